@@ -35,11 +35,10 @@ public: // functions
 
   /// Execute all active child actions
   virtual void execute();
-  
-protected:
+
   /// True if the passed action is disabled
   bool is_disabled(const std::string& name);
-  
+
 private:
   void trigger_disabled_actions();
   std::set<std::string> m_disabled_actions;
@@ -13,8 +13,10 @@
 
 #include "common/AllocatedComponent.hpp"
 #include "common/Action.hpp"
+#include "common/PerfCounters.hpp"
 #include "common/PropertyList.hpp"
 #include "common/Timer.hpp"
+#include "common/TimingTrace.hpp"
 
 namespace cf3 {
 namespace common {
@@ -25,16 +27,38 @@ namespace common {
 
 struct TimedActionImpl::Implementation
 {
-  Implementation(Action& timed_action) : m_timed_component(timed_action)
+  Implementation(Action& timed_action) :
+    m_trace_start(0),
+    m_total_cycles(0.),
+    m_total_instructions(0.),
+    m_total_llc_misses(0.),
+    m_timed_component(timed_action)
   {
     m_timed_component.properties().add("timer_count", Uint(0));
     m_timed_component.properties().add("timer_minimum", Real(0.));
     m_timed_component.properties().add("timer_mean", Real(0.));
     m_timed_component.properties().add("timer_maximum", Real(0.));
     m_timed_component.properties().add("timer_variance", Real(0.));
+    if(PerfCounters::instance().is_available())
+    {
+      m_timed_component.properties().add("perf_cycles", Real(0.));
+      m_timed_component.properties().add("perf_instructions", Real(0.));
+      m_timed_component.properties().add("perf_llc_misses", Real(0.));
+    }
   }
   
   Timer m_timer;
+
+  /// Wall clock time at the start of the execution, if the trace is enabled
+  boost::int64_t m_trace_start;
+
+  /// Hardware counters at the start of the execution
+  PerfCounterValues m_counters_start;
+
+  /// Hardware counters summed over all executions
+  Real m_total_cycles;
+  Real m_total_instructions;
+  Real m_total_llc_misses;
   
   boost::accumulators::accumulator_set
   <
@@ -65,12 +89,31 @@ TimedActionImpl::~TimedActionImpl()
 
 void TimedActionImpl::start_timing()
 {
+  if(TimingTrace::instance().is_enabled())
+    m_implementation->m_trace_start = TimingTrace::now();
+  PerfCounters::instance().read(m_implementation->m_counters_start);
   m_implementation->m_timer.restart();
 }
 
 void TimedActionImpl::stop_timing()
 {
   m_implementation->m_timing_stats(m_implementation->m_timer.elapsed());
+
+  // The counters include the nested actions, just like the timings
+  PerfCounterValues counters;
+  PerfCounters::instance().read(counters);
+  counters.cycles -= m_implementation->m_counters_start.cycles;
+  counters.instructions -= m_implementation->m_counters_start.instructions;
+  counters.llc_misses -= m_implementation->m_counters_start.llc_misses;
+  m_implementation->m_total_cycles += static_cast<Real>(counters.cycles);
+  m_implementation->m_total_instructions += static_cast<Real>(counters.instructions);
+  m_implementation->m_total_llc_misses += static_cast<Real>(counters.llc_misses);
+
+  if(TimingTrace::instance().is_enabled())
+  {
+    const boost::int64_t start = m_implementation->m_trace_start;
+    TimingTrace::instance().record(m_implementation->m_timed_component.uri().path(), start, TimingTrace::now() - start, counters);
+  }
 }
 
 void TimedActionImpl::store_timings()
@@ -80,6 +123,12 @@ void TimedActionImpl::store_timings()
   m_implementation->m_timed_component.properties().set("timer_mean", boost::accumulators::mean(m_implementation->m_timing_stats));
   m_implementation->m_timed_component.properties().set("timer_maximum", boost::accumulators::max(m_implementation->m_timing_stats));
   m_implementation->m_timed_component.properties().set("timer_variance", boost::accumulators::lazy_variance(m_implementation->m_timing_stats));
+  if(PerfCounters::instance().is_available())
+  {
+    m_implementation->m_timed_component.properties().set("perf_cycles", m_implementation->m_total_cycles);
+    m_implementation->m_timed_component.properties().set("perf_instructions", m_implementation->m_total_instructions);
+    m_implementation->m_timed_component.properties().set("perf_llc_misses", m_implementation->m_total_llc_misses);
+  }
 }
 
 #endif
@@ -7,8 +7,11 @@
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 
+#include <boost/thread/thread.hpp>
+
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
 #include <boost/iostreams/restrict.hpp>
 
 #include "rapidxml/rapidxml.hpp"
@@ -29,14 +32,39 @@
 namespace cf3 {
 namespace common {
 
+namespace detail
+{
+  void decompress_chunk(const char* compressed_data, const std::size_t compressed_count, char* data, const std::size_t count)
+  {
+    boost::iostreams::filtering_istream decompressing_stream;
+    decompressing_stream.push(boost::iostreams::zlib_decompressor());
+    decompressing_stream.push(boost::iostreams::array_source(compressed_data, compressed_count));
+    decompressing_stream.read(data, count);
+  }
+
+  /// Decompress the chunks first, first + stride, ...
+  void decompress_chunks(const std::vector<char>& compressed_data, const std::vector<std::size_t>& chunk_begins, char* data, const std::size_t count, const std::size_t chunk_size, const Uint first, const Uint stride)
+  {
+    const Uint nb_chunks = chunk_begins.size() - 1;
+    for(Uint i = first; i < nb_chunks; i += stride)
+    {
+      const std::size_t begin = i*chunk_size;
+      decompress_chunk(&compressed_data[chunk_begins[i]], chunk_begins[i+1] - chunk_begins[i], data + begin, std::min(chunk_size, count - begin));
+    }
+  }
+}
+
 struct BinaryDataReader::Implementation
 {
-  Implementation(const URI& file, const Uint rank) :
+  Implementation(const URI& file, const Uint rank, const Uint nb_threads) :
     xml_doc(XML::parse_file(file)),
-    m_rank(rank)
+    m_rank(rank),
+    m_nb_threads(std::max(nb_threads, 1u))
   {
     XmlNode cfbinary(xml_doc->content->first_node("cfbinary"));
-    cf3_assert(from_str<Uint>(cfbinary.attribute_value("version")) == version());
+    m_version = from_str<Uint>(cfbinary.attribute_value("version"));
+    if(m_version != 1 && m_version != 2)
+      throw FileFormatError(FromHere(), "Unsupported binary data version " + to_str(m_version) + " in file " + file.path());
 
     XmlNode nodes(cfbinary.content->first_node(("nodes")));
     XmlNode node(nodes.content->first_node("node"));
@@ -60,12 +88,6 @@ struct BinaryDataReader::Implementation
   {
   }
 
-  Uint version() const
-  {
-    static const Uint current_version = 1;
-    return current_version;
-  }
-  
   XmlNode get_block_node(const Uint block_idx)
   {
     XmlNode block_node(my_node.content->first_node("block"));
@@ -84,9 +106,9 @@ struct BinaryDataReader::Implementation
     
     XmlNode block_node = get_block_node(block_idx);
       
-    const Uint block_begin = from_str<Uint>(block_node.attribute_value("begin"));
-    const Uint block_end = from_str<Uint>(block_node.attribute_value("end"));
-    const Uint compressed_size = block_end - block_begin - block_prefix.size();
+    const boost::uint64_t block_begin = from_str<boost::uint64_t>(block_node.attribute_value("begin"));
+    const boost::uint64_t block_end = from_str<boost::uint64_t>(block_node.attribute_value("end"));
+    const boost::uint64_t compressed_size = block_end - block_begin - block_prefix.size();
 
     // Check the prefix
     binary_file.seekg(block_begin);
@@ -98,18 +120,53 @@ struct BinaryDataReader::Implementation
    
     if(count != 0)
     {
-      // Build a decompressing stream
-      boost::iostreams::filtering_istream decompressing_stream;
-      decompressing_stream.set_auto_close(false);
-      decompressing_stream.push(boost::iostreams::zlib_decompressor());
-      decompressing_stream.push(boost::iostreams::restrict(binary_file, 0, compressed_size));
-      
-      // Read the data
-      decompressing_stream.read(data, count);
-      decompressing_stream.pop();
+      if(m_version == 1)
+      {
+        // Build a decompressing stream
+        boost::iostreams::filtering_istream decompressing_stream;
+        decompressing_stream.set_auto_close(false);
+        decompressing_stream.push(boost::iostreams::zlib_decompressor());
+        decompressing_stream.push(boost::iostreams::restrict(binary_file, 0, compressed_size));
+
+        // Read the data
+        decompressing_stream.read(data, count);
+        decompressing_stream.pop();
+      }
+      else if(block_node.attribute_value("compression") == "none")
+      {
+        binary_file.read(data, count);
+      }
+      else
+      {
+        // Chunks were compressed independently, so they can be decompressed in parallel
+        std::vector<char> compressed_data(compressed_size);
+        binary_file.read(&compressed_data[0], compressed_size);
+
+        const std::size_t chunk_size = from_str<Uint>(block_node.attribute_value("chunk_size"));
+        std::vector<std::size_t> chunk_begins(1, 0);
+        std::istringstream chunk_sizes(block_node.attribute_value("chunks"));
+        std::size_t chunk_compressed_size;
+        while(chunk_sizes >> chunk_compressed_size)
+          chunk_begins.push_back(chunk_begins.back() + chunk_compressed_size);
+        if(chunk_begins.back() != compressed_size || (chunk_begins.size()-1)*chunk_size < count)
+          throw FileFormatError(FromHere(), "Inconsistent chunk sizes for block " + to_str(block_idx));
+
+        const Uint nb_threads = std::min(m_nb_threads, static_cast<Uint>(chunk_begins.size()-1));
+        if(nb_threads == 1)
+        {
+          detail::decompress_chunks(compressed_data, chunk_begins, data, count, chunk_size, 0, 1);
+        }
+        else
+        {
+          boost::thread_group threads;
+          for(Uint i = 0; i != nb_threads; ++i)
+            threads.create_thread(boost::bind(detail::decompress_chunks, boost::cref(compressed_data), boost::cref(chunk_begins), data, count, chunk_size, i, nb_threads));
+          threads.join_all();
+        }
+      }
     }
     
-    cf3_assert(binary_file.tellg() == block_end);
+    cf3_assert(static_cast<boost::uint64_t>(binary_file.tellg()) == block_end);
   }
 
   // XML document describing all data added
@@ -123,6 +180,12 @@ struct BinaryDataReader::Implementation
 
   // Rank to read
   const Uint m_rank;
+
+  // Number of threads used for decompression
+  const Uint m_nb_threads;
+
+  // Version of the file
+  Uint m_version;
 };
   
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -138,6 +201,11 @@ BinaryDataReader::BinaryDataReader ( const std::string& name ) : Component(name)
     .pretty_name("Rank")
     .description("Rank for which to read data")
     .attach_trigger(boost::bind(&BinaryDataReader::trigger_file, this));
+
+  options().add("nb_threads", 1u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads used to decompress the data")
+    .attach_trigger(boost::bind(&BinaryDataReader::trigger_file, this));
 }
 
 BinaryDataReader::~BinaryDataReader()
@@ -182,11 +250,16 @@ void BinaryDataReader::read_data_block(char *data, const Uint count, const Uint
 void BinaryDataReader::trigger_file()
 {
   const URI file_uri = options().value<URI>("file");
+  if(file_uri.path().empty())
+  {
+    m_implementation.reset();
+    return;
+  }
   if(!boost::filesystem::exists(file_uri.path()))
   {
     throw SetupError(FromHere(), "Input file " + file_uri.path() + " does not exist");
   }
-  m_implementation.reset(new Implementation(file_uri, options().value<Uint>("rank")));
+  m_implementation.reset(new Implementation(file_uri, options().value<Uint>("rank"), options().value<Uint>("nb_threads")));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -8,8 +8,12 @@
 #include <boost/function.hpp>
 #include "common/BoostAssign.hpp"
 
+#include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/device/file_descriptor.hpp>
 
 #include "common/Log.hpp"
@@ -20,6 +24,7 @@
 #include "common/FindComponents.hpp"
 
 #include "common/PE/Comm.hpp"
+#include "common/PE/types.hpp"
 
 #include "common/XML/FileOperations.hpp"
 #include "common/XML/XmlNode.hpp"
@@ -29,114 +34,265 @@
 namespace cf3 {
 namespace common {
 
+namespace detail
+{
+  /// Blocks are compressed in independent chunks of this (uncompressed) size, so they can be processed in parallel
+  const std::size_t compression_chunk_size = 1 << 20;
+
+  /// Largest number of bytes passed to a single MPI-IO call, to stay within the range of int
+  const boost::uint64_t max_mpi_io_size = 1 << 30;
+
+  void compress_chunk(const char* data, const std::size_t count, std::vector<char>& result)
+  {
+    result.clear();
+    boost::iostreams::filtering_ostream compressing_stream;
+    compressing_stream.push(boost::iostreams::zlib_compressor());
+    compressing_stream.push(boost::iostreams::back_inserter(result));
+    compressing_stream.write(data, count);
+    compressing_stream.reset();
+  }
+
+  /// Compress the chunks first, first + stride, ...
+  void compress_chunks(const char* data, const std::size_t count, std::vector< std::vector<char> >& chunks, const Uint first, const Uint stride)
+  {
+    const Uint nb_chunks = chunks.size();
+    for(Uint i = first; i < nb_chunks; i += stride)
+    {
+      const std::size_t chunk_begin = i*compression_chunk_size;
+      compress_chunk(data + chunk_begin, std::min(compression_chunk_size, count - chunk_begin), chunks[i]);
+    }
+  }
+}
+
 struct BinaryDataWriter::Implementation
 {
-  Implementation(const URI& file) :
-    filename(build_filename(file, PE::Comm::instance().rank())),
+  Implementation(const URI& file, const bool shared_file, const bool compress, const Uint nb_threads) :
+    m_shared_file(shared_file && PE::Comm::instance().is_active()),
+    filename(m_shared_file ? build_shared_filename(file) : build_filename(file, PE::Comm::instance().rank())),
     xml_filename(file),
     index(0),
-    xml_doc("1.0", "ISO-8859-1"),
+    m_compress(compress),
+    m_nb_threads(std::max(nb_threads, 1u)),
+    m_file_end(0),
     m_total_count(0)
   {
     const Uint v = version();
-    out_file.open(filename, std::ios_base::out | std::ios_base::binary);
-    out_file.write(reinterpret_cast<const char*>(&v), sizeof(Uint));
-
     PE::Comm& comm = PE::Comm::instance();
-    // Rank 0 writes out an XML file that lists all filenames for all CPUs
-    if(comm.rank() == 0)
+    if(m_shared_file)
     {
-      XmlNode cfbinary = xml_doc.add_node("cfbinary");
-      cfbinary.set_attribute("version", to_str(version()));
-      node_xml_data.reserve(comm.size());
-      XmlNode node_list = cfbinary.add_node("nodes");
-      for(Uint i = 0; i != comm.size(); ++i)
+      // Every rank opens the same file, the version is written by rank 0
+      MPI_CHECK_RESULT(MPI_File_open, (comm.communicator(), const_cast<char*>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &m_mpi_file));
+      MPI_CHECK_RESULT(MPI_File_set_size, (m_mpi_file, 0));
+      if(comm.rank() == 0)
       {
-        XmlNode node = node_list.add_node("node");
-        node.set_attribute("filename", build_filename(file, i));
-        node.set_attribute("rank", to_str(i));
-        node_xml_data.push_back(node);
+        MPI_CHECK_RESULT(MPI_File_write_at, (m_mpi_file, 0, const_cast<Uint*>(&v), sizeof(Uint), MPI_BYTE, MPI_STATUS_IGNORE));
       }
     }
+    else
+    {
+      out_file.open(filename, std::ios_base::out | std::ios_base::binary);
+      out_file.write(reinterpret_cast<const char*>(&v), sizeof(Uint));
+    }
+    m_file_end = sizeof(Uint);
   }
 
   ~Implementation()
   {
-    CFdebug << "wrote a total of " << m_total_count << " bytes with a compression ratio of " << static_cast<Real>(out_file.tellp()) / static_cast<Real>(m_total_count) * 100. << "%" << CFendl;
-    out_file.close();
-    if(PE::Comm::instance().rank() == 0)
-      XML::to_file(xml_doc, xml_filename);
+    CFdebug << "wrote a total of " << m_total_count << " bytes with a compression ratio of " << static_cast<Real>(m_file_end) / static_cast<Real>(m_total_count) * 100. << "%" << CFendl;
+    if(m_shared_file)
+    {
+      // Throwing from a destructor would terminate the program, so a failure is only logged
+      const int close_result = MPI_File_close(&m_mpi_file);
+      if(close_result != MPI_SUCCESS)
+        CFerror << "Closing shared file " << filename << " failed with MPI error code " << close_result << CFendl;
+    }
+    else
+    {
+      out_file.close();
+    }
+
+    write_xml();
 
     PE::Comm::instance().barrier();
   }
 
   Uint write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
   {
-    cf3_assert(out_file.is_open());
-    PE::Comm& comm = PE::Comm::instance();
-    // Prefix and suffix markers
+    // Prefix marker
     static const std::string block_prefix("__CFDATA_BEGIN");
 
-    const Uint block_begin = out_file.tellp();
+    BlockInfo block;
+    block.name = list_name;
+    block.type_name = type_name;
+    block.nb_rows = nb_rows;
+    block.nb_cols = nb_cols;
 
-    // Write the prefix
-    out_file.write(block_prefix.c_str(), block_prefix.size());
-    
-    if(count != 0)
+    // Compress the data, in parallel if requested
+    std::vector< std::vector<char> > chunks;
+    if(m_compress && count != 0)
     {
-      // Build a compressed stream
-      boost::iostreams::filtering_ostream compressing_stream;
-      compressing_stream.push(boost::iostreams::zlib_compressor());
-      compressing_stream.push(out_file);
-      
-      // Write the data
-      compressing_stream.write(data, count);
-      compressing_stream.pop();
+      chunks.resize((count + detail::compression_chunk_size - 1) / detail::compression_chunk_size);
+      const Uint nb_threads = std::min(m_nb_threads, static_cast<Uint>(chunks.size()));
+      if(nb_threads == 1)
+      {
+        detail::compress_chunks(data, count, chunks, 0, 1);
+      }
+      else
+      {
+        boost::thread_group threads;
+        for(Uint i = 0; i != nb_threads; ++i)
+          threads.create_thread(boost::bind(detail::compress_chunks, data, count, boost::ref(chunks), i, nb_threads));
+        threads.join_all();
+      }
+      BOOST_FOREACH(const std::vector<char>& chunk, chunks)
+        block.chunk_sizes.push_back(chunk.size());
     }
 
-    const Uint block_end = out_file.tellp();
+    boost::uint64_t payload_size = m_compress ? 0 : count;
+    BOOST_FOREACH(const std::vector<char>& chunk, chunks)
+      payload_size += chunk.size();
+
+    const boost::uint64_t block_size = block_prefix.size() + payload_size;
+    if(m_shared_file)
+    {
+      // The blocks of all ranks are stored one after the other, in rank order
+      PE::Comm& comm = PE::Comm::instance();
+      boost::uint64_t offset = 0;
+      boost::uint64_t total_size = 0;
+      MPI_CHECK_RESULT(MPI_Exscan, (&block_size, &offset, 1, MPI_UINT64_T, MPI_SUM, comm.communicator()));
+      MPI_CHECK_RESULT(MPI_Allreduce, (&block_size, &total_size, 1, MPI_UINT64_T, MPI_SUM, comm.communicator()));
+      if(comm.rank() == 0)
+        offset = 0; // Result of MPI_Exscan is undefined on rank 0
+      block.begin = m_file_end + offset;
+      m_file_end += total_size;
+
+      std::vector<char> payload;
+      const char* payload_data = data;
+      if(m_compress)
+      {
+        payload.reserve(payload_size);
+        BOOST_FOREACH(const std::vector<char>& chunk, chunks)
+          payload.insert(payload.end(), chunk.begin(), chunk.end());
+        payload_data = payload.empty() ? 0 : &payload[0];
+      }
+      write_at_all(block.begin, block_prefix.c_str(), block_prefix.size());
+      write_at_all(block.begin + block_prefix.size(), payload_data, payload_size);
+    }
+    else
+    {
+      cf3_assert(out_file.is_open());
+      block.begin = m_file_end;
+      m_file_end += block_size;
+      out_file.write(block_prefix.c_str(), block_prefix.size());
+      if(m_compress)
+      {
+        BOOST_FOREACH(const std::vector<char>& chunk, chunks)
+          out_file.write(&chunk[0], chunk.size());
+      }
+      else
+      {
+        out_file.write(data, count);
+      }
+    }
+    block.end = block.begin + block_size;
+
+    m_blocks.push_back(block);
+
+    ++index;
+    m_total_count += count;
+
+    return index - 1;
+  }
+
+  /// Collective write of count bytes at the given offset in the shared file
+  void write_at_all(const boost::uint64_t offset, const char* data, const boost::uint64_t count)
+  {
+    PE::Comm& comm = PE::Comm::instance();
+    boost::uint64_t nb_calls = (count + detail::max_mpi_io_size - 1) / detail::max_mpi_io_size;
+    boost::uint64_t max_nb_calls = 0;
+    MPI_CHECK_RESULT(MPI_Allreduce, (&nb_calls, &max_nb_calls, 1, MPI_UINT64_T, MPI_MAX, comm.communicator()));
+    for(boost::uint64_t i = 0; i != max_nb_calls; ++i)
+    {
+      const boost::uint64_t begin = std::min(i*detail::max_mpi_io_size, count);
+      const boost::uint64_t size = std::min(detail::max_mpi_io_size, count - begin);
+      MPI_CHECK_RESULT(MPI_File_write_at_all, (m_mpi_file, offset + begin, const_cast<char*>(data + begin), static_cast<int>(size), MPI_BYTE, MPI_STATUS_IGNORE));
+    }
+  }
+
+  /// Gather the block descriptions on rank 0, which writes out an XML file that lists all blocks for all CPUs
+  void write_xml()
+  {
+    PE::Comm& comm = PE::Comm::instance();
+
+    // Per block: nb_rows, nb_cols, begin, end, number of chunks and the compressed chunk sizes
+    std::vector<boost::uint64_t> my_block_info;
+    BOOST_FOREACH(const BlockInfo& block, m_blocks)
+    {
+      my_block_info.push_back(block.nb_rows);
+      my_block_info.push_back(block.nb_cols);
+      my_block_info.push_back(block.begin);
+      my_block_info.push_back(block.end);
+      my_block_info.push_back(block.chunk_sizes.size());
+      my_block_info.insert(my_block_info.end(), block.chunk_sizes.begin(), block.chunk_sizes.end());
+    }
 
-    // Data describing the block on the current CPU
-    const std::vector<Uint> my_block_info = boost::assign::list_of(nb_rows)(nb_cols)(block_begin)(block_end);
-    const Uint block_info_size = my_block_info.size();
-    std::vector<Uint> global_block_info;
     const Uint root = 0;
+    const Uint nb_procs = comm.size();
+    std::vector<boost::uint64_t> global_block_info;
+    std::vector<int> global_block_info_sizes(nb_procs, -1);
     if(comm.is_active())
     {
-      comm.gather(my_block_info, global_block_info, root);
+      comm.gather(my_block_info, my_block_info.size(), global_block_info, global_block_info_sizes, root);
     }
     else
     {
       global_block_info = my_block_info;
+      global_block_info_sizes.assign(1, my_block_info.size());
     }
 
-    // Write out the XML data
-    if(comm.rank() == root)
+    if(comm.rank() != root)
+      return;
+
+    XmlDoc xml_doc("1.0", "ISO-8859-1");
+    XmlNode cfbinary = xml_doc.add_node("cfbinary");
+    cfbinary.set_attribute("version", to_str(version()));
+    XmlNode node_list = cfbinary.add_node("nodes");
+    Uint j = 0;
+    for(Uint i = 0; i != nb_procs; ++i)
     {
-      const Uint nb_procs = comm.size();
-      for(Uint i = 0; i != nb_procs; ++i)
+      XmlNode node = node_list.add_node("node");
+      node.set_attribute("filename", m_shared_file ? filename : build_filename(xml_filename, i));
+      node.set_attribute("rank", to_str(i));
+      const Uint nb_blocks = m_blocks.size();
+      for(Uint block_idx = 0; block_idx != nb_blocks; ++block_idx)
       {
-        XmlNode block_xml = node_xml_data[i].add_node("block");
-        const Uint j = i*block_info_size;
-        block_xml.set_attribute("name", list_name);
-        block_xml.set_attribute("index", to_str(index));
-        block_xml.set_attribute("type_name", type_name);
+        const BlockInfo& block = m_blocks[block_idx];
+        XmlNode block_xml = node.add_node("block");
+        block_xml.set_attribute("name", block.name);
+        block_xml.set_attribute("index", to_str(block_idx));
+        block_xml.set_attribute("type_name", block.type_name);
         block_xml.set_attribute("nb_rows", to_str(global_block_info[j]));
         block_xml.set_attribute("nb_cols", to_str(global_block_info[j+1]));
         block_xml.set_attribute("begin", to_str(global_block_info[j+2]));
         block_xml.set_attribute("end", to_str(global_block_info[j+3]));
+        block_xml.set_attribute("compression", m_compress ? "zlib" : "none");
+        const Uint nb_chunks = global_block_info[j+4];
+        if(m_compress)
+        {
+          block_xml.set_attribute("chunk_size", to_str(detail::compression_chunk_size));
+          block_xml.set_attribute("chunks", to_str(std::vector<unsigned long>(global_block_info.begin()+j+5, global_block_info.begin()+j+5+nb_chunks)));
+        }
+        j += 5 + nb_chunks;
       }
     }
+    cf3_assert(j == global_block_info.size());
 
-    ++index;
-    m_total_count += count;
-
-    return index - 1;
+    XML::to_file(xml_doc, xml_filename);
   }
 
   Uint version() const
   {
-    static const Uint current_version = 1;
+    static const Uint current_version = 2;
     return current_version;
   }
 
@@ -148,6 +304,28 @@ struct BinaryDataWriter::Implementation
     return result.path();
   }
 
+  std::string build_shared_filename(const URI& input)
+  {
+    const URI result(input.base_path() / (input.base_name() + ".cfbin"));
+    return result.path();
+  }
+
+  /// Description of a block written by this rank
+  struct BlockInfo
+  {
+    std::string name;
+    std::string type_name;
+    Uint nb_rows;
+    Uint nb_cols;
+    boost::uint64_t begin;
+    boost::uint64_t end;
+    std::vector<unsigned long> chunk_sizes;
+  };
+
+  // True if all ranks write to a single file using MPI-IO. Only possible if the communicator is active.
+  const bool m_shared_file;
+  MPI_File m_mpi_file;
+
   const std::string filename;
   const URI xml_filename;
   boost::filesystem::fstream out_file;
@@ -155,11 +333,14 @@ struct BinaryDataWriter::Implementation
   // Index of the next block to write
   Uint index;
 
-  // XML document describing all data added (only valid on root process)
-  XmlDoc xml_doc;
+  const bool m_compress;
+  const Uint m_nb_threads;
+
+  // Size of the file
+  boost::uint64_t m_file_end;
 
-  std::vector<XmlNode> node_xml_data;
-  Uint m_total_count;
+  std::vector<BlockInfo> m_blocks;
+  boost::uint64_t m_total_count;
 };
   
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,6 +351,21 @@ BinaryDataWriter::BinaryDataWriter ( const std::string& name ) : Component(name)
     .pretty_name("File")
     .description("File name for the output file")
     .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
+
+  options().add("shared_file", false)
+    .pretty_name("Shared File")
+    .description("Write the data of all ranks into a single file, using collective MPI-IO")
+    .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
+
+  options().add("compress", true)
+    .pretty_name("Compress")
+    .description("Compress the data using zlib")
+    .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
+
+  options().add("nb_threads", 1u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads used to compress the data")
+    .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
 }
 
 BinaryDataWriter::~BinaryDataWriter()
@@ -186,7 +382,7 @@ Uint BinaryDataWriter::write_data_block(const char* data, const std::streamsize
 {
   if(is_null(m_implementation.get()))
   {
-    m_implementation.reset(new Implementation(options().value<URI>("file")));
+    m_implementation.reset(new Implementation(options().value<URI>("file"), options().value<bool>("shared_file"), options().value<bool>("compress"), options().value<Uint>("nb_threads")));
   }
 
   return m_implementation->write_data_block(data, count, list_name, nb_rows, nb_cols, type_name);
@@ -21,7 +21,10 @@ namespace common {
 ///////////////////////////////////////////////////////////////////////////////////////
 
   
-/// Component for writing binary data collected into a single file
+/// Component for writing binary data collected into a single file.
+/// By default each rank writes its own file. With the shared_file option all ranks write into one file using
+/// collective MPI-IO, each rank's part of a block placed at an offset obtained from an exclusive scan of the block sizes.
+/// Data is compressed in independent chunks, optionally using several threads, or written as-is if compress is false.
 class Common_API BinaryDataWriter : public Component {
 
 public: // functions
@@ -8,6 +8,7 @@
 #include <boost/cast.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "rapidxml/rapidxml.hpp"
 
@@ -52,6 +53,25 @@ ComponentBuilder < Component, Component, LibCommon > Component_Builder;
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+/// Tagged components in the subtree of a component, per tag
+struct Component::TagIndex
+{
+  std::map< std::string, std::vector< Handle<Component> > > tagged;
+};
+
+namespace detail
+{
+  /// Guards the creation, filling and clearing of all tag indices. Never deleted, since the components of the Core
+  /// are destroyed during static destruction
+  boost::mutex& tag_index_mutex()
+  {
+    static boost::mutex* mutex = new boost::mutex();
+    return *mutex;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 Component::Component ( const std::string& name ) :
     m_name (),
     m_properties(new PropertyList()),
@@ -206,6 +226,9 @@ Component::Component ( const std::string& name ) :
 
 Component::~Component()
 {
+  // The children are destroyed after this, and they clear the tag index of their parents when their tags change
+  boost::mutex::scoped_lock lock(detail::tag_index_mutex());
+  m_tag_index.reset();
 }
 
 
@@ -307,6 +330,7 @@ Component& Component::add_component ( const boost::shared_ptr<Component>& subcom
   cf3_assert(m_component_lookup.size() == m_components.size());
 
   subcomp->m_parent = this;
+  invalidate_tag_index();
 
   raise_tree_updated_event();
 
@@ -384,6 +408,7 @@ boost::shared_ptr<Component> Component::remove_component ( const std::string& na
       new_storage.push_back(m_components[i]);
     }
     m_components = new_storage;
+    invalidate_tag_index();
 
     raise_tree_updated_event();
 
@@ -467,6 +492,58 @@ Handle<Component> Component::get_child_checked(const std::string& name)
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+  void put_tagged_components(const std::vector< boost::shared_ptr<Component> >& components, const std::string& tag, std::vector< Handle<Component> >& result)
+  {
+    BOOST_FOREACH(const boost::shared_ptr<Component>& comp, components)
+    {
+      if(comp->has_tag(tag))
+        result.push_back(Handle<Component>(comp));
+    }
+  }
+}
+
+std::vector< Handle<Component> > Component::components_with_tag(const std::string& tag) const
+{
+  boost::mutex::scoped_lock lock(detail::tag_index_mutex());
+
+  if(!m_tag_index)
+    m_tag_index.reset(new TagIndex());
+
+  std::map< std::string, std::vector< Handle<Component> > >::iterator found = m_tag_index->tagged.find(tag);
+  if(found != m_tag_index->tagged.end())
+    return found->second;
+
+  std::vector< boost::shared_ptr<Component> > subtree;
+  const_cast<Component*>(this)->put_components<Component>(subtree, true);
+  std::vector< Handle<Component> >& result = m_tag_index->tagged[tag];
+  detail::put_tagged_components(subtree, tag, result);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void Component::invalidate_tag_index()
+{
+  boost::mutex::scoped_lock lock(detail::tag_index_mutex());
+  for(Component* comp = this; comp != 0; comp = comp->m_parent)
+  {
+    if(comp->m_tag_index)
+      comp->m_tag_index->tagged.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void Component::tags_changed()
+{
+  if(is_not_null(m_parent))
+    m_parent->invalidate_tag_index();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void Component::change_parent(Handle<Component> to_parent)
 {
   // modifiy the parent, may be NULL
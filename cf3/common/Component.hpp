@@ -15,6 +15,7 @@
 
 #include <boost/version.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "common/AllocatedComponent.hpp"
 #include "common/Assertions.hpp"
@@ -202,6 +203,10 @@ public: // functions
   Handle<Component> get_child_checked(const std::string& name);
   Handle<Component const> get_child_checked(const std::string& name) const;
 
+  /// Components below this one (recursively) that have the given tag, in the order of a recursive search.
+  /// The result is cached, until a component is added or removed or a tag changes anywhere in the subtree.
+  std::vector< Handle<Component> > components_with_tag(const std::string& tag) const;
+
   /// @brief Build a (sub)component of this component using the extended type_name of the component.
   ///
   /// The Library is extracted from the extended type_name, and inside is searched for the builder.
@@ -420,6 +425,9 @@ private: // helper functions
   /// Triggered when the "ping" event is raised. Useful to find out what components still exist
   void on_ping_event( SignalArgs& args );
 
+  /// Clear the tag index of this component and all of its parents
+  void invalidate_tag_index();
+
 private: // data
 
   /// component name (stored as path to ensure validity)
@@ -434,12 +442,18 @@ private: // data
   CompLookupT m_component_lookup;
   /// pointer to parent, naked pointer because of static components
   Component* m_parent;
+  /// Cache for components_with_tag, created on first use
+  struct TagIndex;
+  mutable boost::scoped_ptr<TagIndex> m_tag_index;
 
 protected: // functions
 
   /// raise event that the path has changed
   void raise_tree_updated_event();
 
+  /// Invalidates the tag index of the parents
+  virtual void tags_changed();
+
   /// Friend declarations allow enable_shared_from_this to be private
   template<class T> friend class boost::enable_shared_from_this;
   template<class T> friend class boost::shared_ptr;
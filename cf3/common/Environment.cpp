@@ -12,6 +12,8 @@
 #include "common/Log.hpp"
 #include "common/Environment.hpp"
 #include "common/PropertyList.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/TimingTrace.hpp"
 
 namespace cf3 {
 namespace common {
@@ -102,6 +104,17 @@ Environment::Environment ( const std::string& name) : Component ( name )
       .mark_basic()
       .attach_trigger(boost::bind(&Environment::trigger_log_level,this));
 
+  options().add("trace_actions", false)
+      .pretty_name("Trace Actions")
+      .description("Record the start time, duration and hardware counters of every execution of a timed action, "
+                   "to write a timeline with PrintTimingTree. Requires CF3_ENABLE_COMPONENT_TIMING.")
+      .attach_trigger(boost::bind(&Environment::trigger_trace_actions,this));
+
+  options().add("nb_threads", 1u)
+      .pretty_name("Number of Threads")
+      .description("Number of threads of the shared thread pool, used by the threaded mesh actions such as WallDistance")
+      .attach_trigger(boost::bind(&Environment::trigger_nb_threads,this));
+
   trigger_log_level();
 
   // signals
@@ -180,5 +193,19 @@ void Environment::trigger_log_level()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void Environment::trigger_trace_actions()
+{
+  TimingTrace::instance().enable(options().value<bool>("trace_actions"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::trigger_nb_threads()
+{
+  ThreadPool::shared().resize(options().value<Uint>("nb_threads"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
@@ -51,6 +51,10 @@ private: // functions
 
   void trigger_log_level();
 
+  void trigger_trace_actions();
+
+  void trigger_nb_threads();
+
 }; // Environment
 
 ////////////////////////////////////////////////////////////////////////////////
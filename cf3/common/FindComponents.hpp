@@ -1105,63 +1105,73 @@ find_component_ptr_recursively_with_name(ParentT& parent, StringConverter name)
 
 //////////////////////////////////////////////////////////////////////////////
 
-inline ComponentReference<Component>::type
-find_component_recursively_with_tag(Component& parent, StringConverter tag)
+namespace detail
 {
-  try
+  /// Unique component of type ComponentT below parent with the given tag, looked up in the tag index of parent
+  /// @return a null handle if there is no match or more than one
+  template<typename ComponentT>
+  Handle<ComponentT> unique_tagged_component(const Component& parent, const std::string& tag)
   {
-    return find_component_recursively_with_filter(parent, IsComponentTag(tag));
+    Handle<ComponentT> result;
+    const std::vector< Handle<Component> > tagged = parent.components_with_tag(tag);
+    for(std::vector< Handle<Component> >::const_iterator it = tagged.begin(); it != tagged.end(); ++it)
+    {
+      Handle<ComponentT> candidate(*it);
+      if(is_null(candidate))
+        continue;
+      if(is_not_null(result))
+        return Handle<ComponentT>();
+      result = candidate;
+    }
+    return result;
   }
-  catch (ValueNotFound& e)
-  {
+}
+
+inline ComponentReference<Component>::type
+find_component_recursively_with_tag(Component& parent, StringConverter tag)
+{
+  Handle<Component> result = detail::unique_tagged_component<Component>(parent, tag.str());
+  if(is_null(result))
     throw ValueNotFound(FromHere(), "Unique component not found recursively with tag \"" +tag.str()+ "\" in " + parent.uri().string());
-  }
+  return *result;
 }
 
 inline ComponentReference<Component const>::type
 find_component_recursively_with_tag(const Component& parent, StringConverter tag)
 {
-  try
-  {
-    return find_component_recursively_with_filter(parent, IsComponentTag(tag));
-  }
-  catch (ValueNotFound& e)
-  {
+  Handle<Component> result = detail::unique_tagged_component<Component>(parent, tag.str());
+  if(is_null(result))
     throw ValueNotFound(FromHere(), "Unique component not found recursively with tag \"" +tag.str()+ "\" in " + parent.uri().string());
-  }
+  return *result;
 }
 
 template<typename ComponentT, typename ParentT>
 inline typename ComponentReference<ParentT, ComponentT>::type
 find_component_recursively_with_tag(ParentT& parent, StringConverter tag)
 {
-  try
-  {
-    return find_component_recursively_with_filter<ComponentT>(parent, IsComponentTag(tag));
-  }
-  catch (ValueNotFound& e)
-  {
+  Handle<ComponentT> result = detail::unique_tagged_component<ComponentT>(parent, tag.str());
+  if(is_null(result))
     throw ValueNotFound(FromHere(), "Unique component not found recursively with tag \"" +tag.str()+ "\" and with type " + ComponentT::type_name() + " in " + parent.uri().string());
-  }
+  return *result;
 }
 
 inline ComponentHandle<Component>::type
 find_component_ptr_recursively_with_tag(Component& parent, StringConverter tag)
 {
-  return find_component_ptr_recursively_with_filter(parent,IsComponentTag(tag));
+  return detail::unique_tagged_component<Component>(parent, tag.str());
 }
 
 inline ComponentHandle<Component const>::type
 find_component_ptr_recursively_with_tag(const Component& parent, StringConverter tag)
 {
-  return find_component_ptr_recursively_with_filter(parent,IsComponentTag(tag));
+  return ComponentHandle<Component const>::type(detail::unique_tagged_component<Component>(parent, tag.str()));
 }
 
 template<typename ComponentT, typename ParentT>
 inline typename ComponentHandle<ParentT, ComponentT>::type
 find_component_ptr_recursively_with_tag(ParentT& parent, StringConverter tag)
 {
-  return find_component_ptr_recursively_with_filter<ComponentT>(parent,IsComponentTag(tag));
+  return typename ComponentHandle<ParentT, ComponentT>::type(detail::unique_tagged_component<ComponentT>(parent, tag.str()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,473 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_HashMap_hpp
+#define cf3_common_HashMap_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/type_traits/is_integral.hpp>
+
+#include "common/Component.hpp"
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+  /// Position of key in a dense table starting at first_key, for integral keys
+  template<typename KEY>
+  inline bool dense_offset(const KEY& first_key, const KEY& key, const Uint size, Uint& offset, boost::true_type)
+  {
+    if(key < first_key || static_cast<boost::uint64_t>(key - first_key) >= size)
+      return false;
+    offset = static_cast<Uint>(key - first_key);
+    return true;
+  }
+
+  /// Keys that are not integral never form a dense table
+  template<typename KEY>
+  inline bool dense_offset(const KEY&, const KEY&, const Uint, Uint&, boost::false_type)
+  {
+    return false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Component holding a map with a single key, using open addressing with linear probing.
+/// It has the same interface as Map, but lookups cost O(1) and keys can be inserted
+/// at any time without re-sorting, so lookups may be interleaved with insertions.
+/// The pairs are stored contiguously in insertion order, next to a table of slots
+/// that index into them.
+/// As long as integral keys are inserted as a contiguous, increasing sequence
+/// (e.g. the global indices owned by a rank), no slot table is built and lookup is a
+/// simple offset from the first key.
+/// @note erase() moves the last pair into the erased position, so it invalidates iterators
+///       and does not keep insertion order.
+/// @pre KEY must be usable with boost::hash and operator==
+template <typename KEY, typename DATA>
+class HashMap : public Component {
+
+public: // typedefs
+
+  /// @brief Associative Container -- The map's key type, Key.
+  typedef KEY key_type;
+  /// @brief Pair Associative Container -- The type of object associated with the keys.
+  typedef DATA data_type;
+  /// @brief The type of object, pair<key_type, data_type>, stored in the map.
+  typedef std::pair<key_type, data_type> value_type;
+
+  /// @brief iterator definition for use in stl algorithms
+  typedef typename std::vector<value_type>::iterator         iterator;
+  /// @brief const_iterator definition for use in stl algorithms
+  typedef typename std::vector<value_type>::const_iterator   const_iterator;
+
+public: // functions
+
+  /// Contructor
+  /// @param[in] name of the component
+  HashMap ( const std::string& name ) : Component(name), m_mask(0), m_dense(boost::is_integral<KEY>::value)
+  {
+    regist_typeinfo(this);
+  }
+
+  /// Virtual destructor
+  virtual ~HashMap() {}
+
+  /// Get the class name
+  static std::string type_name () { return "HashMap<"+common::class_name<KEY>()+","+common::class_name<DATA>()+">"; }
+
+  /// @brief Reserve memory
+  /// @param[in] max_size of the map to be set before starting inserting pairs in the map
+  void reserve (size_t max_size);
+
+  /// @brief Copy a std::map into the HashMap
+  /// @param[in] map The map to copy
+  void copy_std_map (std::map<key_type,data_type>& map);
+
+  /// @brief Insert pair without checking if the key is already present
+  /// @param[in] key   new key to be inserted, must not be in the map yet
+  /// @param[in] data  new data to be inserted, corresponding to the given key
+  /// @return the index of the new pair, counted from begin()
+  Uint push_back(const key_type& key, const data_type& data);
+
+  /// @brief Insert pair the same way a std::map would.
+  /// @returns a pair, with its member pair::first set to an
+  ///          iterator pointing to either the newly inserted element or to the element
+  ///          that already had its same value in the map. The pair::second element in
+  ///          the pair is set to true if a new element was inserted or false if an element
+  ///          with the same value existed.
+  std::pair<iterator,bool> insert(const value_type& v);
+
+  /// @brief Find the iterator matching with the given KEY
+  /// @return the iterator with key and value, the end() iterator is returned
+  ///         if no match is found
+  iterator find(const key_type& key)
+  {
+    return m_entries.begin() + lookup(key);
+  }
+
+  /// @brief Find the iterator matching with the given KEY
+  /// @return the iterator with key and value, the end() iterator is returned
+  ///         if no match is found
+  const_iterator find(const key_type& key) const
+  {
+    return m_entries.begin() + lookup(key);
+  }
+
+  /// @brief Look up a batch of keys at once
+  /// @param[in] keys The keys to look up
+  /// @param[out] result The data for each key, resized to the number of keys
+  /// @param[in] not_found Value stored in result for keys that are not in the map
+  /// @return the number of keys that were found
+  Uint find(const std::vector<key_type>& keys, std::vector<data_type>& result, const data_type& not_found) const;
+
+  /// @brief Erase the given iterator from the map
+  /// @note The last pair takes the place of the erased one
+  void erase (iterator itr)
+  {
+    erase_entry(itr - m_entries.begin());
+  }
+
+  /// @brief Erase the entry with given key from the map
+  /// @returns true if element is erased, false if no element was erased
+  bool erase (const key_type& key)
+  {
+    const Uint idx = lookup(key);
+    if(idx == m_entries.size())
+      return false;
+    erase_entry(idx);
+    return true;
+  }
+
+  /// @brief Check if the given KEY is existing in the map
+  bool exists(const key_type& key) const
+  {
+    return lookup(key) != m_entries.size();
+  }
+
+  /// @brief Clear the content of the map
+  void clear();
+
+  /// @brief Get the number of pairs already inserted
+  size_t size() const { return m_entries.size(); }
+
+  /// @brief Get the capacity of the map (memory allocated)
+  size_t capacity() const { return m_entries.capacity(); }
+
+  /// @brief Overloading of the operator"[]" for assignment AND insertion
+  /// @param[in] key The key to look for. If the key is not found,
+  ///               it is inserted using push_back().
+  /// @return modifiable data. In case the key did not exist, this will assign the newly created data.
+  data_type& operator[] (const key_type& key);
+
+  /// @brief Access to the data for an existing key
+  /// @return non-modifiable data for the given key
+  const data_type& operator[] (const key_type& key) const;
+
+  /// @brief Does nothing, the map is always ready for lookup. Provided for compatibility with Map.
+  void sort_keys() {}
+
+  /// True if the keys form a contiguous sequence, so no slot table is used
+  bool is_dense() const { return m_dense; }
+
+  /// @return the iterator pointing at the first element
+  iterator begin() { return m_entries.begin(); }
+
+  /// @return the const_iterator pointing at the first element
+  const_iterator begin() const { return m_entries.begin(); }
+
+  /// @return the end iterator
+  iterator end() { return m_entries.end(); }
+
+  /// @return the end const_iterator
+  const_iterator end() const { return m_entries.end(); }
+
+private: // helper functions
+
+  /// Hash of a key, with the bits mixed so the low bits can be used as slot index
+  static Uint hash(const key_type& key)
+  {
+    boost::uint64_t h = static_cast<boost::uint64_t>(boost::hash<key_type>()(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<Uint>(h);
+  }
+
+  /// Index of the pair with the given key, or size() if it is not present
+  Uint lookup(const key_type& key) const
+  {
+    const Uint nb_entries = m_entries.size();
+    if(nb_entries == 0)
+      return 0;
+
+    if(m_dense)
+    {
+      Uint offset;
+      if(detail::dense_offset(m_entries.front().first, key, nb_entries, offset, boost::is_integral<KEY>()))
+        return offset;
+      return nb_entries;
+    }
+
+    Uint slot = hash(key) & m_mask;
+    while(m_slots[slot] != 0)
+    {
+      const Uint idx = m_slots[slot] - 1;
+      if(m_entries[idx].first == key)
+        return idx;
+      slot = (slot + 1) & m_mask;
+    }
+    return nb_entries;
+  }
+
+  /// Slot that points to the pair at index idx
+  Uint slot_of(const Uint idx) const
+  {
+    Uint slot = hash(m_entries[idx].first) & m_mask;
+    while(m_slots[slot] != idx+1)
+    {
+      cf3_assert(m_slots[slot] != 0);
+      slot = (slot + 1) & m_mask;
+    }
+    return slot;
+  }
+
+  /// Store the pair at index idx in the first free slot for its key
+  void insert_slot(const Uint idx)
+  {
+    Uint slot = hash(m_entries[idx].first) & m_mask;
+    while(m_slots[slot] != 0)
+      slot = (slot + 1) & m_mask;
+    m_slots[slot] = idx+1;
+  }
+
+  /// Build the slot table for at least the given number of pairs, keeping the load factor below 1/2
+  void rehash(const size_t nb_entries);
+
+  /// Remove the pair at index idx
+  void erase_entry(const Uint idx);
+
+private: //data
+
+  /// storage of the inserted data
+  std::vector<value_type> m_entries;
+
+  /// Open addressing table, storing index+1 into m_entries, or 0 for an empty slot. Unused in dense mode.
+  std::vector<Uint> m_slots;
+
+  /// Size of m_slots minus one, m_slots having a power of two size
+  Uint m_mask;
+
+  /// True if the key of entry i is m_entries.front().first + i
+  bool m_dense;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline void HashMap<KEY,DATA>::reserve (size_t max_size)
+{
+  m_entries.reserve(max_size);
+  if(!m_dense)
+    rehash(max_size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+void HashMap<KEY,DATA>::copy_std_map (std::map<key_type,data_type>& map)
+{
+  clear();
+  reserve(map.size());
+
+  typename std::map<key_type,data_type>::iterator itr = map.begin();
+  typename std::map<key_type,data_type>::iterator map_end = map.end();
+  for(; itr != map_end; ++itr)
+    push_back(itr->first,itr->second);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline Uint HashMap<KEY,DATA>::push_back(const key_type& key, const data_type& data)
+{
+  cf3_assert_desc ("Duplicated key inserted in map "+uri().string(), !exists(key));
+
+  const Uint idx = m_entries.size();
+  if(m_dense)
+  {
+    Uint offset;
+    if(idx == 0 || (detail::dense_offset(m_entries.front().first, key, idx+1, offset, boost::is_integral<KEY>()) && offset == idx))
+    {
+      m_entries.push_back(std::make_pair(key,data));
+      return idx;
+    }
+    m_dense = false;
+    m_entries.push_back(std::make_pair(key,data));
+    rehash(m_entries.size());
+    return idx;
+  }
+
+  m_entries.push_back(std::make_pair(key,data));
+  if(2*m_entries.size() > m_slots.size())
+    rehash(m_entries.size());
+  else
+    insert_slot(idx);
+  return idx;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline std::pair<typename HashMap<KEY,DATA>::iterator,bool> HashMap<KEY,DATA>::insert(const value_type& v)
+{
+  const Uint idx = lookup(v.first);
+  if(idx != m_entries.size())
+    return std::make_pair(m_entries.begin() + idx, false);
+
+  return std::make_pair(m_entries.begin() + push_back(v.first, v.second), true);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+Uint HashMap<KEY,DATA>::find(const std::vector<key_type>& keys, std::vector<data_type>& result, const data_type& not_found) const
+{
+  const Uint nb_keys = keys.size();
+  const Uint nb_entries = m_entries.size();
+  result.resize(nb_keys);
+  Uint nb_found = 0;
+  for(Uint i = 0; i != nb_keys; ++i)
+  {
+    const Uint idx = lookup(keys[i]);
+    if(idx == nb_entries)
+    {
+      result[i] = not_found;
+    }
+    else
+    {
+      result[i] = m_entries[idx].second;
+      ++nb_found;
+    }
+  }
+  return nb_found;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline void HashMap<KEY,DATA>::clear()
+{
+  std::vector<value_type>().swap(m_entries);
+  std::vector<Uint>().swap(m_slots);
+  m_mask = 0;
+  m_dense = boost::is_integral<KEY>::value;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline typename HashMap<KEY,DATA>::data_type& HashMap<KEY,DATA>::operator[] (const key_type& key)
+{
+  const Uint idx = lookup(key);
+  if(idx != m_entries.size())
+    return m_entries[idx].second;
+
+  return m_entries[push_back(key,data_type())].second;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+inline const typename HashMap<KEY,DATA>::data_type& HashMap<KEY,DATA>::operator[] (const key_type& key) const
+{
+  const Uint idx = lookup(key);
+  cf3_assert_desc( "The key is not found in the HashMap, and can not be inserted in const version." , idx != m_entries.size());
+  return m_entries[idx].second;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+void HashMap<KEY,DATA>::rehash(const size_t nb_entries)
+{
+  Uint nb_slots = 16;
+  while(nb_slots < 2*nb_entries)
+    nb_slots *= 2;
+
+  if(nb_slots <= m_slots.size())
+    return;
+
+  m_slots.assign(nb_slots, 0);
+  m_mask = nb_slots - 1;
+  const Uint nb_inserted = m_entries.size();
+  for(Uint i = 0; i != nb_inserted; ++i)
+    insert_slot(i);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename KEY, typename DATA>
+void HashMap<KEY,DATA>::erase_entry(const Uint idx)
+{
+  cf3_assert(idx < m_entries.size());
+  const Uint last = m_entries.size() - 1;
+
+  if(m_dense)
+  {
+    if(idx == last)
+    {
+      m_entries.pop_back();
+      return;
+    }
+    m_dense = false;
+    rehash(m_entries.size());
+  }
+
+  // Backward shift deletion: move up the pairs that probed past the freed slot
+  Uint hole = slot_of(idx);
+  Uint slot = hole;
+  while(true)
+  {
+    slot = (slot + 1) & m_mask;
+    if(m_slots[slot] == 0)
+      break;
+    const Uint home = hash(m_entries[m_slots[slot]-1].first) & m_mask;
+    // The pair can move if its home slot is not cyclically in (hole, slot]
+    const bool can_move = hole < slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+    if(can_move)
+    {
+      m_slots[hole] = m_slots[slot];
+      hole = slot;
+    }
+  }
+  m_slots[hole] = 0;
+
+  if(idx != last)
+  {
+    m_slots[slot_of(last)] = idx+1;
+    m_entries[idx] = m_entries[last];
+  }
+  m_entries.pop_back();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_HashMap_hpp
@@ -55,7 +55,8 @@ public: // functions
   /// Contructor
   /// @param name of the component
   List ( const std::string& name ) :
-    Component ( name )
+    Component ( name ),
+    m_nb_views(0)
   {
 
   }
@@ -68,6 +69,9 @@ public: // functions
   /// @param[in] new_size The size allocated after resizing
   void resize(const Uint new_size)
   {
+    if(new_size == size())
+      return;
+    check_resizable();
     m_array.resize(boost::extents[new_size]);
   }
 
@@ -85,6 +89,7 @@ public: // functions
   /// @return A Buffer object that can fill this Array
   Buffer create_buffer(const size_t buffersize=16384)
   {
+    check_resizable();
     return Buffer(m_array,buffersize);
   }
 
@@ -94,6 +99,7 @@ public: // functions
   /// @return A Buffer object that can fill this Array
   typename boost::shared_ptr<Buffer> create_buffer_ptr(const size_t buffersize=16384)
   {
+    check_resizable();
     return boost::shared_ptr<Buffer>( new Buffer(m_array,buffersize) );
   }
 
@@ -110,11 +116,33 @@ public: // functions
   /// @return The number of local rows in the array
   Uint size() const { return m_array.size(); }
 
+  /// Register an external view that aliases the storage, such as a Python buffer.
+  /// As long as views exist, the list can't change size and buffers can't be created.
+  /// Views must therefore be released before any mesh transformation, such as load balancing or growing the overlap.
+  void add_view() { ++m_nb_views; }
+
+  /// Unregister a view that was registered using add_view
+  void remove_view() { cf3_assert(m_nb_views != 0); --m_nb_views; }
+
+  /// Number of external views on the storage
+  Uint nb_views() const { return m_nb_views; }
+
+private: // functions
+
+  /// Throw if the storage is aliased by an external view, since reallocating it would invalidate the view
+  void check_resizable() const
+  {
+    if(m_nb_views != 0)
+      throw IllegalCall(FromHere(), "Can't resize " + uri().path() + " while " + to_str(m_nb_views) + " views of its data exist");
+  }
+
 private: // data
 
   /// storage of the array
   ListT m_array;
 
+  /// number of external views aliasing m_array
+  Uint m_nb_views;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
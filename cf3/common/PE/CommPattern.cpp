@@ -13,6 +13,7 @@
 #include "common/FindComponents.hpp"
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
+#include "common/OptionList.hpp"
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
@@ -51,11 +52,18 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
   m_sendCount(PE::Comm::instance().size(),0),
   m_sendMap(0),
   m_recvCount(PE::Comm::instance().size(),0),
-  m_recvMap(0)
+  m_recvMap(0),
+  m_self_send_start(-1),
+  m_self_recv_start(-1),
+  m_communicator(MPI_COMM_NULL)
 {
   //self->regist_signal ( "update" , "Executes communication patterns on all the registered data.", "" ).connect ( boost::bind ( &CommPattern2::update, self, _1 ) );
   m_isUpToDate=false;
   m_isFreeze=false;
+
+  options().add("neighbour_exchange", true)
+    .pretty_name("Neighbour Exchange")
+    .description("Synchronize using non-blocking point-to-point messages to the neighbouring ranks only. If false, a global all_to_all is used.");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,6 +71,7 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
 CommPattern::~CommPattern()
 {
   if (m_gid.get()!=nullptr) m_gid->remove_tag("gid_of_"+this->name());
+  if (m_communicator!=MPI_COMM_NULL && !PE::Comm::instance().is_finalized()) MPI_CHECK_RESULT(MPI_Comm_free,(&m_communicator));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -273,6 +282,10 @@ void CommPattern::setup()
 #define COMPUTE_IRANK(inode,nproc,nnode) ((((unsigned long long)(inode))*((unsigned long long)(nproc)))/((unsigned long long)(nnode)))
 #define COMPUTE_INODE(irank,nproc,nnode) (((unsigned long long)(nnode))>((unsigned long long)(nproc))?((((unsigned long long)(irank))*((unsigned long long)(nnode)))%((unsigned long long)(nproc))==0?(((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)):((((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)))+1ul):((unsigned long long)(irank)))
 
+  // pending synchronizations rely on the current maps, so they need to finish first
+  for (std::map<std::string, Exchange>::iterator exchange_it=m_pending_exchanges.begin(); exchange_it!=m_pending_exchanges.end(); ++exchange_it)
+    if (exchange_it->second.in_progress) end_synchronize(exchange_it->first);
+
   // get stuff
   const CPint irank=(CPint)PE::Comm::instance().rank();
   const CPint nproc=(CPint)PE::Comm::instance().size();
@@ -465,6 +478,8 @@ void CommPattern::setup()
   Uint *gid=cwv_gid();
   BOOST_FOREACH(temp_buffer_item& i, m_add_buffer) *gid++=i.gid;
 
+  setup_neighbours();
+
   // clear stuff and reset other things
   m_isUpToDate=true;
   m_add_buffer.clear();
@@ -566,11 +581,9 @@ void CommPattern::setup()
 
 void CommPattern::synchronize_all()
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
   BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
   {
-    synchronize_this(pobj,sndbuf,rcvbuf);
+    synchronize_this(pobj);
   }
 }
 
@@ -578,35 +591,175 @@ void CommPattern::synchronize_all()
 
 void CommPattern::synchronize( const std::string& name )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
   Handle<CommWrapper> pobj(get_child(name));
-  synchronize_this(*pobj,sndbuf,rcvbuf);
+  synchronize_this(*pobj);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void CommPattern::synchronize( const CommWrapper& pobj )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  synchronize_this(pobj,sndbuf,rcvbuf);
+  synchronize_this(pobj);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// having the vectors for the intermediate buf coming from outside allows keeping them and reuse for all synchronize
-void CommPattern::synchronize_this( const CommWrapper& pobj, std::vector<unsigned char>& sndbuf, std::vector<unsigned char>& rcvbuf )
+void CommPattern::begin_synchronize( const std::string& name )
+{
+  Handle<CommWrapper> pobj(get_child(name));
+  if (is_null(pobj)) throw common::ValueNotFound(FromHere(),"No data named '" + name + "' registered in commpattern '" + this->name() + "'.");
+  Exchange& exchange=m_pending_exchanges[name];
+  if (exchange.in_progress) throw common::ShouldNotBeHere(FromHere(),"Synchronization of '" + name + "' in commpattern '" + this->name() + "' is already in progress.");
+  // the tag follows the registration order of the object, which is the same on all ranks
+  if (exchange.tag==0)
+  {
+    exchange.tag=1;
+    BOOST_FOREACH( const CommWrapper& registered, find_components_recursively<CommWrapper>(*this) )
+    {
+      if (registered.name()==name) break;
+      ++exchange.tag;
+    }
+  }
+  start_exchange(*pobj,exchange);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::end_synchronize( const std::string& name )
+{
+  std::map<std::string, Exchange>::iterator exchange_it=m_pending_exchanges.find(name);
+  if (exchange_it==m_pending_exchanges.end() || !exchange_it->second.in_progress) throw common::ShouldNotBeHere(FromHere(),"No synchronization of '" + name + "' in progress in commpattern '" + this->name() + "'.");
+  Handle<CommWrapper> pobj(get_child(name));
+  finish_exchange(*pobj,exchange_it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool CommPattern::is_synchronizing( const std::string& name ) const
+{
+  std::map<std::string, Exchange>::const_iterator exchange_it=m_pending_exchanges.find(name);
+  return exchange_it!=m_pending_exchanges.end() && exchange_it->second.in_progress;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// the buffers of m_exchange are kept and reused for all synchronize
+void CommPattern::synchronize_this( const CommWrapper& pobj )
 {
 //  std::cout << PERank << pobj.name() << "\n" << std::flush;
 //  std::cout << PERank << pobj.needs_update() << "\n" << std::flush;
-  if ( pobj.needs_update() )
+  // a pending split-phase synchronization of the same data is superseded by this one
+  if (is_synchronizing(pobj.name())) end_synchronize(pobj.name());
+  start_exchange(pobj,m_exchange);
+  finish_exchange(pobj,m_exchange);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::start_exchange( const CommWrapper& pobj, Exchange& exchange )
+{
+  if ( !pobj.needs_update() )
+    return;
+
+  exchange.in_progress=true;
+
+  const int item_size=pobj.size_of()*pobj.stride();
+  pobj.pack(exchange.send_buffer,m_sendMap);
+  exchange.recv_buffer.resize(m_recvMap.size()*item_size);
+
+  if (!options().value<bool>("neighbour_exchange"))
   {
-    pobj.pack(sndbuf,m_sendMap);
-    rcvbuf.resize(m_recvMap.size()*pobj.size_of()*pobj.stride());
-    PE::Comm::instance().all_to_all(sndbuf,m_sendCount,rcvbuf,m_recvCount,pobj.size_of()*pobj.stride());
-    pobj.unpack(rcvbuf,m_recvMap);
+    // the collective completes immediately, unpacking is left for finish_exchange
+    PE::Comm::instance().all_to_all(exchange.send_buffer,m_sendCount,exchange.recv_buffer,m_recvCount,item_size);
+    exchange.requests.clear();
+    return;
   }
+
+  const CPint irank=(CPint)PE::Comm::instance().rank();
+  Communicator comm=m_communicator;
+  const int tag=exchange.tag;
+
+  std::vector<unsigned char>& sndbuf=exchange.send_buffer;
+  std::vector<unsigned char>& rcvbuf=exchange.recv_buffer;
+  const int nb_recvs=(const int)m_recv_neighbours.size();
+  const int nb_sends=(const int)m_send_neighbours.size();
+  exchange.requests.resize(nb_recvs+nb_sends);
+
+  // post the receives first, so the matching sends can complete without buffering
+  for (int i=0; i<nb_recvs; i++)
+  {
+    const CPint from=m_recv_neighbours[i];
+    MPI_CHECK_RESULT(MPI_Irecv, (&rcvbuf[m_recv_neighbour_starts[i]*item_size], m_recvCount[from]*item_size, MPI_BYTE, from, tag, comm, &exchange.requests[i]));
+  }
+  for (int i=0; i<nb_sends; i++)
+  {
+    const CPint to=m_send_neighbours[i];
+    MPI_CHECK_RESULT(MPI_Isend, (&sndbuf[m_send_neighbour_starts[i]*item_size], m_sendCount[to]*item_size, MPI_BYTE, to, tag, comm, &exchange.requests[nb_recvs+i]));
+  }
+
+  // data to be kept on this rank is copied while the messages are in flight
+  if (m_self_send_start>=0 && m_self_recv_start>=0)
+    std::copy(sndbuf.begin()+m_self_send_start*item_size, sndbuf.begin()+(m_self_send_start+m_sendCount[irank])*item_size, rcvbuf.begin()+m_self_recv_start*item_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::finish_exchange( const CommWrapper& pobj, Exchange& exchange )
+{
+  if (!exchange.in_progress)
+    return;
+
+  if (!exchange.requests.empty())
+    MPI_CHECK_RESULT(MPI_Waitall, ((int)exchange.requests.size(), &exchange.requests[0], MPI_STATUSES_IGNORE));
+
+  pobj.unpack(exchange.recv_buffer,m_recvMap);
+  exchange.in_progress=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::setup_neighbours()
+{
+  const CPint irank=(CPint)PE::Comm::instance().rank();
+  const CPint nproc=(CPint)m_sendCount.size();
+
+  m_send_neighbours.clear();
+  m_send_neighbour_starts.clear();
+  m_recv_neighbours.clear();
+  m_recv_neighbour_starts.clear();
+  m_self_send_start=-1;
+  m_self_recv_start=-1;
+
+  // setup is collective, so all ranks duplicate the communicator together
+  if (m_communicator==MPI_COMM_NULL) MPI_CHECK_RESULT(MPI_Comm_dup,(PE::Comm::instance().communicator(),&m_communicator));
+
+  // the send and receive maps are ordered by rank, so the data for each neighbour is contiguous
+  CPint send_start=0;
+  CPint recv_start=0;
+  for (CPint i=0; i<nproc; i++)
+  {
+    if (m_sendCount[i]>0)
+    {
+      if (i==irank) m_self_send_start=send_start;
+      else
+      {
+        m_send_neighbours.push_back(i);
+        m_send_neighbour_starts.push_back(send_start);
+      }
+      send_start+=m_sendCount[i];
+    }
+    if (m_recvCount[i]>0)
+    {
+      if (i==irank) m_self_recv_start=recv_start;
+      else
+      {
+        m_recv_neighbours.push_back(i);
+        m_recv_neighbour_starts.push_back(recv_start);
+      }
+      recv_start+=m_recvCount[i];
+    }
+  }
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
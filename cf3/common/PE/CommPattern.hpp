@@ -7,6 +7,8 @@
 #ifndef cf3_common_PE_CommPattern_hpp
 #define cf3_common_PE_CommPattern_hpp
 
+#include <map>
+
 #include "common/Component.hpp"
 #include "common/BoostArray.hpp"
 #include "common/PE/Comm.hpp"
@@ -229,6 +231,20 @@ public:
   /// @param name the name of the parallel object
   void synchronize( const CommWrapper& pobj );
 
+  /// start synchronizing the parallel object designated by its name, without waiting for the data to arrive
+  /// The data is packed immediately, so it may be modified afterwards, except for the ghost entries that are being received.
+  /// Only one synchronization per object can be in progress.
+  /// @param name the name of the parallel object
+  void begin_synchronize( const std::string& name );
+
+  /// finish a synchronization started with begin_synchronize, waiting for the data to arrive and unpacking it
+  /// @param name the name of the parallel object
+  void end_synchronize( const std::string& name );
+
+  /// true if a synchronization started with begin_synchronize is still in progress for the named object
+  /// @param name the name of the parallel object
+  bool is_synchronizing( const std::string& name ) const;
+
   /// add element to the commpattern
   /// when all changes done, all needs to be committed by calling setup
   /// if global id is not on current rank, then a ghost is automatically created on current rank
@@ -288,12 +304,42 @@ public:
 
 protected: // helper function
 
+  /// buffers and requests of a synchronization in progress
+  struct Exchange
+  {
+    Exchange() : in_progress(false), tag(0) {}
+
+    /// send buffer, kept between synchronizations to avoid reallocation
+    std::vector<unsigned char> send_buffer;
+    /// receive buffer, kept between synchronizations to avoid reallocation
+    std::vector<unsigned char> recv_buffer;
+    /// requests for the non-blocking exchange
+    std::vector<MPI_Request> requests;
+    /// true between the start and the finish of the exchange
+    bool in_progress;
+    /// MPI tag of the messages. The blocking exchange uses 0, each object synchronized using begin_synchronize gets its
+    /// own tag within the pattern, so messages of exchanges in flight at the same time can't be mixed up
+    int tag;
+  };
+
   /// function to synchronize this object
   /// useful for reusing in the different synchronize functions
   /// @param pobj reference to commwrapper object to synchronize to
-  /// @param sndbuf vector for intermediate buffer for send
-  /// @param rcvbuf vector for intermediate buffer for recieve
-  void synchronize_this( const CommWrapper& pobj, std::vector<unsigned char>& sndbuf, std::vector<unsigned char>& rcvbuf );
+  void synchronize_this( const CommWrapper& pobj );
+
+  /// pack the data and start the exchange
+  /// with neighbour exchange, the messages to the ranks that share nodes with this one are posted using non-blocking point-to-point communication
+  /// @param pobj reference to commwrapper object to synchronize to
+  /// @param exchange buffers to use, which must remain valid until finish_exchange is called
+  void start_exchange( const CommWrapper& pobj, Exchange& exchange );
+
+  /// wait for the data started by start_exchange and unpack it
+  /// @param pobj reference to commwrapper object to synchronize to
+  /// @param exchange buffers passed to start_exchange
+  void finish_exchange( const CommWrapper& pobj, Exchange& exchange );
+
+  /// build the list of neighbouring ranks from m_sendCount and m_recvCount, called at the end of setup
+  void setup_neighbours();
 
 private:
 
@@ -349,6 +395,37 @@ private:
   /// Rank for all the gids in local index space
   std::vector<int> m_ranks;
 
+  /// @name NEIGHBOUR EXCHANGE
+  //@{
+
+  /// ranks this process sends to, excluding itself
+  std::vector< CPint > m_send_neighbours;
+
+  /// start of the data for each entry of m_send_neighbours in the send map
+  std::vector< CPint > m_send_neighbour_starts;
+
+  /// ranks this process receives from, excluding itself
+  std::vector< CPint > m_recv_neighbours;
+
+  /// start of the data for each entry of m_recv_neighbours in the receive map
+  std::vector< CPint > m_recv_neighbour_starts;
+
+  /// start of the data sent to and received from this rank itself, in the send and receive map respectively
+  CPint m_self_send_start;
+  CPint m_self_recv_start;
+
+  /// duplicate of the communicator of PE::Comm, created by the first setup. Since each pattern has its own communicator,
+  /// the messages of patterns exchanging at the same time can't be mixed up, even if they use the same tag
+  Communicator m_communicator;
+
+  /// buffers for the blocking synchronize functions
+  Exchange m_exchange;
+
+  /// buffers for the synchronizations started by begin_synchronize, by name of the parallel object
+  std::map<std::string, Exchange> m_pending_exchanges;
+
+  //@} END NEIGHBOUR EXCHANGE
+
 }; // CommPattern
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,129 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <cstring>
+
+#include "common/PerfCounters.hpp"
+
+#ifdef CF3_HAVE_PERF_EVENT
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef CF3_HAVE_PERF_EVENT
+
+namespace detail
+{
+
+/// Open a hardware counter for the calling thread. pid 0 with cpu -1 follows the calling thread on any CPU,
+/// and inherit also counts the threads it creates later on.
+int open_perf_counter(const boost::uint64_t config)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // detail
+
+PerfCounters::PerfCounters()
+{
+  const int cycles_fd = detail::open_perf_counter(PERF_COUNT_HW_CPU_CYCLES);
+  if(cycles_fd < 0)
+    return;
+
+  m_fds.push_back(cycles_fd);
+  m_members.push_back(&PerfCounterValues::cycles);
+
+  // The other counters are optional, some virtual machines don't provide them
+  const int instructions_fd = detail::open_perf_counter(PERF_COUNT_HW_INSTRUCTIONS);
+  if(instructions_fd >= 0)
+  {
+    m_fds.push_back(instructions_fd);
+    m_members.push_back(&PerfCounterValues::instructions);
+  }
+
+  const int llc_misses_fd = detail::open_perf_counter(PERF_COUNT_HW_CACHE_MISSES);
+  if(llc_misses_fd >= 0)
+  {
+    m_fds.push_back(llc_misses_fd);
+    m_members.push_back(&PerfCounterValues::llc_misses);
+  }
+
+  for(std::vector<int>::const_iterator fd = m_fds.begin(); fd != m_fds.end(); ++fd)
+  {
+    ioctl(*fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(*fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+PerfCounters::~PerfCounters()
+{
+  for(std::vector<int>::const_iterator fd = m_fds.begin(); fd != m_fds.end(); ++fd)
+    close(*fd);
+}
+
+void PerfCounters::read(PerfCounterValues& values) const
+{
+  values = PerfCounterValues();
+
+  const Uint nb_counters = m_fds.size();
+  for(Uint i = 0; i != nb_counters; ++i)
+  {
+    // The value is followed by the time the counter was enabled and the time it was running
+    boost::uint64_t buffer[3];
+    if(::read(m_fds[i], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) || buffer[2] == 0)
+      continue;
+
+    // Extrapolate to the full enabled time if the counter was multiplexed with others
+    values.*m_members[i] = buffer[2] < buffer[1] ? static_cast<boost::uint64_t>(static_cast<double>(buffer[0]) * static_cast<double>(buffer[1]) / static_cast<double>(buffer[2])) : buffer[0];
+  }
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::read(PerfCounterValues& values) const
+{
+  values = PerfCounterValues();
+}
+
+#endif
+
+PerfCounters& PerfCounters::instance()
+{
+  static PerfCounters perf_counters;
+  return perf_counters;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
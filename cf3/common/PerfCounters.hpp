@@ -0,0 +1,79 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_PerfCounters_hpp
+#define cf3_common_PerfCounters_hpp
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "common/CommonAPI.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+/// Values of the hardware performance counters
+struct Common_API PerfCounterValues
+{
+  PerfCounterValues() : cycles(0), instructions(0), llc_misses(0) {}
+
+  /// CPU cycles
+  boost::uint64_t cycles;
+  /// Retired instructions
+  boost::uint64_t instructions;
+  /// Last level cache misses, each one is a cache line read from memory
+  boost::uint64_t llc_misses;
+};
+
+/// Hardware performance counters of the process, read through the Linux perf_event_open interface.
+/// The counters run from the first call to instance() on, so a region is measured by reading them
+/// at its start and end. Only user space is counted.
+/// The counters follow the thread that made the first call to instance() and, since they are opened with the
+/// inherit flag, all threads it creates afterwards, so work done by worker threads (e.g. a multithreaded matrix
+/// product) is included. Threads that already existed when the counters were opened are not counted.
+/// Each counter is opened and read on its own, since the kernel does not allow inherited counters to be read as
+/// a group. If there are more counters than hardware registers, the kernel multiplexes them, and the values are
+/// scaled by the ratio of the time the counter was enabled to the time it was actually running.
+/// If the counters are not supported or not permitted (see /proc/sys/kernel/perf_event_paranoid),
+/// is_available() returns false and the read values are zero.
+class Common_API PerfCounters : public boost::noncopyable
+{
+public:
+
+  /// Gets the instance of the counters
+  static PerfCounters& instance();
+
+  ~PerfCounters();
+
+  /// True if at least the cycle counter could be opened
+  bool is_available() const { return !m_fds.empty(); }
+
+  /// Read the current values of the counters
+  void read(PerfCounterValues& values) const;
+
+private:
+
+  PerfCounters();
+
+  /// File descriptors of the opened counters, with the cycle counter first
+  std::vector<int> m_fds;
+
+  /// Address of the member of PerfCounterValues for each opened counter
+  std::vector<boost::uint64_t PerfCounterValues::*> m_members;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+#endif // cf3_common_PerfCounters_hpp
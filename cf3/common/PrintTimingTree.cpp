@@ -6,7 +6,9 @@
 
 #include "common/Builder.hpp"
 #include "common/OptionList.hpp"
+#include "common/OptionURI.hpp"
 #include "common/TimedComponent.hpp"
+#include "common/TimingTrace.hpp"
 
 #include "PrintTimingTree.hpp"
 
@@ -24,12 +26,21 @@ PrintTimingTree::PrintTimingTree(const std::string& name): Action(name)
     .pretty_name("Root")
     .link_to(&m_root)
     .mark_basic();
+
+  options().add("trace_file", m_trace_file)
+    .supported_protocol(URI::Scheme::FILE)
+    .description("JSON file to write the timeline of the recorded actions to, in the Chrome trace event format. Nothing is written if empty.")
+    .pretty_name("Trace File")
+    .link_to(&m_trace_file);
 }
 
 void PrintTimingTree::execute()
 {
   if(is_not_null(m_root))
     print_timing_tree(*m_root);
+
+  if(!m_trace_file.empty())
+    TimingTrace::instance().write_chrome_trace(m_trace_file);
 }
 
 
@@ -18,7 +18,8 @@ namespace common {
 
 /////////////////////////////////////////////////////////////////////////////////////
 
-/// Prints the timing tree for a root component
+/// Prints the timing tree for a root component, and optionally writes the timeline of the
+/// recorded actions (see the trace_actions option of the Environment) to a Chrome trace file
 class Common_API PrintTimingTree : public Action
 {
 public: // functions
@@ -34,6 +35,8 @@ public: // functions
 private:
   // Root component to print timings from
   Handle<Component> m_root;
+  // File to write the timeline to
+  URI m_trace_file;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -65,7 +65,7 @@ public: // functions
 
   /// Contructor
   /// @param name of the component
-  Table ( const std::string& name )  : Component ( name ), m_pos(0)
+  Table ( const std::string& name )  : Component ( name ), m_pos(0), m_nb_views(0)
   {  }
 
   /// Get the component type name
@@ -77,6 +77,9 @@ public: // functions
   /// @param[in] nb_cols number of columns in the table.
   void set_row_size(const Uint nb_cols)
   {
+    if(nb_cols == row_size())
+      return;
+    check_resizable();
     m_array.resize(boost::extents[size()][nb_cols]);
   }
 
@@ -84,6 +87,9 @@ public: // functions
   /// @param[in] nb_rows The number of rows after resizing
   virtual void resize(const Uint nb_rows)
   {
+    if(nb_rows == size())
+      return;
+    check_resizable();
     m_array.resize(boost::extents[nb_rows][row_size()]);
   }
 
@@ -103,6 +109,7 @@ public: // functions
   {
     // make sure the array has its columnsize defined
     cf3_assert(row_size() > 0);
+    check_resizable();
     return Buffer(m_array,buffersize);
   }
 
@@ -110,6 +117,7 @@ public: // functions
   {
     // make sure the array has its columnsize defined
     cf3_assert(row_size() > 0);
+    check_resizable();
     return typename boost::shared_ptr<Buffer> ( new Buffer (m_array,buffersize) );
   }
 
@@ -159,12 +167,34 @@ public: // functions
     return m_pos;
   }
 
+  /// Register an external view that aliases the storage, such as a Python buffer.
+  /// As long as views exist, the table can't change size or row size and buffers can't be created.
+  /// Views must therefore be released before any mesh transformation, such as load balancing or growing the overlap.
+  void add_view() { ++m_nb_views; }
+
+  /// Unregister a view that was registered using add_view
+  void remove_view() { cf3_assert(m_nb_views != 0); --m_nb_views; }
+
+  /// Number of external views on the storage
+  Uint nb_views() const { return m_nb_views; }
+
+private: // functions
+
+  /// Throw if the storage is aliased by an external view, since reallocating it would invalidate the view
+  void check_resizable() const
+  {
+    if(m_nb_views != 0)
+      throw IllegalCall(FromHere(), "Can't resize " + uri().path() + " while " + to_str(m_nb_views) + " views of its data exist");
+  }
+
 private: // data
 
   /// storage of the array
   ArrayT m_array;
   /// position when used as output stream
   Uint m_pos;
+  /// number of external views aliasing m_array
+  Uint m_nb_views;
 };
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -20,7 +20,10 @@ TaggedObject::TaggedObject() :
 void TaggedObject::add_tag(const std::string& tag)
 {
   if (!has_tag(tag))
+  {
     m_tags += tag + ":";
+    tags_changed();
+  }
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -70,5 +73,6 @@ void TaggedObject::remove_tag(const std::string& tag)
       if (*tok_iter!=tag)
         tags += *tok_iter + ":";
     m_tags=tags;
+    tags_changed();
   }
 }
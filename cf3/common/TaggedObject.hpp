@@ -22,6 +22,9 @@ public:
   /// Constructor
   TaggedObject();
 
+  /// Virtual destructor
+  virtual ~TaggedObject() {}
+
   /// Check if this component has a given tag assigned
   /// @param tag to check
   /// @return if has it or not
@@ -38,6 +41,11 @@ public:
   /// @param tag to remove
   void remove_tag(const std::string& tag);
 
+protected:
+
+  /// Called after a tag was added or removed
+  virtual void tags_changed() {}
+
 private:
 
   std::string m_tags;
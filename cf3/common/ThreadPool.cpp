@@ -0,0 +1,129 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/bind.hpp>
+
+#include "common/Assertions.hpp"
+
+#include "common/ThreadPool.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool() :
+  m_task(0),
+  m_nb_tasks(0),
+  m_generation(0),
+  m_nb_running(0),
+  m_stop(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+  stop();
+}
+
+void ThreadPool::resize(const Uint nb_threads)
+{
+  const Uint nb_workers = nb_threads < 2 ? 0 : nb_threads - 1;
+  if(nb_workers == m_workers.size())
+    return;
+
+  stop();
+  for(Uint i = 0; i != nb_workers; ++i)
+    m_workers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ThreadPool::work, this, i, m_generation))));
+}
+
+void ThreadPool::run(const Uint nb_tasks, const TaskT& task) const
+{
+  cf3_assert(nb_tasks <= nb_threads());
+
+  if(nb_tasks > 1)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_task = &task;
+    m_nb_tasks = nb_tasks;
+    m_nb_running = nb_tasks - 1;
+    ++m_generation;
+    m_start_condition.notify_all();
+  }
+
+  if(nb_tasks != 0)
+    task(0);
+
+  if(nb_tasks > 1)
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_nb_running != 0)
+      m_done_condition.wait(lock);
+    m_task = 0;
+  }
+}
+
+const ThreadPool& ThreadPool::serial()
+{
+  static const ThreadPool pool;
+  return pool;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::work(const Uint worker_idx, Uint generation)
+{
+  const Uint task_idx = worker_idx + 1;
+  while(true)
+  {
+    const TaskT* task = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while(!m_stop && m_generation == generation)
+        m_start_condition.wait(lock);
+      if(m_stop)
+        return;
+      generation = m_generation;
+      // Runs with fewer tasks than threads leave the last workers idle
+      if(task_idx >= m_nb_tasks)
+        continue;
+      task = m_task;
+    }
+
+    (*task)(task_idx);
+
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if(--m_nb_running == 0)
+      m_done_condition.notify_one();
+  }
+}
+
+void ThreadPool::stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+    m_start_condition.notify_all();
+  }
+
+  for(Uint i = 0; i != m_workers.size(); ++i)
+    m_workers[i]->join();
+  m_workers.clear();
+  m_stop = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace common
+} // namespace cf3
@@ -0,0 +1,111 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_ThreadPool_hpp
+#define cf3_common_ThreadPool_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file ThreadPool.hpp Worker threads that are reused by successive parallel loops
+
+  The workers are started once and then wait for tasks, so loops that run many times, such as the vector operations
+  and matrix products of each solver iteration, don't pay for creating and joining threads.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class Common_API ThreadPool : boost::noncopyable {
+public:
+
+  /// Signature of the tasks, taking the index of the task
+  typedef boost::function<void (const Uint)> TaskT;
+
+  /// Create a pool without workers, running everything on the calling thread
+  ThreadPool();
+
+  ~ThreadPool();
+
+  /// Set the number of threads, counting the thread that calls run. The workers are only restarted if the number changes
+  void resize(const Uint nb_threads);
+
+  /// Grow the pool to at least nb_threads threads, counting the thread that calls run
+  void reserve(const Uint nb_threads) { if(nb_threads > this->nb_threads()) resize(nb_threads); }
+
+  /// Number of threads, counting the thread that calls run
+  Uint nb_threads() const { return m_workers.size() + 1; }
+
+  /// Call task(i) for each i in [0, nb_tasks) and wait until all tasks are done. Task 0 runs on the calling thread and
+  /// task i on worker i-1. nb_tasks may not exceed nb_threads(), the task may not throw and only one thread at a time
+  /// may call run.
+  void run(const Uint nb_tasks, const TaskT& task) const;
+
+  /// Shared pool without workers, used when no pool is given
+  static const ThreadPool& serial();
+
+  /// Pool shared by the threaded loops that have no pool of their own. Its size is set by the nb_threads option of the
+  /// environment, and grown by the Proto element loops that use more threads
+  static ThreadPool& shared();
+
+private:
+  /// Loop of the worker with the given index, waiting for the task of each new generation
+  void work(const Uint worker_idx, Uint generation);
+
+  /// Stop and join all workers
+  void stop();
+
+  std::vector< boost::shared_ptr<boost::thread> > m_workers;
+
+  /// Protects the task data and the counters below
+  mutable boost::mutex m_mutex;
+
+  /// Signals the workers that a new task is available or that they must stop
+  mutable boost::condition_variable m_start_condition;
+
+  /// Signals the calling thread that the last worker finished its task
+  mutable boost::condition_variable m_done_condition;
+
+  /// Task that is currently running
+  mutable const TaskT* m_task;
+
+  /// Number of tasks in the current run
+  mutable Uint m_nb_tasks;
+
+  /// Incremented on each run, so the workers can tell a new task from a spurious wakeup
+  mutable Uint m_generation;
+
+  /// Number of workers that still need to finish their task
+  mutable Uint m_nb_running;
+
+  /// True while the workers are being stopped
+  bool m_stop;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace common
+} // namespace cf3
+
+#endif // cf3_common_ThreadPool_hpp
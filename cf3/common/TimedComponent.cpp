@@ -4,11 +4,15 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <iostream>
 
+#include <boost/functional/hash.hpp>
+
 #include "common/Component.hpp"
 #include "common/FindComponents.hpp"
 #include "common/Foreach.hpp"
+#include "common/PerfCounters.hpp"
 #include "common/PropertyList.hpp"
 #include "common/TimedComponent.hpp"
 
@@ -35,76 +39,152 @@ void store_timings(Component& root)
 
 /////////////////////////////////////////////////////////////////////////////////////
 
-void print_timing_tree(cf3::common::Component& root, const bool print_untimed, const std::string& prefix)
+namespace detail
 {
-  if(prefix.empty()) // Top-level recursion
+
+/// Component in the timing tree
+struct TimingNode
+{
+  std::string prefix;
+  std::string name;
+  bool timed;
+};
+
+/// Statistics of each timed component: mean, minimum, maximum, count, total time, cycles, instructions and LLC misses
+const Uint nb_timing_stats = 8;
+
+/// Collect the timing statistics of the tree, depth first
+void collect_timings(Component& root, const bool print_untimed, const std::string& prefix, std::vector<TimingNode>& nodes, std::vector<Real>& stats)
+{
+  const PropertyList& props = root.properties();
+  const bool timed = props.check("timer_mean");
+  if(timed || print_untimed)
   {
-    store_timings(root);
-    if(PE::Comm::instance().rank() == 0)
-      std::cout << "<DartMeasurement name=\"Timings\" type=\"text/plain\"><![CDATA[<html><body><pre>\n";
+    TimingNode node;
+    node.prefix = prefix;
+    node.name = root.name();
+    node.timed = timed;
+    nodes.push_back(node);
   }
 
-  if(!root.properties().check("timer_mean") && print_untimed && PE::Comm::instance().rank() == 0)
+  if(timed)
   {
-    std::cout << prefix << root.name() << ": no timing info\n";
+    const bool has_counters = props.check("perf_cycles");
+    const Real mean = props.value<Real>("timer_mean");
+    const Real count = static_cast<Real>(props.value<Uint>("timer_count"));
+    stats.push_back(mean);
+    stats.push_back(props.value<Real>("timer_minimum"));
+    stats.push_back(props.value<Real>("timer_maximum"));
+    stats.push_back(count);
+    stats.push_back(mean*count);
+    stats.push_back(has_counters ? props.value<Real>("perf_cycles") : 0.);
+    stats.push_back(has_counters ? props.value<Real>("perf_instructions") : 0.);
+    stats.push_back(has_counters ? props.value<Real>("perf_llc_misses") : 0.);
   }
 
-
-  if(root.properties().check("timer_mean"))
+  BOOST_FOREACH(Component& component, root)
   {
-    const Real local_mean = root.properties().value<Real>("timer_mean");
-    const Real local_min = root.properties().value<Real>("timer_minimum");
-    const Real local_max = root.properties().value<Real>("timer_maximum");
-    const Uint local_count = root.properties().value<Uint>("timer_count");
+    collect_timings(component, print_untimed, prefix + "  ", nodes, stats);
+  }
+}
+
+} // detail
+
+void print_timing_tree(cf3::common::Component& root, const bool print_untimed, const std::string& prefix)
+{
+  store_timings(root);
 
-    // Only bother with global averages if we have more than 1 process
-    if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  std::vector<detail::TimingNode> nodes;
+  std::vector<Real> local_stats;
+  detail::collect_timings(root, print_untimed, prefix, nodes, local_stats);
+
+  // Minimum, sum and maximum of each statistic over all processes, reduced element-wise on the packed statistics
+  std::vector<Real> stats_min(local_stats), stats_sum(local_stats), stats_max(local_stats);
+  Uint nb_procs = 1;
+  bool same_trees = true;
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  {
+    // The reductions require the same tree on all processes. The hash of the names in the tree is compared by reducing
+    // its maximum together with the maximum of its complement, which is the complement of the minimum
+    std::size_t tree_hash = 0;
+    BOOST_FOREACH(const detail::TimingNode& node, nodes)
     {
-      // Average, minimum and maximum of each statistic over all CPUs
-      Real mean_mean, mean_min, mean_max, max_mean, max_min, max_max, min_mean, min_min, min_max;
-      Uint min_count, max_count;
-      PE::Comm::instance().all_reduce(PE::plus(), &local_mean, 1, &mean_mean);
-      PE::Comm::instance().all_reduce(PE::min(), &local_mean, 1, &mean_min);
-      PE::Comm::instance().all_reduce(PE::max(), &local_mean, 1, &mean_max);
-
-      PE::Comm::instance().all_reduce(PE::plus(), &local_min, 1, &min_mean);
-      PE::Comm::instance().all_reduce(PE::min(), &local_min, 1, &min_min);
-      PE::Comm::instance().all_reduce(PE::max(), &local_min, 1, &min_max);
-
-      PE::Comm::instance().all_reduce(PE::plus(), &local_max, 1, &max_mean);
-      PE::Comm::instance().all_reduce(PE::min(), &local_max, 1, &max_min);
-      PE::Comm::instance().all_reduce(PE::max(), &local_max, 1, &max_max);
-      
-      PE::Comm::instance().all_reduce(PE::min(), &local_count, 1, &min_count);
-      PE::Comm::instance().all_reduce(PE::max(), &local_count, 1, &max_count);
-      cf3_assert(min_count == max_count);
-
-      const Real nb_procs = static_cast<Real>(PE::Comm::instance().size());
-      mean_mean /= nb_procs; min_mean /= nb_procs; max_mean /= nb_procs;
-
-      if(PE::Comm::instance().rank() == 0)
-      {
-        if(prefix.empty()) std::cout << "Timings in seconds, with [min, mean, max] over CPUs\n";
-        std::cout << prefix << root.name()
-          << ": mean: "  << mean_mean
-          << ", min: " << min_min
-          << ", max: " << max_max
-          << ", count: " << min_count << "\n";
-      }
+      boost::hash_combine(tree_hash, node.prefix);
+      boost::hash_combine(tree_hash, node.name);
+      boost::hash_combine(tree_hash, node.timed);
     }
-    else
+    const Uint local_hashes[2] = { static_cast<Uint>(tree_hash), ~static_cast<Uint>(tree_hash) };
+    Uint max_hashes[2];
+    PE::Comm::instance().all_reduce(PE::max(), local_hashes, 2, max_hashes);
+    same_trees = max_hashes[0] == ~max_hashes[1];
+    if(same_trees && !local_stats.empty())
     {
-      std::cout << prefix << root.name() << ": mean: " << local_mean << ", max: " << local_max << ", min: " << local_min << ", count: " << local_count << "\n";
+      // The minimum is the negated maximum of the negated statistics, so both are found in a single reduction
+      const Uint nb_stats = local_stats.size();
+      std::vector<Real> local_extrema(2*nb_stats), global_extrema(2*nb_stats);
+      for(Uint i = 0; i != nb_stats; ++i)
+      {
+        local_extrema[i] = -local_stats[i];
+        local_extrema[nb_stats + i] = local_stats[i];
+      }
+      PE::Comm::instance().all_reduce(PE::max(), local_extrema, global_extrema);
+      PE::Comm::instance().all_reduce(PE::plus(), local_stats, stats_sum);
+      for(Uint i = 0; i != nb_stats; ++i)
+      {
+        stats_min[i] = -global_extrema[i];
+        stats_max[i] = global_extrema[nb_stats + i];
+      }
+      nb_procs = PE::Comm::instance().size();
     }
   }
 
-  BOOST_FOREACH(Component& component, root)
+  if(PE::Comm::instance().rank() != 0)
+    return;
+
+  const bool has_counters = PerfCounters::instance().is_available();
+
+  std::cout << "<DartMeasurement name=\"Timings\" type=\"text/plain\"><![CDATA[<html><body><pre>\n";
+  if(!same_trees)
+    std::cout << "Timing trees differ between processes, only showing rank 0\n";
+  if(nb_procs > 1)
+    std::cout << "Timings in seconds, with [min, mean, max] over CPUs\n";
+
+  const Real nb_procs_real = static_cast<Real>(nb_procs);
+  Uint stats_idx = 0;
+  BOOST_FOREACH(const detail::TimingNode& node, nodes)
   {
-    print_timing_tree(component, print_untimed, prefix + "  ");
+    if(!node.timed)
+    {
+      std::cout << node.prefix << node.name << ": no timing info\n";
+      continue;
+    }
+
+    const Real* stat_min = &stats_min[stats_idx];
+    const Real* stat_sum = &stats_sum[stats_idx];
+    const Real* stat_max = &stats_max[stats_idx];
+    stats_idx += detail::nb_timing_stats;
+
+    std::cout << node.prefix << node.name
+      << ": mean: " << stat_sum[0] / nb_procs_real
+      << ", min: " << stat_min[1]
+      << ", max: " << stat_max[2]
+      << ", count: " << static_cast<Uint>(stat_min[3]);
+    if(nb_procs > 1)
+    {
+      // Total time spent in the component
+      const Real total_mean = stat_sum[4] / nb_procs_real;
+      std::cout << ", total: [" << stat_min[4] << ", " << total_mean << ", " << stat_max[4] << "]"
+        << ", imbalance: " << (total_mean > 0. ? stat_max[4] / total_mean - 1. : 0.);
+    }
+    if(has_counters)
+    {
+      std::cout << ", IPC: " << (stat_sum[5] > 0. ? stat_sum[6] / stat_sum[5] : 0.)
+        << ", LLC misses: [" << stat_min[7] << ", " << stat_sum[7] / nb_procs_real << ", " << stat_max[7] << "]";
+    }
+    std::cout << "\n";
   }
 
-  if(prefix.empty() && PE::Comm::instance().rank() == 0)
-    std::cout << "</pre></body></html>]]></DartMeasurement>" << std::endl;
+  std::cout << "</pre></body></html>]]></DartMeasurement>" << std::endl;
 }
 
 
@@ -30,7 +30,11 @@ public:
 /// Store accumulated timings in properties for readout
 void store_timings(Component& root);
 
-/// Print timing tree based on the existing properties
+/// Print timing tree based on the existing properties.
+/// In parallel, the minimum, mean and maximum over the processes are obtained by reducing the packed
+/// statistics of all components, together with the imbalance of the total time spent in each component.
+/// If hardware counters are available, the instructions per cycle and the last level cache misses are shown too.
+/// @note This function must be called on all processors
 void print_timing_tree(Component& root, const bool print_untimed = false, const std::string& prefix="");
 
 }
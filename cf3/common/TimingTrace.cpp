@@ -0,0 +1,130 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Foreach.hpp"
+#include "common/TimingTrace.hpp"
+#include "common/URI.hpp"
+
+#include "common/PE/Comm.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Write a string as a JSON string literal
+void write_json_string(std::ostream& out, const std::string& str)
+{
+  out << '"';
+  boost_foreach(const char c, str)
+  {
+    if(c == '"' || c == '\\')
+      out << '\\' << c;
+    else if(static_cast<unsigned char>(c) < 0x20)
+      out << ' ';
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+} // detail
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+TimingTrace::TimingTrace() : m_enabled(false)
+{
+}
+
+TimingTrace& TimingTrace::instance()
+{
+  static TimingTrace timing_trace;
+  return timing_trace;
+}
+
+boost::int64_t TimingTrace::now()
+{
+  static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+}
+
+void TimingTrace::record(const std::string& name, const boost::int64_t start, const boost::int64_t duration, const PerfCounterValues& counters)
+{
+  if(!m_enabled)
+    return;
+
+  m_events.push_back(Event());
+  Event& event = m_events.back();
+  event.name = name;
+  event.start = start;
+  event.duration = duration;
+  event.counters = counters;
+}
+
+void TimingTrace::write_chrome_trace(const URI& file) const
+{
+  const Uint rank = PE::Comm::instance().rank();
+  const bool has_counters = PerfCounters::instance().is_available();
+
+  // Complete ("X") events of this process, the process id is the rank
+  std::ostringstream local_events;
+  boost_foreach(const Event& event, m_events)
+  {
+    local_events << ",\n{\"name\":";
+    detail::write_json_string(local_events, event.name);
+    local_events << ",\"cat\":\"action\",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":0"
+                 << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+    if(has_counters)
+    {
+      local_events << ",\"args\":{\"cycles\":" << event.counters.cycles
+                   << ",\"instructions\":" << event.counters.instructions
+                   << ",\"llc_misses\":" << event.counters.llc_misses << "}";
+    }
+    local_events << "}";
+  }
+
+  // Only the root writes the file, so the events of all processes are gathered there, concatenated by rank
+  const std::string local_str = local_events.str();
+  const std::vector<char> local_chars(local_str.begin(), local_str.end());
+  std::vector<char> all_events(local_chars);
+  std::vector<int> nb_chars(1, static_cast<int>(local_chars.size()));
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+  {
+    all_events.clear();
+    nb_chars.assign(PE::Comm::instance().size(), -1);
+    PE::Comm::instance().gather(local_chars, static_cast<int>(local_chars.size()), all_events, nb_chars, 0);
+  }
+
+  if(rank != 0)
+    return;
+
+  boost::filesystem::fstream out(file.path(), std::ios_base::out);
+  if(!out)
+    throw FileSystemError(FromHere(), "Could not open file " + file.path() + " for writing the timing trace");
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  // Metadata events naming the processes, these also avoid a leading comma
+  for(Uint pid = 0; pid != nb_chars.size(); ++pid)
+    out << (pid == 0 ? "" : ",\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"rank " << pid << "\"}}";
+  out.write(all_events.empty() ? "" : &all_events[0], all_events.size());
+  out << "\n]}\n";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
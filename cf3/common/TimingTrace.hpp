@@ -0,0 +1,87 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_TimingTrace_hpp
+#define cf3_common_TimingTrace_hpp
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "common/CommonAPI.hpp"
+#include "common/PerfCounters.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+class URI;
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+/// Timeline of the executed actions, recorded by the timed actions when enabled.
+/// The timeline of all processes is written in the Chrome trace event format, which is
+/// shown by chrome://tracing or https://ui.perfetto.dev, with one row per process.
+class Common_API TimingTrace : public boost::noncopyable
+{
+public:
+
+  /// One executed action
+  struct Event
+  {
+    /// Path of the action
+    std::string name;
+    /// Wall clock start time, in microseconds since the epoch
+    boost::int64_t start;
+    /// Duration, in microseconds
+    boost::int64_t duration;
+    /// Hardware counters during the execution
+    PerfCounterValues counters;
+  };
+
+  /// Gets the instance of the trace
+  static TimingTrace& instance();
+
+  /// Start or stop recording events
+  void enable(const bool enabled) { m_enabled = enabled; }
+
+  /// True if the events are recorded
+  bool is_enabled() const { return m_enabled; }
+
+  /// Current wall clock time, in microseconds since the epoch
+  static boost::int64_t now();
+
+  /// Add an event to the timeline. Does nothing if the trace is not enabled.
+  void record(const std::string& name, const boost::int64_t start, const boost::int64_t duration, const PerfCounterValues& counters = PerfCounterValues());
+
+  /// Recorded events of this process
+  const std::vector<Event>& events() const { return m_events; }
+
+  /// Remove all recorded events
+  void clear() { m_events.clear(); }
+
+  /// Write the events of all processes to a JSON file in the Chrome trace event format, using rank 0.
+  /// @note This function must be called on all processors
+  void write_chrome_trace(const URI& file) const;
+
+private:
+
+  TimingTrace();
+
+  bool m_enabled;
+
+  std::vector<Event> m_events;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+#endif // cf3_common_TimingTrace_hpp
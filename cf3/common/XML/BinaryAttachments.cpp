@@ -0,0 +1,99 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <cstring>
+
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+
+#include "common/XML/BinaryAttachments.hpp"
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+namespace XML {
+
+////////////////////////////////////////////////////////////////////////////
+
+Uint BinaryAttachments::add( const Block & block )
+{
+  cf3_assert( is_not_null(block) );
+
+  m_blocks.push_back( block );
+  return m_blocks.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+Uint BinaryAttachments::add( const char * data, const std::size_t size, const bool compress )
+{
+  boost::shared_ptr< std::vector<char> > block( new std::vector<char>() );
+
+  if( compress )
+  {
+    boost::iostreams::filtering_ostream compressing_stream;
+    compressing_stream.push( boost::iostreams::zlib_compressor() );
+    compressing_stream.push( boost::iostreams::back_inserter(*block) );
+    compressing_stream.write( data, size );
+    compressing_stream.reset();
+  }
+  else
+    block->assign( data, data + size );
+
+  return add( block );
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+const BinaryAttachments::Block & BinaryAttachments::block( const Uint index ) const
+{
+  if( index >= m_blocks.size() )
+    throw ValueNotFound( FromHere(), "Could not find binary block " + to_str(index) +
+                         ", there are only " + to_str(size()) + " blocks." );
+
+  return m_blocks[index];
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+void BinaryAttachments::read( const Uint index, const bool compressed, char * data, const std::size_t size ) const
+{
+  const std::vector<char> & stored = *block(index);
+
+  if( compressed )
+  {
+    boost::iostreams::filtering_istream decompressing_stream;
+    decompressing_stream.push( boost::iostreams::zlib_decompressor() );
+    decompressing_stream.push( boost::iostreams::array_source(stored.empty() ? nullptr : &stored[0], stored.size()) );
+    decompressing_stream.read( data, size );
+
+    if( static_cast<std::size_t>(decompressing_stream.gcount()) != size )
+      throw ParsingFailed( FromHere(), "Binary block " + to_str(index) + " does not decompress to "
+                           + to_str(size) + " bytes." );
+  }
+  else
+  {
+    if( stored.size() != size )
+      throw ParsingFailed( FromHere(), "Binary block " + to_str(index) + " has " + to_str(stored.size())
+                           + " bytes, expected " + to_str(size) + "." );
+
+    if( size != 0 )
+      std::memcpy( data, &stored[0], size );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+} // XML
+} // common
+} // cf3
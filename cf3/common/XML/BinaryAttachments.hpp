@@ -0,0 +1,89 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_XML_BinaryAttachments_hpp
+#define cf3_common_XML_BinaryAttachments_hpp
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+namespace XML {
+
+////////////////////////////////////////////////////////////////////////////
+
+/// Blocks of binary data travelling with a signal frame, next to its XML.
+/// Large data, such as the values of a multi-array, is not converted to text:
+/// the XML only refers to the index of its block. The blocks are held by shared
+/// pointers, so copying a frame or sending it over the network does not copy them.
+/// All frames of an XML document share the same attachments.
+class Common_API BinaryAttachments
+{
+public:
+
+  /// Type of a block
+  typedef boost::shared_ptr< const std::vector<char> > Block;
+
+  /// Adds a block, without copying the data.
+  /// @param block The block to add. Must not be null.
+  /// @return Returns the index of the block.
+  Uint add( const Block & block );
+
+  /// Adds a block holding a copy of the given data.
+  /// @param data The data to copy.
+  /// @param size The number of bytes in @c data.
+  /// @param compress If @c true, the data is compressed using zlib.
+  /// @return Returns the index of the block.
+  Uint add( const char * data, const std::size_t size, const bool compress );
+
+  /// Gets a block.
+  /// @param index The block index.
+  /// @throw ValueNotFound if the index is not valid.
+  const Block & block( const Uint index ) const;
+
+  /// Copies the data of a block to a buffer.
+  /// @param index The block index.
+  /// @param compressed If @c true, the block is decompressed using zlib.
+  /// @param data The buffer to write to.
+  /// @param size The size of the (decompressed) data, in bytes.
+  /// @throw ValueNotFound if the index is not valid.
+  /// @throw ParsingFailed if the block does not contain @c size bytes.
+  void read( const Uint index, const bool compressed, char * data, const std::size_t size ) const;
+
+  /// @return Returns the number of blocks.
+  Uint size() const { return m_blocks.size(); }
+
+  /// @return Returns @c true if there are no blocks.
+  bool empty() const { return m_blocks.empty(); }
+
+  /// Removes all the blocks.
+  void clear() { m_blocks.clear(); }
+
+private: // data
+
+  /// The blocks, by index
+  std::vector<Block> m_blocks;
+
+}; // BinaryAttachments
+
+////////////////////////////////////////////////////////////////////////////
+
+} // XML
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_XML_BinaryAttachments_hpp
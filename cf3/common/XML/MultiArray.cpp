@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/range/as_literal.hpp>
@@ -18,6 +20,7 @@
 
 #include "common/Log.hpp"
 
+#include "common/XML/BinaryAttachments.hpp"
 #include "common/XML/Protocol.hpp"
 
 #include "common/XML/MultiArray.hpp"
@@ -30,10 +33,21 @@ namespace XML {
 
 ////////////////////////////////////////////////////////////////////////////
 
-XmlNode add_multi_array_in( Map & map, const std::string & name,
-                            const boost::multi_array<Real, 2> & array,
-                            const std::string & delimiter,
-                            const std::vector<std::string> & labels )
+namespace detail
+{
+
+/// Byte order of this machine, stored with the binary multi-arrays
+std::string byte_order()
+{
+  const Uint one = 1;
+  return *reinterpret_cast<const char*>(&one) == 1 ? "little" : "big";
+}
+
+/// Adds the array node with its labels, and returns the (empty) data node
+XmlNode add_array_node( Map & map, const std::string & name,
+                        const boost::multi_array<Real, 2> & array,
+                        const std::string & delimiter,
+                        const std::vector<std::string> & labels )
 {
   cf3_assert( map.content.is_valid() );
   cf3_assert( !name.empty())
@@ -51,41 +65,62 @@ XmlNode add_multi_array_in( Map & map, const std::string & name,
   Uint nb_rows = array.size();
   Uint nb_cols = 0;
 
-  std::string str;
-  std::string size;
-
   if(nb_rows != 0)
     nb_cols = array[0].size();
 
-  size = to_str(nb_rows) + ':' + to_str(nb_cols);
+  std::string size = to_str(nb_rows) + ':' + to_str(nb_cols);
 
   array_node.set_attribute( Protocol::Tags::attr_key(), name );
 
   data_node.set_attribute( "dimensions", to_str((Uint)array.dimensionality) );
   data_node.set_attribute( Protocol::Tags::attr_array_delimiter(), delimiter );
   data_node.set_attribute( Protocol::Tags::attr_array_size(), size);
-  data_node.set_attribute( "merge_delimiter", to_str(true) ); // temporary
 
-  // build the value string (ideas are welcome to avoid multiple
-  // memory reallocations
-  for(Uint row = 0 ; row < nb_rows ; ++row)
-  {
-    for(Uint col = 0 ; col < nb_cols ; ++col)
-      str += to_str( array[row][col] ) + delimiter;
+  return data_node;
+}
 
-    str += '\n'; // line break after each row
-  }
+/// Reads the values of a multi-array from a binary block
+void read_binary_values( const XmlNode & data_node, const std::string & name,
+                         const BinaryAttachments & attachments,
+                         boost::multi_array<Real, 2> & array )
+{
+  const Uint index = from_str<Uint>( data_node.attribute_value( Protocol::Tags::attr_attachment() ) );
+  const std::string compression = data_node.attribute_value( "compression" );
 
-  data_node.set_value(str.c_str());
+  if( compression != "none" && compression != "zlib" )
+    throw XmlError(FromHere(), "Unknown compression [" + compression + "] for multi-array [" + name + "].");
 
-  return array_node;
-}
+  // arrays with a non-default storage order are read through a buffer
+  const Uint nb_values = array.num_elements();
+  const bool contiguous = array.storage_order() == boost::general_storage_order<2>(boost::c_storage_order());
+  std::vector<Real> buffer( contiguous ? 0 : nb_values );
+  Real * values = contiguous ? array.data() : (buffer.empty() ? nullptr : &buffer[0]);
 
-////////////////////////////////////////////////////////////////////////////
+  attachments.read( index, compression == "zlib", reinterpret_cast<char*>(values), nb_values * sizeof(Real) );
+
+  // swap the bytes of each value if the array was written on a machine of different byte order
+  if( data_node.attribute_value( "byte_order" ) != byte_order() )
+  {
+    for( Uint i = 0 ; i < nb_values ; ++i )
+    {
+      char * bytes = reinterpret_cast<char*>( values + i );
+      std::reverse( bytes, bytes + sizeof(Real) );
+    }
+  }
+
+  if( !contiguous )
+  {
+    const Uint nb_cols = array.shape()[1];
+    for(Uint row = 0 ; row < array.shape()[0] ; ++row)
+      for(Uint col = 0 ; col < nb_cols ; ++col)
+        array[row][col] = buffer[row * nb_cols + col];
+  }
+}
 
 void get_multi_array( const Map & map, const std::string & name,
-                          boost::multi_array<Real, 2> & array,
-                          std::vector<std::string> & labels )
+                      boost::multi_array<Real, 2> & array,
+                      std::vector<std::string> & labels,
+                      const BinaryAttachments * attachments )
 {
   cf3_assert( map.content.is_valid() );
   cf3_assert( !name.empty());
@@ -146,7 +181,18 @@ void get_multi_array( const Map & map, const std::string & name,
   // 2. Fill the multi-array
   //
 
-  // the array is written in the XML as a 2D array, with a new line after each
+  // 2a. the values are in a binary block
+  if( is_not_null( data_node.content->first_attribute( Protocol::Tags::attr_attachment() ) ) )
+  {
+    if( is_null(attachments) )
+      throw XmlError(FromHere(), "The values of multi-array [" + name + "] are stored in a binary "
+                     "attachment, but no attachments were provided.");
+
+    read_binary_values( data_node, name, *attachments, array );
+    return;
+  }
+
+  // 2b. the array is written in the XML as a 2D array, with a new line after each
   // row. Thus we first need to tokenize the string on line breaks and then
   // split the line depending on the delimiter and cast each element to Real.
 
@@ -179,6 +225,91 @@ void get_multi_array( const Map & map, const std::string & name,
   }
 }
 
+} // detail
+
+////////////////////////////////////////////////////////////////////////////
+
+XmlNode add_multi_array_in( Map & map, const std::string & name,
+                            const boost::multi_array<Real, 2> & array,
+                            const std::string & delimiter,
+                            const std::vector<std::string> & labels )
+{
+  XmlNode data_node = detail::add_array_node( map, name, array, delimiter, labels );
+
+  Uint nb_rows = array.size();
+  Uint nb_cols = nb_rows != 0 ? array[0].size() : 0;
+
+  std::string str;
+
+  data_node.set_attribute( "merge_delimiter", to_str(true) ); // temporary
+
+  // build the value string (ideas are welcome to avoid multiple
+  // memory reallocations
+  for(Uint row = 0 ; row < nb_rows ; ++row)
+  {
+    for(Uint col = 0 ; col < nb_cols ; ++col)
+      str += to_str( array[row][col] ) + delimiter;
+
+    str += '\n'; // line break after each row
+  }
+
+  data_node.set_value(str.c_str());
+
+  return XmlNode( data_node.content->parent() );
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+XmlNode add_multi_array_in( Map & map, const std::string & name,
+                            const boost::multi_array<Real, 2> & array,
+                            BinaryAttachments & attachments,
+                            const bool compress,
+                            const std::vector<std::string> & labels )
+{
+  XmlNode data_node = detail::add_array_node( map, name, array, ";", labels );
+
+  // the values are copied as they are in memory, row by row
+  const Uint nb_values = array.num_elements();
+  const Real * values = array.data();
+  std::vector<Real> buffer;
+
+  if( !(array.storage_order() == boost::general_storage_order<2>(boost::c_storage_order())) )
+  {
+    buffer.reserve( nb_values );
+    for(Uint row = 0 ; row < array.shape()[0] ; ++row)
+      for(Uint col = 0 ; col < array.shape()[1] ; ++col)
+        buffer.push_back( array[row][col] );
+    values = buffer.empty() ? nullptr : &buffer[0];
+  }
+
+  const Uint index = attachments.add( reinterpret_cast<const char*>(values), nb_values * sizeof(Real), compress );
+
+  data_node.set_attribute( Protocol::Tags::attr_attachment(), to_str(index) );
+  data_node.set_attribute( "compression", compress ? "zlib" : "none" );
+  data_node.set_attribute( "byte_order", detail::byte_order() );
+
+  return XmlNode( data_node.content->parent() );
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+void get_multi_array( const Map & map, const std::string & name,
+                          boost::multi_array<Real, 2> & array,
+                          std::vector<std::string> & labels )
+{
+  detail::get_multi_array( map, name, array, labels, nullptr );
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+void get_multi_array( const Map & map, const std::string & name,
+                          boost::multi_array<Real, 2> & array,
+                          std::vector<std::string> & labels,
+                          const BinaryAttachments & attachments )
+{
+  detail::get_multi_array( map, name, array, labels, &attachments );
+}
+
 ////////////////////////////////////////////////////////////////////////////
 
 } // XML
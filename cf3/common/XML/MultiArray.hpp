@@ -21,16 +21,38 @@ namespace XML {
 
 ////////////////////////////////////////////////////////////////////////////
 
+class BinaryAttachments;
+
+////////////////////////////////////////////////////////////////////////////
+
 /// Adds a multi array in the provided @c Map
 XmlNode add_multi_array_in(Map & map, const std::string & name,
                            const boost::multi_array<Real, 2> & array,
                            const std::string & delimiter = ";",
                            const std::vector<std::string> & labels = std::vector<std::string>());
 
+/// Adds a multi array in the provided @c Map, with its values stored in a
+/// binary block of @c attachments instead of in the XML text.
+/// @param compress If @c true, the block is compressed using zlib.
+XmlNode add_multi_array_in(Map & map, const std::string & name,
+                           const boost::multi_array<Real, 2> & array,
+                           BinaryAttachments & attachments,
+                           const bool compress = false,
+                           const std::vector<std::string> & labels = std::vector<std::string>());
+
+/// Gets a multi array from the provided @c Map.
+/// @throw XmlError if the values are stored in a binary block.
 void get_multi_array(const Map & map, const std::string & name,
                          boost::multi_array<Real, 2> & array,
                          std::vector<std::string> & labels);
 
+/// Gets a multi array from the provided @c Map, with its values stored either
+/// in the XML text or in a binary block of @c attachments.
+void get_multi_array(const Map & map, const std::string & name,
+                         boost::multi_array<Real, 2> & array,
+                         std::vector<std::string> & labels,
+                         const BinaryAttachments & attachments);
+
 ////////////////////////////////////////////////////////////////////////////
 
 } // XML
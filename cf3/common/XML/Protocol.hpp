@@ -45,6 +45,11 @@ namespace XML {
       static const char * attr_array_size ();
       /// @returns Returns the name for attribute 'type' of arrays.
       static const char * attr_array_type ();
+      /// @returns Returns the name for attribute that maintains the index of a binary attachment.
+      static const char * attr_attachment ();
+      /// @returns Returns the name for attribute that maintains the sizes of the binary attachments
+      /// sent after a document.
+      static const char * attr_attachment_sizes ();
 
 
       /// @returns Returns the name for attribute that maintains the client UUID.
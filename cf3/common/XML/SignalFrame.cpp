@@ -35,9 +35,12 @@ namespace common {
 namespace XML {
 ////////////////////////////////////////////////////////////////////////////
 
-SignalFrame::SignalFrame ( XmlNode xml ) :
-  node(xml)
+SignalFrame::SignalFrame ( XmlNode xml, const boost::shared_ptr<BinaryAttachments> & attachments_ptr ) :
+  node(xml),
+  attachments(attachments_ptr)
 {
+  if( is_null(attachments) )
+    attachments.reset( new BinaryAttachments() );
 
   if( node.is_valid() )
   {
@@ -63,7 +66,7 @@ SignalFrame::SignalFrame ( XmlNode xml ) :
         if( attr != nullptr && attr->value()[0] != '\0' &&
             map != nullptr && std::strcmp(map->name(), Protocol::Tags::node_map()) == 0 )
         {
-          m_maps[attr->value()] = SignalFrame(value);
+          m_maps[attr->value()] = SignalFrame(value, attachments);
         }
       }
     }
@@ -83,7 +86,8 @@ SignalFrame::SignalFrame ( XmlNode xml ) :
 ////////////////////////////////////////////////////////////////////////////
 
 SignalFrame::SignalFrame ( boost::shared_ptr<XmlDoc> doc )
-  : xml_doc(doc)
+  : xml_doc(doc),
+    attachments(new BinaryAttachments())
 {
   cf3_assert( is_not_null(doc) );
 
@@ -117,7 +121,7 @@ SignalFrame::SignalFrame ( boost::shared_ptr<XmlDoc> doc )
         if( attr != nullptr && attr->value()[0] != '\0' &&
             map != nullptr && std::strcmp(map->name(), Protocol::Tags::node_map()) == 0 )
         {
-          m_maps[attr->value()] = SignalFrame(value);
+          m_maps[attr->value()] = SignalFrame(value, attachments);
         }
       }
     }
@@ -137,7 +141,8 @@ SignalFrame::SignalFrame ( boost::shared_ptr<XmlDoc> doc )
 
 SignalFrame::SignalFrame ( const std::string& target,
                            const URI& sender,
-                           const URI& receiver )
+                           const URI& receiver ) :
+  attachments(new BinaryAttachments())
 {
   xml_doc = Protocol::create_doc();
   XmlNode doc_node = Protocol::goto_doc_node(*xml_doc.get());
@@ -230,7 +235,7 @@ SignalFrame & SignalFrame::map ( const std::string & name )
   {
     XmlNode node = main_map.content.add_node( Protocol::Tags::node_value() );
     node.set_attribute( Protocol::Tags::attr_key(), name );
-    m_maps[name] = SignalFrame(node); // SignalFrame() adds a map under the node
+    m_maps[name] = SignalFrame(node, attachments); // SignalFrame() adds a map under the node
   }
 
   return m_maps[name];
@@ -267,7 +272,7 @@ SignalFrame SignalFrame::create_reply ( const URI & sender )
     sender_uri = URI(attr->value());
   }
 
-  SignalFrame reply(Protocol::add_reply_frame( node ));
+  SignalFrame reply(Protocol::add_reply_frame( node ), attachments);
 
   reply.node.set_attribute("sender", sender_uri.string() );
 
@@ -289,7 +294,7 @@ SignalFrame SignalFrame::get_reply () const
     rapidxml::xml_attribute<>* attr = reply.content->first_attribute( "type" );
 
     if( attr != nullptr && std::strcmp(attr->value(), Protocol::Tags::node_type_reply()) == 0 )
-      return SignalFrame(reply);
+      return SignalFrame(reply, attachments);
   }
 
   return SignalFrame();
@@ -12,6 +12,7 @@
 
 #include "common/URI.hpp"
 
+#include "common/XML/BinaryAttachments.hpp"
 #include "common/XML/Map.hpp"
 #include "common/XML/XmlDoc.hpp"
 #include "common/XML/SignalOptions.hpp"
@@ -34,7 +35,10 @@ public:
 
   /// Contructor.
   /// @param xml The node to manage.
-  SignalFrame ( XmlNode xml = XmlNode() );
+  /// @param attachments The binary attachments of the document @c xml belongs to.
+  /// If null, new attachments are created.
+  SignalFrame ( XmlNode xml = XmlNode(),
+                const boost::shared_ptr<BinaryAttachments> & attachments = boost::shared_ptr<BinaryAttachments>() );
 
   /// Constructor
   /// @param doc The document the frame is based on.
@@ -144,6 +148,9 @@ public: // data
   /// created by this class.
   boost::shared_ptr<XmlDoc> xml_doc;
 
+  /// The binary attachments, shared by all frames of the document. Never null.
+  boost::shared_ptr<BinaryAttachments> attachments;
+
   SignalOptions & options( const std::string & name = std::string() );
 
   const SignalOptions & options( const std::string & name = std::string() ) const;
@@ -0,0 +1,95 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/Consts.hpp"
+#include "math/FFT.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+
+//////////////////////////////////////////////////////////////////////////////
+
+void fft(std::vector< std::complex<Real> >& data, const bool inverse)
+{
+  const Uint n = data.size();
+  if(!is_power_of_two(n))
+    throw common::BadValue(FromHere(), "FFT size " + common::to_str(n) + " is not a power of two");
+
+  // Bit-reversal permutation
+  for(Uint i = 1, j = 0; i != n; ++i)
+  {
+    Uint bit = n >> 1;
+    for(; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if(i < j)
+      std::swap(data[i], data[j]);
+  }
+
+  // Butterflies, doubling the transform length at each stage
+  const Real sign = inverse ? 1. : -1.;
+  for(Uint length = 2; length <= n; length <<= 1)
+  {
+    const Real angle = sign * 2. * Consts::pi() / static_cast<Real>(length);
+    const std::complex<Real> w_length(std::cos(angle), std::sin(angle));
+    const Uint half = length / 2;
+    for(Uint begin = 0; begin != n; begin += length)
+    {
+      std::complex<Real> w(1.);
+      for(Uint k = 0; k != half; ++k)
+      {
+        const std::complex<Real> u = data[begin+k];
+        const std::complex<Real> v = data[begin+k+half] * w;
+        data[begin+k] = u + v;
+        data[begin+k+half] = u - v;
+        w *= w_length;
+      }
+    }
+  }
+
+  if(inverse)
+  {
+    const Real scale = 1. / static_cast<Real>(n);
+    for(Uint i = 0; i != n; ++i)
+      data[i] *= scale;
+  }
+}
+
+void add_circular_autocorrelation(const Real* values, const Uint n, const Uint stride, Real* result)
+{
+  if(!is_power_of_two(n))
+  {
+    for(Uint k = 0; k != n; ++k)
+      for(Uint i = 0; i != n; ++i)
+        result[k] += values[i*stride] * values[((i+k) % n)*stride];
+    return;
+  }
+
+  // Wiener-Khinchin: the autocorrelation is the inverse transform of the power spectrum
+  std::vector< std::complex<Real> > transformed(n);
+  for(Uint i = 0; i != n; ++i)
+    transformed[i] = values[i*stride];
+  fft(transformed);
+  for(Uint i = 0; i != n; ++i)
+    transformed[i] = std::norm(transformed[i]);
+  fft(transformed, true);
+  for(Uint k = 0; k != n; ++k)
+    result[k] += transformed[k].real();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // math
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
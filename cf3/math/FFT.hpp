@@ -0,0 +1,46 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_math_FFT_hpp
+#define cf3_math_FFT_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <complex>
+#include <vector>
+
+#include "math/LibMath.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// True if n is a power of two (and not zero)
+inline bool is_power_of_two(const Uint n)
+{
+  return n != 0 && (n & (n-1)) == 0;
+}
+
+/// In-place iterative radix-2 fast Fourier transform. The size of data must be a power of two.
+/// The inverse transform is scaled by 1/n, so a forward transform followed by an inverse one is the identity.
+Math_API void fft(std::vector< std::complex<Real> >& data, const bool inverse = false);
+
+/// Circular autocorrelation of the n values, spaced stride apart, starting at values:
+/// result[k] += sum_i values[i]*values[(i+k) % n], for k in [0, n).
+/// Uses the FFT when n is a power of two, and a direct O(n^2) evaluation otherwise.
+Math_API void add_circular_autocorrelation(const Real* values, const Uint n, const Uint stride, Real* result);
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // math
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_math_FFT_hpp
@@ -0,0 +1,32 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "math/LSS/Matrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+const Uint Matrix::scatter_skip;
+
+void Matrix::sparsity_changed()
+{
+  // The counter is shared by all matrices, so a matrix that is created at the address of a deleted one never reuses its generation
+  static Uint generation_counter = 0;
+  m_sparsity_generation = ++generation_counter;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
@@ -12,6 +12,7 @@
 #include <boost/utility.hpp>
 
 #include "math/LSS/LibLSS.hpp"
+#include "common/BasicExceptions.hpp"
 #include "common/PE/CommPattern.hpp"
 #include "common/Log.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
@@ -48,7 +49,7 @@ public:
   virtual const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) = 0;
 
   /// Default constructor
-  Matrix(const std::string& name) : Component(name) { }
+  Matrix(const std::string& name) : Component(name), m_sparsity_generation(0) { }
 
   /// Setup sparsity structure
   /// should only work with local numbering (parallel computations, plus rcm could be a totally internal matter of the matrix)
@@ -124,6 +125,32 @@ public:
 
   //@} END EFFICCIENT ACCESS
 
+  /// @name SCATTER ASSEMBLY
+  /// Direct assembly into the value array of the matrix, avoiding the index conversion and column search of add_values.
+  /// Used through ScatterMap, which caches the offsets per element as long as the sparsity does not change.
+  //@{
+
+  /// Offset value for the rows of the block accumulator that are not stored on this rank
+  static const Uint scatter_skip = static_cast<Uint>(-1);
+
+  /// Value array that the offsets computed by scatter_offsets point into, or null if direct assembly is not supported.
+  /// The default returns null, so add_values is used.
+  virtual Real* scatter_values() { return nullptr; }
+
+  /// Compute the positions in scatter_values() for the entries of an element matrix. For each row r of values.mat and each node j
+  /// in values.indices, offsets[r*values.block_size() + j] receives the position of the entry at column j*neq, the neq entries for
+  /// node j being stored consecutively, or scatter_skip if row r is not stored on this rank.
+  /// @pre scatter_values() is not null
+  virtual void scatter_offsets(const BlockAccumulator& values, Uint* offsets)
+  {
+    throw common::NotSupported(FromHere(), "Matrix " + uri().string() + " does not support direct assembly");
+  }
+
+  /// Identifies the current sparsity structure. Changes each time the structure, and with it the scatter offsets, change
+  Uint sparsity_generation() const { return m_sparsity_generation; }
+
+  //@} END SCATTER ASSEMBLY
+
   /// @name MISCELLANEOUS
   //@{
 
@@ -142,6 +169,10 @@ public:
   /// Accessor to the state of create
   virtual const bool is_created() = 0;
 
+  /// True while the assembly actions are run only to evaluate the matrix, as a matrix-free matrix does for each product.
+  /// The actions must skip their contributions to the RHS then. The default is false, for the matrices that store their values.
+  virtual bool is_evaluating() const { return false; }
+
   /// Accessor to the number of equations
   virtual const Uint neq() = 0;
 
@@ -154,8 +185,12 @@ public:
   /// Make a deep copy of the current matrix into other
   virtual void clone_to(Matrix& other) = 0;
   
-  /// Read in a linear system, optionally filling the provided RHS and solution vector
-  virtual void read_native(const common::URI& file) = 0;
+  /// Read in a linear system, optionally filling the provided RHS and solution vector.
+  /// The default throws, for the matrices that have no file format of their own.
+  virtual void read_native(const common::URI& file)
+  {
+    throw common::NotSupported(FromHere(), "Matrix " + uri().string() + " can't be read from a file");
+  }
   
 
   //@} END MISCELLANEOUS
@@ -177,7 +212,12 @@ public:
 
   //@} END TEST ONLY
 
+protected:
+  /// Implementations call this each time the sparsity structure or the value storage changes, invalidating cached scatter offsets
+  void sparsity_changed();
 
+private:
+  Uint m_sparsity_generation;
 }; // end of class Matrix
 
 ////////////////////////////////////////////////////////////////////////////////////////////
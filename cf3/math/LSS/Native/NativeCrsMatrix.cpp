@@ -0,0 +1,714 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+
+#include "common/Assertions.hpp"
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PropertyList.hpp"
+
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeCrsMatrix, LSS::Matrix, LSS::LibLSS > NativeCrsMatrix_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeCrsMatrix::NativeCrsMatrix(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0),
+  m_block_size(0),
+  m_nb_nodes(0)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.NativeVector"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  m_neq = neq;
+  m_block_size = neq*neq;
+  m_nb_nodes = cp.isUpdatable().size();
+  cf3_assert(starting_indices.size() == m_nb_nodes+1);
+
+  m_node_connectivity = node_connectivity;
+  m_starting_indices = starting_indices;
+
+  detail::create_native_layout(cp, periodic_links_nodes, periodic_links_active, m_node_map, m_owned_nodes);
+  m_owned.assign(m_nb_nodes, false);
+  BOOST_FOREACH(const Uint node, m_owned_nodes)
+    m_owned[node] = true;
+
+  // Upper bound for the number of blocks in each row. Rows of periodic nodes are merged into the row of the node they link to
+  std::vector<Uint> row_capacity(m_nb_nodes+1, 0);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(m_owned[row])
+      row_capacity[row+1] += starting_indices[i+1] - starting_indices[i] + 1;
+  }
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+    row_capacity[i+1] += row_capacity[i];
+
+  std::vector<Uint> raw_columns(row_capacity.back());
+  std::vector<Uint> row_fill(row_capacity.begin(), row_capacity.end()-1);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    raw_columns[row_fill[row]++] = row; // the diagonal is always present
+    for(Uint j = starting_indices[i]; j != starting_indices[i+1]; ++j)
+      raw_columns[row_fill[row]++] = m_node_map[node_connectivity[j]];
+  }
+
+  // Sort the columns in each row and remove duplicates
+  m_row_starts.assign(m_nb_nodes+1, 0);
+  m_columns.clear();
+  m_columns.reserve(raw_columns.size());
+  for(Uint row = 0; row != m_nb_nodes; ++row)
+  {
+    std::vector<Uint>::iterator row_begin = raw_columns.begin() + row_capacity[row];
+    std::vector<Uint>::iterator row_end = raw_columns.begin() + row_fill[row];
+    std::sort(row_begin, row_end);
+    m_columns.insert(m_columns.end(), row_begin, std::unique(row_begin, row_end));
+    m_row_starts[row+1] = m_columns.size();
+  }
+
+  m_diagonal_positions.assign(m_nb_nodes, 0);
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+    m_diagonal_positions[row] = block_position(row, row);
+
+  m_values.assign(m_columns.size()*m_block_size, 0.);
+
+  m_is_created=true;
+  sparsity_changed();
+  m_values_tracker.changed();
+  CFdebug << "Rank " << common::PE::Comm::instance().rank() << ": Created a native block CSR matrix with " << m_columns.size() << " blocks of size " << m_neq << " and " << m_owned_nodes.size() << " local block rows" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), node_connectivity, starting_indices, solution, rhs, periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::destroy()
+{
+  m_node_map.clear();
+  m_owned_nodes.clear();
+  m_owned.clear();
+  m_row_starts.clear();
+  m_columns.clear();
+  m_values.clear();
+  m_diagonal_positions.clear();
+  m_node_connectivity.clear();
+  m_starting_indices.clear();
+  m_symmetric_dirichlet_values.clear();
+  m_neq=0;
+  m_block_size=0;
+  m_nb_nodes=0;
+  m_is_created=false;
+  sparsity_changed();
+  m_values_tracker.changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeCrsMatrix::block_position(const Uint row, const Uint col) const
+{
+  const std::vector<Uint>::const_iterator row_begin = m_columns.begin() + m_row_starts[row];
+  const std::vector<Uint>::const_iterator row_end = m_columns.begin() + m_row_starts[row+1];
+  const std::vector<Uint>::const_iterator found = std::lower_bound(row_begin, row_end, col);
+  if(found == row_end || *found != col)
+    return m_columns.size();
+  return found - m_columns.begin();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeCrsMatrix::checked_block_position(const Uint row, const Uint col) const
+{
+  const Uint result = block_position(row, col);
+  if(result == m_columns.size())
+    throw common::BadValue(FromHere(),"Trying to access an illegal entry.");
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint row = m_node_map[irow/m_neq];
+  if(!m_owned[row])
+    return;
+  block(checked_block_position(row, m_node_map[icol/m_neq]))[(irow%m_neq)*m_neq + icol%m_neq] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint row = m_node_map[irow/m_neq];
+  if(!m_owned[row])
+    return;
+  block(checked_block_position(row, m_node_map[icol/m_neq]))[(irow%m_neq)*m_neq + icol%m_neq] += value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  const Uint row = m_node_map[irow/m_neq];
+  if(!m_owned[row])
+  {
+    value = 0.;
+    return;
+  }
+  value = block(checked_block_position(row, m_node_map[icol/m_neq]))[(irow%m_neq)*m_neq + icol%m_neq];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint nb_nodes = values.indices.size();
+  cf3_assert(values.mat.rows() == nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    if(!m_owned[row])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block_values = block(checked_block_position(row, m_node_map[values.indices[j]]));
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          block_values[a*m_neq+b] = values.mat(i*m_neq+a, j*m_neq+b);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint nb_nodes = values.indices.size();
+  cf3_assert(values.mat.rows() == nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    if(!m_owned[row])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block_values = block(checked_block_position(row, m_node_map[values.indices[j]]));
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          block_values[a*m_neq+b] += values.mat(i*m_neq+a, j*m_neq+b);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::scatter_offsets(const BlockAccumulator& values, Uint* offsets)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      for(Uint j = 0; j != nb_nodes; ++j, ++offsets)
+        *offsets = m_owned[row] ? checked_block_position(row, m_node_map[values.indices[j]])*m_block_size + a*m_neq : scatter_skip;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  values.mat.setZero();
+  const Uint nb_nodes = values.indices.size();
+  cf3_assert(values.mat.rows() == nb_nodes*m_neq);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    if(!m_owned[row])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      const Real* block_values = block(checked_block_position(row, m_node_map[values.indices[j]]));
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          values.mat(i*m_neq+a, j*m_neq+b) = block_values[a*m_neq+b];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint row = m_node_map[iblockrow];
+  if(!m_owned[row])
+    return;
+
+  for(Uint pos = m_row_starts[row]; pos != m_row_starts[row+1]; ++pos)
+  {
+    Real* row_values = block(pos) + ieq*m_neq;
+    for(Uint b = 0; b != m_neq; ++b)
+      row_values[b] = (m_columns[pos] == row && b == ieq) ? diagval : offdiagval;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  values.assign(m_nb_nodes*m_neq, 0.);
+  const Uint col = m_node_map[iblockcol];
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+  {
+    const Uint pos = block_position(row, col);
+    if(pos == m_columns.size())
+      continue;
+    Real* block_values = block(pos);
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      values[row*m_neq+a] = block_values[a*m_neq+ieq];
+      block_values[a*m_neq+ieq] = 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  cf3_assert(m_is_created);
+  std::vector<Real>& rhs_data = dynamic_cast<NativeVector&>(rhs).data();
+
+  const Uint col = m_node_map[blockrow];
+  DirichletEntryT& cached_col_values = m_symmetric_dirichlet_values[col*m_neq+ieq];
+
+  if(cached_col_values.empty())
+  {
+    m_values_tracker.changed();
+
+    // Rows coupled to the boundary node, as storage nodes
+    std::vector<Uint> rows;
+    rows.reserve(m_starting_indices[blockrow+1] - m_starting_indices[blockrow]);
+    for(Uint i = m_starting_indices[blockrow]; i != m_starting_indices[blockrow+1]; ++i)
+    {
+      const Uint row = m_node_map[m_node_connectivity[i]];
+      if(m_owned[row])
+        rows.push_back(row);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    BOOST_FOREACH(const Uint row, rows)
+    {
+      Real* block_values = block(checked_block_position(row, col));
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        if(row == col && a == ieq)
+          continue;
+        const Uint other_row = row*m_neq+a;
+        Real& entry = block_values[a*m_neq+ieq];
+        cached_col_values[other_row] = entry;
+        rhs_data[other_row] -= entry * value;
+        entry = 0.;
+      }
+    }
+
+    if(m_owned[col])
+      set_row(blockrow, ieq, 1., 0.);
+  }
+  else // Reuse the cached values, if the matrix wasn't reset since the previous BC application
+  {
+    for(DirichletEntryT::const_iterator it = cached_col_values.begin(); it != cached_col_values.end(); ++it)
+    {
+      rhs_data[it->first] -= it->second * value;
+    }
+  }
+
+  rhs.set_value(blockrow, ieq, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  const Uint row_to = m_node_map[iblockrow_to];
+  const Uint row_from = m_node_map[iblockrow_from];
+  if(!m_owned[row_to] || !m_owned[row_from] || row_to == row_from)
+    return;
+
+  const Uint nb_blocks = m_row_starts[row_to+1] - m_row_starts[row_to];
+  if(m_row_starts[row_from+1] - m_row_starts[row_from] != nb_blocks)
+    throw common::BadValue(FromHere(),"Number of entries do not match for the two block rows to be tied together.");
+  if(!std::equal(m_columns.begin() + m_row_starts[row_to], m_columns.begin() + m_row_starts[row_to+1], m_columns.begin() + m_row_starts[row_from]))
+    throw common::BadValue(FromHere(),"Indices of the entries do not match for the two block rows to be tied together.");
+
+  Real* values_to = block(m_row_starts[row_to]);
+  Real* values_from = block(m_row_starts[row_from]);
+  Real* to_to = block(checked_block_position(row_to, row_to));
+  Real* to_from = block(checked_block_position(row_to, row_from));
+  Real* from_to = block(checked_block_position(row_from, row_to));
+  Real* from_from = block(checked_block_position(row_from, row_from));
+  for(Uint i = 0; i != m_neq; ++i)
+  {
+    // Add the from row to the to row
+    for(Uint j = 0; j != nb_blocks; ++j)
+    {
+      for(Uint b = 0; b != m_neq; ++b)
+      {
+        const Uint idx = j*m_block_size + i*m_neq + b;
+        values_to[idx] += values_from[idx];
+        values_from[idx] = 0.;
+      }
+    }
+    // The from row now expresses equality of both unknowns
+    from_from[i*m_neq+i] = 1.;
+    from_to[i*m_neq+i] = -1.;
+    // Move the from column into the to column
+    for(Uint k = 0; k != m_neq; ++k)
+    {
+      to_to[i*m_neq+k] += to_from[i*m_neq+k];
+      to_from[i*m_neq+k] = 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::set_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  cf3_assert(diag.size() == m_nb_nodes*m_neq);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    Real* diag_block = block(m_diagonal_positions[row]);
+    for(Uint a = 0; a != m_neq; ++a)
+      diag_block[a*m_neq+a] = diag[i*m_neq+a];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::add_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  cf3_assert(diag.size() == m_nb_nodes*m_neq);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    Real* diag_block = block(m_diagonal_positions[row]);
+    for(Uint a = 0; a != m_neq; ++a)
+      diag_block[a*m_neq+a] += diag[i*m_neq+a];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  diag.assign(m_nb_nodes*m_neq, 0.);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    const Real* diag_block = block(m_diagonal_positions[row]);
+    for(Uint a = 0; a != m_neq; ++a)
+      diag[i*m_neq+a] = diag_block[a*m_neq+a];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  m_values.assign(m_values.size(), reset_to);
+  m_symmetric_dirichlet_values.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::clone_to(Matrix &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Matrix to clone " + uri().string() + " is not created");
+
+  NativeCrsMatrix* other_ptr = dynamic_cast<NativeCrsMatrix*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeCrsMatrix needs another NativeCrsMatrix, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->m_is_created = m_is_created;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_block_size = m_block_size;
+  other_ptr->m_nb_nodes = m_nb_nodes;
+  other_ptr->m_node_map = m_node_map;
+  other_ptr->m_owned_nodes = m_owned_nodes;
+  other_ptr->m_owned = m_owned;
+  other_ptr->m_row_starts = m_row_starts;
+  other_ptr->m_columns = m_columns;
+  other_ptr->m_values = m_values;
+  other_ptr->m_diagonal_positions = m_diagonal_positions;
+  other_ptr->m_node_connectivity = m_node_connectivity;
+  other_ptr->m_starting_indices = m_starting_indices;
+  other_ptr->m_symmetric_dirichlet_values = m_symmetric_dirichlet_values;
+  other_ptr->sparsity_changed();
+  other_ptr->m_values_tracker.changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename StreamT>
+void NativeCrsMatrix::print_entries(StreamT& stream)
+{
+  Uint nb_entries = 0;
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+  {
+    for(Uint pos = m_row_starts[row]; pos != m_row_starts[row+1]; ++pos)
+    {
+      const Real* block_values = block(pos);
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          stream << m_columns[pos]*m_neq+b << " " << -(int)(row*m_neq+a) << " " << block_values[a*m_neq+b] << "\n";
+    }
+    nb_entries += (m_row_starts[row+1] - m_row_starts[row])*m_block_size;
+  }
+  stream << "# name:                 " << name() << "\n";
+  stream << "# type_name:            " << type_name() << "\n";
+  stream << "# process:              " << common::PE::Comm::instance().rank() << "\n";
+  stream << "# number of equations:  " << m_neq << "\n";
+  stream << "# number of rows:       " << m_owned_nodes.size()*m_neq << "\n";
+  stream << "# number of cols:       " << m_nb_nodes*m_neq << "\n";
+  stream << "# number of block rows: " << m_owned_nodes.size() << "\n";
+  stream << "# number of block cols: " << m_nb_nodes << "\n";
+  stream << "# number of entries:    " << nb_entries << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    print_entries(stream);
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    print_entries(stream);
+    stream << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print(const std::string& filename, std::ios_base::openmode mode )
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::print_native(std::ostream& stream)
+{
+  stream << "# block size: " << m_neq << "\n";
+  for(Uint row = 0; row != m_nb_nodes; ++row)
+  {
+    for(Uint pos = m_row_starts[row]; pos != m_row_starts[row+1]; ++pos)
+    {
+      stream << row << " " << m_columns[pos];
+      const Real* block_values = block(pos);
+      for(Uint i = 0; i != m_block_size; ++i)
+        stream << " " << block_values[i];
+      stream << "\n";
+    }
+  }
+  stream << std::flush;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  row_indices.clear(); col_indices.clear(); values.clear();
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+  {
+    for(Uint pos = m_row_starts[row]; pos != m_row_starts[row+1]; ++pos)
+    {
+      const Real* block_values = block(pos);
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        for(Uint b = 0; b != m_neq; ++b)
+        {
+          row_indices.push_back(row*m_neq+a);
+          col_indices.push_back(m_columns[pos]*m_neq+b);
+          values.push_back(block_values[a*m_neq+b]);
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::multiply(NativeVector& x, NativeVector& y, const common::ThreadPool& threads, const Real alpha, const Real beta) const
+{
+  cf3_assert(m_is_created);
+  cf3_assert(x.data().size() == m_nb_nodes*m_neq);
+  cf3_assert(y.data().size() == m_nb_nodes*m_neq);
+
+  x.sync();
+
+  const Uint neq = m_neq;
+  const Uint block_size = m_block_size;
+  const Uint* owned = m_owned_nodes.data();
+  const Uint* row_starts = m_row_starts.data();
+  const Uint* columns = m_columns.data();
+  const Real* values = m_values.data();
+  const Real* x_data = x.data().data();
+  Real* y_data = y.data().data();
+
+  detail::parallel_for(m_owned_nodes.size(), threads, [=](const Uint begin, const Uint end)
+  {
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint row = owned[i];
+      const Uint row_end = row_starts[row+1];
+      if(neq == 1)
+      {
+        Real sum = 0.;
+        for(Uint pos = row_starts[row]; pos != row_end; ++pos)
+          sum += values[pos] * x_data[columns[pos]];
+        y_data[row] = alpha*sum + (beta == 0. ? 0. : beta*y_data[row]);
+        continue;
+      }
+      for(Uint a = 0; a != neq; ++a)
+      {
+        Real sum = 0.;
+        for(Uint pos = row_starts[row]; pos != row_end; ++pos)
+        {
+          const Real* block_row = values + pos*block_size + a*neq;
+          const Real* x_block = x_data + columns[pos]*neq;
+          for(Uint b = 0; b != neq; ++b)
+            sum += block_row[b] * x_block[b];
+        }
+        Real& result = y_data[row*neq+a];
+        result = alpha*sum + (beta == 0. ? 0. : beta*result);
+      }
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::diagonal_blocks(std::vector<Real>& blocks, const common::ThreadPool& threads) const
+{
+  cf3_assert(m_is_created);
+  blocks.assign(m_nb_nodes*m_block_size, 0.);
+
+  const Uint block_size = m_block_size;
+  const Uint* owned = m_owned_nodes.data();
+  const Uint* diag_positions = m_diagonal_positions.data();
+  const Real* values = m_values.data();
+  Real* block_data = blocks.data();
+  detail::parallel_for(m_owned_nodes.size(), threads, [=](const Uint begin, const Uint end)
+  {
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint row = owned[i];
+      const Real* diag_block = values + diag_positions[row]*block_size;
+      std::copy(diag_block, diag_block + block_size, block_data + row*block_size);
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeCrsMatrix::apply(const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha, const Real beta)
+{
+  Handle<NativeVector> y_native(y);
+  Handle<NativeVector const> x_native(x);
+  if(is_null(y_native) || is_null(x_native))
+    throw common::SetupError(FromHere(), "apply method of NativeCrsMatrix needs NativeVector arguments");
+
+  // Only the ghost values of x are updated, its owned values are left untouched
+  multiply(const_cast<NativeVector&>(*x_native), *y_native, common::ThreadPool::serial(), alpha, beta);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,275 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeCrsMatrix_hpp
+#define cf3_Math_LSS_NativeCrsMatrix_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+
+#include "common/PE/CommPattern.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Matrix.hpp"
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/VariablesDescriptor.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeCrsMatrix.hpp Definition of the LSS::Matrix interface without external dependencies.
+
+  The matrix is stored in block compressed sparse row format, with dense neq x neq blocks coupling two nodes.
+  Only the nodes owned by this rank have rows, the columns are numbered using process-local node indices, so
+  a matrix-vector product only needs an update of the ghost values of the vector that is multiplied.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+class NativeVector;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeCrsMatrix : public LSS::Matrix {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeCrsMatrix"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// Accessor to the flag if matrix, solution and rhs are tied together or not
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return true; }
+
+  /// Default constructor
+  NativeCrsMatrix(const std::string& name);
+
+  /// Setup sparsity structure
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// The storage is always per node, so this is the same as create with neq equal to the size of vars
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Set value at given location in the matrix. Rows that are not owned by this rank are ignored
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Add value at given location in the matrix. Rows that are not owned by this rank are ignored
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Get value at given location in the matrix. Rows that are not owned by this rank return zero
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Set a list of values
+  void set_values(const BlockAccumulator& values);
+
+  /// Add a list of values. Safe to call from several threads at once, as long as the threads touch different rows
+  void add_values(const BlockAccumulator& values);
+
+  /// Get a list of values
+  void get_values(BlockAccumulator& values);
+
+  /// Set a row, diagonal and off-diagonals values separately (dirichlet-type boundaries)
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Get a column and replace it to zero (dirichlet-type boundaries, when trying to preserve symmetry)
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  /// Apply a dirichlet boundary condition, preserving symmetry by moving entries to the RHS
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs);
+
+  /// Add one line to another and tie to it via dirichlet-style (applying periodicity)
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Set the diagonal
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Get the diagonal
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Reset Matrix
+  void reset(Real reset_to=0.);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name SCATTER ASSEMBLY
+  //@{
+
+  /// The values may be written through the returned pointer, so this counts as a change of the values
+  Real* scatter_values() { m_values_tracker.changed(); return m_values.data(); }
+
+  void scatter_offsets(const BlockAccumulator& values, Uint* offsets);
+
+  //@} END SCATTER ASSEMBLY
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  /// Print the raw block CSR arrays
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { return m_neq; }
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { return m_nb_nodes; }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { return m_nb_nodes; }
+
+  void clone_to(Matrix& other);
+
+  //@} END MISCELLANEOUS
+
+  /// @name LINEAR ALGEBRA
+  //@{
+
+  void apply(const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha = 1., const Real beta = 0.);
+
+  //@} END LINEAR ALGEBRA
+
+  /// @name NATIVE ACCESS
+  /// @attention these functions are not part of the interface, they are used between the native classes
+  //@{
+
+  /// Compute y = alpha*A*x + beta*y for the owned rows, using the threads of the pool. The ghosts of x are updated first
+  void multiply(NativeVector& x, NativeVector& y, const common::ThreadPool& threads = common::ThreadPool::serial(), const Real alpha = 1., const Real beta = 0.) const;
+
+  /// Diagonal blocks of the owned rows, row-major and indexed by storage node
+  void diagonal_blocks(std::vector<Real>& blocks, const common::ThreadPool& threads = common::ThreadPool::serial()) const;
+
+  /// Storage nodes that have a row in this matrix
+  const std::vector<Uint>& owned_nodes() const { return m_owned_nodes; }
+
+  /// Start of the blocks of each row in columns(), indexed by storage node
+  const std::vector<Uint>& row_starts() const { return m_row_starts; }
+
+  /// Column storage node for each block, sorted within each row
+  const std::vector<Uint>& columns() const { return m_columns; }
+
+  /// Block values, each block stored row-major
+  const std::vector<Real>& values() const { return m_values; }
+
+  /// Index of the diagonal block for each owned storage node
+  const std::vector<Uint>& diagonal_positions() const { return m_diagonal_positions; }
+
+  /// True if the given storage node is owned by this rank
+  bool is_owned(const Uint node) const { return m_owned[node]; }
+
+  /// Index of the block coupling the given storage nodes, or columns().size() if there is no such block
+  Uint block_position(const Uint row, const Uint col) const;
+
+  /// Identifies the current values, changing each time the values are modified. May not be called during an assembly
+  Uint values_generation() { return m_values_tracker.generation(); }
+
+  //@} END NATIVE ACCESS
+
+  /// @name TEST ONLY
+  //@{
+
+  /// exports the matrix into big linear arrays
+  /// @attention only for debug and utest purposes
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+
+  /// Index of the block coupling the given storage nodes, throwing if it does not exist
+  Uint checked_block_position(const Uint row, const Uint col) const;
+
+  /// Pointer to the start of a block
+  Real* block(const Uint position) { return &m_values[position*m_block_size]; }
+
+  /// Write all entries as "col row value" lines, using the given sign for the row index
+  template<typename StreamT>
+  void print_entries(StreamT& stream);
+
+  /// status of the matrix
+  bool m_is_created;
+
+  /// number of equations
+  Uint m_neq;
+
+  /// number of values in a block
+  Uint m_block_size;
+
+  /// number of process-local nodes
+  Uint m_nb_nodes;
+
+  /// Storage node for each process-local node, differing from the node itself for periodic nodes
+  std::vector<Uint> m_node_map;
+
+  /// Storage nodes that are owned by this rank
+  std::vector<Uint> m_owned_nodes;
+
+  /// Ownership flag per storage node
+  std::vector<bool> m_owned;
+
+  /// Block CSR structure
+  std::vector<Uint> m_row_starts;
+  std::vector<Uint> m_columns;
+  std::vector<Real> m_values;
+  std::vector<Uint> m_diagonal_positions;
+
+  /// Copy of the node connectivity, used to apply dirichlet conditions
+  std::vector<Uint> m_node_connectivity;
+  std::vector<Uint> m_starting_indices;
+
+  /// Cache the values eliminated by symmetric_dirichlet, so they can be reapplied to a new RHS as long as the matrix is not reset.
+  /// Key is the eliminated column, value maps each row to the eliminated matrix entry
+  typedef std::map<Uint, Real> DirichletEntryT;
+  std::map<Uint, DirichletEntryT> m_symmetric_dirichlet_values;
+
+  /// Records the modifications of the values
+  detail::ChangeTracker m_values_tracker;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeCrsMatrix_hpp
@@ -0,0 +1,64 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Assertions.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+namespace detail {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint next_generation()
+{
+  static Uint generation_counter = 0;
+  return ++generation_counter;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void create_native_layout(common::PE::CommPattern& cp, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active, std::vector<Uint>& node_map, std::vector<Uint>& owned_nodes)
+{
+  const Uint nb_nodes = cp.isUpdatable().size();
+  const bool has_periodic = !periodic_links_active.empty();
+  cf3_assert(!has_periodic || periodic_links_active.size() == nb_nodes);
+  cf3_assert(periodic_links_nodes.size() == periodic_links_active.size());
+
+  node_map.resize(nb_nodes);
+  owned_nodes.clear();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(has_periodic && periodic_links_active[i])
+    {
+      Uint final_linked_node = periodic_links_nodes[i];
+      while(periodic_links_active[final_linked_node])
+        final_linked_node = periodic_links_nodes[final_linked_node];
+      cf3_assert_desc("Periodic link for node " + common::to_str(i) + " crosses process boundaries", cp.isUpdatable()[i] == cp.isUpdatable()[final_linked_node]);
+      node_map[i] = final_linked_node;
+    }
+    else
+    {
+      node_map[i] = i;
+      if(cp.isUpdatable()[i])
+        owned_nodes.push_back(i);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace detail
+} // namespace LSS
+} // namespace math
+} // namespace cf3
@@ -0,0 +1,137 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeDetail_hpp
+#define cf3_Math_LSS_NativeDetail_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/atomic.hpp>
+
+#include "common/CF.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeDetail.hpp Shared functions between the native LSS classes
+
+  The native matrix and vectors store one block of neq entries for each process-local node. Nodes that are periodically
+  linked to another node share the storage of the final node in the periodic chain, and only the nodes that are owned
+  by this rank and are not periodic have rows in the matrix and count in the global dot products.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+namespace detail {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Build the map from process-local node to storage node and the list of storage nodes owned by this rank
+void LSS_API create_native_layout(common::PE::CommPattern& cp, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active, std::vector<Uint>& node_map, std::vector<Uint>& owned_nodes);
+
+/// Number that differs from all previous results, identifying a state of the native matrices and vectors. Never zero
+Uint LSS_API next_generation();
+
+/// Tracks the changes to the values of a native matrix, so the preconditioners of the NativeStrategy are only computed again
+/// when the matrix changes
+class ChangeTracker
+{
+public:
+  ChangeTracker() : m_changed(true), m_generation(0)
+  {
+  }
+
+  /// Record a change. Safe to call from several threads at once, and cheap once the change is recorded
+  void changed()
+  {
+    if(!m_changed.load(boost::memory_order_relaxed))
+      m_changed.store(true, boost::memory_order_relaxed);
+  }
+
+  /// Identifies the current values. May not be called while the values are being changed
+  Uint generation()
+  {
+    if(m_changed.exchange(false))
+      m_generation = next_generation();
+    return m_generation;
+  }
+
+private:
+  boost::atomic<bool> m_changed;
+  Uint m_generation;
+};
+
+/// Minimal number of items per thread, below this the overhead of waking a worker is larger than the gain
+static const Uint min_items_per_thread = 1024;
+
+/// Number of threads that will actually be used to process size items
+inline Uint effective_nb_threads(const Uint size, const Uint nb_threads)
+{
+  if(nb_threads < 2)
+    return 1;
+  const Uint max_threads = size / min_items_per_thread;
+  return max_threads < 2 ? 1 : std::min(max_threads, nb_threads);
+}
+
+/// Call f(begin, end) for contiguous ranges covering [0, size), each range on its own thread of the pool.
+/// The functor may not throw
+template<typename FunctorT>
+void parallel_for(const Uint size, const common::ThreadPool& threads, const FunctorT& f)
+{
+  const Uint used_threads = effective_nb_threads(size, threads.nb_threads());
+  if(used_threads == 1)
+  {
+    f(0u, size);
+    return;
+  }
+
+  const Uint chunk = size / used_threads;
+  threads.run(used_threads, [&f, size, chunk, used_threads](const Uint i)
+  {
+    f(i*chunk, i == used_threads-1 ? size : (i+1)*chunk);
+  });
+}
+
+/// Sum the results of f(begin, end) over contiguous ranges covering [0, size), each range on its own thread of the pool.
+/// The result is independent of the thread scheduling, but depends on the number of threads used
+template<typename FunctorT>
+Real parallel_sum(const Uint size, const common::ThreadPool& threads, const FunctorT& f)
+{
+  const Uint used_threads = effective_nb_threads(size, threads.nb_threads());
+  if(used_threads == 1)
+    return f(0u, size);
+
+  std::vector<Real> partial_sums(used_threads, 0.);
+  const Uint chunk = size / used_threads;
+  threads.run(used_threads, [&f, &partial_sums, size, chunk, used_threads](const Uint i)
+  {
+    partial_sums[i] = f(i*chunk, i == used_threads-1 ? size : (i+1)*chunk);
+  });
+
+  Real result = 0.;
+  for(Uint i = 0; i != used_threads; ++i)
+    result += partial_sums[i];
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace detail
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeDetail_hpp
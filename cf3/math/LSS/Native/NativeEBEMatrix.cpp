@@ -0,0 +1,792 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "common/Action.hpp"
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PropertyList.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/LSS/Native/NativeEBEMatrix.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeEBEMatrix, LSS::Matrix, LSS::LibLSS > NativeEBEMatrix_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeEBEMatrix::NativeEBEMatrix(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0),
+  m_nb_nodes(0),
+  m_has_periodic_nodes(false),
+  m_evaluation(NO_EVALUATION),
+  m_x(0),
+  m_y(0),
+  m_alpha(0.),
+  m_blocks(0),
+  m_rows(0)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.NativeVector"));
+
+  options().add("assembly_actions", std::vector<common::URI>())
+    .pretty_name("Assembly Actions")
+    .description("Actions that are executed to evaluate the operator, usually the assembly actions of the system. Their RHS contributions are skipped. "
+                 "They are run for each product, so they may only assemble element matrices: boundary conditions and other modifications of the system must be separate actions")
+    .attach_trigger(boost::bind(&NativeEBEMatrix::trigger_assembly_actions, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  m_neq = neq;
+  m_nb_nodes = cp.isUpdatable().size();
+  cf3_assert(starting_indices.size() == m_nb_nodes+1);
+
+  detail::create_native_layout(cp, periodic_links_nodes, periodic_links_active, m_node_map, m_owned_nodes);
+  m_has_periodic_nodes = false;
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    if(m_node_map[i] != i)
+      m_has_periodic_nodes = true;
+  }
+  m_owned.assign(m_nb_nodes, false);
+  BOOST_FOREACH(const Uint node, m_owned_nodes)
+    m_owned[node] = true;
+
+  m_is_created = true;
+  reset();
+  sparsity_changed();
+  m_values_tracker.changed();
+  CFdebug << "Rank " << common::PE::Comm::instance().rank() << ": Created a native element-by-element matrix with block size " << m_neq << " and " << m_owned_nodes.size() << " local block rows" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), node_connectivity, starting_indices, solution, rhs, periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::destroy()
+{
+  m_node_map.clear();
+  m_has_periodic_nodes = false;
+  m_owned_nodes.clear();
+  m_owned.clear();
+  m_diagonal_shift.clear();
+  m_replaced_rows.clear();
+  m_replaced_diagonal.clear();
+  m_eliminated_columns.clear();
+  m_eliminated_dofs.clear();
+  m_eliminated_values.clear();
+  m_pending_columns.clear();
+  m_pending_values.clear();
+  m_pending_rhs = Handle<NativeVector>();
+  m_neq=0;
+  m_nb_nodes=0;
+  m_is_created=false;
+  sparsity_changed();
+  m_values_tracker.changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  throw common::NotSupported(FromHere(), "NativeEBEMatrix does not support setting individual entries");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  throw common::NotSupported(FromHere(), "NativeEBEMatrix does not support adding to individual entries, use add_values with an element matrix");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  value = 0.;
+  const Uint row = m_node_map[irow/m_neq];
+  if(!m_owned[row])
+    return;
+
+  std::vector< std::map< Uint, std::vector<Real> > > rows;
+  row_blocks(rows);
+  std::map< Uint, std::vector<Real> >::const_iterator found = rows[row].find(m_node_map[icol/m_neq]);
+  if(found != rows[row].end())
+    value = found->second[(irow%m_neq)*m_neq + icol%m_neq];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::set_values(const BlockAccumulator& values)
+{
+  throw common::NotSupported(FromHere(), "NativeEBEMatrix does not support setting values, use add_values with an element matrix");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::add_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  if(m_evaluation == NO_EVALUATION)
+  {
+    // The element matrices are not stored, but a new assembly may change the operator
+    m_values_tracker.changed();
+    return;
+  }
+
+  const Uint nb_nodes = values.indices.size();
+  const Uint nb_cols = nb_nodes*m_neq;
+  cf3_assert(values.mat.rows() == nb_cols);
+  cf3_assert(values.mat.cols() == nb_cols);
+
+  boost::mutex::scoped_lock lock(m_mutex, boost::defer_lock);
+  if(m_has_periodic_nodes)
+    lock.lock();
+
+  // The accumulator is row-major
+  const Real* mat = values.mat.data();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    if(!m_owned[row])
+      continue;
+
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      const Uint row_dof = dof(row, a);
+      if(m_evaluation == PRODUCT && m_replaced_rows[row_dof])
+        continue;
+      const Real* mat_row = mat + (i*m_neq + a)*nb_cols;
+      if(m_evaluation == PRODUCT)
+      {
+        Real sum = 0.;
+        for(Uint j = 0; j != nb_nodes; ++j)
+        {
+          const Real* x_block = m_x + m_node_map[values.indices[j]]*m_neq;
+          for(Uint b = 0; b != m_neq; ++b)
+            sum += mat_row[j*m_neq+b] * x_block[b];
+        }
+        m_y[row_dof] += m_alpha*sum;
+      }
+      else if(m_evaluation == DIAGONAL)
+      {
+        // Periodic nodes can appear more than once in the element
+        Real* diag_row = m_blocks + row_dof*m_neq;
+        for(Uint j = 0; j != nb_nodes; ++j)
+        {
+          if(m_node_map[values.indices[j]] != row)
+            continue;
+          for(Uint b = 0; b != m_neq; ++b)
+            diag_row[b] += mat_row[j*m_neq+b];
+        }
+      }
+      else
+      {
+        std::map< Uint, std::vector<Real> >& columns = (*m_rows)[row];
+        for(Uint j = 0; j != nb_nodes; ++j)
+        {
+          std::vector<Real>& block = columns[m_node_map[values.indices[j]]];
+          block.resize(m_neq*m_neq, 0.);
+          for(Uint b = 0; b != m_neq; ++b)
+            block[a*m_neq+b] += mat_row[j*m_neq+b];
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::get_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  values.mat.setZero();
+  const Uint nb_nodes = values.indices.size();
+  cf3_assert(values.mat.rows() == nb_nodes*m_neq);
+  std::vector< std::map< Uint, std::vector<Real> > > rows;
+  row_blocks(rows);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[values.indices[i]];
+    if(!m_owned[row])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      std::map< Uint, std::vector<Real> >::const_iterator found = rows[row].find(m_node_map[values.indices[j]]);
+      if(found == rows[row].end())
+        continue;
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          values.mat(i*m_neq+a, j*m_neq+b) = found->second[a*m_neq+b];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  check_not_evaluating("set_row");
+  cf3_assert(m_is_created);
+  if(offdiagval != 0.)
+    throw common::NotSupported(FromHere(), "NativeEBEMatrix can only replace a row with a diagonal entry");
+
+  const Uint row = m_node_map[iblockrow];
+  if(!m_owned[row])
+    return;
+  m_values_tracker.changed();
+  m_replaced_rows[dof(row, ieq)] = true;
+  m_replaced_diagonal[dof(row, ieq)] = diagval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  throw common::NotSupported(FromHere(), "NativeEBEMatrix does not support get_column_and_replace_to_zero, use symmetric_dirichlet");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  check_not_evaluating("symmetric_dirichlet");
+  cf3_assert(m_is_created);
+  Handle<NativeVector> native_rhs(rhs.handle());
+  if(is_null(native_rhs))
+    throw common::SetupError(FromHere(), "symmetric_dirichlet method of NativeEBEMatrix needs a NativeVector RHS");
+  if(is_not_null(m_pending_rhs) && m_pending_rhs != native_rhs)
+    throw common::SetupError(FromHere(), "All dirichlet conditions on " + uri().path() + " must use the same RHS until eliminate_dirichlet_columns is called");
+
+  // The column is moved to the RHS later, since that needs an evaluation of the operator
+  const Uint col_dof = dof(m_node_map[blockrow], ieq);
+  if(!m_eliminated_columns[col_dof])
+  {
+    m_values_tracker.changed();
+    m_eliminated_columns[col_dof] = true;
+    m_eliminated_dofs.push_back(col_dof);
+    m_eliminated_values.push_back(0.);
+  }
+  m_pending_columns.push_back(col_dof);
+  m_pending_values.push_back(value);
+  m_pending_rhs = native_rhs;
+
+  if(m_owned[m_node_map[blockrow]])
+    set_row(blockrow, ieq, 1., 0.);
+
+  rhs.set_value(blockrow, ieq, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  throw common::NotSupported(FromHere(), "NativeEBEMatrix does not support tie_blockrow_pairs, pass the periodic links when creating the system");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::set_diagonal(const std::vector<Real>& diag)
+{
+  check_not_evaluating("set_diagonal");
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  cf3_assert(diag.size() == m_nb_nodes*m_neq);
+  std::vector<Real> blocks;
+  diagonal_blocks(blocks);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      const Uint row_dof = dof(row, a);
+      if(m_replaced_rows[row_dof])
+        m_replaced_diagonal[row_dof] = diag[i*m_neq+a];
+      else
+        m_diagonal_shift[row_dof] += diag[i*m_neq+a] - blocks[row*m_neq*m_neq + a*m_neq + a];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::add_diagonal(const std::vector<Real>& diag)
+{
+  check_not_evaluating("add_diagonal");
+  cf3_assert(m_is_created);
+  m_values_tracker.changed();
+  cf3_assert(diag.size() == m_nb_nodes*m_neq);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      const Uint row_dof = dof(row, a);
+      if(m_replaced_rows[row_dof])
+        m_replaced_diagonal[row_dof] += diag[i*m_neq+a];
+      else
+        m_diagonal_shift[row_dof] += diag[i*m_neq+a];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  std::vector<Real> blocks;
+  diagonal_blocks(blocks);
+  diag.assign(m_nb_nodes*m_neq, 0.);
+  for(Uint i = 0; i != m_nb_nodes; ++i)
+  {
+    const Uint row = m_node_map[i];
+    if(!m_owned[row])
+      continue;
+    for(Uint a = 0; a != m_neq; ++a)
+      diag[i*m_neq+a] = blocks[row*m_neq*m_neq + a*m_neq + a];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::reset(Real reset_to)
+{
+  check_not_evaluating("reset");
+  cf3_assert(m_is_created);
+  if(reset_to != 0.)
+    throw common::NotSupported(FromHere(), "NativeEBEMatrix can only be reset to zero");
+
+  m_values_tracker.changed();
+  const Uint nb_dofs = m_nb_nodes*m_neq;
+  m_diagonal_shift.assign(nb_dofs, 0.);
+  m_replaced_rows.assign(nb_dofs, false);
+  m_replaced_diagonal.assign(nb_dofs, 0.);
+  m_eliminated_columns.assign(nb_dofs, false);
+  m_eliminated_dofs.clear();
+  m_eliminated_values.clear();
+  m_pending_columns.clear();
+  m_pending_values.clear();
+  m_pending_rhs = Handle<NativeVector>();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::clone_to(Matrix &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Matrix to clone " + uri().string() + " is not created");
+
+  NativeEBEMatrix* other_ptr = dynamic_cast<NativeEBEMatrix*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeEBEMatrix needs another NativeEBEMatrix, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->m_is_created = m_is_created;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_nb_nodes = m_nb_nodes;
+  other_ptr->m_node_map = m_node_map;
+  other_ptr->m_has_periodic_nodes = m_has_periodic_nodes;
+  other_ptr->m_owned_nodes = m_owned_nodes;
+  other_ptr->m_owned = m_owned;
+  other_ptr->m_assembly = m_assembly;
+  other_ptr->m_diagonal_shift = m_diagonal_shift;
+  other_ptr->m_replaced_rows = m_replaced_rows;
+  other_ptr->m_replaced_diagonal = m_replaced_diagonal;
+  other_ptr->m_eliminated_columns = m_eliminated_columns;
+  other_ptr->m_eliminated_dofs = m_eliminated_dofs;
+  other_ptr->m_eliminated_values = m_eliminated_values;
+  other_ptr->m_pending_columns = m_pending_columns;
+  other_ptr->m_pending_values = m_pending_values;
+  other_ptr->m_pending_rhs = m_pending_rhs;
+  other_ptr->sparsity_changed();
+  other_ptr->m_values_tracker.changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::set_assembly(const boost::function<void ()>& assembly)
+{
+  check_not_evaluating("set_assembly");
+  m_assembly = assembly;
+  m_values_tracker.changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::trigger_assembly_actions()
+{
+  const std::vector<common::URI> action_uris = options().value< std::vector<common::URI> >("assembly_actions");
+  std::vector< Handle<common::Action> > actions;
+  BOOST_FOREACH(const common::URI& action_uri, action_uris)
+  {
+    Handle<common::Action> action(access_component_checked(action_uri));
+    if(is_null(action))
+      throw common::SetupError(FromHere(), "Component " + action_uri.string() + " used as assembly action for " + uri().path() + " is not an Action");
+    actions.push_back(action);
+  }
+
+  set_assembly([actions]()
+  {
+    BOOST_FOREACH(const Handle<common::Action>& action, actions)
+      action->execute();
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::evaluate(const EvaluationT evaluation) const
+{
+  if(m_assembly.empty())
+    throw common::SetupError(FromHere(), "No assembly function for the matrix-free " + uri().path() + ", set the assembly_actions option");
+
+  // add_values is not const, but only modifies the evaluation results
+  m_evaluation = evaluation;
+  try
+  {
+    m_assembly();
+  }
+  catch(...)
+  {
+    m_evaluation = NO_EVALUATION;
+    throw;
+  }
+  m_evaluation = NO_EVALUATION;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::check_not_evaluating(const std::string& what) const
+{
+  if(m_evaluation != NO_EVALUATION)
+    throw common::SetupError(FromHere(), what + " called on the matrix-free " + uri().path() + " while evaluating the operator. The assembly actions may only assemble element matrices, "
+                                         "boundary conditions and other modifications of the system must run separately");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeEBEMatrix::storage_size() const
+{
+  return (m_diagonal_shift.size() + m_replaced_diagonal.size() + m_eliminated_values.size() + m_pending_values.size())*sizeof(Real)
+    + (m_node_map.size() + m_owned_nodes.size() + m_eliminated_dofs.size() + m_pending_columns.size())*sizeof(Uint)
+    + (m_owned.size() + m_replaced_rows.size() + m_eliminated_columns.size() + 7) / 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::row_blocks(std::vector< std::map< Uint, std::vector<Real> > >& rows) const
+{
+  rows.assign(m_nb_nodes, std::map< Uint, std::vector<Real> >());
+  m_rows = &rows;
+  evaluate(ROWS);
+
+  const Uint block_size = m_neq*m_neq;
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+  {
+    std::map< Uint, std::vector<Real> >& columns = rows[row];
+    for(std::map< Uint, std::vector<Real> >::iterator it = columns.begin(); it != columns.end(); ++it)
+    {
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        for(Uint b = 0; b != m_neq; ++b)
+        {
+          if(m_replaced_rows[dof(row, a)] || m_eliminated_columns[dof(it->first, b)])
+            it->second[a*m_neq+b] = 0.;
+        }
+      }
+    }
+
+    // Diagonal, which is always present
+    std::vector<Real>& diag_block = columns[row];
+    diag_block.resize(block_size, 0.);
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      const Uint row_dof = dof(row, a);
+      if(m_replaced_rows[row_dof])
+        diag_block[a*m_neq+a] = m_replaced_diagonal[row_dof];
+      else
+        diag_block[a*m_neq+a] += m_diagonal_shift[row_dof];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::diagonal_blocks(std::vector<Real>& blocks, const common::ThreadPool& threads) const
+{
+  cf3_assert(m_is_created);
+
+  const Uint neq = m_neq;
+  const Uint block_size = neq*neq;
+  blocks.assign(m_nb_nodes*block_size, 0.);
+  m_blocks = blocks.data();
+  evaluate(DIAGONAL);
+
+  const Uint* owned = m_owned_nodes.data();
+  const std::vector<bool>& replaced_rows = m_replaced_rows;
+  const std::vector<bool>& eliminated_columns = m_eliminated_columns;
+  const Real* replaced_diagonal = m_replaced_diagonal.data();
+  const Real* diagonal_shift = m_diagonal_shift.data();
+  Real* block_data = blocks.data();
+
+  detail::parallel_for(m_owned_nodes.size(), threads, [=, &replaced_rows, &eliminated_columns](const Uint begin, const Uint end)
+  {
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint row = owned[i];
+      Real* diag_block = block_data + row*block_size;
+      for(Uint a = 0; a != neq; ++a)
+      {
+        const Uint row_dof = row*neq+a;
+        if(replaced_rows[row_dof])
+        {
+          for(Uint b = 0; b != neq; ++b)
+            diag_block[a*neq+b] = 0.;
+          diag_block[a*neq+a] = replaced_diagonal[row_dof];
+          continue;
+        }
+        for(Uint b = 0; b != neq; ++b)
+        {
+          if(eliminated_columns[row*neq+b])
+            diag_block[a*neq+b] = 0.;
+        }
+        diag_block[a*neq+a] += diagonal_shift[row_dof];
+      }
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Write all entries as "col row value" lines, in the same format as the NativeCrsMatrix
+template<typename StreamT>
+void print_entries(StreamT& stream, NativeEBEMatrix& matrix, const Uint nb_rows, const Uint nb_cols)
+{
+  std::vector<Uint> rows, cols;
+  std::vector<Real> values;
+  matrix.debug_data(rows, cols, values);
+  for(Uint i = 0; i != values.size(); ++i)
+    stream << cols[i] << " " << -(int)rows[i] << " " << values[i] << "\n";
+  stream << "# name:                 " << matrix.name() << "\n";
+  stream << "# type_name:            " << matrix.type_name() << "\n";
+  stream << "# process:              " << common::PE::Comm::instance().rank() << "\n";
+  stream << "# number of equations:  " << matrix.neq() << "\n";
+  stream << "# number of rows:       " << nb_rows*matrix.neq() << "\n";
+  stream << "# number of cols:       " << nb_cols*matrix.neq() << "\n";
+  stream << "# number of block rows: " << nb_rows << "\n";
+  stream << "# number of block cols: " << nb_cols << "\n";
+  stream << "# number of entries:    " << values.size() << "\n";
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    print_entries(stream, *this, m_owned_nodes.size(), m_nb_nodes);
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    print_entries(stream, *this, m_owned_nodes.size(), m_nb_nodes);
+    stream << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::print(const std::string& filename, std::ios_base::openmode mode )
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::print_native(std::ostream& stream)
+{
+  print(stream);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  row_indices.clear(); col_indices.clear(); values.clear();
+  std::vector< std::map< Uint, std::vector<Real> > > rows;
+  row_blocks(rows);
+  BOOST_FOREACH(const Uint row, m_owned_nodes)
+  {
+    const std::map< Uint, std::vector<Real> >& columns = rows[row];
+    for(std::map< Uint, std::vector<Real> >::const_iterator it = columns.begin(); it != columns.end(); ++it)
+    {
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        for(Uint b = 0; b != m_neq; ++b)
+        {
+          row_indices.push_back(row*m_neq+a);
+          col_indices.push_back(it->first*m_neq+b);
+          values.push_back(it->second[a*m_neq+b]);
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::multiply(NativeVector& x, NativeVector& y, const common::ThreadPool& threads, const Real alpha, const Real beta) const
+{
+  cf3_assert(m_is_created);
+  cf3_assert(x.data().size() == m_nb_nodes*m_neq);
+  cf3_assert(y.data().size() == m_nb_nodes*m_neq);
+
+  x.sync();
+
+  // Scale y and add the diagonal modifications, the element contributions are added by the evaluation
+  const Uint neq = m_neq;
+  const Uint* owned = m_owned_nodes.data();
+  const std::vector<bool>& replaced_rows = m_replaced_rows;
+  const std::vector<bool>& eliminated_columns = m_eliminated_columns;
+  const Real* replaced_diagonal = m_replaced_diagonal.data();
+  const Real* diagonal_shift = m_diagonal_shift.data();
+  Real* x_data = x.data().data();
+  Real* y_data = y.data().data();
+
+  detail::parallel_for(m_owned_nodes.size(), threads, [=, &replaced_rows, &eliminated_columns](const Uint begin, const Uint end)
+  {
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint row = owned[i];
+      for(Uint a = 0; a != neq; ++a)
+      {
+        const Uint row_dof = row*neq+a;
+        Real& result = y_data[row_dof];
+        result = beta == 0. ? 0. : beta*result;
+        if(replaced_rows[row_dof])
+          result += alpha*replaced_diagonal[row_dof]*x_data[row_dof];
+        else if(!eliminated_columns[row_dof])
+          result += alpha*diagonal_shift[row_dof]*x_data[row_dof];
+      }
+    }
+  });
+
+  // The element matrices still contain the eliminated columns, so they are multiplied with zero instead
+  const Uint nb_eliminated = m_eliminated_dofs.size();
+  for(Uint i = 0; i != nb_eliminated; ++i)
+  {
+    m_eliminated_values[i] = x_data[m_eliminated_dofs[i]];
+    x_data[m_eliminated_dofs[i]] = 0.;
+  }
+
+  m_x = x_data;
+  m_y = y_data;
+  m_alpha = alpha;
+  try
+  {
+    evaluate(PRODUCT);
+  }
+  catch(...)
+  {
+    for(Uint i = 0; i != nb_eliminated; ++i)
+      x_data[m_eliminated_dofs[i]] = m_eliminated_values[i];
+    throw;
+  }
+
+  for(Uint i = 0; i != nb_eliminated; ++i)
+    x_data[m_eliminated_dofs[i]] = m_eliminated_values[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::eliminate_dirichlet_columns()
+{
+  cf3_assert(m_is_created);
+  if(is_null(m_pending_rhs))
+    return;
+
+  // rhs -= A*g for the rows that are not replaced, with g the dirichlet values of the pending columns and zero elsewhere
+  std::vector<Real> dirichlet_values(m_nb_nodes*m_neq, 0.);
+  const Uint nb_pending = m_pending_columns.size();
+  for(Uint i = 0; i != nb_pending; ++i)
+    dirichlet_values[m_pending_columns[i]] = m_pending_values[i];
+
+  m_x = dirichlet_values.data();
+  m_y = m_pending_rhs->data().data();
+  m_alpha = -1.;
+  evaluate(PRODUCT);
+
+  m_pending_columns.clear();
+  m_pending_values.clear();
+  m_pending_rhs = Handle<NativeVector>();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeEBEMatrix::apply(const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha, const Real beta)
+{
+  Handle<NativeVector> y_native(y);
+  Handle<NativeVector const> x_native(x);
+  if(is_null(y_native) || is_null(x_native))
+    throw common::SetupError(FromHere(), "apply method of NativeEBEMatrix needs NativeVector arguments");
+
+  // Only the ghost values of x are updated, the eliminated columns are restored after the product
+  multiply(const_cast<NativeVector&>(*x_native), *y_native, common::ThreadPool::serial(), alpha, beta);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
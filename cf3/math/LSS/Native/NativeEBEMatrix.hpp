@@ -0,0 +1,318 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeEBEMatrix_hpp
+#define cf3_Math_LSS_NativeEBEMatrix_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "common/PE/CommPattern.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Matrix.hpp"
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/VariablesDescriptor.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeEBEMatrix.hpp Matrix-free implementation of the LSS::Matrix interface
+
+  The global matrix is never assembled and no element matrix is stored. Instead, the matrix is given an assembly
+  function that computes all element matrices and passes them to add_values. It is set with set_assembly, or with the
+  assembly_actions option listing the Proto actions that assemble the system matrix. Each matrix-vector product runs the assembly once, and add_values adds the product
+  of the element matrix with the element values of x to the rows of y. Enabling the geometry cache of the elements
+  keeps the jacobians and shape function gradients between the evaluations, so only the element matrices themselves
+  are recomputed. The diagonal, needed by the Jacobi and Chebyshev preconditioners, is obtained in the same way.
+  Outside of these evaluations, add_values does nothing, so the regular assembly of the system costs nothing either.
+
+  The storage is two values per equation for the diagonal modifications, the node layout and a few values per
+  dirichlet condition. The price is one evaluation of the operator per product. The assembly function may be the regular
+  assembly of the system: the Proto element loops skip their RHS contributions while the matrix is evaluating, so the
+  RHS is only assembled when the actions run as part of the solver. It must be a pure system assembly though, since it
+  is run again for each product: boundary conditions, diagonal modifications and field updates belong in separate actions.
+  Modifying the matrix in any other way than through add_values during an evaluation throws a SetupError.
+
+  add_values may be called from several threads at once, as long as the concurrent calls don't share a node. The
+  colored element loops of Proto guarantee this. Periodic nodes map to the same row, so in that case the calls are
+  serialized by a mutex.
+
+  Dirichlet conditions are stored as replaced rows and eliminated columns. Moving the eliminated columns to the RHS
+  needs an evaluation of the operator, so symmetric_dirichlet only records the value and eliminate_dirichlet_columns
+  moves all of them at once. The NativeStrategy calls it before solving.
+  Operations that modify individual entries are not supported.
+
+  The matrix works with the native vectors and with the Krylov solvers and the Jacobi and Chebyshev preconditioners
+  of the NativeStrategy.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+class NativeVector;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeEBEMatrix : public LSS::Matrix {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeEBEMatrix"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// Accessor to the flag if matrix, solution and rhs are tied together or not
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return true; }
+
+  /// Default constructor
+  NativeEBEMatrix(const std::string& name);
+
+  /// Setup the layout. The node connectivity is not needed, since the coupling follows from the element matrices
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// The storage is always per node, so this is the same as create with neq equal to the size of vars
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Not supported, throws NotSupported
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Not supported, throws NotSupported
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Get value at given location in the matrix, evaluating the operator. Rows that are not owned by this rank return zero
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Not supported, throws NotSupported
+  void set_values(const BlockAccumulator& values);
+
+  /// Apply an element matrix to the evaluation that is in progress, and do nothing outside of an evaluation.
+  /// Safe to call from several threads at once for elements that have no node in common
+  void add_values(const BlockAccumulator& values);
+
+  /// Get a list of values, evaluating the operator
+  void get_values(BlockAccumulator& values);
+
+  /// Replace a row by a diagonal entry. Only a zero offdiagval is supported
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Not supported, throws NotSupported
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  /// Apply a dirichlet boundary condition, preserving symmetry by moving the column to the RHS. The column is only moved
+  /// by the next call to eliminate_dirichlet_columns
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs);
+
+  /// Not supported, throws NotSupported. Periodic links passed to create are supported
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Set the diagonal
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Get the diagonal
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Remove the diagonal modifications and boundary conditions. The assembly function is kept. Only resetting to zero is supported
+  void reset(Real reset_to=0.);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  /// There are no stored values, so this prints the entries like print
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { return m_neq; }
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { return m_nb_nodes; }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { return m_nb_nodes; }
+
+  void clone_to(Matrix& other);
+
+  //@} END MISCELLANEOUS
+
+  /// @name LINEAR ALGEBRA
+  //@{
+
+  void apply(const Handle< Vector >& y, const Handle< Vector const >& x, const Real alpha = 1., const Real beta = 0.);
+
+  //@} END LINEAR ALGEBRA
+
+  /// @name NATIVE ACCESS
+  /// @attention these functions are not part of the interface, they are used between the native classes
+  //@{
+
+  /// Set the function that passes all element matrices to add_values. It is called once for each evaluation of the operator
+  void set_assembly(const boost::function<void ()>& assembly);
+
+  /// Compute y = alpha*A*x + beta*y for the owned rows, evaluating the operator once. The threads of the pool are used for the
+  /// row updates, the assembly function uses its own threads. The ghosts of x are updated first
+  void multiply(NativeVector& x, NativeVector& y, const common::ThreadPool& threads = common::ThreadPool::serial(), const Real alpha = 1., const Real beta = 0.) const;
+
+  /// Diagonal blocks of the owned rows, row-major and indexed by storage node, evaluating the operator once
+  void diagonal_blocks(std::vector<Real>& blocks, const common::ThreadPool& threads = common::ThreadPool::serial()) const;
+
+  /// Move the columns eliminated by symmetric_dirichlet since the last call to the RHS that was passed to it, evaluating the operator once
+  void eliminate_dirichlet_columns();
+
+  /// Storage nodes that have a row in this matrix
+  const std::vector<Uint>& owned_nodes() const { return m_owned_nodes; }
+
+  /// True while the assembly function runs to evaluate the operator. Contributions to the RHS must be skipped then
+  bool is_evaluating() const { return m_evaluation != NO_EVALUATION; }
+
+  /// Bytes used by the node layout, the diagonal modifications and the boundary conditions
+  Uint storage_size() const;
+
+  /// Identifies the current operator. It changes when the diagonal or the boundary conditions are modified, and each time
+  /// the regular assembly passes element matrices to add_values, since these may differ from the previous ones. May not
+  /// be called during an assembly
+  Uint values_generation() { return m_values_tracker.generation(); }
+
+  //@} END NATIVE ACCESS
+
+  /// @name TEST ONLY
+  //@{
+
+  /// exports the matrix into big linear arrays, in the same order as the NativeCrsMatrix
+  /// @attention only for debug and utest purposes
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+
+  /// What add_values does with the element matrices during an evaluation of the operator
+  enum EvaluationT { NO_EVALUATION, PRODUCT, DIAGONAL, ROWS };
+
+  /// Run the assembly function, with add_values doing the given evaluation
+  void evaluate(const EvaluationT evaluation) const;
+
+  /// Dense blocks of all owned rows, keyed by storage column. Replaced rows and eliminated columns are taken into account
+  void row_blocks(std::vector< std::map< Uint, std::vector<Real> > >& rows) const;
+
+  /// Trigger for the assembly_actions option
+  void trigger_assembly_actions();
+
+  /// Throw if the operator is being evaluated. The assembly may only pass element matrices to add_values, since anything else
+  /// it modifies would be modified again by each product
+  void check_not_evaluating(const std::string& what) const;
+
+  /// Storage index of a row or column
+  Uint dof(const Uint node, const Uint eq) const { return node*m_neq + eq; }
+
+  /// status of the matrix
+  bool m_is_created;
+
+  /// number of equations
+  Uint m_neq;
+
+  /// number of process-local nodes
+  Uint m_nb_nodes;
+
+  /// Storage node for each process-local node, differing from the node itself for periodic nodes
+  std::vector<Uint> m_node_map;
+
+  /// True if some process-local nodes share a storage node
+  bool m_has_periodic_nodes;
+
+  /// Storage nodes that are owned by this rank
+  std::vector<Uint> m_owned_nodes;
+
+  /// Ownership flag per storage node
+  std::vector<bool> m_owned;
+
+  /// Computes all element matrices and passes them to add_values
+  boost::function<void ()> m_assembly;
+
+  /// Diagonal added to the element contributions, per storage dof
+  std::vector<Real> m_diagonal_shift;
+
+  /// Rows replaced by set_row, with their diagonal value, per storage dof
+  std::vector<bool> m_replaced_rows;
+  std::vector<Real> m_replaced_diagonal;
+
+  /// Columns eliminated by symmetric_dirichlet, as flag per storage dof and as list
+  std::vector<bool> m_eliminated_columns;
+  std::vector<Uint> m_eliminated_dofs;
+
+  /// Columns that still need to be moved to the RHS, with their value
+  std::vector<Uint> m_pending_columns;
+  std::vector<Real> m_pending_values;
+  Handle<NativeVector> m_pending_rhs;
+
+  /// Values of x in the eliminated columns, which multiply sets to zero during the evaluation
+  mutable std::vector<Real> m_eliminated_values;
+
+  /// State of the evaluation that is in progress. add_values computes y += alpha*A*x for a product, adds the diagonal blocks
+  /// to blocks or adds the row blocks to rows
+  mutable EvaluationT m_evaluation;
+  mutable const Real* m_x;
+  mutable Real* m_y;
+  mutable Real m_alpha;
+  mutable Real* m_blocks;
+  mutable std::vector< std::map< Uint, std::vector<Real> > >* m_rows;
+
+  /// Serializes add_values when there are periodic nodes
+  boost::mutex m_mutex;
+
+  /// Records the modifications of the operator
+  detail::ChangeTracker m_values_tracker;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeEBEMatrix_hpp
@@ -0,0 +1,886 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <map>
+
+#include <boost/assign/std/vector.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/LSS/Native/NativeEBEMatrix.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+using namespace boost::assign; // bring 'operator+=()' into scope
+
+common::ComponentBuilder<NativeStrategy, SolutionStrategy, LibLSS> NativeStrategy_builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+typedef Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> BlockT;
+typedef Eigen::Map<BlockT> BlockMapT;
+typedef Eigen::Map<BlockT const> ConstBlockMapT;
+typedef Eigen::Map<RealVector> VectorMapT;
+typedef Eigen::Map<RealVector const> ConstVectorMapT;
+
+/// Invert a diagonal block in place, falling back to the identity for singular blocks
+void invert_block(Real* block_values, const Uint neq)
+{
+  BlockMapT block(block_values, neq, neq);
+  Eigen::FullPivLU<BlockT> lu(block);
+  if(lu.isInvertible())
+    block = lu.inverse();
+  else
+    block.setIdentity();
+}
+
+/// Vector operations restricted to the owned entries
+struct VectorOps
+{
+  VectorOps(const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& thread_pool) :
+    owned(layout.owned_nodes()),
+    neq(nb_eq),
+    threads(thread_pool)
+  {
+  }
+
+  /// y = a*x + b*y
+  void axpby(const Real a, const NativeVector& x, const Real b, NativeVector& y) const
+  {
+    const Uint* owned_nodes = owned.data();
+    const Uint nb_eq = neq;
+    const Real* x_data = x.data().data();
+    Real* y_data = y.data().data();
+    detail::parallel_for(owned.size(), threads, [=](const Uint begin, const Uint end)
+    {
+      for(Uint i = begin; i != end; ++i)
+      {
+        const Uint offset = owned_nodes[i]*nb_eq;
+        for(Uint j = 0; j != nb_eq; ++j)
+          y_data[offset+j] = a*x_data[offset+j] + (b == 0. ? 0. : b*y_data[offset+j]);
+      }
+    });
+  }
+
+  /// Global dot product
+  Real dot(const NativeVector& x, const NativeVector& y) const
+  {
+    return x.dot(y, threads);
+  }
+
+  Real norm2(const NativeVector& x) const
+  {
+    return x.norm2(threads);
+  }
+
+  const std::vector<Uint>& owned;
+  const Uint neq;
+  const common::ThreadPool& threads;
+};
+
+/// Matrix-vector product and diagonal of the supported native matrix types. Exactly one of the handles is set
+struct NativeOperator
+{
+  bool is_set() const
+  {
+    return is_not_null(crs) || is_not_null(ebe);
+  }
+
+  /// y = alpha*A*x + beta*y
+  void multiply(NativeVector& x, NativeVector& y, const common::ThreadPool& threads, const Real alpha = 1., const Real beta = 0.) const
+  {
+    if(is_not_null(crs))
+      crs->multiply(x, y, threads, alpha, beta);
+    else
+      ebe->multiply(x, y, threads, alpha, beta);
+  }
+
+  /// Diagonal blocks indexed by storage node
+  void diagonal_blocks(std::vector<Real>& blocks, const common::ThreadPool& threads) const
+  {
+    if(is_not_null(crs))
+      crs->diagonal_blocks(blocks, threads);
+    else
+      ebe->diagonal_blocks(blocks, threads);
+  }
+
+  /// Identifies the current values of the matrix
+  Uint values_generation() const
+  {
+    return is_not_null(crs) ? crs->values_generation() : ebe->values_generation();
+  }
+
+  Handle<NativeCrsMatrix> crs;
+  Handle<NativeEBEMatrix> ebe;
+};
+
+/// Base class for the preconditioners
+struct Preconditioner
+{
+  virtual ~Preconditioner() {}
+
+  /// Compute the preconditioner for the given matrix. Layout is a vector with the layout of the system
+  virtual void setup(const NativeOperator& matrix, const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& threads) = 0;
+
+  /// Compute z = M^-1 r for the owned entries
+  virtual void apply(const NativeVector& r, NativeVector& z, const common::ThreadPool& threads) const = 0;
+};
+
+/// No preconditioning
+struct IdentityPreconditioner : Preconditioner
+{
+  virtual void setup(const NativeOperator& matrix, const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& threads)
+  {
+    neq = nb_eq;
+  }
+
+  virtual void apply(const NativeVector& r, NativeVector& z, const common::ThreadPool& threads) const
+  {
+    VectorOps(r, neq, threads).axpby(1., r, 0., z);
+  }
+
+  Uint neq;
+};
+
+/// Scale with the inverse of the diagonal, or with the inverse of the diagonal blocks if use_blocks is true
+struct JacobiPreconditioner : Preconditioner
+{
+  JacobiPreconditioner(const bool blocks) : use_blocks(blocks)
+  {
+  }
+
+  virtual void setup(const NativeOperator& matrix, const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& threads)
+  {
+    neq = nb_eq;
+    matrix.diagonal_blocks(inverse_diagonal, threads);
+    const std::vector<Uint>& owned = layout.owned_nodes();
+    Real* inv_diag = inverse_diagonal.data();
+    const Uint* owned_nodes = owned.data();
+    const bool blocks = use_blocks;
+    detail::parallel_for(owned.size(), threads, [=](const Uint begin, const Uint end)
+    {
+      for(Uint i = begin; i != end; ++i)
+      {
+        const Uint row = owned_nodes[i];
+        Real* inv_block = inv_diag + row*nb_eq*nb_eq;
+        if(blocks)
+        {
+          invert_block(inv_block, nb_eq);
+        }
+        else
+        {
+          // Only the diagonal of each block is used
+          for(Uint a = 0; a != nb_eq; ++a)
+          {
+            const Real d = inv_block[a*nb_eq+a];
+            inv_block[a*nb_eq+a] = d == 0. ? 1. : 1./d;
+          }
+        }
+      }
+    });
+  }
+
+  virtual void apply(const NativeVector& r, NativeVector& z, const common::ThreadPool& threads) const
+  {
+    const std::vector<Uint>& owned = r.owned_nodes();
+    const Uint* owned_nodes = owned.data();
+    const Uint nb_eq = neq;
+    const bool blocks = use_blocks;
+    const Real* inv_diag = inverse_diagonal.data();
+    const Real* r_data = r.data().data();
+    Real* z_data = z.data().data();
+    detail::parallel_for(owned.size(), threads, [=](const Uint begin, const Uint end)
+    {
+      for(Uint i = begin; i != end; ++i)
+      {
+        const Uint row = owned_nodes[i];
+        const Real* inv_block = inv_diag + row*nb_eq*nb_eq;
+        const Real* r_block = r_data + row*nb_eq;
+        Real* z_block = z_data + row*nb_eq;
+        for(Uint a = 0; a != nb_eq; ++a)
+        {
+          if(blocks)
+          {
+            Real sum = 0.;
+            for(Uint b = 0; b != nb_eq; ++b)
+              sum += inv_block[a*nb_eq+b]*r_block[b];
+            z_block[a] = sum;
+          }
+          else
+          {
+            z_block[a] = inv_block[a*nb_eq+a]*r_block[a];
+          }
+        }
+      }
+    });
+  }
+
+  const bool use_blocks;
+  Uint neq;
+  std::vector<Real> inverse_diagonal;
+};
+
+/// Block ILU(0) on the rows owned by this rank. Factorization and triangular solves are sequential
+struct ILU0Preconditioner : Preconditioner
+{
+  virtual void setup(const NativeOperator& op, const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& threads)
+  {
+    if(is_null(op.crs))
+      throw common::SetupError(FromHere(), "The ILU0 preconditioner needs an assembled NativeCrsMatrix, use Jacobi, BlockJacobi or Chebyshev for a matrix-free system");
+    const NativeCrsMatrix& matrix = *op.crs;
+    m_matrix = &matrix;
+    neq = nb_eq;
+    const Uint block_size = neq*neq;
+    const std::vector<Uint>& row_starts = matrix.row_starts();
+    const std::vector<Uint>& columns = matrix.columns();
+    const std::vector<Uint>& diag_positions = matrix.diagonal_positions();
+
+    factors = matrix.values();
+    BlockT l_block(neq, neq);
+
+    // The owned nodes are sorted, so the factorization follows the storage order
+    BOOST_FOREACH(const Uint row, matrix.owned_nodes())
+    {
+      const Uint row_end = row_starts[row+1];
+      for(Uint pos = row_starts[row]; pos != row_end && columns[pos] < row; ++pos)
+      {
+        const Uint k = columns[pos];
+        if(!matrix.is_owned(k))
+          continue;
+
+        // L_ik = A_ik * U_kk^-1, the inverse diagonal being stored in place of U_kk
+        BlockMapT a_ik(&factors[pos*block_size], neq, neq);
+        l_block.noalias() = a_ik * ConstBlockMapT(&factors[diag_positions[k]*block_size], neq, neq);
+        a_ik = l_block;
+
+        // A_ij -= L_ik * U_kj for j > k, following the sparsity of both rows
+        Uint kpos = diag_positions[k] + 1;
+        const Uint k_end = row_starts[k+1];
+        for(Uint jpos = pos+1; jpos != row_end; ++jpos)
+        {
+          const Uint j = columns[jpos];
+          while(kpos != k_end && columns[kpos] < j)
+            ++kpos;
+          if(kpos == k_end)
+            break;
+          if(columns[kpos] == j)
+            BlockMapT(&factors[jpos*block_size], neq, neq).noalias() -= l_block * ConstBlockMapT(&factors[kpos*block_size], neq, neq);
+        }
+      }
+      invert_block(&factors[diag_positions[row]*block_size], neq);
+    }
+  }
+
+  virtual void apply(const NativeVector& r, NativeVector& z, const common::ThreadPool& threads) const
+  {
+    const NativeCrsMatrix& matrix = *m_matrix;
+    const Uint block_size = neq*neq;
+    const std::vector<Uint>& owned = matrix.owned_nodes();
+    const std::vector<Uint>& row_starts = matrix.row_starts();
+    const std::vector<Uint>& columns = matrix.columns();
+    const std::vector<Uint>& diag_positions = matrix.diagonal_positions();
+    const std::vector<Real>& r_data = r.data();
+    std::vector<Real>& z_data = z.data();
+    RealVector sum(neq);
+
+    // Forward substitution with the unit lower triangle
+    BOOST_FOREACH(const Uint row, owned)
+    {
+      sum = ConstVectorMapT(&r_data[row*neq], neq);
+      for(Uint pos = row_starts[row]; pos != diag_positions[row]; ++pos)
+      {
+        if(matrix.is_owned(columns[pos]))
+          sum.noalias() -= ConstBlockMapT(&factors[pos*block_size], neq, neq) * VectorMapT(&z_data[columns[pos]*neq], neq);
+      }
+      VectorMapT(&z_data[row*neq], neq) = sum;
+    }
+
+    // Backward substitution with the upper triangle
+    for(std::vector<Uint>::const_reverse_iterator row_it = owned.rbegin(); row_it != owned.rend(); ++row_it)
+    {
+      const Uint row = *row_it;
+      sum = VectorMapT(&z_data[row*neq], neq);
+      for(Uint pos = diag_positions[row]+1; pos != row_starts[row+1]; ++pos)
+      {
+        if(matrix.is_owned(columns[pos]))
+          sum.noalias() -= ConstBlockMapT(&factors[pos*block_size], neq, neq) * VectorMapT(&z_data[columns[pos]*neq], neq);
+      }
+      VectorMapT(&z_data[row*neq], neq).noalias() = ConstBlockMapT(&factors[diag_positions[row]*block_size], neq, neq) * sum;
+    }
+  }
+
+  const NativeCrsMatrix* m_matrix;
+  Uint neq;
+  std::vector<Real> factors;
+};
+
+/// Chebyshev polynomial in the Jacobi scaled matrix D^-1*A. Only uses matrix-vector products and the diagonal, so it also works without an
+/// assembled matrix. The largest eigenvalue of D^-1*A is estimated using power iterations, and the polynomial damps the eigenvalues in the
+/// interval [lambda_max/eigenvalue_ratio, lambda_max]. The preconditioner is a fixed polynomial, so it is symmetric if A is.
+struct ChebyshevPreconditioner : Preconditioner
+{
+  ChebyshevPreconditioner(const Uint poly_degree, const Real ratio) :
+    jacobi(false),
+    degree(std::max(poly_degree, 1u)),
+    eigenvalue_ratio(std::max(ratio, 1.+1e-6))
+  {
+  }
+
+  virtual void setup(const NativeOperator& op, const NativeVector& layout, const Uint nb_eq, const common::ThreadPool& threads)
+  {
+    m_op = op;
+    neq = nb_eq;
+    jacobi.setup(op, layout, nb_eq, threads);
+
+    NativeVector& layout_vector = const_cast<NativeVector&>(layout);
+    d = common::allocate_component<NativeVector>("d");
+    residual = common::allocate_component<NativeVector>("residual");
+    scaled_residual = common::allocate_component<NativeVector>("scaled_residual");
+    layout_vector.clone_to(*d);
+    layout_vector.clone_to(*residual);
+    layout_vector.clone_to(*scaled_residual);
+
+    // Power iterations on D^-1*A, starting from a deterministic vector with varying entries
+    const VectorOps ops(layout, nb_eq, threads);
+    NativeVector& x = *d;
+    NativeVector& w = *residual;
+    x.reset(0.);
+    std::vector<Real>& x_data = x.data();
+    BOOST_FOREACH(const Uint node, layout.owned_nodes())
+    {
+      for(Uint a = 0; a != neq; ++a)
+        x_data[node*neq+a] = 1. + static_cast<Real>((node*neq+a)*7919 % 101) / 100.;
+    }
+    Real norm = ops.norm2(x);
+    Real lambda = 0.;
+    for(Uint i = 0; i != nb_power_iterations && norm != 0.; ++i)
+    {
+      ops.axpby(1. / norm, x, 0., x);
+      m_op.multiply(x, w, threads);
+      jacobi.apply(w, x, threads);
+      norm = ops.norm2(x);
+      lambda = norm;
+    }
+
+    // The power method underestimates the largest eigenvalue, so a safety factor is applied
+    lambda_max = lambda == 0. ? 1. : 1.1*lambda;
+    lambda_min = lambda_max / eigenvalue_ratio;
+  }
+
+  virtual void apply(const NativeVector& r, NativeVector& z, const common::ThreadPool& threads) const
+  {
+    const VectorOps ops(r, neq, threads);
+    const Real theta = 0.5*(lambda_max + lambda_min);
+    const Real delta = 0.5*(lambda_max - lambda_min);
+    const Real sigma = theta / delta;
+    Real rho = 1. / sigma;
+
+    jacobi.apply(r, *d, threads);
+    ops.axpby(1. / theta, *d, 0., *d);
+    ops.axpby(1., *d, 0., z);
+    for(Uint k = 1; k != degree; ++k)
+    {
+      const Real rho_new = 1. / (2.*sigma - rho);
+      m_op.multiply(z, *residual, threads, -1., 0.);
+      ops.axpby(1., r, 1., *residual);
+      jacobi.apply(*residual, *scaled_residual, threads);
+      ops.axpby(2.*rho_new / delta, *scaled_residual, rho_new*rho, *d);
+      ops.axpby(1., *d, 1., z);
+      rho = rho_new;
+    }
+  }
+
+  static const Uint nb_power_iterations = 10;
+
+  JacobiPreconditioner jacobi;
+  const Uint degree;
+  const Real eigenvalue_ratio;
+  NativeOperator m_op;
+  Uint neq;
+  Real lambda_max;
+  Real lambda_min;
+  boost::shared_ptr<NativeVector> d;
+  boost::shared_ptr<NativeVector> residual;
+  boost::shared_ptr<NativeVector> scaled_residual;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+struct NativeStrategy::Implementation
+{
+  Implementation(common::Component& self) :
+    m_self(self),
+    m_preconditioner_layout(0),
+    m_preconditioner_values(0),
+    m_work_layout(0),
+    m_iterations(0),
+    m_relative_residual(0.)
+  {
+    m_self.options().add("solver", std::string("GMRES"))
+      .pretty_name("Solver")
+      .description("Krylov method to use")
+      .restricted_list() += std::string("CG"), std::string("BiCGStab");
+    m_self.options().option("solver").mark_basic();
+
+    m_self.options().add("preconditioner", std::string("ILU0"))
+      .pretty_name("Preconditioner")
+      .description("Preconditioner to use. ILU0 and the Jacobi variants only use the rows owned by each process. ILU0 needs an assembled matrix. "
+                   "The preconditioner is only computed again when the matrix changes")
+      .attach_trigger(boost::bind(&Implementation::reset_preconditioner, this))
+      .restricted_list() += std::string("None"), std::string("Jacobi"), std::string("BlockJacobi"), std::string("Chebyshev");
+    m_self.options().option("preconditioner").mark_basic();
+
+    m_self.options().add("max_iterations", 1000u)
+      .pretty_name("Maximum Iterations")
+      .description("Maximum number of iterations")
+      .mark_basic();
+
+    m_self.options().add("tolerance", 1e-8)
+      .pretty_name("Tolerance")
+      .description("Convergence criterion on the residual norm, relative to the norm of the right hand side")
+      .mark_basic();
+
+    m_self.options().add("gmres_restart", 30u)
+      .pretty_name("GMRES Restart")
+      .description("Number of GMRES iterations between restarts");
+
+    m_self.options().add("chebyshev_degree", 3u)
+      .pretty_name("Chebyshev Degree")
+      .description("Degree of the Chebyshev preconditioner polynomial, i.e. the number of matrix-vector products per application plus one")
+      .attach_trigger(boost::bind(&Implementation::reset_preconditioner, this));
+
+    m_self.options().add("chebyshev_eigenvalue_ratio", 30.)
+      .pretty_name("Chebyshev Eigenvalue Ratio")
+      .description("Ratio between the largest and smallest eigenvalue targeted by the Chebyshev preconditioner")
+      .attach_trigger(boost::bind(&Implementation::reset_preconditioner, this));
+
+    m_self.options().add("nb_threads", 1u)
+      .pretty_name("Number of Threads")
+      .description("Number of threads used for the matrix-vector products, vector updates and Jacobi preconditioners. The worker threads are started at the first solve and kept for the next ones");
+
+    m_self.options().add("verbose", false)
+      .pretty_name("Verbose")
+      .description("Print the number of iterations and the residual after each solve");
+  }
+
+  void check_setup()
+  {
+    if(!m_matrix.is_set())
+      throw common::SetupError(FromHere(), "Null or non-native matrix for " + m_self.uri().path());
+
+    if(is_null(m_rhs))
+      throw common::SetupError(FromHere(), "Null or non-native RHS for " + m_self.uri().path());
+
+    if(is_null(m_solution))
+      throw common::SetupError(FromHere(), "Null or non-native solution vector for " + m_self.uri().path());
+  }
+
+  /// Work vector with the same layout as the solution. The vectors are kept between solves and only created again when the
+  /// layout of the solution changes, so their initial values are undefined
+  boost::shared_ptr<NativeVector> work_vector(const std::string& name)
+  {
+    if(m_work_layout != m_solution->layout_generation())
+    {
+      m_work_vectors.clear();
+      m_work_layout = m_solution->layout_generation();
+    }
+
+    boost::shared_ptr<NativeVector>& result = m_work_vectors[name];
+    if(is_null(result))
+    {
+      result = common::allocate_component<NativeVector>(name);
+      m_solution->clone_to(*result);
+    }
+    return result;
+  }
+
+  boost::shared_ptr<Preconditioner> create_preconditioner()
+  {
+    const std::string name = m_self.options().value<std::string>("preconditioner");
+    boost::shared_ptr<Preconditioner> result;
+    if(name == "ILU0")
+      result.reset(new ILU0Preconditioner());
+    else if(name == "Jacobi")
+      result.reset(new JacobiPreconditioner(false));
+    else if(name == "BlockJacobi")
+      result.reset(new JacobiPreconditioner(true));
+    else if(name == "Chebyshev")
+      result.reset(new ChebyshevPreconditioner(m_self.options().value<Uint>("chebyshev_degree"), m_self.options().value<Real>("chebyshev_eigenvalue_ratio")));
+    else if(name == "None")
+      result.reset(new IdentityPreconditioner());
+    else
+      throw common::SetupError(FromHere(), "Unknown preconditioner " + name + " for " + m_self.uri().path());
+    return result;
+  }
+
+  /// The matrix-free matrix only moves the dirichlet columns to the RHS when asked
+  void eliminate_dirichlet_columns()
+  {
+    if(is_not_null(m_matrix.ebe))
+      m_matrix.ebe->eliminate_dirichlet_columns();
+  }
+
+  /// Compute the preconditioner, unless the matrix and the layout are the same as for the previous solve
+  void setup_preconditioner()
+  {
+    check_setup();
+    eliminate_dirichlet_columns();
+    const Uint values = m_matrix.values_generation();
+    const Uint layout = m_solution->layout_generation();
+    if(is_not_null(m_preconditioner) && values == m_preconditioner_values && layout == m_preconditioner_layout)
+      return;
+
+    if(is_null(m_preconditioner))
+      m_preconditioner = create_preconditioner();
+    m_preconditioner->setup(m_matrix, *m_solution, m_solution->neq(), thread_pool());
+    m_preconditioner_values = values;
+    m_preconditioner_layout = layout;
+  }
+
+  /// Create the preconditioner again at the next solve
+  void reset_preconditioner()
+  {
+    m_preconditioner.reset();
+  }
+
+  void solve()
+  {
+    setup_preconditioner();
+
+    const common::ThreadPool& threads = thread_pool();
+    const std::string solver = m_self.options().value<std::string>("solver");
+    const Preconditioner& preconditioner = *m_preconditioner;
+    const Uint neq = m_solution->neq();
+
+    m_iterations = 0;
+    m_relative_residual = 0.;
+
+    const VectorOps ops(*m_solution, neq, threads);
+    const Real rhs_norm = ops.norm2(*m_rhs);
+    if(rhs_norm == 0.)
+    {
+      m_solution->reset(0.);
+    }
+    else if(solver == "GMRES")
+    {
+      gmres(ops, preconditioner, rhs_norm);
+    }
+    else if(solver == "CG")
+    {
+      cg(ops, preconditioner, rhs_norm);
+    }
+    else if(solver == "BiCGStab")
+    {
+      bicgstab(ops, preconditioner, rhs_norm);
+    }
+    else
+    {
+      throw common::SetupError(FromHere(), "Unknown solver " + solver + " for " + m_self.uri().path());
+    }
+
+    m_solution->sync();
+
+    const Real tolerance = m_self.options().value<Real>("tolerance");
+    if(m_relative_residual > tolerance)
+      CFwarn << m_self.uri().path() << ": " << solver << " did not converge after " << m_iterations << " iterations, relative residual is " << m_relative_residual << CFendl;
+    else if(m_self.options().value<bool>("verbose"))
+      CFinfo << m_self.uri().path() << ": " << solver << " converged after " << m_iterations << " iterations, relative residual is " << m_relative_residual << CFendl;
+  }
+
+  /// r = b - A*x
+  void residual(NativeVector& r)
+  {
+    r.assign(*m_rhs);
+    m_matrix.multiply(*m_solution, r, thread_pool(), -1., 1.);
+  }
+
+  void cg(const VectorOps& ops, const Preconditioner& preconditioner, const Real rhs_norm)
+  {
+    const Uint max_iterations = m_self.options().value<Uint>("max_iterations");
+    const Real tolerance = m_self.options().value<Real>("tolerance");
+    boost::shared_ptr<NativeVector> r = work_vector("r");
+    boost::shared_ptr<NativeVector> z = work_vector("z");
+    boost::shared_ptr<NativeVector> p = work_vector("p");
+    boost::shared_ptr<NativeVector> q = work_vector("q");
+
+    residual(*r);
+    m_relative_residual = ops.norm2(*r) / rhs_norm;
+    if(m_relative_residual <= tolerance)
+      return;
+
+    preconditioner.apply(*r, *z, ops.threads);
+    ops.axpby(1., *z, 0., *p);
+    Real rz = ops.dot(*r, *z);
+
+    while(m_iterations < max_iterations)
+    {
+      ++m_iterations;
+      m_matrix.multiply(*p, *q, ops.threads);
+      const Real alpha = rz / ops.dot(*p, *q);
+      ops.axpby(alpha, *p, 1., *m_solution);
+      ops.axpby(-alpha, *q, 1., *r);
+      m_relative_residual = ops.norm2(*r) / rhs_norm;
+      if(m_relative_residual <= tolerance)
+        break;
+      preconditioner.apply(*r, *z, ops.threads);
+      const Real rz_new = ops.dot(*r, *z);
+      ops.axpby(1., *z, rz_new / rz, *p);
+      rz = rz_new;
+    }
+  }
+
+  /// Right-preconditioned BiCGStab
+  void bicgstab(const VectorOps& ops, const Preconditioner& preconditioner, const Real rhs_norm)
+  {
+    const Uint max_iterations = m_self.options().value<Uint>("max_iterations");
+    const Real tolerance = m_self.options().value<Real>("tolerance");
+    boost::shared_ptr<NativeVector> r = work_vector("r");
+    boost::shared_ptr<NativeVector> r0 = work_vector("r0");
+    boost::shared_ptr<NativeVector> p = work_vector("p");
+    boost::shared_ptr<NativeVector> v = work_vector("v");
+    boost::shared_ptr<NativeVector> p_hat = work_vector("p_hat");
+    boost::shared_ptr<NativeVector> s_hat = work_vector("s_hat");
+    boost::shared_ptr<NativeVector> t = work_vector("t");
+
+    residual(*r);
+    m_relative_residual = ops.norm2(*r) / rhs_norm;
+    if(m_relative_residual <= tolerance)
+      return;
+
+    ops.axpby(1., *r, 0., *r0);
+    p->reset(0.);
+    v->reset(0.);
+    Real rho = 1., alpha = 1., omega = 1.;
+
+    while(m_iterations < max_iterations)
+    {
+      ++m_iterations;
+      Real rho_new = ops.dot(*r0, *r);
+      if(rho_new == 0. || omega == 0.)
+      {
+        // Breakdown, restart using the current residual as shadow residual
+        ops.axpby(1., *r, 0., *r0);
+        p->reset(0.);
+        v->reset(0.);
+        rho = alpha = omega = 1.;
+        rho_new = ops.dot(*r0, *r);
+      }
+
+      // p = r + beta*(p - omega*v)
+      ops.axpby(-omega, *v, 1., *p);
+      ops.axpby(1., *r, (rho_new / rho) * (alpha / omega), *p);
+      preconditioner.apply(*p, *p_hat, ops.threads);
+      m_matrix.multiply(*p_hat, *v, ops.threads);
+      alpha = rho_new / ops.dot(*r0, *v);
+
+      // r becomes s = r - alpha*v
+      ops.axpby(-alpha, *v, 1., *r);
+      ops.axpby(alpha, *p_hat, 1., *m_solution);
+      m_relative_residual = ops.norm2(*r) / rhs_norm;
+      if(m_relative_residual <= tolerance)
+        break;
+
+      preconditioner.apply(*r, *s_hat, ops.threads);
+      m_matrix.multiply(*s_hat, *t, ops.threads);
+      const Real tt = ops.dot(*t, *t);
+      omega = tt == 0. ? 0. : ops.dot(*t, *r) / tt;
+      ops.axpby(omega, *s_hat, 1., *m_solution);
+      ops.axpby(-omega, *t, 1., *r);
+      m_relative_residual = ops.norm2(*r) / rhs_norm;
+      if(m_relative_residual <= tolerance)
+        break;
+
+      rho = rho_new;
+    }
+  }
+
+  /// Right-preconditioned restarted GMRES, using modified Gram-Schmidt and Givens rotations
+  void gmres(const VectorOps& ops, const Preconditioner& preconditioner, const Real rhs_norm)
+  {
+    const Uint max_iterations = m_self.options().value<Uint>("max_iterations");
+    const Real tolerance = m_self.options().value<Real>("tolerance");
+    const Uint restart = std::max(m_self.options().value<Uint>("gmres_restart"), 1u);
+
+    std::vector< boost::shared_ptr<NativeVector> > basis;
+    for(Uint i = 0; i != restart+1; ++i)
+      basis.push_back(work_vector("v" + common::to_str(i)));
+    boost::shared_ptr<NativeVector> z = work_vector("z");
+
+    RealMatrix hessenberg(restart+1, restart);
+    RealVector g(restart+1);
+    RealVector cs(restart), sn(restart);
+
+    while(true)
+    {
+      NativeVector& v0 = *basis[0];
+      residual(v0);
+      const Real beta = ops.norm2(v0);
+      m_relative_residual = beta / rhs_norm;
+      if(m_relative_residual <= tolerance || m_iterations >= max_iterations)
+        return;
+
+      ops.axpby(1. / beta, v0, 0., v0);
+      g.setZero();
+      g[0] = beta;
+      hessenberg.setZero();
+
+      Uint k = 0;
+      while(k != restart && m_iterations < max_iterations)
+      {
+        ++m_iterations;
+        NativeVector& w = *basis[k+1];
+        preconditioner.apply(*basis[k], *z, ops.threads);
+        m_matrix.multiply(*z, w, ops.threads);
+        for(Uint i = 0; i <= k; ++i)
+        {
+          hessenberg(i, k) = ops.dot(w, *basis[i]);
+          ops.axpby(-hessenberg(i, k), *basis[i], 1., w);
+        }
+        hessenberg(k+1, k) = ops.norm2(w);
+        if(hessenberg(k+1, k) != 0.)
+          ops.axpby(1. / hessenberg(k+1, k), w, 0., w);
+
+        // Apply the previous rotations to the new column and compute the rotation that eliminates the subdiagonal
+        for(Uint i = 0; i != k; ++i)
+        {
+          const Real h_i = hessenberg(i, k);
+          hessenberg(i, k) = cs[i]*h_i + sn[i]*hessenberg(i+1, k);
+          hessenberg(i+1, k) = -sn[i]*h_i + cs[i]*hessenberg(i+1, k);
+        }
+        const Real denominator = std::sqrt(hessenberg(k, k)*hessenberg(k, k) + hessenberg(k+1, k)*hessenberg(k+1, k));
+        cs[k] = denominator == 0. ? 1. : hessenberg(k, k) / denominator;
+        sn[k] = denominator == 0. ? 0. : hessenberg(k+1, k) / denominator;
+        hessenberg(k, k) = denominator;
+        hessenberg(k+1, k) = 0.;
+        g[k+1] = -sn[k]*g[k];
+        g[k] = cs[k]*g[k];
+
+        ++k;
+        m_relative_residual = std::abs(g[k]) / rhs_norm;
+        if(m_relative_residual <= tolerance || denominator == 0.)
+          break;
+      }
+
+      // Solve the upper triangular system and update the solution with M^-1 * V * y
+      const RealVector y = hessenberg.topLeftCorner(k, k).triangularView<Eigen::Upper>().solve(g.head(k));
+      NativeVector& update = *basis[restart];
+      ops.axpby(y[0], *basis[0], 0., update);
+      for(Uint i = 1; i != k; ++i)
+        ops.axpby(y[i], *basis[i], 1., update);
+      preconditioner.apply(update, *z, ops.threads);
+      ops.axpby(1., *z, 1., *m_solution);
+    }
+  }
+
+  Real compute_residual()
+  {
+    check_setup();
+    eliminate_dirichlet_columns();
+    boost::shared_ptr<NativeVector> r = work_vector("r");
+    residual(*r);
+    return r->norm2(thread_pool());
+  }
+
+  /// Pool with the number of threads set in the options. The workers are kept between solves
+  const common::ThreadPool& thread_pool()
+  {
+    m_threads.resize(m_self.options().value<Uint>("nb_threads"));
+    return m_threads;
+  }
+
+  common::Component& m_self;
+  common::ThreadPool m_threads;
+  NativeOperator m_matrix;
+  boost::shared_ptr<Preconditioner> m_preconditioner;
+  /// Generations of the solution layout and of the matrix values used to compute the preconditioner
+  Uint m_preconditioner_layout;
+  Uint m_preconditioner_values;
+  /// Work vectors of the solvers by name, with the layout generation they were created for
+  std::map< std::string, boost::shared_ptr<NativeVector> > m_work_vectors;
+  Uint m_work_layout;
+  Handle<NativeVector> m_rhs;
+  Handle<NativeVector> m_solution;
+  Uint m_iterations;
+  Real m_relative_residual;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeStrategy::NativeStrategy(const std::string& name) :
+  SolutionStrategy(name),
+  m_implementation(new Implementation(*this))
+{
+}
+
+NativeStrategy::~NativeStrategy()
+{
+}
+
+void NativeStrategy::set_matrix(const Handle< Matrix >& matrix)
+{
+  m_implementation->m_matrix.crs = Handle<NativeCrsMatrix>(matrix);
+  m_implementation->m_matrix.ebe = Handle<NativeEBEMatrix>(matrix);
+  m_implementation->reset_preconditioner();
+}
+
+void NativeStrategy::set_rhs(const Handle< Vector >& rhs)
+{
+  m_implementation->m_rhs = Handle<NativeVector>(rhs);
+}
+
+void NativeStrategy::set_solution(const Handle< Vector >& solution)
+{
+  m_implementation->m_solution = Handle<NativeVector>(solution);
+}
+
+void NativeStrategy::solve()
+{
+  m_implementation->solve();
+}
+
+Real NativeStrategy::compute_residual()
+{
+  return m_implementation->compute_residual();
+}
+
+Uint NativeStrategy::iterations() const
+{
+  return m_implementation->m_iterations;
+}
+
+Real NativeStrategy::relative_residual() const
+{
+  return m_implementation->m_relative_residual;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
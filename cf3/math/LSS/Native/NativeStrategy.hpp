@@ -0,0 +1,72 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeStrategy_hpp
+#define cf3_Math_LSS_NativeStrategy_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/scoped_ptr.hpp>
+
+#include "math/LSS/SolutionStrategy.hpp"
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ *  @file NativeStrategy.hpp Krylov solvers for the native matrix and vectors
+ *
+ *  The solver is one of CG, BiCGStab or GMRES, preconditioned with Jacobi, block-Jacobi, ILU(0) or a Chebyshev polynomial.
+ *  The Jacobi and ILU(0) preconditioners act on the rows owned by each rank, ignoring the coupling to ghost nodes.
+ *  The matrix is either a NativeCrsMatrix or a matrix-free NativeEBEMatrix, the latter not supporting ILU(0).
+ *  Matrix-vector products, vector updates and the Jacobi preconditioners are spread over nb_threads threads. The worker threads
+ *  are owned by the strategy and kept between solves, as are the work vectors of the solvers. The preconditioner is only computed
+ *  again when the matrix values or the layout of the solution change.
+ **/
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeStrategy : public SolutionStrategy
+{
+public:
+
+  /// Default constructor
+  NativeStrategy(const std::string& name);
+
+  ~NativeStrategy();
+
+  /// name of the type
+  static std::string type_name () { return "NativeStrategy"; }
+
+  void set_matrix(const Handle<LSS::Matrix>& matrix);
+  void set_rhs(const Handle<LSS::Vector>& rhs);
+  void set_solution(const Handle<LSS::Vector>& solution);
+  void solve();
+  Real compute_residual();
+
+  /// Number of iterations used by the last solve
+  Uint iterations() const;
+
+  /// Relative residual at the end of the last solve, as estimated by the solver
+  Real relative_residual() const;
+
+private:
+  struct Implementation;
+  boost::scoped_ptr<Implementation> m_implementation;
+}; // end of class NativeStrategy
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeStrategy_hpp
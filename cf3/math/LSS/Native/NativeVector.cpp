@@ -0,0 +1,509 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <fstream>
+
+#include <boost/weak_ptr.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/StringConversion.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "math/LSS/Native/NativeDetail.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeVector, LSS::Vector, LSS::LibLSS > NativeVector_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  /// Counter used to give each vector data a unique name in the shared comm patterns
+  Uint nb_registered_vectors = 0;
+
+  /// Comm pattern of the native vectors created from the given source pattern, with the layout it was set up for
+  struct SharedCommPattern
+  {
+    const common::PE::CommPattern* source;
+    std::vector<Uint> gids;
+    std::vector<Uint> ranks;
+    boost::weak_ptr<common::PE::CommPattern> pattern;
+  };
+
+  /// Patterns that may be shared by new vectors, so the rhs, the solution and any other vector on the same nodes
+  /// use a single pattern
+  std::vector<SharedCommPattern> shared_comm_patterns;
+
+  /// Get the comm pattern for the given layout, creating it if no vector with the same source and layout exists.
+  /// This is collective, since all ranks must agree on the creation of a new pattern
+  boost::shared_ptr<common::PE::CommPattern> shared_comm_pattern(const common::PE::CommPattern& source, const std::vector<Uint>& gids, const std::vector<Uint>& ranks)
+  {
+    for(std::vector<SharedCommPattern>::iterator it = shared_comm_patterns.begin(); it != shared_comm_patterns.end();)
+    {
+      if(it->pattern.expired())
+        it = shared_comm_patterns.erase(it);
+      else
+        ++it;
+    }
+
+    // Searched after the cleanup, since erasing invalidates the iterators
+    std::vector<SharedCommPattern>::iterator found = shared_comm_patterns.begin();
+    while(found != shared_comm_patterns.end() && found->source != &source)
+      ++found;
+
+    // The source may have been set up again, so the layout is compared on all ranks
+    Uint nb_changed = found == shared_comm_patterns.end() || found->gids != gids || found->ranks != ranks ? 1 : 0;
+    Uint total_changed = nb_changed;
+    common::PE::Comm::instance().all_reduce(common::PE::plus(), &nb_changed, 1, &total_changed);
+    if(total_changed == 0)
+      return found->pattern.lock();
+
+    std::vector<Uint> setup_gids(gids);
+    std::vector<Uint> setup_ranks(ranks);
+    boost::shared_ptr<common::PE::CommPattern> result = common::allocate_component<common::PE::CommPattern>("CommPattern");
+    result->insert("gid", setup_gids, 1, false);
+    result->setup(Handle<common::PE::CommWrapper>(result->get_child("gid")), setup_ranks);
+    result->remove_component("gid"); // gids refers to local data and is only needed for the setup
+
+    if(found == shared_comm_patterns.end())
+    {
+      shared_comm_patterns.push_back(SharedCommPattern());
+      found = shared_comm_patterns.end() - 1;
+    }
+    found->source = &source;
+    found->gids = gids;
+    found->ranks = ranks;
+    found->pattern = result;
+    return result;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeVector::NativeVector(const std::string& name) :
+  LSS::Vector(name),
+  m_neq(0),
+  m_blockrow_size(0),
+  m_is_created(false),
+  m_layout_generation(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeVector::~NativeVector()
+{
+  destroy();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::create(common::PE::CommPattern& cp, Uint neq, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  if (m_is_created) destroy();
+
+  detail::create_native_layout(cp, periodic_links_nodes, periodic_links_active, m_node_map, m_owned_nodes);
+
+  m_neq = neq;
+  m_blockrow_size = cp.isUpdatable().size();
+  m_data.assign(m_blockrow_size*m_neq, 0.);
+
+  if(common::PE::Comm::instance().is_active())
+  {
+    std::vector<Uint> gids(m_blockrow_size);
+    std::vector<Uint> ranks(m_blockrow_size);
+    if(m_blockrow_size != 0)
+      cp.gid()->pack(gids);
+    for(Uint i = 0; i != m_blockrow_size; ++i)
+      ranks[i] = cp.rank(i);
+
+    m_comm_pattern = shared_comm_pattern(cp, gids, ranks);
+    register_data();
+  }
+
+  m_layout_generation = detail::next_generation();
+  m_is_created = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
+{
+  create(cp, vars.size(), periodic_links_nodes, periodic_links_active);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::destroy()
+{
+  if(is_not_null(m_comm_pattern) && is_not_null(m_comm_pattern->get_child(m_sync_name)))
+    m_comm_pattern->remove_component(m_sync_name);
+  m_comm_pattern.reset();
+  m_sync_name.clear();
+  m_data.clear();
+  m_node_map.clear();
+  m_owned_nodes.clear();
+  m_neq=0;
+  m_blockrow_size=0;
+  m_layout_generation=0;
+  m_is_created=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::register_data()
+{
+  m_sync_name = name() + "_" + common::to_str(++nb_registered_vectors);
+  m_comm_pattern->insert(m_sync_name, m_data, m_neq, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_value(const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(irow/m_neq, irow%m_neq)]=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_value(const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(irow/m_neq, irow%m_neq)]+=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_value(const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  value=m_data[index(irow/m_neq, irow%m_neq)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_value(const Uint iblockrow, const Uint ieq, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(iblockrow, ieq)]=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_value(const Uint iblockrow, const Uint ieq, const Real value)
+{
+  cf3_assert(m_is_created);
+  m_data[index(iblockrow, ieq)]+=value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_value(const Uint iblockrow, const Uint ieq, Real& value)
+{
+  cf3_assert(m_is_created);
+  value=m_data[index(iblockrow, ieq)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_rhs_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      m_data[index(values.indices[i], j)] = values.rhs[i*m_neq+j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_rhs_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      m_data[index(values.indices[i], j)] += values.rhs[i*m_neq+j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_rhs_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      values.rhs[i*m_neq+j] = m_data[index(values.indices[i], j)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set_sol_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      m_data[index(values.indices[i], j)] = values.sol[i*m_neq+j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::add_sol_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      m_data[index(values.indices[i], j)] += values.sol[i*m_neq+j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get_sol_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint j = 0; j != m_neq; ++j)
+      values.sol[i*m_neq+j] = m_data[index(values.indices[i], j)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  m_data.assign(m_data.size(), reset_to);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::get( boost::multi_array<Real, 2>& data)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(data.shape()[0]==m_blockrow_size);
+  cf3_assert(data.shape()[1]==m_neq);
+  for (Uint i=0; i != m_blockrow_size; ++i)
+    for (Uint j=0; j != m_neq; ++j)
+      data[i][j]=m_data[index(i, j)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::set( boost::multi_array<Real, 2>& data)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(data.shape()[0]==m_blockrow_size);
+  cf3_assert(data.shape()[1]==m_neq);
+  for (Uint i=0; i != m_blockrow_size; ++i)
+    for (Uint j=0; j != m_neq; ++j)
+      m_data[index(i, j)]=data[i][j];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(common::LogStream& stream)
+{
+  if (m_is_created)
+  {
+    for (Uint i=0; i != m_blockrow_size; ++i)
+      for (Uint j=0; j != m_neq; ++j)
+        stream << 0 << " " << -(int)(i*m_neq+j) << " " << m_data[index(i, j)] << "\n";
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# process:              " << common::PE::Comm::instance().rank() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << m_blockrow_size*m_neq << "\n";
+    stream << "# number of block rows: " << m_blockrow_size << "\n";
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    for (Uint i=0; i != m_blockrow_size; ++i)
+      for (Uint j=0; j != m_neq; ++j)
+        stream << 0 << " " << -(int)(i*m_neq+j) << " " << m_data[index(i, j)] << "\n";
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# process:              " << common::PE::Comm::instance().rank() << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << m_blockrow_size*m_neq << "\n";
+    stream << "# number of block rows: " << m_blockrow_size << "\n" << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print(const std::string& filename, std::ios_base::openmode mode)
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::print_native(std::ostream& stream)
+{
+  const Uint nb_entries = m_data.size();
+  for(Uint i = 0; i != nb_entries; ++i)
+    stream << i << " " << m_data[i] << "\n";
+  stream << std::flush;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::debug_data(std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  values.clear();
+  for (Uint i=0; i != m_blockrow_size; ++i)
+    for (Uint j=0; j != m_neq; ++j)
+      values.push_back(m_data[index(i, j)]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::clone_to(Vector &other)
+{
+  if(!m_is_created)
+    throw common::SetupError(FromHere(), "Vector to clone " + uri().string() + " is not created");
+
+  NativeVector* other_ptr = dynamic_cast<NativeVector*>(&other);
+  if(is_null(other_ptr))
+    throw common::SetupError(FromHere(), "clone_to method of NativeVector needs another NativeVector, but a " + other.derived_type_name() + " was supplied instead.");
+
+  other_ptr->destroy();
+  other_ptr->m_data = m_data;
+  other_ptr->m_neq = m_neq;
+  other_ptr->m_blockrow_size = m_blockrow_size;
+  other_ptr->m_node_map = m_node_map;
+  other_ptr->m_owned_nodes = m_owned_nodes;
+  other_ptr->m_layout_generation = m_layout_generation;
+  other_ptr->m_comm_pattern = m_comm_pattern;
+  if(is_not_null(m_comm_pattern))
+    other_ptr->register_data();
+  other_ptr->m_is_created = m_is_created;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::assign(const Vector& source)
+{
+  NativeVector const* source_ptr = dynamic_cast<NativeVector const*>(&source);
+
+  if(is_null(source_ptr))
+    throw common::SetupError(FromHere(), "assign method of NativeVector needs another NativeVector, but a " + source.derived_type_name() + " was supplied instead.");
+
+  if(source_ptr->m_data.size() != m_data.size())
+    throw common::SetupError(FromHere(), "assign method of NativeVector got a vector with incorrect size");
+
+  m_data.assign(source_ptr->m_data.begin(), source_ptr->m_data.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::update ( const Vector& source, const Real alpha )
+{
+  NativeVector const* source_ptr = dynamic_cast<NativeVector const*>(&source);
+
+  if(is_null(source_ptr))
+    throw common::SetupError(FromHere(), "update method of NativeVector needs another NativeVector, but a " + source.derived_type_name() + " was supplied instead.");
+
+  if(source_ptr->m_data.size() != m_data.size())
+    throw common::SetupError(FromHere(), "update method of NativeVector got a vector with incorrect size");
+
+  const Uint size = m_data.size();
+  for(Uint i = 0; i != size; ++i)
+    m_data[i] += alpha*source_ptr->m_data[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::scale ( const Real alpha )
+{
+  if(alpha == 1.)
+    return;
+
+  const Uint size = m_data.size();
+  for(Uint i = 0; i != size; ++i)
+    m_data[i] *= alpha;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeVector::sync()
+{
+  if(is_not_null(m_comm_pattern))
+    m_comm_pattern->synchronize(m_sync_name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Real NativeVector::dot(const NativeVector& other, const common::ThreadPool& threads) const
+{
+  cf3_assert(other.m_data.size() == m_data.size());
+  const Uint neq = m_neq;
+  const std::vector<Uint>& owned = m_owned_nodes;
+  const Real* x = m_data.data();
+  const Real* y = other.m_data.data();
+  Real result = detail::parallel_sum(owned.size(), threads, [neq, &owned, x, y](const Uint begin, const Uint end)
+  {
+    Real sum = 0.;
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint offset = owned[i]*neq;
+      for(Uint j = 0; j != neq; ++j)
+        sum += x[offset+j]*y[offset+j];
+    }
+    return sum;
+  });
+
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  if(comm.is_active())
+  {
+    Real local_result = result;
+    comm.all_reduce(common::PE::plus(), &local_result, 1, &result);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Real NativeVector::norm2(const common::ThreadPool& threads) const
+{
+  return std::sqrt(dot(*this, threads));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,237 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeVector_hpp
+#define cf3_Math_LSS_NativeVector_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Assertions.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Vector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeVector.hpp Definition of the LSS::Vector interface without external dependencies.
+
+  The values are stored per node, keeping the neq equations of a node together. Ghost values are
+  updated through a CommPattern that is shared between all vectors created from the same comm pattern and layout,
+  and their clones.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API NativeVector : public LSS::Vector {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeVector"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// Default constructor
+  NativeVector(const std::string& name);
+
+  ~NativeVector();
+
+  /// Setup sparsity structure
+  void create(common::PE::CommPattern& cp, Uint neq, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// The storage is always per node, so this is the same as create with neq equal to the size of vars
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Set value at given location in the matrix
+  void set_value(const Uint irow, const Real value);
+
+  /// Add value at given location in the matrix
+  void add_value(const Uint irow, const Real value);
+
+  /// Get value at given location in the matrix
+  void get_value(const Uint irow, Real& value);
+
+  /// Set value at given location in the matrix
+  void set_value(const Uint iblockrow, const Uint ieq, const Real value);
+
+  /// Add value at given location in the matrix
+  void add_value(const Uint iblockrow, const Uint ieq, const Real value);
+
+  /// Get value at given location in the matrix
+  void get_value(const Uint iblockrow, const Uint ieq, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Set a list of values to rhs
+  void set_rhs_values(const BlockAccumulator& values);
+
+  /// Add a list of values to rhs
+  void add_rhs_values(const BlockAccumulator& values);
+
+  /// Get a list of values from rhs
+  void get_rhs_values(BlockAccumulator& values);
+
+  /// Set a list of values to sol
+  void set_sol_values(const BlockAccumulator& values);
+
+  /// Add a list of values to sol
+  void add_sol_values(const BlockAccumulator& values);
+
+  /// Get a list of values from sol
+  void get_sol_values(BlockAccumulator& values);
+
+  /// Reset Vector
+  void reset(Real reset_to=0.);
+
+  /// Copies the contents out of the LSS::Vector to table.
+  void get( boost::multi_array<Real, 2>& data);
+
+  /// Copies the contents of the table into the LSS::Vector.
+  void set( boost::multi_array<Real, 2>& data);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; };
+
+  /// Accessor to the number of equations
+  const Uint neq() { return m_neq; };
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { return m_blockrow_size; };
+
+  void clone_to(Vector &other);
+
+  void assign(const Vector& source);
+
+  void update ( const Vector& source, const Real alpha = 1. );
+
+  void scale ( const Real alpha );
+
+  void sync();
+
+  //@} END MISCELLANEOUS
+
+  /// @name NATIVE ACCESS
+  /// @attention these functions are not part of the interface, they are used between the native classes
+  //@{
+
+  /// Raw storage, indexed as storage_node*neq + equation
+  std::vector<Real>& data() { return m_data; }
+  const std::vector<Real>& data() const { return m_data; }
+
+  /// Storage node for each process-local node
+  const std::vector<Uint>& node_map() const { return m_node_map; }
+
+  /// Storage nodes that are owned by this rank
+  const std::vector<Uint>& owned_nodes() const { return m_owned_nodes; }
+
+  /// Identifies the layout. It changes on each create, and clones have the layout of the original
+  Uint layout_generation() const { return m_layout_generation; }
+
+  /// Global dot product with other, which must have the same layout
+  Real dot(const NativeVector& other, const common::ThreadPool& threads = common::ThreadPool::serial()) const;
+
+  /// Global 2-norm
+  Real norm2(const common::ThreadPool& threads = common::ThreadPool::serial()) const;
+
+  //@} END NATIVE ACCESS
+
+  /// @name TEST ONLY
+  //@{
+
+  /// exports the vector into big linear array
+  /// @attention only for debug and utest purposes
+  void debug_data(std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+
+  /// Storage position for the given equation of a process-local node
+  Uint index(const Uint iblockrow, const Uint ieq) const
+  {
+    cf3_assert(iblockrow < m_blockrow_size);
+    cf3_assert(ieq < m_neq);
+    return m_node_map[iblockrow]*m_neq + ieq;
+  }
+
+  /// Register the data with the comm pattern, under a name that is unique for this vector
+  void register_data();
+
+  /// Vector data, one block of m_neq values per process-local node
+  std::vector<Real> m_data;
+
+  /// number of equations
+  Uint m_neq;
+
+  /// number of blocks
+  Uint m_blockrow_size;
+
+  /// status of the vector
+  bool m_is_created;
+
+  /// Storage node for each process-local node, differing from the node itself for periodic nodes
+  std::vector<Uint> m_node_map;
+
+  /// Storage nodes that are owned by this rank
+  std::vector<Uint> m_owned_nodes;
+
+  /// Identifies the layout, zero if the vector is not created
+  Uint m_layout_generation;
+
+  /// The comm pattern is kept as shared ptr, so it can be shared between the vectors with the same layout. Null when running without MPI
+  boost::shared_ptr<common::PE::CommPattern> m_comm_pattern;
+
+  /// Name of the data in the comm pattern
+  std::string m_sync_name;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeVector_hpp
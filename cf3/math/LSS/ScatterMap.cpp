@@ -0,0 +1,76 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "math/LSS/ScatterMap.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+ScatterMap::ScatterMap() :
+  m_matrix(nullptr),
+  m_values(nullptr),
+  m_sparsity_generation(0),
+  m_nb_nodes(0),
+  m_neq(0),
+  m_nb_offsets(0)
+{
+}
+
+bool ScatterMap::setup(Matrix& matrix, const Uint nb_elements, const Uint nb_nodes)
+{
+  if(!matrix.is_created())
+  {
+    clear();
+    return false;
+  }
+
+  Real* values = matrix.scatter_values();
+  if(is_null(values))
+  {
+    clear();
+    return false;
+  }
+
+  const Uint neq = matrix.neq();
+  if(&matrix != m_matrix || matrix.sparsity_generation() != m_sparsity_generation || nb_nodes != m_nb_nodes || neq != m_neq || nb_elements != m_computed.size())
+  {
+    m_matrix = &matrix;
+    m_sparsity_generation = matrix.sparsity_generation();
+    m_nb_nodes = nb_nodes;
+    m_neq = neq;
+    m_nb_offsets = nb_nodes*nb_nodes*neq;
+    m_offsets.assign(nb_elements*m_nb_offsets, Matrix::scatter_skip);
+    m_computed.assign(nb_elements, 0);
+  }
+
+  m_values = values;
+  return true;
+}
+
+void ScatterMap::clear()
+{
+  m_matrix = nullptr;
+  m_values = nullptr;
+  m_sparsity_generation = 0;
+  m_nb_nodes = 0;
+  m_neq = 0;
+  m_nb_offsets = 0;
+  m_offsets.clear();
+  m_computed.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
@@ -0,0 +1,98 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_ScatterMap_hpp
+#define cf3_Math_LSS_ScatterMap_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Matrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file ScatterMap.hpp Cached element-to-matrix scatter offsets
+
+  For a static sparsity, the positions of the entries of each element matrix in the matrix storage never change. ScatterMap computes
+  them the first time an element is assembled, after which adding the element matrix is a plain indexed add into the matrix values.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class LSS_API ScatterMap
+{
+public:
+  ScatterMap();
+
+  /// Prepare for assembly into matrix, for nb_elements elements with nb_nodes nodes each.
+  /// Offsets are kept if the matrix, its sparsity and the sizes did not change since the last call.
+  /// Not thread-safe, call this before starting concurrent assembly
+  /// @return false if the matrix does not support direct assembly
+  bool setup(Matrix& matrix, const Uint nb_elements, const Uint nb_nodes);
+
+  /// Add the element matrix of the given element, computing its offsets on first use.
+  /// Several threads may assemble different elements concurrently, as long as these touch different rows of the matrix,
+  /// which is the same requirement as for Matrix::add_values
+  /// @pre setup returned true, and values.indices is the same for each call with the same element_idx
+  void add_values(const Uint element_idx, const BlockAccumulator& values)
+  {
+    cf3_assert(element_idx < m_computed.size());
+    cf3_assert(values.block_size() == m_nb_nodes);
+    Uint* offsets = &m_offsets[element_idx*m_nb_offsets];
+    if(!m_computed[element_idx])
+    {
+      m_matrix->scatter_offsets(values, offsets);
+      m_computed[element_idx] = 1;
+    }
+
+    const Uint nb_rows = m_nb_nodes*m_neq;
+    const Real* element_values = values.mat.data();
+    for(Uint row = 0; row != nb_rows; ++row)
+    {
+      for(Uint node = 0; node != m_nb_nodes; ++node, ++offsets, element_values += m_neq)
+      {
+        if(*offsets == Matrix::scatter_skip)
+          continue;
+        Real* matrix_values = m_values + *offsets;
+        for(Uint eq = 0; eq != m_neq; ++eq)
+          matrix_values[eq] += element_values[eq];
+      }
+    }
+  }
+
+  /// Forget all cached offsets
+  void clear();
+
+private:
+  Matrix* m_matrix;
+  Real* m_values;
+  Uint m_sparsity_generation;
+  Uint m_nb_nodes;
+  Uint m_neq;
+  /// Number of offsets per element
+  Uint m_nb_offsets;
+  std::vector<Uint> m_offsets;
+  /// Flags the elements for which the offsets were computed. Not a vector<bool>, so different threads can set different elements
+  std::vector<char> m_computed;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_ScatterMap_hpp
@@ -58,8 +58,11 @@ public:
 
   virtual Real compute_residual() = 0;
   
-  /// Set the coordinates, picked at indices in used_nodes from the coords table. This can be useful for some algebraic multigrid preconditioners such as ML
-  virtual void set_coordinates(common::PE::CommPattern& cp, const common::Table<Real>& coords, const common::List<Uint>& used_nodes, const std::vector<bool>& periodic_links_active) = 0;
+  /// Set the coordinates, picked at indices in used_nodes from the coords table. This can be useful for some algebraic multigrid preconditioners such as ML.
+  /// The default ignores them, for the strategies that don't use the coordinates.
+  virtual void set_coordinates(common::PE::CommPattern& cp, const common::Table<Real>& coords, const common::List<Uint>& used_nodes, const std::vector<bool>& periodic_links_active)
+  {
+  }
 }; // end of class SolutionStrategy
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -50,7 +50,7 @@ common::ComponentBuilder < LSS::System, LSS::System, LSS::LibLSS > System_Builde
 LSS::System::System(const std::string& name) :
   Component(name)
 {
-  options().add( "matrix_builder" , "cf3.math.LSS.TrilinosFEVbrMatrix")
+  options().add( "matrix_builder" , default_matrix_builder())
     .pretty_name("Matrix Builder")
     .description("Name for the builder used to create the LSS matrix")
     .mark_basic();
@@ -60,11 +60,15 @@ LSS::System::System(const std::string& name) :
     .description("Name for the builder used for the vectors. If left empty, this is obtained from the vector_type property of the matrix")
     .mark_basic();
 
-  options().add("solution_strategy", "cf3.math.LSS.TrilinosStratimikosStrategy")
+  options().add("solution_strategy", default_solution_strategy())
     .pretty_name("Solution Strategy")
     .description("Name of the builder that will be used to create the solution strategy")
     .mark_basic();
     
+  options().add("scatter_assembly", true)
+    .pretty_name("Scatter Assembly")
+    .description("Let element loops cache the position of each element matrix entry in the matrix, if the matrix supports this. Speeds up repeated assembly at the cost of extra memory");
+
   options().add("solution_strategy_component", m_solution_strategy)
     .pretty_name("Solution Strategy Component")
     .description("Component to use as solution strategy for the next solve. Overrides any internally created strategy")
@@ -79,6 +83,26 @@ LSS::System::System(const std::string& name) :
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+std::string LSS::System::default_matrix_builder()
+{
+#ifdef CF3_HAVE_TRILINOS
+  return "cf3.math.LSS.TrilinosFEVbrMatrix";
+#else
+  return "cf3.math.LSS.NativeCrsMatrix";
+#endif
+}
+
+std::string LSS::System::default_solution_strategy()
+{
+#ifdef CF3_HAVE_TRILINOS
+  return "cf3.math.LSS.TrilinosStratimikosStrategy";
+#else
+  return "cf3.math.LSS.NativeStrategy";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void LSS::System::create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector<Uint>& node_connectivity, std::vector<Uint>& starting_indices, const std::vector<Uint>& periodic_links_nodes, const std::vector<bool>& periodic_links_active)
 {
   if (is_created())
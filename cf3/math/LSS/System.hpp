@@ -68,6 +68,12 @@ public:
   /// Default constructor
   System(const std::string& name);
 
+  /// Builder name of the default matrix: the Trilinos VBR matrix if Trilinos is available, the native matrix otherwise
+  static std::string default_matrix_builder();
+
+  /// Builder name of the default solution strategy, matching default_matrix_builder
+  static std::string default_solution_strategy();
+
   /// Setup sparsity structure
   /// @todo action for it
   void create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector<Uint>& node_connectivity, std::vector<Uint>& starting_indices, const std::vector<Uint>& periodic_links_nodes = std::vector<Uint>(), const std::vector<bool>& periodic_links_active = std::vector<bool>());
@@ -6,6 +6,7 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 
@@ -69,8 +70,8 @@ TrilinosCrsMatrix::TrilinosCrsMatrix(const std::string& name) :
   m_neq(0),
   m_num_my_elements(0),
   m_p2m(0),
-  m_converted_indices(0),
-  m_comm(common::PE::Comm::instance().communicator())
+  m_comm(common::PE::Comm::instance().communicator()),
+  m_consecutive_equations(false)
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
 }
@@ -105,12 +106,16 @@ void TrilinosCrsMatrix::create_blocked(common::PE::CommPattern& cp, const Variab
   std::vector<Uint> my_ranks;
 
   create_map_data(cp, vars, m_p2m, my_global_elements, my_ranks, m_num_my_elements, periodic_links_nodes, periodic_links_active);
+  m_consecutive_equations = true;
+  for(Uint i = 0; i != m_p2m.size() && m_consecutive_equations; i += total_nb_eq)
+  {
+    for(Uint j = 1; j != total_nb_eq; ++j)
+      m_consecutive_equations = m_consecutive_equations && m_p2m[i+j] == m_p2m[i] + static_cast<int>(j);
+  }
   std::vector<int> num_indices_per_row; num_indices_per_row.reserve(m_num_my_elements);
   std::vector<int> indices_per_row;
   create_indices_per_row(cp, vars, node_connectivity, starting_indices, m_p2m, num_indices_per_row, indices_per_row, periodic_links_nodes, periodic_links_active);
 
-  m_converted_indices.resize(*std::max_element(num_indices_per_row.begin(), num_indices_per_row.end()));
-
   // rowmap, ghosts not present
   Epetra_Map rowmap(-1,m_num_my_elements,&my_global_elements[0],0,m_comm);
 
@@ -143,6 +148,7 @@ void TrilinosCrsMatrix::create_blocked(common::PE::CommPattern& cp, const Variab
   // set class properties
   m_is_created=true;
   m_neq=total_nb_eq;
+  sparsity_changed();
   CFdebug << "Rank " << common::PE::Comm::instance().rank() << ": Created a " << m_mat->NumGlobalCols() << " x " << m_mat->NumGlobalRows() << " trilinos matrix with " << m_mat->NumGlobalNonzeros() << " non-zero elements and " << m_num_my_elements << " local rows" << CFendl;
 }
 
@@ -159,6 +165,8 @@ void TrilinosCrsMatrix::destroy()
   m_neq=0;
   m_num_my_elements=0;
   m_is_created=false;
+  m_consecutive_equations=false;
+  sparsity_changed();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -205,20 +213,23 @@ void TrilinosCrsMatrix::set_values(const BlockAccumulator& values)
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
+  // Per-thread buffer, so element loops running on several threads can set disjoint rows simultaneously
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
   }
   // insert the values
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] < m_num_my_elements)
-        TRILINOS_THROW(m_mat->ReplaceMyValues(m_converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&m_converted_indices[0]));
+      if(converted_indices[i*m_neq+j] < m_num_my_elements)
+        TRILINOS_THROW(m_mat->ReplaceMyValues(converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&converted_indices[0]));
     }
   }
 }
@@ -231,20 +242,78 @@ void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
+  // Per-thread buffer, so element loops running on several threads can add to disjoint rows simultaneously
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
   }
   // insert the values
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] < m_num_my_elements)
-        TRILINOS_THROW(m_mat->SumIntoMyValues(m_converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&m_converted_indices[0]));
+      if(converted_indices[i*m_neq+j] < m_num_my_elements)
+        TRILINOS_THROW(m_mat->SumIntoMyValues(converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&converted_indices[0]));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Real* TrilinosCrsMatrix::scatter_values()
+{
+  if(!m_is_created || !m_consecutive_equations || !m_mat->StorageOptimized())
+    return nullptr;
+
+  int* index_offsets;
+  int* indices;
+  Real* values;
+  if(m_mat->ExtractCrsDataPointers(index_offsets, indices, values) != 0)
+    return nullptr;
+
+  return values;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosCrsMatrix::scatter_offsets(const BlockAccumulator& values, Uint* offsets)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(m_consecutive_equations);
+  int* index_offsets;
+  int* indices;
+  Real* matrix_values;
+  TRILINOS_THROW(m_mat->ExtractCrsDataPointers(index_offsets, indices, matrix_values));
+
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    for(int a = 0; a != m_neq; ++a)
+    {
+      const int row = m_p2m[values.indices[i]*m_neq+a];
+      for(Uint j = 0; j != nb_nodes; ++j, ++offsets)
+      {
+        if(row >= m_num_my_elements)
+        {
+          *offsets = scatter_skip;
+          continue;
+        }
+        // The column map is built from the same global elements as the row map, owned ones first, so the local column index
+        // of a node is its m_p2m entry on every rank, as in add_values. Column indices are sorted after FillComplete, and the
+        // equations of each node are consecutive
+        const int col = m_p2m[values.indices[j]*m_neq];
+        const int* row_begin = indices + index_offsets[row];
+        const int* row_end = indices + index_offsets[row+1];
+        const int* col_it = std::lower_bound(row_begin, row_end, col);
+        if((row_end - col_it) < static_cast<int>(m_neq) || *col_it != col || col_it[m_neq-1] != col + static_cast<int>(m_neq) - 1)
+          throw common::BadValue(FromHere(), "Trying to access an illegal entry.");
+        *offsets = col_it - indices;
+      }
     }
   }
 }
@@ -262,13 +331,15 @@ void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
   int* extracted_indices;
   cf3_assert(values.mat.rows() == num_entries);
   std::map<int, int> reverse_idx_map;
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
     {
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
       reverse_idx_map[m_p2m[local_start_idx+j]] = i*m_neq + j;
     }
   }
@@ -277,9 +348,9 @@ void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] >= m_num_my_elements)
+      if(converted_indices[i*m_neq+j] >= m_num_my_elements)
         continue;
-      TRILINOS_THROW(m_mat->ExtractMyRowView(m_converted_indices[i*m_neq+j], extracted_num_entries, extracted_values, extracted_indices));
+      TRILINOS_THROW(m_mat->ExtractMyRowView(converted_indices[i*m_neq+j], extracted_num_entries, extracted_values, extracted_indices));
       for(int k = 0; k != extracted_num_entries; ++k)
       {
         const std::map<int,int>::const_iterator it = reverse_idx_map.find(extracted_indices[k]);
@@ -529,10 +600,11 @@ void TrilinosCrsMatrix::clone_to(Matrix &other)
   other_ptr->m_neq = m_neq;
   other_ptr->m_num_my_elements = m_num_my_elements;
   other_ptr->m_p2m = m_p2m;
-  other_ptr->m_converted_indices = m_converted_indices;
   other_ptr->m_node_connectivity = m_node_connectivity;
   other_ptr->m_starting_indices = m_starting_indices;
   other_ptr->m_symmetric_dirichlet_values = m_symmetric_dirichlet_values;
+  other_ptr->m_consecutive_equations = m_consecutive_equations;
+  other_ptr->sparsity_changed();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -542,6 +614,8 @@ void TrilinosCrsMatrix::read_native(const common::URI& file)
   EpetraExt::readEpetraLinearSystem(file.path(), m_comm, &m_mat);
   
   m_is_created = true;
+  m_consecutive_equations = false;
+  sparsity_changed();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
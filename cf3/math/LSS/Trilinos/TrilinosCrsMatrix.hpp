@@ -121,6 +121,16 @@ public:
 
   //@} END EFFICCIENT ACCESS
 
+  /// @name SCATTER ASSEMBLY
+  //@{
+
+  /// Epetra value array, only available when the storage is optimized and the equations of each node are numbered consecutively
+  Real* scatter_values();
+
+  void scatter_offsets(const BlockAccumulator& values, Uint* offsets);
+
+  //@} END SCATTER ASSEMBLY
+
   /// @name MISCELLANEOUS
   //@{
 
@@ -163,6 +173,7 @@ public:
   void replace_epetra_matrix(const Teuchos::RCP<Epetra_CrsMatrix>& mat)
   {
     m_mat = mat;
+    sparsity_changed();
   }
   
   /// Store the local matrix GIDs belonging to each variable in the given vector
@@ -222,12 +233,12 @@ private:
   /// mapper array, maps from process local numbering to matrix local numbering (because ghost nodes need to be ordered to the back)
   std::vector<int> m_p2m;
 
-  /// a helper array used in set/add/get_values to avoid frequent new+free combo
-  std::vector<int> m_converted_indices;
-
   /// Copy of the connectivity data
   std::vector<int> m_node_connectivity, m_starting_indices;
 
+  /// True if the equations of each node have consecutive matrix indices, which is required for scatter assembly
+  bool m_consecutive_equations;
+
   /// Cache matrix values in case of symmetric dirichlet, so they can be applied multiple times even if the matrix is not changed
   typedef std::map<int, Real> DirichletEntryT;
   typedef std::map<int, DirichletEntryT> DirichletMapT;
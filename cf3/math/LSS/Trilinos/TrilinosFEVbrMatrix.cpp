@@ -60,7 +60,6 @@ TrilinosFEVbrMatrix::TrilinosFEVbrMatrix(const std::string& name) :
   m_blockrow_size(0),
   m_blockcol_size(0),
   m_p2m(0),
-  m_converted_indices(0),
   m_comm(common::PE::Comm::instance().communicator())
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
@@ -234,9 +233,11 @@ void TrilinosFEVbrMatrix::set_values(const BlockAccumulator& values)
   const int numblocks=values.indices.size();
   const int rowoffset=(numblocks-1)*m_neq;
   const int neqneq=m_neq*m_neq;
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
-  int* idxs=(int*)&m_converted_indices[0];
+  // Per-thread buffer, so element loops running on several threads can access disjoint block rows simultaneously
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(numblocks);
+  for (int i=0; i<(const int)numblocks; i++) converted_indices[i]=m_p2m[values.indices[i]];
+  int* idxs=(int*)&converted_indices[0];
   for (int irow=0; irow<(const int)numblocks; irow++)
   {
     if (idxs[irow]<m_blockrow_size)
@@ -270,49 +271,6 @@ void TrilinosFEVbrMatrix::set_values(const BlockAccumulator& values)
 
 void TrilinosFEVbrMatrix::add_values(const BlockAccumulator& values)
 {
-/* TRILINOS-ADVICED
-  cf3_assert(m_is_created);
-  const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
-  int* idxs=(int*)&m_converted_indices[0];
-  for (int irow=0; irow<(const int)numblocks; irow++)
-    if (idxs[irow]<m_blockrow_size)
-    {
-      TRILINOS_ASSERT(m_mat->BeginSumIntoMyValues(idxs[irow],numblocks,idxs));
-      for (int icol=0; icol<numblocks; icol++)
-        TRILINOS_ASSERT(m_mat->SubmitBlockEntry((double*)values.mat.data()+irow*m_neq+icol*m_neq*m_neq*numblocks,numblocks*m_neq,m_neq,m_neq));
-      TRILINOS_ASSERT(m_mat->EndSubmitEntries());
-    }
-*/
-/* MANUAL FILL
-  cf3_assert(m_is_created);
-  Epetra_SerialDenseMatrix **val;
-  int* colindices;
-  int blockrowsize;
-  int dummyneq;
-  int hits=0;
-  const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
-  int* idxs=(int*)&m_converted_indices[0];
-  for (int irow=0; irow<(const int)numblocks; irow++)
-  {
-    if (idxs[irow]<m_blockrow_size)
-    {
-      TRILINOS_ASSERT(m_mat->ExtractMyBlockRowView(idxs[irow],dummyneq,blockrowsize,colindices,val));
-      for (int j=0; j<(const int)blockrowsize; j++)
-        for (int k=0; k<(const int)numblocks; k++)
-          if (colindices[j]==idxs[k])
-            for (int l=0; l<(const int)m_neq; l++)
-              for (int m=0; m<(const int)m_neq; m++)
-                val[j][0](l,m)+=values.mat(irow*m_neq+l,k*m_neq+m);
-      hits++;
-      if (hits==numblocks) break;
-    }
-  }
-*/
-/* FINAL OPTIMIZED */
   cf3_assert(m_is_created);
   Epetra_SerialDenseMatrix **val;
   int* colindices;
@@ -322,9 +280,11 @@ void TrilinosFEVbrMatrix::add_values(const BlockAccumulator& values)
   const int numblocks=values.indices.size();
   const int rowoffset=(numblocks-1)*m_neq;
   const int neqneq=m_neq*m_neq;
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
-  int* idxs=(int*)&m_converted_indices[0];
+  // Per-thread buffer, so element loops running on several threads can access disjoint block rows simultaneously
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(numblocks);
+  for (int i=0; i<(const int)numblocks; i++) converted_indices[i]=m_p2m[values.indices[i]];
+  int* idxs=(int*)&converted_indices[0];
   for (int irow=0; irow<(const int)numblocks; irow++)
   {
     if (idxs[irow]<m_blockrow_size)
@@ -367,9 +327,11 @@ void TrilinosFEVbrMatrix::get_values(BlockAccumulator& values)
   const int numblocks=values.indices.size();
   const int rowoffset=(numblocks-1)*m_neq;
   const int neqneq=m_neq*m_neq;
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  for (int i=0; i<(const int)numblocks; i++) m_converted_indices[i]=m_p2m[values.indices[i]];
-  int* idxs=(int*)&m_converted_indices[0];
+  // Per-thread buffer, so element loops running on several threads can access disjoint block rows simultaneously
+  static thread_local std::vector<int> converted_indices;
+  converted_indices.resize(numblocks);
+  for (int i=0; i<(const int)numblocks; i++) converted_indices[i]=m_p2m[values.indices[i]];
+  int* idxs=(int*)&converted_indices[0];
   values.mat.setConstant(0.);
   for (int irow=0; irow<(const int)numblocks; irow++)
   {
@@ -49,7 +49,6 @@ TrilinosVector::TrilinosVector(const std::string& name) :
   m_blockrow_size(0),
   m_is_created(false),
   m_vec(0),
-  m_converted_indices(0),
   m_comm(common::PE::Comm::instance().communicator())
 {
   regist_signal( "print_native" )
@@ -174,8 +173,6 @@ void TrilinosVector::set_rhs_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -191,8 +188,6 @@ void TrilinosVector::add_rhs_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -210,8 +205,6 @@ void TrilinosVector::get_rhs_values(BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -229,8 +222,6 @@ void TrilinosVector::set_sol_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -248,8 +239,6 @@ void TrilinosVector::add_sol_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -267,8 +256,6 @@ void TrilinosVector::get_sol_values(BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -422,7 +409,6 @@ void TrilinosVector::clone_to(Vector &other)
   other_ptr->m_blockrow_size = m_blockrow_size;
   other_ptr->m_is_created = m_is_created;
   other_ptr->m_p2m = m_p2m;
-  other_ptr->m_converted_indices = m_converted_indices;
   other_ptr->m_comm_pattern = m_comm_pattern;
   m_comm_pattern->insert(other_ptr->name(), other_ptr->m_data, true);
 }
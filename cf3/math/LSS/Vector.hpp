@@ -12,6 +12,7 @@
 #include <boost/utility.hpp>
 
 #include "math/LSS/LibLSS.hpp"
+#include "common/BasicExceptions.hpp"
 #include "common/PE/CommPattern.hpp"
 #include "common/Log.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
@@ -156,8 +157,11 @@ public:
   /// Update any stored ghost nodes
   virtual void sync() = 0;
   
-  /// Read a vector in the native file format
-  virtual void read_native(const common::URI& filename, const std::string type = "") = 0;
+  /// Read a vector in the native file format. The default throws, for the vectors that have no file format of their own.
+  virtual void read_native(const common::URI& filename, const std::string type = "")
+  {
+    throw common::NotSupported(FromHere(), "Vector " + uri().string() + " can't be read from a file");
+  }
 
   //@} END MISCELLANEOUS
 
@@ -71,6 +71,8 @@ Dictionary::Dictionary ( const std::string& name  ) :
 
   m_connectivity = create_static_component< common::DynTable<SpaceElem> >("element_connectivity");
 
+  m_periodic_inverse_links_valid = false;
+
   options().add("dimension",m_dim).link_to(&m_dim);
 
   // Signals
@@ -441,7 +443,92 @@ void Dictionary::rebuild_map_glb_to_loc()
   m_glb_to_loc->reserve(size());
   for (Uint n=0; n<size(); ++n)
     m_glb_to_loc->push_back(glb_idx()[n],n);
-  m_glb_to_loc->sort_keys();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Dictionary::PeriodicInverseLinks& Dictionary::periodic_inverse_links()
+{
+  Handle<common::List<Uint> const> periodic_links_nodes_h(get_child("periodic_links_nodes"));
+  Handle<common::List<bool> const> periodic_links_active_h(get_child("periodic_links_active"));
+
+  // A removed list shows up as a null handle, which is only consistent with an empty cache
+  if(m_periodic_inverse_links_valid
+     && periodic_links_nodes_h == m_periodic_links_nodes_used
+     && periodic_links_active_h == m_periodic_links_active_used
+     && (is_null(periodic_links_nodes_h) ? m_periodic_inverse_links.targets.empty() : periodic_links_nodes_h->size() == size()))
+    return m_periodic_inverse_links;
+
+  m_periodic_inverse_links.targets.clear();
+  m_periodic_inverse_links.offsets.assign(1, 0);
+  m_periodic_inverse_links.sources.clear();
+  m_periodic_links_nodes_used = periodic_links_nodes_h;
+  m_periodic_links_active_used = periodic_links_active_h;
+  m_periodic_inverse_links_valid = true;
+
+  if(is_null(periodic_links_nodes_h) || is_null(periodic_links_active_h))
+    return m_periodic_inverse_links;
+
+  const common::List<Uint>& periodic_links_nodes = *periodic_links_nodes_h;
+  const common::List<bool>& periodic_links_active = *periodic_links_active_h;
+  const Uint nb_nodes = periodic_links_nodes.size();
+
+  // Follow the chains once, counting the sources for each final target
+  std::vector<Uint> final_targets(nb_nodes);
+  std::vector<Uint> nb_sources(nb_nodes, 0);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(!periodic_links_active[i])
+      continue;
+    Uint final_target_node = periodic_links_nodes[i];
+    while(periodic_links_active[final_target_node])
+      final_target_node = periodic_links_nodes[final_target_node];
+    final_targets[i] = final_target_node;
+    ++nb_sources[final_target_node];
+  }
+
+  // Offsets for each target, stored temporarily per node
+  std::vector<Uint> node_offsets(nb_nodes, 0);
+  Uint nb_links = 0;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(nb_sources[i] == 0)
+      continue;
+    node_offsets[i] = nb_links;
+    nb_links += nb_sources[i];
+    m_periodic_inverse_links.targets.push_back(i);
+    m_periodic_inverse_links.offsets.push_back(nb_links);
+  }
+
+  // Fill the sources, in increasing order for each target
+  m_periodic_inverse_links.sources.resize(nb_links);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(periodic_links_active[i])
+      m_periodic_inverse_links.sources[node_offsets[final_targets[i]]++] = i;
+  }
+
+  CFdebug << "Built inverse periodic links for " << uri().path() << ": " << m_periodic_inverse_links.targets.size() << " targets, " << nb_links << " linked nodes" << CFendl;
+
+  return m_periodic_inverse_links;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Dictionary::invalidate_periodic_inverse_links()
+{
+  m_periodic_inverse_links_valid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Dictionary::invalidate_comm_pattern()
+{
+  if(is_not_null(m_comm_pattern))
+  {
+    remove_component(*m_comm_pattern);
+    m_comm_pattern.reset();
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
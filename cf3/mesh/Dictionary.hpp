@@ -9,7 +9,7 @@
 
 #include <boost/cstdint.hpp>
 
-#include "common/Map.hpp"
+#include "common/HashMap.hpp"
 #include "mesh/LibMesh.hpp"
 #include "mesh/Field.hpp"
 
@@ -44,7 +44,19 @@ friend class Mesh; // dirty (but harmless) hack, because geometry coordinates fi
 public:
 
   /// Type for the mapping from global to local IDs
-  typedef common::Map<boost::uint64_t,Uint> GlbToLocT;
+  typedef common::HashMap<boost::uint64_t,Uint> GlbToLocT;
+
+  /// Inverse of the periodic links, in compressed row storage.
+  /// The nodes linking to targets[i], directly or through a chain of links, are sources[offsets[i]] to sources[offsets[i+1]-1]
+  struct PeriodicInverseLinks
+  {
+    /// Nodes that are the final target of at least one periodic link, in increasing order
+    std::vector<Uint> targets;
+    /// Start of the sources for each target, with an extra entry marking the end
+    std::vector<Uint> offsets;
+    /// Linked nodes grouped by target, in increasing order for each target
+    std::vector<Uint> sources;
+  };
 
   /// Contructor
   /// @param name of the component
@@ -145,6 +157,18 @@ public:
 
   virtual void rebuild_node_to_element_connectivity() = 0;
 
+  /// Inverse of the periodic links stored in the periodic_links_nodes and periodic_links_active lists.
+  /// Built on first use and cached until the lists are replaced or resized, or invalidate_periodic_inverse_links is called.
+  /// Empty if the dictionary has no periodic links.
+  const PeriodicInverseLinks& periodic_inverse_links();
+
+  /// Discard the cached inverse periodic links, to be called after modifying the periodic links
+  void invalidate_periodic_inverse_links();
+
+  /// Remove the comm pattern, to be called after reordering the rows. Fields that were parallelized with it
+  /// are parallelized again with a new comm pattern on their next synchronization.
+  void invalidate_comm_pattern();
+
 private: // functions
 
   void config_space();
@@ -183,6 +207,13 @@ private:
   std::vector< Handle<Field> > m_fields;
 
   Uint m_dim;
+
+  /// Cached result of periodic_inverse_links
+  PeriodicInverseLinks m_periodic_inverse_links;
+  bool m_periodic_inverse_links_valid;
+  /// Lists used to build the cached inverse links, to detect when they are replaced
+  Handle<common::List<Uint> const> m_periodic_links_nodes_used;
+  Handle<common::List<bool> const> m_periodic_links_active_used;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
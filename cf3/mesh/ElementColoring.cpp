@@ -0,0 +1,103 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/PropertyList.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Functions.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < ElementColoring, Component, LibMesh > ElementColoring_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::ElementColoring ( const std::string& name ) :
+  Component ( name ),
+  m_is_valid(false),
+  m_nb_elements(0),
+  m_nb_nodes(0)
+{
+  properties()["brief"] = std::string("Groups the parent elements into colors that have no nodes in common");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::~ElementColoring()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector< std::vector<Uint> >& ElementColoring::colors()
+{
+  if(!is_valid())
+    build();
+
+  return m_colors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint ElementColoring::nb_colors()
+{
+  return colors().size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementColoring::is_valid() const
+{
+  if(!m_is_valid)
+    return false;
+
+  const Entities& elements = entities();
+  return elements.size() == m_nb_elements && elements.geometry_fields().size() == m_nb_nodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::invalidate()
+{
+  m_is_valid = false;
+  m_colors.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::build()
+{
+  const Entities& elements = entities();
+  color_elements(elements, m_colors);
+  m_nb_elements = elements.size();
+  m_nb_nodes = elements.geometry_fields().size();
+  m_is_valid = true;
+
+  CFdebug << "Colored " << m_nb_elements << " elements of " << elements.uri().path() << " using " << m_colors.size() << " colors" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Entities& ElementColoring::entities() const
+{
+  Handle<Entities const> parent_entities(parent());
+  cf3_assert(is_not_null(parent_entities));
+  return *parent_entities;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
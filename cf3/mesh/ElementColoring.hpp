@@ -0,0 +1,79 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementColoring_hpp
+#define cf3_mesh_ElementColoring_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Component.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+  class Entities;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Cached coloring of the parent Entities, grouping the elements so that no two elements
+/// with the same color share a node. Elements of a single color can be processed in parallel
+/// and scatter to nodal fields or the linear system without locking.
+/// The coloring is rebuilt on first access after it was invalidated, which happens when the mesh
+/// raises the mesh_loaded or mesh_changed events, or when the number of elements or nodes changes.
+class Mesh_API ElementColoring : public common::Component
+{
+public:
+
+  /// Contructor
+  /// @param name of the component
+  ElementColoring ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ElementColoring();
+
+  /// Get the class name
+  static std::string type_name () { return "ElementColoring"; }
+
+  /// For each color, the sorted element indices that have that color. Rebuilds the coloring if needed.
+  const std::vector< std::vector<Uint> >& colors();
+
+  /// Number of colors. Rebuilds the coloring if needed.
+  Uint nb_colors();
+
+  /// True if the stored coloring is still up-to-date with the parent entities
+  bool is_valid() const;
+
+  /// Mark the coloring as outdated, so it gets rebuilt on the next access
+  void invalidate();
+
+private:
+  /// Build the coloring for the parent entities
+  void build();
+
+  /// The entities that are colored
+  const Entities& entities() const;
+
+  std::vector< std::vector<Uint> > m_colors;
+
+  bool m_is_valid;
+
+  /// Number of elements at the time of the build
+  Uint m_nb_elements;
+
+  /// Number of geometry nodes at the time of the build
+  Uint m_nb_nodes;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementColoring_hpp
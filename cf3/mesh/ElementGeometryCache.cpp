@@ -0,0 +1,131 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+
+#include "common/Builder.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementGeometryCache.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Space.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < ElementGeometryCache, Component, LibMesh > ElementGeometryCache_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementGeometryCache::ElementGeometryCache ( const std::string& name ) :
+  Component ( name ),
+  m_enabled(false),
+  m_max_points(32),
+  m_is_valid(false),
+  m_nb_elements(0),
+  m_nb_nodes(0)
+{
+  properties()["brief"] = std::string("Caches the jacobians and shape function gradients of the parent elements at quadrature points");
+
+  options().add("enabled", m_enabled)
+    .pretty_name("Enabled")
+    .description("Store the geometric factors of the elements at each point where they are requested")
+    .link_to(&m_enabled)
+    .attach_trigger(boost::bind(&ElementGeometryCache::invalidate, this));
+
+  options().add("max_points", m_max_points)
+    .pretty_name("Maximum Points")
+    .description("Maximum number of points stored in the cache. Requests for more points are not cached.")
+    .link_to(&m_max_points);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementGeometryCache::~ElementGeometryCache()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementGeometryCache::is_valid() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return valid_entities();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementGeometryCache::invalidate()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_is_valid = false;
+  m_points.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint ElementGeometryCache::nb_points() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return valid_entities() ? m_points.size() : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementGeometryCache::valid_entities() const
+{
+  if(!m_is_valid)
+    return false;
+
+  const Entities& elements = entities();
+  return elements.size() == m_nb_elements && elements.geometry_fields().size() == m_nb_nodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementGeometryCache::reset()
+{
+  const Entities& elements = entities();
+  m_points.clear();
+  m_nb_elements = elements.size();
+  m_nb_nodes = elements.geometry_fields().size();
+  m_is_valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Entities& ElementGeometryCache::entities() const
+{
+  Handle<Entities const> parent_entities(parent());
+  cf3_assert(is_not_null(parent_entities));
+  return *parent_entities;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Table<Real>& ElementGeometryCache::coordinates() const
+{
+  return entities().geometry_fields().coordinates();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Connectivity& ElementGeometryCache::connectivity() const
+{
+  return entities().geometry_space().connectivity();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
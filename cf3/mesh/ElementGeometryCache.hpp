@@ -0,0 +1,258 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementGeometryCache_hpp
+#define cf3_mesh_ElementGeometryCache_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/make_shared.hpp>
+#include <boost/mpl/assert.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "common/Component.hpp"
+#include "common/Log.hpp"
+#include "common/Table.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/ElementData.hpp"
+#include "mesh/LibMesh.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+  class Entities;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Cached geometric factors of the parent Entities: for each requested point in mapped coordinates,
+/// the jacobian, its inverse and determinant and the shape function gradient in physical coordinates,
+/// for all elements at once. The data is stored as a structure of arrays, with the element index
+/// running fastest, so loops over the elements read contiguous memory.
+/// The cache is only filled when the "enabled" option is set, and is emptied when the mesh raises the
+/// mesh_loaded or mesh_changed events, or when the number of elements or nodes changes. Code that
+/// moves the nodes must raise mesh_changed as well.
+class Mesh_API ElementGeometryCache : public common::Component
+{
+public:
+
+  /// Geometric factors for all elements at a single point
+  struct PointData
+  {
+    /// The mapped coordinates of the point
+    std::vector<Real> mapped_coords;
+    /// Jacobian determinant, indexed by element
+    std::vector<Real> determinants;
+    /// Jacobian matrix, entry (i,j) of element e is at (i*dimensionality + j)*nb_elements + e
+    std::vector<Real> jacobians;
+    /// Inverse jacobian, same layout as the jacobian
+    std::vector<Real> inverse_jacobians;
+    /// Shape function gradient in physical coordinates, entry (i,n) of element e is at (i*nb_nodes + n)*nb_elements + e
+    std::vector<Real> gradients;
+
+    /// Number of elements
+    Uint nb_elements() const { return determinants.size(); }
+
+    /// True if the point is at exactly the given mapped coordinates
+    template<typename MappedCoordsT>
+    bool matches(const MappedCoordsT& coords) const
+    {
+      for(Uint i = 0; i != mapped_coords.size(); ++i)
+      {
+        if(coords[i] != mapped_coords[i])
+          return false;
+      }
+      return true;
+    }
+
+    /// Copy the jacobian of the given element into a fixed-size matrix
+    template<typename MatrixT>
+    void copy_jacobian(const Uint elem, MatrixT& jacobian) const
+    {
+      copy_matrix(jacobians, elem, jacobian);
+    }
+
+    /// Copy the inverse jacobian of the given element into a fixed-size matrix
+    template<typename MatrixT>
+    void copy_jacobian_inverse(const Uint elem, MatrixT& jacobian_inverse) const
+    {
+      copy_matrix(inverse_jacobians, elem, jacobian_inverse);
+    }
+
+    /// Copy the physical shape function gradient of the given element into a fixed-size matrix
+    template<typename MatrixT>
+    void copy_gradient(const Uint elem, MatrixT& gradient) const
+    {
+      copy_matrix(gradients, elem, gradient);
+    }
+
+  private:
+    template<typename MatrixT>
+    void copy_matrix(const std::vector<Real>& data, const Uint elem, MatrixT& matrix) const
+    {
+      const Uint stride = nb_elements();
+      const Uint nb_rows = matrix.rows();
+      const Uint nb_cols = matrix.cols();
+      cf3_assert(data.size() == stride * nb_rows * nb_cols);
+      const Real* entry = &data[elem];
+      for(Uint i = 0; i != nb_rows; ++i)
+      {
+        for(Uint j = 0; j != nb_cols; ++j)
+        {
+          matrix(i, j) = *entry;
+          entry += stride;
+        }
+      }
+    }
+  };
+
+  /// Contructor
+  /// @param name of the component
+  ElementGeometryCache ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ElementGeometryCache();
+
+  /// Get the class name
+  static std::string type_name () { return "ElementGeometryCache"; }
+
+  /// True if the "enabled" option is set
+  bool is_enabled() const { return m_enabled; }
+
+  /// True if the stored points are still up-to-date with the parent entities
+  bool is_valid() const;
+
+  /// Discard all stored points
+  void invalidate();
+
+  /// Number of stored points
+  Uint nb_points() const;
+
+  /// Geometric factors at the given mapped coordinates, computed for all elements on the first request.
+  /// EtypeT must be the element type of the parent entities, and a volume element type.
+  /// Returns a null pointer if the cache is disabled or already holds the maximum number of points.
+  /// Safe to call from several threads at once.
+  template<typename EtypeT>
+  boost::shared_ptr<PointData const> point(const typename EtypeT::MappedCoordsT& mapped_coords)
+  {
+    BOOST_MPL_ASSERT_RELATION( static_cast<int>(EtypeT::dimension), ==, static_cast<int>(EtypeT::dimensionality) );
+
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if(!m_enabled)
+      return boost::shared_ptr<PointData const>();
+
+    if(!valid_entities())
+      reset();
+
+    for(Uint i = 0; i != m_points.size(); ++i)
+    {
+      if(m_points[i]->matches(mapped_coords))
+        return m_points[i];
+    }
+
+    if(m_points.size() >= m_max_points)
+      return boost::shared_ptr<PointData const>();
+
+    boost::shared_ptr<PointData> result = boost::make_shared<PointData>();
+    compute_point<EtypeT>(mapped_coords, *result);
+    m_points.push_back(result);
+
+    CFdebug << "Cached geometric factors for " << result->nb_elements() << " elements of " << uri().path() << " at point " << m_points.size() << CFendl;
+
+    return result;
+  }
+
+private:
+  template<typename EtypeT>
+  void compute_point(const typename EtypeT::MappedCoordsT& mapped_coords, PointData& result) const
+  {
+    static const Uint dim = EtypeT::dimensionality;
+    static const Uint nb_nodes = EtypeT::nb_nodes;
+
+    const common::Table<Real>& coords = coordinates();
+    const Connectivity::ArrayT& connectivity_array = connectivity().array();
+    const Uint nb_elems = connectivity_array.size();
+
+    result.mapped_coords.assign(mapped_coords.data(), mapped_coords.data() + dim);
+    result.determinants.resize(nb_elems);
+    result.jacobians.resize(dim*dim*nb_elems);
+    result.inverse_jacobians.resize(dim*dim*nb_elems);
+    result.gradients.resize(dim*nb_nodes*nb_elems);
+
+    typename EtypeT::NodesT nodes;
+    typename EtypeT::JacobianT jacobian;
+    typename EtypeT::JacobianT jacobian_inverse;
+    typename EtypeT::SF::GradientT mapped_gradient;
+    typename EtypeT::SF::GradientT gradient;
+    EtypeT::SF::compute_gradient(mapped_coords, mapped_gradient);
+
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      fill(nodes, coords, connectivity_array[elem]);
+      EtypeT::compute_jacobian(mapped_coords, nodes, jacobian);
+      bool is_invertible;
+      jacobian.computeInverseAndDetWithCheck(jacobian_inverse, result.determinants[elem], is_invertible);
+      cf3_assert(is_invertible);
+      gradient.noalias() = jacobian_inverse * mapped_gradient;
+
+      for(Uint i = 0; i != dim; ++i)
+      {
+        for(Uint j = 0; j != dim; ++j)
+        {
+          result.jacobians[(i*dim + j)*nb_elems + elem] = jacobian(i, j);
+          result.inverse_jacobians[(i*dim + j)*nb_elems + elem] = jacobian_inverse(i, j);
+        }
+        for(Uint n = 0; n != nb_nodes; ++n)
+        {
+          result.gradients[(i*nb_nodes + n)*nb_elems + elem] = gradient(i, n);
+        }
+      }
+    }
+  }
+
+  /// True if the element and node counts match the ones the points were computed for
+  bool valid_entities() const;
+
+  /// Clear the points and record the current element and node counts
+  void reset();
+
+  /// The entities the data is computed for
+  const Entities& entities() const;
+
+  /// Coordinates of the geometry nodes
+  const common::Table<Real>& coordinates() const;
+
+  /// Geometry connectivity of the parent entities
+  const Connectivity& connectivity() const;
+
+  std::vector< boost::shared_ptr<PointData const> > m_points;
+
+  bool m_enabled;
+
+  Uint m_max_points;
+
+  bool m_is_valid;
+
+  /// Number of elements at the time of the reset
+  Uint m_nb_elements;
+
+  /// Number of geometry nodes at the time of the reset
+  Uint m_nb_nodes;
+
+  /// Protects the points
+  mutable boost::mutex m_mutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementGeometryCache_hpp
@@ -0,0 +1,180 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/Builder.hpp"
+#include "common/Foreach.hpp"
+#include "common/Log.hpp"
+#include "common/PropertyList.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Space.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < ElementGhostClassification, Component, LibMesh > ElementGhostClassification_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementGhostClassification::ElementGhostClassification ( const std::string& name ) :
+  Component ( name ),
+  m_is_valid(false),
+  m_nb_elements(0),
+  m_nb_nodes(0)
+{
+  properties()["brief"] = std::string("Splits the parent elements into interior elements and elements touching ghost nodes");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementGhostClassification::~ElementGhostClassification()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<Uint>& ElementGhostClassification::interior_elements()
+{
+  if(!is_valid())
+    build();
+
+  return m_interior_elements;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<Uint>& ElementGhostClassification::boundary_elements()
+{
+  if(!is_valid())
+    build();
+
+  return m_boundary_elements;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector< std::vector<Uint> >& ElementGhostClassification::interior_colors()
+{
+  if(!is_valid())
+    build();
+
+  return m_interior_colors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector< std::vector<Uint> >& ElementGhostClassification::boundary_colors()
+{
+  if(!is_valid())
+    build();
+
+  return m_boundary_colors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementGhostClassification::is_valid() const
+{
+  if(!m_is_valid)
+    return false;
+
+  Elements& elems = elements();
+  return elems.size() == m_nb_elements && elems.geometry_fields().size() == m_nb_nodes && elems.coloring().is_valid();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementGhostClassification::invalidate()
+{
+  m_is_valid = false;
+  m_interior_elements.clear();
+  m_boundary_elements.clear();
+  m_interior_colors.clear();
+  m_boundary_colors.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementGhostClassification::build()
+{
+  Elements& elems = elements();
+  const Uint nb_elems = elems.size();
+
+  // An element is on the boundary if any of its nodes is a ghost, in any of its spaces
+  std::vector<bool> is_boundary(nb_elems, false);
+  boost_foreach(const Handle<Space>& space, elems.spaces())
+  {
+    const Dictionary& dict = space->dict();
+    const Connectivity& connectivity = space->connectivity();
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      if(is_boundary[elem])
+        continue;
+      boost_foreach(const Uint node, connectivity[elem])
+      {
+        if(dict.is_ghost(node))
+        {
+          is_boundary[elem] = true;
+          break;
+        }
+      }
+    }
+  }
+
+  m_interior_elements.clear();
+  m_boundary_elements.clear();
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    if(is_boundary[elem])
+      m_boundary_elements.push_back(elem);
+    else
+      m_interior_elements.push_back(elem);
+  }
+
+  // Split each color, so both parts remain free of shared nodes
+  const std::vector< std::vector<Uint> >& colors = elems.coloring().colors();
+  const Uint nb_colors = colors.size();
+  m_interior_colors.assign(nb_colors, std::vector<Uint>());
+  m_boundary_colors.assign(nb_colors, std::vector<Uint>());
+  for(Uint color = 0; color != nb_colors; ++color)
+  {
+    boost_foreach(const Uint elem, colors[color])
+    {
+      if(is_boundary[elem])
+        m_boundary_colors[color].push_back(elem);
+      else
+        m_interior_colors[color].push_back(elem);
+    }
+  }
+
+  m_nb_elements = nb_elems;
+  m_nb_nodes = elems.geometry_fields().size();
+  m_is_valid = true;
+
+  CFdebug << "Classified elements of " << elems.uri().path() << ": " << m_interior_elements.size() << " interior, " << m_boundary_elements.size() << " touching ghosts" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Elements& ElementGhostClassification::elements() const
+{
+  Handle<Elements> parent_elements(parent());
+  cf3_assert(is_not_null(parent_elements));
+  return *parent_elements;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,88 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementGhostClassification_hpp
+#define cf3_mesh_ElementGhostClassification_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Component.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+  class Elements;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Cached split of the parent Elements into interior elements, which only touch nodes owned by this rank,
+/// and boundary elements, which have at least one ghost node in one of their spaces.
+/// Interior elements can be processed while a ghost synchronization is still in progress.
+/// The split of the element coloring is also provided, so threaded loops can process each part separately.
+/// Invalidation follows the same rules as ElementColoring.
+class Mesh_API ElementGhostClassification : public common::Component
+{
+public:
+
+  /// Contructor
+  /// @param name of the component
+  ElementGhostClassification ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ElementGhostClassification();
+
+  /// Get the class name
+  static std::string type_name () { return "ElementGhostClassification"; }
+
+  /// Sorted indices of the elements that touch no ghost nodes
+  const std::vector<Uint>& interior_elements();
+
+  /// Sorted indices of the elements that touch at least one ghost node
+  const std::vector<Uint>& boundary_elements();
+
+  /// The element coloring, restricted to the interior elements
+  const std::vector< std::vector<Uint> >& interior_colors();
+
+  /// The element coloring, restricted to the boundary elements
+  const std::vector< std::vector<Uint> >& boundary_colors();
+
+  /// True if the stored classification is still up-to-date with the parent elements
+  bool is_valid() const;
+
+  /// Mark the classification as outdated, so it gets rebuilt on the next access
+  void invalidate();
+
+private:
+  /// Build the classification for the parent elements
+  void build();
+
+  /// The elements that are classified
+  Elements& elements() const;
+
+  std::vector<Uint> m_interior_elements;
+  std::vector<Uint> m_boundary_elements;
+  std::vector< std::vector<Uint> > m_interior_colors;
+  std::vector< std::vector<Uint> > m_boundary_colors;
+
+  bool m_is_valid;
+
+  /// Number of elements at the time of the build
+  Uint m_nb_elements;
+
+  /// Number of geometry nodes at the time of the build
+  Uint m_nb_nodes;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementGhostClassification_hpp
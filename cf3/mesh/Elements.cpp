@@ -14,6 +14,9 @@
 #include "common/PropertyList.hpp"
 
 #include "mesh/Elements.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/ElementGeometryCache.hpp"
 #include "mesh/Connectivity.hpp"
 #include "common/List.hpp"
 #include "mesh/ElementData.hpp"
@@ -38,6 +41,10 @@ Elements::Elements ( const std::string& name ) :
   properties()["brief"] = std::string("Holds information of elements of one type");
   properties()["description"] = std::string("Container component that stores the element to node connectivity,\n")
   +std::string("a link to node storage, a list of used nodes, and global numbering unique over all processors");
+
+  m_coloring = create_static_component<ElementColoring>("coloring");
+  m_ghost_classification = create_static_component<ElementGhostClassification>("ghost_classification");
+  m_geometry_cache = create_static_component<ElementGeometryCache>("geometry_cache");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
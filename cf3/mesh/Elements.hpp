@@ -21,6 +21,9 @@ namespace cf3 {
 namespace mesh {
 
   class Connectivity;
+  class ElementColoring;
+  class ElementGhostClassification;
+  class ElementGeometryCache;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -41,6 +44,23 @@ public: // functions
   /// Get the class name
   static std::string type_name () { return "Elements"; }
 
+  /// Cached coloring of the elements, grouping elements that share no nodes
+  ElementColoring& coloring() { return *m_coloring; }
+
+  /// Cached split into interior elements and elements that touch ghost nodes
+  ElementGhostClassification& ghost_classification() { return *m_ghost_classification; }
+
+  /// Cached jacobians and shape function gradients at quadrature points, disabled by default
+  ElementGeometryCache& geometry_cache() const { return *m_geometry_cache; }
+
+private: // data
+
+  Handle<ElementColoring> m_coloring;
+
+  Handle<ElementGhostClassification> m_ghost_classification;
+
+  Handle<ElementGeometryCache> m_geometry_cache;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
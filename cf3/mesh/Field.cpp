@@ -176,6 +176,35 @@ void Field::synchronize()
   m_comm_pattern->synchronize( name() );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::begin_synchronize()
+{
+  if(!common::PE::Comm::instance().is_active())
+    return;
+
+  if(is_null(m_comm_pattern))
+  {
+    CFdebug << "Applying default parallelization from dict for field " << uri().path() << CFendl;
+    parallelize();
+  }
+
+  cf3_assert(is_not_null(m_comm_pattern));
+
+  CFdebug << "Starting synchronization of field " << uri().path() << CFendl;
+  m_comm_pattern->begin_synchronize( name() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::end_synchronize()
+{
+  if(is_null(m_comm_pattern) || !m_comm_pattern->is_synchronizing( name() ))
+    return;
+
+  m_comm_pattern->end_synchronize( name() );
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 void Field::set_descriptor(math::VariablesDescriptor& descriptor)
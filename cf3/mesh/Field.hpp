@@ -124,6 +124,13 @@ public: // functions
 
   void synchronize();
 
+  /// Start updating the ghost rows, without waiting for the data to arrive.
+  /// Rows owned by this rank may be modified until end_synchronize, ghost rows must not be accessed.
+  void begin_synchronize();
+
+  /// Finish the ghost update started by begin_synchronize. Does nothing if no update is in progress.
+  void end_synchronize();
+
   math::VariablesDescriptor& descriptor() const { return *m_descriptor; }
 
   void set_descriptor(math::VariablesDescriptor& descriptor);
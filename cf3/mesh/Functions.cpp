@@ -11,6 +11,8 @@
 #include "mesh/Dictionary.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Entities.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/UsedNodesCache.hpp"
 
 namespace cf3 {
 namespace mesh {
@@ -113,6 +115,72 @@ boost::shared_ptr< common::List< Uint > > build_used_nodes_list( const Component
 
 ////////////////////////////////////////////////////////////////////////////////
 
+boost::shared_ptr< common::List< Uint > const > cached_used_nodes_list( const std::vector< Handle<Entities const> >& entities, const Dictionary& dictionary, const bool include_ghost_elems, const bool follow_periodic_links)
+{
+  // Dictionaries are created directly in their mesh
+  Handle<Mesh const> mesh(dictionary.parent());
+  if(is_null(mesh))
+    return build_used_nodes_list(entities, dictionary, include_ghost_elems, follow_periodic_links);
+
+  return mesh->used_nodes_cache().used_nodes(entities, dictionary, include_ghost_elems, follow_periodic_links);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void color_elements( const Entities& entities, std::vector< std::vector<Uint> >& colors )
+{
+  colors.clear();
+
+  const Dictionary& dictionary = entities.geometry_fields();
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  const Uint nb_elems = connectivity.size();
+
+  const List<Uint>* periodic_links_nodes = dynamic_cast< const List<Uint>* >(dictionary.get_child("periodic_links_nodes").get());
+  const List<bool>* periodic_links_active = dynamic_cast< const List<bool>* >(dictionary.get_child("periodic_links_active").get());
+
+  // Colors of the elements already processed, for each node
+  std::vector< std::vector<Uint> > node_colors(dictionary.size());
+  // For each color, the last element that had a neighbour with that color
+  std::vector<Uint> forbidden_for;
+  std::vector<Uint> element_nodes;
+
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    element_nodes.clear();
+    boost_foreach(Uint node, connectivity[elem])
+    {
+      if(is_not_null(periodic_links_active))
+      {
+        while((*periodic_links_active)[node])
+          node = (*periodic_links_nodes)[node];
+      }
+      element_nodes.push_back(node);
+    }
+
+    boost_foreach(const Uint node, element_nodes)
+    {
+      boost_foreach(const Uint color, node_colors[node])
+        forbidden_for[color] = elem;
+    }
+
+    Uint elem_color = 0;
+    while(elem_color != colors.size() && forbidden_for[elem_color] == elem)
+      ++elem_color;
+
+    if(elem_color == colors.size())
+    {
+      colors.push_back(std::vector<Uint>());
+      forbidden_for.push_back(nb_elems);
+    }
+
+    colors[elem_color].push_back(elem);
+    boost_foreach(const Uint node, element_nodes)
+      node_colors[node].push_back(elem_color);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void nearest_node_mapping(const RealMatrix& support_local_coords, const RealMatrix& source_local_coords, std::vector<Uint>& node_mapping, std::vector<bool>& is_interior)
 {
   const Real eps = 1e-8;
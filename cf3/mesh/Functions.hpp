@@ -41,6 +41,23 @@ boost::shared_ptr< common::List< Uint > > build_used_nodes_list( const std::vect
 /// @return used_nodes  List of used nodes
 boost::shared_ptr< common::List< Uint > > build_used_nodes_list( const common::Component& node_user, const Dictionary& dictionary, const bool include_ghost_elems, const bool follow_periodic_links = true);
 
+/// cached_used_nodes_list
+/// @brief Same as build_used_nodes_list, but the result is cached in the mesh that holds the dictionary.
+/// Use this for lists that are needed repeatedly, e.g. in every iteration. The cache is cleared when the mesh changes.
+/// @param [in]  entities             vector of entities, that the unique nodes will be collected from
+/// @param [in]  dictionary           dictionary where the nodes are stored
+/// @param [in]  include_ghost_elems  if true, ghost elements will be included in the search
+/// @return used_nodes  List of used nodes, which must not be modified
+boost::shared_ptr< common::List< Uint > const > cached_used_nodes_list( const std::vector< Handle<Entities const> >& entities, const Dictionary& dictionary, const bool include_ghost_elems, const bool follow_periodic_links = true);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Greedy coloring of the elements, so that no two elements with the same color share a node of the geometry dictionary.
+/// Periodic links are followed, so elements that touch periodically linked nodes also get a different color.
+/// @param [in]  entities  entities to color
+/// @param [out] colors    for each color, the sorted list of element indices that have this color
+void color_elements( const Entities& entities, std::vector< std::vector<Uint> >& colors );
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /// Build a mapping linking the local source coordinates to the nearest local coordinate in support_local_coords.
@@ -0,0 +1,493 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/assign/std/vector.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Foreach.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "math/Hilbert.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/GeometricPartitioner.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Space.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+using namespace boost::assign; // bring 'operator+=()' into scope
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < GeometricPartitioner, MeshTransformer, LibMesh > GeometricPartitioner_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Sum the values over all processors, if running in parallel
+void sum_over_processors(std::vector<Real>& values)
+{
+  if(PE::Comm::instance().is_active() && !values.empty())
+    PE::Comm::instance().all_reduce(PE::plus(), values, values);
+}
+
+/// Order of the points of a set along one axis
+struct CompareCoordinate
+{
+  CompareCoordinate(const std::vector<Real>& points, const Uint dim, const Uint axis) : m_points(points), m_dim(dim), m_axis(axis)
+  {
+  }
+
+  bool operator()(const Uint a, const Uint b) const
+  {
+    return m_points[a*m_dim + m_axis] < m_points[b*m_dim + m_axis];
+  }
+
+  bool operator()(const Real value, const Uint b) const
+  {
+    return value < m_points[b*m_dim + m_axis];
+  }
+
+  const std::vector<Real>& m_points;
+  const Uint m_dim;
+  const Uint m_axis;
+};
+
+/// Set of points that remains to be divided over the parts [part_begin, part_end)
+struct PointSet
+{
+  Uint node;
+  Uint part_begin;
+  Uint part_end;
+  std::vector<Uint> points;
+};
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+GeometricPartitioner::GeometricPartitioner ( const std::string& name ) :
+  MeshPartitioner(name),
+  m_method("Hilbert"),
+  m_dim(0)
+{
+  properties()["brief"] = std::string("Partitions the mesh using the element centroids");
+
+  options().add("method", m_method)
+    .pretty_name("Method")
+    .description("Hilbert cuts the Hilbert space-filling curve through the element centroids, RCB uses recursive coordinate bisection")
+    .link_to(&m_method)
+    .restricted_list() += std::string("RCB");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+GeometricPartitioner::~GeometricPartitioner()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GeometricPartitioner::build_graph()
+{
+  const Mesh& mesh = *m_mesh;
+  const Field& coordinates = mesh.geometry_fields().coordinates();
+  m_dim = coordinates.row_size();
+
+  const std::vector< Handle<Entities> >& entities = mesh.elements();
+  m_centroids.resize(entities.size());
+
+  RealVector bounding_min = RealVector::Constant(m_dim, std::numeric_limits<Real>::max());
+  RealVector bounding_max = RealVector::Constant(m_dim, -std::numeric_limits<Real>::max());
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    const Connectivity& connectivity = entities[comp]->geometry_space().connectivity();
+    const Uint nb_elems = connectivity.size();
+    const Real nb_nodes = static_cast<Real>(connectivity.row_size());
+    std::vector<Real>& centroids = m_centroids[comp];
+    centroids.assign(nb_elems*m_dim, 0.);
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      Real* centroid = &centroids[elem*m_dim];
+      boost_foreach(const Uint node, connectivity[elem])
+      {
+        for(Uint d = 0; d != m_dim; ++d)
+          centroid[d] += coordinates[node][d];
+      }
+      for(Uint d = 0; d != m_dim; ++d)
+      {
+        centroid[d] /= nb_nodes;
+        bounding_min[d] = std::min(bounding_min[d], centroid[d]);
+        bounding_max[d] = std::max(bounding_max[d], centroid[d]);
+      }
+    }
+  }
+
+  m_bounding_box.define(bounding_min, bounding_max);
+  m_bounding_box.make_global();
+
+  // Pad the bounding box, so no direction has a zero extent and all centroids are strictly inside
+  const Real extent = (m_bounding_box.max() - m_bounding_box.min()).maxCoeff();
+  const Real padding = 1e-6 * (extent > 0. ? extent : 1.);
+  m_bounding_box.min().array() -= padding;
+  m_bounding_box.max().array() += padding;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GeometricPartitioner::partition_graph()
+{
+  const Mesh& mesh = *m_mesh;
+  const std::vector< Handle<Entities> >& entities = mesh.elements();
+  const Uint rank = PE::Comm::instance().is_active() ? PE::Comm::instance().rank() : 0;
+
+  // The owned volume elements are partitioned
+  std::vector<bool> is_volume(entities.size());
+  std::vector<Real> points;
+  std::vector<Real> weights;
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    is_volume[comp] = entities[comp]->element_type().dimensionality() == mesh.dimension();
+    if(!is_volume[comp])
+      continue;
+
+    for(Uint elem = 0; elem != entities[comp]->size(); ++elem)
+    {
+      if(entities[comp]->is_ghost(elem))
+        continue;
+      points.insert(points.end(), m_centroids[comp].begin() + elem*m_dim, m_centroids[comp].begin() + (elem+1)*m_dim);
+      weights.push_back(entities_weights()[comp]);
+    }
+  }
+
+  if(m_method == "Hilbert")
+    build_hilbert_splitters(points, weights);
+  else
+    build_rcb_tree(points, weights);
+
+  // Part of each element
+  std::vector< std::vector<Uint> > element_parts(entities.size());
+  RealVector centroid(m_dim);
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    if(!is_volume[comp])
+      continue;
+    element_parts[comp].resize(entities[comp]->size(), rank);
+    for(Uint elem = 0; elem != entities[comp]->size(); ++elem)
+    {
+      if(entities[comp]->is_ghost(elem))
+        continue;
+      centroid = Eigen::Map<const RealVector>(&m_centroids[comp][elem*m_dim], m_dim);
+      element_parts[comp][elem] = part_of_point(centroid);
+    }
+  }
+
+  // Volume elements connected to each node
+  const Uint nb_nodes = mesh.geometry_fields().size();
+  std::vector< std::vector< std::pair<Uint, Uint> > > node_to_volume(nb_nodes);
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    if(!is_volume[comp])
+      continue;
+    const Connectivity& connectivity = entities[comp]->geometry_space().connectivity();
+    for(Uint elem = 0; elem != connectivity.size(); ++elem)
+    {
+      if(entities[comp]->is_ghost(elem))
+        continue;
+      boost_foreach(const Uint node, connectivity[elem])
+        node_to_volume[node].push_back(std::make_pair(comp, elem));
+    }
+  }
+
+  // Lower-dimensional elements follow an adjacent volume element, or their own centroid
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    if(is_volume[comp])
+      continue;
+    const Connectivity& connectivity = entities[comp]->geometry_space().connectivity();
+    element_parts[comp].resize(entities[comp]->size(), rank);
+    for(Uint elem = 0; elem != connectivity.size(); ++elem)
+    {
+      if(entities[comp]->is_ghost(elem))
+        continue;
+      const Connectivity::ConstRow nodes = connectivity[elem];
+      bool found = false;
+      typedef std::pair<Uint, Uint> VolumeElementT;
+      boost_foreach(const VolumeElementT& volume_elem, node_to_volume[nodes[0]])
+      {
+        const Connectivity::ConstRow volume_nodes = entities[volume_elem.first]->geometry_space().connectivity()[volume_elem.second];
+        found = true;
+        boost_foreach(const Uint node, nodes)
+        {
+          if(std::find(volume_nodes.begin(), volume_nodes.end(), node) == volume_nodes.end())
+          {
+            found = false;
+            break;
+          }
+        }
+        if(found)
+        {
+          element_parts[comp][elem] = element_parts[volume_elem.first][volume_elem.second];
+          break;
+        }
+      }
+      if(!found)
+      {
+        centroid = Eigen::Map<const RealVector>(&m_centroids[comp][elem*m_dim], m_dim);
+        element_parts[comp][elem] = part_of_point(centroid);
+      }
+    }
+  }
+
+  for(Uint comp = 0; comp != entities.size(); ++comp)
+  {
+    for(Uint elem = 0; elem != element_parts[comp].size(); ++elem)
+    {
+      if(element_parts[comp][elem] != rank && !entities[comp]->is_ghost(elem))
+        m_elements_to_export[element_parts[comp][elem]][comp].push_back(elem);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint GeometricPartitioner::part_of_point(const RealVector& point) const
+{
+  if(m_method == "Hilbert")
+  {
+    cf3_assert(m_hilbert.get() != nullptr);
+    const boost::uint64_t key = (*m_hilbert)(point);
+    return std::upper_bound(m_splitters.begin(), m_splitters.end(), key) - m_splitters.begin();
+  }
+
+  cf3_assert(!m_rcb_tree.empty());
+  const RCBNode* node = &m_rcb_tree.front();
+  while(!node->is_leaf)
+    node = &m_rcb_tree[point[node->axis] <= node->cut ? node->left : node->right];
+  return node->part;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GeometricPartitioner::build_hilbert_splitters(const std::vector<Real>& points, const std::vector<Real>& weights)
+{
+  const Uint nb_parts = options().value<Uint>("nb_parts");
+  const Uint nb_points = weights.size();
+
+  m_hilbert.reset(new math::Hilbert(m_bounding_box, m_dim == 3 ? 20 : 30));
+
+  // Local keys in increasing order, with the accumulated weight
+  std::vector< std::pair<boost::uint64_t, Real> > keys(nb_points);
+  RealVector point(m_dim);
+  for(Uint i = 0; i != nb_points; ++i)
+  {
+    point = Eigen::Map<const RealVector>(&points[i*m_dim], m_dim);
+    keys[i] = std::make_pair((*m_hilbert)(point), weights[i]);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<boost::uint64_t> sorted_keys(nb_points);
+  std::vector<Real> weight_below(nb_points+1, 0.);
+  for(Uint i = 0; i != nb_points; ++i)
+  {
+    sorted_keys[i] = keys[i].first;
+    weight_below[i+1] = weight_below[i] + keys[i].second;
+  }
+
+  std::vector<Real> total_weight(1, weight_below.back());
+  detail::sum_over_processors(total_weight);
+
+  // Each splitter is the smallest key with at least the target weight below it. The search interval is
+  // the same on all processors, since it only depends on globally summed weights.
+  const Uint nb_splitters = nb_parts - 1;
+  std::vector<boost::uint64_t> lower(nb_splitters, 0);
+  std::vector<boost::uint64_t> upper(nb_splitters, m_hilbert->max_key() + 1);
+  std::vector<boost::uint64_t> middle(nb_splitters);
+  std::vector<Real> weights_below_middle(nb_splitters);
+  while(lower != upper)
+  {
+    for(Uint s = 0; s != nb_splitters; ++s)
+    {
+      middle[s] = lower[s] + (upper[s] - lower[s]) / 2;
+      weights_below_middle[s] = weight_below[std::lower_bound(sorted_keys.begin(), sorted_keys.end(), middle[s]) - sorted_keys.begin()];
+    }
+    detail::sum_over_processors(weights_below_middle);
+    for(Uint s = 0; s != nb_splitters; ++s)
+    {
+      if(lower[s] == upper[s])
+        continue;
+      const Real target = total_weight[0] * static_cast<Real>(s+1) / static_cast<Real>(nb_parts);
+      if(weights_below_middle[s] >= target)
+        upper[s] = middle[s];
+      else
+        lower[s] = middle[s] + 1;
+    }
+  }
+
+  m_splitters = lower;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GeometricPartitioner::build_rcb_tree(const std::vector<Real>& points, const std::vector<Real>& weights)
+{
+  const Uint nb_parts = options().value<Uint>("nb_parts");
+  const Uint nb_iterations = 64;
+
+  m_rcb_tree.assign(1, RCBNode());
+  std::vector<detail::PointSet> sets(1);
+  sets[0].node = 0;
+  sets[0].part_begin = 0;
+  sets[0].part_end = nb_parts;
+  sets[0].points.resize(weights.size());
+  for(Uint i = 0; i != weights.size(); ++i)
+    sets[0].points[i] = i;
+
+  // Bisect all sets of the same level together, to minimize the number of collective operations
+  while(!sets.empty())
+  {
+    std::vector<detail::PointSet> to_split;
+    boost_foreach(detail::PointSet& set, sets)
+    {
+      RCBNode& node = m_rcb_tree[set.node];
+      if(set.part_end - set.part_begin == 1)
+      {
+        node.is_leaf = true;
+        node.part = set.part_begin;
+      }
+      else
+      {
+        to_split.push_back(detail::PointSet());
+        to_split.back().node = set.node;
+        to_split.back().part_begin = set.part_begin;
+        to_split.back().part_end = set.part_end;
+        to_split.back().points.swap(set.points);
+      }
+    }
+    sets.clear();
+    const Uint nb_sets = to_split.size();
+    if(nb_sets == 0)
+      break;
+
+    // Bounding box and total weight of each set. The minimum is stored as the negative of the maximum of its opposite.
+    std::vector<Real> extrema(2*m_dim*nb_sets, -std::numeric_limits<Real>::max());
+    std::vector<Real> total_weights(nb_sets, 0.);
+    for(Uint s = 0; s != nb_sets; ++s)
+    {
+      boost_foreach(const Uint i, to_split[s].points)
+      {
+        for(Uint d = 0; d != m_dim; ++d)
+        {
+          extrema[2*m_dim*s + d] = std::max(extrema[2*m_dim*s + d], -points[i*m_dim + d]);
+          extrema[2*m_dim*s + m_dim + d] = std::max(extrema[2*m_dim*s + m_dim + d], points[i*m_dim + d]);
+        }
+        total_weights[s] += weights[i];
+      }
+    }
+    if(PE::Comm::instance().is_active())
+      PE::Comm::instance().all_reduce(PE::max(), extrema, extrema);
+    detail::sum_over_processors(total_weights);
+
+    // Cut each set along its longest direction
+    std::vector<Real> lower(nb_sets), upper(nb_sets), targets(nb_sets);
+    std::vector< std::vector<Real> > weight_below(nb_sets);
+    for(Uint s = 0; s != nb_sets; ++s)
+    {
+      RCBNode& node = m_rcb_tree[to_split[s].node];
+      node.is_leaf = false;
+      node.axis = 0;
+      for(Uint d = 1; d != m_dim; ++d)
+      {
+        if(extrema[2*m_dim*s + m_dim + d] + extrema[2*m_dim*s + d] > extrema[2*m_dim*s + m_dim + node.axis] + extrema[2*m_dim*s + node.axis])
+          node.axis = d;
+      }
+      lower[s] = -extrema[2*m_dim*s + node.axis];
+      upper[s] = extrema[2*m_dim*s + m_dim + node.axis];
+      if(lower[s] > upper[s]) // No points in this set on any processor
+        lower[s] = upper[s] = 0.;
+
+      const Uint nb_left_parts = (to_split[s].part_end - to_split[s].part_begin) / 2;
+      targets[s] = total_weights[s] * static_cast<Real>(nb_left_parts) / static_cast<Real>(to_split[s].part_end - to_split[s].part_begin);
+
+      std::vector<Uint>& set_points = to_split[s].points;
+      std::sort(set_points.begin(), set_points.end(), detail::CompareCoordinate(points, m_dim, node.axis));
+      weight_below[s].assign(set_points.size()+1, 0.);
+      for(Uint i = 0; i != set_points.size(); ++i)
+        weight_below[s][i+1] = weight_below[s][i] + weights[set_points[i]];
+    }
+
+    // Smallest cut with at least the target weight at or below it
+    std::vector<Real> middle(nb_sets), weights_below_middle(nb_sets);
+    for(Uint iter = 0; iter != nb_iterations; ++iter)
+    {
+      for(Uint s = 0; s != nb_sets; ++s)
+      {
+        const RCBNode& node = m_rcb_tree[to_split[s].node];
+        middle[s] = 0.5*(lower[s] + upper[s]);
+        const std::vector<Uint>& set_points = to_split[s].points;
+        const std::vector<Uint>::const_iterator first_above = std::upper_bound(set_points.begin(), set_points.end(), middle[s], detail::CompareCoordinate(points, m_dim, node.axis));
+        weights_below_middle[s] = weight_below[s][first_above - set_points.begin()];
+      }
+      detail::sum_over_processors(weights_below_middle);
+      for(Uint s = 0; s != nb_sets; ++s)
+      {
+        if(weights_below_middle[s] >= targets[s])
+          upper[s] = middle[s];
+        else
+          lower[s] = middle[s];
+      }
+    }
+
+    // Create the children and divide the points
+    for(Uint s = 0; s != nb_sets; ++s)
+    {
+      const Uint node_idx = to_split[s].node;
+      const Uint axis = m_rcb_tree[node_idx].axis;
+      const Uint nb_left_parts = (to_split[s].part_end - to_split[s].part_begin) / 2;
+      m_rcb_tree[node_idx].cut = upper[s];
+      m_rcb_tree[node_idx].left = m_rcb_tree.size();
+      m_rcb_tree[node_idx].right = m_rcb_tree.size() + 1;
+      m_rcb_tree.resize(m_rcb_tree.size() + 2, RCBNode());
+
+      detail::PointSet left, right;
+      left.node = m_rcb_tree[node_idx].left;
+      left.part_begin = to_split[s].part_begin;
+      left.part_end = to_split[s].part_begin + nb_left_parts;
+      right.node = m_rcb_tree[node_idx].right;
+      right.part_begin = left.part_end;
+      right.part_end = to_split[s].part_end;
+      boost_foreach(const Uint i, to_split[s].points)
+      {
+        if(points[i*m_dim + axis] <= upper[s])
+          left.points.push_back(i);
+        else
+          right.points.push_back(i);
+      }
+      sets.push_back(left);
+      sets.push_back(right);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
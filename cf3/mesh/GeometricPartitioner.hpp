@@ -0,0 +1,107 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_GeometricPartitioner_hpp
+#define cf3_mesh_GeometricPartitioner_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "math/BoundingBox.hpp"
+
+#include "mesh/MeshPartitioner.hpp"
+
+namespace cf3 {
+namespace math { class Hilbert; }
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Partitioner that only uses the element centroids, and needs no external library.
+/// The volume elements are divided using recursive coordinate bisection (RCB) or by cutting the Hilbert
+/// space-filling curve through the centroids in pieces of equal weight. The cuts along the curve are the splitters
+/// of a parallel sample sort, found by a parallel weighted histogram search, so the elements themselves are never
+/// sorted globally: the migrate step moves them to their part.
+/// Lower-dimensional elements follow an adjacent volume element when one is available on the same processor.
+/// The element weights are set by the cost_model option. Nodes are not weighted, as they follow the elements.
+/// This is fast enough to partition very large meshes at startup, and provides a good initial partition before
+/// refining with a graph partitioner.
+class Mesh_API GeometricPartitioner : public MeshPartitioner
+{
+public: // functions
+
+  /// Contructor
+  /// @param name of the component
+  GeometricPartitioner ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~GeometricPartitioner();
+
+  /// Get the class name
+  static std::string type_name () { return "GeometricPartitioner"; }
+
+  /// Computes the element centroids
+  virtual void build_graph();
+
+  /// Assigns each element to a part, and fills the lists of elements to export
+  virtual void partition_graph();
+
+  /// Part of the given point, according to the last partitioning
+  Uint part_of_point(const RealVector& point) const;
+
+private: // functions
+
+  /// Find the Hilbert keys that split the given points in parts of equal weight
+  void build_hilbert_splitters(const std::vector<Real>& points, const std::vector<Real>& weights);
+
+  /// Build the tree of coordinate cuts that splits the given points in parts of equal weight
+  void build_rcb_tree(const std::vector<Real>& points, const std::vector<Real>& weights);
+
+private: // data
+
+  /// Partitioning method, RCB or Hilbert
+  std::string m_method;
+
+  /// Dimension of the mesh
+  Uint m_dim;
+
+  /// Centroids of the elements, for each element component, stored as x0 y0 z0 x1 y1 z1 ...
+  std::vector< std::vector<Real> > m_centroids;
+
+  /// Global bounding box of the centroids
+  math::BoundingBox m_bounding_box;
+
+  /// Hilbert curve used to compute the keys
+  boost::scoped_ptr<math::Hilbert> m_hilbert;
+
+  /// Smallest Hilbert key of each part except the first
+  std::vector<boost::uint64_t> m_splitters;
+
+  /// Node of the RCB tree. Points with a coordinate smaller than or equal to the cut go to the left child.
+  struct RCBNode
+  {
+    Uint axis;
+    Real cut;
+    Uint left;
+    Uint right;
+    Uint part;
+    bool is_leaf;
+  };
+
+  /// RCB tree, with the root as first node
+  std::vector<RCBNode> m_rcb_tree;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_GeometricPartitioner_hpp
@@ -7,6 +7,7 @@
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 
+#include "math/Consts.hpp"
 #include "math/MatrixTypesConversion.hpp"
 
 #include "common/FindComponents.hpp"
@@ -15,11 +16,14 @@
 #include "common/OptionT.hpp"
 #include "common/Signal.hpp"
 #include "common/XML/SignalOptions.hpp"
+#include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
 
 #include "mesh/Interpolator.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Field.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Entities.hpp"
 
 #include "mesh/PointInterpolator.hpp"
 
@@ -38,15 +42,7 @@ common::ComponentBuilder<Interpolator,AInterpolator,LibMesh> Interpolator_builde
 Interpolator::Interpolator(const std::string &name) :
   AInterpolator(name),
   m_source_dict_size(0),
-  m_target_size(0),
-  m_proc(0),
-  m_expect_recv(0),
-  m_stored_element(0),
-  m_stored_stencil(0),
-  m_stored_source_field_points(0),
-  m_stored_source_field_weights(0),
-  m_source_vars(0),
-  m_target_vars(0)
+  m_target_size(0)
 
 {
   options().add("store", false)
@@ -58,155 +54,215 @@ Interpolator::Interpolator(const std::string &name) :
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace detail {
+
+/// Exchange a vector with every processor, or copy it when running serially
 template <typename T>
-void Interpolator_send_receive(const Uint send_to_pid, std::vector<T>& send, const Uint receive_from_pid, std::vector<T>& receive)
+void exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& receive)
 {
-  if (send_to_pid == PE::Comm::instance().rank() &&
-      receive_from_pid == PE::Comm::instance().rank())
-  {
+  if (PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
+    PE::Comm::instance().all_to_all(send, receive);
+  else
     receive = send;
-      return;
-  }
-  size_t recv_size;
-  size_t send_size = send.size();
-  MPI_Sendrecv(&send_size, 1, PE::get_mpi_datatype<size_t>(), (int)send_to_pid, 0,
-               &recv_size, 1, PE::get_mpi_datatype<size_t>(), (int)receive_from_pid, 0,
-               PE::Comm::instance().communicator(), MPI_STATUS_IGNORE);
-  receive.resize(recv_size);
-  MPI_Sendrecv(&send[0], (int)send.size(), PE::get_mpi_datatype<T>(), (int)send_to_pid, 0,
-               &receive[0], (int)receive.size(), PE::get_mpi_datatype<T>(), (int)receive_from_pid, 0,
-               PE::Comm::instance().communicator(), MPI_STATUS_IGNORE);
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-
-void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coords)
+/// Bounding box of the geometry nodes of the elements of a dictionary,
+/// stored as the minimum coordinates followed by the maximum coordinates
+void element_bounding_box(const Dictionary& dict, std::vector<Real>& box)
 {
-  m_dict  = dict.handle<Dictionary>();
-  m_table = target_coords.handle< Table<Real> >();
-
-  cf3_assert(m_point_interpolator);
-  m_point_interpolator->options().set("dict", const_cast<Dictionary*>(m_dict.get())->handle<Dictionary>());
-
-  Uint nb_coords = target_coords.size();
-  Uint dim = target_coords.row_size();
-
-  std::vector<Uint> not_found; not_found.reserve(nb_coords);
-  for (Uint i=0; i<nb_coords; ++i)
-    not_found.push_back(i);
+  box.clear();
+  boost_foreach(const Handle<Entities>& entities, dict.entities_range())
+  {
+    const Field& coords = entities->geometry_fields().coordinates();
+    const Uint dim = coords.row_size();
+    if (box.empty())
+    {
+      box.resize(2*dim);
+      std::fill(box.begin(), box.begin()+dim, math::Consts::real_max());
+      std::fill(box.begin()+dim, box.end(), -math::Consts::real_max());
+    }
+    cf3_assert(box.size() == 2*dim);
+    boost_foreach(const Connectivity::ConstRow nodes, entities->geometry_space().connectivity().array())
+    {
+      boost_foreach(const Uint node, nodes)
+      {
+        for (Uint d=0; d<dim; ++d)
+        {
+          box[d]     = std::min(box[d],     coords[node][d]);
+          box[dim+d] = std::max(box[dim+d], coords[node][d]);
+        }
+      }
+    }
+  }
 
-  m_proc.resize(nb_coords,-1);
+  // Enlarge the box, so that points on its boundary are not missed due to round-off
+  const Uint dim = box.size()/2;
+  Real extent = 0.;
+  for (Uint d=0; d<dim; ++d)
+    extent = std::max(extent, box[dim+d]-box[d]);
+  for (Uint d=0; d<dim; ++d)
+  {
+    box[d]     -= 1e-6*extent;
+    box[dim+d] += 1e-6*extent;
+  }
+}
 
-  m_proc.clear();
-  m_expect_recv.clear();
-  m_stored_element.clear();
-  m_stored_stencil.clear();
-  m_stored_source_field_points.clear();
-  m_stored_source_field_weights.clear();
+/// Check if a bounding box, as computed by element_bounding_box(), may contain a point
+bool box_contains(const std::vector<Real>& box, const Table<Real>::ConstRow& point)
+{
+  if (box.empty())
+    return false;
+  // Dimensions don't match, let the element finder decide
+  if (box.size() != 2*point.size())
+    return true;
+  const Uint dim = point.size();
+  for (Uint d=0; d<dim; ++d)
+  {
+    if (point[d] < box[d] || point[d] > box[dim+d])
+      return false;
+  }
+  return true;
+}
 
-  m_expect_recv.resize(PE::Comm::instance().size());
-  m_stored_element.resize(PE::Comm::instance().size());
-  m_stored_stencil.resize(PE::Comm::instance().size());
-  m_stored_source_field_points.resize(PE::Comm::instance().size());
-  m_stored_source_field_weights.resize(PE::Comm::instance().size());
+} // detail
 
+////////////////////////////////////////////////////////////////////////////////
 
-  // Now find missing on other procs.
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
+void Interpolator::send_to_candidates(const Dictionary& dict, const Table<Real>& target_coords,
+                                      std::vector< std::vector<Uint> >& sent_rows,
+                                      std::vector< std::vector<Real> >& received_coords) const
+{
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  // Exchange the bounding boxes of the source elements of every processor
+  std::vector<Real> my_box;
+  detail::element_bounding_box(dict, my_box);
+  std::vector< std::vector<Real> > boxes(1, my_box);
+  if (PE::Comm::instance().is_active() && nb_procs > 1)
+    PE::Comm::instance().all_gather(my_box, boxes);
+  cf3_assert(boxes.size() == nb_procs);
+
+  // Send every coordinate to the processors whose bounding box contains it
+  sent_rows.assign(nb_procs, std::vector<Uint>());
+  std::vector< std::vector<Real> > send_coords(nb_procs);
+  for (Uint t=0; t<target_coords.size(); ++t)
   {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_coords = (PE::Comm::instance().rank() + pid) %
-                                  PE::Comm::instance().size();
-    const Uint pid_recv_coords = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                  PE::Comm::instance().size();
-
-    std::vector<Real> send_coords; send_coords.reserve(not_found.size()*target_coords.row_size());
-    std::vector<Real> received_coords;
-
-    // fill in coords to send
-    boost_foreach (const Uint t, not_found)
+    const Table<Real>::ConstRow point = target_coords[t];
+    for (Uint pid=0; pid<nb_procs; ++pid)
     {
-      boost_foreach (const Real& xyz, target_coords[t])
+      if (detail::box_contains(boxes[pid], point))
       {
-        send_coords.push_back(xyz);
+        sent_rows[pid].push_back(t);
+        send_coords[pid].insert(send_coords[pid].end(), point.begin(), point.end());
       }
     }
+  }
 
-    // send coords, and receive coords
-    Interpolator_send_receive(pid_send_coords,   send_coords,
-                              pid_recv_coords,   received_coords);
+  detail::exchange(send_coords, received_coords);
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
-    Uint nb_received_coords = received_coords.size()/dim;
+void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coords)
+{
+  m_dict  = dict.handle<Dictionary>();
+  m_table = target_coords.handle< Table<Real> >();
 
-    // Find interpolated
+  cf3_assert(m_point_interpolator);
+  m_point_interpolator->options().set("dict", const_cast<Dictionary*>(m_dict.get())->handle<Dictionary>());
 
-    m_stored_element[pid_recv_coords].clear();
-    m_stored_stencil[pid_recv_coords].clear();
-    m_stored_source_field_points[pid_recv_coords].clear();
-    m_stored_source_field_weights[pid_recv_coords].clear();
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_coords = target_coords.size();
+  const Uint dim = target_coords.row_size();
 
-    m_stored_element[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_stencil[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_source_field_points[pid_recv_coords].reserve(nb_received_coords);
-    m_stored_source_field_weights[pid_recv_coords].reserve(nb_received_coords);
+  std::vector< std::vector<Uint> > sent_rows;
+  std::vector< std::vector<Real> > received_coords;
+  send_to_candidates(dict, target_coords, sent_rows, received_coords);
 
-    std::vector<Uint> send_found_coords;  send_found_coords.reserve(nb_received_coords);
+  // Compute the stencil and weights of every received coordinate, with an empty row when not found
+  std::vector< std::vector<Uint> > found_offsets(nb_procs);
+  std::vector< std::vector<Uint> > found_points(nb_procs);
+  std::vector< std::vector<Real> > found_weights(nb_procs);
+  std::vector< std::vector<Uint> > send_found(nb_procs);
 
-    Uint dim = target_coords.row_size();
-    RealVector t_point(dim);
-    SpaceElem element;
-    std::vector<SpaceElem> stencil;
-    std::vector<Uint> points;
-    std::vector<Real> weights;
+  RealVector t_point(dim);
+  SpaceElem element;
+  std::vector<SpaceElem> stencil;
+  std::vector<Uint> points;
+  std::vector<Real> weights;
 
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const Uint nb_received_coords = received_coords[pid].size()/dim;
+    found_offsets[pid].reserve(nb_received_coords+1);
+    found_offsets[pid].push_back(0);
+    send_found[pid].reserve(nb_received_coords);
     for (Uint t=0; t<nb_received_coords; ++t)
     {
-      t_point = RealVector::MapType(&received_coords[t*dim],dim);
-      bool interpolation_possible_on_this_proc =
+      t_point = RealVector::MapType(&received_coords[pid][t*dim],dim);
+      const bool interpolation_possible_on_this_proc =
           m_point_interpolator->compute_storage(t_point,
                                                 element,
                                                 stencil,
                                                 points,
                                                 weights);
-
       if (interpolation_possible_on_this_proc)
       {
-        m_stored_element[pid_recv_coords].push_back(element);
-        m_stored_stencil[pid_recv_coords].push_back(stencil);
-        m_stored_source_field_points[pid_recv_coords].push_back(points);
-        m_stored_source_field_weights[pid_recv_coords].push_back(weights);
-
-        // mark found
-        send_found_coords.push_back(t);
+        found_points[pid].insert(found_points[pid].end(), points.begin(), points.end());
+        found_weights[pid].insert(found_weights[pid].end(), weights.begin(), weights.end());
       }
-
+      found_offsets[pid].push_back(found_points[pid].size());
+      send_found[pid].push_back(interpolation_possible_on_this_proc);
     }
+  }
 
-    std::vector<Uint> recv_found_coords;
-
-    const Uint pid_send_back = pid_recv_coords;
-    const Uint pid_recv_back = pid_send_coords;
-
-    Interpolator_send_receive (pid_send_back, send_found_coords,
-                               pid_recv_back, recv_found_coords);
-
-    m_expect_recv[pid_recv_back].reserve(recv_found_coords.size());
+  std::vector< std::vector<Uint> > recv_found;
+  detail::exchange(send_found, recv_found);
 
-    boost_foreach(const Uint i, recv_found_coords)
+  // Every coordinate is interpolated by one processor that found it, preferring this processor
+  std::vector<bool> located(nb_coords, false);
+  std::vector< std::vector<Uint> > send_accepted(nb_procs);
+  m_expect_recv.assign(nb_procs, std::vector<Uint>());
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    const Uint pid = (rank + p) % nb_procs;
+    cf3_assert(recv_found[pid].size() == sent_rows[pid].size());
+    send_accepted[pid].resize(sent_rows[pid].size(), 0u);
+    for (Uint i=0; i<sent_rows[pid].size(); ++i)
     {
-      cf3_assert(i<not_found.size());
-      const Uint t = not_found[i];
-      cf3_assert(t<nb_coords);
-      m_proc[t] = pid_recv_back;
-      m_expect_recv[pid_recv_back].push_back(t);
+      const Uint t = sent_rows[pid][i];
+      if (recv_found[pid][i] && !located[t])
+      {
+        located[t] = true;
+        send_accepted[pid][i] = 1u;
+        m_expect_recv[pid].push_back(t);
+      }
     }
+  }
+
+  std::vector< std::vector<Uint> > recv_accepted;
+  detail::exchange(send_accepted, recv_accepted);
 
-    not_found.clear();
-    for (Uint t=0; t<nb_coords; ++t)
+  // Keep the stencils and weights of the accepted coordinates as the rows of the sparse operator
+  m_stored_offsets.assign(nb_procs, std::vector<Uint>(1, 0u));
+  m_stored_source_field_points.assign(nb_procs, std::vector<Uint>());
+  m_stored_source_field_weights.assign(nb_procs, std::vector<Real>());
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    cf3_assert(recv_accepted[pid].size() == send_found[pid].size());
+    for (Uint t=0; t<recv_accepted[pid].size(); ++t)
     {
-      if (m_proc[t]<0)
-        not_found.push_back(t);
+      if (recv_accepted[pid][t])
+      {
+        const Uint begin = found_offsets[pid][t];
+        const Uint end   = found_offsets[pid][t+1];
+        m_stored_source_field_points[pid].insert(m_stored_source_field_points[pid].end(),
+                                                 found_points[pid].begin()+begin, found_points[pid].begin()+end);
+        m_stored_source_field_weights[pid].insert(m_stored_source_field_weights[pid].end(),
+                                                  found_weights[pid].begin()+begin, found_weights[pid].begin()+end);
+        m_stored_offsets[pid].push_back(m_stored_source_field_points[pid].size());
+      }
     }
   }
 }
@@ -215,57 +271,47 @@ void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coord
 
 void Interpolator::stored_interpolation(const Field& source_field, Table<Real>& target)
 {
-  // Do interpolation on processors that can do the interpolation,
-  // and send back an array of interpolated values
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
-  {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_interpolated = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                        PE::Comm::instance().size();
-    const Uint pid_recv_interpolated = (PE::Comm::instance().rank() + pid) %
-                                        PE::Comm::instance().size();
-
-    // number of points to be interpolated
-    const Uint nb_points = m_stored_element[pid_send_interpolated].size();
-
-    // number of variables for each point to be interpolated
-    const Uint nb_vars = m_source_vars.size();
+  const Uint nb_procs = PE::Comm::instance().size();
 
-    // storage for interpolated variables, which will be sent to the pid that reqests it (pid_recv_interpolated)
-    std::vector<Real> interpolated; interpolated.reserve(nb_points*nb_vars);
+  // number of variables for each point to be interpolated
+  const Uint nb_vars = m_source_vars.size();
 
-    // Interpolation points and weights
-    const std::vector< std::vector<Uint> >& s_points  = m_stored_source_field_points[pid_send_interpolated];
-    const std::vector< std::vector<Real> >& s_weights = m_stored_source_field_weights[pid_send_interpolated];
+  // Apply the stored operator for every processor that requested values from this processor
+  std::vector< std::vector<Real> > send_interpolated(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const std::vector<Uint>& offsets   = m_stored_offsets[pid];
+    const std::vector<Uint>& s_points  = m_stored_source_field_points[pid];
+    const std::vector<Real>& s_weights = m_stored_source_field_weights[pid];
+    const Uint nb_points = offsets.size()-1;
 
-    // Do interpolation
+    std::vector<Real>& interpolated = send_interpolated[pid];
+    interpolated.assign(nb_points*nb_vars, 0.);
     for (Uint t=0; t<nb_points; ++t)
     {
-      for (Uint v=0; v<nb_vars; ++v)
+      for (Uint s=offsets[t]; s<offsets[t+1]; ++s)
       {
-        interpolated.push_back(0.);
-        for (Uint s=0; s<s_points[t].size(); ++s)
-        {
-          cf3_assert(s_points[t][s]<source_field.size());
-          interpolated.back() += source_field[ s_points[t][s] ][ m_source_vars[v] ] * s_weights[t][s];
-        }
+        cf3_assert(s_points[s]<source_field.size());
+        Field::ConstRow source_row = source_field[ s_points[s] ];
+        for (Uint v=0; v<nb_vars; ++v)
+          interpolated[t*nb_vars+v] += source_row[ m_source_vars[v] ] * s_weights[s];
       }
     }
+  }
 
-    // Send/Receive interpolated variables
-    std::vector<Real> recv_interpolated;
-    Interpolator_send_receive(pid_send_interpolated   , interpolated,
-                              pid_recv_interpolated   , recv_interpolated);
+  std::vector< std::vector<Real> > recv_interpolated;
+  detail::exchange(send_interpolated, recv_interpolated);
 
-    // Fill the target_field with received interpolated variables from requested processor
+  // Fill the target with received interpolated variables
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    cf3_assert(recv_interpolated[pid].size() == m_expect_recv[pid].size()*nb_vars);
     Uint it=0;
-    boost_foreach( const Uint t, m_expect_recv[pid_recv_interpolated] )
+    boost_foreach( const Uint t, m_expect_recv[pid] )
     {
+      cf3_assert(t<target.size());
       for (Uint v=0; v<nb_vars; ++v)
-      {
-        cf3_assert(t<target.size());
-        target[t][ m_target_vars[v] ] = recv_interpolated[it++];
-      }
+        target[t][ m_target_vars[v] ] = recv_interpolated[pid][it++];
     }
   }
 }
@@ -281,102 +327,73 @@ void Interpolator::unstored_interpolation(const Field& source_field, const commo
   cf3_assert(m_point_interpolator);
   m_point_interpolator->options().set("dict", const_cast<Dictionary*>(&source_field.dict())->handle<Dictionary>());
 
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint rank = PE::Comm::instance().rank();
   const Uint nb_coords = target_coords.size();
   const Uint dim = target_coords.row_size();
 
-  std::vector<int> not_found; not_found.reserve(nb_coords);
-  for (Uint i=0; i<nb_coords; ++i)
-    not_found.push_back(i);
-
-  // Now find missing on other procs.
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
-  {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_coords = (PE::Comm::instance().rank() + pid) %
-                                  PE::Comm::instance().size();
-    const Uint pid_recv_coords = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                  PE::Comm::instance().size();
-
-    std::vector<Real> send_coords; send_coords.reserve(not_found.size()*target_coords.row_size());
-    std::vector<Uint>  unknown_ids; unknown_ids.reserve(not_found.size());
-    std::vector<Real> received_coords;
-
-    // fill in coords to send
-    boost_foreach (const int t, not_found)
-    {
-      if (t>=0)
-      {
-        unknown_ids.push_back(t);
-        boost_foreach (const Real& xyz, target_coords[t])
-        {
-          send_coords.push_back(xyz);
-        }
-      }
-    }
-
-    // send coords, and receive coords
-    Interpolator_send_receive(pid_send_coords,   send_coords,
-                              pid_recv_coords,   received_coords);
+  std::vector< std::vector<Uint> > sent_rows;
+  std::vector< std::vector<Real> > received_coords;
+  send_to_candidates(source_field.dict(), target_coords, sent_rows, received_coords);
 
-    Uint nb_received_coords = received_coords.size()/dim;
+  // number of variables for each point to be interpolated
+  const Uint nb_vars = m_source_vars.size();
 
-    // Find interpolated
+  // Interpolate the received coordinates, and send back which ones were found with their values
+  std::vector< std::vector<Uint> > send_found(nb_procs);
+  std::vector< std::vector<Real> > send_interpolated(nb_procs);
 
-    std::vector<Uint> send_found_coords;  send_found_coords.reserve(nb_received_coords);
-
-    // number of variables for each point to be interpolated
-    const Uint nb_vars = m_source_vars.size();
-
-    // storage for interpolated variables, which will be sent to the pid that reqests it (pid_recv_interpolated)
-    std::vector<Real> send_interpolated; send_interpolated.reserve(nb_received_coords*nb_vars);
-
-    Uint dim = target_coords.row_size();
-    RealVector t_point(dim);
-    RealVector t_val(source_field.row_size());
+  RealVector t_point(dim);
+  RealVector t_val(source_field.row_size());
 
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const Uint nb_received_coords = received_coords[pid].size()/dim;
+    send_found[pid].reserve(nb_received_coords);
+    send_interpolated[pid].reserve(nb_received_coords*nb_vars);
     for (Uint t=0; t<nb_received_coords; ++t)
     {
-      t_point = RealVector::MapType(&received_coords[t*dim],dim);
-      bool interpolation_possible_on_this_proc =
+      t_point = RealVector::MapType(&received_coords[pid][t*dim],dim);
+      const bool interpolation_possible_on_this_proc =
           m_point_interpolator->interpolate(source_field,t_point,t_val);
+      send_found[pid].push_back(interpolation_possible_on_this_proc);
       if (interpolation_possible_on_this_proc)
       {
-        // mark found
-        send_found_coords.push_back(t);
-
         for (Uint v=0; v<nb_vars; ++v)
-          send_interpolated.push_back(t_val[ m_source_vars[v] ] );
+          send_interpolated[pid].push_back(t_val[ m_source_vars[v] ] );
       }
     }
+  }
 
-    std::vector<Uint> recv_found_coords;
-    std::vector<Real> recv_interpolated;
-
-    const Uint pid_send_back = pid_recv_coords;
-    const Uint pid_recv_back = pid_send_coords;
-
-    Interpolator_send_receive (pid_send_back, send_found_coords,
-                               pid_recv_back, recv_found_coords);
-    Interpolator_send_receive (pid_send_back, send_interpolated,
-                               pid_recv_back, recv_interpolated);
+  std::vector< std::vector<Uint> > recv_found;
+  std::vector< std::vector<Real> > recv_interpolated;
+  detail::exchange(send_found, recv_found);
+  detail::exchange(send_interpolated, recv_interpolated);
 
+  // Use the values of the first processor that found each coordinate, preferring this processor
+  std::vector<bool> located(nb_coords, false);
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    const Uint pid = (rank + p) % nb_procs;
+    cf3_assert(recv_found[pid].size() == sent_rows[pid].size());
     Uint it=0;
-    boost_foreach(const Uint i, recv_found_coords)
+    for (Uint i=0; i<sent_rows[pid].size(); ++i)
     {
-      cf3_assert(i<unknown_ids.size());
-      const int t = unknown_ids[i];
-      not_found[t] = -1;
-      cf3_assert_desc(common::to_str(t)+'<'+common::to_str(nb_coords),t<(int)nb_coords);
-      for (Uint v=0; v<nb_vars; ++v)
+      if (!recv_found[pid][i])
+        continue;
+      const Uint t = sent_rows[pid][i];
+      cf3_assert(t<target.size());
+      if (!located[t])
       {
-        cf3_assert(t<target.size());
-        target[t][ m_target_vars[v] ] = recv_interpolated[it++];
+        located[t] = true;
+        for (Uint v=0; v<nb_vars; ++v)
+          target[t][ m_target_vars[v] ] = recv_interpolated[pid][it+v];
       }
+      it += nb_vars;
     }
   }
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
 
 void Interpolator::interpolate_vars(const Field& source_field, const common::Table<Real>& target_coords, common::Table<Real>& target, const std::vector<Uint>& source_vars, const std::vector<Uint>& target_vars)
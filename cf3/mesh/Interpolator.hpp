@@ -27,6 +27,11 @@ class APointInterpolator;
 /// mesh as the source, depending on concrete implementations
 /// The interpolation also works with parallel distributed fields. Interpolation
 /// is delegated to the processor that has the necessary source values.
+/// The processors exchange the bounding boxes of their source elements once, and
+/// each target coordinate is only sent to the processors whose bounding box contains it,
+/// in a single all_to_all communication. When the "store" option is set, the stencils and
+/// weights are kept on the processors owning the source values, as a distributed sparse
+/// operator that is applied with a single all_to_all of the interpolated values.
 /// @author Willem Deconinck
 class Mesh_API Interpolator : public AInterpolator {
 
@@ -56,6 +61,15 @@ public: // functions
 
 private: // functions
 
+  /// Send each target coordinate to the processors whose source elements may contain it
+  /// @param [in]  dict             Dictionary to interpolate from
+  /// @param [in]  target_coords    Table with coordinates to interpolate to
+  /// @param [out] sent_rows        For each processor, the rows of target_coords sent to it
+  /// @param [out] received_coords  For each processor, the coordinates it sent to this processor
+  void send_to_candidates(const Dictionary& dict, const common::Table<Real>& target_coords,
+                          std::vector< std::vector<Uint> >& sent_rows,
+                          std::vector< std::vector<Real> >& received_coords) const;
+
   void store(const Dictionary& dict, const common::Table<Real>& target_coords);
 
   void stored_interpolation(const Field& source_field, common::Table<Real>& target);
@@ -77,12 +91,12 @@ private: // data
   Handle<common::Table<Real> const> m_table;
 
   // Values for each processor
-  std::vector< int                                   > m_proc;
-  std::vector< std::vector< Uint                   > > m_expect_recv;
-  std::vector< std::vector< SpaceElem              > > m_stored_element;
-  std::vector< std::vector< std::vector<SpaceElem> > > m_stored_stencil;
-  std::vector< std::vector< std::vector<Uint>      > > m_stored_source_field_points;
-  std::vector< std::vector< std::vector<Real>      > > m_stored_source_field_weights;
+  // Row r of the stored operator for processor pid uses the source points and weights
+  // in the range [ m_stored_offsets[pid][r], m_stored_offsets[pid][r+1] )
+  std::vector< std::vector<Uint> > m_expect_recv;
+  std::vector< std::vector<Uint> > m_stored_offsets;
+  std::vector< std::vector<Uint> > m_stored_source_field_points;
+  std::vector< std::vector<Real> > m_stored_source_field_weights;
 
   // store variable indices in table rows
   std::vector<Uint> m_source_vars;
@@ -102,7 +116,7 @@ public:
   /// @param name of the component
   InterpolatorT<POINTINTERPOLATOR> ( const std::string& name ) : Interpolator(name)
   {
-    remove_component(*m_point_interpolator);
+    remove_component("point_interpolator");
     m_point_interpolator = Handle<APointInterpolator>( create_component<POINTINTERPOLATOR>("point_interpolator") );
   }
 
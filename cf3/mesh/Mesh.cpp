@@ -44,8 +44,13 @@
 #include "mesh/Field.hpp"
 #include "mesh/MeshElements.hpp"
 #include "mesh/ElementType.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGeometryCache.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/Elements.hpp"
 #include "mesh/WriteMesh.hpp"
 #include "mesh/MeshMetadata.hpp"
+#include "mesh/UsedNodesCache.hpp"
 #include "mesh/Cells.hpp"
 #include "mesh/Faces.hpp"
 #include "mesh/BoundingBox.hpp"
@@ -84,6 +89,7 @@ Mesh::Mesh ( const std::string& name  ) :
 
   m_local_bounding_box  = create_static_component<BoundingBox>("bounding_box_local");
   m_global_bounding_box = create_static_component<BoundingBox>("bounding_box_global");
+  m_used_nodes_cache = create_static_component<UsedNodesCache>("used_nodes_cache");
 
   regist_signal ( "write_mesh" )
       .description( "Write mesh, guessing automatically the format" )
@@ -486,8 +492,18 @@ void Mesh::raise_mesh_loaded()
     m_dictionaries[dict_idx]->update_structures();
     m_dictionaries[dict_idx]->rebuild_map_glb_to_loc();
     m_dictionaries[dict_idx]->rebuild_node_to_element_connectivity();
+    m_dictionaries[dict_idx]->invalidate_periodic_inverse_links();
   }
 
+  // Cached element colorings, ghost classifications and geometric factors depend on the connectivity, the node ranks and the coordinates
+  boost_foreach ( Elements& elements, find_components_recursively<Elements>(topology()) )
+  {
+    elements.coloring().invalidate();
+    elements.ghost_classification().invalidate();
+    elements.geometry_cache().invalidate();
+  }
+  m_used_nodes_cache->clear();
+
   check_sanity();
 
   // Raise an event to indicate that this mesh was loaded
@@ -513,7 +529,17 @@ void Mesh::raise_mesh_changed()
   {
     m_dictionaries[dict_idx]->rebuild_map_glb_to_loc();
     m_dictionaries[dict_idx]->rebuild_node_to_element_connectivity();
+    m_dictionaries[dict_idx]->invalidate_periodic_inverse_links();
+  }
+
+  // Cached element colorings, ghost classifications and geometric factors depend on the connectivity, the node ranks and the coordinates
+  boost_foreach ( Elements& elements, find_components_recursively<Elements>(topology()) )
+  {
+    elements.coloring().invalidate();
+    elements.ghost_classification().invalidate();
+    elements.geometry_cache().invalidate();
   }
+  m_used_nodes_cache->clear();
 
   check_sanity();
 
@@ -24,6 +24,7 @@ namespace mesh {
   class Region;
   class MeshElements;
   class MeshMetadata;
+  class UsedNodesCache;
   class BoundingBox;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -103,6 +104,9 @@ public: // functions
   const Handle<BoundingBox>& local_bounding_box()  const { return m_local_bounding_box; }
   const Handle<BoundingBox>& global_bounding_box() const { return m_global_bounding_box; }
 
+  /// Cached used node lists, cleared when the mesh is loaded or changed
+  UsedNodesCache& used_nodes_cache() const { return *m_used_nodes_cache; }
+
 private: // data
 
   Uint m_dimension;
@@ -121,6 +125,8 @@ private: // data
 
   Handle<BoundingBox> m_local_bounding_box;
   Handle<BoundingBox> m_global_bounding_box;
+
+  Handle<UsedNodesCache> m_used_nodes_cache;
   
   bool m_block_mesh_changed;
 
@@ -351,7 +351,7 @@ void MeshAdaptor::restore_element_node_connectivity()
         //PECheckPoint(100,space->dict().uri());
         //PECheckPoint(100,"global connectivity = \n"<<space->connectivity());
         //PECheckPoint(100,"global nodes = \n"<<space->dict().glb_idx());
-        const common::Map<boost::uint64_t,Uint>& glb_to_loc = space->dict().glb_to_loc();
+        const Dictionary::GlbToLocT& glb_to_loc = space->dict().glb_to_loc();
         boost_foreach ( Connectivity::Row nodes, space->connectivity().array() )
         {
           boost_foreach ( Uint& node, nodes )
@@ -789,7 +789,7 @@ void MeshAdaptor::send_nodes(const std::vector< std::vector< std::vector<Uint> >
       received_glb_nodes_pid[recv_pid][unpacked_node.dict_idx()].insert( unpacked_node.glb_idx() );
 
       // Component to check if a node is already existing. If so, the unpacked node doesn't need to be added anymore
-      const common::Map<boost::uint64_t,Uint>& glb_to_loc = m_mesh->dictionaries()[unpacked_node.dict_idx()]->glb_to_loc();
+      const Dictionary::GlbToLocT& glb_to_loc = m_mesh->dictionaries()[unpacked_node.dict_idx()]->glb_to_loc();
       if (!glb_to_loc.exists(unpacked_node.glb_idx()))
       {
         add_node(unpacked_node);
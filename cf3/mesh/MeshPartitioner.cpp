@@ -6,6 +6,8 @@
 
 #include <set>
 
+#include <boost/assign/std/vector.hpp>
+
 #include "common/Foreach.hpp"
 #include "common/Log.hpp"
 #include "common/Signal.hpp"
@@ -19,6 +21,7 @@
 #include "common/StringConversion.hpp"
 #include "common/DynTable.hpp"
 #include "common/List.hpp"
+#include "common/PropertyList.hpp"
 
 #include "common/XML/Protocol.hpp"
 #include "common/XML/SignalOptions.hpp"
@@ -29,6 +32,8 @@
 #include "mesh/Region.hpp"
 #include "mesh/MeshAdaptor.hpp"
 #include "mesh/MeshElements.hpp"
+#include "mesh/ShapeFunction.hpp"
+#include "mesh/Space.hpp"
 
 namespace cf3 {
 namespace mesh {
@@ -37,13 +42,16 @@ namespace mesh {
   using namespace common;
   using namespace common::XML;
   using namespace common::PE;
+  using namespace boost::assign; // bring 'operator+=()' into scope
 
 //////////////////////////////////////////////////////////////////////////////
 
 MeshPartitioner::MeshPartitioner ( const std::string& name ) :
     MeshTransformer(name),
     m_base(0),
-    m_nb_parts(PE::Comm::instance().size())
+    m_nb_parts(PE::Comm::instance().size()),
+    m_cost_model("Uniform"),
+    m_node_weight(1.)
 {
   options().add("nb_parts", m_nb_parts)
       .description("Total number of partitions (e.g. number of processors)")
@@ -51,6 +59,20 @@ MeshPartitioner::MeshPartitioner ( const std::string& name ) :
       .link_to(&m_nb_parts)
       .mark_basic();
 
+  options().add("cost_model", m_cost_model)
+      .description("Model for the computational cost of the elements, used as vertex weight in the graph. "
+                   "Uniform: all elements have the same cost. "
+                   "Nodes: the cost is proportional to the largest number of nodes per element over all spaces. "
+                   "Measured: the cost is taken from the computational_cost property of each element component, as set by LoadBalance.")
+      .pretty_name("Cost Model")
+      .link_to(&m_cost_model)
+      .restricted_list() += std::string("Nodes"), std::string("Measured");
+
+  options().add("node_weight", m_node_weight)
+      .description("Weight of a node in the graph, relative to the mean element weight")
+      .pretty_name("Node Weight")
+      .link_to(&m_node_weight);
+
   m_global_to_local = create_static_component<common::Map<Uint,Uint> >("global_to_local");
   m_lookup = create_static_component<UnifiedData >("lookup");
 
@@ -184,10 +206,12 @@ void MeshPartitioner::initialize(Mesh& mesh)
     start_id += nb_obj_per_proc[p];
   }
 
-  m_nodes_to_export.resize(m_nb_parts);
-  m_elements_to_export.resize(m_nb_parts,std::vector< std::vector<Uint> >(mesh.elements().size()));
+  // clear the results of a previous partitioning, as the partitioner may be executed repeatedly
+  m_nodes_to_export.assign(m_nb_parts, std::vector<Uint>());
+  m_elements_to_export.assign(m_nb_parts,std::vector< std::vector<Uint> >(mesh.elements().size()));
 
   build_global_to_local_index(mesh);
+  compute_entities_weights(mesh);
   build_graph();
 
 //  mesh.update_statistics();
@@ -205,6 +229,9 @@ void MeshPartitioner::build_global_to_local_index(Mesh& mesh)
 {
   Dictionary& nodes = mesh.geometry_fields();
 
+  m_lookup->reset();
+  m_global_to_local->clear();
+
   m_lookup->add(nodes);
   boost_foreach ( const Handle<Entities>& elements, mesh.elements() )
     m_lookup->add(*elements);
@@ -270,6 +297,65 @@ void MeshPartitioner::build_global_to_local_index(Mesh& mesh)
 
 //////////////////////////////////////////////////////////////////////////////
 
+void MeshPartitioner::compute_entities_weights(Mesh& mesh)
+{
+  const std::vector< Handle<Entities> >& entities = mesh.elements();
+  const Uint nb_entities = entities.size();
+  m_entities_weights.assign(nb_entities, 1.);
+  if(m_cost_model == "Uniform")
+    return;
+
+  std::vector<bool> has_cost(nb_entities, true);
+  for(Uint i = 0; i != nb_entities; ++i)
+  {
+    if(m_cost_model == "Nodes")
+    {
+      Uint nb_nodes = 0;
+      boost_foreach(const Handle<Space>& space, entities[i]->spaces())
+        nb_nodes = std::max(nb_nodes, space->shape_function().nb_nodes());
+      m_entities_weights[i] = static_cast<Real>(nb_nodes);
+    }
+    else if(entities[i]->properties().check("computational_cost"))
+    {
+      m_entities_weights[i] = entities[i]->properties().value<Real>("computational_cost");
+      if(m_entities_weights[i] < 0.)
+        throw BadValue(FromHere(), "Negative computational_cost for " + entities[i]->uri().path());
+    }
+    else
+    {
+      has_cost[i] = false;
+    }
+  }
+
+  // Global mean cost per element, over the components for which the cost is known
+  Real loc_sums[2] = {0., 0.};
+  for(Uint i = 0; i != nb_entities; ++i)
+  {
+    if(has_cost[i])
+    {
+      loc_sums[0] += m_entities_weights[i] * static_cast<Real>(entities[i]->size());
+      loc_sums[1] += static_cast<Real>(entities[i]->size());
+    }
+  }
+  Real glb_sums[2] = {loc_sums[0], loc_sums[1]};
+  if(PE::Comm::instance().is_active())
+    PE::Comm::instance().all_reduce(PE::plus(), loc_sums, 2, glb_sums);
+
+  if(glb_sums[0] <= 0.)
+  {
+    CFwarn << "No computational cost available for the elements of " << mesh.uri().path() << ", using uniform weights" << CFendl;
+    m_entities_weights.assign(nb_entities, 1.);
+    return;
+  }
+
+  // Components without a measured cost get the mean cost, and all weights are normalized to a mean of 1
+  const Real mean_cost = glb_sums[0] / glb_sums[1];
+  for(Uint i = 0; i != nb_entities; ++i)
+    m_entities_weights[i] = has_cost[i] ? m_entities_weights[i] / mean_cost : 1.;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void MeshPartitioner::show_changes()
 {
   Uint nb_changes(0);
@@ -101,6 +101,17 @@ public: // functions
   template <typename VectorT>
   void list_of_connected_procs_in_part(const Uint part, VectorT& proc_per_neighbor) const;
 
+  /// Vertex weights of the objects owned by the part, in the same order as list_of_objects_owned_by_part
+  template <typename WeightsT>
+  void list_of_object_weights_in_part(const Uint part, WeightsT& obj_weights) const;
+
+  /// True if the objects have different weights, as set by the cost_model option
+  bool has_object_weights() const { return m_cost_model != "Uniform"; }
+
+  /// Weight of a single element of each element component, in the order of Mesh::elements().
+  /// The weights are normalized so that the mean weight over all elements of all processors is 1.
+  const std::vector<Real>& entities_weights() const { return m_entities_weights; }
+
 
 public: // functions
 
@@ -139,6 +150,9 @@ protected: // functions
   
   Uint periodic_target_node(Uint node) const;
 
+  /// Compute the weight of the elements of each element component, according to the cost model
+  void compute_entities_weights(Mesh& mesh);
+
 protected: // data
 
   /// nodes_to_export[part][loc_node_idx]
@@ -169,6 +183,15 @@ private: // data
 
   std::vector< std::pair<bool, Uint > > m_periodic_links;
   std::vector< std::vector<Uint> > m_inverse_periodic_links;
+
+  /// Cost model used to weigh the elements
+  std::string m_cost_model;
+
+  /// Weight of a node in the graph
+  Real m_node_weight;
+
+  /// Weight of a single element, for each element component
+  std::vector<Real> m_entities_weights;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -294,6 +317,35 @@ void MeshPartitioner::list_of_connected_objects_in_part(const Uint part, VectorT
 
 //////////////////////////////////////////////////////////////////////////////
 
+template <typename WeightsT>
+void MeshPartitioner::list_of_object_weights_in_part(const Uint part, WeightsT& obj_weights) const
+{
+  // declaration for boost::tie
+  Uint comp;
+  Uint loc_idx;
+
+  Uint idx = 0;
+  foreach_container((const Uint glb_obj)(const Uint loc_obj),*m_global_to_local)
+  {
+    if (part_of_obj(glb_obj) == part)
+    {
+      boost::tie(comp,loc_idx) = m_lookup->location_idx(loc_obj);
+      if (comp == 0) // node
+      {
+        if(!m_periodic_links[loc_idx].first)
+          obj_weights[idx++] = m_node_weight;
+      }
+      else
+      {
+        obj_weights[idx++] = m_entities_weights[comp-1];
+      }
+    }
+  }
+  cf3_assert( idx == nb_objects_owned_by_part(part) );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 template <typename VectorT>
 void MeshPartitioner::list_of_connected_procs_in_part(const Uint part, VectorT& connected_procs) const
 {
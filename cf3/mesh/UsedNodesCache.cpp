@@ -0,0 +1,107 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include "common/Builder.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/PropertyList.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/UsedNodesCache.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < UsedNodesCache, Component, LibMesh > UsedNodesCache_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+UsedNodesCache::UsedNodesCache ( const std::string& name ) :
+  Component ( name )
+{
+  properties()["brief"] = std::string("Cache for the lists of nodes used by sets of entities");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UsedNodesCache::~UsedNodesCache()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr< List<Uint> const > UsedNodesCache::used_nodes( const std::vector< Handle<Entities const> >& entities, const Dictionary& dictionary, const bool include_ghost_elems, const bool follow_periodic_links )
+{
+  Key key;
+  key.entities.reserve(entities.size());
+  boost_foreach(const Handle<Entities const>& entities_h, entities)
+    key.entities.push_back(entities_h.get());
+  std::sort(key.entities.begin(), key.entities.end());
+  key.entities.erase(std::unique(key.entities.begin(), key.entities.end()), key.entities.end());
+  key.dictionary = &dictionary;
+  key.include_ghost_elems = include_ghost_elems;
+  key.follow_periodic_links = follow_periodic_links;
+
+  Entry& entry = m_entries[key];
+  if(is_null(entry.used_nodes) || !entry.is_valid())
+  {
+    entry.entities = entities;
+    entry.dictionary = dictionary.handle<Dictionary>();
+    entry.dictionary_size = dictionary.size();
+    entry.used_nodes = build_used_nodes_list(entities, dictionary, include_ghost_elems, follow_periodic_links);
+  }
+
+  return entry.used_nodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UsedNodesCache::clear()
+{
+  m_entries.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UsedNodesCache::Key::operator<(const Key& other) const
+{
+  if(dictionary != other.dictionary)
+    return dictionary < other.dictionary;
+  if(include_ghost_elems != other.include_ghost_elems)
+    return include_ghost_elems < other.include_ghost_elems;
+  if(follow_periodic_links != other.follow_periodic_links)
+    return follow_periodic_links < other.follow_periodic_links;
+  return entities < other.entities;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UsedNodesCache::Entry::is_valid() const
+{
+  if(is_null(dictionary) || dictionary->size() != dictionary_size)
+    return false;
+
+  boost_foreach(const Handle<Entities const>& entities_h, entities)
+  {
+    if(is_null(entities_h))
+      return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
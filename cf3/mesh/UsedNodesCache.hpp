@@ -0,0 +1,86 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_UsedNodesCache_hpp
+#define cf3_mesh_UsedNodesCache_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+
+#include "common/Component.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+namespace cf3 {
+namespace common { template <typename T> class List; }
+namespace mesh {
+
+  class Dictionary;
+  class Entities;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Stores the results of build_used_nodes_list, keyed on the set of entities, the dictionary and the flags.
+/// The mesh owns one instance and clears it when raising the mesh_loaded or mesh_changed events.
+/// An entry is also rebuilt if one of its entities was removed or the dictionary was resized.
+class Mesh_API UsedNodesCache : public common::Component
+{
+public:
+
+  /// Contructor
+  /// @param name of the component
+  UsedNodesCache ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~UsedNodesCache();
+
+  /// Get the class name
+  static std::string type_name () { return "UsedNodesCache"; }
+
+  /// Get the used nodes, building them with build_used_nodes_list if they are not cached yet.
+  /// The arguments have the same meaning as for build_used_nodes_list. The order of the entities does not matter.
+  boost::shared_ptr< common::List<Uint> const > used_nodes( const std::vector< Handle<Entities const> >& entities, const Dictionary& dictionary, const bool include_ghost_elems, const bool follow_periodic_links = true );
+
+  /// Remove all cached lists
+  void clear();
+
+  /// Number of cached lists
+  Uint size() const { return m_entries.size(); }
+
+private:
+  struct Key
+  {
+    std::vector<Entities const*> entities;
+    Dictionary const* dictionary;
+    bool include_ghost_elems;
+    bool follow_periodic_links;
+
+    bool operator<(const Key& other) const;
+  };
+
+  struct Entry
+  {
+    std::vector< Handle<Entities const> > entities;
+    Handle<Dictionary const> dictionary;
+    Uint dictionary_size;
+    boost::shared_ptr< common::List<Uint> const > used_nodes;
+
+    /// True if none of the components used to build the entry was removed or resized
+    bool is_valid() const;
+  };
+
+  std::map<Key, Entry> m_entries;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_UsedNodesCache_hpp
@@ -16,10 +16,14 @@
 
 #include "mesh/ConnectivityData.hpp"
 #include "mesh/DiscontinuousDictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/Elements.hpp"
 #include "mesh/Faces.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Mesh.hpp"
+#include "mesh/UsedNodesCache.hpp"
 #include "mesh/MeshAdaptor.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Functions.hpp"
@@ -151,6 +155,8 @@ void LinkPeriodicNodes::execute()
 
   common::List<Uint>& periodic_links_nodes = *periodic_links_nodes_h;
   common::List<bool>& periodic_links_active = *periodic_links_active_h;
+  mesh.geometry_fields().invalidate_periodic_inverse_links();
+  mesh.used_nodes_cache().clear();
 
   if(periodic_links_nodes.size() != mesh.geometry_fields().size())
   {
@@ -199,6 +205,14 @@ void LinkPeriodicNodes::execute()
       }
     }
   }
+
+  // The element coloring follows the periodic links and the ghost classification depends on the node ranks,
+  // so both must be rebuilt
+  BOOST_FOREACH(Elements& elements, common::find_components_recursively<Elements>(mesh.topology()))
+  {
+    elements.coloring().invalidate();
+    elements.ghost_classification().invalidate();
+  }
 /*
   boost::shared_ptr<NodeConnectivity> node_connectivity = common::allocate_component<NodeConnectivity>("node_connectivity");
   node_connectivity->initialize(common::find_components_recursively_with_filter<mesh::Entities>(*m_destination_region, IsElementsSurface()));
@@ -6,16 +6,26 @@
 
 #include "coolfluid-packages.hpp"
 
+#include <map>
+
 #include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
 #include "common/PropertyList.hpp"
+#include "common/TimedComponent.hpp"
+#include "common/TypeInfo.hpp"
 
 #include "common/PE/Comm.hpp"
 
 #include "mesh/actions/LoadBalance.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
+#include "mesh/ShapeFunction.hpp"
+#include "mesh/Space.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -32,17 +42,74 @@ common::ComponentBuilder < LoadBalance, MeshTransformer, mesh::actions::LibActio
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Mark the element components of the mesh that are looped over by the given action, based on its regions option.
+/// Actions without regions are assumed to loop over the complete mesh.
+void mark_looped_entities(const Component& action, const Mesh& mesh, std::vector<bool>& is_looped)
+{
+  const std::vector< Handle<Entities> >& entities = mesh.elements();
+  is_looped.assign(entities.size(), false);
+
+  std::vector<URI> region_uris;
+  if(action.options().check("regions") && action.options().option("regions").type() == class_name< std::vector<URI> >())
+    region_uris = action.options().value< std::vector<URI> >("regions");
+
+  if(region_uris.empty())
+  {
+    is_looped.assign(entities.size(), true);
+    return;
+  }
+
+  std::map<const Entities*, Uint> entities_idx;
+  for(Uint i = 0; i != entities.size(); ++i)
+    entities_idx[entities[i].get()] = i;
+
+  boost_foreach(const URI& region_uri, region_uris)
+  {
+    Handle<Component const> region = region_uri.is_relative() ? mesh.access_component(region_uri) : action.access_component(region_uri);
+    if(is_null(region))
+      throw ValueNotFound(FromHere(), "Could not find region " + region_uri.path() + " of action " + action.uri().path());
+
+    boost_foreach(const Entities& region_entities, find_components_recursively<Entities>(*region))
+    {
+      std::map<const Entities*, Uint>::const_iterator it = entities_idx.find(&region_entities);
+      if(it != entities_idx.end())
+        is_looped[it->second] = true;
+    }
+  }
+}
+
+/// Number of nodes of an element, taken as the largest number over all spaces, as in the Nodes cost model of the partitioner
+Real nb_element_nodes(const Entities& entities)
+{
+  Uint nb_nodes = 0;
+  boost_foreach(const Handle<Space>& space, entities.spaces())
+    nb_nodes = std::max(nb_nodes, space->shape_function().nb_nodes());
+  return static_cast<Real>(nb_nodes);
+}
+
+/// Remove the comm patterns of all dictionaries, so they are set up again on the next synchronization
+void invalidate_comm_patterns(Mesh& mesh)
+{
+  boost_foreach(const Handle<Dictionary>& dict, mesh.dictionaries())
+    dict->invalidate_comm_pattern();
+}
+
+} // detail
+
+//////////////////////////////////////////////////////////////////////////////
+
 LoadBalance::LoadBalance( const std::string& name ) :
   MeshTransformer(name)
 #if (defined CF3_HAVE_PTSCOTCH)
   ,m_partitioner(create_component("partitioner", "cf3.mesh.ptscotch.Partitioner"))
 #elif (defined CF3_HAVE_ZOLTAN)
   ,m_partitioner(create_component("partitioner", "cf3.zoltan.PHG"))
-#endif
-
-#if ( !defined CF3_HAVE_PTSCOTCH ) && ( !defined CF3_HAVE_ZOLTAN )
-#warning "There is no partitioner available (Zoltan or PT-Scotch). Load-balancing will not be possible."
-#define CF3_MESH_LOADBALANCE_PARTITIONER_UNAVAILABLE
+#else
+  // no graph partitioning library available, partition using the element centroids
+  ,m_partitioner(create_component("partitioner", "cf3.mesh.GeometricPartitioner"))
 #endif
 {
 
@@ -51,13 +118,192 @@ LoadBalance::LoadBalance( const std::string& name ) :
   desc =
     "  Usage: LoadBalance Regions:array[uri]=region1,region2\n\n";
   properties()["description"] = desc;
+
+  properties().add("imbalance", Real(0.));
+  properties().add("nb_rebalances", Uint(0));
+
+  options().add("dynamic", false)
+    .pretty_name("Dynamic")
+    .description("If true, executions after the first one only repartition and migrate the mesh when the measured imbalance exceeds the tolerance");
+
+  options().add("imbalance_tolerance", 0.1)
+    .pretty_name("Imbalance Tolerance")
+    .description("Relative excess of the most loaded processor over the mean load above which the mesh is repartitioned in dynamic mode");
+
+  options().add("timed_actions", std::vector<URI>())
+    .pretty_name("Timed Actions")
+    .description("Actions of which the execution time is used to measure the cost of the elements they loop over. Requires CF3_ENABLE_COMPONENT_TIMING.");
 }
 
 /////////////////////////////////////////////////////////////////////////////
 
 void LoadBalance::execute()
 {
+  if(options().value<bool>("dynamic") && m_balanced_mesh == m_mesh)
+  {
+    const Real imbalance = measure_imbalance();
+    if(imbalance > options().value<Real>("imbalance_tolerance"))
+    {
+      CFinfo << "load imbalance of " << imbalance*100. << "% exceeds the tolerance" << CFendl;
+      rebalance();
+    }
+    return;
+  }
+
+  balance();
+  m_balanced_mesh = m_mesh;
+
+  // Start measuring from the balanced state
+  store_previous_timings();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void LoadBalance::rebalance()
+{
+  Mesh& mesh = *m_mesh;
+
+  if( !Comm::instance().is_active() || Comm::instance().size() == 1 )
+    return;
+
+  // Measured costs are only available when there are timed actions
+  if(!options().value< std::vector<URI> >("timed_actions").empty())
+    m_partitioner->options().set("cost_model", std::string("Measured"));
+
+  // The comm patterns refer to the rows and arrays from before the migration, so they must not be used while migrating
+  detail::invalidate_comm_patterns(mesh);
+
+  CFinfo << "rebalancing mesh:" << CFendl;
+  CFinfo << "  + removing overlap layer ..." << CFendl;
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.RemoveGhostElements","remove_ghosts")->transform(mesh);
+  CFinfo << "  + removing overlap layer ... done" << CFendl;
+
+  balance();
+
+  // Patterns set up on demand during the migration are outdated as well
+  detail::invalidate_comm_patterns(mesh);
+
+  // Rebuild the connectivity and invalidate the caches that depend on the old distribution, and notify the solvers
+  // so they recreate their linear systems
+  mesh.raise_mesh_changed();
+
+  properties()["nb_rebalances"] = properties().value<Uint>("nb_rebalances") + 1u;
+  store_previous_timings();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+Real LoadBalance::measure_imbalance()
+{
+  const Mesh& mesh = *m_mesh;
+  const std::vector< Handle<Entities> >& entities = mesh.elements();
+  const std::vector<URI> action_uris = options().value< std::vector<URI> >("timed_actions");
+
+  std::vector<Real> total_times;
+  read_timings(total_times);
+
+  // Divide the time spent in each action over the element components it loops over. Only the total time on this
+  // processor is measured, so the share of each component is estimated from its number of nodes per element, as in the
+  // Nodes cost model
+  std::vector<Real> element_weights(entities.size());
+  for(Uint j = 0; j != entities.size(); ++j)
+    element_weights[j] = detail::nb_element_nodes(*entities[j]);
+
+  std::vector<Real> costs(entities.size(), 0.);
+  std::vector<bool> is_looped;
+  Real local_time = 0.;
+  for(Uint i = 0; i != action_uris.size(); ++i)
+  {
+    const Real elapsed = total_times[i] - m_previous_times[action_uris[i].string()];
+    local_time += elapsed;
+
+    detail::mark_looped_entities(*access_component_checked(action_uris[i]), mesh, is_looped);
+    Real total_weight = 0.;
+    for(Uint j = 0; j != entities.size(); ++j)
+    {
+      if(is_looped[j])
+        total_weight += element_weights[j] * static_cast<Real>(entities[j]->size());
+    }
+    if(total_weight == 0.)
+      continue;
+
+    const Real cost_per_weight = elapsed / total_weight;
+    for(Uint j = 0; j != entities.size(); ++j)
+    {
+      if(is_looped[j])
+        costs[j] += cost_per_weight * element_weights[j];
+    }
+  }
+  store_previous_timings(total_times);
+
+  if(action_uris.empty())
+    return properties().value<Real>("imbalance");
+
+  // Elements that are not looped over by any timed action get a cost of zero
+  for(Uint j = 0; j != entities.size(); ++j)
+    entities[j]->properties()["computational_cost"] = costs[j];
+
+  Real max_time = local_time;
+  Real sum_time = local_time;
+  Uint nb_procs = 1;
+  if(Comm::instance().is_active())
+  {
+    Comm::instance().all_reduce(PE::max(), &local_time, 1, &max_time);
+    Comm::instance().all_reduce(PE::plus(), &local_time, 1, &sum_time);
+    nb_procs = Comm::instance().size();
+  }
+
+  const Real mean_time = sum_time / static_cast<Real>(nb_procs);
+  const Real imbalance = mean_time > 0. ? max_time / mean_time - 1. : 0.;
+  properties()["imbalance"] = imbalance;
+  return imbalance;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void LoadBalance::read_timings(std::vector<Real>& total_times)
+{
+  const std::vector<URI> action_uris = options().value< std::vector<URI> >("timed_actions");
+  total_times.resize(action_uris.size());
+  for(Uint i = 0; i != action_uris.size(); ++i)
+  {
+    Handle<Component> action = access_component_checked(action_uris[i]);
+    // store_timings(Component&) only visits the components below the given one, so the action is asked directly
+    TimedComponent* timed_action = dynamic_cast<TimedComponent*>(action.get());
+    if(is_not_null(timed_action))
+      timed_action->store_timings();
+    if(!action->properties().check("timer_mean"))
+      throw SetupError(FromHere(), "Action " + action->uri().path() + " has no timing information. Build with CF3_ENABLE_COMPONENT_TIMING to measure element costs.");
+
+    // The mean is not a number before the first execution
+    const Uint count = action->properties().value<Uint>("timer_count");
+    total_times[i] = count == 0 ? 0. : action->properties().value<Real>("timer_mean") * static_cast<Real>(count);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void LoadBalance::store_previous_timings()
+{
+  std::vector<Real> total_times;
+  read_timings(total_times);
+  store_previous_timings(total_times);
+}
 
+/////////////////////////////////////////////////////////////////////////////
+
+void LoadBalance::store_previous_timings(const std::vector<Real>& total_times)
+{
+  const std::vector<URI> action_uris = options().value< std::vector<URI> >("timed_actions");
+  m_previous_times.clear();
+  for(Uint i = 0; i != action_uris.size(); ++i)
+    m_previous_times[action_uris[i].string()] = total_times[i];
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void LoadBalance::balance()
+{
   Mesh& mesh = *m_mesh;
 
   // balance if parallel run with multiple processors
@@ -82,13 +328,9 @@ void LoadBalance::execute()
     CFinfo << "  + building global node-element connectivity ... done" << CFendl;
     Comm::instance().barrier();
 
-#ifdef CF3_MESH_LOADBALANCE_PARTITIONER_UNAVAILABLE
-    CFwarn << "  Skipping mesh partitioning. (No partitioner available)" << CFendl;
-#else
     CFinfo << "  + partitioning and migrating ..." << CFendl;
     m_partitioner->transform(mesh);
     CFinfo << "  + partitioning and migrating ... done" << CFendl;
-#endif
 #ifndef CF3_HAVE_ZOLTAN
     Comm::instance().barrier();
     CFinfo << "  + growing overlap layer ..." << CFendl;
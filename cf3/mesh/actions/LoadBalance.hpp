@@ -9,6 +9,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <map>
+
 #include "math/MatrixTypes.hpp"
 #include "mesh/MeshTransformer.hpp"
 #include "mesh/actions/LibActions.hpp"
@@ -23,6 +25,12 @@ namespace actions {
 
 /// @brief Load Balance the mesh
 ///
+/// The element weights used by the partitioner are set by its cost_model option. The cost of each element component
+/// can be measured from the timings of the actions listed in the timed_actions option: the time spent in an action
+/// is divided over the elements of the regions it loops over, in proportion to their number of nodes, and stored in
+/// the computational_cost property of each element component. In dynamic mode, the first execution partitions the mesh
+/// and each later execution only repartitions and migrates the mesh when the measured imbalance exceeds the
+/// imbalance_tolerance. A rebalance raises the mesh_changed event, so solvers can recreate their linear systems.
 /// @post After this, the mesh is ready to be parallellized
 /// @author Willem Deconinck
 class mesh_actions_API LoadBalance : public MeshTransformer
@@ -37,10 +45,35 @@ public: // functions
 
   virtual void execute();
 
+  /// Update the computational_cost of the element components from the time spent in the timed actions
+  /// since the previous measurement.
+  /// @return the load imbalance, i.e. the maximum over the processors of the time spent divided by the mean, minus one
+  Real measure_imbalance();
+
+  /// Repartition and migrate a mesh that was balanced before, removing and regrowing the overlap.
+  /// The comm patterns of the dictionaries are invalidated and Mesh::raise_mesh_changed is called.
+  void rebalance();
+
 private:
 
+  /// Build the global numbering, partition and migrate the mesh and grow the overlap
+  void balance();
+
+  /// Total time spent in each timed action, as stored in its timing properties
+  void read_timings(std::vector<Real>& total_times);
+
+  /// Remember the current total times, as the starting point for the next measurement
+  void store_previous_timings();
+  void store_previous_timings(const std::vector<Real>& total_times);
+
   Handle<MeshTransformer> m_partitioner;
 
+  /// Total time spent in each timed action at the previous measurement, by action URI
+  std::map<std::string, Real> m_previous_times;
+
+  /// Mesh that was balanced by the last execution
+  Handle<Mesh> m_balanced_mesh;
+
 }; // end LoadBalance
 
 
@@ -0,0 +1,486 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/assign/std/vector.hpp>
+
+#include "common/Builder.hpp"
+#include "common/DynTable.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "math/Hilbert.hpp"
+
+#include "mesh/BoundingBox.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/FaceCellConnectivity.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+using namespace common;
+using namespace boost::assign; // bring 'operator+=()' into scope
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < Renumber, MeshTransformer, mesh::actions::LibActions> Renumber_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Move row i of the table to new_idx[i]
+template<typename ValueT>
+void permute_rows(common::Table<ValueT>& table, const std::vector<Uint>& new_idx)
+{
+  cf3_assert(table.size() == new_idx.size());
+  const typename common::Table<ValueT>::ArrayT old_array = table.array();
+  typename common::Table<ValueT>::ArrayT& array = table.array();
+  const Uint nb_rows = new_idx.size();
+  for(Uint i = 0; i != nb_rows; ++i)
+    array[new_idx[i]] = old_array[i];
+}
+
+/// Move entry i of the list to new_idx[i]
+template<typename ValueT>
+void permute_rows(common::List<ValueT>& list, const std::vector<Uint>& new_idx)
+{
+  cf3_assert(list.size() == new_idx.size());
+  const typename common::List<ValueT>::ListT old_array = list.array();
+  typename common::List<ValueT>::ListT& array = list.array();
+  const Uint nb_rows = new_idx.size();
+  for(Uint i = 0; i != nb_rows; ++i)
+    array[new_idx[i]] = old_array[i];
+}
+
+/// Convert a list of indices in the new order to the new index of each old index
+void order_to_new_idx(const std::vector<Uint>& order, std::vector<Uint>& new_idx)
+{
+  new_idx.resize(order.size());
+  for(Uint i = 0; i != order.size(); ++i)
+    new_idx[order[i]] = i;
+}
+
+/// Sort the indices 0..keys.size()-1 by key, keeping the original order for equal keys
+template<typename KeyT>
+void sort_by_key(const std::vector<KeyT>& keys, std::vector<Uint>& new_idx)
+{
+  std::vector< std::pair<KeyT, Uint> > sorted(keys.size());
+  for(Uint i = 0; i != keys.size(); ++i)
+    sorted[i] = std::make_pair(keys[i], i);
+  std::sort(sorted.begin(), sorted.end());
+
+  new_idx.resize(keys.size());
+  for(Uint i = 0; i != sorted.size(); ++i)
+    new_idx[sorted[i].second] = i;
+}
+
+/// Number the nodes of a dictionary in the order in which the elements use them. Unused nodes go last.
+void first_use_order(const Dictionary& dict, std::vector<Uint>& new_idx)
+{
+  const Uint nb_nodes = dict.size();
+  const Uint unnumbered = std::numeric_limits<Uint>::max();
+  new_idx.assign(nb_nodes, unnumbered);
+  Uint next_idx = 0;
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    boost_foreach(const Connectivity::ConstRow row, space->connectivity().array())
+    {
+      boost_foreach(const Uint node, row)
+      {
+        if(new_idx[node] == unnumbered)
+          new_idx[node] = next_idx++;
+      }
+    }
+  }
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    if(new_idx[i] == unnumbered)
+      new_idx[i] = next_idx++;
+  }
+}
+
+/// Breadth-first search from start over the unvisited nodes, visiting neighbours by increasing degree.
+/// Appends the visited nodes to order and returns the number of levels. last_level_begin is set to the position in order where the last level starts.
+Uint cuthill_mckee(const std::vector< std::vector<Uint> >& graph, const Uint start, std::vector<bool>& visited, std::vector<Uint>& order, Uint& last_level_begin)
+{
+  order.push_back(start);
+  visited[start] = true;
+  Uint nb_levels = 1;
+  Uint level_begin = order.size() - 1;
+  Uint level_end = order.size();
+  std::vector< std::pair<Uint, Uint> > neighbours;
+  for(Uint i = level_begin; i != order.size(); ++i)
+  {
+    if(i == level_end)
+    {
+      level_begin = level_end;
+      level_end = order.size();
+      ++nb_levels;
+    }
+    neighbours.clear();
+    boost_foreach(const Uint neighbour, graph[order[i]])
+    {
+      if(!visited[neighbour])
+      {
+        visited[neighbour] = true;
+        neighbours.push_back(std::make_pair(static_cast<Uint>(graph[neighbour].size()), neighbour));
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    for(Uint j = 0; j != neighbours.size(); ++j)
+      order.push_back(neighbours[j].second);
+  }
+  last_level_begin = level_begin;
+  return nb_levels;
+}
+
+/// Find a node with a large eccentricity in the connected component of start, by repeated breadth-first searches
+Uint pseudo_peripheral_node(const std::vector< std::vector<Uint> >& graph, Uint start)
+{
+  std::vector<bool> visited(graph.size(), false);
+  std::vector<Uint> order;
+  Uint last_level = 0;
+  Uint nb_levels = cuthill_mckee(graph, start, visited, order, last_level);
+  for(Uint iteration = 0; iteration != 10; ++iteration)
+  {
+    // Restart from the node with the lowest degree among the nodes furthest away
+    Uint candidate = order[last_level];
+    for(Uint i = last_level; i != order.size(); ++i)
+    {
+      if(graph[order[i]].size() < graph[candidate].size())
+        candidate = order[i];
+    }
+
+    boost_foreach(const Uint node, order)
+      visited[node] = false;
+    order.clear();
+    const Uint candidate_levels = cuthill_mckee(graph, candidate, visited, order, last_level);
+    if(candidate_levels <= nb_levels)
+      break;
+    start = candidate;
+    nb_levels = candidate_levels;
+  }
+  return start;
+}
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+Renumber::Renumber( const std::string& name )
+: MeshTransformer(name)
+{
+  properties()["brief"] = std::string("Renumber nodes and elements for memory locality");
+  properties()["description"] = std::string("Orders the geometry nodes along a Hilbert curve or using reverse Cuthill-McKee, "
+                                            "and the elements along the Hilbert curve or by their lowest node.");
+
+  options().add("method", std::string("Hilbert"))
+    .pretty_name("Method")
+    .description("Ordering of the geometry nodes: Hilbert for a space-filling curve, RCM for reverse Cuthill-McKee on the node graph")
+    .restricted_list() += std::string("RCM");
+
+  options().add("renumber_elements", true)
+    .pretty_name("Renumber Elements")
+    .description("Also renumber the elements of each Entities");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Renumber::execute()
+{
+  Mesh& mesh = *m_mesh;
+  const std::string method = options().value<std::string>("method");
+  const bool do_elements = options().value<bool>("renumber_elements");
+
+  if(do_elements && !find_components_recursively<FaceCellConnectivity>(mesh).empty())
+    throw SetupError(FromHere(), "Mesh " + mesh.uri().path() + " has face connectivity, which refers to element indices. Renumber must run before BuildFaces.");
+
+  const Uint bandwidth_before = node_bandwidth(mesh);
+
+  // Geometry nodes
+  std::vector<Uint> new_idx;
+  if(method == "RCM")
+    rcm_node_order(new_idx);
+  else
+    hilbert_node_order(new_idx);
+  renumber_nodes(mesh.geometry_fields(), new_idx);
+
+  // Elements
+  if(do_elements)
+  {
+    boost_foreach(const Handle<Entities>& entities, mesh.elements())
+    {
+      if(is_null(entities) || entities->size() == 0)
+        continue;
+      if(method == "RCM")
+        node_element_order(*entities, new_idx);
+      else
+        hilbert_element_order(*entities, new_idx);
+      renumber_elements(*entities, new_idx);
+    }
+  }
+
+  // Nodes of the other dictionaries follow the elements
+  boost_foreach(const Handle<Dictionary>& dict, mesh.dictionaries())
+  {
+    if(is_null(dict) || dict == mesh.geometry_fields().handle<Dictionary>())
+      continue;
+    detail::first_use_order(*dict, new_idx);
+    renumber_nodes(*dict, new_idx);
+  }
+
+  mesh.raise_mesh_changed();
+
+  CFinfo << "Renumbered " << mesh.geometry_fields().size() << " nodes of " << mesh.uri().path() << " using " << method
+         << ", node bandwidth changed from " << bandwidth_before << " to " << node_bandwidth(mesh) << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Renumber::hilbert_node_order(std::vector<Uint>& new_idx) const
+{
+  const Field& coordinates = m_mesh->geometry_fields().coordinates();
+  const Uint nb_nodes = coordinates.size();
+
+  boost::shared_ptr<BoundingBox> bounding_box = allocate_component<BoundingBox>("bounding_box");
+  bounding_box->build(coordinates);
+  math::Hilbert compute_hilbert_idx(*bounding_box, 20);
+
+  std::vector<boost::uint64_t> keys(nb_nodes);
+  RealVector coords(coordinates.row_size());
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    for(Uint j = 0; j != coords.size(); ++j)
+      coords[j] = coordinates[i][j];
+    keys[i] = compute_hilbert_idx(coords);
+  }
+
+  detail::sort_by_key(keys, new_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Renumber::rcm_node_order(std::vector<Uint>& new_idx) const
+{
+  const Dictionary& geometry = m_mesh->geometry_fields();
+  const Uint nb_nodes = geometry.size();
+
+  // Node graph, coupling all nodes of each element
+  std::vector< std::vector<Uint> > graph(nb_nodes);
+  boost_foreach(const Handle<Space>& space, geometry.spaces())
+  {
+    boost_foreach(const Connectivity::ConstRow row, space->connectivity().array())
+    {
+      boost_foreach(const Uint i, row)
+      {
+        boost_foreach(const Uint j, row)
+        {
+          if(i != j)
+            graph[i].push_back(j);
+        }
+      }
+    }
+  }
+
+  // Periodic nodes are coupled to their target
+  Handle< List<Uint> const > periodic_links_nodes(geometry.get_child("periodic_links_nodes"));
+  Handle< List<bool> const > periodic_links_active(geometry.get_child("periodic_links_active"));
+  if(is_not_null(periodic_links_nodes) && is_not_null(periodic_links_active))
+  {
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      if((*periodic_links_active)[i])
+      {
+        const Uint target = (*periodic_links_nodes)[i];
+        graph[i].push_back(target);
+        graph[target].push_back(i);
+      }
+    }
+  }
+
+  boost_foreach(std::vector<Uint>& neighbours, graph)
+  {
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+  }
+
+  // Process the connected components one by one, starting each at the unvisited node with the lowest degree
+  std::vector< std::pair<Uint, Uint> > by_degree(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    by_degree[i] = std::make_pair(static_cast<Uint>(graph[i].size()), i);
+  std::sort(by_degree.begin(), by_degree.end());
+
+  std::vector<bool> visited(nb_nodes, false);
+  std::vector<Uint> order;
+  order.reserve(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint node = by_degree[i].second;
+    Uint last_level;
+    if(!visited[node])
+      detail::cuthill_mckee(graph, detail::pseudo_peripheral_node(graph, node), visited, order, last_level);
+  }
+  cf3_assert(order.size() == nb_nodes);
+
+  std::reverse(order.begin(), order.end());
+  detail::order_to_new_idx(order, new_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Renumber::hilbert_element_order(const Entities& entities, std::vector<Uint>& new_idx) const
+{
+  const Field& coordinates = m_mesh->geometry_fields().coordinates();
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  const Uint nb_elems = connectivity.size();
+  const Uint dim = coordinates.row_size();
+
+  boost::shared_ptr<BoundingBox> bounding_box = allocate_component<BoundingBox>("bounding_box");
+  bounding_box->build(coordinates);
+  math::Hilbert compute_hilbert_idx(*bounding_box, 20);
+
+  // The average of the nodes is inside the bounding box for any element type
+  std::vector<boost::uint64_t> keys(nb_elems);
+  RealVector centre(dim);
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    centre.setZero();
+    const Connectivity::ConstRow row = connectivity[elem];
+    boost_foreach(const Uint node, row)
+    {
+      for(Uint j = 0; j != dim; ++j)
+        centre[j] += coordinates[node][j];
+    }
+    centre /= static_cast<Real>(row.size());
+    keys[elem] = compute_hilbert_idx(centre);
+  }
+
+  detail::sort_by_key(keys, new_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Renumber::node_element_order(const Entities& entities, std::vector<Uint>& new_idx) const
+{
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  const Uint nb_elems = connectivity.size();
+
+  std::vector<Uint> keys(nb_elems);
+  for(Uint elem = 0; elem != nb_elems; ++elem)
+  {
+    const Connectivity::ConstRow row = connectivity[elem];
+    keys[elem] = *std::min_element(row.begin(), row.end());
+  }
+
+  detail::sort_by_key(keys, new_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void renumber_nodes(Dictionary& dict, const std::vector<Uint>& new_idx)
+{
+  const Uint nb_nodes = dict.size();
+  if(new_idx.size() != nb_nodes)
+    throw BadValue(FromHere(), "Renumbering of " + dict.uri().path() + " has " + to_str(static_cast<Uint>(new_idx.size())) + " entries for " + to_str(nb_nodes) + " nodes");
+
+  boost_foreach(Field& field, find_components<Field>(dict))
+    detail::permute_rows(field, new_idx);
+  detail::permute_rows(dict.glb_idx(), new_idx);
+  detail::permute_rows(dict.rank(), new_idx);
+
+  // Periodic links move with the nodes, and point to the new index of their target
+  Handle< List<Uint> > periodic_links_nodes(dict.get_child("periodic_links_nodes"));
+  Handle< List<bool> > periodic_links_active(dict.get_child("periodic_links_active"));
+  if(is_not_null(periodic_links_nodes) && is_not_null(periodic_links_active))
+  {
+    detail::permute_rows(*periodic_links_nodes, new_idx);
+    detail::permute_rows(*periodic_links_active, new_idx);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      if((*periodic_links_active)[i])
+        (*periodic_links_nodes)[i] = new_idx[(*periodic_links_nodes)[i]];
+    }
+  }
+  dict.invalidate_periodic_inverse_links();
+
+  // Global element connectivity of each node, if it was built
+  Handle< DynTable<Uint> > glb_elem_connectivity_h(dict.get_child("glb_elem_connectivity"));
+  if(is_not_null(glb_elem_connectivity_h) && glb_elem_connectivity_h->size() == nb_nodes)
+  {
+    DynTable<Uint>::ArrayT& glb_elem_connectivity = glb_elem_connectivity_h->array();
+    DynTable<Uint>::ArrayT old_glb_elem_connectivity(nb_nodes);
+    old_glb_elem_connectivity.swap(glb_elem_connectivity);
+    glb_elem_connectivity.resize(nb_nodes);
+    for(Uint i = 0; i != nb_nodes; ++i)
+      glb_elem_connectivity[new_idx[i]].swap(old_glb_elem_connectivity[i]);
+  }
+
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    boost_foreach(Connectivity::Row row, space->connectivity().array())
+    {
+      boost_foreach(Uint& node, row)
+        node = new_idx[node];
+    }
+  }
+
+  // The comm pattern refers to the old local indices
+  dict.invalidate_comm_pattern();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void renumber_elements(Entities& entities, const std::vector<Uint>& new_idx)
+{
+  if(new_idx.size() != entities.size())
+    throw BadValue(FromHere(), "Renumbering of " + entities.uri().path() + " has " + to_str(static_cast<Uint>(new_idx.size())) + " entries for " + to_str(entities.size()) + " elements");
+
+  boost_foreach(const Handle<Space>& space, entities.spaces())
+    detail::permute_rows(space->connectivity(), new_idx);
+  detail::permute_rows(entities.glb_idx(), new_idx);
+  detail::permute_rows(entities.rank(), new_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint node_bandwidth(const Mesh& mesh)
+{
+  Uint bandwidth = 0;
+  boost_foreach(const Handle<Space>& space, mesh.geometry_fields().spaces())
+  {
+    boost_foreach(const Connectivity::ConstRow row, space->connectivity().array())
+    {
+      const Uint min_node = *std::min_element(row.begin(), row.end());
+      const Uint max_node = *std::max_element(row.begin(), row.end());
+      bandwidth = std::max(bandwidth, max_node - min_node);
+    }
+  }
+  return bandwidth;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
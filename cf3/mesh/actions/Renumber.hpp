@@ -0,0 +1,84 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_actions_Renumber_hpp
+#define cf3_mesh_actions_Renumber_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/actions/LibActions.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class Dictionary;
+  class Entities;
+
+namespace actions {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Renumber the local nodes and elements of a mesh, to improve memory locality in element loops and
+/// to reduce the bandwidth of the assembled matrices.
+/// The geometry nodes are ordered along a Hilbert space-filling curve or using the reverse Cuthill-McKee
+/// algorithm on the node graph. Elements are ordered along the Hilbert curve or by their lowest node
+/// number, and the nodes of the other dictionaries follow the element order.
+/// All fields, connectivities, global indices, ranks and periodic links are updated. The global numbering
+/// is not changed. Face connectivities built by BuildFaces refer to element indices, so this action must
+/// run before BuildFaces if the elements are renumbered.
+class mesh_actions_API Renumber : public MeshTransformer
+{
+public: // functions
+
+  /// constructor
+  Renumber( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "Renumber"; }
+
+  virtual void execute();
+
+private: // functions
+
+  /// New index of each geometry node along the Hilbert curve
+  void hilbert_node_order(std::vector<Uint>& new_idx) const;
+
+  /// New index of each geometry node using reverse Cuthill-McKee
+  void rcm_node_order(std::vector<Uint>& new_idx) const;
+
+  /// New index of each element along the Hilbert curve
+  void hilbert_element_order(const Entities& entities, std::vector<Uint>& new_idx) const;
+
+  /// New index of each element, sorting by the lowest geometry node index
+  void node_element_order(const Entities& entities, std::vector<Uint>& new_idx) const;
+
+}; // end Renumber
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Move node i of the dictionary to new_idx[i], updating all fields, global indices, ranks, periodic links
+/// and the connectivity of all spaces in the dictionary. Mesh::raise_mesh_changed must be called afterwards.
+void mesh_actions_API renumber_nodes(Dictionary& dict, const std::vector<Uint>& new_idx);
+
+/// Move element i of the entities to new_idx[i], updating the connectivity of all its spaces, the global
+/// indices and the ranks. Mesh::raise_mesh_changed must be called afterwards.
+void mesh_actions_API renumber_elements(Entities& entities, const std::vector<Uint>& new_idx);
+
+/// Largest difference between the indices of two geometry nodes of the same element, over all elements of the mesh
+Uint mesh_actions_API node_bandwidth(const Mesh& mesh);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_actions_Renumber_hpp
@@ -4,7 +4,9 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
-#include <set>
+#include <limits>
+
+#include <boost/array.hpp>
 
 #include "common/Builder.hpp"
 
@@ -13,6 +15,8 @@
 #include "common/Option.hpp"
 #include "common/OptionList.hpp"
 #include "common/List.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/ThreadPool.hpp"
 
 #include "mesh/ConnectivityData.hpp"
 #include "mesh/DiscontinuousDictionary.hpp"
@@ -26,9 +30,6 @@
 #include "mesh/Connectivity.hpp"
 #include "mesh/ElementData.hpp"
 
-#include "mesh/LagrangeP1/Triag2D.hpp"
-#include "mesh/LagrangeP1/Quad2D.hpp"
-
 #include "WallDistance.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
@@ -46,165 +47,331 @@ common::ComponentBuilder < WallDistance, MeshTransformer, mesh::actions::LibActi
 namespace detail
 {
 
-/// Helper struct to handle projection to the wall near a given surface node
-struct WallProjection
+/// Surface element of the wall, stored by the coordinates of its corners so it can be sent to other ranks
+struct WallFace
+{
+  /// 2 for a line segment, 3 for a triangle and 4 for a quad
+  Uint nb_corners;
+  /// Corner coordinates, padded with zeros in 2D
+  Real corners[4][3];
+  /// True if the element exists on this rank, the indices below are only valid in that case
+  bool is_local;
+  /// Index of the entities in the wall node connectivity
+  Uint entities_idx;
+  /// Element index in the entities
+  Uint element_idx;
+  /// Local node index of the corners
+  Uint nodes[4];
+
+  /// Number of Reals used to pack a face for communication
+  static const Uint packed_size = 13;
+
+  void pack(std::vector<Real>& buffer) const
+  {
+    buffer.push_back(static_cast<Real>(nb_corners));
+    buffer.insert(buffer.end(), &corners[0][0], &corners[0][0] + 12);
+  }
+
+  void unpack(const Real* buffer)
+  {
+    nb_corners = static_cast<Uint>(buffer[0]);
+    std::copy(buffer+1, buffer+packed_size, &corners[0][0]);
+    is_local = false;
+    entities_idx = 0;
+    element_idx = 0;
+    std::fill(nodes, nodes+4, 0u);
+  }
+};
+
+/// Result of a closest point query
+struct WallPoint
+{
+  /// Squared distance to the wall
+  Real distance2;
+  /// Face that contains the closest point, or nb_faces if there is none
+  Uint face_idx;
+  /// True if the projection along the face normal falls inside the face (i.e. the closest point is not clamped to an edge or corner)
+  bool projects_inside;
+};
+
+inline Real squared_norm(const Real* a)
+{
+  return a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+}
+
+inline Real dot3(const Real* a, const Real* b)
+{
+  return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+/// Squared distance from p to segment ab, inside is true if the orthogonal projection lies on the segment
+inline Real segment_distance2(const Real* p, const Real* a, const Real* b, bool& inside)
+{
+  Real ab[3], ap[3];
+  for(int i = 0; i != 3; ++i)
+  {
+    ab[i] = b[i] - a[i];
+    ap[i] = p[i] - a[i];
+  }
+  const Real len2 = squared_norm(ab);
+  Real t = len2 > 0. ? dot3(ap, ab) / len2 : 0.;
+  inside = t >= 0. && t <= 1.;
+  t = std::max(0., std::min(1., t));
+  Real diff[3];
+  for(int i = 0; i != 3; ++i)
+    diff[i] = ap[i] - t*ab[i];
+  return squared_norm(diff);
+}
+
+/// Squared distance from p to triangle abc (Ericson, Real-Time Collision Detection, 5.1.5)
+/// inside is true if the orthogonal projection lies in the triangle
+inline Real triangle_distance2(const Real* p, const Real* a, const Real* b, const Real* c, bool& inside)
 {
-  WallProjection(const Field& coordinates, const NodeConnectivity& node_connectivity, const Field& normals, const Dictionary& wall_dict) :
-    m_coords(coordinates),
-    m_node_connectivity(node_connectivity),
-    m_normals(normals),
-    m_wall_dict(wall_dict)
+  inside = false;
+  Real ab[3], ac[3], ap[3], bp[3], cp[3], closest[3];
+  for(int i = 0; i != 3; ++i)
   {
+    ab[i] = b[i] - a[i];
+    ac[i] = c[i] - a[i];
+    ap[i] = p[i] - a[i];
+    bp[i] = p[i] - b[i];
+    cp[i] = p[i] - c[i];
   }
 
-  // Get the wall distance for an inner node, looking at the elements that are adjacent to the given surface node
-  Real operator()(const Uint inner_node_idx, const Uint surface_node_idx)
+  const Real d1 = dot3(ab, ap);
+  const Real d2 = dot3(ac, ap);
+  if(d1 <= 0. && d2 <= 0.)
+    return squared_norm(ap);
+
+  const Real d3 = dot3(ab, bp);
+  const Real d4 = dot3(ac, bp);
+  if(d3 >= 0. && d4 <= d3)
+    return squared_norm(bp);
+
+  const Real vc = d1*d4 - d3*d2;
+  if(vc <= 0. && d1 >= 0. && d3 <= 0.)
   {
-    m_has_nearest_element = false;
-    RealMatrix elem_coords;
-    const Uint dim = m_coords.row_size();
-    const RealVector inner_coord = to_vector(m_coords[inner_node_idx]);
-    std::vector<Uint> neighbor_nodes; // Collect neighboring nodes, so we can project onto a sharp corner in 3D if needed (i.e. near a step)
-    // Loop over all surface elements around the given node
-    BOOST_FOREACH(const NodeConnectivity::ElementReferenceT& element_ref, m_node_connectivity.node_element_range(surface_node_idx))
+    const Real v = d1 / (d1 - d3);
+    for(int i = 0; i != 3; ++i)
+      closest[i] = ap[i] - v*ab[i];
+    return squared_norm(closest);
+  }
+
+  const Real d5 = dot3(ab, cp);
+  const Real d6 = dot3(ac, cp);
+  if(d6 >= 0. && d5 <= d6)
+    return squared_norm(cp);
+
+  const Real vb = d5*d2 - d1*d6;
+  if(vb <= 0. && d2 >= 0. && d6 <= 0.)
+  {
+    const Real w = d2 / (d2 - d6);
+    for(int i = 0; i != 3; ++i)
+      closest[i] = ap[i] - w*ac[i];
+    return squared_norm(closest);
+  }
+
+  const Real va = d3*d6 - d5*d4;
+  if(va <= 0. && (d4 - d3) >= 0. && (d5 - d6) >= 0.)
+  {
+    const Real w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    for(int i = 0; i != 3; ++i)
+      closest[i] = bp[i] - w*(c[i] - b[i]);
+    return squared_norm(closest);
+  }
+
+  inside = true;
+  const Real denom = 1. / (va + vb + vc);
+  const Real v = vb * denom;
+  const Real w = vc * denom;
+  for(int i = 0; i != 3; ++i)
+    closest[i] = ap[i] - v*ab[i] - w*ac[i];
+  return squared_norm(closest);
+}
+
+/// Squared distance from p to a face. Quads are split in two triangles.
+inline Real face_distance2(const Real* p, const WallFace& face, bool& inside)
+{
+  if(face.nb_corners == 2)
+    return segment_distance2(p, face.corners[0], face.corners[1], inside);
+
+  const Real result = triangle_distance2(p, face.corners[0], face.corners[1], face.corners[2], inside);
+  if(face.nb_corners == 3)
+    return result;
+
+  bool inside2;
+  const Real result2 = triangle_distance2(p, face.corners[0], face.corners[2], face.corners[3], inside2);
+  inside = inside || inside2;
+  return std::min(result, result2);
+}
+
+/// Bounding volume hierarchy over the wall faces, answering exact closest point queries
+class WallTree
+{
+public:
+  WallTree(const std::vector<WallFace>& faces) : m_faces(faces)
+  {
+    const Uint nb_faces = m_faces.size();
+    m_order.resize(nb_faces);
+    m_centroids.resize(nb_faces);
+    for(Uint i = 0; i != nb_faces; ++i)
     {
-      // Get the element coordinates
-      const Entities& elem_entities = *m_node_connectivity.entities()[element_ref.first];
-      const ElementType& etype = elem_entities.element_type();
-      const Uint element_nb_nodes = etype.nb_nodes();
-      elem_coords.resize(element_nb_nodes, dim);
-      const Connectivity::ConstRow conn_row = elem_entities.geometry_space().connectivity()[element_ref.second];
-      fill(elem_coords, m_coords, conn_row);
-
-      // We consider lines, triangles and quads as viable surface elements
-      if(element_nb_nodes < 2 || element_nb_nodes > 4 || etype.order() != 1)
+      m_order[i] = i;
+      const WallFace& face = m_faces[i];
+      for(int d = 0; d != 3; ++d)
       {
-        throw common::SetupError(FromHere(), "Unsupported surface element of type " + etype.name() + " in surface region " + elem_entities.uri().path());
+        Real sum = 0.;
+        for(Uint c = 0; c != face.nb_corners; ++c)
+          sum += face.corners[c][d];
+        m_centroids[i][d] = sum / static_cast<Real>(face.nb_corners);
       }
+    }
+    if(nb_faces != 0)
+    {
+      m_nodes.reserve(2*nb_faces / leaf_size + 1);
+      build(0, nb_faces);
+    }
+  }
 
-      bool in_element = false;
+  /// Closest point on the wall to p. If local_only is true, only faces that exist on this rank are considered.
+  WallPoint closest(const Real* p, const bool local_only) const
+  {
+    WallPoint result;
+    result.distance2 = std::numeric_limits<Real>::max();
+    result.face_idx = m_faces.size();
+    result.projects_inside = false;
+    if(m_nodes.empty())
+      return result;
+
+    Uint stack[64];
+    Uint stack_size = 0;
+    stack[stack_size++] = 0;
+    while(stack_size != 0)
+    {
+      const TreeNode& node = m_nodes[stack[--stack_size]];
+      if(node.box_distance2(p) >= result.distance2)
+        continue;
 
-      if(element_nb_nodes == 2) // line segment
-      {
-        cf3_assert(dim == 2);
-        cf3_assert(etype.shape() == GeoShape::LINE);
-        RealVector e1 = elem_coords.row(1) - elem_coords.row(0); // line segment vector
-        Real e1_len = e1.norm();
-        e1 /= e1_len;
-        const Real projection = e1.dot(inner_coord - elem_coords.row(0).transpose());
-        // If the projection of the node along the normal fits inside the element, we can take the normal distance
-        in_element = projection >= 0 && projection <= e1_len;
-      }
-      if(element_nb_nodes == 3)
+      if(node.left == 0) // leaf
       {
-        cf3_assert(dim == 3);
-        cf3_assert(etype.shape() == GeoShape::TRIAG);
-        RealVector3 e1 = (elem_coords.row(1) - elem_coords.row(0)).normalized();
-        RealVector3 en = elem_coords.row(2) - elem_coords.row(0);
-        RealVector3 e2 = (e1.cross(en)).cross(e1).normalized();
-        RealVector3 p = inner_coord - elem_coords.row(0).transpose();
-
-        // Construct 2D coordinates for the boundary element
-        Eigen::Matrix<Real, 3, 2> triag_coords_2d;
-        triag_coords_2d.row(0).setZero();
-        triag_coords_2d(1,0) = e1.dot(elem_coords.row(1) - elem_coords.row(0));
-        triag_coords_2d(1,1) = 0.;
-        triag_coords_2d(2,0) = e1.dot(elem_coords.row(2) - elem_coords.row(0));
-        triag_coords_2d(2,1) = e2.dot(elem_coords.row(2) - elem_coords.row(0));
-
-        RealVector2 p_proj(2);
-        p_proj[0] = p.dot(e1);
-        p_proj[1] = p.dot(e2);
-
-        in_element = LagrangeP1::Triag2D::is_coord_in_element(p_proj, triag_coords_2d);
-        const Uint origin_corner = std::find(conn_row.begin(), conn_row.end(), surface_node_idx) - conn_row.begin();
-        if(origin_corner == 0)
-        {
-          neighbor_nodes.push_back(conn_row[1]);
-          neighbor_nodes.push_back(conn_row[2]);
-        }
-        else if(origin_corner == 1)
-        {
-          neighbor_nodes.push_back(conn_row[0]);
-          neighbor_nodes.push_back(conn_row[2]);
-        }
-        else
+        for(Uint i = node.begin; i != node.end; ++i)
         {
-          neighbor_nodes.push_back(conn_row[0]);
-          neighbor_nodes.push_back(conn_row[1]);
+          const Uint face_idx = m_order[i];
+          const WallFace& face = m_faces[face_idx];
+          if(local_only && !face.is_local)
+            continue;
+          bool inside;
+          const Real d2 = face_distance2(p, face, inside);
+          // Exact ties go to local faces, so identical copies of a face on other ranks are never preferred
+          if(d2 < result.distance2 || (d2 == result.distance2 && face.is_local && !m_faces[result.face_idx].is_local))
+          {
+            result.distance2 = d2;
+            result.face_idx = face_idx;
+            result.projects_inside = inside;
+          }
         }
+        continue;
       }
-      if(element_nb_nodes == 4)
+
+      // Visit the nearest child first
+      const Real left_d2 = m_nodes[node.left].box_distance2(p);
+      const Real right_d2 = m_nodes[node.right].box_distance2(p);
+      cf3_assert(stack_size + 2 <= 64);
+      if(left_d2 < right_d2)
       {
-        cf3_assert(dim == 3);
-        cf3_assert(etype.shape() == GeoShape::QUAD);
-        RealVector3 e1 = (elem_coords.row(1) - elem_coords.row(0)).normalized();
-        RealVector3 en = elem_coords.row(3) - elem_coords.row(0);
-        RealVector3 e2 = (e1.cross(en)).cross(e1).normalized();
-        RealVector3 p = inner_coord - elem_coords.row(0).transpose();
-
-        // Construct 2D coordinates for the boundary element
-        Eigen::Matrix<Real, 4, 2> quad_coords_2d;
-        quad_coords_2d.row(0).setZero();
-        for(int i = 1; i != 4; ++i)
-        {
-          quad_coords_2d(i, 0) = e1.dot(elem_coords.row(i) - elem_coords.row(0));
-          quad_coords_2d(i, 1) = e2.dot(elem_coords.row(i) - elem_coords.row(0));
-        }
+        stack[stack_size++] = node.right;
+        stack[stack_size++] = node.left;
+      }
+      else
+      {
+        stack[stack_size++] = node.left;
+        stack[stack_size++] = node.right;
+      }
+    }
+    return result;
+  }
 
-        RealVector2 p_proj(2);
-        p_proj[0] = p.dot(e1);
-        p_proj[1] = p.dot(e2);
+private:
+  static const Uint leaf_size = 8;
 
-        in_element = LagrangeP1::Quad2D::is_coord_in_element(p_proj, quad_coords_2d);
-        const Uint origin_corner = std::find(conn_row.begin(), conn_row.end(), surface_node_idx) - conn_row.begin();
-        if(origin_corner == 0 || origin_corner == 2)
-        {
-          neighbor_nodes.push_back(conn_row[1]);
-          neighbor_nodes.push_back(conn_row[3]);
-        }
-        else
-        {
-          neighbor_nodes.push_back(conn_row[0]);
-          neighbor_nodes.push_back(conn_row[2]);
-        }
+  struct TreeNode
+  {
+    Real box_min[3];
+    Real box_max[3];
+    Uint begin, end;
+    Uint left, right; // left is 0 for leaves, since the root can't be a child
+
+    Real box_distance2(const Real* p) const
+    {
+      Real result = 0.;
+      for(int d = 0; d != 3; ++d)
+      {
+        const Real delta = p[d] < box_min[d] ? box_min[d] - p[d] : (p[d] > box_max[d] ? p[d] - box_max[d] : 0.);
+        result += delta*delta;
       }
+      return result;
+    }
+  };
 
-      // If the projection was in an element, we can just proceed to compute the normal distance
-      if(in_element)
+  /// Build the subtree for faces m_order[begin, end), returning its index
+  Uint build(const Uint begin, const Uint end)
+  {
+    const Uint node_idx = m_nodes.size();
+    m_nodes.push_back(TreeNode());
+    TreeNode node;
+    node.begin = begin;
+    node.end = end;
+    node.left = 0;
+    node.right = 0;
+    Real centroid_min[3], centroid_max[3];
+    for(int d = 0; d != 3; ++d)
+    {
+      node.box_min[d] = centroid_min[d] = std::numeric_limits<Real>::max();
+      node.box_max[d] = centroid_max[d] = -std::numeric_limits<Real>::max();
+    }
+    for(Uint i = begin; i != end; ++i)
+    {
+      const WallFace& face = m_faces[m_order[i]];
+      for(int d = 0; d != 3; ++d)
       {
-        m_last_nearest_element = element_ref;
-        m_has_nearest_element = true;
-        const Uint normal_idx = elem_entities.space(m_wall_dict).connectivity()[element_ref.second][0];
-        const Eigen::Map<RealVector const> normal(&m_normals[normal_idx][0], dim);
-        return fabs(normal.dot(inner_coord - elem_coords.row(0).transpose()));
+        for(Uint c = 0; c != face.nb_corners; ++c)
+        {
+          node.box_min[d] = std::min(node.box_min[d], face.corners[c][d]);
+          node.box_max[d] = std::max(node.box_max[d], face.corners[c][d]);
+        }
+        centroid_min[d] = std::min(centroid_min[d], m_centroids[m_order[i]][d]);
+        centroid_max[d] = std::max(centroid_max[d], m_centroids[m_order[i]][d]);
       }
     }
-    // If we got here, no projections on the elements gave a result
-    // First, verify the 3D case where we need to project on "step" edges
-    BOOST_FOREACH(const Uint neighbor_node, neighbor_nodes)
+
+    if(end - begin > leaf_size)
     {
-      const RealVector surface_coord = to_vector(m_coords[surface_node_idx]);
-      const RealVector neighbor_coord = to_vector(m_coords[neighbor_node]);
-      RealVector e1 = neighbor_coord - surface_coord;
-      Real e1_len = e1.norm();
-      e1 /= e1_len;
-      const Real projection = e1.dot(inner_coord - surface_coord);
-      if(projection > 0 && projection < e1_len)
+      // Split at the median centroid along the longest axis
+      int axis = 0;
+      for(int d = 1; d != 3; ++d)
       {
-        return (inner_coord - (surface_coord + e1*projection)).norm();
+        if(centroid_max[d] - centroid_min[d] > centroid_max[axis] - centroid_min[axis])
+          axis = d;
       }
+      const Uint middle = begin + (end - begin) / 2;
+      std::nth_element(m_order.begin() + begin, m_order.begin() + middle, m_order.begin() + end, [this, axis](const Uint a, const Uint b)
+      {
+        return m_centroids[a][axis] < m_centroids[b][axis];
+      });
+      node.left = build(begin, middle);
+      node.right = build(middle, end);
     }
-    return (inner_coord - to_vector(m_coords[surface_node_idx])).norm();
+
+    m_nodes[node_idx] = node;
+    return node_idx;
   }
 
-  const Field& m_coords;
-  const NodeConnectivity& m_node_connectivity;
-  const Field& m_normals;
-  const Dictionary& m_wall_dict;
-  bool m_has_nearest_element = false;
-  NodeConnectivity::ElementReferenceT m_last_nearest_element;
+  const std::vector<WallFace>& m_faces;
+  std::vector<Uint> m_order;
+  std::vector< boost::array<Real, 3> > m_centroids;
+  std::vector<TreeNode> m_nodes;
 };
+
 }
 
 WallDistance::WallDistance(const std::string& name) : MeshTransformer(name)
@@ -242,9 +409,6 @@ void WallDistance::execute()
   Field& d = mesh.geometry_fields().create_field("wall_distance");
   d.add_tag("wall_distance");
 
-  // Field& nodal_normals = mesh.geometry_fields().create_field("nodal_normals", "nodal_normals[vector]");
-  // nodal_normals.add_tag("nodal_normals");
-
   // Wall normal field
   if(mesh.get_child("wall_P0") != nullptr)
   {
@@ -260,14 +424,25 @@ void WallDistance::execute()
   Field& face_normals = wall_P0.create_field(mesh::Tags::normal(),std::string(mesh::Tags::normal())+"[vector]");
   face_normals.add_tag(mesh::Tags::normal());
 
-  for(const auto& wall_entity : surface_entities)
+  // Collect the wall faces and their normals
+  std::vector<detail::WallFace> wall_faces;
+  std::vector<bool> is_surface_node(nb_nodes, false);
+  const Uint nb_surface_entities = surface_entities.size();
+  for(Uint entities_idx = 0; entities_idx != nb_surface_entities; ++entities_idx)
   {
-    const Uint nb_elems = wall_entity->size();
-    const auto& wall_space_conn = wall_entity->space(wall_P0).connectivity();
-    const auto& geom_conn = wall_entity->geometry_space().connectivity();
-    const ElementType& etype = wall_entity->element_type();
+    const Entities& wall_entity = *surface_entities[entities_idx];
+    const Uint nb_elems = wall_entity.size();
+    const auto& wall_space_conn = wall_entity.space(wall_P0).connectivity();
+    const auto& geom_conn = wall_entity.geometry_space().connectivity();
+    const ElementType& etype = wall_entity.element_type();
     const Uint element_nb_nodes = etype.nb_nodes();
 
+    // We consider lines, triangles and quads as viable surface elements
+    if(element_nb_nodes < 2 || element_nb_nodes > 4 || etype.order() != 1)
+    {
+      throw common::SetupError(FromHere(), "Unsupported surface element of type " + etype.name() + " in surface region " + wall_entity.uri().path());
+    }
+
     RealMatrix elem_coords(element_nb_nodes, dim);
     for(Uint elem_idx = 0; elem_idx != nb_elems; ++elem_idx)
     {
@@ -277,21 +452,59 @@ void WallDistance::execute()
       RealVector normal(dim);
       etype.compute_normal(elem_coords, normal);
       Eigen::Map<RealVector>(&face_normals[normal_fd_idx][0], dim) = normal / normal.norm();
-      // for(const Uint node_idx : conn_row)
-      // {
-      //   Eigen::Map<RealVector> node_normal(&nodal_normals[node_idx][0], dim);
-      //   node_normal += normal;
-      // }
+
+      detail::WallFace face;
+      face.nb_corners = element_nb_nodes;
+      face.is_local = true;
+      face.entities_idx = entities_idx;
+      face.element_idx = elem_idx;
+      std::fill(&face.corners[0][0], &face.corners[0][0] + 12, 0.);
+      std::fill(face.nodes, face.nodes + 4, 0u);
+      for(Uint i = 0; i != element_nb_nodes; ++i)
+      {
+        face.nodes[i] = conn_row[i];
+        is_surface_node[conn_row[i]] = true;
+        for(Uint j = 0; j != dim; ++j)
+          face.corners[i][j] = elem_coords(i, j);
+      }
+      wall_faces.push_back(face);
     }
   }
 
-  boost::shared_ptr< common::List< Uint > > surface_nodes_ptr = build_used_nodes_list(const_surface_entities, mesh.geometry_fields(), true);
-  const common::List<Uint>& surface_nodes = *surface_nodes_ptr;
-  const Uint nb_surface_nodes = surface_nodes.size();
+  // In parallel, every rank needs the complete wall, since the nearest wall face may be on another rank
+  const Uint nb_local_faces = wall_faces.size();
+  if(common::PE::Comm::instance().is_active() && common::PE::Comm::instance().size() > 1)
+  {
+    common::PE::Comm& comm = common::PE::Comm::instance();
+    std::vector<Real> send_buffer;
+    send_buffer.reserve(nb_local_faces * detail::WallFace::packed_size);
+    for(Uint i = 0; i != nb_local_faces; ++i)
+      wall_faces[i].pack(send_buffer);
+
+    std::vector< std::vector<Real> > recv_buffers;
+    comm.all_gather(send_buffer, recv_buffers);
+    const Uint nb_procs = comm.size();
+    for(Uint rank = 0; rank != nb_procs; ++rank)
+    {
+      if(rank == comm.rank())
+        continue;
+      const std::vector<Real>& recv_buffer = recv_buffers[rank];
+      cf3_assert(recv_buffer.size() % detail::WallFace::packed_size == 0);
+      const Uint nb_recv_faces = recv_buffer.size() / detail::WallFace::packed_size;
+      for(Uint i = 0; i != nb_recv_faces; ++i)
+      {
+        detail::WallFace face;
+        face.unpack(&recv_buffer[i*detail::WallFace::packed_size]);
+        wall_faces.push_back(face);
+      }
+    }
+  }
 
-  detail::WallProjection normal_distance(coords, *node_connectivity, face_normals, wall_P0);
+  const detail::WallTree wall_tree(wall_faces);
 
   // Link each node to a wall element. First column: 1 if a wall element exists. Second column: index to the entities in the node connectivity. Last column: element index
+  // If the node does not project inside a wall element, the first column is 0 and the second column is the nearest node of the nearest wall element
+  // Only local wall elements can be referred to, so when the nearest wall element is remote the nearest local one is used, even if it is far away
   auto& node_to_wall_element = *mesh.create_component<common::Table<Uint>>("node_to_wall_element");
   node_to_wall_element.set_row_size(3);
   node_to_wall_element.resize(nb_nodes);
@@ -300,50 +513,67 @@ void WallDistance::execute()
     std::fill(row.begin(), row.end(), 0);
   }
 
-  for(Uint inner_node_idx = 0; inner_node_idx != nb_nodes; ++inner_node_idx)
+  // Each thread handles a contiguous range of nodes, writing only to their rows
+  const auto compute_distances = [&](const Uint begin, const Uint end)
   {
-    bool is_surface_node = false;
-    Real shortest_distance = 1e20;
-    Uint closest_surface_node = 0;
-    for(Uint j = 0; j != nb_surface_nodes; ++j)
+    Real point[3] = {0., 0., 0.};
+    for(Uint node_idx = begin; node_idx != end; ++node_idx)
     {
-      const Uint surface_node_idx = surface_nodes[j];
-      if(surface_node_idx == inner_node_idx)
+      if(is_surface_node[node_idx])
       {
-        is_surface_node = true;
-        break;
+        d[node_idx][0] = 0.;
+        continue;
       }
-      const Real d2 = (to_vector(coords[inner_node_idx]) - to_vector(coords[surface_node_idx])).squaredNorm();
-      if(d2 < shortest_distance)
-      {
-        shortest_distance = d2;
-        closest_surface_node = surface_node_idx;
-      }
-    }
 
-    if(is_surface_node)
-    {
-      d[inner_node_idx][0] = 0.;
-      // Eigen::Map<RealVector> node_normal(&nodal_normals[inner_node_idx][0], dim);
-      // node_normal /= node_normal.norm();
-    }
-    else
-    {
-      d[inner_node_idx][0] = normal_distance(inner_node_idx, closest_surface_node);
-      if(normal_distance.m_has_nearest_element)
+      for(Uint j = 0; j != dim; ++j)
+        point[j] = coords[node_idx][j];
+
+      detail::WallPoint wall_point = wall_tree.closest(point, false);
+      d[node_idx][0] = wall_point.face_idx == wall_faces.size() ? 0. : std::sqrt(wall_point.distance2);
+
+      // The connectivity table can only refer to wall elements on this rank
+      if(wall_point.face_idx != wall_faces.size() && !wall_faces[wall_point.face_idx].is_local)
+        wall_point = wall_tree.closest(point, true);
+      if(wall_point.face_idx == wall_faces.size())
+        continue;
+
+      const detail::WallFace& face = wall_faces[wall_point.face_idx];
+      if(wall_point.projects_inside)
       {
-        node_to_wall_element[inner_node_idx][0] = 1;
-        node_to_wall_element[inner_node_idx][1] = normal_distance.m_last_nearest_element.first;
-        node_to_wall_element[inner_node_idx][2] = normal_distance.m_last_nearest_element.second;
+        node_to_wall_element[node_idx][0] = 1;
+        node_to_wall_element[node_idx][1] = face.entities_idx;
+        node_to_wall_element[node_idx][2] = face.element_idx;
       }
       else
       {
-        node_to_wall_element[inner_node_idx][0] = 0;
-        node_to_wall_element[inner_node_idx][1] = closest_surface_node;
+        Uint closest_corner = 0;
+        Real closest_d2 = std::numeric_limits<Real>::max();
+        for(Uint i = 0; i != face.nb_corners; ++i)
+        {
+          Real diff[3];
+          for(int j = 0; j != 3; ++j)
+            diff[j] = point[j] - face.corners[i][j];
+          const Real d2 = detail::squared_norm(diff);
+          if(d2 < closest_d2)
+          {
+            closest_d2 = d2;
+            closest_corner = i;
+          }
+        }
+        node_to_wall_element[node_idx][0] = 0;
+        node_to_wall_element[node_idx][1] = face.nodes[closest_corner];
       }
     }
-  }
+  };
 
+  // The threads of the shared pool are used, as set by the nb_threads option of the environment
+  const common::ThreadPool& pool = common::ThreadPool::shared();
+  const Uint nb_threads = std::max(1u, std::min(pool.nb_threads(), nb_nodes / 1024u));
+  const Uint chunk = nb_nodes / nb_threads;
+  pool.run(nb_threads, [&compute_distances, nb_nodes, nb_threads, chunk](const Uint i)
+  {
+    compute_distances(i*chunk, i == nb_threads-1 ? nb_nodes : (i+1)*chunk);
+  });
 }
 
 //////////////////////////////////////////////////////////////////////////////
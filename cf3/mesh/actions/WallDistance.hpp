@@ -22,6 +22,12 @@ namespace actions {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/// Compute the distance from each node to the nearest wall element, stored in the wall_distance field.
+/// The wall elements of all ranks are gathered in a bounding volume hierarchy, so the distance is exact
+/// also when the nearest wall lies on another rank.
+/// The node_to_wall_element table created on the mesh can only refer to wall elements of this rank. If the nearest
+/// wall element lies on another rank, the table refers to the nearest local wall element instead, which may be much
+/// farther away than the wall distance. If the rank has no wall elements at all, the rows are left at zero.
 class WallDistance : public MeshTransformer
 {
 public:
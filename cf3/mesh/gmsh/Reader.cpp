@@ -4,9 +4,14 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/regex.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
 
 #include "common/Log.hpp"
 #include "common/Builder.hpp"
@@ -20,6 +25,7 @@
 #include "common/List.hpp"
 #include "common/DynTable.hpp"
 
+#include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
 
 #include "mesh/Region.hpp"
@@ -28,8 +34,6 @@
 #include "mesh/DiscontinuousDictionary.hpp"
 #include "mesh/MeshElements.hpp"
 #include "mesh/ConnectivityData.hpp"
-#include "mesh/MergedParallelDistribution.hpp"
-#include "mesh/ParallelDistribution.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Cells.hpp"
@@ -63,7 +67,7 @@ Reader::Reader( const std::string& name )
       .pretty_name("Part");
 
   options().add("nb_parts", PE::Comm::instance().size() )
-      .description("Total number of parts. (e.g. number of processors)")
+      .description("Total number of parts. (e.g. number of processors). The nodes and elements of the file are split in this many ranges, and range \"part\" is read")
       .pretty_name("nb_parts");
 
   options().add("read_fields", true)
@@ -76,6 +80,7 @@ Reader::Reader( const std::string& name )
   properties()["brief"] = std::string("Gmsh file reader component");
 
   std::string desc;
+  desc += "This component reads MSH 2.2 and 4.1 files, in ASCII or binary form.\n";
   desc += "This component can read in parallel.\n";
   desc += "It can also read multiple files in serial, combining them in one large mesh.\n";
   desc += "Available coolfluid-element types are:\n";
@@ -97,6 +102,148 @@ std::vector<std::string> Reader::get_extensions()
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Cursor over a memory mapped file, parsing numbers without the overhead of iostream extraction
+struct Cursor
+{
+  Cursor(const char* begin, const char* end_ptr) : pos(begin), end(end_ptr) {}
+
+  void skip_whitespace()
+  {
+    while(pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n'))
+      ++pos;
+  }
+
+  /// Parse an integer, that may be negative
+  long read_int()
+  {
+    skip_whitespace();
+    bool negative = false;
+    if(pos != end && (*pos == '-' || *pos == '+'))
+    {
+      negative = *pos == '-';
+      ++pos;
+    }
+    if(pos == end || *pos < '0' || *pos > '9')
+      throw ParsingFailed(FromHere(), "Expected an integer in gmsh file");
+    long result = 0;
+    while(pos != end && *pos >= '0' && *pos <= '9')
+      result = 10*result + (*pos++ - '0');
+    return negative ? -result : result;
+  }
+
+  Uint read_uint()
+  {
+    const long result = read_int();
+    if(result < 0)
+      throw ParsingFailed(FromHere(), "Expected a positive integer in gmsh file");
+    return static_cast<Uint>(result);
+  }
+
+  Real read_real()
+  {
+    skip_whitespace();
+    char* number_end;
+    const Real result = std::strtod(pos, &number_end);
+    if(number_end == pos)
+      throw ParsingFailed(FromHere(), "Expected a real number in gmsh file");
+    pos = number_end;
+    return result;
+  }
+
+  /// Read a value stored in binary form, swapping the bytes if the file has a different endianness
+  template<typename T>
+  T read_binary(const bool swap_bytes)
+  {
+    if(end - pos < static_cast<std::ptrdiff_t>(sizeof(T)))
+      throw ParsingFailed(FromHere(), "Unexpected end of binary data in gmsh file");
+    char bytes[sizeof(T)];
+    std::copy(pos, pos+sizeof(T), bytes);
+    if(swap_bytes)
+      std::reverse(bytes, bytes+sizeof(T));
+    pos += sizeof(T);
+    T result;
+    std::memcpy(&result, bytes, sizeof(T));
+    return result;
+  }
+
+  /// Move to the start of the next line
+  void next_line()
+  {
+    const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    pos = newline == 0 ? end : newline+1;
+  }
+
+  /// Move to the start of the line nb_lines further
+  void skip_lines(const Uint nb_lines)
+  {
+    for(Uint i = 0; i != nb_lines; ++i)
+      next_line();
+  }
+
+  /// Rest of the current line, without the line ending, moving to the next line
+  std::string read_line()
+  {
+    const char* begin = pos;
+    next_line();
+    const char* line_end = pos;
+    while(line_end != begin && (line_end[-1] == '\n' || line_end[-1] == '\r'))
+      --line_end;
+    return std::string(begin, line_end);
+  }
+
+  const char* pos;
+  const char* end;
+};
+
+/// Read a size or a node or element number: an int in version 2 binary files, a size_t in version 4 binary files
+inline Uint read_number(Cursor& cursor, const Uint version, const bool binary, const bool swap_bytes)
+{
+  if(!binary)
+    return cursor.read_uint();
+  if(version == 2)
+    return cursor.read_binary<int>(swap_bytes);
+  return static_cast<Uint>(cursor.read_binary<boost::uint64_t>(swap_bytes));
+}
+
+/// Read an entity or physical tag, element type or other int
+inline long read_tag(Cursor& cursor, const bool binary, const bool swap_bytes)
+{
+  return binary ? cursor.read_binary<int>(swap_bytes) : cursor.read_int();
+}
+
+/// Read a coordinate or field value
+inline Real read_value(Cursor& cursor, const bool binary, const bool swap_bytes)
+{
+  return binary ? cursor.read_binary<double>(swap_bytes) : cursor.read_real();
+}
+
+/// Start of the line in [begin, end) that contains or follows position
+inline const char* line_start_after(const char* begin, const char* end, const char* position)
+{
+  if(position <= begin)
+    return begin;
+  if(position[-1] == '\n')
+    return position;
+  const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+  return newline == 0 ? end : newline+1;
+}
+
+/// Split the lines in [begin, end) in nb_parts contiguous ranges of about equal size, returning range part
+inline std::pair<const char*, const char*> line_range(const char* begin, const char* end, const Uint part, const Uint nb_parts)
+{
+  const std::ptrdiff_t size = end - begin;
+  const char* range_begin = line_start_after(begin, end, begin + (size * part) / nb_parts);
+  const char* range_end = line_start_after(begin, end, begin + (size * (part+1)) / nb_parts);
+  return std::make_pair(range_begin, range_end);
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 {
 
@@ -105,7 +252,8 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   if( boost::filesystem::exists(fp) )
   {
     CFinfo <<  "Opening file " <<  fp.string() << CFendl;
-    m_file.open(fp,std::ios_base::in); // exists so open it
+    m_mapped_file.open(fp.string());
+    m_file.open(fp,std::ios_base::in | std::ios_base::binary); // Only used to read the field headers
   }
   else // doesnt exist so throw exception
   {
@@ -121,13 +269,19 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   // NOTE: since gmsh contains several 'physical entities' in one mesh, we create one region per physical entity
   m_region = Handle<Region>(m_mesh->topology().handle<Component>());
 
+  const Uint part = options().value<Uint>("part");
+  const Uint nb_parts = options().value<Uint>("nb_parts");
+  if(part >= nb_parts)
+    throw BadValue(FromHere(), "Part " + to_str(part) + " is out of range for " + to_str(nb_parts) + " parts");
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1 && nb_parts != PE::Comm::instance().size())
+    throw BadValue(FromHere(), "When reading in parallel, nb_parts (" + to_str(nb_parts) + ") must equal the number of processes (" + to_str(PE::Comm::instance().size()) + ")");
+
   // Read file once and store positions
   get_file_positions();
-  cf3_assert(m_hash);
 
   m_mesh->initialize_nodes(0, m_mesh_dimension);
 
-  find_used_nodes();
+  read_elements();
   read_coordinates();
   read_connectivity();
 
@@ -139,17 +293,16 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
     read_node_data();
   }
 
-  m_node_idx_gmsh_to_cf.clear();
-  m_elem_idx_gmsh_to_cf.clear();
-
   // clean-up
-  m_ghost_nodes.clear();
-  m_used_nodes.clear();
   m_node_idx_gmsh_to_cf.clear();
-  if (is_not_null(m_hash))
-    remove_component(*m_hash);
+  m_elem_idx_gmsh_to_cf.clear();
+  m_local_elements.clear();
+  m_local_element_nodes.clear();
+  m_node_blocks.clear();
+  m_element_blocks.clear();
 
   // close the file
+  m_mapped_file.close();
   m_file.close();
 
   mesh.raise_mesh_loaded();
@@ -159,107 +312,264 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 
 void Reader::get_file_positions()
 {
-  std::string region_names("$PhysicalNames");
-  std::string nodes("$Nodes");
-  std::string elements("$Elements");
-  std::string element_data("$ElementData");
-  std::string node_data("$NodeData");
-  std::string element_node_data("$ElementNodeData");
+  const char* file_begin = m_mapped_file.data();
+  const char* file_end = file_begin + m_mapped_file.size();
 
   m_element_data_positions.clear();
   m_node_data_positions.clear();
   m_element_node_data_positions.clear();
-  m_elements_position=0;
-  std::streampos p;
-  std::string line;
-  while (!m_file.eof())
+  m_nodes_begin = m_nodes_end = 0;
+  m_elements_begin = m_elements_end = 0;
+  m_total_nb_nodes = 0;
+  m_total_nb_elements = 0;
+  m_nb_regions = 0;
+  m_region_list.clear();
+  m_node_blocks.clear();
+  m_element_blocks.clear();
+  m_version = 2;
+  m_binary = false;
+  m_swap_bytes = false;
+  m_mesh_dimension = options().value<Uint>("dimension");
+
+  detail::Cursor cursor(file_begin, file_end);
+  const auto read_number = [&]() { return detail::read_number(cursor, m_version, m_binary, m_swap_bytes); };
+  const auto read_tag = [&]() { return detail::read_tag(cursor, m_binary, m_swap_bytes); };
+
+  // Physical group of each version 4 entity, by dimension and tag
+  std::map< std::pair<Uint, long>, long > entity_phys_tags;
+
+  while(true)
   {
-    p = m_file.tellg();
-    getline(m_file,line);
-    if (line.find(region_names)!=std::string::npos) {
-      m_region_names_position=p;
-      m_file >> m_nb_regions;
-      m_region_list.resize(m_nb_regions);
+    cursor.skip_whitespace();
+    if(cursor.pos == file_end)
+      break;
 
-      m_nb_gmsh_elem_in_region.resize(m_nb_regions);
-      for(Uint ir = 0; ir < m_nb_regions; ++ir)
+    const std::size_t section_position = cursor.pos - file_begin;
+    const std::string section = cursor.read_line();
+    if(section.empty() || section[0] != '$')
+      throw ParsingFailed(FromHere(), "Expected a section header in gmsh file, got " + section);
+
+    if(section == "$MeshFormat")
+    {
+      const Real version = cursor.read_real();
+      const Uint file_type = cursor.read_uint();
+      const Uint data_size = cursor.read_uint();
+      if(version >= 2. && version < 3.)
+        m_version = 2;
+      else if(version >= 4.1 && version < 5.)
+        m_version = 4;
+      else
+        throw ParsingFailed(FromHere(), "Unsupported gmsh file format version " + to_str(version) + ", only versions 2 and 4.1 are supported");
+      if(file_type == 1)
       {
-        m_nb_gmsh_elem_in_region[ir].resize(Shared::nb_gmsh_types);
-        for(Uint type = 0; type < Shared::nb_gmsh_types; ++ type)
-           (m_nb_gmsh_elem_in_region[ir])[type] = 0;
+        if(data_size != sizeof(double))
+          throw ParsingFailed(FromHere(), "Binary gmsh files must use 8-byte reals and sizes");
+        m_binary = true;
+        cursor.next_line();
+        // The integer 1, written in binary to detect the endianness
+        const int one = cursor.read_binary<int>(false);
+        m_swap_bytes = one != 1;
       }
-
-      m_mesh_dimension = options().value<Uint>("dimension");
+      cursor.next_line();
+    }
+    else if(section == "$PhysicalNames")
+    {
+      m_nb_regions = cursor.read_uint();
+      m_region_list.resize(m_nb_regions);
       for(Uint ir = 0; ir < m_nb_regions; ++ir)
       {
-        Uint phys_group_dimensionality;
-        Uint phys_group_index;
-        std::string phys_group_name;
-        m_file >> phys_group_dimensionality >> phys_group_index >> phys_group_name;
-        m_region_list[phys_group_index-1].dim=phys_group_dimensionality;
-        m_region_list[phys_group_index-1].index=phys_group_index;
+        const Uint phys_group_dimensionality = cursor.read_uint();
+        const Uint phys_group_index = cursor.read_uint();
+        cursor.skip_whitespace();
+        std::string phys_group_name = boost::algorithm::trim_copy(cursor.read_line());
+        if(phys_group_index < 1 || phys_group_index > m_nb_regions)
+          throw ParsingFailed(FromHere(), "Physical group index " + to_str(phys_group_index) + " out of range");
+        RegionData& region_data = m_region_list[phys_group_index-1];
+        region_data.dim=phys_group_dimensionality;
+        region_data.index=phys_group_index;
         //The original name of the region in the mesh file has quotes, we want to strip them off
-        m_region_list[phys_group_index-1].name=phys_group_name.substr(1,phys_group_name.length()-2);
-        m_region_list[phys_group_index-1].region = create_region(m_region_list[phys_group_index-1].name);
-        m_mesh_dimension = std::max(m_region_list[phys_group_index-1].dim,m_mesh_dimension);
+        region_data.name=phys_group_name.substr(1,phys_group_name.length()-2);
+        region_data.region = create_region(region_data.name);
+        m_mesh_dimension = std::max(region_data.dim,m_mesh_dimension);
       }
     }
-    else if (line.find(nodes)!=std::string::npos) {
-      m_coordinates_position=p;
-      m_file >> m_total_nb_nodes;
-//      CFinfo << "The total number of nodes is " << m_total_nb_nodes << CFendl;
+    else if(section == "$Entities")
+    {
+      // Only the first physical group of an entity is used, as only the first tag of an element is used in version 2
+      Uint nb_entities[4];
+      for(Uint dim = 0; dim != 4; ++dim)
+        nb_entities[dim] = read_number();
+      for(Uint dim = 0; dim != 4; ++dim)
+      {
+        for(Uint i = 0; i != nb_entities[dim]; ++i)
+        {
+          const long entity_tag = read_tag();
+          // Point coordinates, or bounding box
+          for(Uint c = 0; c != (dim == 0 ? 3u : 6u); ++c)
+            detail::read_value(cursor, m_binary, m_swap_bytes);
+          const Uint nb_phys_tags = read_number();
+          long phys_tag = 0;
+          for(Uint t = 0; t != nb_phys_tags; ++t)
+          {
+            const long tag = read_tag();
+            if(t == 0)
+              phys_tag = tag;
+          }
+          if(dim != 0)
+          {
+            const Uint nb_bounding = read_number();
+            for(Uint b = 0; b != nb_bounding; ++b)
+              read_tag();
+          }
+          entity_phys_tags[std::make_pair(dim, entity_tag)] = phys_tag;
+        }
+      }
+    }
+    else if(section == "$Nodes" && m_version == 4)
+    {
+      // Blocks with a header line, the node numbers and then the node coordinates
+      const Uint nb_blocks = read_number();
+      m_total_nb_nodes = read_number();
+      read_number(); // smallest node number
+      read_number(); // largest node number
       if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+      m_nodes_begin = cursor.pos - file_begin;
+      for(Uint ib = 0; ib != nb_blocks; ++ib)
+      {
+        const Uint entity_dim = read_tag();
+        read_tag(); // entity tag
+        const bool parametric = read_tag() != 0;
+        EntityBlock block;
+        block.nb_entries = read_number();
+        block.type = parametric ? entity_dim : 0;
+        block.phys_tag = 0;
+        if(!m_binary)
+          cursor.next_line();
+        block.begin = cursor.pos - file_begin;
+        if(m_binary)
+          cursor.pos += static_cast<std::size_t>(block.nb_entries) * sizeof(boost::uint64_t);
+        else
+          cursor.skip_lines(block.nb_entries);
+        block.coords_begin = cursor.pos - file_begin;
+        if(m_binary)
+          cursor.pos += static_cast<std::size_t>(block.nb_entries) * (3 + block.type) * sizeof(double);
+        else
+          cursor.skip_lines(block.nb_entries);
+        if(cursor.pos > file_end)
+          throw ParsingFailed(FromHere(), "Unexpected end of the nodes section");
+        m_node_blocks.push_back(block);
+      }
+      m_nodes_end = cursor.pos - file_begin;
     }
-    else if (line.find(elements)!=std::string::npos)
+    else if(section == "$Elements" && m_version == 4)
     {
-      m_elements_position = p;
-      m_file >> m_total_nb_elements;
-//      CFinfo << "The total number of elements is " << m_total_nb_elements << CFendl;
+      // Blocks with a header line, followed by the number and nodes of each element
+      const Uint nb_blocks = read_number();
+      m_total_nb_elements = read_number();
+      read_number(); // smallest element number
+      read_number(); // largest element number
       if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
-      //Create a hash
-      m_hash = create_component<MergedParallelDistribution>("hash");
-      std::vector<Uint> num_obj(2);
-      num_obj[0] = m_total_nb_nodes;
-      num_obj[1] = m_total_nb_elements;
-      m_hash->options().set("nb_parts",options().value<Uint>("nb_parts"));
-      m_hash->options().set("nb_obj",num_obj);
-
-
-      Uint elem_idx, elem_type, nb_tags, phys_tag;
-
-      //Let's count how many elements of each type are present
-      for(Uint ie = 0; ie < m_total_nb_elements; ++ie)
+      m_elements_begin = cursor.pos - file_begin;
+      for(Uint ib = 0; ib != nb_blocks; ++ib)
       {
-          m_file >> elem_idx;
-          m_file >> elem_type;
-          m_file >> nb_tags;
-          m_file >> phys_tag;
-          cf3_assert(phys_tag > 0);
-          getline(m_file,line);
-          if (m_hash->subhash(ELEMS).owns(ie))
-            (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
-          m_region_list[phys_tag-1].element_types.insert(elem_type);
+        const Uint entity_dim = read_tag();
+        const long entity_tag = read_tag();
+        EntityBlock block;
+        block.type = read_tag();
+        block.nb_entries = read_number();
+        if(block.type >= Shared::nb_gmsh_types)
+          throw ParsingFailed(FromHere(), "Unknown gmsh element type " + to_str(block.type));
+        const std::map< std::pair<Uint, long>, long >::const_iterator entity = entity_phys_tags.find(std::make_pair(entity_dim, entity_tag));
+        if(entity == entity_phys_tags.end())
+          throw ParsingFailed(FromHere(), "Element block refers to entity " + to_str(entity_tag) + " of dimension " + to_str(entity_dim) + ", which is not in the $Entities section");
+        block.phys_tag = entity->second;
+        if(!m_binary)
+          cursor.next_line();
+        block.begin = cursor.pos - file_begin;
+        block.coords_begin = 0;
+        if(m_binary)
+          cursor.pos += static_cast<std::size_t>(block.nb_entries) * (1 + Shared::m_nodes_in_gmsh_elem[block.type]) * sizeof(boost::uint64_t);
+        else
+          cursor.skip_lines(block.nb_entries);
+        if(cursor.pos > file_end)
+          throw ParsingFailed(FromHere(), "Unexpected end of the elements section");
+        m_element_blocks.push_back(block);
       }
+      m_elements_end = cursor.pos - file_begin;
     }
-    else if (line.find(element_data)!=std::string::npos)
+    else if(section == "$Nodes")
     {
-      m_element_data_positions.push_back(p);
+      m_total_nb_nodes = cursor.read_uint();
+      if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+      cursor.next_line();
+      m_nodes_begin = cursor.pos - file_begin;
+      if(m_binary)
+      {
+        cursor.pos += static_cast<std::size_t>(m_total_nb_nodes) * (sizeof(int) + 3*sizeof(double));
+        if(cursor.pos > file_end)
+          throw ParsingFailed(FromHere(), "Unexpected end of the binary nodes section");
+        m_nodes_end = cursor.pos - file_begin;
+      }
+    }
+    else if(section == "$Elements")
+    {
+      m_total_nb_elements = cursor.read_uint();
+      if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
+      cursor.next_line();
+      m_elements_begin = cursor.pos - file_begin;
+      if(m_binary)
+      {
+        // Skip the blocks, each consisting of a header with the element type, number of elements and number of tags
+        Uint nb_read = 0;
+        while(nb_read != m_total_nb_elements)
+        {
+          const Uint elem_type = cursor.read_binary<int>(m_swap_bytes);
+          const Uint nb_elems = cursor.read_binary<int>(m_swap_bytes);
+          const Uint nb_tags = cursor.read_binary<int>(m_swap_bytes);
+          if(elem_type >= Shared::nb_gmsh_types || nb_read + nb_elems > m_total_nb_elements)
+            throw ParsingFailed(FromHere(), "Corrupt element block in binary gmsh file");
+          cursor.pos += static_cast<std::size_t>(nb_elems) * (1 + nb_tags + Shared::m_nodes_in_gmsh_elem[elem_type]) * sizeof(int);
+          if(cursor.pos > file_end)
+            throw ParsingFailed(FromHere(), "Unexpected end of the binary elements section");
+          nb_read += nb_elems;
+        }
+        m_elements_end = cursor.pos - file_begin;
+      }
     }
-    else if (line.find(node_data)!=std::string::npos)
+    else if(section == "$ElementData")
     {
-      m_node_data_positions.push_back(p);
+      m_element_data_positions.push_back(section_position);
     }
-    else if (line.find(element_node_data)!=std::string::npos)
+    else if(section == "$NodeData")
     {
-      m_element_node_data_positions.push_back(p);
+      m_node_data_positions.push_back(section_position);
+    }
+    else if(section == "$ElementNodeData")
+    {
+      m_element_node_data_positions.push_back(section_position);
     }
 
+    // Skip to the end of the section
+    const std::string end_marker = "$End" + section.substr(1);
+    const char* section_end = std::search(cursor.pos, file_end, end_marker.begin(), end_marker.end());
+    if(section_end == file_end)
+      throw ParsingFailed(FromHere(), "Section " + section + " has no matching " + end_marker);
+    if(section == "$Nodes" && !m_binary && m_version == 2)
+      m_nodes_end = section_end - file_begin;
+    if(section == "$Elements" && !m_binary && m_version == 2)
+      m_elements_end = section_end - file_begin;
+    cursor.pos = section_end;
+    cursor.next_line();
   }
-  if (m_elements_position==0)
+
+  if (m_elements_begin==0)
   {
     throw ParsingFailed(FromHere(),"File does not contain any elements");
   }
-  m_file.clear();
+  if (m_nodes_begin==0)
+  {
+    throw ParsingFailed(FromHere(),"File contains no nodes");
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,372 +593,425 @@ Handle< Region > Reader::create_region(std::string const& relative_path)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Reader::find_used_nodes()
+void Reader::read_elements()
 {
-  m_used_nodes.clear();
-  std::string line;
+  const char* file_begin = m_mapped_file.data();
+  const bool is_parallel = PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+  const Uint part = options().value<Uint>("part");
+  const Uint nb_parts = options().value<Uint>("nb_parts");
 
-  m_file.seekg(m_elements_position,std::ios::beg);
-  // skip next line
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  //Skip the line containing the actual number of elements
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_elems = " << line << std::endl;
+  m_local_elements.clear();
+  m_local_element_nodes.clear();
 
-  // read every line and store the connectivity in the correct region through the buffer
-  Uint elementNumber, elementType, nbElementNodes;
-  Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
+  m_nb_gmsh_elem_in_region.assign(m_nb_regions, std::vector<Uint>(Shared::nb_gmsh_types, 0));
 
-  std::set<Uint>::iterator it=m_used_nodes.begin();
-
-//  if (PE::Comm::instance().rank()==IO_rank)
-//  {
-//    std::cout << "nb_obj = "   << m_hash->subhash(ELEMS).options()["nb_obj"].value<Uint>() << std::endl;
-//    std::cout << "nb_parts = " <<m_hash->subhash(ELEMS).options()["nb_parts"].value<Uint>() << std::endl;
-//  }
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  const auto add_element = [&](const Uint element_number, const Uint elem_type, const long phys_tag, detail::Cursor& cursor)
+  {
+    if(phys_tag < 1 || phys_tag > static_cast<long>(m_nb_regions))
+      throw ParsingFailed(FromHere(), "Element " + to_str(element_number) + " has invalid physical tag " + to_str(phys_tag));
+    LocalElement element;
+    element.number = element_number;
+    element.type = elem_type;
+    element.region = phys_tag-1;
+    element.nodes_begin = m_local_element_nodes.size();
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[elem_type];
+    for(Uint j = 0; j != nb_element_nodes; ++j)
+      m_local_element_nodes.push_back(detail::read_number(cursor, m_version, m_binary, m_swap_bytes));
+    m_local_elements.push_back(element);
+    ++m_nb_gmsh_elem_in_region[element.region][elem_type];
+  };
+
+  if(m_version == 4)
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//    }
-
-    cf3_assert(m_hash);
-    if (m_hash->subhash(ELEMS).owns(i))
+    // Each part is a contiguous range of element indices, located through the blocks found in get_file_positions
+    const Uint own_begin = (static_cast<boost::uint64_t>(m_total_nb_elements) * part) / nb_parts;
+    const Uint own_end = (static_cast<boost::uint64_t>(m_total_nb_elements) * (part+1)) / nb_parts;
+    Uint block_begin = 0;
+    BOOST_FOREACH(const EntityBlock& block, m_element_blocks)
     {
-      // element description
-      m_file >> elementNumber >> elementType;
-      nbElementNodes = Shared::m_nodes_in_gmsh_elem[elementType];
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << i << ":  elem["<<m_hash->subhash(ELEMS).part_of_obj(i)<<"] " << elementNumber << " :    ";
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-      for (Uint j=0; j<nbElementNodes; ++j)
+      if(block_begin >= own_end)
+        break;
+      const Uint block_end = block_begin + block.nb_entries;
+      if(block_end > own_begin)
       {
-        m_file >> gmsh_node_number;
-        it = m_used_nodes.insert(it,gmsh_node_number);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number;
+        const Uint first = std::max(block_begin, own_begin);
+        const Uint last = std::min(block_end, own_end);
+        detail::Cursor cursor(file_begin + block.begin, file_begin + m_elements_end);
+        if(m_binary)
+          cursor.pos += (first - block_begin) * (1 + Shared::m_nodes_in_gmsh_elem[block.type]) * sizeof(boost::uint64_t);
+        else
+          cursor.skip_lines(first - block_begin);
+        for(Uint i = first; i != last; ++i)
+        {
+          const Uint element_number = detail::read_number(cursor, m_version, m_binary, m_swap_bytes);
+          add_element(element_number, block.type, block.phys_tag, cursor);
+          if(!m_binary)
+            cursor.next_line();
+        }
       }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "\n";
+      block_begin = block_end;
     }
-    getline(m_file,line); // finnish the line
   }
+  else if(m_binary)
+  {
+    // Each part is a contiguous range of element indices, located by skipping over the blocks
+    const Uint own_begin = (static_cast<boost::uint64_t>(m_total_nb_elements) * part) / nb_parts;
+    const Uint own_end = (static_cast<boost::uint64_t>(m_total_nb_elements) * (part+1)) / nb_parts;
+    detail::Cursor cursor(file_begin + m_elements_begin, file_begin + m_elements_end);
+    Uint block_begin = 0;
+    while(block_begin < own_end)
+    {
+      const Uint elem_type = cursor.read_binary<int>(m_swap_bytes);
+      const Uint nb_elems = cursor.read_binary<int>(m_swap_bytes);
+      const Uint nb_tags = cursor.read_binary<int>(m_swap_bytes);
+      const std::size_t record_size = (1 + nb_tags + Shared::m_nodes_in_gmsh_elem[elem_type]) * sizeof(int);
+      const Uint block_end = block_begin + nb_elems;
+      if(block_end <= own_begin)
+      {
+        cursor.pos += nb_elems * record_size;
+        block_begin = block_end;
+        continue;
+      }
 
-  // Now we have all nodes, used by the elements
-
-  // Now add owned nodes
-  m_file.seekg(m_coordinates_position,std::ios::beg);
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_nodes = " << line << std::endl;
-
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+      const Uint first = std::max(block_begin, own_begin);
+      const Uint last = std::min(block_end, own_end);
+      cursor.pos += (first - block_begin) * record_size;
+      for(Uint i = first; i != last; ++i)
+      {
+        const Uint element_number = cursor.read_binary<int>(m_swap_bytes);
+        const long phys_tag = nb_tags == 0 ? 0 : cursor.read_binary<int>(m_swap_bytes);
+        for(Uint itag = 1; itag < nb_tags; ++itag)
+          cursor.read_binary<int>(m_swap_bytes);
+        add_element(element_number, elem_type, phys_tag, cursor);
+      }
+      cursor.pos += (block_end - last) * record_size;
+      block_begin = block_end;
+    }
+  }
+  else
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if (node_idx == m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-
-    std::stringstream ss(line);
-    ss >> gmsh_node_number;
-    getline(ss,line);
-    if (m_hash->subhash(NODES).owns(node_idx))
+    // Each part consists of the lines in its own byte range
+    const std::pair<const char*, const char*> range = detail::line_range(file_begin + m_elements_begin, file_begin + m_elements_end, part, nb_parts);
+    detail::Cursor cursor(range.first, range.second);
+    cursor.skip_whitespace();
+    while(cursor.pos != cursor.end)
     {
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "node " << gmsh_node_number << "\n";
+      const Uint element_number = cursor.read_uint();
+      const Uint elem_type = cursor.read_uint();
+      if(elem_type >= Shared::nb_gmsh_types)
+        throw ParsingFailed(FromHere(), "Unknown gmsh element type " + to_str(elem_type));
+      const Uint nb_tags = cursor.read_uint();
+      const long phys_tag = nb_tags == 0 ? 0 : cursor.read_int();
+      for(Uint itag = 1; itag < nb_tags; ++itag)
+        cursor.read_int();
+      add_element(element_number, elem_type, phys_tag, cursor);
+      cursor.next_line();
+      cursor.skip_whitespace();
+    }
+  }
 
-      it = m_used_nodes.insert(it,gmsh_node_number);
+  // All ranks must create the same element types in each region, even if they have no elements of that type
+  std::vector<Uint> local_types(m_nb_regions*Shared::nb_gmsh_types, 0);
+  for(Uint ir = 0; ir != m_nb_regions; ++ir)
+    for(Uint etype = 0; etype != Shared::nb_gmsh_types; ++etype)
+      local_types[ir*Shared::nb_gmsh_types + etype] = m_nb_gmsh_elem_in_region[ir][etype] != 0;
+  std::vector<Uint> global_types(local_types);
+  if(is_parallel && !local_types.empty())
+    PE::Comm::instance().all_reduce(PE::max(), local_types, global_types);
+  for(Uint ir = 0; ir != m_nb_regions; ++ir)
+  {
+    m_region_list[ir].element_types.clear();
+    for(Uint etype = 0; etype != Shared::nb_gmsh_types; ++etype)
+    {
+      if(global_types[ir*Shared::nb_gmsh_types + etype] != 0)
+        m_region_list[ir].element_types.insert(etype);
     }
-    else
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_node_range(const Uint part, const Uint nb_parts, std::vector<Uint>& numbers, std::vector<Real>& coords) const
+{
+  const char* file_begin = m_mapped_file.data();
+  numbers.clear();
+  coords.clear(); // always 3 coordinates per node, as in the file
+  if(m_version == 4)
+  {
+    // The node numbers and coordinates are stored separately in each block
+    const Uint own_begin = (static_cast<boost::uint64_t>(m_total_nb_nodes) * part) / nb_parts;
+    const Uint own_end = (static_cast<boost::uint64_t>(m_total_nb_nodes) * (part+1)) / nb_parts;
+    Uint block_begin = 0;
+    BOOST_FOREACH(const EntityBlock& block, m_node_blocks)
     {
-      it = m_used_nodes.find(gmsh_node_number);
-      if (it != m_used_nodes.end())
+      if(block_begin >= own_end)
+        break;
+      const Uint block_end = block_begin + block.nb_entries;
+      if(block_end > own_begin)
       {
-        m_ghost_nodes.insert(node_idx);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "ghostnode " << gmsh_node_number << "\n";
+        const Uint first = std::max(block_begin, own_begin);
+        const Uint last = std::min(block_end, own_end);
+        detail::Cursor number_cursor(file_begin + block.begin, file_begin + m_nodes_end);
+        detail::Cursor coords_cursor(file_begin + block.coords_begin, file_begin + m_nodes_end);
+        if(m_binary)
+        {
+          number_cursor.pos += (first - block_begin) * sizeof(boost::uint64_t);
+          coords_cursor.pos += (first - block_begin) * (3 + block.type) * sizeof(double);
+        }
+        else
+        {
+          number_cursor.skip_lines(first - block_begin);
+          coords_cursor.skip_lines(first - block_begin);
+        }
+        for(Uint i = first; i != last; ++i)
+        {
+          numbers.push_back(detail::read_number(number_cursor, m_version, m_binary, m_swap_bytes));
+          for(Uint d = 0; d != 3; ++d)
+            coords.push_back(detail::read_value(coords_cursor, m_binary, m_swap_bytes));
+          // Skip the parametric coordinates
+          if(m_binary)
+          {
+            coords_cursor.pos += block.type * sizeof(double);
+          }
+          else
+          {
+            number_cursor.next_line();
+            coords_cursor.next_line();
+          }
+        }
       }
+      block_begin = block_end;
+    }
+  }
+  else if(m_binary)
+  {
+    const std::size_t record_size = sizeof(int) + 3*sizeof(double);
+    const Uint own_begin = (static_cast<boost::uint64_t>(m_total_nb_nodes) * part) / nb_parts;
+    const Uint own_end = (static_cast<boost::uint64_t>(m_total_nb_nodes) * (part+1)) / nb_parts;
+    detail::Cursor cursor(file_begin + m_nodes_begin + own_begin*record_size, file_begin + m_nodes_begin + own_end*record_size);
+    numbers.reserve(own_end - own_begin);
+    coords.reserve(3*(own_end - own_begin));
+    for(Uint i = own_begin; i != own_end; ++i)
+    {
+      numbers.push_back(cursor.read_binary<int>(m_swap_bytes));
+      for(Uint d = 0; d != 3; ++d)
+        coords.push_back(cursor.read_binary<double>(m_swap_bytes));
+    }
+  }
+  else
+  {
+    const std::pair<const char*, const char*> range = detail::line_range(file_begin + m_nodes_begin, file_begin + m_nodes_end, part, nb_parts);
+    detail::Cursor cursor(range.first, range.second);
+    cursor.skip_whitespace();
+    while(cursor.pos != cursor.end)
+    {
+      numbers.push_back(cursor.read_uint());
+      for(Uint d = 0; d != 3; ++d)
+        coords.push_back(cursor.read_real());
+      cursor.next_line();
+      cursor.skip_whitespace();
     }
   }
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << std::flush;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void Reader::read_coordinates()
 {
+  const bool is_parallel = PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+  const Uint nb_ranks = is_parallel ? PE::Comm::instance().size() : 1;
+  const Uint part = options().value<Uint>("part");
+  const Uint nb_parts = options().value<Uint>("nb_parts");
+
+  // Nodes in the own range of the file
+  std::vector<Uint> own_numbers;
+  std::vector<Real> own_coords;
+  read_node_range(part, nb_parts, own_numbers, own_coords);
+
+  // Nodes used by the own elements but read by another rank
+  std::vector<Uint> ghost_numbers(m_local_element_nodes);
+  std::sort(ghost_numbers.begin(), ghost_numbers.end());
+  ghost_numbers.erase(std::unique(ghost_numbers.begin(), ghost_numbers.end()), ghost_numbers.end());
+  {
+    std::vector<Uint> sorted_own(own_numbers);
+    std::sort(sorted_own.begin(), sorted_own.end());
+    std::vector<Uint> difference;
+    std::set_difference(ghost_numbers.begin(), ghost_numbers.end(), sorted_own.begin(), sorted_own.end(), std::back_inserter(difference));
+    ghost_numbers.swap(difference);
+  }
 
-  m_file.seekg(m_coordinates_position,std::ios::beg);
-
-  Dictionary& nodes = m_mesh->geometry_fields();
-  nodes.resize(m_used_nodes.size());
-  m_used_nodes.clear();
-
-  Uint part = options().value<Uint>("part");
-
-  std::string line;
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
-
-
-  // declare and allocate one coordinate row
-//  std::vector<Real> rowVector(m_mesh_dimension);
-
-  std::set<Uint>::const_iterator it;
-
-  Uint coord_idx=0;
-  Uint gmsh_node_number;
-
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+  std::vector<Real> ghost_coords(3*ghost_numbers.size());
+  std::vector<Uint> ghost_parts(ghost_numbers.size());
+  if(is_parallel)
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if(node_idx==m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-//    CFinfo << line << CFendl;
-    if (m_hash->subhash(NODES).owns(node_idx))
+    // Rendezvous through the rank number % nb_ranks: it learns about the nodes it is responsible for, and answers the requests for them
+    PE::Comm& comm = PE::Comm::instance();
+    std::vector<Uint> parts;
+    comm.all_gather(part, parts);
+
+    std::vector< std::vector<Uint> > send_numbers(nb_ranks), recv_numbers;
+    std::vector< std::vector<Real> > send_coords(nb_ranks), recv_coords;
+    const Uint nb_own = own_numbers.size();
+    for(Uint i = 0; i != nb_own; ++i)
     {
-      std::stringstream ss(line);
-      ss >> gmsh_node_number;
-      m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-      for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-      if(m_mesh_dimension < DIM_3D) getline(ss,line); //Gmsh always stores 3 coordinates, even for 2D meshes
-
-      nodes.rank()[coord_idx] = part;
-      nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-      coord_idx++;
+      const Uint directory = own_numbers[i] % nb_ranks;
+      send_numbers[directory].push_back(own_numbers[i]);
+      send_coords[directory].insert(send_coords[directory].end(), own_coords.begin() + 3*i, own_coords.begin() + 3*(i+1));
     }
-    else
+    comm.all_to_all(send_numbers, recv_numbers);
+    comm.all_to_all(send_coords, recv_coords);
+
+    // (number, source rank, index in the received data of that rank)
+    std::vector< boost::tuple<Uint, Uint, Uint> > directory;
+    for(Uint source = 0; source != nb_ranks; ++source)
+      for(Uint i = 0; i != recv_numbers[source].size(); ++i)
+        directory.push_back(boost::make_tuple(recv_numbers[source][i], source, i));
+    std::sort(directory.begin(), directory.end());
+
+    std::vector< std::vector<Uint> > request_numbers(nb_ranks), received_requests;
+    const Uint nb_ghosts = ghost_numbers.size();
+    for(Uint i = 0; i != nb_ghosts; ++i)
+      request_numbers[ghost_numbers[i] % nb_ranks].push_back(ghost_numbers[i]);
+    comm.all_to_all(request_numbers, received_requests);
+
+    std::vector< std::vector<Uint> > reply_parts(nb_ranks), recv_parts;
+    std::vector< std::vector<Real> > reply_coords(nb_ranks), recv_reply_coords;
+    for(Uint requester = 0; requester != nb_ranks; ++requester)
     {
-      it = m_ghost_nodes.find(node_idx);
-      if (it != m_ghost_nodes.end())
+      BOOST_FOREACH(const Uint number, received_requests[requester])
       {
-        std::stringstream ss(line);
-        ss >> gmsh_node_number;
-        m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-        for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-        if(m_mesh_dimension < DIM_3D) getline(ss, line);
-
-        nodes.rank()[coord_idx] = m_hash->subhash(NODES).part_of_obj(node_idx);
-        nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-        coord_idx++;
+        const std::vector< boost::tuple<Uint, Uint, Uint> >::const_iterator found = std::lower_bound(directory.begin(), directory.end(), boost::make_tuple(number, 0u, 0u));
+        if(found == directory.end() || found->get<0>() != number)
+          throw ParsingFailed(FromHere(), "Node " + to_str(number) + " is used by an element but is not in the gmsh file");
+        const Uint source = found->get<1>();
+        const Uint idx = found->get<2>();
+        reply_parts[requester].push_back(parts[source]);
+        reply_coords[requester].insert(reply_coords[requester].end(), recv_coords[source].begin() + 3*idx, recv_coords[source].begin() + 3*(idx+1));
       }
     }
+    comm.all_to_all(reply_parts, recv_parts);
+    comm.all_to_all(reply_coords, recv_reply_coords);
 
-
-  } //loop over nodes
-
-
-
-  /*
-  CFinfo << "Printing all nodal coordinates:" << CFendl;
-  for(Uint i = 0; i < m_total_nb_nodes; ++i)
+    // Replies come back in the order of the requests
+    std::vector<Uint> reply_position(nb_ranks, 0);
+    for(Uint i = 0; i != nb_ghosts; ++i)
+    {
+      const Uint directory_rank = ghost_numbers[i] % nb_ranks;
+      const Uint pos = reply_position[directory_rank]++;
+      ghost_parts[i] = recv_parts[directory_rank][pos];
+      std::copy(recv_reply_coords[directory_rank].begin() + 3*pos, recv_reply_coords[directory_rank].begin() + 3*(pos+1), ghost_coords.begin() + 3*i);
+    }
+  }
+  else if(!ghost_numbers.empty())
   {
-      CFinfo << "\t";
-      for(Uint dim = 0; dim < m_mesh_dimension; ++dim)
-        {
-            CFinfo << nodes.coordinates()[i][dim] << " ";
-        }
-      CFinfo << CFendl;
+    // A single part is read without communication, so the ghost nodes are looked up in the ranges of the other parts
+    std::vector<bool> found(ghost_numbers.size(), false);
+    std::vector<Uint> other_numbers;
+    std::vector<Real> other_coords;
+    for(Uint other = 0; other != nb_parts; ++other)
+    {
+      if(other == part)
+        continue;
+      read_node_range(other, nb_parts, other_numbers, other_coords);
+      for(Uint i = 0; i != other_numbers.size(); ++i)
+      {
+        const std::vector<Uint>::const_iterator ghost = std::lower_bound(ghost_numbers.begin(), ghost_numbers.end(), other_numbers[i]);
+        if(ghost == ghost_numbers.end() || *ghost != other_numbers[i])
+          continue;
+        const Uint idx = ghost - ghost_numbers.begin();
+        ghost_parts[idx] = other;
+        std::copy(other_coords.begin() + 3*i, other_coords.begin() + 3*(i+1), ghost_coords.begin() + 3*idx);
+        found[idx] = true;
+      }
+    }
+    const std::vector<bool>::const_iterator missing = std::find(found.begin(), found.end(), false);
+    if(missing != found.end())
+      throw ParsingFailed(FromHere(), "Node " + to_str(ghost_numbers[missing - found.begin()]) + " is used by an element but is not in the gmsh file");
   }
-  */
 
-  getline(m_file,line);
+  // Own nodes come first, in file order, followed by the ghost nodes
+  Dictionary& nodes = m_mesh->geometry_fields();
+  const Uint nb_own = own_numbers.size();
+  const Uint nb_ghosts = ghost_numbers.size();
+  nodes.resize(nb_own + nb_ghosts);
+  m_node_idx_gmsh_to_cf.clear();
+  for(Uint i = 0; i != nb_own + nb_ghosts; ++i)
+  {
+    const bool is_own = i < nb_own;
+    const Uint gmsh_node_number = is_own ? own_numbers[i] : ghost_numbers[i-nb_own];
+    const Real* coords = is_own ? &own_coords[3*i] : &ghost_coords[3*(i-nb_own)];
+    m_node_idx_gmsh_to_cf[gmsh_node_number] = i;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[i][dim] = coords[dim]; //Gmsh always stores 3 coordinates, even for 2D meshes
+    nodes.rank()[i] = is_own ? part : ghost_parts[i-nb_own];
+    nodes.glb_idx()[i] = gmsh_node_number-1;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void Reader::read_connectivity()
 {
-
   Dictionary& nodes = m_mesh->geometry_fields();
 
-
   Uint part = options().value<Uint>("part");
 
   //Each entry of this vector holds a map (gmsh_type_idx, pointer to connectivity table of this gmsh type).
- //Each row corresponds to one region of the mesh
- std::vector<std::map<Uint, Entities* > > conn_table_idx;
- conn_table_idx.resize(m_nb_regions);
- for(Uint ir = 0; ir < m_nb_regions; ++ir)
- {
-    conn_table_idx[ir].clear();
- }
-
- std::map<Uint, Entities*>::iterator elem_table_iter;
-
-// std::vector<std::map<std::string,Handle< Elements > > > elements(m_nb_regions);
-// std::vector<std::map<std::string,Handle< Connectivity::Buffer > > > buffer(m_nb_regions);
-
-
- m_elem_idx_gmsh_to_cf.clear();
- //Loop over all regions and allocate a connectivity table of proper size for each element type that
- //is present in each region. Counting of elements was done during the first pass in the function
- //get_file_positions
- for(Uint ir = 0; ir < m_nb_regions; ++ir)
- {
-   // create new region
-   Handle< Region > region = m_region_list[ir].region;
-
-//   elements[ir] = create_cells_in_region(*region,m_mesh->geometry_fields(),m_supported_types);
-//   buffer[ir] = create_connectivity_buffermap(elements[ir]);
-
-
-   // Take the gmsh element types present in this region and generate new names of elements which correspond
-   // to coolfuid naming:
-   for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
-   {
-     if(m_region_list[ir].element_types.find(etype) !=  m_region_list[ir].element_types.end())
-     {
-       const std::string cf_elem_name = Shared::gmsh_name_to_cf_name(m_mesh_dimension,etype);
-
-       boost::shared_ptr< ElementType > allocated_type = build_component_abstract_type<ElementType>(cf_elem_name,"tmp");
-       boost::shared_ptr< Entities > elements;
-       if (allocated_type->dimensionality() == allocated_type->dimension()-1)
-         elements = build_component_abstract_type<Entities>("cf3.mesh.Faces","elements_"+allocated_type->derived_type_name());
-       else if(allocated_type->dimensionality() == allocated_type->dimension())
-         elements = build_component_abstract_type<Entities>("cf3.mesh.Cells","elements_"+allocated_type->derived_type_name());
-       else
-         elements = build_component_abstract_type<Entities>("cf3.mesh.Elements","elements_"+allocated_type->derived_type_name());
-      region->add_component(elements);
-      elements->initialize(cf_elem_name,nodes);
+  //Each row corresponds to one region of the mesh
+  std::vector<std::map<Uint, Handle<Elements> > > conn_table_idx(m_nb_regions);
 
-       Connectivity& elem_table = Handle<Elements>(elements)->geometry_space().connectivity();
-       elem_table.set_row_size(Shared::m_nodes_in_gmsh_elem[etype]);
-       elem_table.resize((m_nb_gmsh_elem_in_region[ir])[etype]);
-       elements->rank().resize(m_nb_gmsh_elem_in_region[ir][etype]);
-       elements->glb_idx().resize(m_nb_gmsh_elem_in_region[ir][etype]);
-       conn_table_idx[ir].insert(std::pair<Uint,Entities*>(etype,elements.get()));
-     }
-   }
- }
-
-   std::string etype_CF;
-   std::set<Uint>::const_iterator it;
-   std::vector<Uint> cf_element;
-   Uint element_number, gmsh_element_type, nb_element_nodes;
-   Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
-   Uint cf_node_number;
-   Uint cf_idx;
-
-   m_file.seekg(m_elements_position,std::ios::beg);
-   // skip next line
-   std::string line;
-   //Re-read the line that contains the keyword '$Elements':
-   getline(m_file,line);
-   //Parse the following line (containing the actual number of elements)
-   getline(m_file,line);
-
-   for(Uint ir = 0; ir < m_nb_regions; ++ir)
-     for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
-      (m_nb_gmsh_elem_in_region[ir])[etype] = 0;
-
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  m_elem_idx_gmsh_to_cf.clear();
+  //Loop over all regions and allocate a connectivity table of proper size for each element type that
+  //is present in each region. Counting of elements was done in read_elements
+  for(Uint ir = 0; ir < m_nb_regions; ++ir)
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//      if(i==m_total_nb_elements-1)
-//        CFinfo << CFendl;
-//    }
-
-    // element description
-    m_file >> element_number >> gmsh_element_type;
+    Handle< Region > region = m_region_list[ir].region;
 
-    nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
-
-    // get element nodes
-    if (m_hash->subhash(ELEMS).owns(i))
+    // Take the gmsh element types present in this region and generate new names of elements which correspond
+    // to coolfuid naming:
+    BOOST_FOREACH(const Uint etype, m_region_list[ir].element_types)
     {
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-//      CFinfo << "Reading element " << element_number << " of type " << gmsh_element_type;
-//      CFinfo << " in region " << phys_tag << " with " << nb_element_nodes << " nodes " << CFendl;
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << element_number << "   -->   ";
-
-      cf_element.resize(nb_element_nodes);
-      for (Uint j=0; j<nb_element_nodes; ++j)
-      {
-        cf_idx = Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j];
-        m_file >> gmsh_node_number;
-        cf_node_number = m_node_idx_gmsh_to_cf[gmsh_node_number];
-        cf_element[cf_idx] = cf_node_number;
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number << "("<<m_node_idx_gmsh_to_cf[gmsh_node_number]<<")";
-      }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << std::endl;
-
-      elem_table_iter = conn_table_idx[phys_tag-1].find(gmsh_element_type);
-      const Uint row_idx = (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type];
-
-      Handle< Elements > elements_region = Handle<Elements>(elem_table_iter->second->handle<Component>());
-      Connectivity::Row element_nodes = elements_region->geometry_space().connectivity()[row_idx];
-
-      m_elem_idx_gmsh_to_cf[element_number] = std::make_pair( elements_region , row_idx);
-
-      for(Uint node = 0; node < nb_element_nodes; ++node)
-      {
-         element_nodes[node] = cf_element[node];
-      }
+      const std::string cf_elem_name = Shared::gmsh_name_to_cf_name(m_mesh_dimension,etype);
+
+      boost::shared_ptr< ElementType > allocated_type = build_component_abstract_type<ElementType>(cf_elem_name,"tmp");
+      boost::shared_ptr< Entities > elements;
+      if (allocated_type->dimensionality() == allocated_type->dimension()-1)
+        elements = build_component_abstract_type<Entities>("cf3.mesh.Faces","elements_"+allocated_type->derived_type_name());
+      else if(allocated_type->dimensionality() == allocated_type->dimension())
+        elements = build_component_abstract_type<Entities>("cf3.mesh.Cells","elements_"+allocated_type->derived_type_name());
+      else
+        elements = build_component_abstract_type<Entities>("cf3.mesh.Elements","elements_"+allocated_type->derived_type_name());
+      region->add_component(elements);
+      elements->initialize(cf_elem_name,nodes);
 
-      elements_region->rank()[row_idx] = part;
-      elements_region->glb_idx()[row_idx] = element_number-1;
+      Connectivity& elem_table = Handle<Elements>(elements)->geometry_space().connectivity();
+      elem_table.set_row_size(Shared::m_nodes_in_gmsh_elem[etype]);
+      elem_table.resize(m_nb_gmsh_elem_in_region[ir][etype]);
+      elements->rank().resize(m_nb_gmsh_elem_in_region[ir][etype]);
+      elements->glb_idx().resize(m_nb_gmsh_elem_in_region[ir][etype]);
+      conn_table_idx[ir][etype] = Handle<Elements>(elements);
+    }
+  }
 
-      (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type]++;
+  std::vector< std::vector<Uint> > next_row(m_nb_regions, std::vector<Uint>(Shared::nb_gmsh_types, 0));
+  BOOST_FOREACH(const LocalElement& element, m_local_elements)
+  {
+    const Handle<Elements>& elements_region = conn_table_idx[element.region][element.type];
+    const Uint row_idx = next_row[element.region][element.type]++;
+    Connectivity::Row element_nodes = elements_region->geometry_space().connectivity()[row_idx];
 
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[element.type];
+    for (Uint j=0; j<nb_element_nodes; ++j)
+    {
+      const Uint cf_idx = Shared::m_nodes_gmsh_to_cf[element.type][j];
+      element_nodes[cf_idx] = m_node_idx_gmsh_to_cf[m_local_element_nodes[element.nodes_begin + j]];
     }
 
-    // finish the line
-    getline(m_file,line);
+    m_elem_idx_gmsh_to_cf[element.number] = std::make_pair( elements_region , row_idx);
+
+    elements_region->rank()[row_idx] = part;
+    elements_region->glb_idx()[row_idx] = element.number-1;
   }
-  getline(m_file,line);  // ENDOFSECTION
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -687,12 +1050,6 @@ void Reader::read_element_node_data()
     // 1) Find which elements regions this field is defined in.
     foreach_container( (const std::string& field_name) (const Reader::Field& gmsh_field) , gmsh_fields)
     {
-      if (gmsh_field.nb_entries != m_total_nb_elements)
-      {
-        //CFwarn << "Skipping field " << field_name << ": it has " << gmsh_field.nb_entries << " entries while the total number of elements is " << m_total_nb_elements << CFendl;
-        //continue;
-      }
-
       /// TODO: There are shapefunctions defined in this library that are otherwise not found from the buildername :-(
       ///       We should find a solution for this to autoload automatically
       Core::instance().libraries().autoload_library_with_namespace("cf3.dcm.core");
@@ -714,9 +1071,8 @@ void Reader::read_element_node_data()
         CFdebug << "Reading " << field.name() << "/" << field.var_name(var) <<"["<<static_cast<Uint>(field.var_length(var))<<"]" << CFendl;
         Uint var_begin = field.var_offset(var);
         Uint var_end = var_begin + static_cast<Uint>(field.var_length(var));
-        m_file.seekg(gmsh_field.file_data_positions[var]);
+        detail::Cursor cursor(m_mapped_file.data() + static_cast<std::streamoff>(gmsh_field.file_data_positions[var]), m_mapped_file.data() + m_mapped_file.size());
 
-        std::string line;
         Uint gmsh_elem_idx;
         Uint gmsh_nb_elem_nodes;
         Uint cf_idx;
@@ -727,7 +1083,8 @@ void Reader::read_element_node_data()
         std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it;
         for (Uint e=0; e<gmsh_field.nb_entries; ++e)
         {
-          m_file >> gmsh_elem_idx >> gmsh_nb_elem_nodes;
+          gmsh_elem_idx = detail::read_tag(cursor, m_binary, m_swap_bytes);
+          gmsh_nb_elem_nodes = detail::read_tag(cursor, m_binary, m_swap_bytes);
 
           it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
           if (it != m_elem_idx_gmsh_to_cf.end())
@@ -741,7 +1098,7 @@ void Reader::read_element_node_data()
             {
 
               for (d=0; d<data.size(); ++d)
-                m_file >> data[d];
+                data[d] = detail::read_value(cursor, m_binary, m_swap_bytes);
 
               mesh::Field::Row field_data = field[space.connectivity()[cf_idx][n]] ;
 
@@ -755,7 +1112,12 @@ void Reader::read_element_node_data()
                 field_data[v] = data[d++];
             }
           }
-          getline(m_file,line); // finish line
+          else if(m_binary)
+          {
+            cursor.pos += static_cast<std::size_t>(gmsh_nb_elem_nodes) * data.size() * sizeof(double);
+          }
+          if(!m_binary)
+            cursor.next_line(); // finish line
         }
       }
     }
@@ -807,7 +1169,7 @@ void Reader::read_element_data()
         CFdebug << "Reading " << field.name() << "/" << field.var_name(i) <<"["<<static_cast<Uint>(field.var_length(i))<<"]" << CFendl;
         Uint var_begin = field.var_offset(i);
         Uint var_end = var_begin + static_cast<Uint>(field.var_length(i));
-        m_file.seekg(gmsh_field.file_data_positions[i]);
+        detail::Cursor cursor(m_mapped_file.data() + static_cast<std::streamoff>(gmsh_field.file_data_positions[i]), m_mapped_file.data() + m_mapped_file.size());
 
 
         Uint gmsh_elem_idx;
@@ -818,9 +1180,9 @@ void Reader::read_element_data()
 
         for (Uint e=0; e<gmsh_field.nb_entries; ++e)
         {
-          m_file >> gmsh_elem_idx;
+          gmsh_elem_idx = detail::read_tag(cursor, m_binary, m_swap_bytes);
           for (d=0; d<data.size(); ++d)
-            m_file >> data[d];
+            data[d] = detail::read_value(cursor, m_binary, m_swap_bytes);
 
           std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
           if (it != m_elem_idx_gmsh_to_cf.end())
@@ -879,7 +1241,7 @@ void Reader::read_node_data()
       CFdebug << "Reading " << field.name() << "/" << field.var_name(i) <<"["<<static_cast<Uint>(field.var_length(i))<<"]" << CFendl;
       Uint var_begin = field.var_offset(i);
       Uint var_end = var_begin + static_cast<Uint>(field.var_length(i));
-      m_file.seekg(gmsh_field.file_data_positions[i]);
+      detail::Cursor cursor(m_mapped_file.data() + static_cast<std::streamoff>(gmsh_field.file_data_positions[i]), m_mapped_file.data() + m_mapped_file.size());
 
       Uint gmsh_node_idx;
       Uint cf_idx;
@@ -888,9 +1250,9 @@ void Reader::read_node_data()
 
       for (Uint e=0; e<gmsh_field.nb_entries; ++e)
       {
-        m_file >> gmsh_node_idx;
+        gmsh_node_idx = detail::read_tag(cursor, m_binary, m_swap_bytes);
         for (d=0; d<data.size(); ++d)
-          m_file >> data[d];
+          data[d] = detail::read_value(cursor, m_binary, m_swap_bytes);
 
         std::map<Uint, Uint>::iterator it = m_node_idx_gmsh_to_cf.find(gmsh_node_idx);
         if (it != m_node_idx_gmsh_to_cf.end())
@@ -11,6 +11,7 @@
 
 #include <set>
 #include <boost/tuple/tuple.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "mesh/MeshReader.hpp"
 
@@ -24,7 +25,6 @@ namespace mesh {
 
 class Elements;
 class Region;
-class MergedParallelDistribution;
 class Dictionary;
 
 class Mesh;
@@ -55,10 +55,13 @@ private: // functions
 
   Handle<Region> create_region(std::string const& relative_path);
 
-  void find_used_nodes();
+  void read_elements();
 
   void read_coordinates();
 
+  /// Read the numbers and coordinates of the nodes in range part of nb_parts of the nodes section
+  void read_node_range(const Uint part, const Uint nb_parts, std::vector<Uint>& numbers, std::vector<Real>& coords) const;
+
   void read_connectivity();
 
   void read_element_node_data();
@@ -71,13 +74,11 @@ private: // data
 
   virtual void do_read_mesh_into(const common::URI& fp, Mesh& mesh);
 
-  enum HashType { NODES=0, ELEMS=1 };
-  Handle<MergedParallelDistribution> m_hash;
-
   // map< gmsh index , pair< elements, index in elements > >
   std::map<Uint, std::pair<Handle<Elements>,Uint> > m_elem_idx_gmsh_to_cf;
   std::map<Uint, Uint> m_node_idx_gmsh_to_cf;
 
+  boost::iostreams::mapped_file_source m_mapped_file;
   boost::filesystem::fstream m_file;
   Handle<Mesh> m_mesh;
   Handle<Region> m_region;
@@ -100,16 +101,38 @@ private: // data
 
   std::vector<RegionData> m_region_list;
 
-  std::set<Uint> m_ghost_nodes;
-  //std::set<Uint> m_ghost_elems;
-  std::set<Uint> m_used_nodes;
-  
-  std::vector<std::set<Uint> > m_node_to_glb_elements;
+  /// Element read by this rank, with its nodes stored in m_local_element_nodes
+  struct LocalElement
+  {
+    Uint number;
+    Uint type;
+    Uint region;
+    Uint nodes_begin;
+  };
+  std::vector<LocalElement> m_local_elements;
+  std::vector<Uint> m_local_element_nodes;
+
+  Uint m_version; // Major version of the file format, 2 or 4
+  bool m_binary;
+  bool m_swap_bytes;
 
-  //Markers for important places in the file to be read
-  std::streampos m_region_names_position;
-  std::streampos m_coordinates_position;
-  std::streampos m_elements_position;
+  /// Block of nodes or elements belonging to one entity, in a version 4 file
+  struct EntityBlock
+  {
+    Uint nb_entries;
+    Uint type;                // gmsh element type, or the number of parametric coordinates for a node block
+    long phys_tag;            // physical group of the entity, for element blocks
+    std::size_t begin;        // byte offset of the first element, or of the first node number
+    std::size_t coords_begin; // byte offset of the first node coordinates
+  };
+  std::vector<EntityBlock> m_node_blocks;
+  std::vector<EntityBlock> m_element_blocks;
+
+  //Markers for important places in the file to be read (byte offsets)
+  std::size_t m_nodes_begin;
+  std::size_t m_nodes_end;
+  std::size_t m_elements_begin;
+  std::size_t m_elements_end;
   std::vector<std::streampos> m_element_data_positions;
   std::vector<std::streampos> m_node_data_positions;
   std::vector<std::streampos> m_element_node_data_positions;
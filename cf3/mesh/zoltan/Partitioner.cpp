@@ -220,6 +220,9 @@ void Partitioner::set_partitioning_params()
 
   zoltan_handle().Set_Param("EDGE_WEIGHT_DIM", "1");
 
+  zoltan_handle().Set_Param("OBJ_WEIGHT_DIM", has_object_weights() ? "1" : "0");
+  // Number of weights per object, set by the cost_model option
+
   /// zoltan Query functions
 
   zoltan_handle().Set_Num_Obj_Fn(&Partitioner::query_nb_of_objects, this);
@@ -249,6 +252,8 @@ void Partitioner::query_list_of_objects(void *data, int sizeGID, int sizeLID,
 
   p.list_of_objects_owned_by_part(PE::Comm::instance().rank(),globalID);
 
+  if (wgt_dim > 0)
+    p.list_of_object_weights_in_part(PE::Comm::instance().rank(),obj_wgts);
 
   // for debugging
 #if 0
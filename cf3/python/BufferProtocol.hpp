@@ -0,0 +1,168 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef CF3_Python_BufferProtocol_hpp
+#define CF3_Python_BufferProtocol_hpp
+
+#include "python/BoostPython.hpp"
+
+#include <boost/pointer_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "python/ComponentWrapper.hpp"
+
+namespace cf3 {
+namespace python {
+
+/// Format character of the Python buffer protocol for the supported value types
+template<typename ValueT>
+struct BufferFormat;
+
+template<>
+struct BufferFormat<Real>
+{
+  static const char* value() { return sizeof(Real) == sizeof(double) ? "d" : "f"; }
+};
+
+template<>
+struct BufferFormat<Uint>
+{
+  static const char* value() { return "I"; }
+};
+
+template<>
+struct BufferFormat<bool>
+{
+  static const char* value() { return "?"; }
+};
+
+/// Implementation of the Python buffer protocol for components that store a boost::multi_array, i.e. Table and List.
+/// The exported buffer aliases the storage of the component, so numpy.asarray(table) gives an array that reads and
+/// writes directly into the solver memory. While a buffer exists, the component is kept alive and refuses to resize,
+/// so the buffer can't dangle.
+template<typename ArrayComponentT, typename WrapperT, bool IsConst>
+struct BufferProtocol
+{
+  typedef typename ArrayComponentT::value_type ValueT;
+
+  /// Data that must live as long as the buffer
+  struct ViewData
+  {
+    boost::shared_ptr<ArrayComponentT> component;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+  };
+
+  /// Fill in the memory layout of a (C-ordered) multi_array
+  template<typename ArrayT>
+  static void describe(ArrayT& array, ViewData& data, Py_buffer& view)
+  {
+    const int ndim = array.num_dimensions();
+    Py_ssize_t stride = sizeof(ValueT);
+    for(int d = ndim-1; d >= 0; --d)
+    {
+      data.shape[d] = array.shape()[d];
+      data.strides[d] = stride;
+      stride *= data.shape[d];
+    }
+    view.buf = array.data();
+    view.len = array.num_elements() * sizeof(ValueT);
+    view.ndim = ndim;
+  }
+
+  static int get_buffer(PyObject* self, Py_buffer* view, int flags)
+  {
+    view->obj = 0;
+    if(IsConst && (flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+      PyErr_SetString(PyExc_BufferError, "Buffer of a const component is read-only");
+      return -1;
+    }
+
+    try
+    {
+      WrapperT& wrapper = boost::python::extract<WrapperT&>(self);
+      const common::Component& component = static_cast<const WrapperT&>(wrapper).component();
+      const ArrayComponentT* array_component = dynamic_cast<const ArrayComponentT*>(&component);
+      if(array_component == 0)
+      {
+        PyErr_SetString(PyExc_BufferError, ("Component " + component.uri().path() + " does not store an array of type " + ArrayComponentT::type_name()).c_str());
+        return -1;
+      }
+
+      ViewData* data = new ViewData();
+      data->component = boost::const_pointer_cast<ArrayComponentT>(boost::dynamic_pointer_cast<ArrayComponentT const>(array_component->shared_from_this()));
+
+      describe(data->component->array(), *data, *view);
+      view->readonly = IsConst;
+      view->itemsize = sizeof(ValueT);
+      view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>(BufferFormat<ValueT>::value()) : 0;
+      view->shape = (flags & PyBUF_ND) == PyBUF_ND ? data->shape : 0;
+      view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? data->strides : 0;
+      view->suboffsets = 0;
+      view->internal = data;
+
+      data->component->add_view();
+      view->obj = self;
+      Py_INCREF(self);
+      return 0;
+    }
+    catch(boost::python::error_already_set&)
+    {
+      return -1;
+    }
+    catch(std::exception& e)
+    {
+      PyErr_SetString(PyExc_BufferError, e.what());
+      return -1;
+    }
+  }
+
+  static void release_buffer(PyObject*, Py_buffer* view)
+  {
+    ViewData* data = static_cast<ViewData*>(view->internal);
+    if(data == 0)
+      return;
+    data->component->remove_view();
+    delete data;
+    view->internal = 0;
+  }
+
+  /// Install the buffer functions on the given wrapper class
+  static void install(boost::python::object& python_class)
+  {
+    static PyBufferProcs procs;
+    procs.bf_getbuffer = get_buffer;
+    procs.bf_releasebuffer = release_buffer;
+
+    PyTypeObject* type = reinterpret_cast<PyTypeObject*>(python_class.ptr());
+    type->tp_as_buffer = &procs;
+#if PY_MAJOR_VERSION < 3
+    type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+  }
+};
+
+/// Expose the storage of the component wrapped by python_class through the Python buffer protocol
+template<typename ArrayComponentT>
+void def_buffer_protocol(boost::python::object python_class)
+{
+  BufferProtocol<ArrayComponentT, ComponentWrapper, false>::install(python_class);
+}
+
+/// Expose the storage of the component wrapped by python_class through the Python buffer protocol, read-only version
+template<typename ArrayComponentT>
+void def_const_buffer_protocol(boost::python::object python_class)
+{
+  BufferProtocol<ArrayComponentT, ComponentWrapperConst, true>::install(python_class);
+}
+
+} // python
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // CF3_Python_BufferProtocol_hpp
@@ -15,6 +15,7 @@
 
 #include "common/List.hpp"
 
+#include "python/BufferProtocol.hpp"
 #include "python/ComponentWrapper.hpp"
 #include "python/ListWrapper.hpp"
 #include "python/Utility.hpp"
@@ -72,17 +73,20 @@ void def_clist_types()
   typedef DerivedComponentWrapper< common::List<ValueT> > ListWrapper;
   typedef DerivedComponentWrapper< common::List<ValueT> const > ListWrapperConst;
 
-  boost::python::class_<ListWrapper, boost::python::bases<ComponentWrapper> >(("List_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
+  // Lists support the buffer protocol, so numpy.asarray(list) aliases the list storage
+  boost::python::object list_class = boost::python::class_<ListWrapper, boost::python::bases<ComponentWrapper> >(("List_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("resize", ListMethods<ValueT>::resize, "Set the size of the List, i.e. the number of rows")
     .def("__setitem__", ListMethods<ValueT>::set_item)
     .def("__getitem__", ListMethods<ValueT>::get_item)
     .def("__len__", ListMethods<ValueT>::len)
     .def("__str__", ListMethods<ValueT>::to_str);
+  def_buffer_protocol< common::List<ValueT> >(list_class);
 
-  boost::python::class_<ListWrapperConst, boost::python::bases<ComponentWrapperConst> >(("ListConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
+  boost::python::object list_const_class = boost::python::class_<ListWrapperConst, boost::python::bases<ComponentWrapperConst> >(("ListConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("__getitem__", ListMethods<ValueT>::get_item)
     .def("__len__", ListMethods<ValueT>::len)
     .def("__str__", ListMethods<ValueT>::to_str);
+  def_const_buffer_protocol< common::List<ValueT> >(list_const_class);
 
   ComponentWrapperRegistry::instance().register_factory< DefaultComponentWrapperFactory< common::List<ValueT> > >();
 }
@@ -15,6 +15,7 @@
 
 #include "common/Table.hpp"
 
+#include "python/BufferProtocol.hpp"
 #include "python/ComponentWrapper.hpp"
 #include "python/TableWrapper.hpp"
 #include "python/Utility.hpp"
@@ -165,7 +166,8 @@ void def_ctable_types()
   typedef DerivedComponentWrapper< common::Table<ValueT> > TableWrapper;
   typedef DerivedComponentWrapper< common::Table<ValueT> const > TableWrapperConst;
 
-  boost::python::class_<TableWrapper, boost::python::bases<ComponentWrapper> >(("Table_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
+  // Tables, and fields, support the buffer protocol, so numpy.asarray(table) aliases the table storage
+  boost::python::object table_class = boost::python::class_<TableWrapper, boost::python::bases<ComponentWrapper> >(("Table_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("row_size", TableMethods<ValueT>::row_size, "Return the number of columns the table can hold")
     .def("resize", TableMethods<ValueT>::resize, "Set the size of the table, i.e. the number of rows")
     .def("set_row_size", TableMethods<ValueT>::set_row_size, "Set the size of a row, i.e. the number of columns in the table")
@@ -173,12 +175,14 @@ void def_ctable_types()
     .def("__getitem__", TableMethods<ValueT>::get_item)
     .def("__len__", TableMethods<ValueT>::len)
     .def("__str__", TableMethods<ValueT>::to_str);
+  def_buffer_protocol< common::Table<ValueT> >(table_class);
 
-  boost::python::class_<TableWrapperConst, boost::python::bases<ComponentWrapperConst> >(("TableConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
+  boost::python::object table_const_class = boost::python::class_<TableWrapperConst, boost::python::bases<ComponentWrapperConst> >(("TableConst_"+common::class_name<ValueT>()).c_str(), boost::python::no_init)
     .def("row_size", TableMethods<ValueT>::row_size, "Return the number of columns the table can hold")
     .def("__getitem__", TableMethods<ValueT>::get_item_const)
     .def("__len__", TableMethods<ValueT>::len)
     .def("__str__", TableMethods<ValueT>::to_str);
+  def_const_buffer_protocol< common::Table<ValueT> >(table_const_class);
 
   ComponentWrapperRegistry::instance().register_factory< DefaultComponentWrapperFactory< common::Table<ValueT> > >();
 }
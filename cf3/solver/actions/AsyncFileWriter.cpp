@@ -0,0 +1,73 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Log.hpp"
+
+#include "solver/actions/AsyncFileWriter.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+AsyncFileWriter::AsyncFileWriter()
+{
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+  if(is_not_null(m_thread.get()))
+    m_thread->join();
+  if(!m_error.empty())
+    CFerror << m_error << CFendl;
+}
+
+void AsyncFileWriter::write(const std::string& path, const std::string& contents)
+{
+  wait();
+  m_thread.reset(new boost::thread(boost::bind(&AsyncFileWriter::run, this, path, contents)));
+}
+
+void AsyncFileWriter::wait()
+{
+  if(is_not_null(m_thread.get()))
+  {
+    m_thread->join();
+    m_thread.reset();
+  }
+
+  if(!m_error.empty())
+  {
+    const std::string error = m_error;
+    m_error.clear();
+    throw common::FileSystemError(FromHere(), error);
+  }
+}
+
+void AsyncFileWriter::run(const std::string path, const std::string contents)
+{
+  boost::filesystem::fstream file(path, std::ios::out);
+  file << contents;
+  file.close();
+  if(file.fail())
+    m_error = "Error writing file " + path;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
+
+/////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,58 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_actions_AsyncFileWriter_hpp
+#define cf3_solver_actions_AsyncFileWriter_hpp
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "solver/actions/LibActions.hpp"
+
+namespace boost { class thread; }
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+/// Writes text files in a background thread, so output of statistics does not stall the computation.
+/// At most one write is in progress: a new write first waits for the previous one to complete.
+class solver_actions_API AsyncFileWriter : boost::noncopyable
+{
+public:
+  AsyncFileWriter();
+
+  /// Waits for the write in progress
+  ~AsyncFileWriter();
+
+  /// Write contents to the file at path, returning before the data is on disk
+  void write(const std::string& path, const std::string& contents);
+
+  /// Wait for the write in progress. Throws if the previous write failed.
+  void wait();
+
+private:
+  void run(const std::string path, const std::string contents);
+
+  boost::scoped_ptr<boost::thread> m_thread;
+  std::string m_error;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_solver_actions_AsyncFileWriter_hpp
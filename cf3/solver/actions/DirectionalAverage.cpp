@@ -60,7 +60,8 @@ struct threshold_compare
 }
 
 DirectionalAverage::DirectionalAverage ( const std::string& name ) :
-  common::Action(name)
+  common::Action(name),
+  m_writer(new AsyncFileWriter())
 {
   options().add("direction", 0u)
     .pretty_name("Direction")
@@ -86,59 +87,56 @@ DirectionalAverage::DirectionalAverage ( const std::string& name ) :
     .mark_basic();
 }
 
+DirectionalAverage::~DirectionalAverage()
+{
+}
+
 void DirectionalAverage::execute()
 {
   setup();
 
-  std::fill(m_averages.begin(), m_averages.end(), 0.);
+  std::fill(m_sums.begin(), m_sums.end(), 0.);
   
   const mesh::Field::ArrayT& field_values = m_field->array();
-  const Uint nb_nodes = field_values.size();
-  const mesh::Dictionary& dict = m_field->dict();
-  const common::List<bool>* periodic_links_active = Handle<common::List<bool> const>(dict.get_child("periodic_links_active")).get();
-  const Uint stride = m_field->row_size()+1;
-  for(Uint node_idx = 0; node_idx != nb_nodes; ++node_idx)
+  const Uint nb_used_nodes = m_used_nodes.size();
+  const Uint row_size = m_field->row_size();
+  for(Uint i = 0; i != nb_used_nodes; ++i)
   {
-    if(!dict.is_ghost(node_idx) && !(is_not_null(periodic_links_active) && (*periodic_links_active)[node_idx]))
-    {
-      const Uint position_idx = m_node_position_indices[node_idx];
-      const Uint node_begin = stride*position_idx;
-      ++m_averages[node_begin];
-      const mesh::Field::ConstRow row = field_values[node_idx];
-      std::transform(row.begin(), row.end(), m_averages.begin()+node_begin+1, m_averages.begin()+node_begin+1, std::plus<Real>());
-    }
+    const Uint sum_begin = row_size*m_node_position_indices[i];
+    const mesh::Field::ConstRow row = field_values[m_used_nodes[i]];
+    std::transform(row.begin(), row.end(), m_sums.begin()+sum_begin, m_sums.begin()+sum_begin, std::plus<Real>());
   }
   
   common::PE::Comm& comm = common::PE::Comm::instance();
-  std::vector<Real> global_averages;
+  std::vector<Real> global_sums;
   if(comm.is_active())
   {
-    comm.reduce(common::PE::plus(), m_averages, global_averages, 0);
+    comm.reduce(common::PE::plus(), m_sums, global_sums, 0);
   }
   else
   {
-    global_averages = m_averages;
+    global_sums = m_sums;
   }
   
   if(comm.rank() == 0)
   {
-    boost::filesystem::fstream file(options().value<common::URI>("file").path(), std::ios::out);
+    std::ostringstream file;
     const Uint nb_positions = m_positions.size();
     file << "# Position, Count, Averages for " << m_field->descriptor().description() << "\n";
     for(Uint pos_idx = 0; pos_idx != nb_positions; ++pos_idx)
     {
-      const Uint avg_begin = pos_idx*stride;
-      const Uint avg_end = avg_begin+stride;
-      const Real count = global_averages[avg_begin];
+      const Uint avg_begin = pos_idx*row_size;
+      const Uint avg_end = avg_begin+row_size;
+      const Real count = m_counts[pos_idx];
       file << common::to_str(m_positions[pos_idx]) << " " << count;
 
-      for(Uint j = avg_begin+1; j != avg_end; ++j)
+      for(Uint j = avg_begin; j != avg_end; ++j)
       {
-        file << " " << common::to_str(global_averages[j]/count);
+        file << " " << common::to_str(global_sums[j]/count);
       }
       file << "\n";
     }
-    file.close();
+    m_writer->write(options().value<common::URI>("file").path(), file.str());
   }
 }
 
@@ -195,18 +193,37 @@ void DirectionalAverage::setup()
 
   CFinfo << "Found " << m_positions.size() << " unique coordinates in direction " << direction << CFendl;
   
-  m_node_position_indices.resize(nb_nodes);
+  // Nodes that contribute: owned, and not a periodic copy of another node
+  const common::List<bool>* periodic_links_active = Handle<common::List<bool> const>(dict.get_child("periodic_links_active")).get();
+  m_used_nodes.clear();
+  m_node_position_indices.clear();
+  std::vector<Real> local_counts(m_positions.size(), 0.);
   for(Uint node_idx = 0; node_idx != nb_nodes; ++node_idx )
   {
-    if(!dict.is_ghost( node_idx ))
+    if(!dict.is_ghost( node_idx ) && !(is_not_null(periodic_links_active) && (*periodic_links_active)[node_idx]))
     {
       cf3_assert(coords_map.find(coords[node_idx][direction]) != coords_map.end());
-      m_node_position_indices[node_idx] = coords_map[coords[node_idx][direction]];
+      const Uint position_idx = coords_map[coords[node_idx][direction]];
+      m_used_nodes.push_back(node_idx);
+      m_node_position_indices.push_back(position_idx);
+      ++local_counts[position_idx];
     }
   }
+
+  // The number of nodes at each position doesn't change, so it is only reduced once
+  if(comm.is_active())
+  {
+    m_counts.resize(local_counts.size());
+    if(!local_counts.empty())
+      comm.all_reduce(common::PE::plus(), &local_counts[0], local_counts.size(), &m_counts[0]);
+  }
+  else
+  {
+    m_counts = local_counts;
+  }
   
-  // For each position, we store the count and then the sum of all values in the field
-  m_averages.resize(m_positions.size() * (m_field->row_size()+1));
+  // For each position, we store the sum of all values in the field
+  m_sums.resize(m_positions.size() * m_field->row_size());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
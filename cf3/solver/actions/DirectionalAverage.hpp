@@ -18,6 +18,7 @@
 
 #include "mesh/Field.hpp"
 
+#include "solver/actions/AsyncFileWriter.hpp"
 #include "solver/actions/LibActions.hpp"
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -29,7 +30,7 @@ namespace actions {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 /// Take the average along planes perpendicular to the given direction
-/// Assumes a structured mesh
+/// Assumes a structured mesh. Each rank sums its own nodes, the sums are reduced to rank 0 which writes the file in the background.
 class solver_actions_API DirectionalAverage : public common::Action
 {
 public: // functions
@@ -38,7 +39,7 @@ public: // functions
   DirectionalAverage ( const std::string& name );
 
   /// Virtual destructor
-  virtual ~DirectionalAverage() {}
+  virtual ~DirectionalAverage();
 
   /// Get the class name
   static std::string type_name () { return "DirectionalAverage"; }
@@ -51,9 +52,15 @@ private:
   void trigger();
   void setup();
   Handle<mesh::Field> m_field;
+  // Nodes contributing to the average, and the index of the position of each
+  std::vector<Uint> m_used_nodes;
   std::vector<Uint> m_node_position_indices;
   std::vector<Real> m_positions;
-  std::vector<Real> m_averages;
+  // Global number of nodes at each position
+  std::vector<Real> m_counts;
+  // Local sum of the field values at each position
+  std::vector<Real> m_sums;
+  boost::scoped_ptr<AsyncFileWriter> m_writer;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////
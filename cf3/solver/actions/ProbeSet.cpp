@@ -0,0 +1,390 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionComponent.hpp"
+#include "common/PropertyList.hpp"
+#include "common/PE/Comm.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementFinder.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/PointInterpolator.hpp"
+#include "mesh/Tags.hpp"
+
+#include "solver/Tags.hpp"
+#include "solver/Time.hpp"
+#include "solver/actions/ProbeSet.hpp"
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+
+using namespace common;
+
+common::ComponentBuilder < ProbeSet, common::Action, LibActions > ProbeSet_Builder;
+common::ComponentBuilder < ProbeSetWriter, common::Action, LibActions > ProbeSetWriter_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProbeLocator::locate(mesh::PointInterpolator& interpolator, const std::vector<RealVector>& points)
+{
+  PE::Comm& comm = PE::Comm::instance();
+  const int nb_procs = comm.is_active() ? comm.size() : 1;
+  const int my_rank = comm.is_active() ? comm.rank() : 0;
+  const Uint nb_points = points.size();
+
+  // Only accept points that lie inside an element on this rank, otherwise every rank claims every point
+  Handle<mesh::ElementFinder> finder(interpolator.get_child("element_finder"));
+  if(is_not_null(finder) && finder->options().check("find_closest"))
+    finder->options().set("find_closest", false);
+
+  // Single pass over all points, keeping the interpolation data of the points found here
+  std::vector<int> owner(nb_points, nb_procs);
+  std::vector<mesh::SpaceElem> found_elements(nb_points);
+  std::vector< std::vector<Uint> > found_points(nb_points);
+  std::vector< std::vector<Real> > found_weights(nb_points);
+  std::vector<mesh::SpaceElem> stencil;
+  for(Uint i = 0; i != nb_points; ++i)
+  {
+    if(interpolator.compute_storage(points[i], found_elements[i], stencil, found_points[i], found_weights[i]))
+      owner[i] = my_rank;
+  }
+
+  // Points on partition boundaries are found by several ranks: the lowest rank owns them
+  if(comm.is_active() && nb_points != 0)
+    comm.all_reduce(PE::min(), owner, owner);
+
+  m_probe_indices.clear();
+  m_elements.clear();
+  m_stencil_begin.assign(1, 0);
+  m_points.clear();
+  m_weights.clear();
+  for(Uint i = 0; i != nb_points; ++i)
+  {
+    if(owner[i] == nb_procs)
+      throw SetupError(FromHere(), "Probe " + to_str(i) + " at (" + to_str(std::vector<Real>(points[i].data(), points[i].data() + points[i].size())) + ") lies outside the domain");
+    if(owner[i] != my_rank)
+      continue;
+
+    m_probe_indices.push_back(i);
+    m_elements.push_back(found_elements[i]);
+    m_points.insert(m_points.end(), found_points[i].begin(), found_points[i].end());
+    m_weights.insert(m_weights.end(), found_weights[i].begin(), found_weights[i].end());
+    m_stencil_begin.push_back(m_points.size());
+  }
+}
+
+void ProbeLocator::interpolate(const mesh::Field& field, const Uint local_probe, const Uint var_begin, const Uint var_length, Real* result) const
+{
+  cf3_assert(local_probe < m_probe_indices.size());
+  const mesh::Field::ArrayT& array = field.array();
+  const Uint stencil_end = m_stencil_begin[local_probe+1];
+  for(Uint v = 0; v != var_length; ++v)
+    result[v] = 0.;
+  for(Uint i = m_stencil_begin[local_probe]; i != stencil_end; ++i)
+  {
+    const mesh::Field::ConstRow row = array[m_points[i]];
+    const Real w = m_weights[i];
+    for(Uint v = 0; v != var_length; ++v)
+      result[v] += w * row[var_begin+v];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ProbeSet::ProbeSet ( const std::string& name ) :
+  common::Action(name),
+  m_setup_needed(true),
+  m_nb_probes(0),
+  m_nb_values(0),
+  m_nb_samples(0)
+{
+  properties()["brief"] = std::string("Interpolate fields to a set of points, buffering the results");
+  properties()["description"] = std::string("The points are located once. Each execution samples all probes, flushing writes the buffered samples from rank 0.");
+
+  options().add("coordinates", std::vector<Real>())
+    .pretty_name("Coordinates")
+    .description("Coordinates of the probes, one point after the other (x0, y0, z0, x1, y1, z1, ...)")
+    .attach_trigger(boost::bind(&ProbeSet::trigger_setup, this))
+    .mark_basic();
+
+  options().add("variables", std::vector<std::string>())
+    .pretty_name("Variables")
+    .description("Names of the variables to probe. Leave empty to probe all variables of the dictionary")
+    .attach_trigger(boost::bind(&ProbeSet::trigger_setup, this))
+    .mark_basic();
+
+  options().add("dict", m_dict)
+    .pretty_name("Dictionary")
+    .description("Dictionary that will be probed")
+    .link_to(&m_dict)
+    .attach_trigger(boost::bind(&ProbeSet::trigger_setup, this))
+    .mark_basic();
+
+  options().add(Tags::time(), m_time)
+    .pretty_name("Time")
+    .description("Time component, used to label the samples")
+    .link_to(&m_time);
+
+  m_point_interpolator = create_static_component<mesh::PointInterpolator>("point_interpolator");
+  m_point_interpolator->options().set("function", std::string("cf3.mesh.ShapeFunctionInterpolation"));
+}
+
+ProbeSet::~ProbeSet()
+{
+}
+
+void ProbeSet::trigger_setup()
+{
+  m_setup_needed = true;
+}
+
+void ProbeSet::setup()
+{
+  if(!m_setup_needed)
+    return;
+  m_setup_needed = false;
+
+  if(is_null(m_dict))
+    throw SetupError(FromHere(), "Option \"dict\" was not configured in " + uri().string());
+
+  if(!m_sample_iterations.empty())
+    CFwarn << "Discarding " << m_sample_iterations.size() << " unwritten samples in " << uri().path() << " because the probe set changed" << CFendl;
+  m_buffer.clear();
+  m_sample_iterations.clear();
+  m_sample_times.clear();
+  m_nb_samples = 0;
+
+  // Probe points
+  const Uint dim = m_dict->coordinates().row_size();
+  const std::vector<Real> coordinates = options().value< std::vector<Real> >("coordinates");
+  if(coordinates.size() % dim != 0)
+    throw SetupError(FromHere(), "Number of coordinates " + to_str(coordinates.size()) + " for " + uri().path() + " is not a multiple of the dimension " + to_str(dim));
+  m_nb_probes = coordinates.size() / dim;
+  m_points.assign(m_nb_probes, RealVector(dim));
+  for(Uint i = 0; i != m_nb_probes; ++i)
+    m_points[i] = RealVector::Map(&coordinates[i*dim], dim);
+
+  // Probed variables
+  const std::vector<std::string> variables = options().value< std::vector<std::string> >("variables");
+  m_fields.clear();
+  m_var_begin.clear();
+  m_var_length.clear();
+  m_column_names.clear();
+  m_nb_values = 0;
+  std::vector<bool> variable_found(variables.size(), false);
+  boost_foreach(const Handle<mesh::Field>& field, m_dict->fields())
+  {
+    if(variables.empty() && field->has_tag(mesh::Tags::coordinates()))
+      continue;
+    const math::VariablesDescriptor& descriptor = field->descriptor();
+    for(Uint var_idx = 0; var_idx != descriptor.nb_vars(); ++var_idx)
+    {
+      const std::string& var_name = descriptor.user_variable_name(var_idx);
+      if(!variables.empty())
+      {
+        const std::vector<std::string>::const_iterator found = std::find(variables.begin(), variables.end(), var_name);
+        if(found == variables.end())
+          continue;
+        variable_found[found - variables.begin()] = true;
+      }
+
+      const Uint var_length = descriptor.var_length(var_idx);
+      m_fields.push_back(field);
+      m_var_begin.push_back(descriptor.offset(var_idx));
+      m_var_length.push_back(var_length);
+      m_nb_values += var_length;
+      if(var_length == 1)
+      {
+        m_column_names.push_back(var_name);
+      }
+      else
+      {
+        for(Uint i = 0; i != var_length; ++i)
+          m_column_names.push_back(var_name + "[" + to_str(i) + "]");
+      }
+    }
+  }
+  for(Uint i = 0; i != variables.size(); ++i)
+  {
+    if(!variable_found[i])
+      throw SetupError(FromHere(), "Variable " + variables[i] + " probed by " + uri().path() + " was not found in " + m_dict->uri().path());
+  }
+
+  // Locate the probes once
+  m_point_interpolator->options().set("dict", m_dict);
+  m_locator.locate(*m_point_interpolator, m_points);
+
+  // Rank 0 needs to know which probes are where to order the gathered data
+  PE::Comm& comm = PE::Comm::instance();
+  if(comm.is_active())
+  {
+    std::vector< std::vector<Uint> > all_indices;
+    comm.all_gather(m_locator.probe_indices(), all_indices);
+    m_nb_probes_per_rank.assign(comm.size(), 0);
+    m_all_probe_indices.clear();
+    for(Uint rank = 0; rank != comm.size(); ++rank)
+    {
+      m_nb_probes_per_rank[rank] = all_indices[rank].size();
+      m_all_probe_indices.insert(m_all_probe_indices.end(), all_indices[rank].begin(), all_indices[rank].end());
+    }
+  }
+  else
+  {
+    m_nb_probes_per_rank.assign(1, m_locator.nb_local_probes());
+    m_all_probe_indices = m_locator.probe_indices();
+  }
+
+  properties()["nb_probes"] = m_nb_probes;
+}
+
+void ProbeSet::execute()
+{
+  setup();
+
+  const Uint nb_local_probes = m_locator.nb_local_probes();
+  const Uint nb_fields = m_fields.size();
+
+  Uint sample_begin = m_buffer.size();
+  m_buffer.resize(sample_begin + nb_local_probes*m_nb_values);
+  for(Uint probe = 0; probe != nb_local_probes; ++probe)
+  {
+    for(Uint i = 0; i != nb_fields; ++i)
+    {
+      m_locator.interpolate(*m_fields[i], probe, m_var_begin[i], m_var_length[i], &m_buffer[sample_begin]);
+      sample_begin += m_var_length[i];
+    }
+  }
+
+  m_sample_iterations.push_back(is_null(m_time) ? m_nb_samples : m_time->iter());
+  ++m_nb_samples;
+  m_sample_times.push_back(is_null(m_time) ? 0. : m_time->current_time());
+}
+
+void ProbeSet::flush(const URI& file)
+{
+  setup();
+
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint nb_samples = m_sample_iterations.size();
+
+  // One gather for all buffered samples of all probes
+  std::vector<Real> gathered;
+  if(comm.is_active())
+  {
+    std::vector<int> recv_counts(comm.size());
+    for(Uint rank = 0; rank != comm.size(); ++rank)
+      recv_counts[rank] = nb_samples*m_nb_probes_per_rank[rank]*m_nb_values;
+    if(comm.rank() == 0)
+      gathered.resize(nb_samples*m_nb_probes*m_nb_values);
+    comm.gather(m_buffer, m_buffer.size(), gathered, recv_counts, 0);
+  }
+  else
+  {
+    gathered.swap(m_buffer);
+  }
+
+  m_buffer.clear();
+  const std::vector<Uint> sample_iterations = m_sample_iterations;
+  const std::vector<Real> sample_times = m_sample_times;
+  m_sample_iterations.clear();
+  m_sample_times.clear();
+
+  if(comm.is_active() && comm.rank() != 0)
+    return;
+
+  // Order the data by sample, then by probe index
+  std::vector<Real> ordered(gathered.size());
+  Uint gathered_idx = 0;
+  Uint probe_offset = 0;
+  for(Uint rank = 0; rank != m_nb_probes_per_rank.size(); ++rank)
+  {
+    const Uint nb_rank_probes = m_nb_probes_per_rank[rank];
+    for(Uint sample = 0; sample != nb_samples; ++sample)
+    {
+      for(Uint i = 0; i != nb_rank_probes; ++i)
+      {
+        const Uint probe_idx = m_all_probe_indices[probe_offset + i];
+        std::copy(gathered.begin() + gathered_idx, gathered.begin() + gathered_idx + m_nb_values, ordered.begin() + (sample*m_nb_probes + probe_idx)*m_nb_values);
+        gathered_idx += m_nb_values;
+      }
+    }
+    probe_offset += nb_rank_probes;
+  }
+
+  const std::string path = file.path();
+  const bool append = path == m_last_file;
+  boost::filesystem::fstream out(path, append ? std::ios_base::out | std::ios_base::app : std::ios_base::out);
+  if(!out)
+    throw FileSystemError(FromHere(), "Failed to open file " + path);
+  m_last_file = path;
+
+  if(!append)
+  {
+    out << "# Probe data for " << m_nb_probes << " probes\n";
+    for(Uint i = 0; i != m_nb_probes; ++i)
+      out << "# probe " << i << ": " << m_points[i].transpose() << "\n";
+    out << "# iteration time probe";
+    boost_foreach(const std::string& column, m_column_names)
+      out << " " << column;
+    out << "\n";
+  }
+
+  out.precision(12);
+  for(Uint sample = 0; sample != nb_samples; ++sample)
+  {
+    for(Uint probe = 0; probe != m_nb_probes; ++probe)
+    {
+      out << sample_iterations[sample] << " " << sample_times[sample] << " " << probe;
+      const Real* values = &ordered[(sample*m_nb_probes + probe)*m_nb_values];
+      for(Uint v = 0; v != m_nb_values; ++v)
+        out << " " << values[v];
+      out << "\n";
+    }
+  }
+
+  if(!out)
+    throw FileSystemError(FromHere(), "Failed to write probe data to " + path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ProbeSetWriter::ProbeSetWriter ( const std::string& name ) :
+  common::Action(name)
+{
+  options().add("probe_set", m_probe_set)
+    .pretty_name("Probe Set")
+    .description("Probe set to write")
+    .link_to(&m_probe_set)
+    .mark_basic();
+
+  options().add("file", URI())
+    .pretty_name("File")
+    .description("File to write the probe data to. Data is appended if the file name did not change since the last write")
+    .mark_basic();
+}
+
+void ProbeSetWriter::execute()
+{
+  if(is_null(m_probe_set))
+    throw SetupError(FromHere(), "Option \"probe_set\" was not configured in " + uri().string());
+
+  m_probe_set->flush(options().value<URI>("file"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
@@ -0,0 +1,158 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_actions_ProbeSet_hpp
+#define cf3_solver_actions_ProbeSet_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Action.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "mesh/Space.hpp"
+
+#include "solver/actions/LibActions.hpp"
+
+namespace cf3 {
+namespace mesh { class Dictionary; class Field; class PointInterpolator; }
+namespace solver {
+class Time;
+namespace actions {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Interpolation data for a set of points, computed once and reused for every evaluation
+///
+/// All points are located in a single pass over the element finder of the given interpolator, and each point
+/// is assigned to exactly one rank (the lowest rank that contains it) using a single collective. The element, the
+/// interpolation stencil and the weights are cached for the points owned by this rank.
+class solver_actions_API ProbeLocator
+{
+public:
+  /// Locate the points. The interpolator must have its dictionary configured.
+  /// Throws a SetupError if a point lies outside the domain on all ranks.
+  void locate(mesh::PointInterpolator& interpolator, const std::vector<RealVector>& points);
+
+  /// Number of probes owned by this rank
+  Uint nb_local_probes() const { return m_probe_indices.size(); }
+
+  /// Index in the original point list of each local probe
+  const std::vector<Uint>& probe_indices() const { return m_probe_indices; }
+
+  /// Element containing each local probe
+  const std::vector<mesh::SpaceElem>& elements() const { return m_elements; }
+
+  /// Interpolate var_length consecutive entries of a field row, starting at var_begin, to the given local probe
+  void interpolate(const mesh::Field& field, const Uint local_probe, const Uint var_begin, const Uint var_length, Real* result) const;
+
+private:
+  std::vector<Uint> m_probe_indices;
+  std::vector<mesh::SpaceElem> m_elements;
+  /// Offset of the stencil of each local probe in m_points and m_weights (compressed storage, size nb_local_probes+1)
+  std::vector<Uint> m_stencil_begin;
+  std::vector<Uint> m_points;
+  std::vector<Real> m_weights;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Probe a large number of points at once, buffering the time series in memory
+///
+/// The points are located once, on the first execution or after one of the options changed. Each execution
+/// interpolates the configured variables to the probes owned by this rank and appends them to a buffer, without
+/// any communication. The buffer is collected on rank 0 with a single gather by calling flush(), which is what
+/// the ProbeSetWriter does. Put a ProbeSetWriter in a TimeSeriesWriter to control the output interval.
+class solver_actions_API ProbeSet : public common::Action
+{
+public: // functions
+
+  /// Contructor
+  /// @param name of the component
+  ProbeSet ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ProbeSet();
+
+  /// Get the class name
+  static std::string type_name () { return "ProbeSet"; }
+
+  /// Sample all probes
+  virtual void execute();
+
+  /// Gather the buffered samples on rank 0, write them to the given file and clear the buffer.
+  /// Samples are appended if the file is the same as for the previous flush.
+  void flush(const common::URI& file);
+
+  /// Number of samples in the buffer
+  Uint nb_buffered_samples() const { return m_sample_iterations.size(); }
+
+private: // functions
+  void setup();
+  void trigger_setup();
+
+private: // data
+  Handle<mesh::Dictionary> m_dict;
+  Handle<Time> m_time;
+  Handle<mesh::PointInterpolator> m_point_interpolator;
+  bool m_setup_needed;
+
+  ProbeLocator m_locator;
+  /// Number of local probes on each rank, and their global index, known on all ranks
+  std::vector<int> m_nb_probes_per_rank;
+  std::vector<Uint> m_all_probe_indices;
+  Uint m_nb_probes;
+  std::vector<RealVector> m_points;
+
+  /// Field, offset in the field row and length of each probed variable
+  std::vector< Handle<mesh::Field> > m_fields;
+  std::vector<Uint> m_var_begin;
+  std::vector<Uint> m_var_length;
+  std::vector<std::string> m_column_names;
+  Uint m_nb_values;
+
+  /// Buffered data, sample-major, then local probe, then value
+  std::vector<Real> m_buffer;
+  std::vector<Uint> m_sample_iterations;
+  std::vector<Real> m_sample_times;
+  /// Total number of samples taken since the last setup
+  Uint m_nb_samples;
+
+  /// Last file that was written, to append to it on the next flush
+  std::string m_last_file;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the buffered samples of a ProbeSet. Meant to be used inside a TimeSeriesWriter.
+class solver_actions_API ProbeSetWriter : public common::Action
+{
+public:
+  /// Contructor
+  /// @param name of the component
+  ProbeSetWriter ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ProbeSetWriter() {}
+
+  /// Get the class name
+  static std::string type_name () { return "ProbeSetWriter"; }
+
+  virtual void execute();
+
+private:
+  Handle<ProbeSet> m_probe_set;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // solver
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_solver_actions_ProbeSet_hpp
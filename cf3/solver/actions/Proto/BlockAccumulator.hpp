@@ -109,6 +109,64 @@ inline void do_assign_op_matrix(boost::proto::tag::plus_assign, math::LSS::Matri
   }
 }
 
+/// Translate tag to operator, using the LSS wrapper and the element data
+template<typename OpTagT, typename LSST, typename DataT>
+inline void do_assign_op_matrix(OpTagT, LSST& lss, const math::LSS::BlockAccumulator& block_accumulator, const DataT&)
+{
+  do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator);
+}
+
+/// Add the element matrix directly to the matrix values, if the matrix supports this
+template<typename LSST, typename DataT>
+inline void do_assign_op_matrix(boost::proto::tag::plus_assign, LSST& lss, const math::LSS::BlockAccumulator& block_accumulator, const DataT& data)
+{
+  if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
+  {
+    math::LSS::ScatterMap* scatter_map = lss.scatter_map(data);
+    if(is_not_null(scatter_map))
+      scatter_map->add_values(data.support().element_idx(), block_accumulator);
+    else
+      lss.matrix().add_values(block_accumulator);
+  }
+}
+
+/// Calls prepare_scatter_map on a system matrix terminal
+struct PrepareScatterMap : boost::proto::callable
+{
+  typedef int result_type;
+
+  template<typename DataT>
+  int operator()(const LSSWrapperImpl<SystemMatrixTag>& lss, const int state, const DataT& data) const
+  {
+    lss.prepare_scatter_map(data);
+    return state;
+  }
+};
+
+/// Set up the scatter maps of all system matrices that appear in an element expression, for the elements of the data.
+/// Called by the element looper before the loop starts, so the threads that assemble the elements only read the maps
+struct PrepareScatterMaps :
+  boost::proto::or_
+  <
+    boost::proto::when
+    <
+      boost::proto::terminal< LSSWrapperImpl<SystemMatrixTag> >,
+      PrepareScatterMap(boost::proto::_value, boost::proto::_state, boost::proto::_data)
+    >,
+    boost::proto::when
+    <
+      boost::proto::terminal<boost::proto::_>,
+      boost::proto::_state
+    >,
+    boost::proto::when
+    <
+      boost::proto::nary_expr<boost::proto::_, boost::proto::vararg<boost::proto::_> >,
+      boost::proto::fold<boost::proto::_, boost::proto::_state, PrepareScatterMaps>
+    >
+  >
+{
+};
+
 /// Translate tag to operator
 inline void do_assign_op_rhs(boost::proto::tag::assign, math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator)
 {
@@ -166,7 +224,7 @@ struct BlockAssignmentOp<SystemMatrixTag, OpTagT>
         block_accumulator.mat(block_row, block_col) = rhs(row, col);
       }
     }
-    do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator);
+    do_assign_op_matrix(OpTagT(), lss, block_accumulator, data);
   }
 };
 
@@ -176,6 +234,9 @@ struct BlockAssignmentOp<SystemRHSTag, OpTagT>
   template<typename LSST, typename RhsT, typename DataT>
   void operator()(LSST& lss, const RhsT& rhs, const DataT& data) const
   {
+    if(lss.skip_rhs())
+      return;
+
     // TODO: We take some shortcuts here that assume the same shape function for every variable. Storage order for the system is i.e. uvp, uvp, ...
     static const Uint mat_size = DataT::EMatrixSizeT::value;
     detail::assert_nb_nodes<DataT::nb_lss_nodes>();
@@ -240,6 +301,9 @@ boost::proto::transform< RHSAccumulator >
     template<typename LSST, typename RhsT>
     void assign_single_variable(LSST& lss_term, const RhsT& rhs, typename impl::data_param data, const Uint var_offset) const
     {
+      if(lss_term.skip_rhs())
+        return;
+
       math::LSS::System& lss = lss_term.lss();
       // TODO: We take some shortcuts here that assume the same shape function for every variable. Storage order for the system is i.e. uvp, uvp, ...
       typedef typename boost::remove_reference<DataT>::type DataUnrefT;
@@ -27,8 +27,10 @@
 
 #include "math/VariablesDescriptor.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/ScatterMap.hpp"
 
 #include "mesh/Elements.hpp"
+#include "mesh/ElementGeometryCache.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
@@ -184,7 +186,10 @@ public:
   GeometricSupport(const mesh::Elements& elements) :
     m_coordinates(elements.geometry_fields().coordinates()),
     m_connectivity_array(elements.geometry_space().connectivity().array()),
-    m_elements(elements)
+    m_elements(elements),
+    m_geometry_cache(elements.geometry_cache().is_enabled() ? &elements.geometry_cache() : nullptr),
+    m_cached_point(nullptr),
+    m_last_cached_point(0)
   {
   }
 
@@ -192,6 +197,7 @@ public:
   void set_element(const Uint element_idx)
   {
     m_element_idx = element_idx;
+    m_cached_point = nullptr;
     const mesh::Connectivity::ConstRow row = m_connectivity_array[element_idx];
     std::copy(row.begin(), row.end(), m_connectivity.begin());
     mesh::fill(m_nodes, m_coordinates, m_connectivity);
@@ -320,6 +326,18 @@ public:
     return static_cast<Real>(!m_elements.is_ghost(m_element_idx));
   }
 
+  /// Copy the shape function gradient at the given mapped coordinates from the geometry cache.
+  /// Returns false if compute_jacobian did not find these coordinates in the cache for the current element.
+  template<typename GradientT>
+  bool cached_gradient(const typename EtypeT::MappedCoordsT& mapped_coords, GradientT& gradient) const
+  {
+    if(is_null(m_cached_point) || !m_cached_point->matches(mapped_coords))
+      return false;
+
+    m_cached_point->copy_gradient(m_element_idx, gradient);
+    return true;
+  }
+
 private:
   void compute_normal_dispatch(boost::mpl::false_, const typename EtypeT::MappedCoordsT&) const
   {
@@ -336,12 +354,52 @@ private:
 
   void compute_jacobian_dispatch(boost::mpl::true_, const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
+    if(is_not_null(m_geometry_cache))
+    {
+      m_cached_point = find_cached_point(mapped_coords);
+      if(is_not_null(m_cached_point))
+      {
+        m_jacobian_determinant = m_cached_point->determinants[m_element_idx];
+        m_cached_point->copy_jacobian(m_element_idx, m_jacobian_matrix);
+        m_cached_point->copy_jacobian_inverse(m_element_idx, m_jacobian_inverse);
+        return;
+      }
+    }
+
     EtypeT::compute_jacobian(mapped_coords, m_nodes, m_jacobian_matrix);
     bool is_invertible;
     m_jacobian_matrix.computeInverseAndDetWithCheck(m_jacobian_inverse, m_jacobian_determinant, is_invertible);
     cf3_assert(is_invertible);
   }
 
+  /// Look up the cached data for the given point, asking the cache to compute it on the first request
+  const mesh::ElementGeometryCache::PointData* find_cached_point(const typename EtypeT::MappedCoordsT& mapped_coords) const
+  {
+    // Quadrature loops visit the same points in the same order for each element, so start after the last hit
+    const Uint nb_points = m_cached_points.size();
+    for(Uint i = 0; i != nb_points; ++i)
+    {
+      const Uint point_idx = (m_last_cached_point + 1 + i) % nb_points;
+      if(m_cached_points[point_idx]->matches(mapped_coords))
+      {
+        m_last_cached_point = point_idx;
+        return m_cached_points[point_idx].get();
+      }
+    }
+
+    boost::shared_ptr<mesh::ElementGeometryCache::PointData const> point = m_geometry_cache->point<EtypeT>(mapped_coords);
+    if(!point)
+    {
+      // The cache is full, so stop looking for new points instead of locking the cache at each call
+      m_geometry_cache = nullptr;
+      return nullptr;
+    }
+
+    m_cached_points.push_back(point);
+    m_last_cached_point = nb_points;
+    return point.get();
+  }
+
   /// Stored node data
   ValueT m_nodes;
 
@@ -367,6 +425,14 @@ private:
   mutable typename EtypeT::JacobianT m_jacobian_inverse;
   mutable Real m_jacobian_determinant;
   mutable typename EtypeT::CoordsT m_normal_vector;
+
+  /// Geometric factors cached on the elements, or null if caching is disabled
+  mutable mesh::ElementGeometryCache* m_geometry_cache;
+  /// Points fetched from the cache so far, kept here to avoid locking the cache for each element
+  mutable std::vector< boost::shared_ptr<mesh::ElementGeometryCache::PointData const> > m_cached_points;
+  /// Cached data used by the last call to compute_jacobian, or null if it was computed directly
+  mutable const mesh::ElementGeometryCache::PointData* m_cached_point;
+  mutable Uint m_last_cached_point;
 };
 
 /// Helper function to find a field starting from a region
@@ -480,7 +546,15 @@ public:
   {
   }
 
-  ~EtypeTVariableData()
+  /// Take into account the modifications made through a copy of this data, used by another thread
+  void merge_sync(const EtypeTVariableData& other)
+  {
+    m_need_sync = m_need_sync || other.m_need_sync;
+  }
+
+  /// Register the field for synchronization if it was modified on any process.
+  /// This is a collective operation, called once per loop on all processes.
+  void insert_sync() const
   {
     if(common::PE::Comm::instance().is_active())
     {
@@ -630,10 +704,23 @@ private:
   void compute_values_dispatch(boost::mpl::true_, const MappedCoordsT& mapped_coords) const
   {
     compute_values_dispatch(boost::mpl::false_(), mapped_coords);
+    compute_gradient_dispatch(boost::mpl::bool_<boost::is_same<EtypeT, SupportEtypeT>::value>(), mapped_coords);
+  }
+
+  /// Gradient for a variable that uses a different shape function than the geometry
+  void compute_gradient_dispatch(boost::mpl::false_, const MappedCoordsT& mapped_coords) const
+  {
     EtypeT::SF::compute_gradient(mapped_coords, m_mapped_gradient_matrix);
     m_nabla_n.noalias() = m_support.jacobian_inverse() * m_mapped_gradient_matrix;
   }
 
+  /// Gradient for a variable that uses the geometry shape function, which may be available from the geometry cache
+  void compute_gradient_dispatch(boost::mpl::true_, const MappedCoordsT& mapped_coords) const
+  {
+    if(!m_support.cached_gradient(mapped_coords, m_nabla_n))
+      compute_gradient_dispatch(boost::mpl::false_(), mapped_coords);
+  }
+
   /// Value of the field in each element node
   ValueT m_element_values;
 
@@ -701,6 +788,15 @@ public:
     m_field_idx = element_idx + m_elements_begin;
   }
 
+  /// Element-based fields have no ghosts to synchronize
+  void merge_sync(const EtypeTVariableData&)
+  {
+  }
+
+  void insert_sync() const
+  {
+  }
+
   ValueResultT value() const
   {
     return ValueResultT(&m_field[m_field_idx][offset]);
@@ -716,7 +812,7 @@ public:
   }
 
   // Dummy types for compatibility with higher order elements
-  RealMatrix& nabla(RealMatrix mapped_coords = RealMatrix()) const
+  const RealMatrix& nabla(RealMatrix mapped_coords = RealMatrix()) const
   {
     cf3_assert(false); // should not be used
     return m_dummy_result;
@@ -778,6 +874,15 @@ public:
     m_field_idx = element_idx + m_elements_begin;
   }
 
+  /// Element-based fields have no ghosts to synchronize
+  void merge_sync(const EtypeTVariableData&)
+  {
+  }
+
+  void insert_sync() const
+  {
+  }
+
   Real& value() const
   {
     cf3_assert(m_field_idx < m_field.size());
@@ -974,6 +1079,8 @@ public:
   static const Uint nb_lss_nodes = detail::GetNbNodes<EquationDataT>::value;
 
   ElementData(VariablesT& variables, mesh::Elements& elements) :
+    scatter_map(nullptr),
+    scatter_map_owner(nullptr),
     m_variables(variables),
     m_elements(elements),
     m_support(elements),
@@ -1011,6 +1118,19 @@ public:
     boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(DeleteVariablesData(m_variables_data));
   }
 
+  /// Take into account the fields modified through other, a copy of this data used by another thread
+  void merge_sync(const ElementData& other)
+  {
+    boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(MergeSync(m_variables_data, other.m_variables_data));
+  }
+
+  /// Register the modified fields for synchronization. This is a collective operation, to be called exactly
+  /// once per loop on all processes, after merging the data of all threads.
+  void insert_sync() const
+  {
+    boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(InsertSync(m_variables_data));
+  }
+
   /// Update element index
   void set_element(const Uint element_idx)
   {
@@ -1125,6 +1245,10 @@ public:
   mutable math::LSS::BlockAccumulator block_accumulator;
   mutable bool indices_converted; // Indicate if the indices in the block accumulator have been converted to LSS indices
 
+  /// Scatter map used to assemble these elements, set up before the loop by the LSS wrapper that is given by scatter_map_owner
+  mutable math::LSS::ScatterMap* scatter_map;
+  mutable const void* scatter_map_owner;
+
 private:
   /// Variables used in the expression
   VariablesT& m_variables;
@@ -1208,6 +1332,61 @@ private:
     VariablesDataT& variables_data;
   };
 
+  /// Merge the synchronization flags of another copy of the data
+  struct MergeSync
+  {
+    MergeSync(VariablesDataT& vars_data, const VariablesDataT& other_vars_data) :
+      variables_data(vars_data),
+      other_variables_data(other_vars_data)
+    {
+    }
+
+    template<typename I>
+    void operator()(const I&)
+    {
+      apply(boost::fusion::at<I>(variables_data), boost::fusion::at<I>(other_variables_data));
+    }
+
+    void apply(const boost::mpl::void_&, const boost::mpl::void_&)
+    {
+    }
+
+    template<typename T>
+    void apply(T* d, const T* other)
+    {
+      d->merge_sync(*other);
+    }
+
+    VariablesDataT& variables_data;
+    const VariablesDataT& other_variables_data;
+  };
+
+  /// Register the modified fields for synchronization
+  struct InsertSync
+  {
+    InsertSync(const VariablesDataT& vars_data) : variables_data(vars_data)
+    {
+    }
+
+    template<typename I>
+    void operator()(const I&)
+    {
+      apply(boost::fusion::at<I>(variables_data));
+    }
+
+    void apply(const boost::mpl::void_&)
+    {
+    }
+
+    template<typename T>
+    void apply(const T* d)
+    {
+      d->insert_sync();
+    }
+
+    const VariablesDataT& variables_data;
+  };
+
   /// Set the element on each stored data item
   struct SetElement
   {
@@ -7,6 +7,12 @@
 #ifndef cf3_solver_actions_Proto_ElementLooper_hpp
 #define cf3_solver_actions_Proto_ElementLooper_hpp
 
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
 #include <boost/fusion/adapted/mpl.hpp>
 #include <boost/fusion/mpl.hpp>
@@ -20,6 +26,10 @@
 #include "ElementExpressionWrapper.hpp"
 #include "ElementGrammar.hpp"
 
+#include "common/ThreadPool.hpp"
+
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGhostClassification.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/Space.hpp"
@@ -61,7 +71,7 @@ struct CheckSameEtype
 template<typename ElementTypesT, typename ExprT, typename SupportETYPE, typename VariablesT, typename VariablesEtypesT, typename NbVarsT, typename VarIdxT>
 struct ExpressionRunner
 {
-  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems) : variables(vars), expression(expr), elements(elems), m_nb_tests(0), m_found(false) {}
+  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems, const Uint threads) : variables(vars), expression(expr), elements(elems), nb_threads(threads), m_nb_tests(0), m_found(false) {}
 
   typedef typename boost::remove_reference<typename boost::fusion::result_of::at<VariablesT, VarIdxT>::type>::type VarT;
 
@@ -90,7 +100,7 @@ struct ExpressionRunner
       NewVariablesEtypesT,
       NbVarsT,
       NextIdxT
-    >(variables, expression, elements).run();
+    >(variables, expression, elements, nb_threads).run();
   }
 
   // Chosen otherwise
@@ -142,12 +152,13 @@ struct ExpressionRunner
       NewVariablesEtypesT,
       NbVarsT,
       NextIdxT
-    >(variables, expression, elements).run();
+    >(variables, expression, elements, nb_threads).run();
   }
 
   VariablesT& variables;
   const ExprT& expression;
   mesh::Elements& elements;
+  const Uint nb_threads;
   // Number of times we tried a shape function
   mutable Uint m_nb_tests;
   mutable bool m_found;
@@ -156,17 +167,83 @@ struct ExpressionRunner
 
 
 /// Helper struct to launch execution once all shape functions have been determined
+/// If more than one thread is requested, the elements are split up into colors that have no nodes in common. Each color
+/// is then shared out over the threads, each thread working on its own copy of the element data. The result only depends
+/// on the coloring, so it is the same for any number of threads larger than one.
+/// Threaded execution requires that the expression only writes to nodal or element-based fields or to the linear system,
+/// or to Real values passed using lit(). Each thread works on its own copy of these values, initialized from the original, and
+/// the originals are left unchanged by a threaded loop. Accumulating into a literal (lit(x) += ...) is refused by
+/// check_nb_threads, since the sum would be split over the threads.
+/// If a ghost synchronization started by a previous loop is still in progress, the elements that touch no ghost nodes
+/// are processed first, and the synchronization is finished before the remaining elements are visited.
 template<typename DataT>
 struct ElementLooperImpl
 {
-  template<typename ExprT>
-  void operator()(const ExprT& expr, DataT& data, const Uint nb_elems) const
+  template<typename ExprT, typename VariablesT>
+  void operator()(const ExprT& expr, VariablesT& variables, mesh::Elements& elements, const Uint nb_threads) const
   {
-    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
-    run(WrapExpression()(expr, mapped_coords, data), data, nb_elems);
+    const bool overlap = FieldSynchronizer::instance().is_synchronizing();
+    const Uint nb_elems = elements.size();
+    if(nb_threads < 2 || nb_elems < 2)
+    {
+      DataT data(variables, elements);
+      PrepareScatterMaps()(expr, 0, data);
+      const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
+      if(overlap)
+        run_overlapped(WrapExpression()(expr, mapped_coords, data), data, elements.ghost_classification());
+      else
+        run(WrapExpression()(expr, mapped_coords, data), data, nb_elems);
+      data.insert_sync();
+      return;
+    }
+
+    // The scatter maps are set up here, so the threads only read them
+    boost::ptr_vector<DataT> thread_data;
+    for(Uint i = 0; i != nb_threads; ++i)
+    {
+      thread_data.push_back(new DataT(variables, elements));
+      PrepareScatterMaps()(expr, 0, thread_data.back());
+    }
+
+    if(overlap)
+    {
+      mesh::ElementGhostClassification& classification = elements.ghost_classification();
+      run_threads(expr, thread_data, classification.interior_colors());
+      FieldSynchronizer::instance().end_synchronize();
+      run_threads(expr, thread_data, classification.boundary_colors());
+    }
+    else
+    {
+      run_threads(expr, thread_data, elements.coloring().colors());
+    }
+
+    // Exactly one collective per variable, independent of the number of threads and elements
+    for(Uint i = 1; i != nb_threads; ++i)
+      thread_data[0].merge_sync(thread_data[i]);
+    thread_data[0].insert_sync();
   }
 
 private:
+  /// Synchronization between the threads
+  struct ThreadControl
+  {
+    ThreadControl(const Uint threads) : nb_threads(threads), barrier(threads)
+    {
+    }
+
+    /// True if an exception was caught in one of the threads
+    bool failed()
+    {
+      boost::mutex::scoped_lock lock(error_mutex);
+      return bool(error);
+    }
+
+    const Uint nb_threads;
+    boost::barrier barrier;
+    boost::mutex error_mutex;
+    boost::exception_ptr error;
+  };
+
   template<typename FilteredExprT>
   void run(const FilteredExprT& expr, DataT& data, const Uint nb_elems) const
   {
@@ -179,13 +256,94 @@ private:
       grammar(expr, elem, data);
     }
   }
+
+  /// Run the interior elements, finish the pending synchronization and then run the elements touching ghosts
+  template<typename FilteredExprT>
+  void run_overlapped(const FilteredExprT& expr, DataT& data, mesh::ElementGhostClassification& classification) const
+  {
+    run_list(expr, data, classification.interior_elements());
+    FieldSynchronizer::instance().end_synchronize();
+    run_list(expr, data, classification.boundary_elements());
+  }
+
+  template<typename FilteredExprT>
+  void run_list(const FilteredExprT& expr, DataT& data, const std::vector<Uint>& elems) const
+  {
+    ElementGrammar grammar;
+    BOOST_FOREACH(const Uint elem, elems)
+    {
+      data.set_element(elem);
+      grammar(expr, elem, data);
+    }
+  }
+
+  /// Process the given colors using one thread of the shared pool per entry in thread_data
+  template<typename ExprT>
+  void run_threads(const ExprT& expr, boost::ptr_vector<DataT>& thread_data, const std::vector< std::vector<Uint> >& colors) const
+  {
+    const Uint nb_threads = thread_data.size();
+    common::ThreadPool& pool = common::ThreadPool::shared();
+    pool.reserve(nb_threads);
+
+    ThreadControl control(nb_threads);
+    pool.run(nb_threads, boost::bind(&ElementLooperImpl::template run_thread<ExprT>, this, boost::cref(expr), boost::ref(thread_data), boost::cref(colors), _1, boost::ref(control)));
+
+    if(control.failed())
+      boost::rethrow_exception(control.error);
+  }
+
+  /// Thread entry point. The expression is wrapped separately for each thread, since the wrapper stores temporary results.
+  /// The Real values passed using lit() are also replaced by copies private to the thread, so values written by the
+  /// expression (e.g. stabilization coefficients) don't leak between threads
+  template<typename ExprT>
+  void run_thread(const ExprT& expr, boost::ptr_vector<DataT>& thread_data, const std::vector< std::vector<Uint> >& colors, const Uint thread_idx, ThreadControl& control) const
+  {
+    DataT& data = thread_data[thread_idx];
+    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords;
+    LiteralCopies literals;
+    run_colors(WrapExpression()(CopyLiterals()(expr, 0, literals), mapped_coords, data), data, colors, thread_idx, control);
+  }
+
+  template<typename FilteredExprT>
+  void run_colors(const FilteredExprT& expr, DataT& data, const std::vector< std::vector<Uint> >& colors, const Uint thread_idx, ThreadControl& control) const
+  {
+    ElementGrammar grammar;
+    const Uint nb_colors = colors.size();
+    for(Uint color = 0; color != nb_colors; ++color)
+    {
+      // After an error, keep going through the barriers so the other threads can finish
+      if(!control.failed())
+      {
+        try
+        {
+          const std::vector<Uint>& color_elems = colors[color];
+          const Uint nb_color_elems = color_elems.size();
+          const Uint begin = (nb_color_elems * thread_idx) / control.nb_threads;
+          const Uint end = (nb_color_elems * (thread_idx+1)) / control.nb_threads;
+          for(Uint i = begin; i != end; ++i)
+          {
+            const Uint elem = color_elems[i];
+            data.set_element(elem);
+            grammar(expr, elem, data);
+          }
+        }
+        catch(...)
+        {
+          boost::mutex::scoped_lock lock(control.error_mutex);
+          if(!control.error)
+            control.error = boost::current_exception();
+        }
+      }
+      control.barrier.wait();
+    }
+  }
 };
 
 /// When we recursed to the last variable, actually run the expression
 template<typename ElementTypesT, typename ExprT, typename SupportETYPE, typename VariablesT, typename VariablesEtypesT, typename NbVarsT>
 struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, VariablesEtypesT, NbVarsT, NbVarsT>
 {
-  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems) : variables(vars), expression(expr), elements(elems) {}
+  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems, const Uint threads) : variables(vars), expression(expr), elements(elems), nb_threads(threads) {}
 
   typedef ElementData<VariablesT, VariablesEtypesT, SupportETYPE, typename EquationVariables<ExprT, NbVarsT>::type> DataT;
 
@@ -197,15 +355,14 @@ struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, Variable
       INVALID_ELEMENT_EXPRESSION,
       (ElementGrammar));
 
-    DataT data(variables, elements);
-
-    ElementLooperImpl<DataT>()(expression, data, elements.size());
+    ElementLooperImpl<DataT>()(expression, variables, elements, nb_threads);
   }
 
 private:
   VariablesT& variables;
   const ExprT& expression;
   mesh::Elements& elements;
+  const Uint nb_threads;
 };
 
 /// mpl::for_each compatible functor to loop over elements, using the correct shape function for the geometry
@@ -216,10 +373,11 @@ struct ElementLooper
   // Type of a fusion vector that can contain a copy of each variable that is used in the expression
   typedef typename ExpressionProperties<ExprT>::VariablesT VariablesT;
 
-  ElementLooper(mesh::Elements& elements, const ExprT& expr, VariablesT& variables) :
+  ElementLooper(mesh::Elements& elements, const ExprT& expr, VariablesT& variables, const Uint nb_threads = 1) :
     m_elements(elements),
     m_expr(expr),
-    m_variables(variables)
+    m_variables(variables),
+    m_nb_threads(nb_threads)
   {
   }
 
@@ -253,9 +411,7 @@ struct ElementLooper
     // Verify the types match, and throw an error if non-matching fields are found
     boost::fusion::for_each(m_variables, CheckSameEtype<ETYPE>(m_elements));
 
-    DataT data(m_variables, m_elements);
-
-    ElementLooperImpl<DataT>()(m_expr, data, m_elements.size());
+    ElementLooperImpl<DataT>()(m_expr, m_variables, m_elements, m_nb_threads);
   }
 
   /// Static dispatch in case different ETYPE are possible
@@ -276,18 +432,30 @@ struct ElementLooper
       boost::mpl::vector0<>, // Start with an empty vector for the per-variable element types
       NbVarsT, // number of variables
       boost::mpl::int_<0> // Start index, as MPL integral constant
-    >(m_variables, m_expr, m_elements).run();
+    >(m_variables, m_expr, m_elements, m_nb_threads).run();
   }
 
 private:
   mesh::Elements& m_elements;
   const ExprT& m_expr;
   VariablesT& m_variables;
+  const Uint m_nb_threads;
 };
 
+/// Throw if the expression can't be run using nb_threads threads, because it accumulates into a value passed using lit()
+template<typename ExprT>
+void check_nb_threads(const Uint nb_threads)
+{
+  if(nb_threads > 1 && boost::tr1_result_of<AccumulatesInLiteral(ExprT)>::type::value)
+    throw common::SetupError(FromHere(), "Expression accumulates into a value passed using lit(), so it can't be run using more than one thread");
+}
+
+/// Loop over all elements under root_region, using nb_threads threads for each element block
 template<typename ElementTypesT, typename ExprT>
-void for_each_element(mesh::Region& root_region, const ExprT& expr)
+void for_each_element(mesh::Region& root_region, const ExprT& expr, const Uint nb_threads)
 {
+  check_nb_threads<ExprT>(nb_threads);
+
   // Store the variables
   typedef typename ExpressionProperties<ExprT>::VariablesT VariablesT;
   VariablesT vars;
@@ -298,9 +466,15 @@ void for_each_element(mesh::Region& root_region, const ExprT& expr)
   BOOST_FOREACH(mesh::Elements& elements, common::find_components_recursively<mesh::Elements>(root_region))
   {
     // We skip order 0 functions in the top-call, because first the support shape function is determined, and order 0 is not allowed there
-    boost::mpl::for_each< boost::mpl::filter_view< ElementTypesT, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypesT, ExprT>(elements, expr, vars) );
+    boost::mpl::for_each< boost::mpl::filter_view< ElementTypesT, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypesT, ExprT>(elements, expr, vars, nb_threads) );
   }
-};
+}
+
+template<typename ElementTypesT, typename ExprT>
+void for_each_element(mesh::Region& root_region, const ExprT& expr)
+{
+  for_each_element<ElementTypesT>(root_region, expr, 1);
+}
 
 } // namespace Proto
 } // namespace actions
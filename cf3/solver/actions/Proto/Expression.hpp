@@ -65,6 +65,9 @@ public:
   /// value: space library name, to indicate what kind of field is expected
   virtual void insert_field_info(std::map<std::string, std::string>& tags) const = 0;
 
+  /// Set the number of threads to use in the loop. Expressions that can't be run in parallel ignore this.
+  virtual void set_nb_threads(const Uint nb_threads) {}
+
   virtual ~Expression() {}
 };
 
@@ -246,7 +249,7 @@ class ElementsExpression : public ExpressionBase<ExprT>
   typedef ExpressionBase<ExprT> BaseT;
 public:
 
-  ElementsExpression(const ExprT& expr) : BaseT(expr)
+  ElementsExpression(const ExprT& expr) : BaseT(expr), m_nb_threads(1)
   {
   }
 
@@ -255,9 +258,18 @@ public:
     // Traverse all Elements under the region and evaluate the expression
     BOOST_FOREACH(mesh::Elements& elements, common::find_components_recursively<mesh::Elements>(region) )
     {
-      boost::mpl::for_each<boost::mpl::filter_view< ElementTypes, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypes, typename BaseT::CopiedExprT>(elements, BaseT::m_expr, BaseT::m_variables) );
+      boost::mpl::for_each<boost::mpl::filter_view< ElementTypes, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypes, typename BaseT::CopiedExprT>(elements, BaseT::m_expr, BaseT::m_variables, m_nb_threads) );
     }
   }
+
+  void set_nb_threads(const Uint nb_threads)
+  {
+    check_nb_threads<typename BaseT::CopiedExprT>(nb_threads);
+    m_nb_threads = nb_threads == 0 ? 1 : nb_threads;
+  }
+
+private:
+  Uint m_nb_threads;
 };
 
 /// Expression for looping over nodes
@@ -4,8 +4,11 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <boost/foreach.hpp>
+
 #include "common/PE/Comm.hpp"
-#include "common/List.hpp"
+
+#include "mesh/Dictionary.hpp"
 
 #include "FieldSync.hpp"
 
@@ -14,7 +17,7 @@ namespace solver {
 namespace actions {
 namespace Proto {
 
-FieldSynchronizer::FieldSynchronizer()
+FieldSynchronizer::FieldSynchronizer() : m_deferred(false)
 {
 }
 
@@ -31,6 +34,13 @@ void FieldSynchronizer::insert(mesh::Field& f, bool do_periodic_element_update)
 }
 
 void FieldSynchronizer::synchronize()
+{
+  begin_synchronize();
+  if(!m_deferred)
+    end_synchronize();
+}
+
+void FieldSynchronizer::begin_synchronize()
 {
   // Periodic update needed even in a sequential run
   for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
@@ -39,47 +49,23 @@ void FieldSynchronizer::synchronize()
       continue;
     
     mesh::Field& field = *field_it->second.first;
-    const mesh::Dictionary& dict = field.dict();
-    Handle< common::List<Uint> const > periodic_links_nodes_h(dict.get_child("periodic_links_nodes"));
-    Handle< common::List<bool> const > periodic_links_active_h(dict.get_child("periodic_links_active"));
-    if(is_not_null(periodic_links_nodes_h) && is_not_null(periodic_links_active_h))
-    {
-      const common::List<Uint>& periodic_links_nodes = *periodic_links_nodes_h;
-      const common::List<bool>& periodic_links_active = *periodic_links_active_h;
-      const Uint nb_nodes = periodic_links_nodes.size();
-      std::vector< std::vector<Uint> > inverse_periodic_links(nb_nodes);
+    const mesh::Dictionary::PeriodicInverseLinks& inverse_links = field.dict().periodic_inverse_links();
+    const Uint nb_targets = inverse_links.targets.size();
+    const Uint row_size = field.row_size();
 
-      for(Uint i = 0; i != nb_nodes; ++i)
+    for(Uint i = 0; i != nb_targets; ++i)
+    {
+      const Uint links_begin = inverse_links.offsets[i];
+      const Uint links_end = inverse_links.offsets[i+1];
+      Eigen::Map<RealVector> my_row(&field[inverse_links.targets[i]][0], row_size);
+      for(Uint j = links_begin; j != links_end; ++j)
       {
-        if(periodic_links_active[i])
-        {
-          Uint final_target_node = periodic_links_nodes[i];
-          while(periodic_links_active[final_target_node])
-          {
-            final_target_node = periodic_links_nodes[final_target_node];
-          }
-          inverse_periodic_links[final_target_node].push_back(i);
-        }
+        my_row += Eigen::Map<RealVector>(&field[inverse_links.sources[j]][0], row_size);
       }
-
-      const Uint row_size = field.row_size();
-
-      for(Uint i = 0; i != nb_nodes; ++i)
+      for(Uint j = links_begin; j != links_end; ++j)
       {
-        const std::vector<Uint>& my_links = inverse_periodic_links[i];
-        const Uint nb_links = my_links.size();
-        if(nb_links == 0)
-          continue;
-        Eigen::Map<RealVector> my_row(&field[i][0], row_size);
-        for(Uint j = 0; j != nb_links; ++j)
-        {
-          my_row += Eigen::Map<RealVector>(&field[my_links[j]][0], row_size);
-        }
-        for(Uint j = 0; j != nb_links; ++j)
-        {
-          Eigen::Map<RealVector> other_row(&field[my_links[j]][0], row_size);
-          other_row = my_row;
-        }
+        Eigen::Map<RealVector> other_row(&field[inverse_links.sources[j]][0], row_size);
+        other_row = my_row;
       }
     }
   }
@@ -88,13 +74,28 @@ void FieldSynchronizer::synchronize()
   {
     for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
     {
-      field_it->second.first->synchronize();
+      mesh::Field& field = *field_it->second.first;
+      // A field can only have one synchronization in progress
+      field.end_synchronize();
+      field.begin_synchronize();
+      m_pending_fields.push_back(field_it->second.first);
     }
   }
 
   m_fields.clear();
 }
 
+void FieldSynchronizer::end_synchronize()
+{
+  BOOST_FOREACH(const Handle<mesh::Field>& field, m_pending_fields)
+  {
+    if(is_not_null(field))
+      field->end_synchronize();
+  }
+
+  m_pending_fields.clear();
+}
+
 } // namespace Proto
 } // namespace actions
 } // namespace solver
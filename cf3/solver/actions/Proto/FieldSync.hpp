@@ -29,9 +29,24 @@ public:
   /// @param do_periodic_element_update Sum together periodic entries, i.e. after an element loop that updates nodal values
   void insert(mesh::Field& f, bool do_periodic_element_update);
 
-  /// Sync fields and clear the list
+  /// Sync fields and clear the list. If deferred synchronization is enabled, this only starts the exchange.
   void synchronize();
 
+  /// Do the periodic updates and start the parallel synchronization of the fields, without waiting for it to finish.
+  /// The list of fields to synchronize is cleared.
+  void begin_synchronize();
+
+  /// Finish all synchronizations started by begin_synchronize
+  void end_synchronize();
+
+  /// True if a synchronization was started and not yet finished
+  bool is_synchronizing() const { return !m_pending_fields.empty(); }
+
+  /// If true, synchronize only starts the exchange, so the next loop can overlap the communication with computation.
+  /// The next loop must be a proto loop, which finishes the synchronization before touching ghost nodes. ProtoAction only
+  /// enables this if the next action run by its ActionDirector is also a ProtoAction, and finishes the synchronization otherwise.
+  void set_deferred(const bool deferred) { m_deferred = deferred; }
+
 private:
   FieldSynchronizer();
 
@@ -39,6 +54,11 @@ private:
   // on each cpu.
   typedef std::map< std::string, std::pair<Handle<mesh::Field>, bool> > FieldsT;
   FieldsT m_fields;
+
+  /// Fields for which the synchronization is in progress
+  std::vector< Handle<mesh::Field> > m_pending_fields;
+
+  bool m_deferred;
 };
 
 
@@ -8,13 +8,18 @@
 #ifndef cf3_solver_actions_Proto_LSSWrapper_hpp
 #define cf3_solver_actions_Proto_LSSWrapper_hpp
 
+#include <map>
+
 #include <boost/proto/core.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "common/List.hpp"
 #include "common/Log.hpp"
 #include "common/OptionComponent.hpp"
 
+#include "math/LSS/ScatterMap.hpp"
 #include "math/LSS/System.hpp"
+#include "mesh/Elements.hpp"
 #include "mesh/Tags.hpp"
 
 /// @file
@@ -39,14 +44,16 @@ public:
   /// Construction using references to the actual component (mainly useful in utests or other non-dynamic code)
   /// Using this constructor does not use dynamic configuration through options
   LSSWrapperImpl(math::LSS::System& component) :
-    m_component( new Handle<math::LSS::System>(component.handle<math::LSS::System>()) )
+    m_component( new Handle<math::LSS::System>(component.handle<math::LSS::System>()) ),
+    m_scatter_maps(new ScatterMaps())
   {
     trigger_component();
   }
 
   /// Construction using an option that will point to the actual component.
   LSSWrapperImpl(common::Option& component_option) :
-    m_component( new Handle<math::LSS::System>() )
+    m_component( new Handle<math::LSS::System>() ),
+    m_scatter_maps(new ScatterMaps())
   {
     component_option.link_to(m_component.get()).attach_trigger(boost::bind(&LSSWrapperImpl::trigger_component, this));
     trigger_component();
@@ -99,6 +106,12 @@ public:
     data.indices_converted = true;
   }
   
+  /// True if element contributions to the RHS must be skipped, because a matrix-free matrix runs the assembly to evaluate the operator
+  bool skip_rhs() const
+  {
+    return is_not_null(m_matrix) && m_matrix->is_evaluating();
+  }
+
   int node_to_lss(const Uint node)
   {
     if(is_null(m_used_node_map))
@@ -107,7 +120,34 @@ public:
     return (*m_used_node_map)[node];
   }
 
+  /// Set up the scatter map for direct assembly of the elements in data into the matrix, and store it in data.
+  /// The map is null if the matrix does not support it or scatter assembly is disabled on the system.
+  /// Must be called by the thread that starts the element loop, before any element is assembled: the map is shared with
+  /// the threads that assemble the same elements, and these only read it
+  template<typename DataT>
+  void prepare_scatter_map(const DataT& data) const
+  {
+    data.scatter_map = DataT::nb_lss_nodes == 0 ? nullptr : setup_scatter_map(data.support().elements(), DataT::nb_lss_nodes);
+    data.scatter_map_owner = m_scatter_maps.get();
+  }
+
+  /// Scatter map stored in data by prepare_scatter_map on this wrapper or one of its copies, or null if none was prepared.
+  /// Safe to call from several threads, since it does not modify the map
+  template<typename DataT>
+  math::LSS::ScatterMap* scatter_map(const DataT& data) const
+  {
+    return data.scatter_map_owner == m_scatter_maps.get() ? data.scatter_map : nullptr;
+  }
+
 private:
+  /// Scatter maps for each set of elements, shared between copies of the wrapper
+  struct ScatterMaps
+  {
+    typedef std::pair<Handle<mesh::Elements const>, math::LSS::ScatterMap> EntryT;
+    boost::mutex mutex;
+    std::map<const mesh::Elements*, EntryT> maps;
+  };
+
   /// Points to the wrapped component, if any
   /// The shared_ptr wraps the weak_ptr so the link is always OK
   boost::shared_ptr< Handle<math::LSS::System> > m_component;
@@ -119,6 +159,29 @@ private:
   // Used in case there is no 1-to-1 mapping between the mesh nodes and the LSS indices
   common::List<Uint>* m_used_nodes;
   common::List<int>* m_used_node_map;
+
+  boost::shared_ptr<ScatterMaps> m_scatter_maps;
+
+  /// Scatter map for the given elements, set up for the current matrix
+  math::LSS::ScatterMap* setup_scatter_map(const mesh::Elements& elements, const Uint nb_nodes) const
+  {
+    boost::mutex::scoped_lock lock(m_scatter_maps->mutex);
+    if(is_null(m_matrix) || !m_cached_component->options().value<bool>("scatter_assembly"))
+    {
+      m_scatter_maps->maps.clear();
+      return nullptr;
+    }
+
+    typename ScatterMaps::EntryT& entry = m_scatter_maps->maps[&elements];
+    if(is_null(entry.first))
+    {
+      // New or deleted elements, that may have been replaced by other elements at the same address
+      entry.first = elements.handle<mesh::Elements>();
+      entry.second.clear();
+    }
+
+    return entry.second.setup(*m_matrix, elements.size(), nb_nodes) ? &entry.second : nullptr;
+  }
   
   void trigger_component()
   {
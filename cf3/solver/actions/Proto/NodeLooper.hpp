@@ -156,7 +156,7 @@ private:
       used_entities.push_back(entities.handle<mesh::Entities>());
     }
 
-    boost::shared_ptr< common::List<Uint> > used_nodes_ptr = mesh::build_used_nodes_list(used_entities, dict, false);
+    boost::shared_ptr< common::List<Uint> const > used_nodes_ptr = mesh::cached_used_nodes_list(used_entities, dict, false);
 
     const common::List<Uint>& nodes = *used_nodes_ptr;
     const Uint nb_nodes = nodes.size();
@@ -222,6 +222,9 @@ struct NodeLooper
     if(NbDimsT::value != coords.row_size())
       return;
 
+    // Node loops may access ghost nodes, so pending synchronizations must finish first
+    FieldSynchronizer::instance().end_synchronize();
+
     // Execute with known dimension
     NodeLooperDim<ExprT, NbDimsT>(m_expr, m_region, m_variables)();
 
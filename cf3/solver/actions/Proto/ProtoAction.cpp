@@ -8,7 +8,9 @@
 #include <boost/function.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 
+#include "common/ActionDirector.hpp"
 #include "common/Builder.hpp"
+#include "common/Link.hpp"
 #include "common/Log.hpp"
 #include "common/OptionComponent.hpp"
 #include "common/URI.hpp"
@@ -21,6 +23,7 @@
 
 #include "ProtoAction.hpp"
 #include "Expression.hpp"
+#include "FieldSync.hpp"
 
 namespace cf3 {
 namespace solver {
@@ -40,6 +43,42 @@ struct ProtoAction::Implementation
     m_physical_model(physical_model)
   {
     m_component.options().option(Tags::physical_model()).attach_trigger(boost::bind(&Implementation::trigger_physical_model, this));
+
+    m_component.options().add("nb_threads", 1u)
+      .pretty_name("Number of Threads")
+      .description("Number of threads to use for element loops. If more than 1, elements are processed color by color, so no two threads write to the same node at the same time. Each thread writes to its own copy of the Real values passed using lit(), and expressions that accumulate into such a value (lit(x) += ...) are refused.")
+      .attach_trigger(boost::bind(&Implementation::trigger_nb_threads, this));
+
+    m_component.options().add("overlap_synchronization", false)
+      .pretty_name("Overlap Synchronization")
+      .description("Leave the ghost synchronization of the fields modified by this action in progress when it finishes, so the next element loop can process interior elements while the data is exchanged. Only used if the next action executed by the parent ActionDirector is also a ProtoAction, so the synchronization is always finished before the end of the parent.");
+  }
+
+  /// True if the next action the parent ActionDirector executes after this one is a ProtoAction
+  bool next_action_is_proto()
+  {
+    Handle<ActionDirector> director(m_component.parent());
+    if(is_null(director))
+      return false;
+
+    bool found = false;
+    boost_foreach(Component& child, *director)
+    {
+      Handle<Action> action(follow_link(child));
+      if(is_null(action) || director->is_disabled(action->name()))
+        continue;
+      if(found)
+        return is_not_null(Handle<ProtoAction>(action));
+      found = (action.get() == &m_component);
+    }
+
+    return false;
+  }
+
+  void trigger_nb_threads()
+  {
+    if(m_expression)
+      m_expression->set_nb_threads(m_component.options().value<Uint>("nb_threads"));
   }
 
   void trigger_physical_model()
@@ -118,13 +157,31 @@ void ProtoAction::execute()
   if(m_loop_regions.empty())
     CFwarn << "No regions to loop over for action " << uri().string() << CFendl;
 
-  boost_foreach(const Handle< Region >& region, m_loop_regions)
+  // Later loops of this action also finish pending synchronizations, so deferring is safe for all regions
+  FieldSynchronizer& synchronizer = FieldSynchronizer::instance();
+  const bool deferred = options().value<bool>("overlap_synchronization") && m_implementation->next_action_is_proto();
+  synchronizer.set_deferred(deferred);
+  try
+  {
+    boost_foreach(const Handle< Region >& region, m_loop_regions)
+    {
+      if(is_null(m_implementation->m_expression))
+        throw SetupError(FromHere(), "Expression for ProtoAction " + uri().path() + " is not set.");
+      CFdebug << "  Action " << name() << ": running over region " << region->uri().path() << CFendl;
+      m_implementation->m_expression->loop(*region);
+    }
+  }
+  catch(...)
   {
-    if(is_null(m_implementation->m_expression))
-      throw SetupError(FromHere(), "Expression for ProtoAction " + uri().path() + " is not set.");
-    CFdebug << "  Action " << name() << ": running over region " << region->uri().path() << CFendl;
-    m_implementation->m_expression->loop(*region);
+    synchronizer.set_deferred(false);
+    synchronizer.end_synchronize();
+    throw;
   }
+  synchronizer.set_deferred(false);
+
+  // Finish synchronizations left in progress by an earlier action, in case none of the loops above needed the ghosts
+  if(!deferred)
+    synchronizer.end_synchronize();
 }
 
 void ProtoAction::set_expression(const boost::shared_ptr< Expression >& expression)
@@ -132,6 +189,7 @@ void ProtoAction::set_expression(const boost::shared_ptr< Expression >& expressi
   m_implementation->m_expression = expression;
   expression->add_options(options());
   m_implementation->trigger_physical_model();
+  m_implementation->trigger_nb_threads();
 }
 
 bool ProtoAction::expression_is_set() const
@@ -7,11 +7,14 @@
 #ifndef cf3_solver_actions_Proto_Transforms_hpp
 #define cf3_solver_actions_Proto_Transforms_hpp
 
+#include <map>
+
 #include <boost/accumulators/accumulators_fwd.hpp>
 
 #include <boost/fusion/container/vector/convert.hpp>
 #include <boost/mpl/copy.hpp>
 #include <boost/mpl/max.hpp>
+#include <boost/mpl/or.hpp>
 #include <boost/mpl/range_c.hpp>
 #include <boost/mpl/transform.hpp>
 #include <boost/mpl/vector_c.hpp>
@@ -328,6 +331,100 @@ struct DeepCopy : //boost::proto::functional::deep_copy
 {
 };
 
+/// True if the value stored in the terminal TerminalT is a reference to a non-const type
+template<typename TerminalT>
+struct IsModifiableReference
+{
+  typedef typename boost::remove_reference<TerminalT>::type::proto_child0 ValueT;
+  typedef boost::mpl::bool_<boost::is_reference<ValueT>::value && !boost::is_const<typename boost::remove_reference<ValueT>::type>::value> type;
+};
+
+template<typename TagT>
+class LSSWrapperImpl;
+
+/// Matches a terminal that refers to a modifiable value, as created by lit(x) for a non-const x.
+/// The linear system terminals are excluded, since threads assemble elements that don't share nodes
+struct LiteralReference :
+  boost::proto::and_
+  <
+    boost::proto::terminal<boost::proto::_>,
+    boost::proto::not_< boost::proto::terminal< LSSWrapperImpl<boost::proto::_> > >,
+    boost::proto::if_< IsModifiableReference<boost::proto::_expr>() >
+  >
+{
+};
+
+/// Evaluates to mpl::true_ if the expression accumulates into a modifiable literal, as in lit(x) += ...
+struct AccumulatesInLiteral :
+  boost::proto::or_
+  <
+    boost::proto::when
+    <
+      boost::proto::or_
+      <
+        boost::proto::plus_assign<LiteralReference, boost::proto::_>,
+        boost::proto::minus_assign<LiteralReference, boost::proto::_>,
+        boost::proto::multiplies_assign<LiteralReference, boost::proto::_>,
+        boost::proto::divides_assign<LiteralReference, boost::proto::_>
+      >,
+      boost::mpl::true_()
+    >,
+    boost::proto::when<boost::proto::terminal<boost::proto::_>, boost::mpl::false_()>,
+    boost::proto::when
+    <
+      boost::proto::nary_expr<boost::proto::_, boost::proto::vararg<boost::proto::_> >,
+      boost::proto::fold<boost::proto::_, boost::mpl::false_(), boost::mpl::or_<AccumulatesInLiteral, boost::proto::_state>()>
+    >
+  >
+{
+};
+
+/// Private copies of the Real values referred to by lit(), indexed by the address of the original
+class LiteralCopies
+{
+public:
+  /// Copy of value, initialized with value the first time it is requested
+  Real& copy(Real& value)
+  {
+    std::map<const Real*, Real>::iterator it = m_copies.find(&value);
+    if(it == m_copies.end())
+      it = m_copies.insert(std::make_pair(&value, value)).first;
+    return it->second;
+  }
+
+private:
+  std::map<const Real*, Real> m_copies;
+};
+
+/// Refer to the copy of a Real literal stored in the LiteralCopies passed as data
+struct MakeLiteralCopy : boost::proto::callable
+{
+  typedef boost::proto::terminal<Real&>::type result_type;
+
+  result_type operator()(Real& value, LiteralCopies& copies) const
+  {
+    result_type result = {copies.copy(value)};
+    return result;
+  }
+};
+
+/// Transform to copy an expression, replacing all modifiable Real literals with copies stored in the LiteralCopies passed as data.
+/// Used to give each thread its own storage for values written to by the expression, such as the coefficients computed by
+/// a function call
+struct CopyLiterals :
+  boost::proto::or_
+  <
+    boost::proto::when
+    <
+      boost::proto::terminal<Real&>,
+      MakeLiteralCopy(boost::proto::_value, boost::proto::_data)
+    >,
+    boost::proto::terminal<boost::proto::_>,
+    boost::proto::nary_expr<boost::proto::_, boost::proto::vararg< boost::proto::when<CopyLiterals, boost::proto::_byval(CopyLiterals)> > >
+  >
+{
+};
+
 /// Generic definition of result, using C++11 features
 template<typename Signature>
 struct generic_result;
@@ -6,11 +6,15 @@
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
 
 #include "common/Builder.hpp"
 #include "common/OptionList.hpp"
 #include "common/List.hpp"
 #include "common/BinaryDataReader.hpp"
+#include "common/Table.hpp"
+#include "common/PE/Comm.hpp"
 
 #include "common/XML/FileOperations.hpp"
 
@@ -38,6 +42,91 @@ common::ComponentBuilder < ReadRestartFile, common::Action, LibActions > ReadRes
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Look up the field referred to by a field node in the restart file
+Handle<mesh::Field> find_field(mesh::Mesh& mesh, const common::XML::XmlNode& field_node)
+{
+  Handle<mesh::Field> field(mesh.access_component(common::URI(field_node.attribute_value("path"), common::URI::Scheme::CPATH)));
+  if(is_null(field))
+    throw common::SetupError(FromHere(), "Field " + field_node.attribute_value("path") + " was not found in mesh " + mesh.uri().path());
+  return field;
+}
+
+/// Fill the field rows from the data written by a different number of ranks, matching rows using the dictionary global indices
+void redistribute_field(mesh::Field& field, const std::vector< boost::shared_ptr<common::BinaryDataReader> >& data_readers, const Uint field_block, const Uint glb_idx_block)
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  const Uint nb_procs = comm.size();
+  const Uint row_size = field.row_size();
+
+  // Send the rows that were read to the rank responsible for their global index
+  std::vector< std::vector<Uint> > send_glb_idx(nb_procs), recv_glb_idx;
+  std::vector< std::vector<Real> > send_values(nb_procs), recv_values;
+  boost::shared_ptr< common::List<Uint> > written_glb_idx = common::allocate_component< common::List<Uint> >("glb_idx");
+  boost::shared_ptr< common::Table<Real> > written_values = common::allocate_component< common::Table<Real> >("values");
+  BOOST_FOREACH(const boost::shared_ptr<common::BinaryDataReader>& data_reader, data_readers)
+  {
+    data_reader->read_list(*written_glb_idx, glb_idx_block);
+    data_reader->read_table(*written_values, field_block);
+    if(written_values->row_size() != row_size || written_values->size() != written_glb_idx->size())
+      throw common::SetupError(FromHere(), "Restart data for field " + field.uri().path() + " does not match the field layout");
+
+    const Uint nb_rows = written_glb_idx->size();
+    for(Uint i = 0; i != nb_rows; ++i)
+    {
+      const Uint directory = (*written_glb_idx)[i] % nb_procs;
+      send_glb_idx[directory].push_back((*written_glb_idx)[i]);
+      send_values[directory].insert(send_values[directory].end(), (*written_values)[i].begin(), (*written_values)[i].end());
+    }
+  }
+  comm.all_to_all(send_glb_idx, recv_glb_idx);
+  comm.all_to_all(send_values, recv_values);
+
+  // Rows stored on this rank, as (global index, source rank, row in the data from that rank). Ghost rows may appear more than once.
+  std::vector< boost::tuple<Uint, Uint, Uint> > directory;
+  for(Uint source = 0; source != nb_procs; ++source)
+    for(Uint i = 0; i != recv_glb_idx[source].size(); ++i)
+      directory.push_back(boost::make_tuple(recv_glb_idx[source][i], source, i));
+  std::sort(directory.begin(), directory.end());
+
+  // Ask for the rows of the local field
+  const common::List<Uint>& glb_idx = field.dict().glb_idx();
+  const Uint nb_local_rows = glb_idx.size();
+  std::vector< std::vector<Uint> > requests(nb_procs), recv_requests;
+  for(Uint i = 0; i != nb_local_rows; ++i)
+    requests[glb_idx[i] % nb_procs].push_back(glb_idx[i]);
+  comm.all_to_all(requests, recv_requests);
+
+  std::vector< std::vector<Real> > replies(nb_procs), recv_replies;
+  for(Uint requester = 0; requester != nb_procs; ++requester)
+  {
+    BOOST_FOREACH(const Uint requested_idx, recv_requests[requester])
+    {
+      const std::vector< boost::tuple<Uint, Uint, Uint> >::const_iterator found = std::lower_bound(directory.begin(), directory.end(), boost::make_tuple(requested_idx, 0u, 0u));
+      if(found == directory.end() || found->get<0>() != requested_idx)
+        throw common::SetupError(FromHere(), "Global index " + common::to_str(requested_idx) + " of field " + field.uri().path() + " is not in the restart file");
+      const std::vector<Real>& source_values = recv_values[found->get<1>()];
+      replies[requester].insert(replies[requester].end(), source_values.begin() + found->get<2>()*row_size, source_values.begin() + (found->get<2>()+1)*row_size);
+    }
+  }
+  comm.all_to_all(replies, recv_replies);
+
+  // Replies arrive in the order of the requests
+  std::vector<Uint> reply_position(nb_procs, 0);
+  for(Uint i = 0; i != nb_local_rows; ++i)
+  {
+    const Uint directory_rank = glb_idx[i] % nb_procs;
+    const Uint pos = reply_position[directory_rank]++;
+    std::copy(recv_replies[directory_rank].begin() + pos*row_size, recv_replies[directory_rank].begin() + (pos+1)*row_size, field[i].begin());
+  }
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
 ReadRestartFile::ReadRestartFile ( const std::string& name ) :
   common::Action(name)
 {  
@@ -92,20 +181,42 @@ void ReadRestartFile::execute()
     throw common::FileFormatError(FromHere(), "File  " + filepath.path() + " has unsupported version");
 
   common::PE::Comm& comm = common::PE::Comm::instance();
-  if(common::from_str<Uint>(restart_node.attribute_value("nb_procs")) != comm.size())
-    throw common::SetupError(FromHere(), "File  " + filepath.path() + " was made for " + restart_node.attribute_value("nb_procs") + " CPUs, but we are loading on " + common::to_str(comm.size()) + " CPUs");
+  const Uint nb_written_procs = common::from_str<Uint>(restart_node.attribute_value("nb_procs"));
+  const common::URI binary_file(restart_node.attribute_value("binary_file"));
 
-  boost::shared_ptr<common::BinaryDataReader> data_reader = common::allocate_component<common::BinaryDataReader>("DataReader");
-  data_reader->options().set("file", common::URI(restart_node.attribute_value("binary_file")));
+  if(nb_written_procs == comm.size())
+  {
+    boost::shared_ptr<common::BinaryDataReader> data_reader = common::allocate_component<common::BinaryDataReader>("DataReader");
+    data_reader->options().set("file", binary_file);
+
+    common::XML::XmlNode field_node = restart_node.content->first_node("field");
+    for(; field_node.is_valid(); field_node.content = field_node.content->next_sibling("field"))
+    {
+      data_reader->read_table(*detail::find_field(*mesh, field_node), common::from_str<Uint>(field_node.attribute_value("index")));
+    }
+    return;
+  }
+
+  // Different number of CPUs: each rank reads the data of some of the writing ranks, and the rows are redistributed using the global indices
+  if(!comm.is_active())
+    throw common::SetupError(FromHere(), "File  " + filepath.path() + " was made for " + restart_node.attribute_value("nb_procs") + " CPUs, but we are loading in serial");
+
+  std::vector< boost::shared_ptr<common::BinaryDataReader> > data_readers;
+  for(Uint written_rank = comm.rank(); written_rank < nb_written_procs; written_rank += comm.size())
+  {
+    boost::shared_ptr<common::BinaryDataReader> data_reader = common::allocate_component<common::BinaryDataReader>("DataReader");
+    data_reader->options().set("rank", written_rank);
+    data_reader->options().set("file", binary_file);
+    data_readers.push_back(data_reader);
+  }
 
   common::XML::XmlNode field_node = restart_node.content->first_node("field");
   for(; field_node.is_valid(); field_node.content = field_node.content->next_sibling("field"))
   {
-    Handle<mesh::Field> field(mesh->access_component(common::URI(field_node.attribute_value("path"), common::URI::Scheme::CPATH)));
-    if(is_null(field))
-      throw common::SetupError(FromHere(), "Field " + field_node.attribute_value("path") + " was not found in mesh " + mesh->uri().path());
+    if(field_node.attribute_value("glb_idx_index").empty())
+      throw common::SetupError(FromHere(), "File  " + filepath.path() + " was made for " + restart_node.attribute_value("nb_procs") + " CPUs and has no global indices, but we are loading on " + common::to_str(comm.size()) + " CPUs");
 
-    data_reader->read_table(*field, common::from_str<Uint>(field_node.attribute_value("index")));
+    detail::redistribute_field(*detail::find_field(*mesh, field_node), data_readers, common::from_str<Uint>(field_node.attribute_value("index")), common::from_str<Uint>(field_node.attribute_value("glb_idx_index")));
   }
 }
 
@@ -19,6 +19,7 @@
 #include "mesh/Dictionary.hpp"
 #include "mesh/Functions.hpp"
 #include "mesh/Mesh.hpp"
+#include "mesh/PointInterpolator.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/Space.hpp"
 
@@ -102,6 +103,9 @@ TurbulenceStatistics::TurbulenceStatistics ( const std::string& name ) :
     .pretty_name("Setup");
   
   properties().add("restart_field_tags", std::vector<std::string>(1, "turbulence_statistics"));
+
+  m_point_interpolator = create_static_component<mesh::PointInterpolator>("point_interpolator");
+  m_point_interpolator->options().set("function", std::string("cf3.mesh.ShapeFunctionInterpolation"));
 }
 
 void TurbulenceStatistics::execute()
@@ -115,7 +119,8 @@ void TurbulenceStatistics::execute()
   const mesh::Field::ArrayT& pressure_array = m_pressure_field->array();
   mesh::Field::ArrayT& means_array = m_statistics_field->array();
   const Uint stride = 2.*m_dim + m_dim-1 + m_dim-2;
-  const Uint nb_my_probes = m_probe_nodes.size();
+  const Uint nb_my_probes = m_probe_locator.nb_local_probes();
+  Real probe_velocity[3];
 
   if(m_dim == 2)
   {
@@ -138,8 +143,8 @@ void TurbulenceStatistics::execute()
     for(Uint my_probe_idx = 0; my_probe_idx != nb_my_probes; ++my_probe_idx)
     {
       const Uint probe_begin = my_probe_idx*stride;
-      const mesh::Field::ConstRow velocity = velocity_array[m_probe_nodes[my_probe_idx]];
-      const Real u = velocity[XX+m_velocity_field_offset]; const Real v = velocity[YY+m_velocity_field_offset];
+      m_probe_locator.interpolate(*m_velocity_field, my_probe_idx, m_velocity_field_offset, m_dim, probe_velocity);
+      const Real u = probe_velocity[XX]; const Real v = probe_velocity[YY];
 
       m_means[probe_begin  ](u);
       m_means[probe_begin+1](v);
@@ -179,8 +184,8 @@ void TurbulenceStatistics::execute()
     for(Uint my_probe_idx = 0; my_probe_idx != nb_my_probes; ++my_probe_idx)
     {
       const Uint probe_begin = my_probe_idx*stride;
-      const mesh::Field::ConstRow velocity = velocity_array[m_probe_nodes[my_probe_idx]];
-      const Real u = velocity[XX+m_velocity_field_offset]; const Real v = velocity[YY+m_velocity_field_offset]; const Real w = velocity[ZZ+m_velocity_field_offset];
+      m_probe_locator.interpolate(*m_velocity_field, my_probe_idx, m_velocity_field_offset, m_dim, probe_velocity);
+      const Real u = probe_velocity[XX]; const Real v = probe_velocity[YY]; const Real w = probe_velocity[ZZ];
 
       m_means[probe_begin  ](u);
       m_means[probe_begin+1](v);
@@ -230,7 +235,7 @@ void TurbulenceStatistics::execute()
 
 void TurbulenceStatistics::reset_statistics()
 {
-  const Uint nb_accs = (2.*m_dim + m_dim-1 + m_dim-2)*m_probe_nodes.size();
+  const Uint nb_accs = (2.*m_dim + m_dim-1 + m_dim-2)*m_probe_locator.nb_local_probes();
   m_means.assign(nb_accs, MeanAccT());
   m_rolling_means.assign(nb_accs, RollingAccT(boost::accumulators::tag::rolling_window::window_size = options().value<Uint>("rolling_window")));
   options().set("count", 0u);
@@ -324,60 +329,28 @@ void TurbulenceStatistics::setup()
   
   m_pressure_field_offset = m_pressure_field->var_offset( pressure_var_name );
 
-  const mesh::Field& coords = dictionary->coordinates();
-  
-  common::PE::Comm& comm = common::PE::Comm::instance();
-
   m_used_nodes = mesh::build_used_nodes_list(*region, *dictionary, true, false);
-  const int nb_probes = m_probe_locations.size();
-  std::vector<int> my_probes_found(nb_probes, 0);
-  m_probe_nodes.clear();
-  m_probe_indices.clear();
-  const common::List<Uint>::ListT& used_nodes_list = m_used_nodes->array();
-  BOOST_FOREACH(const Uint node_idx, used_nodes_list)
+
+  // Locate all probes at once, the interpolation weights are kept for the whole run
+  const Uint nb_probes = m_probe_locations.size();
+  for(Uint probe_idx = 0; probe_idx != nb_probes; ++probe_idx)
   {
-    if(dictionary->is_ghost(node_idx))
-      continue;
-    for(int probe_idx = 0; probe_idx != nb_probes; ++probe_idx)
+    if(m_probe_locations[probe_idx].size() != m_dim)
     {
-      if(m_probe_locations[probe_idx].size() != m_dim)
-      {
-        throw common::SetupError(FromHere(), "Probe coordinates of dimension " + common::to_str(m_probe_locations[probe_idx].size()) + " do not match dimension " + common::to_str(m_dim));
-      }
-      if(((RealVector::Map(&coords[node_idx][0], m_dim) - m_probe_locations[probe_idx]).array().abs() < 1e-10).all())
-      {
-        m_probe_nodes.push_back(node_idx);
-        m_probe_indices.push_back(probe_idx);
-        my_probes_found[probe_idx] = 1;
-      }
+      throw common::SetupError(FromHere(), "Probe coordinates of dimension " + common::to_str(m_probe_locations[probe_idx].size()) + " do not match dimension " + common::to_str(m_dim));
     }
   }
-
-  std::vector<int> global_probes_found(nb_probes);
-  if(comm.is_active() && nb_probes > 0)
-  {
-    comm.all_reduce(common::PE::plus(), my_probes_found, global_probes_found);
-  }
-  else
-  {
-    global_probes_found = my_probes_found;
-  }
-  for(int probe_idx = 0; probe_idx != nb_probes; ++probe_idx)
-  {
-    if(global_probes_found[probe_idx] == 0)
-      throw common::SetupError(FromHere(), "Probe " + common::to_str(probe_idx) + " has no matching node");
-    if(global_probes_found[probe_idx] > 1)
-      throw common::SetupError(FromHere(), "Probe " + common::to_str(probe_idx) + " was found on " + common::to_str(global_probes_found[probe_idx]) + " CPUs");
-  }
+  m_point_interpolator->options().set("dict", dictionary);
+  m_probe_locator.locate(*m_point_interpolator, m_probe_locations);
 
   const common::URI original_uri = options().value<common::URI>("file");
 
   // Init probe files
   m_probe_files.clear();
-  const Uint nb_my_probes = m_probe_nodes.size();
+  const Uint nb_my_probes = m_probe_locator.nb_local_probes();
   for(Uint my_idx = 0; my_idx != nb_my_probes; ++my_idx)
   {
-    const Uint probe_idx = m_probe_indices[my_idx];
+    const Uint probe_idx = m_probe_locator.probe_indices()[my_idx];
     std::string probe_path = (original_uri.base_path() / (original_uri.base_name() + "-probe-" + common::to_str(probe_idx) + original_uri.extension())).path();
 
     m_probe_files.push_back(boost::make_shared<boost::filesystem::fstream>(probe_path, std::ios_base::out));
@@ -412,7 +385,7 @@ void TurbulenceStatistics::setup()
   }
 
   // Reset statistics without changing m_count
-  const Uint nb_accs = (2.*m_dim + m_dim-1 + m_dim-2)*m_probe_nodes.size();
+  const Uint nb_accs = (2.*m_dim + m_dim-1 + m_dim-2)*m_probe_locator.nb_local_probes();
   m_means.assign(nb_accs, MeanAccT());
   m_rolling_means.assign(nb_accs, RollingAccT(boost::accumulators::tag::rolling_window::window_size = options().value<Uint>("rolling_window")));
 }
@@ -19,6 +19,7 @@
 #include "mesh/Field.hpp"
 
 #include "solver/actions/LibActions.hpp"
+#include "solver/actions/ProbeSet.hpp"
 
 /////////////////////////////////////////////////////////////////////////////////////
 
@@ -81,8 +82,9 @@ private:
   std::vector<RollingAccT> m_rolling_means;
   Uint m_count;
   std::vector<RealVector> m_probe_locations;
-  std::vector<Uint> m_probe_nodes;
-  std::vector<Uint> m_probe_indices;
+  /// Interpolation data for the probes owned by this rank
+  ProbeLocator m_probe_locator;
+  Handle<mesh::PointInterpolator> m_point_interpolator;
   std::vector< boost::shared_ptr<boost::filesystem::fstream> > m_probe_files;
 };
 
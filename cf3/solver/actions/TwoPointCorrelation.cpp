@@ -15,10 +15,10 @@
 #include "common/List.hpp"
 #include "common/PropertyList.hpp"
 #include "common/PE/Comm.hpp"
-#include <common/PE/CommPattern.hpp>
 #include "common/Signal.hpp"
 #include "common/XML/SignalOptions.hpp"
 
+#include "math/FFT.hpp"
 #include "math/VariablesDescriptor.hpp"
 
 #include "mesh/Dictionary.hpp"
@@ -62,6 +62,9 @@ struct threshold_compare
 
 TwoPointCorrelation::TwoPointCorrelation ( const std::string& name ) :
   common::Action(name),
+  m_nb_x_lines(0),
+  m_nb_y_lines(0),
+  m_writer(new AsyncFileWriter()),
   m_count(0),
   m_interval(1)
 {
@@ -99,97 +102,158 @@ TwoPointCorrelation::TwoPointCorrelation ( const std::string& name ) :
     .description("Write every interval timesteps")
     .mark_basic()
     .link_to(&m_interval);
+
+  options().add("periodic", false)
+    .pretty_name("Periodic")
+    .description("Treat both directions in the plane as periodic, averaging the correlation over all reference points using an FFT. Nodes with an active periodic link are skipped.")
+    .attach_trigger(boost::bind(&TwoPointCorrelation::trigger, this))
+    .mark_basic();
+}
+
+TwoPointCorrelation::~TwoPointCorrelation()
+{
 }
 
 void TwoPointCorrelation::execute()
 {
   setup();
   
-  const Uint nb_used_nodes = m_used_node_lids.size();
-  
   common::PE::Comm& comm = common::PE::Comm::instance();
-  if(comm.is_active() && comm.rank() == m_root)
+  const Uint nb_procs = comm.is_active() ? comm.size() : 1;
+  const Uint dim = m_field->row_size();
+  const mesh::Field::ArrayT& field_values = m_field->array();
+
+  // Send the samples to the ranks owning the lines they are on
+  std::vector< std::vector<Real> > send_values(nb_procs), recv_values;
+  for(Uint proc = 0; proc != nb_procs; ++proc)
   {
-    const Uint nb_x_gids = m_x_positions.size();
-    const Uint nb_y_gids = m_y_positions.size();
-    for(Uint i = 0; i != nb_used_nodes; ++i)
-    {
-      const Uint gid = m_used_node_y_gids[i]*nb_x_gids+m_used_node_x_gids[i];
-      m_sampled_values[gid] = m_field->array()[m_used_node_lids[i]];
-    }
+    send_values[proc].reserve((m_x_send_nodes[proc].size() + m_y_send_nodes[proc].size())*dim);
+    BOOST_FOREACH(const Uint i, m_x_send_nodes[proc])
+      send_values[proc].insert(send_values[proc].end(), field_values[m_used_node_lids[i]].begin(), field_values[m_used_node_lids[i]].end());
+    BOOST_FOREACH(const Uint i, m_y_send_nodes[proc])
+      send_values[proc].insert(send_values[proc].end(), field_values[m_used_node_lids[i]].begin(), field_values[m_used_node_lids[i]].end());
   }
+
+  if(comm.is_active())
+    comm.all_to_all(send_values, recv_values);
   else
+    recv_values.swap(send_values);
+
+  for(Uint proc = 0; proc != nb_procs; ++proc)
   {
-    for(Uint i = 0; i != nb_used_nodes; ++i)
+    std::vector<Real>::const_iterator values_it = recv_values[proc].begin();
+    BOOST_FOREACH(const Uint pos, m_x_recv_positions[proc])
+    {
+      std::copy(values_it, values_it + dim, m_x_lines.begin() + pos*dim);
+      values_it += dim;
+    }
+    BOOST_FOREACH(const Uint pos, m_y_recv_positions[proc])
     {
-      m_sampled_values[i] = m_field->array()[m_used_node_lids[i]];
+      std::copy(values_it, values_it + dim, m_y_lines.begin() + pos*dim);
+      values_it += dim;
     }
   }
-  
-  if(comm.is_active())
-    m_comm_pattern->synchronize("samples");
-  
-  if(!comm.is_active() || comm.rank() == m_root)
+
+  // Correlations for the own lines
+  const Uint nb_x_gids = m_x_positions.size();
+  const Uint nb_y_gids = m_y_positions.size();
+  const bool periodic = options().value<bool>("periodic");
+  for(Uint line = 0; line != m_nb_x_lines; ++line)
   {
-    const Uint nb_x_gids = m_x_positions.size();
-    const Uint nb_y_gids = m_y_positions.size();
-    
-    const RealMatrix old_x_sum = m_x_corr*static_cast<Real>(m_count);
-    const RealMatrix old_y_sum = m_y_corr*static_cast<Real>(m_count);
-    m_x_corr.setZero();
-    m_y_corr.setZero();
-    
-    const Uint dim = m_field->row_size();
-    
-    for(Uint i = 0; i != nb_x_gids; ++i)
+    const Real* line_values = &m_x_lines[line*nb_x_gids*dim];
+    for(Uint var = 0; var != dim; ++var)
     {
-      const RealRowVector y_ref = Eigen::Map<RealRowVector const>(&m_sampled_values[i][0], dim);
-      for(Uint j = 0; j != nb_y_gids; ++j)
+      if(periodic)
+      {
+        math::add_circular_autocorrelation(line_values + var, nb_x_gids, dim, &m_x_corr_sum(0, var));
+      }
+      else
       {
-        const Uint x_ref_gid = nb_x_gids*j;
-        Eigen::Map<RealRowVector const> mapped_x_ref(&m_sampled_values[x_ref_gid][0], dim);
-        Eigen::Map<RealRowVector const> mapped_val(&m_sampled_values[x_ref_gid + i][0], dim);
-        m_x_corr.row(i).array() += mapped_x_ref.array() * mapped_val.array();
-        m_y_corr.row(j).array() += y_ref.array() * mapped_val.array();
+        for(Uint i = 0; i != nb_x_gids; ++i)
+          m_x_corr_sum(i, var) += line_values[var] * line_values[i*dim + var];
       }
     }
-    
-    ++m_count;
-    
-    m_x_corr = (m_x_corr/static_cast<Real>(nb_y_gids) + old_x_sum) / static_cast<Real>(m_count);
-    m_y_corr = (m_y_corr/static_cast<Real>(nb_x_gids) + old_y_sum) / static_cast<Real>(m_count);
-    
-    if(m_count % m_interval == 0)
+  }
+  for(Uint line = 0; line != m_nb_y_lines; ++line)
+  {
+    const Real* line_values = &m_y_lines[line*nb_y_gids*dim];
+    for(Uint var = 0; var != dim; ++var)
     {
-      const Uint normal = options().value<Uint>("normal");
-      const Uint x_direction = (normal+1) % 3;
-      const Uint y_direction = (normal+2) % 3;
-      const Real coord = options().value<Real>("coordinate");
-      
-      const common::URI original_uri = options().value<common::URI>("file");
-      std::string rewritten_path = original_uri.path();
-      boost::algorithm::replace_all(rewritten_path, "{iteration}", common::to_str(m_count));
-      
-      boost::filesystem::fstream file(rewritten_path, std::ios::out);
-      file << "# Autocorrelation at level " << coord << " in direction " << x_direction << " for field " << m_field->descriptor().description() << "\n";
-      for(Uint i = 0; i != nb_x_gids; ++i)
+      if(periodic)
       {
-        file << m_x_positions[i];
-        for(Uint j = 0; j != dim; ++j)
-          file << "," << common::to_str(m_x_corr(i,j));
-        file << "\n";
+        math::add_circular_autocorrelation(line_values + var, nb_y_gids, dim, &m_y_corr_sum(0, var));
       }
-      file << "# Autocorrelation at level " << coord << " in direction " << y_direction << " for field " << m_field->descriptor().description() << "\n";
-      for(Uint i = 0; i != nb_y_gids; ++i)
+      else
       {
-        file << m_y_positions[i];
-        for(Uint j = 0; j != dim; ++j)
-          file << "," << common::to_str(m_y_corr(i,j));
-        file << "\n";
+        for(Uint j = 0; j != nb_y_gids; ++j)
+          m_y_corr_sum(j, var) += line_values[var] * line_values[j*dim + var];
       }
-      file.close();
     }
   }
+  
+  ++m_count;
+  
+  if(m_count % m_interval == 0)
+    write_output();
+}
+
+void TwoPointCorrelation::write_output()
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  const Uint dim = m_field->row_size();
+  const Uint nb_x_gids = m_x_positions.size();
+  const Uint nb_y_gids = m_y_positions.size();
+
+  // Reduce the partial sums of all ranks (column major, as stored in the matrices)
+  std::vector<Real> local_sums(m_x_corr_sum.data(), m_x_corr_sum.data() + m_x_corr_sum.size());
+  local_sums.insert(local_sums.end(), m_y_corr_sum.data(), m_y_corr_sum.data() + m_y_corr_sum.size());
+  std::vector<Real> global_sums;
+  if(comm.is_active())
+  {
+    comm.reduce(common::PE::plus(), local_sums, global_sums, 0);
+  }
+  else
+  {
+    global_sums = local_sums;
+  }
+
+  if(comm.rank() != 0)
+    return;
+
+  const bool periodic = options().value<bool>("periodic");
+  const Eigen::Map<RealMatrix const> x_sum(&global_sums[0], nb_x_gids, dim);
+  const Eigen::Map<RealMatrix const> y_sum(&global_sums[nb_x_gids*dim], nb_y_gids, dim);
+  const Real x_scale = 1. / (static_cast<Real>(m_count) * static_cast<Real>(nb_y_gids) * (periodic ? static_cast<Real>(nb_x_gids) : 1.));
+  const Real y_scale = 1. / (static_cast<Real>(m_count) * static_cast<Real>(nb_x_gids) * (periodic ? static_cast<Real>(nb_y_gids) : 1.));
+
+  const Uint normal = options().value<Uint>("normal");
+  const Uint x_direction = (normal+1) % 3;
+  const Uint y_direction = (normal+2) % 3;
+  const Real coord = options().value<Real>("coordinate");
+
+  const common::URI original_uri = options().value<common::URI>("file");
+  std::string rewritten_path = original_uri.path();
+  boost::algorithm::replace_all(rewritten_path, "{iteration}", common::to_str(m_count));
+
+  std::ostringstream file;
+  file << "# Autocorrelation at level " << coord << " in direction " << x_direction << " for field " << m_field->descriptor().description() << "\n";
+  for(Uint i = 0; i != nb_x_gids; ++i)
+  {
+    file << m_x_positions[i];
+    for(Uint j = 0; j != dim; ++j)
+      file << "," << common::to_str(x_sum(i,j)*x_scale);
+    file << "\n";
+  }
+  file << "# Autocorrelation at level " << coord << " in direction " << y_direction << " for field " << m_field->descriptor().description() << "\n";
+  for(Uint i = 0; i != nb_y_gids; ++i)
+  {
+    file << m_y_positions[i];
+    for(Uint j = 0; j != dim; ++j)
+      file << "," << common::to_str(y_sum(i,j)*y_scale);
+    file << "\n";
+  }
+
+  m_writer->write(rewritten_path, file.str());
 }
 
 void TwoPointCorrelation::trigger()
@@ -203,9 +267,6 @@ void TwoPointCorrelation::setup()
   if(is_not_null(m_field))
     return;
 
-  if(is_not_null(m_comm_pattern))
-    remove_component(*m_comm_pattern);
-
   m_field = options().value< Handle<mesh::Field> >("field");
   if(is_null(m_field))
     throw common::SetupError(FromHere(), "No field configured for " + uri().path());
@@ -230,21 +291,26 @@ void TwoPointCorrelation::setup()
 
   const Real threshold = options().value<Real>("threshold");
 
+  // Periodic copies of nodes on the other side of the domain must not be counted twice
+  const common::List<bool>* periodic_links_active = options().value<bool>("periodic") ? Handle<common::List<bool> const>(dict.get_child("periodic_links_active")).get() : 0;
+
   std::set<Real, detail_twopoint::threshold_compare> unique_x_coords((detail_twopoint::threshold_compare(threshold)));
   std::set<Real, detail_twopoint::threshold_compare> unique_y_coords((detail_twopoint::threshold_compare(threshold)));
-  Uint node_counter = 0;
+  m_used_node_lids.clear();
   for(Uint node_idx = 0; node_idx != nb_nodes; ++node_idx )
   {
-    if(!dict.is_ghost( node_idx ) && ::fabs(coords[node_idx][normal] - coordinate) < threshold)
+    if(!dict.is_ghost( node_idx ) && ::fabs(coords[node_idx][normal] - coordinate) < threshold && !(is_not_null(periodic_links_active) && (*periodic_links_active)[node_idx]))
     {
       unique_x_coords.insert(coords[node_idx][x_direction]);
       unique_y_coords.insert(coords[node_idx][y_direction]);
-      ++node_counter;
+      m_used_node_lids.push_back(node_idx);
     }
   }
-  const Uint nb_used_nodes = node_counter;
+  const Uint nb_used_nodes = m_used_node_lids.size();
 
   common::PE::Comm& comm = common::PE::Comm::instance();
+  const Uint nb_procs = comm.is_active() ? comm.size() : 1;
+  const Uint rank = comm.is_active() ? comm.rank() : 0;
   
   if(comm.is_active())
   {
@@ -281,75 +347,46 @@ void TwoPointCorrelation::setup()
 
   CFinfo << "Found " << m_x_positions.size() << "x" << m_y_positions.size() << " unique coordinates in direction normal to " << normal << CFendl;
   
-  m_used_node_lids.clear();
-  m_used_node_lids.reserve(nb_used_nodes);
-  m_used_node_x_gids.resize(nb_used_nodes); m_used_node_y_gids.resize(nb_used_nodes);
-  for(Uint node_idx = 0; node_idx != nb_nodes; ++node_idx )
-  {
-    if(!dict.is_ghost( node_idx ) && ::fabs(coords[node_idx][normal] - coordinate) < threshold)
-    {
-      cf3_assert(x_coords_map.find(coords[node_idx][x_direction]) != x_coords_map.end());
-      cf3_assert(y_coords_map.find(coords[node_idx][y_direction]) != y_coords_map.end());
-      
-      m_used_node_x_gids[m_used_node_lids.size()] = x_coords_map[coords[node_idx][x_direction]];
-      m_used_node_y_gids[m_used_node_lids.size()] = y_coords_map[coords[node_idx][y_direction]];
-      m_used_node_lids.push_back(node_idx);
-    }
-  }
-  
   const Uint nb_x_gids = m_x_positions.size();
   const Uint nb_y_gids = m_y_positions.size();
-  
 
-  
-  if(comm.is_active())
+  // The line in x direction with y index j and the line in y direction with x index i are owned by rank j % nb_procs and i % nb_procs
+  m_x_send_nodes.assign(nb_procs, std::vector<Uint>());
+  m_y_send_nodes.assign(nb_procs, std::vector<Uint>());
+  std::vector< std::vector<Uint> > x_send_positions(nb_procs), y_send_positions(nb_procs);
+  for(Uint i = 0; i != nb_used_nodes; ++i)
   {
-    m_root = 0;
-    std::vector< std::vector<Uint> > send_gids, recv_gids;
-    send_gids.resize(comm.size());
-    send_gids[m_root].reserve(nb_used_nodes);
-    for(Uint i = 0; i != nb_used_nodes; ++i)
-    {
-      send_gids[m_root].push_back(m_used_node_y_gids[i]*nb_x_gids+m_used_node_x_gids[i]);
-    }
-
-    comm.all_to_all(send_gids, recv_gids);
-
-    if(comm.rank() == m_root)
-    {
-      m_ranks.resize(nb_x_gids*nb_y_gids);
-      m_gids.resize(nb_x_gids*nb_y_gids);
-      for(Uint rank = 0; rank != comm.size(); ++rank)
-      {
-        BOOST_FOREACH(const Uint gid, recv_gids[rank])
-        {
-          m_gids[gid] = gid;
-          m_ranks[gid] = rank;
-        }
-      }
+    const Uint node_idx = m_used_node_lids[i];
+    cf3_assert(x_coords_map.find(coords[node_idx][x_direction]) != x_coords_map.end());
+    cf3_assert(y_coords_map.find(coords[node_idx][y_direction]) != y_coords_map.end());
+    const Uint x_gid = x_coords_map[coords[node_idx][x_direction]];
+    const Uint y_gid = y_coords_map[coords[node_idx][y_direction]];
+
+    m_x_send_nodes[y_gid % nb_procs].push_back(i);
+    x_send_positions[y_gid % nb_procs].push_back((y_gid / nb_procs)*nb_x_gids + x_gid);
+    m_y_send_nodes[x_gid % nb_procs].push_back(i);
+    y_send_positions[x_gid % nb_procs].push_back((x_gid / nb_procs)*nb_y_gids + y_gid);
+  }
 
-      m_sampled_values.resize(boost::extents[nb_x_gids*nb_y_gids][m_field->row_size()]);
-      m_x_corr.resize(nb_x_gids, m_field->row_size()); m_x_corr.setZero();
-      m_y_corr.resize(nb_y_gids, m_field->row_size()); m_y_corr.setZero();
-    }
-    else
-    {
-      m_gids = send_gids[m_root];
-      m_ranks.assign(nb_used_nodes, comm.rank());
-      m_sampled_values.resize(boost::extents[nb_used_nodes][m_field->row_size()]);
-    }
-    
-    m_comm_pattern = create_component<common::PE::CommPattern>("CommPattern");
-    m_comm_pattern->insert("gid", m_gids, 1, false);
-    m_comm_pattern->setup(Handle<common::PE::CommWrapper>(m_comm_pattern->get_child("gid")), m_ranks);
-    m_comm_pattern->insert("samples", m_sampled_values);
+  if(comm.is_active())
+  {
+    comm.all_to_all(x_send_positions, m_x_recv_positions);
+    comm.all_to_all(y_send_positions, m_y_recv_positions);
   }
   else
   {
-    m_x_corr.resize(nb_x_gids, m_field->row_size()); m_x_corr.setZero();
-    m_y_corr.resize(nb_y_gids, m_field->row_size()); m_y_corr.setZero();
-    m_sampled_values.resize(boost::extents[nb_x_gids*nb_y_gids][m_field->row_size()]);
+    m_x_recv_positions = x_send_positions;
+    m_y_recv_positions = y_send_positions;
   }
+
+  const Uint dim = m_field->row_size();
+  m_nb_x_lines = nb_y_gids > rank ? (nb_y_gids - rank + nb_procs - 1) / nb_procs : 0;
+  m_nb_y_lines = nb_x_gids > rank ? (nb_x_gids - rank + nb_procs - 1) / nb_procs : 0;
+  m_x_lines.assign(m_nb_x_lines*nb_x_gids*dim, 0.);
+  m_y_lines.assign(m_nb_y_lines*nb_y_gids*dim, 0.);
+
+  m_x_corr_sum.resize(nb_x_gids, dim); m_x_corr_sum.setZero();
+  m_y_corr_sum.resize(nb_y_gids, dim); m_y_corr_sum.setZero();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 
 #include "mesh/Field.hpp"
 
+#include "solver/actions/AsyncFileWriter.hpp"
 #include "solver/actions/LibActions.hpp"
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -28,7 +29,11 @@ namespace actions {
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-/// Compute two-point correlations in two perpendipular directions on a structured mesh
+/// Compute two-point correlations in two perpendipular directions on a structured mesh.
+/// The lines of sample points are distributed over the ranks, each rank accumulating the correlations of the lines it owns.
+/// The partial sums are only reduced when output is written, and the file is written in the background.
+/// If the periodic option is set, the correlation is averaged over all reference points along each line using an FFT,
+/// otherwise the first point of each line is the reference point.
 class solver_actions_API TwoPointCorrelation : public common::Action
 {
 public: // functions
@@ -37,7 +42,7 @@ public: // functions
   TwoPointCorrelation ( const std::string& name );
 
   /// Virtual destructor
-  virtual ~TwoPointCorrelation() {}
+  virtual ~TwoPointCorrelation();
 
   /// Get the class name
   static std::string type_name () { return "TwoPointCorrelation"; }
@@ -49,24 +54,31 @@ public: // functions
 private:
   void trigger();
   void setup();
+  void write_output();
   Handle<mesh::Field> m_field;
   
   std::vector<Uint> m_used_node_lids;
-  std::vector<Uint> m_used_node_x_gids;
-  std::vector<Uint> m_used_node_y_gids;
   std::vector<Real> m_x_positions;
   std::vector<Real> m_y_positions;
-  
-  RealMatrix m_x_corr;
-  RealMatrix m_y_corr;
 
-  Uint m_root;
-  std::vector<Uint> m_gids;
-  std::vector<Uint> m_ranks;
-  
-  common::Table<Real>::ArrayT m_sampled_values;
+  // For each rank, the used nodes to send for the lines in x and y direction
+  std::vector< std::vector<Uint> > m_x_send_nodes;
+  std::vector< std::vector<Uint> > m_y_send_nodes;
+  // For each rank, the position in the local line storage of the received values
+  std::vector< std::vector<Uint> > m_x_recv_positions;
+  std::vector< std::vector<Uint> > m_y_recv_positions;
+
+  // Sample values for the lines owned by this rank
+  std::vector<Real> m_x_lines;
+  std::vector<Real> m_y_lines;
+  Uint m_nb_x_lines;
+  Uint m_nb_y_lines;
+
+  // Correlations summed over time and the owned lines
+  RealMatrix m_x_corr_sum;
+  RealMatrix m_y_corr_sum;
 
-  Handle<common::PE::CommPattern> m_comm_pattern;
+  boost::scoped_ptr<AsyncFileWriter> m_writer;
   
   Uint m_count;
   Uint m_interval;
@@ -55,6 +55,18 @@ WriteRestartFile::WriteRestartFile ( const std::string& name ) :
     .pretty_name("Time")
     .description("Time component, used to extract timing and iteration information")
     .mark_basic();
+
+  options().add("shared_file", true)
+    .pretty_name("Shared File")
+    .description("Write the data of all ranks into a single binary file");
+
+  options().add("compress", true)
+    .pretty_name("Compress")
+    .description("Compress the binary data");
+
+  options().add("nb_threads", 1u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads used to compress the data");
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -86,6 +98,9 @@ void WriteRestartFile::execute()
   const common::URI binfile = out_file_path.base_path() / (out_file_path.base_name() + ".cfbinxml");
   boost::shared_ptr<common::BinaryDataWriter> data_writer = common::allocate_component<common::BinaryDataWriter>("DataWriter");
   data_writer->options().set("file", binfile);
+  data_writer->options().set("shared_file", options().value<bool>("shared_file"));
+  data_writer->options().set("compress", options().value<bool>("compress"));
+  data_writer->options().set("nb_threads", options().value<Uint>("nb_threads"));
   
   common::XML::XmlDoc xml_doc("1.0", "ISO-8859-1");
   common::XML::XmlNode restart_node = xml_doc.add_node("restart");
@@ -97,6 +112,9 @@ void WriteRestartFile::execute()
   restart_node.set_attribute("iteration", common::to_str(time->iter()));
   
   const std::string base_path = mesh->uri().path() + "/";
+
+  // The global indices of each dictionary allow restarting on a different number of CPUs
+  std::map<const mesh::Dictionary*, Uint> glb_idx_blocks;
   
   BOOST_FOREACH(const Handle<mesh::Field>& field, fields)
   {
@@ -106,6 +124,10 @@ void WriteRestartFile::execute()
     cf3_assert(relative_path.size() == field->uri().path().size() - base_path.size());
     field_node.set_attribute("path", relative_path);
     field_node.set_attribute("index", common::to_str(data_writer->append_data(*field)));
+    const mesh::Dictionary& dict = field->dict();
+    if(!glb_idx_blocks.count(&dict))
+      glb_idx_blocks[&dict] = data_writer->append_data(dict.glb_idx());
+    field_node.set_attribute("glb_idx_index", common::to_str(glb_idx_blocks[&dict]));
   }
 
   if(comm.rank() == 0)
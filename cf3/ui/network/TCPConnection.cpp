@@ -6,13 +6,18 @@
 
 #include <iomanip> // for std::setw()
 
+#include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include "common/StringConversion.hpp"
 
-#include "common/XML/SignalFrame.hpp"
+#include "rapidxml/rapidxml.hpp"
+
 #include "common/XML/FileOperations.hpp"
+#include "common/XML/Map.hpp"
+#include "common/XML/Protocol.hpp"
+#include "common/XML/SignalFrame.hpp"
 
 #include "ui/network/ErrorHandler.hpp"
 #include "ui/network/TCPConnection.hpp"
@@ -63,6 +68,28 @@ void TCPConnection::prepare_write_buffers( SignalArgs & args,
   // prepare the outgoing data: flush to XML and convert to string
   args.flush_maps();
 
+  // announce the sizes of the binary attachments in the document node
+  XmlNode doc_node = Protocol::goto_doc_node( *args.xml_doc.get() );
+  rapidxml::xml_attribute<>* sizes_attr = doc_node.content->first_attribute( Protocol::Tags::attr_attachment_sizes() );
+
+  m_outgoing_blocks.clear();
+
+  if( is_not_null(sizes_attr) )
+    doc_node.content->remove_attribute( sizes_attr );
+
+  if( is_not_null(args.attachments) && !args.attachments->empty() )
+  {
+    std::vector<std::string> sizes;
+
+    for( Uint i = 0 ; i < args.attachments->size() ; ++i )
+    {
+      m_outgoing_blocks.push_back( args.attachments->block(i) );
+      sizes.push_back( to_str( m_outgoing_blocks.back()->size() ) );
+    }
+
+    doc_node.set_attribute( Protocol::Tags::attr_attachment_sizes(), boost::algorithm::join(sizes, ":") );
+  }
+
   XML::to_string( *args.xml_doc.get(), m_outgoing_data );
 
   // create the header on HEADER_LENGTH characters
@@ -75,6 +102,10 @@ void TCPConnection::prepare_write_buffers( SignalArgs & args,
   // write header and data to buffers and then on the socket
   buffers.push_back( asio::buffer(m_outgoing_header) );
   buffers.push_back( asio::buffer(m_outgoing_data) );
+
+  // the attachments are sent from the blocks themselves
+  for( Uint i = 0 ; i < m_outgoing_blocks.size() ; ++i )
+    buffers.push_back( asio::buffer( *m_outgoing_blocks[i] ) );
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -125,6 +156,18 @@ void TCPConnection::parse_frame_data( SignalFrame & args, boost::system::error_c
     std::string frame( m_incoming_data, m_incoming_data_size );
 
     args = SignalFrame( cf3::common::XML::parse_string( frame ) );
+
+    // allocate the buffers of the binary attachments, if any
+    std::string sizes_str = Protocol::goto_doc_node( *args.xml_doc.get() ).attribute_value( Protocol::Tags::attr_attachment_sizes() );
+    std::vector<Uint> sizes;
+
+    m_incoming_blocks.clear();
+
+    if( !sizes_str.empty() )
+      Map::split_string( sizes_str, ":", sizes );
+
+    for( Uint i = 0 ; i < sizes.size() ; ++i )
+      m_incoming_blocks.push_back( boost::shared_ptr< std::vector<char> >( new std::vector<char>( sizes[i] ) ) );
   }
 
   catch ( cf3::common::Exception & cfe )
@@ -147,6 +190,16 @@ void TCPConnection::parse_frame_data( SignalFrame & args, boost::system::error_c
 
 //////////////////////////////////////////////////////////////////////////////
 
+void TCPConnection::store_attachments( SignalFrame & args )
+{
+  for( Uint i = 0 ; i < m_incoming_blocks.size() ; ++i )
+    args.attachments->add( m_incoming_blocks[i] );
+
+  m_incoming_blocks.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void TCPConnection::disconnect()
 {
   if( m_socket.is_open() )
@@ -7,6 +7,8 @@
 #ifndef cf3_ui_network_connection_hpp
 #define cf3_ui_network_connection_hpp
 
+#include <vector>
+
 #include <boost/asio/ip/tcp.hpp>           // TCP related classes
 #include <boost/asio/placeholders.hpp>     // for placholder::error_code
 #include <boost/asio/read.hpp>             // for async_read()
@@ -16,6 +18,8 @@
 #include <boost/tuple/tuple.hpp>           // for managing multiple callback fcts
 #include <boost/variant/get.hpp>           // for calling callback functions
 
+#include "common/XML/BinaryAttachments.hpp"
+
 #include "ui/network/LibNetwork.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -51,7 +55,10 @@ class ErrorHandler;
 /// Frames handled by this class have two main parts:
 /// @li A size-fixed header (8 bytes): contains the size in bytes of the frame
 /// data.
-/// @li Frame data: actual data that is sent, in XML format.@n@n
+/// @li Frame data: actual data that is sent, in XML format.
+/// @li Binary attachments of the frame, if any. Their sizes are given by an
+/// attribute of the XML document node, and they are sent straight from the
+/// blocks of the frame, without copy.@n@n
 ///
 /// The header is completely tansparent to the calling code and is used as a
 /// safeguard to check that all data has arrived and allocate the correct buffer
@@ -291,7 +298,41 @@ private: // functions
     if ( !error )
       parse_frame_data( args, err );
 
-    boost::get<0>( functions )( err );
+    if ( !err && !m_incoming_blocks.empty() )
+    {
+      std::vector<boost::asio::mutable_buffer> buffers;
+
+      for( std::size_t i = 0 ; i < m_incoming_blocks.size() ; ++i )
+        buffers.push_back( boost::asio::buffer( *m_incoming_blocks[i] ) );
+
+      // initiate an async read to get the binary attachments
+      boost::asio::async_read( m_socket,
+                               buffers,
+                               boost::bind( &TCPConnection::callback_attachments_read<HANDLER>,
+                                            shared_from_this(),
+                                            boost::ref( args ),
+                                            boost::asio::placeholders::error,
+                                            functions
+                                          )
+                             );
+    }
+    else
+      boost::get<0>( functions )( err );
+  }
+
+  /// @brief Function called when the binary attachments have been read.
+  /// @param args The frame the attachments are added to.
+  /// @param error Error code, if any.
+  /// @param functions Callback function
+  template< typename HANDLER >
+  void callback_attachments_read( common::XML::SignalFrame & args,
+                                  const boost::system::error_code & error,
+                                  boost::tuple<HANDLER> functions )
+  {
+    if ( !error )
+      store_attachments( args );
+
+    boost::get<0>( functions )( error );
   }
 
 private: // functions
@@ -303,7 +344,8 @@ private: // functions
   /// @brief Builds the data to be sent on the network.
   /// @param args XML data. @c flush_maps() is called before converting to string.
   /// @param buffer Data buffer. First item is the header and second item is
-  /// the frame data. Vector is cleared before first use.
+  /// the frame data, followed by the binary attachments. Vector is cleared
+  /// before first use.
   void prepare_write_buffers( common::XML::SignalFrame & args,
                               std::vector<boost::asio::const_buffer> & buffers );
 
@@ -313,10 +355,15 @@ private: // functions
   void process_header ( boost::system::error_code & error );
 
   /// @brief Parses frame data from string to XML.
+  /// Allocates the buffers for the binary attachments announced by the document.
   /// @param args Object where the parsed XML will be written.
   void parse_frame_data ( common::XML::SignalFrame & args,
                           boost::system::error_code & error);
 
+  /// @brief Moves the received binary attachments to the frame.
+  /// @param args The frame the attachments are added to.
+  void store_attachments ( common::XML::SignalFrame & args );
+
   /// @brief Notifies an error if an error handler has been set.
   /// @param message Error message.
   void notify_error( const std::string & message ) const;
@@ -332,6 +379,9 @@ private: // data
   /// Buffer for outgoing header
   std::string m_outgoing_header;
 
+  /// Binary attachments being sent, kept alive until the write is finished
+  std::vector<common::XML::BinaryAttachments::Block> m_outgoing_blocks;
+
   /// Nameless enum for header length
   enum { HEADER_LENGTH = 8 };
 
@@ -346,6 +396,9 @@ private: // data
   /// @c m_incoming_data_size.
   char * m_incoming_data;
 
+  /// Buffers for the binary attachments being received.
+  std::vector< boost::shared_ptr< std::vector<char> > > m_incoming_blocks;
+
   /// Weak pointer to the error handler.
   boost::weak_ptr<ErrorHandler> m_error_handler;
 
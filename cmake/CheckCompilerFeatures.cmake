@@ -293,6 +293,14 @@ include(CheckNullPtr)
 
   check_function_exists(gettimeofday  CF3_HAVE_GETTIMEOFDAY)
 
+#######################################################################################
+
+  # check for hardware performance counters through perf_event_open (Linux)
+
+  check_include_file(linux/perf_event.h CF3_HAVE_PERF_EVENT)
+
+  coolfluid_log_file( "+++++  Checking for the Linux perf_event.h header -- ${CF3_HAVE_PERF_EVENT}" )
+
 #######################################################################################
 # Win32 specific
 #######################################################################################
@@ -102,13 +102,13 @@ LSSAction::LSSAction(const std::string& name) :
     .pretty_name("Blocked System")
     .description("Store the linear system internally as a set of blocks grouped per variable, rather than keeping the variables per node");
 
-  options().add("matrix_builder", "cf3.math.LSS.TrilinosFEVbrMatrix")
+  options().add("matrix_builder", math::LSS::System::default_matrix_builder())
     .pretty_name("Matrix Builder")
     .description("Builder to use when creating the LSS")
     .attach_trigger(boost::bind(&LSSAction::create_lss, this))
     .mark_basic();
 
-  options().add("solution_strategy", "cf3.math.LSS.TrilinosStratimikosStrategy")
+  options().add("solution_strategy", math::LSS::System::default_solution_strategy())
     .pretty_name("Solution Strategy")
     .description("Builder to use when creating the initial LSS solution strategy")
     .attach_trigger(boost::bind(&LSSAction::create_lss, this))
@@ -152,6 +152,15 @@ LSS::System& LSSAction::create_lss()
   return *lss;
 }
 
+void LSSAction::destroy_lss()
+{
+  if(is_not_null(m_implementation->m_lss) && m_implementation->m_lss->is_created())
+  {
+    CFdebug << "Destroying LSS for " << uri().path() << CFendl;
+    m_implementation->m_lss->destroy();
+  }
+}
+
 void LSSAction::signal_create_lss(SignalArgs& node)
 {
   LSS::System& lss = create_lss();
@@ -216,6 +225,13 @@ void LSSAction::on_regions_set()
 
     CFdebug << "Creating LSS for " << uri().path() << " using dictionary " << m_dictionary->uri().path() << CFendl;
 
+    // Remove the numbering of a previously destroyed system
+    for(const std::string name : {"GIDs", "Ranks", "used_node_map"})
+    {
+      if(is_not_null(m_implementation->m_lss->get_child(name)))
+        m_implementation->m_lss->remove_component(name);
+    }
+
     Handle< List<Uint> > gids = m_implementation->m_lss->create_component< List<Uint> >("GIDs");
     Handle< List<Uint> > ranks = m_implementation->m_lss->create_component< List<Uint> >("Ranks");
     Handle< List<int> > used_node_map = m_implementation->m_lss->create_component< List<int> >("used_node_map");
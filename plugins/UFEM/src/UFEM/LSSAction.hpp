@@ -59,6 +59,10 @@ public: // functions
   /// Create the LSS to use
   math::LSS::System& create_lss();
 
+  /// Deallocate the matrix and vectors of the LSS, so they are recreated with a new sparsity and comm pattern
+  /// at the next execution. Needed when the mesh topology or its distribution over the processes changed.
+  void destroy_lss();
+
   /// Access to the tag this component uses for finding its solution field
   std::string solution_tag();
 
@@ -33,6 +33,7 @@
 #include "physics/PhysModel.hpp"
 
 #include "InitialConditions.hpp"
+#include "LSSAction.hpp"
 #include "Solver.hpp"
 #include "SparsityBuilder.hpp"
 #include "Tags.hpp"
@@ -346,6 +347,12 @@ void Solver::mesh_loaded(mesh::Mesh& mesh)
 void Solver::mesh_changed(Mesh& mesh)
 {
   m_need_field_creation = true;
+
+  // The sparsity and comm pattern of the linear systems refer to the old topology, so recreate them on the next execution
+  BOOST_FOREACH(LSSAction& lss_action, find_components_recursively<LSSAction>(*this))
+  {
+    lss_action.destroy_lss();
+  }
 }
 
 void Solver::on_variables_added_event(SignalArgs& args)
@@ -4,6 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <set>
 
 #include "common/FindComponents.hpp"
@@ -28,17 +29,50 @@ using namespace mesh;
 
 ////////////////////////////////////////////////////////////////////////////////
 
-boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<int>& used_node_map)
+namespace detail
 {
-  // Get some data from the dictionary
-  const Uint nb_global_nodes = dictionary.size();
-  const List<Uint>& dict_gid = dictionary.glb_idx();
-  const List<Uint>& dict_rank = dictionary.rank();
 
-  const Uint my_rank = PE::Comm::instance().rank();
-  const Uint nb_procs = PE::Comm::instance().size();
+/// Fill the node connectivity of the used entities, in the numbering given by used_node_map
+void fill_node_connectivity(const std::vector< Handle<Entities const> >& used_entities, const Dictionary& dictionary, const List<int>& used_node_map, const Uint nb_used_nodes, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices)
+{
+  std::vector< std::set<Uint> > connectivity_sets(nb_used_nodes);
+  start_indices.assign(nb_used_nodes+1, 0);
 
-  // Build a list of used entities
+  // Determine the number of connected nodes for each element
+  BOOST_FOREACH(const Handle<Entities const>& elements, used_entities)
+  {
+    const Connectivity& connectivity = elements->space(dictionary).connectivity();
+    const Uint nb_elems = connectivity.size();
+    const Uint nb_elem_nodes = connectivity.row_size();
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      BOOST_FOREACH(const Uint node_a, connectivity[elem])
+      {
+        BOOST_FOREACH(const Uint node_b, connectivity[elem])
+        {
+          connectivity_sets[used_node_map[node_a]].insert(used_node_map[node_b]);
+        }
+      }
+    }
+  }
+
+  // Sum the number of connected nodes to get the real start indices
+  const Uint start_indices_end = start_indices.size();
+  for(Uint i = 1; i != start_indices_end; ++i)
+  {
+    start_indices[i] = connectivity_sets[i-1].size() + start_indices[i-1];
+  }
+
+  node_connectivity.reserve(start_indices.back());
+  for(Uint node = 0; node != nb_used_nodes; ++node)
+  {
+    node_connectivity.insert(node_connectivity.begin() + start_indices[node], connectivity_sets[node].begin(), connectivity_sets[node].end());
+  }
+}
+
+/// Volume entities in the given regions
+std::vector< Handle<Entities const> > volume_entities(const std::vector< Handle<Region> >& regions)
+{
   std::vector< Handle<Entities const> > used_entities;
   BOOST_FOREACH(const Handle<Region>& region, regions)
   {
@@ -47,6 +81,23 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
       used_entities.push_back(entities.handle<Entities>());
     }
   }
+  return used_entities;
+}
+
+} // detail
+
+boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<int>& used_node_map)
+{
+  // Get some data from the dictionary
+  const Uint nb_global_nodes = dictionary.size();
+  const List<Uint>& dict_gid = dictionary.glb_idx();
+  const List<Uint>& dict_rank = dictionary.rank();
+
+  const Uint my_rank = PE::Comm::instance().rank();
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  // Build a list of used entities
+  const std::vector< Handle<Entities const> > used_entities = detail::volume_entities(regions);
 
   // Build used node list, together with a mapping from old node ID to ID in the node list, as well as the new GIDs
   boost::shared_ptr< List<Uint> > used_nodes_ptr = build_used_nodes_list(used_entities, dictionary, true);
@@ -154,43 +205,18 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     }
   }
 
-  std::vector< std::set<Uint> > connectivity_sets(nb_used_nodes);
-  start_indices.assign(nb_used_nodes+1, 0);
-
-  // Determine the number of connected nodes for each element
-  BOOST_FOREACH(const Handle<Entities const>& elements, used_entities)
-  {
-    const Connectivity& connectivity = elements->space(dictionary).connectivity();
-    const Uint nb_elems = connectivity.size();
-    const Uint nb_elem_nodes = connectivity.row_size();
-    for(Uint elem = 0; elem != nb_elems; ++elem)
-    {
-      BOOST_FOREACH(const Uint node_a, connectivity[elem])
-      {
-        BOOST_FOREACH(const Uint node_b, connectivity[elem])
-        {
-          connectivity_sets[used_node_map[node_a]].insert(used_node_map[node_b]);
-        }
-      }
-    }
-  }
-
-  // Sum the number of connected nodes to get the real start indices
-  const Uint start_indices_end = start_indices.size();
-  for(Uint i = 1; i != start_indices_end; ++i)
-  {
-    start_indices[i] = connectivity_sets[i-1].size() + start_indices[i-1];
-  }
-
-  node_connectivity.reserve(start_indices.back());
-  for(Uint node = 0; node != nb_used_nodes; ++node)
-  {
-    node_connectivity.insert(node_connectivity.begin() + start_indices[node], connectivity_sets[node].begin(), connectivity_sets[node].end());
-  }
+  detail::fill_node_connectivity(used_entities, dictionary, used_node_map, nb_used_nodes, node_connectivity, start_indices);
 
   return used_nodes_ptr;
 }
 
+void build_node_connectivity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, const List<int>& used_node_map, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices)
+{
+  // The used node map is -1 for unused nodes, so the number of used nodes is one more than its maximum
+  const Uint nb_used_nodes = used_node_map.size() == 0 ? 0 : static_cast<Uint>(*std::max_element(used_node_map.array().begin(), used_node_map.array().end()) + 1);
+  node_connectivity.clear();
+  detail::fill_node_connectivity(detail::volume_entities(regions), dictionary, used_node_map, nb_used_nodes, node_connectivity, start_indices);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
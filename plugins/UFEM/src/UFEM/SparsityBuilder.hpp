@@ -30,6 +30,10 @@ namespace UFEM {
 /// Size is number of nodes + 1, so the last item is the size of node_connectivity
 UFEM_API boost::shared_ptr< common::List< Uint > > build_sparsity(const std::vector< Handle<mesh::Region> >& regions, const mesh::Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, common::List<Uint>& gids, common::List<Uint>& ranks, common::List<int>& used_node_map);
 
+/// Build the node connectivity of the volume elements in the given regions, numbered according to a used_node_map obtained from build_sparsity.
+/// The result is in the same format as for build_sparsity.
+UFEM_API void build_node_connectivity(const std::vector< Handle<mesh::Region> >& regions, const mesh::Dictionary& dictionary, const common::List<int>& used_node_map, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices);
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 } // UFEM
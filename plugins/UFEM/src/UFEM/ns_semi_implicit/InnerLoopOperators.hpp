@@ -0,0 +1,284 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_UFEM_InnerLoopOperators_hpp
+#define cf3_UFEM_InnerLoopOperators_hpp
+
+#include <boost/noncopyable.hpp>
+
+#include "common/List.hpp"
+
+#include "mesh/Integrators/Gauss.hpp"
+#include "mesh/LagrangeP1/Tetra3D.hpp"
+#include "mesh/LagrangeP1/Triag2D.hpp"
+
+#include "solver/actions/Proto/ElementOperations.hpp"
+
+#include "SparseOperator.hpp"
+
+namespace cf3 {
+namespace UFEM {
+
+/// Helper to detemine the appropriate default integration order
+template<typename ElementT>
+struct IntegralOrder
+{
+  const static int value = 2;
+};
+
+/// Triangles get order 1
+template<>
+struct IntegralOrder<mesh::LagrangeP1::Triag2D>
+{
+  const static int value = 1;
+};
+
+/// Tetrahedra get order 1
+template<>
+struct IntegralOrder<mesh::LagrangeP1::Tetra3D>
+{
+  const static int value = 1;
+};
+
+/// The operators that make up the right hand sides of the inner loop of the semi-implicit Navier-Stokes solver.
+/// None of them depend on the inner loop unknowns, so they are assembled once per time step and the inner iterations
+/// only need to multiply them with the current vectors:
+/// - velocity RHS: u_mass*a + u_visc*(dt*(1-theta)*a - u) + grad*((1-theta)*delta_p_sum - p) + constant terms
+/// - pressure RHS: p_u*(u + dt*delta_a) + p_a*(a + delta_a) + p_p*p
+/// - Aup*delta_p: theta*grad*delta_p
+struct InnerLoopOperators : boost::noncopyable
+{
+  /// Mass matrix, including the SUPG part, applied to each velocity component separately
+  SparseOperator u_mass;
+  /// Viscous, advection, skew-symmetric and bulk viscosity terms
+  SparseOperator u_visc;
+  /// Pressure gradient, including the SUPG part
+  SparseOperator grad;
+  /// Divergence and PSPG advection terms of the pressure equation
+  SparseOperator p_u;
+  /// PSPG acceleration term of the pressure equation
+  SparseOperator p_a;
+  /// PSPG pressure laplacian
+  SparseOperator p_p;
+
+  /// Create the operators for the given node connectivity, for a problem of dimension dim
+  void create(const boost::shared_ptr< const std::vector<Uint> >& node_connectivity, const boost::shared_ptr< const std::vector<Uint> >& starting_indices, const Uint dim)
+  {
+    u_mass.create(node_connectivity, starting_indices, 1, 1);
+    u_visc.create(node_connectivity, starting_indices, dim, dim);
+    grad.create(node_connectivity, starting_indices, dim, 1);
+    p_u.create(node_connectivity, starting_indices, 1, dim);
+    p_a.create(node_connectivity, starting_indices, 1, dim);
+    p_p.create(node_connectivity, starting_indices, 1, 1);
+  }
+
+  bool is_created() const
+  {
+    return u_mass.is_created();
+  }
+
+  /// Zero all operators
+  void reset()
+  {
+    u_mass.reset();
+    u_visc.reset();
+    grad.reset();
+    p_u.reset();
+    p_a.reset();
+    p_p.reset();
+  }
+
+  /// Convert the geometric connectivity of the element to LSS indices
+  template<typename SupportT>
+  void lss_indices(const SupportT& support, Uint* indices) const
+  {
+    cf3_assert(is_not_null(used_node_map));
+    const Uint nb_nodes = SupportT::EtypeT::nb_nodes;
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      indices[i] = (*used_node_map)[support.element_connectivity()[i]];
+    }
+  }
+
+  /// Map from the geometry nodes to the LSS indices
+  const common::List<int>* used_node_map;
+};
+
+/// Assemble the velocity operators of the inner loop, using the stabilization coefficients for the advection velocity
+struct VelocityOperatorsImpl
+{
+  typedef void result_type;
+
+  VelocityOperatorsImpl() : operators(nullptr)
+  {
+  }
+
+  template<typename UT, typename NUT>
+  void operator()(const UT& u, const NUT& nu_eff, const Real& tau_su, const Real& tau_bulk) const
+  {
+    typedef typename UT::EtypeT ElementT;
+
+    static const Uint nb_nodes = ElementT::nb_nodes;
+    static const Uint dim = ElementT::dimension;
+
+    typedef Eigen::Matrix<Real, nb_nodes, nb_nodes> NodeMatrixT;
+
+    Eigen::Matrix<Real, 1, nb_nodes> adv;
+    Eigen::Matrix<Real, 1, nb_nodes> N_plus_adv;
+    NodeMatrixT mass;
+    NodeMatrixT block;
+    Eigen::Matrix<Real, nb_nodes*dim, nb_nodes*dim> visc;
+    Eigen::Matrix<Real, nb_nodes*dim, nb_nodes> grad;
+
+    mass.setZero();
+    visc.setZero();
+    grad.setZero();
+
+    // Mass, advection and skew symmetric terms are always second order
+    typedef mesh::Integrators::GaussMappedCoords<2, ElementT::shape> Gauss2T;
+    for(Uint gauss_idx = 0; gauss_idx != Gauss2T::nb_points; ++gauss_idx)
+    {
+      // This precomputes the required matrix operators
+      u.support().compute_shape_functions(Gauss2T::instance().coords.col(gauss_idx));
+      u.support().compute_jacobian(Gauss2T::instance().coords.col(gauss_idx));
+      u.compute_values(Gauss2T::instance().coords.col(gauss_idx));
+
+      const Real w = Gauss2T::instance().weights[gauss_idx] * u.support().jacobian_determinant();
+
+      adv = u.eval() * u.nabla(); // advection operator
+      N_plus_adv = tau_su*adv + u.shape_function();
+
+      mass -= (w * N_plus_adv.transpose()) * u.shape_function();
+      block = (w * N_plus_adv.transpose()) * adv;
+      for(Uint i = 0; i != dim; ++i)
+      {
+        visc.template block<nb_nodes, nb_nodes>(i*nb_nodes, i*nb_nodes) += block;
+        for(Uint j = 0; j != dim; ++j)
+        {
+          visc.template block<nb_nodes, nb_nodes>(i*nb_nodes, j*nb_nodes) += (0.5 * w * u.eval()[i] * N_plus_adv.transpose()) * u.nabla().row(j);
+        }
+      }
+    }
+
+    typedef mesh::Integrators::GaussMappedCoords<IntegralOrder<ElementT>::value, ElementT::shape> GaussT;
+    for(Uint gauss_idx = 0; gauss_idx != GaussT::nb_points; ++gauss_idx)
+    {
+      // This precomputes the required matrix operators
+      u.support().compute_shape_functions(GaussT::instance().coords.col(gauss_idx));
+      u.support().compute_jacobian(GaussT::instance().coords.col(gauss_idx));
+      u.compute_values(GaussT::instance().coords.col(gauss_idx));
+      nu_eff.compute_values(GaussT::instance().coords.col(gauss_idx));
+
+      const Real w = GaussT::instance().weights[gauss_idx] * u.support().jacobian_determinant();
+      const Real bulk_w = w * tau_bulk;
+
+      adv = (w * tau_su) * (u.eval() * u.nabla()); // advection operator
+      block = (w * nu_eff.eval()) * (u.nabla().transpose() * u.nabla()); // laplacian operator
+      for(Uint i = 0; i != dim; ++i)
+      {
+        visc.template block<nb_nodes, nb_nodes>(i*nb_nodes, i*nb_nodes) += block;
+        for(Uint j = 0; j != dim; ++j)
+        {
+          visc.template block<nb_nodes, nb_nodes>(i*nb_nodes, j*nb_nodes) += (bulk_w * u.nabla().row(i).transpose()) * u.nabla().row(j);
+        }
+        grad.template block<nb_nodes, nb_nodes>(i*nb_nodes, 0) += adv.transpose() * u.nabla().row(i) - (w * u.nabla().row(i).transpose()) * u.shape_function();
+      }
+    }
+
+    Uint indices[nb_nodes];
+    operators->lss_indices(u.support(), indices);
+    operators->u_mass.add_element(indices, nb_nodes, mass);
+    operators->u_visc.add_element(indices, nb_nodes, visc);
+    operators->grad.add_element(indices, nb_nodes, grad);
+  }
+
+  InnerLoopOperators* operators;
+};
+
+/// Assemble the pressure operators of the inner loop, using the PSPG coefficient tau_ps
+struct PressureOperatorsImpl
+{
+  typedef void result_type;
+
+  PressureOperatorsImpl() : operators(nullptr)
+  {
+  }
+
+  template<typename UT>
+  void operator()(const UT& u, const Real& tau_ps) const
+  {
+    typedef typename UT::EtypeT ElementT;
+
+    static const Uint nb_nodes = ElementT::nb_nodes;
+    static const Uint dim = ElementT::dimension;
+
+    Eigen::Matrix<Real, 1, nb_nodes> adv;
+    Eigen::Matrix<Real, nb_nodes, nb_nodes*dim> p_u;
+    Eigen::Matrix<Real, nb_nodes, nb_nodes*dim> p_a;
+    Eigen::Matrix<Real, nb_nodes, nb_nodes> p_p;
+
+    p_u.setZero();
+    p_a.setZero();
+    p_p.setZero();
+
+    typedef mesh::Integrators::GaussMappedCoords<IntegralOrder<ElementT>::value, ElementT::shape> GaussT;
+    for(Uint gauss_idx = 0; gauss_idx != GaussT::nb_points; ++gauss_idx)
+    {
+      // This precomputes the required matrix operators
+      u.support().compute_shape_functions(GaussT::instance().coords.col(gauss_idx));
+      u.support().compute_jacobian(GaussT::instance().coords.col(gauss_idx));
+      u.compute_values(GaussT::instance().coords.col(gauss_idx));
+
+      const Real w = GaussT::instance().weights[gauss_idx] * u.support().jacobian_determinant();
+      const Real tau_w = w*tau_ps;
+
+      adv = tau_ps*u.eval() * u.nabla(); // advection operator
+      p_p -= (tau_w * u.nabla().transpose()) * u.nabla();
+      for(Uint i = 0; i != dim; ++i)
+      {
+        p_u.template block<nb_nodes, nb_nodes>(0, i*nb_nodes) -= (w * (u.shape_function() + 0.5*adv).transpose()) * u.nabla().row(i) + (w * u.nabla().row(i).transpose()) * adv;
+        p_a.template block<nb_nodes, nb_nodes>(0, i*nb_nodes) -= (tau_w * u.nabla().row(i).transpose()) * u.shape_function();
+      }
+    }
+
+    Uint indices[nb_nodes];
+    operators->lss_indices(u.support(), indices);
+    operators->p_u.add_element(indices, nb_nodes, p_u);
+    operators->p_a.add_element(indices, nb_nodes, p_a);
+    operators->p_p.add_element(indices, nb_nodes, p_p);
+  }
+
+  InnerLoopOperators* operators;
+};
+
+/// Groups the inner loop operators with the proto terminals that assemble them
+struct AssembleInnerLoopOperators
+{
+  AssembleInnerLoopOperators() :
+    velocity(boost::proto::as_child(velocity_data)),
+    pressure(boost::proto::as_child(pressure_data))
+  {
+    velocity_data.op.operators = &operators;
+    pressure_data.op.operators = &operators;
+    operators.used_node_map = nullptr;
+  }
+
+  InnerLoopOperators operators;
+
+  // Stores the operators
+  solver::actions::Proto::MakeSFOp<VelocityOperatorsImpl>::stored_type velocity_data;
+  solver::actions::Proto::MakeSFOp<PressureOperatorsImpl>::stored_type pressure_data;
+
+  // Use as velocity(advection_velocity_field, nu_eff_field, tau_su, tau_bulk)
+  solver::actions::Proto::MakeSFOp<VelocityOperatorsImpl>::reference_type velocity;
+  // Use as pressure(advection_velocity_field, tau_ps)
+  solver::actions::Proto::MakeSFOp<PressureOperatorsImpl>::reference_type pressure;
+};
+
+} // UFEM
+} // cf3
+
+#endif // cf3_UFEM_InnerLoopOperators_hpp
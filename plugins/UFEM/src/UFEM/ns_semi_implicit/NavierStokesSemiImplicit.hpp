@@ -16,7 +16,7 @@
 
 #include "../SUPG.hpp"
 
-#include "LSSVectorOps.hpp"
+#include "InnerLoopOperators.hpp"
 
 namespace cf3 {
 namespace UFEM {
@@ -76,13 +76,6 @@ private:
   /// Effective viscosity field
   FieldVariable<6, ScalarField> nu_eff;
   
-  SFOp< CustomSFOp<VectorLSSVector> > u_vec;
-  SFOp< CustomSFOp<ScalarLSSVector> > p_vec;
-  SFOp< CustomSFOp<VectorLSSVector> > a;
-  SFOp< CustomSFOp<VectorLSSVector> > delta_a;
-  SFOp< CustomSFOp<ScalarLSSVector> > delta_p;
-  SFOp< CustomSFOp<ScalarLSSVector> > delta_p_sum;
-  
   /// Access to the physics
   PhysicsConstant nu;
 
@@ -112,6 +105,9 @@ private:
   Handle<solver::Time> m_time;
 
   ComputeTau compute_tau;
+
+  /// Operators used in the inner loop, assembled once per time step
+  AssembleInnerLoopOperators assemble_operators;
 };
 
 } // UFEM
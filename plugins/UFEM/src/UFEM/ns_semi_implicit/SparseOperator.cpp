@@ -0,0 +1,123 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/BasicExceptions.hpp"
+
+#include "SparseOperator.hpp"
+
+namespace cf3 {
+namespace UFEM {
+
+SparseOperator::SparseOperator() :
+  m_nb_row_eqs(0),
+  m_nb_col_eqs(0),
+  m_block_size(0)
+{
+}
+
+void SparseOperator::create(const boost::shared_ptr< const std::vector<Uint> >& node_connectivity, const boost::shared_ptr< const std::vector<Uint> >& starting_indices, const Uint nb_row_eqs, const Uint nb_col_eqs)
+{
+  cf3_assert(!starting_indices->empty());
+  cf3_assert(starting_indices->back() == node_connectivity->size());
+  m_node_connectivity = node_connectivity;
+  m_starting_indices = starting_indices;
+  m_nb_row_eqs = nb_row_eqs;
+  m_nb_col_eqs = nb_col_eqs;
+  m_block_size = nb_row_eqs*nb_col_eqs;
+  m_values.assign(node_connectivity->size()*m_block_size, 0.);
+}
+
+void SparseOperator::reset()
+{
+  std::fill(m_values.begin(), m_values.end(), 0.);
+}
+
+void SparseOperator::apply(math::LSS::Vector& x, math::LSS::Vector& y, const Real alpha) const
+{
+  gather(x, alpha, nullptr, 0.);
+  multiply(y);
+}
+
+void SparseOperator::apply(math::LSS::Vector& x1, const Real alpha1, math::LSS::Vector& x2, const Real alpha2, math::LSS::Vector& y) const
+{
+  gather(x1, alpha1, &x2, alpha2);
+  multiply(y);
+}
+
+void SparseOperator::gather(math::LSS::Vector& x1, const Real alpha1, math::LSS::Vector* x2, const Real alpha2) const
+{
+  if(!is_created())
+    throw common::SetupError(FromHere(), "SparseOperator is applied before it was created");
+
+  const Uint nb_rows = m_starting_indices->size() - 1;
+  const Uint neq = x1.neq();
+  if(x1.blockrow_size() != nb_rows || (is_not_null(x2) && (x2->blockrow_size() != nb_rows || x2->neq() != neq)))
+    throw common::BadValue(FromHere(), "Vector size does not match the SparseOperator");
+
+  m_x.resize(nb_rows*neq);
+  Real value;
+  for(Uint i = 0; i != nb_rows; ++i)
+  {
+    for(Uint j = 0; j != neq; ++j)
+    {
+      x1.get_value(i, j, value);
+      m_x[i*neq + j] = alpha1*value;
+      if(is_not_null(x2))
+      {
+        x2->get_value(i, j, value);
+        m_x[i*neq + j] += alpha2*value;
+      }
+    }
+  }
+}
+
+void SparseOperator::multiply(math::LSS::Vector& y) const
+{
+  const std::vector<Uint>& starting_indices = *m_starting_indices;
+  const std::vector<Uint>& node_connectivity = *m_node_connectivity;
+  const Uint nb_rows = starting_indices.size() - 1;
+  const Uint x_neq = m_x.size() / nb_rows;
+  const Uint y_neq = y.neq();
+  // Number of times the operator is repeated along the diagonal, i.e. the number of variables for a 1x1 operator
+  const Uint nb_components = x_neq / m_nb_col_eqs;
+  if(y.blockrow_size() != nb_rows || x_neq != nb_components*m_nb_col_eqs || y_neq != nb_components*m_nb_row_eqs || (nb_components != 1 && m_block_size != 1))
+    throw common::BadValue(FromHere(), "Vector size does not match the SparseOperator");
+
+  m_y.resize(y_neq);
+  for(Uint row = 0; row != nb_rows; ++row)
+  {
+    std::fill(m_y.begin(), m_y.end(), 0.);
+    const Uint row_end = starting_indices[row+1];
+    for(Uint k = starting_indices[row]; k != row_end; ++k)
+    {
+      const Real* block = &m_values[k*m_block_size];
+      const Real* x = &m_x[node_connectivity[k]*x_neq];
+      if(m_block_size == 1)
+      {
+        for(Uint c = 0; c != nb_components; ++c)
+          m_y[c] += block[0]*x[c];
+      }
+      else
+      {
+        for(Uint i = 0; i != m_nb_row_eqs; ++i)
+        {
+          for(Uint j = 0; j != m_nb_col_eqs; ++j)
+          {
+            m_y[i] += block[i*m_nb_col_eqs + j]*x[j];
+          }
+        }
+      }
+    }
+
+    for(Uint i = 0; i != y_neq; ++i)
+    {
+      y.add_value(row, i, m_y[i]);
+    }
+  }
+}
+
+} // UFEM
+} // cf3
@@ -0,0 +1,106 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_UFEM_SparseOperator_hpp
+#define cf3_UFEM_SparseOperator_hpp
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/Assertions.hpp"
+
+#include "math/LSS/Vector.hpp"
+
+#include "../LibUFEM.hpp"
+
+namespace cf3 {
+namespace UFEM {
+
+/// Sparse operator acting on LSS vectors, assembled from element matrices.
+/// Rows and columns are numbered like the blockrows of the LSS, and each nonzero is a dense block of nb_row_eqs x nb_col_eqs values,
+/// so the operator can be rectangular, e.g. mapping a pressure vector to a velocity vector. The sparsity is the node connectivity
+/// computed by build_node_connectivity, which can be shared between operators. Contributions for periodic and ghost nodes end up
+/// where assembling the element vectors directly into the LSS vector would put them, so applying the operator gives the same result
+/// as an element loop over the element vectors.
+class UFEM_API SparseOperator
+{
+public:
+  SparseOperator();
+
+  /// Set up the structure. node_connectivity and starting_indices are in the format used by build_sparsity
+  void create(const boost::shared_ptr< const std::vector<Uint> >& node_connectivity, const boost::shared_ptr< const std::vector<Uint> >& starting_indices, const Uint nb_row_eqs, const Uint nb_col_eqs);
+
+  bool is_created() const
+  {
+    return is_not_null(m_starting_indices.get());
+  }
+
+  /// Set all values to zero
+  void reset();
+
+  /// Add an element matrix. The element matrix rows and columns are blocked by variable, i.e. entry (i*nb_nodes + a, j*nb_nodes + b)
+  /// couples equation i of node a with equation j of node b. Assembly of elements that have no node in common may happen concurrently.
+  /// @param lss_indices The LSS blockrow for each of the nb_nodes nodes of the element
+  template<typename MatrixT>
+  void add_element(const Uint* lss_indices, const Uint nb_nodes, const MatrixT& element_matrix)
+  {
+    cf3_assert(is_created());
+    cf3_assert(element_matrix.rows() == nb_nodes*m_nb_row_eqs);
+    cf3_assert(element_matrix.cols() == nb_nodes*m_nb_col_eqs);
+    const std::vector<Uint>& starting_indices = *m_starting_indices;
+    const std::vector<Uint>& node_connectivity = *m_node_connectivity;
+    for(Uint a = 0; a != nb_nodes; ++a)
+    {
+      const Uint row = lss_indices[a];
+      const std::vector<Uint>::const_iterator row_begin = node_connectivity.begin() + starting_indices[row];
+      const std::vector<Uint>::const_iterator row_end = node_connectivity.begin() + starting_indices[row+1];
+      for(Uint b = 0; b != nb_nodes; ++b)
+      {
+        const std::vector<Uint>::const_iterator col = std::lower_bound(row_begin, row_end, lss_indices[b]);
+        cf3_assert(col != row_end && *col == lss_indices[b]);
+        Real* block = &m_values[(col - node_connectivity.begin()) * m_block_size];
+        for(Uint i = 0; i != m_nb_row_eqs; ++i)
+        {
+          for(Uint j = 0; j != m_nb_col_eqs; ++j)
+          {
+            block[i*m_nb_col_eqs + j] += element_matrix(i*nb_nodes + a, j*nb_nodes + b);
+          }
+        }
+      }
+    }
+  }
+
+  /// y += alpha*A*x
+  /// An operator with 1x1 blocks is applied to each variable of x and y separately, so y and x must then have the same number of equations.
+  void apply(math::LSS::Vector& x, math::LSS::Vector& y, const Real alpha = 1.) const;
+
+  /// y += A*(alpha1*x1 + alpha2*x2)
+  void apply(math::LSS::Vector& x1, const Real alpha1, math::LSS::Vector& x2, const Real alpha2, math::LSS::Vector& y) const;
+
+private:
+  /// Copy the linear combination alpha1*x1 + alpha2*x2 into m_x. x2 may be null
+  void gather(math::LSS::Vector& x1, const Real alpha1, math::LSS::Vector* x2, const Real alpha2) const;
+  /// Add A*m_x to y
+  void multiply(math::LSS::Vector& y) const;
+
+  boost::shared_ptr< const std::vector<Uint> > m_node_connectivity;
+  boost::shared_ptr< const std::vector<Uint> > m_starting_indices;
+  Uint m_nb_row_eqs;
+  Uint m_nb_col_eqs;
+  Uint m_block_size;
+  std::vector<Real> m_values;
+
+  /// Work arrays for the multiplication
+  mutable std::vector<Real> m_x;
+  mutable std::vector<Real> m_y;
+};
+
+} // UFEM
+} // cf3
+
+#endif // cf3_UFEM_SparseOperator_hpp
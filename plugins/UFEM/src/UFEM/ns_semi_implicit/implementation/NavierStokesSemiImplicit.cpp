@@ -20,6 +20,7 @@
 #include <Thyra_MultiVectorStdOps.hpp>
 #include <Thyra_VectorBase.hpp>
 
+#include "common/BasicExceptions.hpp"
 #include "common/Component.hpp"
 #include "common/Builder.hpp"
 #include "common/OptionT.hpp"
@@ -41,6 +42,7 @@
 #include "solver/Time.hpp"
 #include "solver/Tags.hpp"
 
+#include "../../SparsityBuilder.hpp"
 #include "../../Tags.hpp"
 
 namespace cf3 {
@@ -98,9 +100,9 @@ struct InnerLoop : solver::Action
       .link_to(&m_time);
     
     nb_iterations = 2;
+    operators = nullptr;
+    m_operator_assembly = create_component<solver::ActionDirector>("OperatorAssembly");
     m_u_rhs_assembly = create_component<solver::ActionDirector>("URHSAssembly");
-    m_p_rhs_assembly = create_component<solver::ActionDirector>("PRHSAssembly");
-    m_apply_aup = create_component<solver::ActionDirector>("ApplyAup");
     
     solve_u_lss = create_component<math::LSS::SolveLSS>("SolveUSystem");
     solve_p_lss = create_component<math::LSS::SolveLSS>("SolvePSystem");
@@ -115,18 +117,32 @@ struct InnerLoop : solver::Action
     a->reset(0.);
     delta_p_sum->reset(0.);
     u->assign(*u_lss->solution());
-    p->assign(*p_lss->solution());    
+    p->assign(*p_lss->solution());
+
+    // None of the operators depend on the inner loop unknowns, so they are assembled once here and only applied in the iterations below
+    cf3_assert(is_not_null(operators));
+    if(!operators->is_created())
+      throw common::SetupError(FromHere(), "Inner loop operators for " + uri().path() + " were not created");
+    operators->reset();
+    m_operator_assembly->execute();
+    u_lss->rhs()->reset(0.);
+    m_u_rhs_assembly->execute();
+    u_rhs_constant->assign(*u_lss->rhs());
+
+    const Real dt = m_time->dt();
     for(Uint i = 0; i != nb_iterations; ++i)
     {
-      u_lss->rhs()->reset(0.);
       // Velocity system: compute delta_a_star
-      m_u_rhs_assembly->execute();
+      u_lss->rhs()->assign(*u_rhs_constant);
+      operators->u_mass.apply(*a, *u_lss->rhs());
+      operators->u_visc.apply(*a, dt*(1. - theta), *u, -1., *u_lss->rhs());
+      operators->grad.apply(*delta_p_sum, 1. - theta, *p, -1., *u_lss->rhs());
       if(i == 0) // Apply velocity BC the first inner iteration
       {
-        u_lss->rhs()->scale(m_time->dt());
+        u_lss->rhs()->scale(dt);
         velocity_bc->execute();
         // The velocity BC deals with velocity, so we need to write this in terms of acceleration
-        u_lss->rhs()->scale(1./m_time->dt());
+        u_lss->rhs()->scale(1./dt);
       }
       else // Zero boundary condition after first pass
       {
@@ -142,7 +158,9 @@ struct InnerLoop : solver::Action
 
       // Pressure system: compute delta_p
       p_lss->rhs()->reset(0.);
-      m_p_rhs_assembly->execute();
+      operators->p_u.apply(*u, 1., *u_lss->solution(), dt, *p_lss->rhs());
+      operators->p_a.apply(*a, 1., *u_lss->solution(), 1., *p_lss->rhs());
+      operators->p_p.apply(*p, *p_lss->rhs());
       p_lss->solution()->reset(0.);
       // Apply BC if the first iteration, set RHS to 0 otherwise
       if(i ==0)
@@ -170,7 +188,7 @@ struct InnerLoop : solver::Action
 
       // Compute delta_a
       u_lss->rhs()->reset(0.);
-      m_apply_aup->execute(); // Compute Aup*delta_p (stored in u_lss RHS)
+      operators->grad.apply(*p_lss->solution(), *u_lss->rhs(), theta); // Compute Aup*delta_p (stored in u_lss RHS)
       // delta_a is delta_a_star for the dirichlet nodes
       BOOST_FOREACH(const BlockrowIdxT& diri_idx, Handle<math::LSS::TrilinosCrsMatrix>(u_lss->matrix())->get_dirichlet_nodes())
       {
@@ -183,7 +201,7 @@ struct InnerLoop : solver::Action
       const math::LSS::Vector& dp = *p_lss->solution();
       
       a->update(da);
-      u->update(da, m_time->dt());
+      u->update(da, dt);
       p->update(dp);
       delta_p_sum->update(dp);
     }
@@ -214,6 +232,11 @@ struct InnerLoop : solver::Action
   Teuchos::RCP<Thyra::VectorBase<Real> > delta_a;
   Teuchos::RCP<Thyra::VectorBase<Real> > aup_delta_p; // This is actually u_lss->rhs()
   Handle< math::LSS::Vector > delta_p_sum;
+  /// Velocity RHS terms that are constant during the inner loop
+  Handle< math::LSS::Vector > u_rhs_constant;
+
+  /// Operators for the RHS of the velocity and pressure systems
+  InnerLoopOperators* operators;
   
   Handle<solver::Time> m_time;
   Real theta;
@@ -223,9 +246,8 @@ struct InnerLoop : solver::Action
   Handle<math::LSS::SolutionStrategy> m_p_strategy_second;
 
 private:
+  Handle<solver::ActionDirector> m_operator_assembly;
   Handle<solver::ActionDirector> m_u_rhs_assembly;
-  Handle<solver::ActionDirector> m_p_rhs_assembly;
-  Handle<solver::ActionDirector> m_apply_aup;
 };
 
 ComponentBuilder < InnerLoop, common::Action, LibUFEM > InnerLoop_builder;
@@ -400,6 +422,7 @@ NavierStokesSemiImplicit::NavierStokesSemiImplicit(const std::string& name) :
   m_inner_loop->add_tag(detail::my_tag());
   Handle<InnerLoop>(m_inner_loop)->pressure_bc = pressure_bc;
   Handle<InnerLoop>(m_inner_loop)->velocity_bc = velocity_bc;
+  Handle<InnerLoop>(m_inner_loop)->operators = &assemble_operators.operators;
 
   // Update the solution
   create_component<ProtoAction>("Update")->set_expression(nodes_expression(group(u3 = u2, u2 = u1, u1 = u, u = m_u_lss->solution(u), p = m_p_lss->solution(p))));
@@ -510,6 +533,7 @@ void NavierStokesSemiImplicit::on_regions_set()
   inner_loop->delta_a = u_lss->solution()->handle<math::LSS::ThyraVector>()->thyra_vector();
   inner_loop->delta_p_sum = detail::create_vector(*p_lss, "DeltaPSum");
   inner_loop->aup_delta_p = u_lss->rhs()->handle<math::LSS::ThyraVector>()->thyra_vector();
+  inner_loop->u_rhs_constant = detail::create_vector(*u_lss, "URHSConstant");
   
   mesh::Dictionary& dict = common::find_parent_component<mesh::Mesh>(*m_loop_regions.front()).geometry_fields();
   Handle< common::Table<Real> > coordinates(dict.coordinates().handle());
@@ -517,6 +541,16 @@ void NavierStokesSemiImplicit::on_regions_set()
   
   cf3_assert(is_not_null(coordinates));
   cf3_assert(is_not_null(used_nodes));
+
+  // The inner loop operators use the velocity LSS numbering for both systems, which have the same nodes
+  Handle< common::List<int> const > used_node_map(u_lss->get_child("used_node_map"));
+  cf3_always_assert(is_not_null(used_node_map));
+  cf3_always_assert(p_lss->solution()->blockrow_size() == u_lss->solution()->blockrow_size());
+  boost::shared_ptr< std::vector<Uint> > node_connectivity(new std::vector<Uint>());
+  boost::shared_ptr< std::vector<Uint> > starting_indices(new std::vector<Uint>());
+  build_node_connectivity(m_loop_regions, dict, *used_node_map, *node_connectivity, *starting_indices);
+  assemble_operators.operators.used_node_map = used_node_map.get();
+  assemble_operators.operators.create(node_connectivity, starting_indices, u_lss->solution()->neq());
   
   std::vector<bool> periodic_links_active_vec;
 
@@ -549,14 +583,6 @@ void NavierStokesSemiImplicit::on_regions_set()
     p_lss->solution_strategy()->options().set("coordinates", coordinates);
     p_lss->solution_strategy()->options().set("used_nodes", used_nodes);
   }
-  
-  // Make sure the terminals refer to the correct vectors
-  u_vec.op.set_vector(inner_loop->u, *u_lss);
-  p_vec.op.set_vector(inner_loop->p, *p_lss);
-  a.op.set_vector(inner_loop->a, *u_lss);
-  delta_a.op.set_vector(u_lss->solution(), *u_lss);
-  delta_p.op.set_vector(p_lss->solution(), *p_lss);
-  delta_p_sum.op.set_vector(inner_loop->delta_p_sum, *p_lss);
 }
 
 void NavierStokesSemiImplicit::trigger_theta()
@@ -588,9 +614,8 @@ void NavierStokesSemiImplicit::trigger_reset_assembly()
 {
   m_mass_matrix_assembly->clear();
   m_velocity_assembly->clear();
+  m_inner_loop->get_child("OperatorAssembly")->clear();
   m_inner_loop->get_child("URHSAssembly")->clear();
-  m_inner_loop->get_child("PRHSAssembly")->clear();
-  m_inner_loop->get_child("ApplyAup")->clear();
   
   set_elements_expressions_quad();
   set_elements_expressions_triag();
@@ -15,12 +15,19 @@
  #define BOOST_MPL_LIMIT_METAFUNCTION_ARITY 10
 #endif
 
+#include <boost/foreach.hpp>
+
 #include "common/Core.hpp"
 #include "common/Environment.hpp"
+#include "common/FindComponents.hpp"
 
 #include "math/LSS/System.hpp"
+#include "math/LSS/Native/NativeEBEMatrix.hpp"
 
 #include "mesh/Domain.hpp"
+#include "mesh/ElementGeometryCache.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Mesh.hpp"
 
 #include "mesh/LagrangeP1/Line1D.hpp"
 #include "solver/Model.hpp"
@@ -35,6 +42,7 @@
 
 #include "mesh/SimpleMeshGenerator.hpp"
 
+#include "UFEM/InitialConditions.hpp"
 #include "UFEM/LSSAction.hpp"
 #include "UFEM/Solver.hpp"
 #include "UFEM/Tags.hpp"
@@ -148,6 +156,129 @@ BOOST_AUTO_TEST_CASE( Heat1DComponent )
   model.simulate();
 }
 
+// Steady heat conduction with a constant heat source, solved by HeatConductionSteady with the matrix-free NativeEBEMatrix.
+// Its assembly action assembles both the matrix and the RHS, and is executed again for each matrix-vector product
+BOOST_AUTO_TEST_CASE( Heat1DMatrixFree )
+{
+  const Real length      = 5.;
+  const Uint nb_segments = 5;
+  const Real heat_source = 2.;
+
+  Model& model = *root.create_component<Model>("MatrixFreeModel");
+  Domain& domain = model.create_domain("Domain");
+  model.create_physics("cf3.UFEM.NavierStokesPhysics");
+  // Created through the model, so the solver and its actions get the physical model
+  UFEM::Solver& solver = dynamic_cast<UFEM::Solver&>(model.create_solver("cf3.UFEM.Solver"));
+
+  Handle<UFEM::LSSAction> heat_conduction(solver.add_direct_solver("cf3.UFEM.HeatConductionSteady"));
+  heat_conduction->options().set("matrix_builder", std::string("cf3.math.LSS.NativeEBEMatrix"));
+  heat_conduction->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+
+  FieldVariable<0, ScalarField> temperature("Temperature", "heat_conduction_solution");
+  FieldVariable<1, ScalarField> heat("Heat", "source_terms");
+
+  Handle<ProtoAction> heat_ic(solver.create_initial_conditions()->create_initial_condition("source_terms", "cf3.solver.ProtoAction"));
+  heat_ic->set_expression(nodes_expression(heat = heat_source));
+
+  boost::shared_ptr<MeshGenerator> create_line = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","create_line");
+  create_line->options().set("mesh",domain.uri()/"Mesh");
+  create_line->options().set("lengths",std::vector<Real>(DIM_1D, length));
+  create_line->options().set("nb_cells",std::vector<Uint>(DIM_1D, nb_segments));
+  Mesh& mesh = create_line->generate();
+
+  // The jacobians are computed once and reused by each evaluation
+  BOOST_FOREACH(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+    elements.geometry_cache().options().set("enabled", true);
+
+  const std::vector<URI> regions(1, mesh.topology().uri());
+  heat_conduction->options().set("regions", regions);
+  heat_ic->options().set("regions", regions);
+
+  Handle<cf3::math::LSS::System> lss(heat_conduction->get_child("LSS"));
+  BOOST_REQUIRE(is_not_null(lss));
+  BOOST_REQUIRE(lss->is_created());
+  lss->matrix()->options().set("assembly_actions", std::vector<URI>(1, heat_conduction->get_child("Assembly")->uri()));
+  lss->solution_strategy()->options().set("solver", std::string("CG"));
+  lss->solution_strategy()->options().set("preconditioner", std::string("Jacobi"));
+
+  Handle<UFEM::BoundaryConditions> bc(heat_conduction->get_child("BoundaryConditions"));
+  bc->add_constant_bc("xneg", "Temperature", 10.);
+  bc->add_constant_bc("xpos", "Temperature", 35.);
+
+  model.simulate();
+
+  // With a unit conductivity, the exact solution is quadratic and the linear elements are exact at the nodes
+  for_each_node
+  (
+    mesh.topology(),
+    _check_close(temperature, 10. + 25.*coordinates(0,0)/length + 0.5*heat_source*coordinates(0,0)*(length - coordinates(0,0)), 1e-6)
+  );
+
+  // No matrix entries are stored, so this is less than the values and column indices of the 3*nb_nodes-2 entries of the assembled matrix
+  const cf3::math::LSS::NativeEBEMatrix& matrix = dynamic_cast<const cf3::math::LSS::NativeEBEMatrix&>(*lss->matrix());
+  const Uint nb_nodes = nb_segments+1;
+  BOOST_CHECK(matrix.storage_size() < (3*nb_nodes-2)*(sizeof(Real) + sizeof(Uint)));
+}
+
+// Threaded assembly adds the element matrices through scatter maps, which are set up before the threads start
+BOOST_AUTO_TEST_CASE( Heat2DThreadedAssembly )
+{
+  Model& model = *root.create_component<Model>("ThreadedModel");
+  Domain& domain = model.create_domain("Domain");
+  model.create_physics("cf3.UFEM.NavierStokesPhysics");
+  UFEM::Solver& solver = dynamic_cast<UFEM::Solver&>(model.create_solver("cf3.UFEM.Solver"));
+
+  Handle<UFEM::LSSAction> heat_conduction(solver.add_direct_solver("cf3.UFEM.HeatConductionSteady"));
+  heat_conduction->options().set("matrix_builder", std::string("cf3.math.LSS.NativeCrsMatrix"));
+  heat_conduction->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+
+  FieldVariable<1, ScalarField> heat("Heat", "source_terms");
+  Handle<ProtoAction> heat_ic(solver.create_initial_conditions()->create_initial_condition("source_terms", "cf3.solver.ProtoAction"));
+  heat_ic->set_expression(nodes_expression(heat = 1.));
+
+  Mesh& mesh = *domain.create_component<Mesh>("Mesh");
+  Tools::MeshGeneration::create_rectangle_tris(mesh, 1., 1., 20, 20);
+
+  const std::vector<URI> regions(1, mesh.topology().uri());
+  heat_conduction->options().set("regions", regions);
+  heat_ic->options().set("regions", regions);
+
+  Handle<UFEM::BoundaryConditions> bc(heat_conduction->get_child("BoundaryConditions"));
+  bc->add_constant_bc("left", "Temperature", 10.);
+  bc->add_constant_bc("right", "Temperature", 35.);
+
+  // Creates the fields and the linear system
+  model.simulate();
+
+  Handle<cf3::math::LSS::System> lss(heat_conduction->get_child("LSS"));
+  cf3::math::LSS::Matrix& matrix = *lss->matrix();
+  BOOST_REQUIRE(is_not_null(matrix.scatter_values()));
+  Handle<ProtoAction> assembly(heat_conduction->get_child("Assembly"));
+
+  // Reference using add_values
+  std::vector<Uint> ref_rows, ref_cols, rows, cols;
+  std::vector<Real> ref_values, values;
+  lss->options().set("scatter_assembly", false);
+  matrix.reset();
+  assembly->execute();
+  matrix.debug_data(ref_rows, ref_cols, ref_values);
+
+  // The second threaded pass reuses the offsets computed in the first
+  lss->options().set("scatter_assembly", true);
+  assembly->options().set("nb_threads", 4u);
+  for(Uint pass = 0; pass != 2; ++pass)
+  {
+    matrix.reset();
+    assembly->execute();
+    matrix.debug_data(rows, cols, values);
+    BOOST_CHECK(rows == ref_rows);
+    BOOST_CHECK(cols == ref_cols);
+    BOOST_REQUIRE_EQUAL(values.size(), ref_values.size());
+    for(Uint i = 0; i != values.size(); ++i)
+      BOOST_CHECK_SMALL(values[i] - ref_values[i], 1e-12);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,490 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the sparse operators of the semi-implicit Navier-Stokes solver"
+
+#include <cmath>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/MatrixTypes.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+#include "mesh/Cells.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/LagrangeP1/Hexa3D.hpp"
+#include "mesh/LagrangeP1/Quad2D.hpp"
+#include "mesh/LagrangeP1/Tetra3D.hpp"
+#include "mesh/LagrangeP1/Triag2D.hpp"
+
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+#include "UFEM/SparsityBuilder.hpp"
+#include "UFEM/ns_semi_implicit/InnerLoopOperators.hpp"
+#include "UFEM/ns_semi_implicit/SparseOperator.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::common;
+using namespace cf3::math;
+using namespace cf3::mesh;
+
+using boost::proto::lit;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Deterministic values that are different for each entry
+Real test_value(const Uint i, const Uint j, const Real seed)
+{
+  return std::sin(1.3*static_cast<Real>(i) + 0.7*static_cast<Real>(j) + seed);
+}
+
+/// Fill an LSS vector with test values
+void fill_vector(LSS::Vector& v, const Real seed)
+{
+  for(Uint i = 0; i != v.blockrow_size(); ++i)
+    for(Uint j = 0; j != v.neq(); ++j)
+      v.set_value(i, j, test_value(i, j, seed));
+}
+
+/// Sparsity, LSS numbering and vector layout for the volume elements of a mesh
+struct OperatorStructure
+{
+  OperatorStructure(Mesh& mesh) :
+    node_connectivity(new std::vector<Uint>()),
+    starting_indices(new std::vector<Uint>())
+  {
+    gids = mesh.create_component< List<Uint> >("GIDs");
+    ranks = mesh.create_component< List<Uint> >("Ranks");
+    used_node_map = mesh.create_component< List<int> >("used_node_map");
+    UFEM::build_sparsity(std::vector< Handle<Region> >(1, mesh.topology().handle<Region>()), mesh.geometry_fields(), *node_connectivity, *starting_indices, *gids, *ranks, *used_node_map);
+
+    comm_pattern = mesh.create_component<PE::CommPattern>("CommPattern");
+    comm_pattern->insert("gid", gids->array(), false);
+    comm_pattern->setup(Handle<PE::CommWrapper>(comm_pattern->get_child("gid")), ranks->array());
+  }
+
+  Uint nb_rows() const
+  {
+    return starting_indices->size() - 1;
+  }
+
+  /// Create a vector with neq equations per node
+  boost::shared_ptr<LSS::NativeVector> create_vector(const std::string& name, const Uint neq)
+  {
+    boost::shared_ptr<LSS::NativeVector> result = allocate_component<LSS::NativeVector>(name);
+    result->create(*comm_pattern, neq);
+    return result;
+  }
+
+  boost::shared_ptr< std::vector<Uint> > node_connectivity;
+  boost::shared_ptr< std::vector<Uint> > starting_indices;
+  Handle< List<Uint> > gids;
+  Handle< List<Uint> > ranks;
+  Handle< List<int> > used_node_map;
+  Handle<PE::CommPattern> comm_pattern;
+};
+
+/// Assemble test element matrices into op, and into the dense matrix dense, which has one row and column per equation, numbered as node*neq + eq
+void assemble_test_operator(Mesh& mesh, const OperatorStructure& structure, const Uint nb_row_eqs, const Uint nb_col_eqs, UFEM::SparseOperator& op, RealMatrix& dense)
+{
+  op.create(structure.node_connectivity, structure.starting_indices, nb_row_eqs, nb_col_eqs);
+  dense.resize(structure.nb_rows()*nb_row_eqs, structure.nb_rows()*nb_col_eqs);
+  dense.setZero();
+
+  Uint elem_idx = 0;
+  BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(mesh.topology(), IsElementsVolume()))
+  {
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    const Uint nb_nodes = connectivity.row_size();
+    std::vector<Uint> indices(nb_nodes);
+    RealMatrix element_matrix(nb_nodes*nb_row_eqs, nb_nodes*nb_col_eqs);
+    for(Uint elem = 0; elem != connectivity.size(); ++elem, ++elem_idx)
+    {
+      for(Uint a = 0; a != nb_nodes; ++a)
+        indices[a] = (*structure.used_node_map)[connectivity[elem][a]];
+
+      for(Uint r = 0; r != element_matrix.rows(); ++r)
+        for(Uint c = 0; c != element_matrix.cols(); ++c)
+          element_matrix(r, c) = test_value(elem_idx, r*element_matrix.cols() + c, 0.1);
+
+      op.add_element(&indices[0], nb_nodes, element_matrix);
+
+      for(Uint a = 0; a != nb_nodes; ++a)
+        for(Uint b = 0; b != nb_nodes; ++b)
+          for(Uint i = 0; i != nb_row_eqs; ++i)
+            for(Uint j = 0; j != nb_col_eqs; ++j)
+              dense(indices[a]*nb_row_eqs + i, indices[b]*nb_col_eqs + j) += element_matrix(i*nb_nodes + a, j*nb_nodes + b);
+    }
+  }
+}
+
+/// Check that y equals y0 + alpha*A*x, with A the dense matrix. For a 1x1 operator with vectors of more than one equation, A is applied to each component
+void check_product(const RealMatrix& dense, LSS::Vector& x, LSS::Vector& y0, LSS::Vector& y, const Real alpha)
+{
+  const Uint nb_rows = y.blockrow_size();
+  const Uint nb_components = dense.rows() == nb_rows ? y.neq() : 1;
+  const Uint x_neq = x.neq() / nb_components;
+  const Uint y_neq = y.neq() / nb_components;
+  Real x_value, y_value, y0_value;
+  for(Uint c = 0; c != nb_components; ++c)
+  {
+    for(Uint row = 0; row != nb_rows; ++row)
+    {
+      for(Uint i = 0; i != y_neq; ++i)
+      {
+        Real ref = 0.;
+        for(Uint col = 0; col != nb_rows; ++col)
+        {
+          for(Uint j = 0; j != x_neq; ++j)
+          {
+            x.get_value(col, c + j, x_value);
+            ref += dense(row*y_neq + i, col*x_neq + j) * x_value;
+          }
+        }
+        y0.get_value(row, c + i, y0_value);
+        y.get_value(row, c + i, y_value);
+        BOOST_CHECK_SMALL(y_value - (y0_value + alpha*ref), 1e-12);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Sum over the rows of the product of component weight_eq of weights and component eq of v
+Real weighted_sum(LSS::Vector& weights, const Uint weight_eq, LSS::Vector& v, const Uint eq)
+{
+  Real result = 0.;
+  Real weight, value;
+  for(Uint row = 0; row != v.blockrow_size(); ++row)
+  {
+    weights.get_value(row, weight_eq, weight);
+    v.get_value(row, eq, value);
+    result += weight*value;
+  }
+  return result;
+}
+
+/// Check the inner loop operators on a mesh of the unit square or cube. Weighting the rows with a linear field turns the
+/// shape function gradients into constants, so the expected values are exact whatever the stabilization coefficients
+template<typename ElementsT>
+void check_inner_loop_operators(Mesh& mesh)
+{
+  const Uint dim = mesh.dimension();
+
+  // Advection velocity and viscosity that vary over the domain
+  Field& fields = mesh.geometry_fields().create_field("ns_test", "AdvectionVelocity[vector],EffectiveViscosity");
+  fields.add_tag("ns_test");
+  const Field& coords = mesh.geometry_fields().coordinates();
+  for(Uint i = 0; i != fields.size(); ++i)
+  {
+    for(Uint j = 0; j != dim; ++j)
+      fields[i][j] = 1. + test_value(i, j, 0.2) + coords[i][(j+1) % dim];
+    fields[i][dim] = 0.01*(1. + coords[i][0]);
+  }
+  FieldVariable<0, VectorField> u_adv("AdvectionVelocity", "ns_test");
+  FieldVariable<1, ScalarField> nu_eff("EffectiveViscosity", "ns_test");
+
+  const Real tau_su = 0.3;
+  const Real tau_ps = 0.2;
+  const Real tau_bulk = 0.05;
+
+  OperatorStructure structure(mesh);
+  UFEM::AssembleInnerLoopOperators assemble_operators;
+  assemble_operators.operators.used_node_map = structure.used_node_map.get();
+  assemble_operators.operators.create(structure.node_connectivity, structure.starting_indices, dim);
+  for_each_element<ElementsT>(mesh.topology(), group
+  (
+    assemble_operators.velocity(u_adv, nu_eff, lit(tau_su), lit(tau_bulk)),
+    assemble_operators.pressure(u_adv, lit(tau_ps))
+  ));
+  const UFEM::InnerLoopOperators& operators = assemble_operators.operators;
+
+  // Constant and linear fields
+  boost::shared_ptr<LSS::NativeVector> ones_u = structure.create_vector("ones_u", dim);
+  boost::shared_ptr<LSS::NativeVector> ones_p = structure.create_vector("ones_p", 1);
+  boost::shared_ptr<LSS::NativeVector> x = structure.create_vector("x", dim);
+  ones_u->reset(1.);
+  ones_p->reset(1.);
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    const int row = (*structure.used_node_map)[i];
+    for(Uint j = 0; j != dim && row >= 0; ++j)
+      x->set_value(row, j, coords[i][j]);
+  }
+
+  // Mass: the SUPG part vanishes, since the shape functions sum to one
+  boost::shared_ptr<LSS::NativeVector> u_result = structure.create_vector("u_result", dim);
+  operators.u_mass.apply(*ones_u, *u_result);
+  for(Uint j = 0; j != dim; ++j)
+    BOOST_CHECK_CLOSE(weighted_sum(*ones_u, j, *u_result, j), -1., 1e-10);
+
+  // All terms of the viscous operator contain the gradient of the velocity
+  u_result->reset(0.);
+  operators.u_visc.apply(*ones_u, *u_result);
+  BOOST_CHECK_SMALL(u_result->norm2(), 1e-10);
+
+  // Pressure gradient: the SUPG part contains the gradient of the pressure, and the weighted sum of the rest is minus the volume
+  u_result->reset(0.);
+  operators.grad.apply(*ones_p, *u_result);
+  for(Uint j = 0; j != dim; ++j)
+    BOOST_CHECK_CLOSE(weighted_sum(*x, j, *u_result, j), -1., 1e-10);
+
+  // Divergence and PSPG advection terms vanish for a constant velocity
+  boost::shared_ptr<LSS::NativeVector> p_result = structure.create_vector("p_result", 1);
+  operators.p_u.apply(*ones_u, *p_result);
+  BOOST_CHECK_SMALL(p_result->norm2(), 1e-10);
+
+  // PSPG acceleration: the x-weighted sum is minus tau_ps times the volume
+  p_result->reset(0.);
+  operators.p_a.apply(*ones_u, *p_result);
+  BOOST_CHECK_CLOSE(weighted_sum(*x, 0, *p_result, 0), -tau_ps, 1e-10);
+
+  // PSPG laplacian: zero for a constant pressure, and minus tau_ps times the volume for the x-weighted sum of x
+  p_result->reset(0.);
+  operators.p_p.apply(*ones_p, *p_result);
+  BOOST_CHECK_SMALL(p_result->norm2(), 1e-10);
+  boost::shared_ptr<LSS::NativeVector> x0 = structure.create_vector("x0", 1);
+  for(Uint row = 0; row != x0->blockrow_size(); ++row)
+  {
+    Real value;
+    x->get_value(row, 0, value);
+    x0->set_value(row, 0, value);
+  }
+  p_result->reset(0.);
+  operators.p_p.apply(*x0, *p_result);
+  BOOST_CHECK_CLOSE(weighted_sum(*x, 0, *p_result, 0), -tau_ps, 1e-10);
+}
+
+/// Generate a unit square or cube
+Mesh& generate_mesh(const std::string& name, const Uint dim, const Uint nb_cells)
+{
+  boost::shared_ptr<MeshGenerator> generator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator", "generate_" + name);
+  generator->options().set("mesh", Core::instance().root().uri()/name);
+  generator->options().set("lengths", std::vector<Real>(dim, 1.));
+  generator->options().set("nb_cells", std::vector<Uint>(dim, nb_cells));
+  return generator->generate();
+}
+
+/// Generate a unit cube, with each hexahedral cell split into 6 tetrahedra that share the diagonal from (0,0,0) to (1,1,1)
+Mesh& generate_tetra_mesh(const std::string& name, const Uint nb_cells)
+{
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>(name);
+  const Uint nb_points = nb_cells + 1;
+  mesh.initialize_nodes(nb_points*nb_points*nb_points, 3);
+  Dictionary& nodes = mesh.geometry_fields();
+  Field& coords = nodes.coordinates();
+  const Real step = 1. / static_cast<Real>(nb_cells);
+  for(Uint k = 0; k != nb_points; ++k)
+    for(Uint j = 0; j != nb_points; ++j)
+      for(Uint i = 0; i != nb_points; ++i)
+      {
+        Field::Row row = coords[(k*nb_points + j)*nb_points + i];
+        row[XX] = static_cast<Real>(i) * step;
+        row[YY] = static_cast<Real>(j) * step;
+        row[ZZ] = static_cast<Real>(k) * step;
+      }
+
+  for(Uint i = 0; i != nodes.size(); ++i)
+  {
+    nodes.rank()[i] = 0;
+    nodes.glb_idx()[i] = i;
+  }
+
+  // Each tetrahedron follows the edges of the cell from the first to the last corner, taking the directions in the order of a permutation
+  const Uint permutations[6][3] = { {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0} };
+  const Uint offsets[3] = { 1, nb_points, nb_points*nb_points };
+
+  Handle<Cells> cells = mesh.topology().create_region("region").create_component<Cells>("Tetra");
+  cells->initialize("cf3.mesh.LagrangeP1.Tetra3D", nodes);
+  cells->resize(6*nb_cells*nb_cells*nb_cells);
+  Table<Uint>& connectivity = cells->geometry_space().connectivity();
+  Uint elem_idx = 0;
+  for(Uint k = 0; k != nb_cells; ++k)
+    for(Uint j = 0; j != nb_cells; ++j)
+      for(Uint i = 0; i != nb_cells; ++i)
+        for(Uint p = 0; p != 6; ++p, ++elem_idx)
+        {
+          Table<Uint>::Row elem_nodes = connectivity[elem_idx];
+          elem_nodes[0] = (k*nb_points + j)*nb_points + i;
+          elem_nodes[1] = elem_nodes[0] + offsets[permutations[p][0]];
+          elem_nodes[2] = elem_nodes[1] + offsets[permutations[p][1]];
+          elem_nodes[3] = elem_nodes[2] + offsets[permutations[p][2]];
+          // Odd permutations give a negative volume
+          if(p == 1 || p == 2 || p == 5)
+            std::swap(elem_nodes[2], elem_nodes[3]);
+        }
+
+  mesh.raise_mesh_loaded();
+  return mesh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( SparseOperatorSuite )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( InitMPI )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK_EQUAL(PE::Comm::instance().size(), 1);
+}
+
+// Square operator with 2x2 blocks
+BOOST_AUTO_TEST_CASE( Square )
+{
+  Mesh& mesh = generate_mesh("square_operator", 2, 4);
+  OperatorStructure structure(mesh);
+
+  UFEM::SparseOperator op;
+  BOOST_CHECK(!op.is_created());
+  RealMatrix dense;
+  assemble_test_operator(mesh, structure, 2, 2, op, dense);
+  BOOST_CHECK(op.is_created());
+
+  boost::shared_ptr<LSS::NativeVector> x = structure.create_vector("x", 2);
+  boost::shared_ptr<LSS::NativeVector> y0 = structure.create_vector("y0", 2);
+  boost::shared_ptr<LSS::NativeVector> y = structure.create_vector("y", 2);
+  fill_vector(*x, 0.2);
+  fill_vector(*y0, 0.3);
+
+  // y is added to
+  y->assign(*y0);
+  op.apply(*x, *y, 0.5);
+  check_product(dense, *x, *y0, *y, 0.5);
+
+  // Linear combination: A*(2*x - x) == A*x
+  y->assign(*y0);
+  op.apply(*x, 2., *x, -1., *y);
+  check_product(dense, *x, *y0, *y, 1.);
+
+  // After a reset, the operator is zero
+  op.reset();
+  y->assign(*y0);
+  op.apply(*x, *y);
+  check_product(dense, *x, *y0, *y, 0.);
+}
+
+// Rectangular operators, such as the pressure gradient and the divergence
+BOOST_AUTO_TEST_CASE( Rectangular )
+{
+  Mesh& mesh = generate_mesh("rectangular_operator", 2, 4);
+  OperatorStructure structure(mesh);
+
+  boost::shared_ptr<LSS::NativeVector> scalar = structure.create_vector("scalar", 1);
+  boost::shared_ptr<LSS::NativeVector> vector = structure.create_vector("vector", 2);
+  boost::shared_ptr<LSS::NativeVector> scalar0 = structure.create_vector("scalar0", 1);
+  boost::shared_ptr<LSS::NativeVector> vector0 = structure.create_vector("vector0", 2);
+  fill_vector(*scalar0, 0.4);
+  fill_vector(*vector0, 0.5);
+
+  // Scalar to vector
+  UFEM::SparseOperator gradient;
+  RealMatrix dense;
+  assemble_test_operator(mesh, structure, 2, 1, gradient, dense);
+  fill_vector(*scalar, 0.6);
+  vector->assign(*vector0);
+  gradient.apply(*scalar, *vector, -2.);
+  check_product(dense, *scalar, *vector0, *vector, -2.);
+
+  // Vector to scalar
+  UFEM::SparseOperator divergence;
+  assemble_test_operator(mesh, structure, 1, 2, divergence, dense);
+  fill_vector(*vector, 0.7);
+  scalar->assign(*scalar0);
+  divergence.apply(*vector, *scalar);
+  check_product(dense, *vector, *scalar0, *scalar, 1.);
+
+  // Vectors that don't match the block size are rejected
+  BOOST_CHECK_THROW(gradient.apply(*vector, *vector), BadValue);
+  BOOST_CHECK_THROW(divergence.apply(*vector, *vector), BadValue);
+}
+
+// A 1x1 operator is applied to each component of a vector
+BOOST_AUTO_TEST_CASE( PerComponent )
+{
+  Mesh& mesh = generate_mesh("component_operator", 2, 4);
+  OperatorStructure structure(mesh);
+
+  UFEM::SparseOperator op;
+  RealMatrix dense;
+  assemble_test_operator(mesh, structure, 1, 1, op, dense);
+
+  boost::shared_ptr<LSS::NativeVector> x = structure.create_vector("x", 3);
+  boost::shared_ptr<LSS::NativeVector> y0 = structure.create_vector("y0", 3);
+  boost::shared_ptr<LSS::NativeVector> y = structure.create_vector("y", 3);
+  fill_vector(*x, 0.8);
+  fill_vector(*y0, 0.9);
+  y->assign(*y0);
+  op.apply(*x, *y, 3.);
+  check_product(dense, *x, *y0, *y, 3.);
+
+  // The number of components must match
+  boost::shared_ptr<LSS::NativeVector> y2 = structure.create_vector("y2", 2);
+  BOOST_CHECK_THROW(op.apply(*x, *y2), BadValue);
+}
+
+// The operators of the semi-implicit inner loop integrate constant and linear fields exactly
+BOOST_AUTO_TEST_CASE( InnerLoopQuads )
+{
+  check_inner_loop_operators< boost::mpl::vector1<mesh::LagrangeP1::Quad2D> >(generate_mesh("inner_loop_quads", 2, 4));
+}
+
+BOOST_AUTO_TEST_CASE( InnerLoopTriags )
+{
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>("inner_loop_triags");
+  Tools::MeshGeneration::create_rectangle_tris(mesh, 1., 1., 4, 4);
+  check_inner_loop_operators< boost::mpl::vector1<mesh::LagrangeP1::Triag2D> >(mesh);
+}
+
+BOOST_AUTO_TEST_CASE( InnerLoopHexas )
+{
+  check_inner_loop_operators< boost::mpl::vector1<mesh::LagrangeP1::Hexa3D> >(generate_mesh("inner_loop_hexas", 3, 3));
+}
+
+// Tetrahedra use first order quadrature for the viscous and pressure terms, with a separate second order loop for the mass matrix
+BOOST_AUTO_TEST_CASE( InnerLoopTetras )
+{
+  Mesh& mesh = generate_tetra_mesh("inner_loop_tetras", 2);
+  BOOST_CHECK(UFEM::IntegralOrder<mesh::LagrangeP1::Tetra3D>::value == 1);
+  check_inner_loop_operators< boost::mpl::vector1<mesh::LagrangeP1::Tetra3D> >(mesh);
+}
+
+BOOST_AUTO_TEST_CASE( FinalizeMPI )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
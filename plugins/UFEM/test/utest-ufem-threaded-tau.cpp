@@ -0,0 +1,135 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for computing the SUPG coefficients in a threaded element loop"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/LagrangeP1/Triag2D.hpp"
+
+#include "solver/actions/Proto/ProtoAction.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+#include "UFEM/SUPG.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+using boost::proto::lit;
+
+/// Scatter a scalar to all nodes of the element
+struct AddNodalValue
+{
+  typedef void result_type;
+
+  template<typename VarT>
+  void operator()(VarT& var, const Real value) const
+  {
+    var.add_nodal_values(VarT::ElementVectorT::Constant(value));
+  }
+};
+
+static MakeSFOp<AddNodalValue>::type const add_nodal_value = {};
+
+BOOST_AUTO_TEST_SUITE( UFEMThreadedTauSuite )
+
+// Each thread computes tau_su in its own copy of the literal, so the threaded result must match the serial one
+BOOST_AUTO_TEST_CASE( ThreadedComputeTau )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("Mesh");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 20, 20);
+
+  mesh->geometry_fields().create_field("velocity", "Velocity[vector]").add_tag("velocity");
+  mesh->geometry_fields().create_field("navier_stokes_viscosity", "EffectiveViscosity").add_tag("navier_stokes_viscosity");
+  mesh->geometry_fields().create_field("tau", "SerialTau,ThreadedTau").add_tag("tau");
+
+  FieldVariable<0, VectorField> u("Velocity", "velocity");
+  FieldVariable<1, ScalarField> nu_eff("EffectiveViscosity", "navier_stokes_viscosity");
+  FieldVariable<2, ScalarField> serial_tau("SerialTau", "tau");
+  FieldVariable<3, ScalarField> threaded_tau("ThreadedTau", "tau");
+
+  // Velocity and viscosity vary over the mesh, so tau_su is different for each element
+  for_each_node(mesh->topology(), group(u[0] = 1. + coordinates[1], u[1] = coordinates[0]*coordinates[0], nu_eff = 0.01 + 0.1*coordinates[0], serial_tau = 0., threaded_tau = 0.));
+
+  UFEM::ComputeTau compute_tau;
+  Real dt = 0.1;
+  Real tau_su = 0.;
+
+  boost::mpl::vector1<mesh::LagrangeP1::Triag2D> allowed_elements;
+
+  boost::shared_ptr<ProtoAction> serial = create_proto_action("Serial", elements_expression
+  (
+    allowed_elements,
+    group(compute_tau.apply(u, nu_eff, lit(dt), lit(tau_su)), add_nodal_value(serial_tau, lit(tau_su)))
+  ));
+  boost::shared_ptr<ProtoAction> threaded = create_proto_action("Threaded", elements_expression
+  (
+    allowed_elements,
+    group(compute_tau.apply(u, nu_eff, lit(dt), lit(tau_su)), add_nodal_value(threaded_tau, lit(tau_su)))
+  ));
+  threaded->options().set("nb_threads", 4u);
+
+  // The actions must be in the tree to find the regions
+  Core::instance().root().add_component(serial);
+  Core::instance().root().add_component(threaded);
+  serial->options().set("regions", std::vector<URI>(1, mesh->topology().uri()));
+  threaded->options().set("regions", std::vector<URI>(1, mesh->topology().uri()));
+
+  serial->execute();
+
+  // The threaded loop leaves the original literal untouched
+  tau_su = -1.;
+  threaded->execute();
+  BOOST_CHECK_EQUAL(tau_su, -1.);
+
+  const Field& tau = find_component_with_tag<Field>(mesh->geometry_fields(), "tau");
+  for(Uint i = 0; i != tau.size(); ++i)
+  {
+    BOOST_CHECK(tau[i][0] > 0.);
+    BOOST_CHECK_CLOSE(tau[i][0], tau[i][1], 1e-10);
+  }
+
+  Core::instance().root().remove_component(*serial);
+  Core::instance().root().remove_component(*threaded);
+}
+
+// Accumulating into a literal can't be split over threads
+BOOST_AUTO_TEST_CASE( RejectThreadedAccumulation )
+{
+  Real total_volume = 0.;
+  boost::shared_ptr<ProtoAction> action = create_proto_action("Accumulate", elements_expression
+  (
+    boost::mpl::vector1<mesh::LagrangeP1::Triag2D>(),
+    lit(total_volume) += volume
+  ));
+
+  BOOST_CHECK_THROW(action->options().set("nb_threads", 2u), SetupError);
+
+  Handle<Mesh> mesh(Core::instance().root().get_child("Mesh"));
+  Core::instance().root().add_component(action);
+  action->options().set("regions", std::vector<URI>(1, mesh->topology().uri()));
+  action->execute();
+  BOOST_CHECK_CLOSE(total_volume, 1., 1e-10);
+
+  Core::instance().root().remove_component(*action);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
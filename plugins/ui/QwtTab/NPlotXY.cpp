@@ -109,7 +109,7 @@ void NPlotXY::convergence_history ( SignalArgs& node )
   PlotDataPtr array( new PlotData() );
   std::vector<std::string> labels;
 
-  get_multi_array(options.main_map, "Table", *array, labels);
+  get_multi_array(options.main_map, "Table", *array, labels, *node.attachments);
 
   int nbRows = array->size();
   int nbCols = (*array)[0].size();
@@ -9,6 +9,7 @@
 
 #include <iostream>
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/random/mersenne_twister.hpp>
@@ -173,6 +174,64 @@ BOOST_AUTO_TEST_CASE( ReadBinaryData )
   BOOST_CHECK_EQUAL(empty_real_table.row_size(), 8);
 }
 
+BOOST_AUTO_TEST_CASE( SharedFile )
+{
+  Handle<common::Component> write_group = common::Core::instance().root().get_child("WriteGroup");
+  Handle< common::Table<Real> > write_real_table(write_group->get_child("RealTable"));
+  Handle< common::List<Uint> > write_int_list(write_group->get_child("IntList"));
+
+  // Compressed using multiple threads, the real table spans several compression chunks
+  common::BinaryDataWriter& writer = *write_group->create_component<common::BinaryDataWriter>("SharedWriter");
+  writer.options().set("file", common::URI("shared_binary_data.cfbinxml"));
+  writer.options().set("shared_file", true);
+  writer.options().set("nb_threads", 2u);
+  writer.append_data(*write_real_table);
+  writer.append_data(*write_int_list);
+  writer.close();
+
+  // Uncompressed
+  common::BinaryDataWriter& raw_writer = *write_group->create_component<common::BinaryDataWriter>("RawWriter");
+  raw_writer.options().set("file", common::URI("raw_binary_data.cfbinxml"));
+  raw_writer.options().set("shared_file", true);
+  raw_writer.options().set("compress", false);
+  raw_writer.append_data(*write_int_list);
+  raw_writer.append_data(*write_real_table);
+  raw_writer.close();
+
+  BOOST_CHECK(boost::filesystem::exists("shared_binary_data.cfbin"));
+  BOOST_CHECK(!boost::filesystem::exists("shared_binary_data_P0.cfbin"));
+
+  common::Component& read_group = *common::Core::instance().root().create_component("SharedReadGroup", "cf3.common.Group");
+  common::Table<Real>& read_real_table = *read_group.create_component< common::Table<Real> >("RealTable");
+  common::List<Uint>& read_int_list = *read_group.create_component< common::List<Uint> >("IntList");
+
+  common::BinaryDataReader& reader = *read_group.create_component<common::BinaryDataReader>("Reader");
+  reader.options().set("nb_threads", 2u);
+  reader.options().set("file", common::URI("shared_binary_data.cfbinxml"));
+  reader.read_table(read_real_table, 0);
+  reader.read_list(read_int_list, 1);
+  BOOST_CHECK(read_real_table.array() == write_real_table->array());
+  BOOST_CHECK(read_int_list.array() == write_int_list->array());
+
+  common::BinaryDataReader& raw_reader = *read_group.create_component<common::BinaryDataReader>("RawReader");
+  raw_reader.options().set("file", common::URI("raw_binary_data.cfbinxml"));
+  read_real_table.resize(0);
+  read_int_list.resize(0);
+  raw_reader.read_list(read_int_list, 0);
+  raw_reader.read_table(read_real_table, 1);
+  BOOST_CHECK(read_real_table.array() == write_real_table->array());
+  BOOST_CHECK(read_int_list.array() == write_int_list->array());
+
+  // Read the data of another rank
+  const Uint nb_procs = common::PE::Comm::instance().size();
+  common::BinaryDataReader& other_reader = *read_group.create_component<common::BinaryDataReader>("OtherReader");
+  other_reader.options().set("rank", (rank + 1) % nb_procs);
+  other_reader.options().set("file", common::URI("shared_binary_data.cfbinxml"));
+  BOOST_CHECK_EQUAL(other_reader.block_rows(0), 20000u + 2000u*((rank + 1) % nb_procs));
+  other_reader.read_table(read_real_table, 0);
+  BOOST_CHECK_EQUAL(read_real_table.size(), other_reader.block_rows(0));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,169 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for timing instrumentation: hardware counters, traces and the timing tree"
+
+#include <iostream>
+#include <sstream>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/ActionDirector.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/Foreach.hpp"
+#include "common/Group.hpp"
+#include "common/OptionList.hpp"
+#include "common/PerfCounters.hpp"
+#include "common/PropertyList.hpp"
+#include "common/TimedComponent.hpp"
+#include "common/TimingTrace.hpp"
+#include "common/URI.hpp"
+
+#include "common/PE/Comm.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( TimingTraceSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( HardwareCounters )
+{
+  PerfCounterValues start, end;
+  PerfCounters::instance().read(start);
+
+  Real sum = 0.;
+  for(Uint i = 0; i != 1000000; ++i)
+    sum += static_cast<Real>(i);
+  BOOST_CHECK_GT(sum, 0.);
+
+  PerfCounters::instance().read(end);
+  if(PerfCounters::instance().is_available())
+  {
+    BOOST_CHECK_GT(end.cycles, start.cycles);
+    BOOST_CHECK_GE(end.instructions, start.instructions);
+  }
+  else
+  {
+    BOOST_TEST_MESSAGE("Hardware counters are not available");
+    BOOST_CHECK_EQUAL(end.cycles, 0u);
+    BOOST_CHECK_EQUAL(end.instructions, 0u);
+    BOOST_CHECK_EQUAL(end.llc_misses, 0u);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( ChromeTrace )
+{
+  TimingTrace& trace = TimingTrace::instance();
+  trace.clear();
+
+  Core::instance().environment().options().set("trace_actions", true);
+  BOOST_CHECK(trace.is_enabled());
+
+  const boost::int64_t start = TimingTrace::now();
+  trace.record("/first", start, 10);
+  trace.record("/second \"quoted\"", start + 10, 5);
+
+#ifdef CF3_ENABLE_COMPONENT_TIMING
+  // Timed actions record themselves
+  Handle<ActionDirector> director = Core::instance().root().create_component<ActionDirector>("traced_director");
+  director->execute();
+  BOOST_CHECK_EQUAL(trace.events().size(), 3u);
+  BOOST_CHECK_EQUAL(trace.events().back().name, director->uri().path());
+  trace.clear();
+  trace.record("/first", start, 10);
+  trace.record("/second \"quoted\"", start + 10, 5);
+#endif
+
+  Core::instance().environment().options().set("trace_actions", false);
+  trace.record("/ignored", start, 1);
+  BOOST_CHECK_EQUAL(trace.events().size(), 2u);
+
+  trace.write_chrome_trace(URI("utest-common-timing-trace.json", URI::Scheme::FILE));
+
+  // The file is valid JSON, with a name for each process and the events of all processes
+  if(PE::Comm::instance().rank() == 0)
+  {
+    boost::property_tree::ptree json;
+    boost::property_tree::read_json("utest-common-timing-trace.json", json);
+    const Uint nb_procs = PE::Comm::instance().size();
+    BOOST_CHECK_EQUAL(json.get_child("traceEvents").size(), 3*nb_procs);
+
+    Uint nb_second = 0;
+    boost_foreach(const boost::property_tree::ptree::value_type& event, json.get_child("traceEvents"))
+    {
+      if(event.second.get<std::string>("name") == "/second \"quoted\"")
+      {
+        ++nb_second;
+        BOOST_CHECK_EQUAL(event.second.get<std::string>("ph"), "X");
+        if(event.second.get<Uint>("pid") == 0)
+          BOOST_CHECK_EQUAL(event.second.get<boost::int64_t>("ts"), start + 10);
+        BOOST_CHECK_EQUAL(event.second.get<boost::int64_t>("dur"), 5);
+      }
+    }
+    BOOST_CHECK_EQUAL(nb_second, nb_procs);
+  }
+  trace.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( TimingTree )
+{
+  // Fake timings, where rank 1 takes twice as long as rank 0
+  Handle<Group> timed = Core::instance().root().create_component<Group>("timed");
+  timed->properties().add("timer_mean", static_cast<Real>(PE::Comm::instance().rank() + 1));
+  timed->properties().add("timer_minimum", 0.5);
+  timed->properties().add("timer_maximum", 4.);
+  timed->properties().add("timer_count", Uint(2));
+
+  std::ostringstream output;
+  std::streambuf* cout_buf = std::cout.rdbuf(output.rdbuf());
+  print_timing_tree(*timed);
+  std::cout.rdbuf(cout_buf);
+
+  if(PE::Comm::instance().rank() == 0)
+  {
+    BOOST_TEST_MESSAGE(output.str());
+    BOOST_CHECK(output.str().find("timed: mean: ") != std::string::npos);
+    BOOST_CHECK(output.str().find("count: 2") != std::string::npos);
+    if(PE::Comm::instance().size() == 2)
+    {
+      BOOST_CHECK(output.str().find("mean: 1.5") != std::string::npos);
+      BOOST_CHECK(output.str().find("total: [2, 3, 4]") != std::string::npos);
+      BOOST_CHECK(output.str().find("imbalance: 0.333333") != std::string::npos);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -297,6 +297,40 @@ BOOST_AUTO_TEST_CASE( clear )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( tag_index )
+{
+  boost::shared_ptr<Component> root = allocate_component<Group> ( "root" );
+  Handle<Group> dir1 = root->create_component<Group>("dir1");
+  Handle<Component> c1 = dir1->create_component<Component>("c1");
+  c1->add_tag("marked");
+
+  BOOST_CHECK_EQUAL(root->components_with_tag("marked").size(), 1u);
+  BOOST_CHECK(&find_component_recursively_with_tag(*root, "marked") == c1.get());
+  BOOST_CHECK(is_null(find_component_ptr_recursively_with_tag<Group>(*root, "marked")));
+
+  // A new tag deeper in the tree is seen by the cached lookups in all parents
+  Handle<Group> dir2 = dir1->create_component<Group>("dir2");
+  dir2->add_tag("marked");
+  BOOST_CHECK_EQUAL(root->components_with_tag("marked").size(), 2u);
+  BOOST_CHECK(is_null(find_component_ptr_recursively_with_tag(*root, "marked")));
+  BOOST_CHECK(find_component_ptr_recursively_with_tag<Group>(*root, "marked") == dir2);
+  BOOST_CHECK(&find_component_recursively_with_tag<Group>(*dir1, "marked") == dir2.get());
+
+  // Removing and moving components updates the lookups
+  c1->remove_tag("marked");
+  BOOST_CHECK(find_component_ptr_recursively_with_tag(*root, "marked") == dir2);
+
+  dir2->move_to(*root);
+  BOOST_CHECK(is_null(find_component_ptr_recursively_with_tag(*dir1, "marked")));
+  BOOST_CHECK(find_component_ptr_recursively_with_tag(*root, "marked") == dir2);
+
+  root->remove_component("dir2");
+  BOOST_CHECK(root->components_with_tag("marked").empty());
+  BOOST_CHECK_THROW(find_component_recursively_with_tag(*root, "marked"), ValueNotFound);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,176 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for HashMap component"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/CF.hpp"
+#include "common/HashMap.hpp"
+#include "common/Log.hpp"
+#include "common/Foreach.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+using namespace cf3;
+using namespace cf3::common;
+
+BOOST_AUTO_TEST_SUITE( HashMapTests )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( test_HashMap )
+{
+  boost::shared_ptr< HashMap<std::string,Uint> > map_ptr ( allocate_component< HashMap<std::string,Uint> > ("map"));
+  HashMap<std::string,Uint>& map = *map_ptr;
+
+  BOOST_CHECK_EQUAL(map.type_name() , "HashMap<string,unsigned>");
+  BOOST_CHECK(!map.is_dense());
+
+  BOOST_CHECK(map.find("first") == map.end());
+
+  map.push_back(std::string("first"), (Uint) 1);
+  BOOST_CHECK_EQUAL(map.size() , 1u);
+  BOOST_CHECK_EQUAL(map["first"] , 1u);
+  map.push_back(std::string("second"), (Uint) 2);
+  BOOST_CHECK_EQUAL(map.size() , 2u);
+  BOOST_CHECK_EQUAL(map["second"] , 2u);
+  map["third"] = 3;
+  BOOST_CHECK_EQUAL(map.size() , 3u);
+  BOOST_CHECK_EQUAL(map["third"] , 3u);
+
+  BOOST_CHECK(map.find("fourth") == map.end());
+  map["fourth"] = 4;
+  BOOST_CHECK_EQUAL(map.find("fourth")->second,4u);
+  BOOST_CHECK_EQUAL(map.size() , 4u);
+
+  foreach_container((const std::string& key)(Uint data),map)
+    BOOST_CHECK_EQUAL( map[key] , data );
+
+  std::pair<HashMap<std::string,Uint>::iterator,bool> ret = map.insert(std::make_pair("fifth",5u));
+  BOOST_CHECK_EQUAL(ret.second, true);
+  BOOST_CHECK_EQUAL(ret.first->first, "fifth");
+  BOOST_CHECK_EQUAL(ret.first->second, 5u);
+
+  ret = map.insert(std::make_pair("fifth",1000u));
+  BOOST_CHECK_EQUAL(ret.second, false);
+  BOOST_CHECK_EQUAL(ret.first->second, 5u);
+
+  BOOST_CHECK(map.erase("first"));
+  BOOST_CHECK(!map.erase("first"));
+  BOOST_CHECK(map.find("first") == map.end());
+
+  map.erase( map.find("fourth") );
+  BOOST_CHECK(map.find("fourth") == map.end());
+  BOOST_CHECK_EQUAL(map.size(), 3u);
+
+  const HashMap<std::string,Uint>& const_map = *map_ptr;
+  BOOST_CHECK_EQUAL(const_map["second"], 2u);
+  BOOST_CHECK_EQUAL(const_map["third"], 3u);
+  BOOST_CHECK_EQUAL(const_map["fifth"], 5u);
+}
+
+BOOST_AUTO_TEST_CASE ( test_HashMap_dense )
+{
+  boost::shared_ptr< HashMap<boost::uint64_t,Uint> > map_ptr ( allocate_component< HashMap<boost::uint64_t,Uint> > ("map"));
+  HashMap<boost::uint64_t,Uint>& map = *map_ptr;
+
+  // Contiguous keys don't need the hash table
+  for(Uint i = 0; i != 100; ++i)
+    map.push_back(1000+i, i);
+  BOOST_CHECK(map.is_dense());
+  BOOST_CHECK(!map.exists(999));
+  BOOST_CHECK(!map.exists(1100));
+  for(Uint i = 0; i != 100; ++i)
+    BOOST_CHECK_EQUAL(map.find(1000+i)->second, i);
+
+  // Removing the last key keeps the sequence contiguous
+  BOOST_CHECK(map.erase(1099));
+  BOOST_CHECK(map.is_dense());
+  BOOST_CHECK(!map.exists(1099));
+
+  // A gap switches to hashing, without losing the existing keys
+  map.push_back(5, 99);
+  BOOST_CHECK(!map.is_dense());
+  BOOST_CHECK_EQUAL(map.size(), 100u);
+  BOOST_CHECK_EQUAL(map[5], 99u);
+  for(Uint i = 0; i != 99; ++i)
+    BOOST_CHECK_EQUAL(map.find(1000+i)->second, i);
+
+  map.clear();
+  BOOST_CHECK(map.is_dense());
+  BOOST_CHECK_EQUAL(map.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE ( test_HashMap_erase_many )
+{
+  boost::shared_ptr< HashMap<boost::uint64_t,Uint> > map_ptr ( allocate_component< HashMap<boost::uint64_t,Uint> > ("map"));
+  HashMap<boost::uint64_t,Uint>& map = *map_ptr;
+
+  const Uint nb_keys = 10000;
+  for(Uint i = 0; i != nb_keys; ++i)
+    map.push_back(7*i, i);
+  BOOST_CHECK_EQUAL(map.size(), nb_keys);
+
+  // Erase every third key, then check all remaining lookups
+  for(Uint i = 0; i < nb_keys; i += 3)
+    BOOST_CHECK(map.erase(7*i));
+
+  Uint nb_left = 0;
+  for(Uint i = 0; i != nb_keys; ++i)
+  {
+    if(i % 3 == 0)
+    {
+      BOOST_CHECK(!map.exists(7*i));
+    }
+    else
+    {
+      ++nb_left;
+      BOOST_CHECK(map.exists(7*i));
+      BOOST_CHECK_EQUAL(map[7*i], i);
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_left);
+
+  // Batched lookup
+  std::vector<boost::uint64_t> keys;
+  keys.push_back(7);
+  keys.push_back(0);
+  keys.push_back(14);
+  keys.push_back(3);
+  std::vector<Uint> result;
+  BOOST_CHECK_EQUAL(map.find(keys, result, 12345u), 2u);
+  BOOST_CHECK_EQUAL(result.size(), 4u);
+  BOOST_CHECK_EQUAL(result[0], 1u);
+  BOOST_CHECK_EQUAL(result[1], 12345u);
+  BOOST_CHECK_EQUAL(result[2], 2u);
+  BOOST_CHECK_EQUAL(result[3], 12345u);
+}
+
+BOOST_AUTO_TEST_CASE ( test_HashMap_copy_std_map )
+{
+  boost::shared_ptr< HashMap<std::string,int> > map_ptr ( allocate_component< HashMap<std::string,int> > ("map"));
+  HashMap<std::string,int>& map = *map_ptr;
+
+  BOOST_CHECK_EQUAL(map.type_name() , "HashMap<string,integer>");
+
+  std::map<std::string,int> stl_map;
+  stl_map["first"] = 1;
+  stl_map["second"] = 2;
+  stl_map["third"] = 3;
+  stl_map["fourth"] = 4;
+
+  map.copy_std_map(stl_map);
+  BOOST_CHECK_EQUAL(map.size(), 4u);
+  BOOST_CHECK_EQUAL(map["third"], 3);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,7 @@
 #include "common/PE/CommPattern.hpp"
 #include "common/PE/debug.hpp"
 #include "common/Group.hpp"
+#include "common/OptionList.hpp"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -212,6 +213,145 @@ BOOST_AUTO_TEST_CASE( commpattern_mainstream )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( commpattern_neighbour_exchange )
+{
+  // general constants in this routine
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // two identical commpatterns, one using the global all_to_all and one the neighbour exchange
+  boost::shared_ptr<CommPattern> global_ptr = allocate_component<CommPattern>("GlobalCommPattern");
+  boost::shared_ptr<CommPattern> neighbour_ptr = allocate_component<CommPattern>("NeighbourCommPattern");
+  global_ptr->options().set("neighbour_exchange", false);
+  neighbour_ptr->options().set("neighbour_exchange", true);
+
+  std::vector<Uint> global_gid, neighbour_gid;
+  std::vector<Uint> global_rank, neighbour_rank;
+  setupGidAndRank(global_gid,global_rank);
+  setupGidAndRank(neighbour_gid,neighbour_rank);
+  global_ptr->insert("gid",global_gid,1,false);
+  neighbour_ptr->insert("gid",neighbour_gid,1,false);
+
+  std::vector<double> global_v, neighbour_v;
+  for(int i=0;i<18*nproc;i++) global_v.push_back((double)((irank+1)*1000+i+1));
+  neighbour_v = global_v;
+  global_ptr->insert("v",global_v,3,true);
+  neighbour_ptr->insert("v",neighbour_v,3,true);
+
+  global_ptr->setup(Handle<CommWrapper>(global_ptr->get_child("gid")),global_rank);
+  neighbour_ptr->setup(Handle<CommWrapper>(neighbour_ptr->get_child("gid")),neighbour_rank);
+
+  // synchronize twice, the second time reusing the buffers from the first
+  for(int sync=0; sync<2; sync++)
+  {
+    global_ptr->synchronize("v");
+    neighbour_ptr->synchronize("v");
+
+    BOOST_CHECK_EQUAL(global_v.size(), neighbour_v.size());
+    for(int i=0;i<(const int)global_v.size();i++)
+      BOOST_CHECK_EQUAL(global_v[i], neighbour_v[i]);
+
+    // modify the data, so the next synchronization actually transfers something new
+    for(int i=0;i<(const int)global_v.size();i++)
+    {
+      global_v[i] += 0.5;
+      neighbour_v[i] += 0.5;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( commpattern_split_phase )
+{
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // reference data synchronized in one go, and a copy synchronized in two phases
+  boost::shared_ptr<CommPattern> pecp_ptr = allocate_component<CommPattern>("SplitPhaseCommPattern");
+  CommPattern& pecp = *pecp_ptr;
+
+  std::vector<Uint> gid;
+  std::vector<Uint> rank;
+  setupGidAndRank(gid,rank);
+  pecp.insert("gid",gid,1,false);
+
+  std::vector<int> blocking;
+  for(int i=0;i<6*nproc;i++) blocking.push_back(-((irank+1)*1000+i+1));
+  std::vector<int> split = blocking;
+  // same data with an offset, in flight together with split so the messages of both must not be mixed up
+  std::vector<int> split_offset = blocking;
+  for(int i=0;i<(const int)split_offset.size();i++) split_offset[i] -= 100000;
+  pecp.insert("blocking",blocking,1,true);
+  pecp.insert("split",split,1,true);
+  pecp.insert("split_offset",split_offset,1,true);
+  pecp.setup(Handle<CommWrapper>(pecp.get_child("gid")),rank);
+
+  pecp.begin_synchronize("split");
+  pecp.begin_synchronize("split_offset");
+  BOOST_CHECK(pecp.is_synchronizing("split"));
+  BOOST_CHECK(!pecp.is_synchronizing("blocking"));
+  BOOST_CHECK_THROW(pecp.begin_synchronize("split"), ShouldNotBeHere);
+  pecp.synchronize("blocking");
+  pecp.end_synchronize("split_offset");
+  pecp.end_synchronize("split");
+  BOOST_CHECK(!pecp.is_synchronizing("split"));
+  BOOST_CHECK_THROW(pecp.end_synchronize("split"), ShouldNotBeHere);
+
+  for(int i=0;i<(const int)blocking.size();i++)
+  {
+    BOOST_CHECK_EQUAL(blocking[i], split[i]);
+    BOOST_CHECK_EQUAL(blocking[i]-100000, split_offset[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( commpattern_split_phase_two_patterns )
+{
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // two patterns with the same layout, each with one object, so both objects use the same tag
+  boost::shared_ptr<CommPattern> first_ptr = allocate_component<CommPattern>("FirstCommPattern");
+  boost::shared_ptr<CommPattern> second_ptr = allocate_component<CommPattern>("SecondCommPattern");
+
+  std::vector<Uint> first_gid, second_gid;
+  std::vector<Uint> first_rank, second_rank;
+  setupGidAndRank(first_gid,first_rank);
+  setupGidAndRank(second_gid,second_rank);
+  first_ptr->insert("gid",first_gid,1,false);
+  second_ptr->insert("gid",second_gid,1,false);
+
+  std::vector<int> blocking;
+  for(int i=0;i<6*nproc;i++) blocking.push_back(-((irank+1)*1000+i+1));
+  std::vector<int> first = blocking;
+  std::vector<int> second = blocking;
+  for(int i=0;i<(const int)second.size();i++) second[i] -= 100000;
+  first_ptr->insert("v",first,1,true);
+  second_ptr->insert("v",second,1,true);
+  first_ptr->insert("blocking",blocking,1,true);
+  first_ptr->setup(Handle<CommWrapper>(first_ptr->get_child("gid")),first_rank);
+  second_ptr->setup(Handle<CommWrapper>(second_ptr->get_child("gid")),second_rank);
+
+  // the ranks start and finish the exchanges in a different order
+  CommPattern& begin_first = irank%2==0 ? *first_ptr : *second_ptr;
+  CommPattern& begin_second = irank%2==0 ? *second_ptr : *first_ptr;
+  begin_first.begin_synchronize("v");
+  begin_second.begin_synchronize("v");
+  begin_second.end_synchronize("v");
+  begin_first.end_synchronize("v");
+  first_ptr->synchronize("blocking");
+
+  for(int i=0;i<(const int)blocking.size();i++)
+  {
+    BOOST_CHECK_EQUAL(blocking[i], first[i]);
+    BOOST_CHECK_EQUAL(blocking[i]-100000, second[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( commpattern_external_synchronization )
 {
 /*
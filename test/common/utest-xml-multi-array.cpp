@@ -0,0 +1,176 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for XML multi-arrays, as text and as binary attachments"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/BoostArray.hpp"
+
+#include "common/XML/BinaryAttachments.hpp"
+#include "common/XML/FileOperations.hpp"
+#include "common/XML/MultiArray.hpp"
+#include "common/XML/Protocol.hpp"
+#include "common/XML/SignalFrame.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::XML;
+
+/////////////////////////////////////////////////////////////////////////////
+
+struct MultiArrayFixture
+{
+  MultiArrayFixture() :
+    table(boost::extents[1000][3])
+  {
+    labels.push_back("x");
+    labels.push_back("y");
+    labels.push_back("z");
+
+    for(Uint row = 0; row != table.size(); ++row)
+    {
+      table[row][0] = row;
+      table[row][1] = 1. / (row + 1.);
+      table[row][2] = -0.1 * row;
+    }
+  }
+
+  void check_table(const boost::multi_array<Real, 2>& result, const std::vector<std::string>& result_labels)
+  {
+    BOOST_CHECK(result_labels == labels);
+    BOOST_REQUIRE_EQUAL(result.shape()[0], table.shape()[0]);
+    BOOST_REQUIRE_EQUAL(result.shape()[1], table.shape()[1]);
+    for(Uint row = 0; row != table.size(); ++row)
+      for(Uint col = 0; col != 3; ++col)
+        BOOST_CHECK_EQUAL(result[row][col], table[row][col]);
+  }
+
+  boost::multi_array<Real, 2> table;
+  std::vector<std::string> labels;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( XmlMultiArray_TestSuite, MultiArrayFixture )
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( text )
+{
+  SignalFrame frame("plot", "cpath:/", "cpath:/");
+  add_multi_array_in(frame.main_map, "Table", table, ";", labels);
+
+  BOOST_CHECK(frame.attachments->empty());
+
+  boost::multi_array<Real, 2> result;
+  std::vector<std::string> result_labels;
+  get_multi_array(frame.main_map, "Table", result, result_labels);
+
+  // the text representation is not exact, check the exactly represented column only
+  BOOST_REQUIRE_EQUAL(result.size(), table.size());
+  for(Uint row = 0; row != table.size(); ++row)
+    BOOST_CHECK_EQUAL(result[row][0], table[row][0]);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( binary )
+{
+  SignalFrame frame("plot", "cpath:/", "cpath:/");
+  SignalFrame reply = frame.create_reply();
+  SignalFrame& options = reply.map( Protocol::Tags::key_options() );
+
+  // the reply and its maps use the attachments of the frame
+  BOOST_CHECK_EQUAL(reply.attachments, frame.attachments);
+  BOOST_CHECK_EQUAL(options.attachments, frame.attachments);
+
+  add_multi_array_in(options.main_map, "Raw", table, *options.attachments, false, labels);
+  add_multi_array_in(options.main_map, "Compressed", table, *options.attachments, true, labels);
+
+  BOOST_CHECK_EQUAL(frame.attachments->size(), 2u);
+  BOOST_CHECK_EQUAL(frame.attachments->block(0)->size(), table.num_elements() * sizeof(Real));
+  BOOST_CHECK_LT(frame.attachments->block(1)->size(), frame.attachments->block(0)->size());
+
+  // the values are not in the XML
+  std::string xml_str;
+  to_string(*frame.xml_doc, xml_str);
+  BOOST_CHECK_LT(xml_str.size(), 2048u);
+
+  boost::multi_array<Real, 2> result;
+  std::vector<std::string> result_labels;
+
+  get_multi_array(options.main_map, "Raw", result, result_labels, *options.attachments);
+  check_table(result, result_labels);
+
+  result_labels.clear();
+  get_multi_array(frame.get_reply().map( Protocol::Tags::key_options() ).main_map, "Compressed", result, result_labels, *frame.attachments);
+  check_table(result, result_labels);
+
+  // reading without the attachments is an error
+  BOOST_CHECK_THROW(get_multi_array(options.main_map, "Raw", result, result_labels), XmlError);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( parsed_frame )
+{
+  SignalFrame frame("plot", "cpath:/", "cpath:/");
+  add_multi_array_in(frame.map("options").main_map, "Table", table, *frame.attachments, true, labels);
+
+  // a received frame gets the blocks from the transport, without copy
+  std::string xml_str;
+  to_string(*frame.xml_doc, xml_str);
+  SignalFrame received(parse_string(xml_str));
+  BOOST_CHECK(received.attachments->empty());
+  BOOST_CHECK_EQUAL(received.map("options").attachments, received.attachments);
+
+  received.attachments->add(frame.attachments->block(0));
+  BOOST_CHECK_EQUAL(received.attachments->block(0), frame.attachments->block(0));
+
+  boost::multi_array<Real, 2> result;
+  std::vector<std::string> result_labels;
+  get_multi_array(received.map("options").main_map, "Table", result, result_labels, *received.attachments);
+  check_table(result, result_labels);
+
+  // corrupt block
+  BinaryAttachments truncated;
+  truncated.add(&(*frame.attachments->block(0))[0], frame.attachments->block(0)->size() / 2, false);
+  BOOST_CHECK_THROW(get_multi_array(received.map("options").main_map, "Table", result, result_labels, truncated), ParsingFailed);
+
+  BinaryAttachments empty;
+  BOOST_CHECK_THROW(get_multi_array(received.map("options").main_map, "Table", result, result_labels, empty), ValueNotFound);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE ( storage_order )
+{
+  // column-major arrays are converted to and from the row-major binary layout
+  boost::multi_array<Real, 2> fortran_table(boost::extents[table.shape()[0]][table.shape()[1]], boost::fortran_storage_order());
+  fortran_table = table;
+
+  SignalFrame frame("plot", "cpath:/", "cpath:/");
+  add_multi_array_in(frame.main_map, "Table", fortran_table, *frame.attachments, false, labels);
+
+  boost::multi_array<Real, 2> result;
+  std::vector<std::string> result_labels;
+  get_multi_array(frame.main_map, "Table", result, result_labels, *frame.attachments);
+  check_table(result, result_labels);
+
+  boost::multi_array<Real, 2> fortran_result(boost::extents[0][0], boost::fortran_storage_order());
+  result_labels.clear();
+  get_multi_array(frame.main_map, "Table", fortran_result, result_labels, *frame.attachments);
+  check_table(fortran_result, result_labels);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/////////////////////////////////////////////////////////////////////////////
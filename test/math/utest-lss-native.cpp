@@ -0,0 +1,562 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the native cf3::math::LSS backend"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/test/unit_test.hpp>
+#include <boost/assign/std/vector.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/LSS/ScatterMap.hpp"
+#include "math/LSS/System.hpp"
+#include "math/LSS/SolutionStrategy.hpp"
+#include "math/LSS/Native/NativeCrsMatrix.hpp"
+#include "math/LSS/Native/NativeEBEMatrix.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace boost::assign;
+
+using namespace cf3;
+using namespace cf3::math;
+using namespace cf3::math::LSS;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// 1D Laplacian with 10 nodes, split over two ranks that each own 5 nodes and see one ghost node
+struct LSSNativeFixture
+{
+  LSSNativeFixture() :
+    irank(0),
+    nproc(1),
+    nb_local_nodes(6),
+    nb_assemblies(0)
+  {
+    if (common::PE::Comm::instance().is_initialized())
+    {
+      nproc=common::PE::Comm::instance().size();
+      irank=common::PE::Comm::instance().rank();
+      BOOST_CHECK_EQUAL(nproc,2);
+    }
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// Global index of a local node
+  Uint global_node(const Uint local) const
+  {
+    return irank == 0 ? local : local + 4;
+  }
+
+  /// create the commpattern
+  void build_commpattern(common::PE::CommPattern& cp)
+  {
+    for(Uint i = 0; i != nb_local_nodes; ++i)
+    {
+      gid.push_back(global_node(i));
+      rank_updatable.push_back(global_node(i) < 5 ? 0 : 1);
+    }
+    cp.insert("gid",gid,1,false);
+    cp.setup(Handle<common::PE::CommWrapper>(cp.get_child("gid")),rank_updatable);
+  }
+
+  /// Build the system and assemble the Laplacian with the given coupling block, fixing the first and last nodes
+  boost::shared_ptr<LSS::System> build_system(common::PE::CommPattern& cp, const RealMatrix& coupling, const RealVector& left, const RealVector& right, const std::string& matrix_builder = "cf3.math.LSS.NativeCrsMatrix")
+  {
+    const Uint neq = coupling.rows();
+    std::vector<Uint> node_connectivity, starting_indices;
+    starting_indices.push_back(0);
+    for(Uint i = 0; i != nb_local_nodes; ++i)
+    {
+      if(i != 0)
+        node_connectivity.push_back(i-1);
+      node_connectivity.push_back(i);
+      if(i != nb_local_nodes-1)
+        node_connectivity.push_back(i+1);
+      starting_indices.push_back(node_connectivity.size());
+    }
+
+    boost::shared_ptr<LSS::System> sys(common::allocate_component<LSS::System>("sys"));
+    sys->options().set("matrix_builder", matrix_builder);
+    sys->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    sys->create(cp,neq,node_connectivity,starting_indices);
+    BOOST_CHECK(sys->is_created());
+    BOOST_CHECK_EQUAL(sys->solvertype(), "Native");
+
+    // The matrix-free matrix calls the element loop each time the operator is evaluated, for the assembled matrix it runs once
+    Handle<LSS::Matrix> matrix = sys->matrix();
+    const Uint nb_elements = nb_local_nodes-1;
+    Uint& assembly_count = nb_assemblies;
+    boost::function<void ()> assemble = [matrix, coupling, neq, nb_elements, &assembly_count]()
+    {
+      BlockAccumulator acc;
+      acc.resize(2, neq);
+      for(Uint e = 0; e != nb_elements; ++e)
+      {
+        acc.reset();
+        acc.indices[0] = e;
+        acc.indices[1] = e+1;
+        for(Uint i = 0; i != 2; ++i)
+          for(Uint j = 0; j != 2; ++j)
+            acc.mat.block(i*neq, j*neq, neq, neq) = (i == j ? 1. : -1.) * coupling;
+        matrix->add_values(acc);
+      }
+      ++assembly_count;
+    };
+    Handle<NativeEBEMatrix> ebe_matrix(matrix);
+    if(is_not_null(ebe_matrix))
+      ebe_matrix->set_assembly(assemble);
+    assemble();
+
+    for(Uint eq = 0; eq != neq; ++eq)
+    {
+      if(irank == 0)
+        sys->dirichlet(0, eq, left[eq], true);
+      else
+        sys->dirichlet(nb_local_nodes-1, eq, right[eq], true);
+    }
+
+    return sys;
+  }
+
+  /// Check the solution against the exact linear solution, including the ghost node
+  void check_solution(LSS::System& sys, const RealVector& left, const RealVector& right)
+  {
+    const Uint neq = left.size();
+    for(Uint i = 0; i != nb_local_nodes; ++i)
+    {
+      const Real x = static_cast<Real>(global_node(i)) / 9.;
+      for(Uint eq = 0; eq != neq; ++eq)
+      {
+        Real val;
+        sys.solution()->get_value(i, eq, val);
+        BOOST_CHECK_SMALL(val - (left[eq] + x*(right[eq] - left[eq])), 1e-6);
+      }
+    }
+  }
+
+  int irank;
+  int nproc;
+  int m_argc;
+  char** m_argv;
+  const Uint nb_local_nodes;
+  /// Number of times the element loop of build_system was executed
+  Uint nb_assemblies;
+
+  std::vector<Uint> gid;
+  std::vector<Uint> rank_updatable;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( LSSNativeSuite, LSSNativeFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  common::PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK_EQUAL(common::PE::Comm::instance().is_active(),true);
+  common::Core::instance().environment().options().set("exception_backtrace", false);
+  common::Core::instance().environment().options().set("exception_outputs", false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( apply )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+  build_commpattern(*cp);
+
+  RealMatrix coupling(1,1);
+  coupling(0,0) = 1.;
+  RealVector left(1), right(1);
+  left[0] = 0.;
+  right[0] = 1.;
+  boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right);
+
+  // A*x for x equal to the global node index, only the interior rows of the Laplacian vanish
+  for(Uint i = 0; i != nb_local_nodes; ++i)
+    sys->solution()->set_value(i, 0, global_node(i));
+  sys->rhs()->reset(1.);
+  sys->matrix()->apply(sys->rhs(), sys->solution(), 2., 1.);
+
+  for(Uint i = 0; i != nb_local_nodes; ++i)
+  {
+    const Uint gnode = global_node(i);
+    if((irank == 0 && gnode > 4) || (irank == 1 && gnode < 5))
+      continue;
+
+    Real val;
+    sys->rhs()->get_value(i, 0, val);
+    if(gnode == 0 || gnode == 9)
+      BOOST_CHECK_CLOSE(val, 1. + 2.*gnode, 1e-10);
+    else if(gnode == 1)
+      BOOST_CHECK_CLOSE(val, 1. + 2.*(2.*gnode - (gnode+1)), 1e-10); // the column of node 0 was eliminated
+    else if(gnode == 8)
+      BOOST_CHECK_CLOSE(val, 1. + 2.*(2.*gnode - (gnode-1)), 1e-10); // the column of node 9 was eliminated
+    else
+      BOOST_CHECK_CLOSE(val, 1., 1e-10);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( scalar_solvers )
+{
+  std::vector<std::string> solvers, preconditioners;
+  solvers += "CG", "BiCGStab", "GMRES";
+  preconditioners += "None", "Jacobi", "BlockJacobi", "ILU0";
+
+  RealMatrix coupling(1,1);
+  coupling(0,0) = 1.;
+  RealVector left(1), right(1);
+  left[0] = 0.;
+  right[0] = 1.;
+
+  BOOST_FOREACH(const std::string& solver, solvers)
+  {
+    BOOST_FOREACH(const std::string& preconditioner, preconditioners)
+    {
+      boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+      gid.clear();
+      rank_updatable.clear();
+      build_commpattern(*cp);
+      boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right);
+      sys->solution_strategy()->options().set("solver", solver);
+      sys->solution_strategy()->options().set("preconditioner", preconditioner);
+      sys->solution_strategy()->options().set("nb_threads", 2u);
+      sys->solve();
+      BOOST_CHECK_SMALL(sys->solution_strategy()->compute_residual(), 1e-8);
+      check_solution(*sys, left, right);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( block_solvers )
+{
+  std::vector<std::string> solvers, preconditioners;
+  solvers += "BiCGStab", "GMRES";
+  preconditioners += "Jacobi", "BlockJacobi", "ILU0";
+
+  RealMatrix coupling(2,2);
+  coupling << 2., 1.,
+              1., 2.;
+  RealVector left(2), right(2);
+  left << 0., 2.;
+  right << 1., -1.;
+
+  BOOST_FOREACH(const std::string& solver, solvers)
+  {
+    BOOST_FOREACH(const std::string& preconditioner, preconditioners)
+    {
+      boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+      gid.clear();
+      rank_updatable.clear();
+      build_commpattern(*cp);
+      boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right);
+      sys->solution_strategy()->options().set("solver", solver);
+      sys->solution_strategy()->options().set("preconditioner", preconditioner);
+      sys->solve();
+      check_solution(*sys, left, right);
+
+      const NativeStrategy& strategy = dynamic_cast<const NativeStrategy&>(*sys->solution_strategy());
+      BOOST_CHECK(strategy.iterations() > 0);
+      BOOST_CHECK(strategy.relative_residual() < 1e-8);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( scatter_assembly )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+  build_commpattern(*cp);
+
+  RealMatrix coupling(2,2);
+  coupling << 2., 1.,
+              1., 2.;
+  RealVector left(2), right(2);
+  left << 0., 2.;
+  right << 1., -1.;
+  boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right);
+  Matrix& matrix = *sys->matrix();
+  matrix.reset();
+
+  // Reference assembly, with an element matrix that differs per entry
+  const Uint nb_elements = nb_local_nodes-1;
+  BlockAccumulator acc;
+  acc.resize(2, 2);
+  for(Uint e = 0; e != nb_elements; ++e)
+  {
+    acc.indices[0] = e;
+    acc.indices[1] = e+1;
+    for(Uint i = 0; i != 4; ++i)
+      for(Uint j = 0; j != 4; ++j)
+        acc.mat(i,j) = 1. + i*4 + j + e*16;
+    matrix.add_values(acc);
+  }
+  std::vector<Uint> ref_rows, ref_cols;
+  std::vector<Real> ref_values;
+  matrix.debug_data(ref_rows, ref_cols, ref_values);
+
+  ScatterMap scatter_map;
+  BOOST_CHECK(scatter_map.setup(matrix, nb_elements, 2));
+  const Uint generation = matrix.sparsity_generation();
+
+  // Assemble twice, the second time using the cached offsets
+  for(Uint pass = 0; pass != 2; ++pass)
+  {
+    matrix.reset();
+    BOOST_CHECK(scatter_map.setup(matrix, nb_elements, 2));
+    for(Uint e = 0; e != nb_elements; ++e)
+    {
+      acc.indices[0] = e;
+      acc.indices[1] = e+1;
+      for(Uint i = 0; i != 4; ++i)
+        for(Uint j = 0; j != 4; ++j)
+          acc.mat(i,j) = 1. + i*4 + j + e*16;
+      scatter_map.add_values(e, acc);
+    }
+
+    std::vector<Uint> rows, cols;
+    std::vector<Real> values;
+    matrix.debug_data(rows, cols, values);
+    BOOST_CHECK(rows == ref_rows);
+    BOOST_CHECK(cols == ref_cols);
+    BOOST_CHECK(values == ref_values);
+  }
+  BOOST_CHECK_EQUAL(matrix.sparsity_generation(), generation);
+
+  // Creating the system again changes the sparsity generation
+  sys = build_system(*cp, coupling, left, right);
+  BOOST_CHECK(sys->matrix()->sparsity_generation() != generation);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( ebe_matrix )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+  build_commpattern(*cp);
+
+  RealMatrix coupling(2,2);
+  coupling << 2., 1.,
+              1., 2.;
+  RealVector left(2), right(2);
+  left << 0., 2.;
+  right << 1., -1.;
+  boost::shared_ptr<LSS::System> crs_sys = build_system(*cp, coupling, left, right);
+  boost::shared_ptr<LSS::System> ebe_sys = build_system(*cp, coupling, left, right, "cf3.math.LSS.NativeEBEMatrix");
+  BOOST_CHECK_EQUAL(ebe_sys->solvertype(), "Native");
+  NativeEBEMatrix& ebe_matrix = dynamic_cast<NativeEBEMatrix&>(*ebe_sys->matrix());
+
+  // The dirichlet columns are only moved to the RHS on request, which evaluates the operator once
+  nb_assemblies = 0;
+  ebe_matrix.eliminate_dirichlet_columns();
+  BOOST_CHECK_EQUAL(nb_assemblies, 1u);
+  ebe_matrix.eliminate_dirichlet_columns();
+  BOOST_CHECK_EQUAL(nb_assemblies, 1u);
+
+  // Same entries, including the eliminated dirichlet columns
+  std::vector<Uint> crs_rows, crs_cols, ebe_rows, ebe_cols;
+  std::vector<Real> crs_values, ebe_values;
+  crs_sys->matrix()->debug_data(crs_rows, crs_cols, crs_values);
+  ebe_sys->matrix()->debug_data(ebe_rows, ebe_cols, ebe_values);
+  BOOST_CHECK(crs_rows == ebe_rows);
+  BOOST_CHECK(crs_cols == ebe_cols);
+  BOOST_REQUIRE_EQUAL(crs_values.size(), ebe_values.size());
+  for(Uint i = 0; i != crs_values.size(); ++i)
+    BOOST_CHECK_SMALL(crs_values[i] - ebe_values[i], 1e-14);
+
+  // Same RHS after the dirichlet conditions, and the same product
+  for(Uint i = 0; i != nb_local_nodes; ++i)
+  {
+    for(Uint eq = 0; eq != 2; ++eq)
+    {
+      Real crs_val, ebe_val;
+      crs_sys->rhs()->get_value(i, eq, crs_val);
+      ebe_sys->rhs()->get_value(i, eq, ebe_val);
+      BOOST_CHECK_SMALL(crs_val - ebe_val, 1e-14);
+      crs_sys->solution()->set_value(i, eq, global_node(i) + eq*0.5);
+      ebe_sys->solution()->set_value(i, eq, global_node(i) + eq*0.5);
+    }
+  }
+  crs_sys->rhs()->reset(1.);
+  ebe_sys->rhs()->reset(1.);
+  crs_sys->matrix()->apply(crs_sys->rhs(), crs_sys->solution(), 2., 0.5);
+  nb_assemblies = 0;
+  ebe_sys->matrix()->apply(ebe_sys->rhs(), ebe_sys->solution(), 2., 0.5);
+  BOOST_CHECK_EQUAL(nb_assemblies, 1u);
+  std::vector<Real> crs_result, ebe_result;
+  crs_sys->rhs()->debug_data(crs_result);
+  ebe_sys->rhs()->debug_data(ebe_result);
+  BOOST_REQUIRE_EQUAL(crs_result.size(), ebe_result.size());
+  for(Uint i = 0; i != crs_result.size(); ++i)
+    BOOST_CHECK_SMALL(crs_result[i] - ebe_result[i], 1e-12);
+
+  // Diagonal modifications
+  std::vector<Real> diag(nb_local_nodes*2, 0.5), crs_diag, ebe_diag;
+  crs_sys->matrix()->add_diagonal(diag);
+  ebe_sys->matrix()->add_diagonal(diag);
+  crs_sys->matrix()->get_diagonal(crs_diag);
+  ebe_sys->matrix()->get_diagonal(ebe_diag);
+  BOOST_CHECK(crs_diag == ebe_diag);
+
+  // Entries of assembled matrices can't be modified
+  BOOST_CHECK_THROW(ebe_sys->matrix()->add_value(0, 0, 1.), common::NotSupported);
+
+  // No element matrices are stored: the diagonal shift and replaced diagonal per equation, the node layout,
+  // the two eliminated columns with their saved value and three flags per equation or node
+  const Uint nb_dofs = nb_local_nodes*2;
+  const Uint ebe_size = ebe_matrix.storage_size();
+  BOOST_CHECK_EQUAL(ebe_size, (2*nb_dofs + 2)*sizeof(Real) + (nb_local_nodes + ebe_matrix.owned_nodes().size() + 2)*sizeof(Uint) + (nb_local_nodes + 2*nb_dofs + 7)/8);
+  const NativeCrsMatrix& crs_matrix = dynamic_cast<const NativeCrsMatrix&>(*crs_sys->matrix());
+  const Uint crs_size = crs_matrix.values().size()*sizeof(Real)
+    + (crs_matrix.columns().size() + crs_matrix.row_starts().size() + crs_matrix.diagonal_positions().size())*sizeof(Uint);
+  BOOST_CHECK_LT(ebe_size, crs_size);
+  CFinfo << "EBE storage: " << ebe_size << " bytes, CRS storage: " << crs_size << " bytes, ratio " << static_cast<Real>(ebe_size) / static_cast<Real>(crs_size) << CFendl;
+
+  // The assembly is run for each product, so it may only pass element matrices
+  LSS::Matrix& ebe_base = ebe_matrix;
+  ebe_matrix.set_assembly([&ebe_base, nb_dofs]() { ebe_base.add_diagonal(std::vector<Real>(nb_dofs, 1.)); });
+  BOOST_CHECK_THROW(ebe_sys->matrix()->apply(ebe_sys->rhs(), ebe_sys->solution()), common::SetupError);
+  BOOST_CHECK(!ebe_matrix.is_evaluating());
+  ebe_matrix.set_assembly([&ebe_base]() { ebe_base.set_row(0, 0, 1., 0.); });
+  BOOST_CHECK_THROW(ebe_sys->matrix()->apply(ebe_sys->rhs(), ebe_sys->solution()), common::SetupError);
+
+  // The operator can't be evaluated without an assembly function
+  ebe_matrix.set_assembly(boost::function<void ()>());
+  BOOST_CHECK_THROW(ebe_sys->matrix()->apply(ebe_sys->rhs(), ebe_sys->solution()), common::SetupError);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( ebe_solvers )
+{
+  std::vector<std::string> solvers, preconditioners;
+  solvers += "CG", "BiCGStab", "GMRES";
+  preconditioners += "None", "Jacobi", "BlockJacobi", "Chebyshev";
+
+  RealMatrix coupling(2,2);
+  coupling << 2., 1.,
+              1., 2.;
+  RealVector left(2), right(2);
+  left << 0., 2.;
+  right << 1., -1.;
+
+  BOOST_FOREACH(const std::string& solver, solvers)
+  {
+    BOOST_FOREACH(const std::string& preconditioner, preconditioners)
+    {
+      boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+      gid.clear();
+      rank_updatable.clear();
+      build_commpattern(*cp);
+      boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right, "cf3.math.LSS.NativeEBEMatrix");
+      sys->solution_strategy()->options().set("solver", solver);
+      sys->solution_strategy()->options().set("preconditioner", preconditioner);
+      sys->solution_strategy()->options().set("nb_threads", 2u);
+      sys->solve();
+      check_solution(*sys, left, right);
+      BOOST_CHECK(dynamic_cast<const NativeStrategy&>(*sys->solution_strategy()).relative_residual() < 1e-8);
+    }
+  }
+
+  // Chebyshev on the assembled matrix gives the same number of iterations
+  boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+  gid.clear();
+  rank_updatable.clear();
+  build_commpattern(*cp);
+  boost::shared_ptr<LSS::System> crs_sys = build_system(*cp, coupling, left, right);
+  boost::shared_ptr<LSS::System> ebe_sys = build_system(*cp, coupling, left, right, "cf3.math.LSS.NativeEBEMatrix");
+  crs_sys->solution_strategy()->options().set("solver", std::string("CG"));
+  crs_sys->solution_strategy()->options().set("preconditioner", std::string("Chebyshev"));
+  ebe_sys->solution_strategy()->options().set("solver", std::string("CG"));
+  ebe_sys->solution_strategy()->options().set("preconditioner", std::string("Chebyshev"));
+  crs_sys->solve();
+  ebe_sys->solve();
+  check_solution(*crs_sys, left, right);
+  BOOST_CHECK_EQUAL(dynamic_cast<const NativeStrategy&>(*crs_sys->solution_strategy()).iterations(), dynamic_cast<const NativeStrategy&>(*ebe_sys->solution_strategy()).iterations());
+
+  // ILU0 needs the assembled matrix
+  ebe_sys->solution_strategy()->options().set("preconditioner", std::string("ILU0"));
+  BOOST_CHECK_THROW(ebe_sys->solve(), common::SetupError);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( repeated_solves )
+{
+  RealMatrix coupling(2,2);
+  coupling << 2., 1.,
+              1., 2.;
+  RealVector left(2), right(2);
+  left << 0., 2.;
+  right << 1., -1.;
+
+  boost::shared_ptr<common::PE::CommPattern> cp = common::allocate_component<common::PE::CommPattern>("commpattern");
+  gid.clear();
+  rank_updatable.clear();
+  build_commpattern(*cp);
+  boost::shared_ptr<LSS::System> sys = build_system(*cp, coupling, left, right, "cf3.math.LSS.NativeEBEMatrix");
+  sys->solution_strategy()->options().set("solver", std::string("CG"));
+  sys->solution_strategy()->options().set("preconditioner", std::string("Jacobi"));
+  sys->solve();
+  check_solution(*sys, left, right);
+
+  // The matrix did not change, so the operator is only evaluated for the products
+  sys->solution()->reset(0.);
+  Uint nb_assemblies_before = nb_assemblies;
+  sys->solve();
+  const Uint nb_product_assemblies = nb_assemblies - nb_assemblies_before;
+  check_solution(*sys, left, right);
+
+  // Modifying the matrix computes the diagonal for the Jacobi preconditioner again
+  sys->matrix()->add_diagonal(std::vector<Real>(nb_local_nodes*2, 0.));
+  sys->solution()->reset(0.);
+  nb_assemblies_before = nb_assemblies;
+  sys->solve();
+  BOOST_CHECK_EQUAL(nb_assemblies - nb_assemblies_before, nb_product_assemblies + 1);
+  check_solution(*sys, left, right);
+
+  // The values of the assembled matrix are tracked as well
+  boost::shared_ptr<LSS::System> crs_sys = build_system(*cp, coupling, left, right);
+  Handle<NativeCrsMatrix> crs_matrix(crs_sys->matrix());
+  const Uint generation = crs_matrix->values_generation();
+  BOOST_CHECK_EQUAL(crs_matrix->values_generation(), generation);
+  crs_matrix->add_value(4, 4, 1.);
+  BOOST_CHECK_NE(crs_matrix->values_generation(), generation);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  common::PE::Comm::instance().finalize();
+  BOOST_CHECK_EQUAL(common::PE::Comm::instance().is_active(),false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the FFT"
+
+#include <boost/test/unit_test.hpp>
+
+#include "math/Consts.hpp"
+#include "math/FFT.hpp"
+
+using namespace cf3;
+using namespace cf3::math;
+
+BOOST_AUTO_TEST_SUITE( math_fft_test_suite )
+
+BOOST_AUTO_TEST_CASE( fft_matches_dft )
+{
+  const Uint n = 32;
+  std::vector< std::complex<Real> > data(n);
+  for(Uint i = 0; i != n; ++i)
+    data[i] = std::complex<Real>(std::sin(0.3*i) + 0.1*i, std::cos(1.7*i));
+  const std::vector< std::complex<Real> > original(data);
+
+  fft(data);
+  for(Uint k = 0; k != n; ++k)
+  {
+    std::complex<Real> dft(0.);
+    for(Uint i = 0; i != n; ++i)
+      dft += original[i] * std::polar(1., -2.*Consts::pi()*static_cast<Real>(i*k)/static_cast<Real>(n));
+    BOOST_CHECK_SMALL(std::abs(data[k] - dft), 1e-10);
+  }
+
+  fft(data, true);
+  for(Uint i = 0; i != n; ++i)
+    BOOST_CHECK_SMALL(std::abs(data[i] - original[i]), 1e-12);
+
+  std::vector< std::complex<Real> > bad_size(12);
+  BOOST_CHECK_THROW(fft(bad_size), common::BadValue);
+}
+
+BOOST_AUTO_TEST_CASE( autocorrelation )
+{
+  // Power of two (FFT) and other (direct) sizes, with a stride of 2
+  const Uint sizes[] = {16, 12};
+  for(Uint s = 0; s != 2; ++s)
+  {
+    const Uint n = sizes[s];
+    std::vector<Real> values(2*n);
+    for(Uint i = 0; i != n; ++i)
+      values[2*i] = std::sin(0.9*i) + 0.05*i*i;
+
+    std::vector<Real> result(n, 1.);
+    add_circular_autocorrelation(&values[0], n, 2, &result[0]);
+    for(Uint k = 0; k != n; ++k)
+    {
+      Real expected = 1.;
+      for(Uint i = 0; i != n; ++i)
+        expected += values[2*i]*values[2*((i+k)%n)];
+      BOOST_CHECK_CLOSE(result[k], expected, 1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
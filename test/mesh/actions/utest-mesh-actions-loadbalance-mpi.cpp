@@ -0,0 +1,193 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests dynamic rebalancing with mesh::actions::LoadBalance"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Action.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+#include "common/Group.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Timer.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/actions/LoadBalance.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Tags.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Set the owned rows of the field to the global node index and the ghosts to -1, then synchronize
+/// and check that each ghost received the value of its owner
+void check_synchronize(Field& field)
+{
+  const Dictionary& dict = field.dict();
+  BOOST_REQUIRE_EQUAL(field.size(), dict.size());
+
+  for(Uint i = 0; i != field.size(); ++i)
+    field[i][0] = dict.is_ghost(i) ? -1. : static_cast<Real>(dict.glb_idx()[i]);
+
+  field.synchronize();
+
+  for(Uint i = 0; i != field.size(); ++i)
+    BOOST_CHECK_EQUAL(field[i][0], static_cast<Real>(dict.glb_idx()[i]));
+}
+
+/// Counts the mesh_changed events, which tell the solvers to rebuild their linear systems
+struct MeshChangedListener : public ConnectionManager
+{
+  MeshChangedListener() : nb_events(0)
+  {
+    Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &MeshChangedListener::on_mesh_changed);
+  }
+
+  void on_mesh_changed(SignalArgs& args)
+  {
+    ++nb_events;
+  }
+
+  Uint nb_events;
+};
+
+/// Action that keeps the processor busy for the number of seconds given by its duration option
+class BusyAction : public Action
+{
+public:
+  BusyAction(const std::string& name) : Action(name)
+  {
+    options().add("duration", 0.);
+  }
+
+  static std::string type_name () { return "BusyAction"; }
+
+  virtual void execute()
+  {
+    const Real duration = options().value<Real>("duration");
+    Timer timer;
+    while(timer.elapsed() < duration)
+    {
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( LoadBalanceMPISuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK_EQUAL(PE::Comm::instance().size(), 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RebalanceSynchronize )
+{
+  Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator");
+  mesh_generator->options().set("mesh", Core::instance().root().uri()/"mesh");
+  mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+  mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 8));
+  Mesh& mesh = mesh_generator->generate();
+
+  // A fake timed action, looping over the interior region
+  Handle<Region> interior(mesh.topology().get_child("interior"));
+  BOOST_REQUIRE(is_not_null(interior));
+  Handle<Group> action = Core::instance().root().create_component<Group>("timed_action");
+  action->options().add("regions", std::vector<URI>(1, interior->uri()));
+  action->properties().add("timer_mean", 0.5);
+  action->properties().add("timer_count", Uint(2));
+
+  Handle<LoadBalance> load_balance = Core::instance().root().create_component<LoadBalance>("load_balance");
+  load_balance->options().set("timed_actions", std::vector<URI>(1, action->uri()));
+  load_balance->options().set("dynamic", true);
+  load_balance->transform(mesh);
+
+  // Synchronizing builds the comm pattern of the geometry dictionary
+  Field& field = mesh.geometry_fields().create_field("glb_node_idx");
+  check_synchronize(field);
+
+  // The first rank spent much more time in the action, so the mesh is repartitioned and migrated
+  MeshChangedListener listener;
+  action->properties()["timer_count"] = PE::Comm::instance().rank() == 0 ? Uint(10) : Uint(3);
+  load_balance->transform(mesh);
+  BOOST_CHECK_GT(load_balance->properties().value<Real>("imbalance"), 0.1);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Uint>("nb_rebalances"), 1u);
+  BOOST_CHECK_GE(listener.nb_events, 1u);
+  BOOST_CHECK(is_null(mesh.geometry_fields().get_child("CommPattern")));
+
+  // The field now synchronizes through a new comm pattern for the migrated nodes
+  check_synchronize(field);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The timings are measured by the action itself, so this only rebalances when the timing of actions is enabled
+BOOST_AUTO_TEST_CASE( RebalanceMeasured )
+{
+  Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("measured_generator");
+  mesh_generator->options().set("mesh", Core::instance().root().uri()/"measured_mesh");
+  mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+  mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 8));
+  Mesh& mesh = mesh_generator->generate();
+
+  Handle<BusyAction> action = Core::instance().root().create_component<BusyAction>("busy_action");
+  action->options().set("duration", PE::Comm::instance().rank() == 0 ? 0.05 : 0.005);
+
+  Handle<LoadBalance> load_balance = Core::instance().root().create_component<LoadBalance>("measured_load_balance");
+  load_balance->options().set("timed_actions", std::vector<URI>(1, action->uri()));
+  load_balance->options().set("dynamic", true);
+
+#ifdef CF3_ENABLE_COMPONENT_TIMING
+  load_balance->transform(mesh);
+
+  // The first rank spends ten times as long in the action
+  for(Uint i = 0; i != 3; ++i)
+    action->execute();
+  load_balance->transform(mesh);
+  BOOST_CHECK_GT(load_balance->properties().value<Real>("imbalance"), 0.5);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Uint>("nb_rebalances"), 1u);
+
+  // Without new executions there is no imbalance
+  load_balance->transform(mesh);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Real>("imbalance"), 0.);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Uint>("nb_rebalances"), 1u);
+#else
+  // The action is not timed, so there is nothing to measure
+  BOOST_CHECK_THROW(load_balance->transform(mesh), SetupError);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
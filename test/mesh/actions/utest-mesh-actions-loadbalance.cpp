@@ -0,0 +1,241 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests element weights for mesh::actions::LoadBalance"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/Group.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/actions/LoadBalance.hpp"
+
+#include "mesh/Elements.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshPartitioner.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Partitioner that only stores the object weights it would pass to the graph partitioning library
+class WeightsPartitioner : public MeshPartitioner
+{
+public:
+  WeightsPartitioner(const std::string& name) : MeshPartitioner(name)
+  {
+  }
+
+  static std::string type_name () { return "WeightsPartitioner"; }
+
+  virtual void build_graph()
+  {
+    object_weights.resize(nb_objects_owned_by_part(0));
+    list_of_object_weights_in_part(0, object_weights);
+  }
+
+  virtual void partition_graph()
+  {
+  }
+
+  std::vector<Real> object_weights;
+};
+
+struct LoadBalanceFixture
+{
+  LoadBalanceFixture()
+  {
+    if(is_not_null(Core::instance().root().get_child("mesh")))
+      Core::instance().root().remove_component("mesh");
+
+    Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator");
+    mesh_generator->options().set("mesh", Core::instance().root().uri()/"mesh");
+    mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+    mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 4));
+    mesh = mesh_generator->generate().handle<Mesh>();
+    Core::instance().root().remove_component("generator");
+
+    build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalNumbering","glb_numbering")->transform(*mesh);
+
+    if(is_null(partitioner))
+      partitioner = Core::instance().root().create_component<WeightsPartitioner>("partitioner");
+  }
+
+  /// Mean element weight, weighted by the number of elements
+  Real mean_element_weight()
+  {
+    Real total = 0.;
+    Uint nb_elems = 0;
+    for(Uint i = 0; i != mesh->elements().size(); ++i)
+    {
+      total += partitioner->entities_weights()[i] * mesh->elements()[i]->size();
+      nb_elems += mesh->elements()[i]->size();
+    }
+    return total / static_cast<Real>(nb_elems);
+  }
+
+  Handle<Mesh> mesh;
+  static Handle<WeightsPartitioner> partitioner;
+};
+
+Handle<WeightsPartitioner> LoadBalanceFixture::partitioner;
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( LoadBalanceSuite, LoadBalanceFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( UniformWeights )
+{
+  partitioner->transform(*mesh);
+  BOOST_CHECK(!partitioner->has_object_weights());
+  BOOST_CHECK_EQUAL(partitioner->object_weights.size(), partitioner->nb_objects_owned_by_part(0));
+  boost_foreach(const Real w, partitioner->object_weights)
+    BOOST_CHECK_EQUAL(w, 1.);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( NodesCostModel )
+{
+  partitioner->options().set("cost_model", std::string("Nodes"));
+  partitioner->options().set("node_weight", 0.5);
+  partitioner->transform(*mesh);
+  BOOST_CHECK(partitioner->has_object_weights());
+
+  // Quads have twice the weight of the boundary lines, and the mean is 1
+  const std::vector< Handle<Entities> >& entities = mesh->elements();
+  for(Uint i = 0; i != entities.size(); ++i)
+  {
+    for(Uint j = 0; j != entities.size(); ++j)
+    {
+      const Real nodes_ratio = static_cast<Real>(entities[i]->element_type().nb_nodes()) / static_cast<Real>(entities[j]->element_type().nb_nodes());
+      BOOST_CHECK_CLOSE(partitioner->entities_weights()[i] / partitioner->entities_weights()[j], nodes_ratio, 1e-10);
+    }
+  }
+  BOOST_CHECK_CLOSE(mean_element_weight(), 1., 1e-10);
+
+  // The nodes come first, followed by the elements in the order of Mesh::elements()
+  const Uint nb_nodes = mesh->geometry_fields().size();
+  Uint obj = 0;
+  for(; obj != nb_nodes; ++obj)
+    BOOST_CHECK_EQUAL(partitioner->object_weights[obj], 0.5);
+  for(Uint i = 0; i != entities.size(); ++i)
+  {
+    for(Uint e = 0; e != entities[i]->size(); ++e, ++obj)
+      BOOST_CHECK_EQUAL(partitioner->object_weights[obj], partitioner->entities_weights()[i]);
+  }
+  BOOST_CHECK_EQUAL(obj, partitioner->object_weights.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( MeasuredCosts )
+{
+  // A fake timed action, looping over the interior region
+  Handle<Region> interior(mesh->topology().get_child("interior"));
+  BOOST_REQUIRE(is_not_null(interior));
+  Handle<Group> action = Core::instance().root().create_component<Group>("timed_action");
+  action->options().add("regions", std::vector<URI>(1, interior->uri()));
+  action->properties().add("timer_mean", 0.5);
+  action->properties().add("timer_count", Uint(2));
+
+  Handle<LoadBalance> load_balance = Core::instance().root().create_component<LoadBalance>("load_balance");
+  load_balance->options().set("timed_actions", std::vector<URI>(1, action->uri()));
+  load_balance->options().set("dynamic", true);
+
+  // First execution balances the mesh and starts measuring
+  load_balance->transform(*mesh);
+
+  // Time spent since the balancing is divided over the elements of the interior region
+  action->properties()["timer_count"] = Uint(4);
+  load_balance->transform(*mesh);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Real>("imbalance"), 0.);
+  BOOST_CHECK_EQUAL(load_balance->properties().value<Uint>("nb_rebalances"), 0u);
+
+  Uint nb_interior_elements = 0;
+  boost_foreach(const Elements& elements, find_components_recursively<Elements>(*interior))
+    nb_interior_elements += elements.size();
+  BOOST_CHECK_EQUAL(nb_interior_elements, 16u);
+
+  boost_foreach(const Handle<Entities>& entities, mesh->elements())
+  {
+    const Real expected_cost = entities->parent() == interior ? 1. / static_cast<Real>(nb_interior_elements) : 0.;
+    BOOST_CHECK_CLOSE(entities->properties().value<Real>("computational_cost"), expected_cost, 1e-10);
+  }
+
+  // The measured costs are used by the partitioner, normalized to a mean of 1
+  partitioner->options().set("cost_model", std::string("Measured"));
+  partitioner->transform(*mesh);
+  for(Uint i = 0; i != mesh->elements().size(); ++i)
+  {
+    const Real weight = partitioner->entities_weights()[i];
+    if(mesh->elements()[i]->parent() == interior)
+      BOOST_CHECK_GT(weight, 1.);
+    else
+      BOOST_CHECK_EQUAL(weight, 0.);
+  }
+  BOOST_CHECK_CLOSE(mean_element_weight(), 1., 1e-10);
+
+  // An action over the complete mesh divides its time over the element components in proportion to their number of nodes
+  Handle<Group> mesh_action = Core::instance().root().create_component<Group>("mesh_action");
+  mesh_action->properties().add("timer_mean", 1.);
+  mesh_action->properties().add("timer_count", Uint(1));
+  load_balance->options().set("timed_actions", std::vector<URI>(1, mesh_action->uri()));
+  load_balance->measure_imbalance();
+  mesh_action->properties()["timer_count"] = Uint(2);
+  load_balance->measure_imbalance();
+
+  Real total_nodes = 0.;
+  boost_foreach(const Handle<Entities>& entities, mesh->elements())
+    total_nodes += static_cast<Real>(entities->element_type().nb_nodes() * entities->size());
+  Real total_cost = 0.;
+  boost_foreach(const Handle<Entities>& entities, mesh->elements())
+  {
+    const Real cost = entities->properties().value<Real>("computational_cost");
+    BOOST_CHECK_CLOSE(cost, static_cast<Real>(entities->element_type().nb_nodes()) / total_nodes, 1e-10);
+    total_cost += cost * static_cast<Real>(entities->size());
+  }
+  BOOST_CHECK_CLOSE(total_cost, 1., 1e-10);
+  load_balance->options().set("timed_actions", std::vector<URI>(1, action->uri()));
+
+  // Without timing information, the measurement fails
+  action->properties().erase("timer_mean");
+  BOOST_CHECK_THROW(load_balance->measure_imbalance(), SetupError);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
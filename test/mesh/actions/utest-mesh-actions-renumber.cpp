@@ -0,0 +1,264 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::Renumber"
+
+#include <algorithm>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Nodes of each element, identified by global indices
+typedef std::map< std::pair<std::string, Uint>, std::vector<Uint> > ElementNodesT;
+
+struct RenumberFixture
+{
+  RenumberFixture() : nb_cells(16)
+  {
+  }
+
+  /// Build a square mesh with a nodal field, a discontinuous field and periodic links between the left and right sides
+  Mesh& create_mesh(const std::string& name)
+  {
+    Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator_" + name);
+    mesh_generator->options().set("mesh", Core::instance().root().uri()/name);
+    mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+    mesh_generator->options().set("nb_cells", std::vector<Uint>(2, nb_cells));
+    Mesh& mesh = mesh_generator->generate();
+
+    Dictionary& geometry = mesh.geometry_fields();
+    const Field& coords = geometry.coordinates();
+    Field& nodal_field = geometry.create_field("nodal_field");
+    for(Uint i = 0; i != coords.size(); ++i)
+      nodal_field[i][0] = coords[i][XX] + 2.*coords[i][YY];
+
+    Dictionary& dg = mesh.create_discontinuous_space("dg", "cf3.mesh.LagrangeP1");
+    Field& dg_field = dg.create_field("dg_field");
+    const Field& dg_coords = dg.coordinates();
+    for(Uint i = 0; i != dg_coords.size(); ++i)
+      dg_field[i][0] = dg_coords[i][XX] + 2.*dg_coords[i][YY];
+
+    List<Uint>& links = *geometry.create_component< List<Uint> >("periodic_links_nodes");
+    List<bool>& active = *geometry.create_component< List<bool> >("periodic_links_active");
+    links.resize(geometry.size());
+    active.resize(geometry.size());
+    for(Uint i = 0; i != coords.size(); ++i)
+    {
+      active[i] = false;
+      if(coords[i][XX] > 1. - 1e-10)
+      {
+        for(Uint j = 0; j != coords.size(); ++j)
+        {
+          if(coords[j][XX] < 1e-10 && std::abs(coords[j][YY] - coords[i][YY]) < 1e-10)
+          {
+            links[i] = j;
+            active[i] = true;
+          }
+        }
+      }
+    }
+
+    mesh.raise_mesh_changed();
+    return mesh;
+  }
+
+  /// Randomly shuffle the nodes and elements
+  void scramble(Mesh& mesh)
+  {
+    std::vector<Uint> new_idx(mesh.geometry_fields().size());
+    for(Uint i = 0; i != new_idx.size(); ++i)
+      new_idx[i] = i;
+    std::random_shuffle(new_idx.begin(), new_idx.end());
+    renumber_nodes(mesh.geometry_fields(), new_idx);
+
+    boost_foreach(const Handle<Entities>& entities, mesh.elements())
+    {
+      new_idx.resize(entities->size());
+      for(Uint i = 0; i != new_idx.size(); ++i)
+        new_idx[i] = i;
+      std::random_shuffle(new_idx.begin(), new_idx.end());
+      renumber_elements(*entities, new_idx);
+    }
+
+    mesh.raise_mesh_changed();
+  }
+
+  /// Average over the elements of the difference between the largest and smallest node index, as a measure of locality
+  Real mean_node_spread(const Mesh& mesh)
+  {
+    Real total = 0.;
+    Uint nb_elems = 0;
+    boost_foreach(const Handle<Entities>& entities, mesh.elements())
+    {
+      const Connectivity& connectivity = entities->geometry_space().connectivity();
+      boost_foreach(const Connectivity::ConstRow row, connectivity.array())
+      {
+        total += *std::max_element(row.begin(), row.end()) - *std::min_element(row.begin(), row.end());
+        ++nb_elems;
+      }
+    }
+    return total / static_cast<Real>(nb_elems);
+  }
+
+  void element_nodes(const Mesh& mesh, ElementNodesT& result)
+  {
+    result.clear();
+    const List<Uint>& node_glb_idx = mesh.geometry_fields().glb_idx();
+    boost_foreach(const Handle<Entities>& entities, mesh.elements())
+    {
+      const Connectivity& connectivity = entities->geometry_space().connectivity();
+      for(Uint elem = 0; elem != entities->size(); ++elem)
+      {
+        std::vector<Uint>& nodes = result[std::make_pair(entities->uri().path(), entities->glb_idx()[elem])];
+        boost_foreach(const Uint node, connectivity[elem])
+          nodes.push_back(node_glb_idx[node]);
+      }
+    }
+  }
+
+  /// Check that the mesh still describes the same geometry and fields
+  void check_mesh(Mesh& mesh, const ElementNodesT& reference)
+  {
+    BOOST_CHECK(mesh.check_sanity());
+
+    ElementNodesT renumbered;
+    element_nodes(mesh, renumbered);
+    BOOST_CHECK(renumbered == reference);
+
+    Dictionary& geometry = mesh.geometry_fields();
+    const Field& coords = geometry.coordinates();
+    const Field& nodal_field = *Handle<Field>(geometry.get_child("nodal_field"));
+    for(Uint i = 0; i != coords.size(); ++i)
+    {
+      BOOST_CHECK_CLOSE(nodal_field[i][0], coords[i][XX] + 2.*coords[i][YY], 1e-10);
+      BOOST_CHECK_EQUAL(geometry.glb_to_loc()[geometry.glb_idx()[i]], i);
+    }
+
+    // Periodic links still connect the left and right sides
+    const List<Uint>& links = *Handle< List<Uint> >(geometry.get_child("periodic_links_nodes"));
+    const List<bool>& active = *Handle< List<bool> >(geometry.get_child("periodic_links_active"));
+    Uint nb_links = 0;
+    for(Uint i = 0; i != coords.size(); ++i)
+    {
+      if(active[i])
+      {
+        ++nb_links;
+        BOOST_CHECK_CLOSE(coords[i][XX], 1., 1e-10);
+        BOOST_CHECK_SMALL(coords[links[i]][XX], 1e-10);
+        BOOST_CHECK_SMALL(coords[links[i]][YY] - coords[i][YY], 1e-10);
+      }
+    }
+    BOOST_CHECK_EQUAL(nb_links, nb_cells + 1);
+
+    // The discontinuous dictionary matches the geometry, and its nodes follow the element order
+    Dictionary& dg = *Handle<Dictionary>(mesh.get_child("dg"));
+    const Field& dg_coords = *Handle<Field>(dg.get_child("coordinates"));
+    const Field& dg_field = *Handle<Field>(dg.get_child("dg_field"));
+    Uint next_node = 0;
+    boost_foreach(const Handle<Space>& space, dg.spaces())
+    {
+      const Connectivity& geometry_connectivity = space->support().geometry_space().connectivity();
+      const Connectivity& dg_connectivity = space->connectivity();
+      for(Uint elem = 0; elem != dg_connectivity.size(); ++elem)
+      {
+        for(Uint k = 0; k != dg_connectivity.row_size(); ++k)
+        {
+          const Uint dg_node = dg_connectivity[elem][k];
+          BOOST_CHECK_EQUAL(dg_node, next_node++);
+          BOOST_CHECK_SMALL(dg_coords[dg_node][XX] - coords[geometry_connectivity[elem][k]][XX], 1e-10);
+          BOOST_CHECK_SMALL(dg_coords[dg_node][YY] - coords[geometry_connectivity[elem][k]][YY], 1e-10);
+          BOOST_CHECK_CLOSE(dg_field[dg_node][0], dg_coords[dg_node][XX] + 2.*dg_coords[dg_node][YY], 1e-10);
+        }
+      }
+    }
+  }
+
+  void check_renumbering(const std::string& method)
+  {
+    Mesh& mesh = create_mesh("mesh_" + method);
+    const Real initial_spread = mean_node_spread(mesh);
+    scramble(mesh);
+    const Real scrambled_spread = mean_node_spread(mesh);
+    BOOST_CHECK_GT(scrambled_spread, 4.*initial_spread);
+
+    ElementNodesT reference;
+    element_nodes(mesh, reference);
+
+    boost::shared_ptr<MeshTransformer> renumber = build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.Renumber", "renumber");
+    renumber->options().set("method", method);
+    renumber->transform(mesh);
+
+    check_mesh(mesh, reference);
+    BOOST_CHECK_LT(mean_node_spread(mesh), scrambled_spread / 4.);
+    BOOST_TEST_MESSAGE(method << " mean node spread: initial " << initial_spread << ", scrambled " << scrambled_spread << ", renumbered " << mean_node_spread(mesh));
+  }
+
+  const Uint nb_cells;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( RenumberSuite, RenumberFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RCM )
+{
+  check_renumbering("RCM");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Hilbert )
+{
+  check_renumbering("Hilbert");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RCMBandwidth )
+{
+  // On a structured grid, RCM gets close to the bandwidth of the row-by-row numbering
+  Mesh& mesh = create_mesh("mesh_bandwidth");
+  const Uint initial_bandwidth = node_bandwidth(mesh);
+  scramble(mesh);
+
+  boost::shared_ptr<MeshTransformer> renumber = build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.Renumber", "renumber");
+  renumber->options().set("method", std::string("RCM"));
+  renumber->transform(mesh);
+  BOOST_CHECK_LE(node_bandwidth(mesh), 2*initial_bandwidth);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,161 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::WallDistance"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/OptionList.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/Table.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "mesh/actions/WallDistance.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TestFixture
+{
+  /// common setup for each test case
+  TestFixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// common tear-down for each test case
+  ~TestFixture()
+  {
+  }
+
+  /// Generate a unit square or cube with the given number of cells in each direction
+  Mesh& generate(const std::string& name, const Uint dim, const Uint nb_cells)
+  {
+    Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generate_" + name);
+    mesh_generator->options().set("mesh",Core::instance().root().uri()/name);
+    mesh_generator->options().set("lengths",std::vector<Real>(dim,1.));
+    mesh_generator->options().set("nb_cells",std::vector<Uint>(dim,nb_cells));
+    return mesh_generator->generate();
+  }
+
+  /// Run the wall distance action with the given wall regions
+  void compute_wall_distance(Mesh& mesh, const std::vector<std::string>& walls)
+  {
+    std::vector< Handle<Region> > regions;
+    for(Uint i = 0; i != walls.size(); ++i)
+      regions.push_back(Handle<Region>(mesh.topology().get_child(walls[i])));
+
+    boost::shared_ptr<WallDistance> wall_distance = allocate_component<WallDistance>("wall_distance");
+    wall_distance->options().set("regions",regions);
+    wall_distance->transform(mesh);
+  }
+
+  int m_argc;
+  char** m_argv;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( TestSuite, TestFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Initiate )
+{
+ Core::instance().initiate(m_argc,m_argv);
+ PE::Comm::instance().init(m_argc,m_argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Line walls: the distance to the bottom is the y coordinate. The mesh is split along y in parallel,
+// so the ranks above the first have no local wall elements and rely on the gathered wall.
+BOOST_AUTO_TEST_CASE( DistanceToLine )
+{
+  Mesh& mesh = generate("square", 2, 10);
+  compute_wall_distance(mesh, std::vector<std::string>(1, "bottom"));
+
+  const Field& coords = mesh.geometry_fields().coordinates();
+  const Field& distance = *Handle<Field const>(mesh.geometry_fields().get_child("wall_distance"));
+  const Table<Uint>& node_to_wall_element = *Handle< Table<Uint> const >(mesh.get_child("node_to_wall_element"));
+  const bool is_serial = !PE::Comm::instance().is_active() || PE::Comm::instance().size() == 1;
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_SMALL(distance[i][0] - coords[i][1], 1e-12);
+    // Every node above the wall projects inside a wall segment
+    if(is_serial && coords[i][1] > 0.)
+      BOOST_CHECK_EQUAL(node_to_wall_element[i][0], 1u);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Quad walls, split in triangles: the distance is the smallest distance to the bottom or top
+BOOST_AUTO_TEST_CASE( DistanceToQuads )
+{
+  Mesh& mesh = generate("cube", 3, 4);
+  std::vector<std::string> walls;
+  walls.push_back("bottom");
+  walls.push_back("top");
+  compute_wall_distance(mesh, walls);
+
+  const Field& coords = mesh.geometry_fields().coordinates();
+  const Field& distance = *Handle<Field const>(mesh.geometry_fields().get_child("wall_distance"));
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_SMALL(distance[i][0] - std::min(coords[i][1], 1. - coords[i][1]), 1e-12);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Run on the threads of the shared pool. The mesh has enough nodes to give each thread at least 1024 nodes
+BOOST_AUTO_TEST_CASE( ThreadedDistanceToLine )
+{
+  Core::instance().environment().options().set("nb_threads", 4u);
+  BOOST_CHECK_EQUAL(ThreadPool::shared().nb_threads(), 4u);
+
+  Mesh& mesh = generate("threaded_square", 2, 80);
+  compute_wall_distance(mesh, std::vector<std::string>(1, "bottom"));
+
+  const Field& coords = mesh.geometry_fields().coordinates();
+  const Field& distance = *Handle<Field const>(mesh.geometry_fields().get_child("wall_distance"));
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    BOOST_CHECK_SMALL(distance[i][0] - coords[i][1], 1e-12);
+  }
+
+  Core::instance().environment().options().set("nb_threads", 1u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,4 +1,5 @@
 import sys
+from math import sqrt
 import coolfluid as cf
 
 env = cf.Core.environment()
@@ -58,6 +59,19 @@ wall_distance.mesh = mesh
 wall_distance.regions = [mesh.topology.step]
 wall_distance.execute()
 
+# Exact distance to the step: the vertical segment below it, the horizontal segment to the right, or the corner
+coords = mesh.geometry.coordinates
+distance = mesh.geometry.wall_distance
+for ((x,y),(d,)) in zip(coords, distance):
+    if y <= 0.5:
+        expected = 0.5 - x
+    elif x >= 0.5:
+        expected = y - 0.5
+    else:
+        expected = sqrt((0.5-x)**2 + (y-0.5)**2)
+    if abs(d - expected) > 1e-12:
+        raise Exception('Bad wall distance {d} at ({x}, {y}), expected {e}'.format(d=d, x=x, y=y, e=expected))
+
 writer.mesh =  mesh
 writer.file = cf.URI('wall-distance-2dstep.vtm')
 writer.execute()
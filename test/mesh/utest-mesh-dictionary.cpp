@@ -15,6 +15,7 @@
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
 #include "common/Core.hpp"
+#include "common/List.hpp"
 
 #include "math/MatrixTypes.hpp"
 #include "math/VariablesDescriptor.hpp"
@@ -28,6 +29,8 @@
 #include "mesh/Field.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Faces.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/UsedNodesCache.hpp"
 #include "mesh/Cells.hpp"
 
 using namespace boost;
@@ -309,6 +312,89 @@ BOOST_AUTO_TEST_CASE( FieldVariables )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( PeriodicInverseLinks )
+{
+  Dictionary& dict = m_mesh->geometry_fields();
+  const Uint nb_nodes = dict.size();
+
+  // No periodic links yet
+  BOOST_CHECK(dict.periodic_inverse_links().targets.empty());
+  BOOST_CHECK(dict.periodic_inverse_links().sources.empty());
+
+  common::List<Uint>& periodic_links_nodes = *dict.create_component< common::List<Uint> >("periodic_links_nodes");
+  common::List<bool>& periodic_links_active = *dict.create_component< common::List<bool> >("periodic_links_active");
+  periodic_links_nodes.resize(nb_nodes);
+  periodic_links_active.resize(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    periodic_links_nodes[i] = 0;
+    periodic_links_active[i] = false;
+  }
+
+  // 2 links to 0 through 1, and 5 links to 3
+  periodic_links_nodes[1] = 0; periodic_links_active[1] = true;
+  periodic_links_nodes[2] = 1; periodic_links_active[2] = true;
+  periodic_links_nodes[5] = 3; periodic_links_active[5] = true;
+
+  const Dictionary::PeriodicInverseLinks& inverse_links = dict.periodic_inverse_links();
+  BOOST_CHECK_EQUAL(inverse_links.targets.size(), 2u);
+  BOOST_CHECK_EQUAL(inverse_links.targets[0], 0u);
+  BOOST_CHECK_EQUAL(inverse_links.targets[1], 3u);
+  BOOST_CHECK_EQUAL(inverse_links.offsets.size(), 3u);
+  BOOST_CHECK_EQUAL(inverse_links.offsets[0], 0u);
+  BOOST_CHECK_EQUAL(inverse_links.offsets[1], 2u);
+  BOOST_CHECK_EQUAL(inverse_links.offsets[2], 3u);
+  BOOST_CHECK_EQUAL(inverse_links.sources.size(), 3u);
+  BOOST_CHECK_EQUAL(inverse_links.sources[0], 1u);
+  BOOST_CHECK_EQUAL(inverse_links.sources[1], 2u);
+  BOOST_CHECK_EQUAL(inverse_links.sources[2], 5u);
+
+  // Modifications are only seen after invalidating
+  periodic_links_active[5] = false;
+  BOOST_CHECK_EQUAL(dict.periodic_inverse_links().targets.size(), 2u);
+  dict.invalidate_periodic_inverse_links();
+  BOOST_CHECK_EQUAL(dict.periodic_inverse_links().targets.size(), 1u);
+  BOOST_CHECK_EQUAL(dict.periodic_inverse_links().sources.size(), 2u);
+
+  // Removing the links is detected automatically
+  dict.remove_component("periodic_links_nodes");
+  dict.remove_component("periodic_links_active");
+  BOOST_CHECK(dict.periodic_inverse_links().targets.empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( CachedUsedNodes )
+{
+  Mesh& mesh = *m_mesh;
+  Dictionary& dict = mesh.geometry_fields();
+
+  std::vector< Handle<Entities const> > entities;
+  boost_foreach(const Cells& cells, find_components_recursively<Cells>(mesh.topology()))
+    entities.push_back(cells.handle<Entities>());
+
+  mesh.used_nodes_cache().clear();
+  boost::shared_ptr< common::List<Uint> const > cached = cached_used_nodes_list(entities, dict, true);
+  boost::shared_ptr< common::List<Uint> > built = build_used_nodes_list(entities, dict, true);
+  BOOST_CHECK(cached->array() == built->array());
+  BOOST_CHECK_EQUAL(mesh.used_nodes_cache().size(), 1u);
+
+  // Same list on the next call, also when the entities are given in a different order
+  std::vector< Handle<Entities const> > reversed_entities(entities.rbegin(), entities.rend());
+  BOOST_CHECK(cached_used_nodes_list(reversed_entities, dict, true) == cached);
+
+  // Different flags give a different entry
+  cached_used_nodes_list(entities, dict, false);
+  BOOST_CHECK_EQUAL(mesh.used_nodes_cache().size(), 2u);
+
+  // Changing the mesh clears the cache
+  mesh.raise_mesh_changed();
+  BOOST_CHECK_EQUAL(mesh.used_nodes_cache().size(), 0u);
+  BOOST_CHECK(cached_used_nodes_list(entities, dict, true) != cached);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,240 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::ElementColoring"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/List.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Check that no two elements of the same color share a node, and that all elements are colored
+void check_coloring(Elements& elements)
+{
+  const Connectivity& connectivity = elements.geometry_space().connectivity();
+  Uint nb_colored = 0;
+  boost_foreach(const std::vector<Uint>& color, elements.coloring().colors())
+  {
+    std::vector<bool> node_used(elements.geometry_fields().size(), false);
+    boost_foreach(const Uint elem, color)
+    {
+      boost_foreach(const Uint node, connectivity[elem])
+      {
+        BOOST_CHECK(!node_used[node]);
+        node_used[node] = true;
+      }
+    }
+    nb_colored += color.size();
+  }
+  BOOST_CHECK_EQUAL(nb_colored, elements.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Check that no two elements of the same color share a node once the periodic links are followed
+void check_periodic_coloring(Elements& elements)
+{
+  const Dictionary& dict = elements.geometry_fields();
+  const List<Uint>& periodic_links_nodes = *Handle< List<Uint> const >(dict.get_child("periodic_links_nodes"));
+  const List<bool>& periodic_links_active = *Handle< List<bool> const >(dict.get_child("periodic_links_active"));
+  const Connectivity& connectivity = elements.geometry_space().connectivity();
+  boost_foreach(const std::vector<Uint>& color, elements.coloring().colors())
+  {
+    std::vector<bool> node_used(dict.size(), false);
+    boost_foreach(const Uint elem, color)
+    {
+      boost_foreach(Uint node, connectivity[elem])
+      {
+        while(periodic_links_active[node])
+          node = periodic_links_nodes[node];
+        BOOST_CHECK(!node_used[node]);
+        node_used[node] = true;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( ElementColoringSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( ColorQuads )
+{
+  boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+  meshgenerator->options().set("mesh",URI("//quads"));
+  meshgenerator->options().set("nb_cells",std::vector<Uint>(2,8));
+  meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+  Mesh& mesh = meshgenerator->generate();
+
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    ElementColoring& coloring = elements.coloring();
+    BOOST_CHECK(!coloring.is_valid());
+    check_coloring(elements);
+    BOOST_CHECK(coloring.is_valid());
+
+    // A structured quad mesh needs 4 colors, a line mesh 2. A partition may hold less than 2 boundary elements.
+    const Uint expected_nb_colors = elements.size() < 2 ? elements.size() : (elements.element_type().dimensionality() == 2 ? 4u : 2u);
+    BOOST_CHECK_EQUAL(coloring.nb_colors(), expected_nb_colors);
+  }
+
+  // Changing the mesh invalidates the coloring
+  mesh.raise_mesh_changed();
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    BOOST_CHECK(!elements.coloring().is_valid());
+  }
+
+  // Resizing is detected as well
+  Elements& first_elements = *find_components_recursively<Elements>(mesh.topology()).begin();
+  first_elements.coloring().colors();
+  BOOST_CHECK(first_elements.coloring().is_valid());
+  first_elements.resize(first_elements.size() - 1);
+  BOOST_CHECK(!first_elements.coloring().is_valid());
+  check_coloring(first_elements);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( GhostClassification )
+{
+  boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+  meshgenerator->options().set("mesh",URI("//quads_ghosts"));
+  meshgenerator->options().set("nb_cells",std::vector<Uint>(2,8));
+  meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+  Mesh& mesh = meshgenerator->generate();
+
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    ElementGhostClassification& classification = elements.ghost_classification();
+    const std::vector<Uint>& interior = classification.interior_elements();
+    const std::vector<Uint>& boundary = classification.boundary_elements();
+    BOOST_CHECK_EQUAL(interior.size() + boundary.size(), elements.size());
+
+    // Check the classification against the ghost flags
+    const Dictionary& dict = elements.geometry_fields();
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    boost_foreach(const Uint elem, interior)
+    {
+      boost_foreach(const Uint node, connectivity[elem])
+        BOOST_CHECK(!dict.is_ghost(node));
+    }
+    boost_foreach(const Uint elem, boundary)
+    {
+      bool has_ghost = false;
+      boost_foreach(const Uint node, connectivity[elem])
+        has_ghost = has_ghost || dict.is_ghost(node);
+      BOOST_CHECK(has_ghost);
+    }
+
+    // The split colors together make up the coloring
+    const std::vector< std::vector<Uint> >& colors = elements.coloring().colors();
+    BOOST_CHECK_EQUAL(classification.interior_colors().size(), colors.size());
+    BOOST_CHECK_EQUAL(classification.boundary_colors().size(), colors.size());
+    for(Uint color = 0; color != colors.size(); ++color)
+    {
+      BOOST_CHECK_EQUAL(classification.interior_colors()[color].size() + classification.boundary_colors()[color].size(), colors[color].size());
+    }
+
+    BOOST_CHECK(classification.is_valid());
+  }
+
+  mesh.raise_mesh_changed();
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    BOOST_CHECK(!elements.ghost_classification().is_valid());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( PeriodicColoring )
+{
+  // An odd number of cells in the periodic direction, so a coloring that ignores the links is wrong
+  boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+  meshgenerator->options().set("mesh",URI("//quads_periodic"));
+  std::vector<Uint> nb_cells(2, 8);
+  nb_cells[0] = 5;
+  meshgenerator->options().set("nb_cells",nb_cells);
+  meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+  Mesh& mesh = meshgenerator->generate();
+
+  // Build the coloring and ghost classification before linking
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    elements.coloring().colors();
+    elements.ghost_classification().interior_elements();
+  }
+
+  boost::shared_ptr< MeshTransformer > link = build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.LinkPeriodicNodes","link");
+  link->options().set("source_region", Handle<Region>(mesh.topology().get_child("right")));
+  link->options().set("destination_region", Handle<Region>(mesh.topology().get_child("left")));
+  std::vector<Real> translation_vector(2, 0.);
+  translation_vector[0] = -1.;
+  link->options().set("translation_vector", translation_vector);
+  link->transform(mesh);
+
+  boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh.topology()))
+  {
+    BOOST_CHECK(!elements.coloring().is_valid());
+    BOOST_CHECK(!elements.ghost_classification().is_valid());
+    check_periodic_coloring(elements);
+
+    // Nodes linked to a node on another rank became ghosts, so their elements are no longer interior
+    const Dictionary& dict = elements.geometry_fields();
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    boost_foreach(const Uint elem, elements.ghost_classification().interior_elements())
+    {
+      boost_foreach(const Uint node, connectivity[elem])
+        BOOST_CHECK(!dict.is_ghost(node));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
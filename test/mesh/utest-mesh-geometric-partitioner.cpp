@@ -0,0 +1,213 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::GeometricPartitioner"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "math/BoundingBox.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/GeometricPartitioner.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct GeometricPartitionerFixture
+{
+  GeometricPartitionerFixture() : nb_parts(4)
+  {
+  }
+
+  /// Partition a square mesh and check the result
+  void check_partitioning(const std::string& method)
+  {
+    Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator_" + method);
+    mesh_generator->options().set("mesh", Core::instance().root().uri()/("mesh_" + method));
+    mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+    mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 16));
+    Mesh& mesh = mesh_generator->generate();
+    build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalNumbering","glb_numbering")->transform(mesh);
+
+    boost::shared_ptr<GeometricPartitioner> partitioner = allocate_component<GeometricPartitioner>("partitioner");
+    partitioner->options().set("method", method);
+    partitioner->options().set("nb_parts", nb_parts);
+
+    // Only partition, there are more parts than processors
+    partitioner->initialize(mesh);
+    partitioner->partition_graph();
+
+    // Part of each element, the elements that are not exported stay on this processor
+    const Uint rank = PE::Comm::instance().rank();
+    const std::vector< Handle<Entities> >& entities = mesh.elements();
+    std::vector< std::vector<Uint> > parts(entities.size());
+    for(Uint comp = 0; comp != entities.size(); ++comp)
+      parts[comp].assign(entities[comp]->size(), rank);
+    for(Uint part = 0; part != nb_parts; ++part)
+    {
+      for(Uint comp = 0; comp != entities.size(); ++comp)
+      {
+        boost_foreach(const Uint elem, partitioner->exported_elements()[part][comp])
+          parts[comp][elem] = part;
+      }
+    }
+
+    // Each part gets the same number of cells, in a compact region
+    const Field& coords = mesh.geometry_fields().coordinates();
+    std::vector<Uint> nb_cells_per_part(nb_parts, 0);
+    std::vector<math::BoundingBox> part_boxes(nb_parts, math::BoundingBox(std::vector<Real>(2, 1e10), std::vector<Real>(2, -1e10)));
+    for(Uint comp = 0; comp != entities.size(); ++comp)
+    {
+      if(entities[comp]->element_type().dimensionality() != 2)
+        continue;
+      const Connectivity& connectivity = entities[comp]->geometry_space().connectivity();
+      for(Uint elem = 0; elem != entities[comp]->size(); ++elem)
+      {
+        const Uint part = parts[comp][elem];
+        ++nb_cells_per_part[part];
+        RealVector centroid = RealVector::Zero(2);
+        boost_foreach(const Uint node, connectivity[elem])
+        {
+          centroid[XX] += coords[node][XX] / 4.;
+          centroid[YY] += coords[node][YY] / 4.;
+        }
+        part_boxes[part].extend(centroid);
+      }
+    }
+    PE::Comm::instance().all_reduce(PE::plus(), nb_cells_per_part, nb_cells_per_part);
+    for(Uint part = 0; part != nb_parts; ++part)
+    {
+      part_boxes[part].make_global();
+      BOOST_CHECK_EQUAL(nb_cells_per_part[part], 64u);
+      BOOST_CHECK_CLOSE((part_boxes[part].max() - part_boxes[part].min()).sum(), 14./16., 1e-8);
+    }
+
+    // Boundary elements are in the same part as the adjacent cell, if it is on the same processor
+    Uint nb_boundary_elements = 0;
+    for(Uint comp = 0; comp != entities.size(); ++comp)
+    {
+      if(entities[comp]->element_type().dimensionality() != 1)
+        continue;
+      const Connectivity& connectivity = entities[comp]->geometry_space().connectivity();
+      for(Uint elem = 0; elem != entities[comp]->size(); ++elem)
+      {
+        ++nb_boundary_elements;
+        bool found = false;
+        for(Uint volume_comp = 0; volume_comp != entities.size() && !found; ++volume_comp)
+        {
+          if(entities[volume_comp]->element_type().dimensionality() != 2)
+            continue;
+          const Connectivity& volume_connectivity = entities[volume_comp]->geometry_space().connectivity();
+          for(Uint volume_elem = 0; volume_elem != volume_connectivity.size() && !found; ++volume_elem)
+          {
+            const Connectivity::ConstRow row = volume_connectivity[volume_elem];
+            if(std::find(row.begin(), row.end(), connectivity[elem][0]) != row.end() && std::find(row.begin(), row.end(), connectivity[elem][1]) != row.end())
+            {
+              found = true;
+              BOOST_CHECK_EQUAL(parts[comp][elem], parts[volume_comp][volume_elem]);
+            }
+          }
+        }
+        if(PE::Comm::instance().size() == 1)
+          BOOST_CHECK(found);
+      }
+    }
+    PE::Comm::instance().all_reduce(PE::plus(), &nb_boundary_elements, 1, &nb_boundary_elements);
+    BOOST_CHECK_EQUAL(nb_boundary_elements, 64u);
+  }
+
+  const Uint nb_parts;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( GeometricPartitionerSuite, GeometricPartitionerFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Hilbert )
+{
+  check_partitioning("Hilbert");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RCB )
+{
+  check_partitioning("RCB");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( LoadBalance )
+{
+  // Without a graph partitioning library, LoadBalance uses the geometric partitioner
+  Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generator_loadbalance");
+  mesh_generator->options().set("mesh", Core::instance().root().uri()/"mesh_loadbalance");
+  mesh_generator->options().set("lengths", std::vector<Real>(2, 1.));
+  mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 16));
+  Mesh& mesh = mesh_generator->generate();
+
+  boost::shared_ptr<MeshTransformer> load_balance = build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.LoadBalance","load_balance");
+  Handle<MeshPartitioner> partitioner(load_balance->get_child("partitioner"));
+  BOOST_REQUIRE(is_not_null(partitioner));
+  if(is_null(Handle<GeometricPartitioner>(partitioner)))
+    return;
+
+  partitioner->options().set("method", std::string("RCB"));
+  load_balance->transform(mesh);
+  BOOST_CHECK(mesh.check_sanity());
+
+  Uint nb_owned_cells = 0;
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    if(entities->element_type().dimensionality() != 2)
+      continue;
+    for(Uint elem = 0; elem != entities->size(); ++elem)
+    {
+      if(!entities->is_ghost(elem))
+        ++nb_owned_cells;
+    }
+  }
+  BOOST_CHECK_EQUAL(nb_owned_cells, 256u / PE::Comm::instance().size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
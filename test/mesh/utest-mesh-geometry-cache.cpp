@@ -0,0 +1,190 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::ElementGeometryCache"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "math/Consts.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementData.hpp"
+#include "mesh/ElementGeometryCache.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Integrators/Gauss.hpp"
+#include "mesh/LagrangeP1/Quad2D.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+typedef LagrangeP1::Quad2D ETYPE;
+typedef Integrators::GaussMappedCoords<2, GeoShape::QUAD> GaussT;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct GeometryCacheFixture
+{
+  GeometryCacheFixture()
+  {
+    // Each test starts from a new mesh
+    if(is_not_null(Core::instance().root().get_child("quads")))
+      Core::instance().root().remove_component("quads");
+
+    boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+    meshgenerator->options().set("mesh",URI("//quads"));
+    meshgenerator->options().set("nb_cells",std::vector<Uint>(2,6));
+    meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+    mesh = meshgenerator->generate().handle<Mesh>();
+
+    // Distort the mesh, so each element has a different, non-constant jacobian
+    Field& coords = mesh->geometry_fields().coordinates();
+    for(Uint i = 0; i != coords.size(); ++i)
+    {
+      const Real x = coords[i][XX];
+      const Real y = coords[i][YY];
+      coords[i][XX] = x + 0.05*sin(2.*math::Consts::pi()*y);
+      coords[i][YY] = y + 0.05*sin(2.*math::Consts::pi()*x);
+    }
+
+    boost_foreach(Elements& elements, find_components_recursively<Elements>(mesh->topology()))
+    {
+      if(elements.element_type().shape() == GeoShape::QUAD)
+        quads = elements.handle<Elements>();
+    }
+    BOOST_REQUIRE(is_not_null(quads));
+  }
+
+  /// Check the cached data for all elements against a direct computation
+  void check_point(const ElementGeometryCache::PointData& point, const ETYPE::MappedCoordsT& mapped_coords)
+  {
+    const Connectivity& connectivity = quads->geometry_space().connectivity();
+    const Field& coords = mesh->geometry_fields().coordinates();
+    BOOST_CHECK_EQUAL(point.nb_elements(), quads->size());
+    BOOST_CHECK(point.matches(mapped_coords));
+
+    ETYPE::NodesT nodes;
+    ETYPE::JacobianT jacobian, cached_jacobian, cached_inverse;
+    ETYPE::SF::GradientT mapped_gradient, cached_gradient;
+    ETYPE::SF::compute_gradient(mapped_coords, mapped_gradient);
+    for(Uint elem = 0; elem != quads->size(); ++elem)
+    {
+      fill(nodes, coords, connectivity[elem]);
+      ETYPE::compute_jacobian(mapped_coords, nodes, jacobian);
+      point.copy_jacobian(elem, cached_jacobian);
+      point.copy_jacobian_inverse(elem, cached_inverse);
+      point.copy_gradient(elem, cached_gradient);
+
+      BOOST_CHECK_SMALL((cached_jacobian - jacobian).norm(), 1e-14);
+      BOOST_CHECK_CLOSE(point.determinants[elem], ETYPE::jacobian_determinant(mapped_coords, nodes), 1e-10);
+      BOOST_CHECK_SMALL((cached_inverse - jacobian.inverse()).norm(), 1e-10);
+      BOOST_CHECK_SMALL((cached_gradient - jacobian.inverse()*mapped_gradient).norm(), 1e-10);
+    }
+  }
+
+  Handle<Mesh> mesh;
+  Handle<Elements> quads;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( ElementGeometryCacheSuite, GeometryCacheFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Disabled )
+{
+  ElementGeometryCache& cache = quads->geometry_cache();
+  BOOST_CHECK(!cache.is_enabled());
+  BOOST_CHECK(!cache.point<ETYPE>(GaussT::instance().coords.col(0)));
+  BOOST_CHECK_EQUAL(cache.nb_points(), 0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( CachedValues )
+{
+  ElementGeometryCache& cache = quads->geometry_cache();
+  cache.options().set("enabled", true);
+
+  std::vector< boost::shared_ptr<ElementGeometryCache::PointData const> > points;
+  for(Uint i = 0; i != GaussT::nb_points; ++i)
+  {
+    const ETYPE::MappedCoordsT mapped_coords = GaussT::instance().coords.col(i);
+    points.push_back(cache.point<ETYPE>(mapped_coords));
+    BOOST_REQUIRE(points.back());
+    check_point(*points.back(), mapped_coords);
+  }
+  BOOST_CHECK_EQUAL(cache.nb_points(), static_cast<Uint>(GaussT::nb_points));
+  BOOST_CHECK(cache.is_valid());
+
+  // Repeated requests return the stored data
+  for(Uint i = 0; i != GaussT::nb_points; ++i)
+  {
+    BOOST_CHECK(cache.point<ETYPE>(GaussT::instance().coords.col(i)) == points[i]);
+  }
+  BOOST_CHECK_EQUAL(cache.nb_points(), static_cast<Uint>(GaussT::nb_points));
+
+  // No new points are added beyond the maximum
+  cache.options().set("max_points", static_cast<Uint>(GaussT::nb_points));
+  BOOST_CHECK(!cache.point<ETYPE>(ETYPE::MappedCoordsT(0.1, 0.2)));
+  BOOST_CHECK(cache.point<ETYPE>(GaussT::instance().coords.col(0)) == points[0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Invalidation )
+{
+  ElementGeometryCache& cache = quads->geometry_cache();
+  cache.options().set("enabled", true);
+  const ETYPE::MappedCoordsT mapped_coords = GaussT::instance().coords.col(0);
+  boost::shared_ptr<ElementGeometryCache::PointData const> point = cache.point<ETYPE>(mapped_coords);
+  BOOST_REQUIRE(point);
+  BOOST_CHECK(cache.is_valid());
+
+  // Changing the mesh empties the cache
+  mesh->raise_mesh_changed();
+  BOOST_CHECK(!cache.is_valid());
+  BOOST_CHECK_EQUAL(cache.nb_points(), 0u);
+
+  // Moving nodes followed by a mesh_changed event gives new values
+  Field& coords = mesh->geometry_fields().coordinates();
+  for(Uint i = 0; i != coords.size(); ++i)
+    coords[i][XX] *= 2.;
+  mesh->raise_mesh_changed();
+  boost::shared_ptr<ElementGeometryCache::PointData const> new_point = cache.point<ETYPE>(mapped_coords);
+  BOOST_REQUIRE(new_point);
+  BOOST_CHECK(new_point != point);
+  check_point(*new_point, mapped_coords);
+  BOOST_CHECK_CLOSE(new_point->determinants[0], 2.*point->determinants[0], 1e-10);
+
+  // Resizing is detected as well
+  quads->resize(quads->size() - 1);
+  BOOST_CHECK(!cache.is_valid());
+  BOOST_CHECK_EQUAL(cache.point<ETYPE>(mapped_coords)->nb_elements(), quads->size());
+
+  // Disabling clears the cache
+  cache.options().set("enabled", false);
+  BOOST_CHECK_EQUAL(cache.nb_points(), 0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
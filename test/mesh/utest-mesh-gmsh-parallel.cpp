@@ -7,8 +7,11 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::gmsh::Reader parallel"
 
+#include <cstring>
 #include <iostream>
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
@@ -18,6 +21,7 @@
 #include "common/Environment.hpp"
 #include "common/BoostAnyConversion.hpp"
 #include "common/List.hpp"
+#include "common/PE/Comm.hpp"
 
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
@@ -65,6 +69,83 @@ struct gmshReaderMPITests_Fixture
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Write a value in binary form, optionally with the bytes swapped
+template<typename T>
+void write_binary(std::ostream& file, const T value, const bool swap_bytes)
+{
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  if(swap_bytes)
+    std::reverse(bytes, bytes+sizeof(T));
+  file.write(bytes, sizeof(T));
+}
+
+/// Unit square of n x n quads in binary MSH 4.1 format, with the nodes and the elements each split in two blocks.
+/// Node number k is at ((k-1) % (n+1), (k-1) / (n+1)) / n
+void write_binary_grid(const std::string& filename, const Uint n, const bool swap)
+{
+  typedef boost::uint64_t SizeT;
+  const Uint nb_nodes = (n+1)*(n+1);
+  const Uint nb_elems = n*n;
+
+  boost::filesystem::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+  file << "$MeshFormat\n4.1 1 8\n";
+  write_binary<int>(file, 1, swap);
+  file << "\n$EndMeshFormat\n";
+  file << "$PhysicalNames\n1\n2 1 \"fluid\"\n$EndPhysicalNames\n";
+
+  file << "$Entities\n";
+  write_binary<SizeT>(file, 0, swap); write_binary<SizeT>(file, 0, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 0, swap);
+  write_binary<int>(file, 1, swap);
+  const double bounding_box[6] = { 0., 0., 0., 1., 1., 0. };
+  for(Uint i = 0; i != 6; ++i)
+    write_binary<double>(file, bounding_box[i], swap);
+  write_binary<SizeT>(file, 1, swap);
+  write_binary<int>(file, 1, swap);
+  write_binary<SizeT>(file, 0, swap);
+  file << "\n$EndEntities\n";
+
+  file << "$Nodes\n";
+  write_binary<SizeT>(file, 2, swap); write_binary<SizeT>(file, nb_nodes, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, nb_nodes, swap);
+  const Uint node_blocks[3] = { 0, nb_nodes/3, nb_nodes };
+  for(Uint b = 0; b != 2; ++b)
+  {
+    write_binary<int>(file, 2, swap); write_binary<int>(file, 1, swap); write_binary<int>(file, 0, swap);
+    write_binary<SizeT>(file, node_blocks[b+1] - node_blocks[b], swap);
+    for(Uint k = node_blocks[b]; k != node_blocks[b+1]; ++k)
+      write_binary<SizeT>(file, k+1, swap);
+    for(Uint k = node_blocks[b]; k != node_blocks[b+1]; ++k)
+    {
+      write_binary<double>(file, static_cast<double>(k % (n+1)) / n, swap);
+      write_binary<double>(file, static_cast<double>(k / (n+1)) / n, swap);
+      write_binary<double>(file, 0., swap);
+    }
+  }
+  file << "\n$EndNodes\n";
+
+  file << "$Elements\n";
+  write_binary<SizeT>(file, 2, swap); write_binary<SizeT>(file, nb_elems, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, nb_elems, swap);
+  const Uint elem_blocks[3] = { 0, (2*nb_elems)/3, nb_elems };
+  for(Uint b = 0; b != 2; ++b)
+  {
+    write_binary<int>(file, 2, swap); write_binary<int>(file, 1, swap); write_binary<int>(file, 3, swap);
+    write_binary<SizeT>(file, elem_blocks[b+1] - elem_blocks[b], swap);
+    for(Uint e = elem_blocks[b]; e != elem_blocks[b+1]; ++e)
+    {
+      const Uint i = e % n;
+      const Uint j = e / n;
+      write_binary<SizeT>(file, e+1, swap);
+      write_binary<SizeT>(file, j*(n+1) + i + 1, swap);
+      write_binary<SizeT>(file, j*(n+1) + i + 2, swap);
+      write_binary<SizeT>(file, (j+1)*(n+1) + i + 2, swap);
+      write_binary<SizeT>(file, (j+1)*(n+1) + i + 1, swap);
+    }
+  }
+  file << "\n$EndElements\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_FIXTURE_TEST_SUITE( gmshReaderMPITests_TestSuite, gmshReaderMPITests_Fixture )
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -226,6 +307,46 @@ BOOST_AUTO_TEST_CASE( test )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Each rank reads its own range of a single byte-swapped binary file, and receives its ghost nodes from the other ranks
+BOOST_AUTO_TEST_CASE( read_binary_ranges )
+{
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint n = 12;
+  if(comm.rank() == 0)
+    write_binary_grid("grid-binary-swapped.msh", n, true);
+  comm.barrier();
+
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>("binary_grid");
+  meshreader->read_mesh_into("grid-binary-swapped.msh",mesh);
+
+  const Dictionary& nodes = mesh.geometry_fields();
+  Uint nb_owned_nodes = 0;
+  Uint nb_ghost_nodes = 0;
+  for(Uint i = 0; i != nodes.size(); ++i)
+  {
+    const Uint k = nodes.glb_idx()[i];
+    BOOST_CHECK_EQUAL(nodes.coordinates()[i][0], static_cast<Real>(k % (n+1)) / n);
+    BOOST_CHECK_EQUAL(nodes.coordinates()[i][1], static_cast<Real>(k / (n+1)) / n);
+    if(nodes.rank()[i] == comm.rank())
+      ++nb_owned_nodes;
+    else
+      ++nb_ghost_nodes;
+  }
+  if(comm.size() > 1)
+    BOOST_CHECK(nb_ghost_nodes > 0);
+
+  const Uint nb_elements = mesh.topology().recursive_elements_count(true);
+  Uint total_nb_elements = 0;
+  Uint total_nb_owned_nodes = 0;
+  comm.all_reduce(PE::plus(), &nb_elements, 1, &total_nb_elements);
+  comm.all_reduce(PE::plus(), &nb_owned_nodes, 1, &total_nb_owned_nodes);
+  BOOST_CHECK_EQUAL(total_nb_elements, n*n);
+  BOOST_CHECK_EQUAL(total_nb_owned_nodes, (n+1)*(n+1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   PE::Comm::instance().finalize();
@@ -7,10 +7,15 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::gmsh::Reader"
 
+#include <cstring>
+
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
+#include "common/FindComponents.hpp"
 
 
 #include "common/Core.hpp"
@@ -63,6 +68,165 @@ struct gmshReaderMPITests_Fixture
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Write a value in binary form, optionally with the bytes swapped
+template<typename T>
+void write_binary(std::ostream& file, const T value, const bool swap_bytes)
+{
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  if(swap_bytes)
+    std::reverse(bytes, bytes+sizeof(T));
+  file.write(bytes, sizeof(T));
+}
+
+/// Unit square made of 2 triangles, with a wall on the bottom edge and a nodal temperature x + 2y, in binary MSH 2.2 or 4.1 format
+void write_binary_square(const std::string& filename, const std::string& version, const bool swap)
+{
+  const double coords[4][2] = { {0.,0.}, {1.,0.}, {1.,1.}, {0.,1.} };
+  const int triags[2][3] = { {1, 2, 3}, {1, 3, 4} };
+
+  boost::filesystem::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+  file << "$MeshFormat\n" << version << " 1 8\n";
+  write_binary<int>(file, 1, swap);
+  file << "\n$EndMeshFormat\n";
+  file << "$PhysicalNames\n2\n1 1 \"wall\"\n2 2 \"fluid\"\n$EndPhysicalNames\n";
+  if(version == "2.2")
+  {
+    file << "$Nodes\n4\n";
+    for(int i = 0; i != 4; ++i)
+    {
+      write_binary<int>(file, i+1, swap);
+      write_binary<double>(file, coords[i][0], swap);
+      write_binary<double>(file, coords[i][1], swap);
+      write_binary<double>(file, 0., swap);
+    }
+    file << "\n$EndNodes\n";
+    file << "$Elements\n3\n";
+    // block header: type, number of elements, number of tags, followed by number, tags and nodes of each element
+    const int lines[] = { 1, 1, 2,   1, 1, 1, 1, 2 };
+    for(Uint i = 0; i != 8; ++i)
+      write_binary<int>(file, lines[i], swap);
+    const int triag_header[] = { 2, 2, 2 };
+    for(Uint i = 0; i != 3; ++i)
+      write_binary<int>(file, triag_header[i], swap);
+    for(int e = 0; e != 2; ++e)
+    {
+      write_binary<int>(file, e+2, swap);
+      write_binary<int>(file, 2, swap);
+      write_binary<int>(file, 2, swap);
+      for(Uint n = 0; n != 3; ++n)
+        write_binary<int>(file, triags[e][n], swap);
+    }
+    file << "\n$EndElements\n";
+  }
+  else
+  {
+    // Sizes and numbers are size_t, tags and types are int
+    typedef boost::uint64_t SizeT;
+    file << "$Entities\n";
+    write_binary<SizeT>(file, 0, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 0, swap);
+    for(int dim = 1; dim != 3; ++dim)
+    {
+      write_binary<int>(file, 1, swap);
+      const double bounding_box[6] = { 0., 0., 0., 1., dim == 1 ? 0. : 1., 0. };
+      for(Uint i = 0; i != 6; ++i)
+        write_binary<double>(file, bounding_box[i], swap);
+      write_binary<SizeT>(file, 1, swap);
+      write_binary<int>(file, dim, swap); // physical group
+      write_binary<SizeT>(file, 0, swap); // bounding entities
+    }
+    file << "\n$EndEntities\n";
+    file << "$Nodes\n";
+    write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 4, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 4, swap);
+    write_binary<int>(file, 2, swap); write_binary<int>(file, 1, swap); write_binary<int>(file, 0, swap); write_binary<SizeT>(file, 4, swap);
+    for(int i = 0; i != 4; ++i)
+      write_binary<SizeT>(file, i+1, swap);
+    for(int i = 0; i != 4; ++i)
+    {
+      write_binary<double>(file, coords[i][0], swap);
+      write_binary<double>(file, coords[i][1], swap);
+      write_binary<double>(file, 0., swap);
+    }
+    file << "\n$EndNodes\n";
+    file << "$Elements\n";
+    write_binary<SizeT>(file, 2, swap); write_binary<SizeT>(file, 3, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 3, swap);
+    write_binary<int>(file, 1, swap); write_binary<int>(file, 1, swap); write_binary<int>(file, 1, swap); write_binary<SizeT>(file, 1, swap);
+    write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 1, swap); write_binary<SizeT>(file, 2, swap);
+    write_binary<int>(file, 2, swap); write_binary<int>(file, 1, swap); write_binary<int>(file, 2, swap); write_binary<SizeT>(file, 2, swap);
+    for(int e = 0; e != 2; ++e)
+    {
+      write_binary<SizeT>(file, e+2, swap);
+      for(Uint n = 0; n != 3; ++n)
+        write_binary<SizeT>(file, triags[e][n], swap);
+    }
+    file << "\n$EndElements\n";
+  }
+  // The field header is text, the values are binary in both versions
+  file << "$NodeData\n1\n\"temperature\"\n1\n0\n3\n0\n1\n4\n";
+  for(int i = 0; i != 4; ++i)
+  {
+    write_binary<int>(file, i+1, swap);
+    write_binary<double>(file, coords[i][0] + 2.*coords[i][1], swap);
+  }
+  file << "\n$EndNodeData\n";
+}
+
+/// Check the square written by write_binary_square
+void check_square(Mesh& mesh)
+{
+  BOOST_CHECK_EQUAL(mesh.dimension(), 2u);
+  BOOST_CHECK_EQUAL(mesh.geometry_fields().size(), 4u);
+  BOOST_CHECK_EQUAL(find_component_recursively_with_name<Region>(mesh.topology(),"fluid").recursive_elements_count(true), 2u);
+  BOOST_CHECK_EQUAL(find_component_recursively_with_name<Region>(mesh.topology(),"wall").recursive_elements_count(true), 1u);
+  const Field& coords = mesh.geometry_fields().coordinates();
+  BOOST_CHECK_EQUAL(coords[2][0], 1.);
+  BOOST_CHECK_EQUAL(coords[2][1], 1.);
+  const Field& temperature = *Handle<Field const>(mesh.geometry_fields().get_child("temperature"));
+  for(Uint i = 0; i != coords.size(); ++i)
+    BOOST_CHECK_EQUAL(temperature[i][0], coords[i][0] + 2.*coords[i][1]);
+}
+
+/// Read the file in nb_parts parts, and check that together they contain each element once and own each node once
+void check_parts(const std::string& filename, const Uint nb_parts)
+{
+  Component& root = Core::instance().root();
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  meshreader->options().set("read_fields", false);
+  Mesh& full_mesh = *root.create_component<Mesh>("full_mesh");
+  meshreader->read_mesh_into(filename,full_mesh);
+  const Field& full_coords = full_mesh.geometry_fields().coordinates();
+  std::map<Uint, Uint> full_node_idx;
+  for(Uint i = 0; i != full_coords.size(); ++i)
+    full_node_idx[full_mesh.geometry_fields().glb_idx()[i]] = i;
+
+  meshreader->options().set("nb_parts", nb_parts);
+  Uint nb_elements = 0;
+  Uint nb_owned_nodes = 0;
+  for(Uint part = 0; part != nb_parts; ++part)
+  {
+    meshreader->options().set("part", part);
+    Mesh& mesh = *root.create_component<Mesh>("part_mesh");
+    meshreader->read_mesh_into(filename,mesh);
+    nb_elements += mesh.topology().recursive_elements_count(true);
+    const Dictionary& nodes = mesh.geometry_fields();
+    for(Uint i = 0; i != nodes.size(); ++i)
+    {
+      BOOST_CHECK(nodes.rank()[i] < nb_parts);
+      if(nodes.rank()[i] == part)
+        ++nb_owned_nodes;
+      const Uint full_idx = full_node_idx[nodes.glb_idx()[i]];
+      for(Uint d = 0; d != full_coords.row_size(); ++d)
+        BOOST_CHECK_EQUAL(nodes.coordinates()[i][d], full_coords[full_idx][d]);
+    }
+    root.remove_component(mesh);
+  }
+  BOOST_CHECK_EQUAL(nb_elements, full_mesh.topology().recursive_elements_count(true));
+  BOOST_CHECK_EQUAL(nb_owned_nodes, full_coords.size());
+  root.remove_component(full_mesh);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_FIXTURE_TEST_SUITE( gmshReaderMPITests_TestSuite, gmshReaderMPITests_Fixture )
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -311,6 +475,62 @@ BOOST_AUTO_TEST_CASE( read_2d_mesh_mix_p1_out )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( read_2d_mesh_binary )
+{
+  // The same square in both binary versions, with the native byte order and with the bytes swapped as on a machine with the other endianness
+  const char* versions[] = { "2.2", "4.1" };
+  for(Uint v = 0; v != 2; ++v)
+  {
+    for(Uint swap = 0; swap != 2; ++swap)
+    {
+      const std::string filename = std::string("square-binary-") + versions[v] + (swap ? "-swapped" : "") + ".msh";
+      write_binary_square(filename, versions[v], swap);
+
+      boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+      Mesh& mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_binary");
+      meshreader->read_mesh_into(filename,mesh);
+      check_square(mesh);
+      Core::instance().root().remove_component(mesh);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( read_2d_mesh_msh4_ascii )
+{
+  {
+    boost::filesystem::ofstream file("square-msh4.msh");
+    file << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n";
+    file << "$PhysicalNames\n2\n1 1 \"wall\"\n2 2 \"fluid\"\n$EndPhysicalNames\n";
+    // Entities: no points, one curve and one surface, each with a bounding box and a physical group
+    file << "$Entities\n0 1 1 0\n1 0 0 0 1 0 0 1 1 0\n1 0 0 0 1 1 0 1 2 0\n$EndEntities\n";
+    // Two node blocks, each with the node numbers followed by the coordinates
+    file << "$Nodes\n2 4 1 4\n1 1 0 2\n1\n2\n0 0 0\n1 0 0\n2 1 0 2\n3\n4\n1 1 0\n0 1 0\n$EndNodes\n";
+    file << "$Elements\n2 3 1 3\n1 1 1 1\n1 1 2\n2 1 2 2\n2 1 2 3\n3 1 3 4\n$EndElements\n";
+    file << "$NodeData\n1\n\"temperature\"\n1\n0\n3\n0\n1\n4\n1 0\n2 1\n3 3\n4 2\n$EndNodeData\n";
+  }
+
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_msh4");
+  meshreader->read_mesh_into("square-msh4.msh",mesh);
+  check_square(mesh);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Read the file in parts, as the ranks of a parallel run would, without communication
+BOOST_AUTO_TEST_CASE( read_parts )
+{
+  check_parts("square-msh4.msh", 2);
+  check_parts("square-binary-4.1-swapped.msh", 3);
+  check_parts("square-binary-2.2.msh", 2);
+  check_parts("../../resources/rectangle-tg-p1.msh", 3);
+  check_parts("../../resources/rectangle-mix-p2.msh", 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   Core::instance().terminate();
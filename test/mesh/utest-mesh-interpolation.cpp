@@ -305,6 +305,48 @@ BOOST_AUTO_TEST_CASE( test_new_interpolation )
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( ParallelInterpolation )
+{
+  // Source mesh, distributed over the processors
+  boost::shared_ptr<MeshGenerator> mesh_gen = allocate_component<SimpleMeshGenerator>("meshgen");
+  Handle<Mesh> source_mesh = Core::instance().root().create_component<Mesh>("parallel_source");
+  mesh_gen->options().set("nb_cells",std::vector<Uint>(2,10));
+  mesh_gen->options().set("lengths",std::vector<Real>(2,1.));
+  mesh_gen->options().set("mesh",source_mesh->uri());
+  mesh_gen->execute();
+
+  // Target mesh, with the parts in reverse order, so that most points are located on another processor
+  Handle<Mesh> target_mesh = Core::instance().root().create_component<Mesh>("parallel_target");
+  mesh_gen->options().set("nb_cells",std::vector<Uint>(2,7));
+  mesh_gen->options().set("mesh",target_mesh->uri());
+  mesh_gen->options().set("part",PE::Comm::instance().size()-1-PE::Comm::instance().rank());
+  mesh_gen->execute();
+
+  Field& source_field = source_mesh->geometry_fields().create_field("linear");
+  const Field& source_coords = source_mesh->geometry_fields().coordinates();
+  for (Uint i=0; i<source_field.size(); ++i)
+    source_field[i][0] = source_coords[i][XX] + 2.*source_coords[i][YY];
+
+  Field& target_field = target_mesh->geometry_fields().create_field("linear");
+  const Field& target_coords = target_mesh->geometry_fields().coordinates();
+
+  boost::shared_ptr< AInterpolator > interpolator = allocate_component<Interpolator>("interpolator");
+
+  // A linear field is interpolated exactly, the first call with store computes the storage,
+  // the second call uses it, and the last call computes the interpolation on the fly
+  const bool store[] = {true, true, false};
+  for (Uint i=0; i<3; ++i)
+  {
+    interpolator->options().set("store",store[i]);
+    target_field = -1.;
+    interpolator->interpolate(source_field,target_field);
+    for (Uint n=0; n<target_field.size(); ++n)
+      BOOST_CHECK_CLOSE(target_field[n][0] + 1., target_coords[n][XX] + 2.*target_coords[n][YY] + 1., 1e-8);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_CASE( finalize_mpi )
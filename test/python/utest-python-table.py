@@ -1,4 +1,5 @@
 from coolfluid import *
+import struct
 
 root = Core.root()
 env = Core.environment()
@@ -37,3 +38,27 @@ cf_check_equal(table[0][0],2,'Table increment failed')
 
 print 'Full table:'
 print table
+
+# The table exports its storage through the buffer protocol, e.g. for numpy.asarray(table)
+view = memoryview(table)
+cf_check_equal(view.shape, (10, 2), 'Incorrect buffer shape')
+cf_check_equal(view.format, 'I', 'Incorrect buffer format')
+values = struct.unpack('20I', view.tobytes())
+cf_check(values[0] == 2 and values[1] == 2 and values[2] == 1, 'Buffer does not alias the table data')
+
+# Resizing is refused as long as the buffer is in use
+resize_failed = False
+try:
+  table.resize(20)
+except:
+  resize_failed = True
+cf_check(resize_failed, 'Table was resized while a buffer was in use')
+cf_check_equal(len(table),10,'Incorrect table size after failed resize')
+
+# Keeping the size does not reallocate, so it is allowed
+table.resize(10)
+cf_check_equal(view.shape, (10, 2), 'Buffer shape changed by a resize to the same size')
+
+del view
+table.resize(20)
+cf_check_equal(len(table),20,'Resize failed after releasing the buffer')
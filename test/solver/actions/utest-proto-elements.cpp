@@ -25,6 +25,9 @@
 #include "mesh/ElementData.hpp"
 #include "mesh/FieldManager.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Space.hpp"
 
 #include "mesh/Integrators/Gauss.hpp"
 #include "mesh/ElementTypes.hpp"
@@ -46,6 +49,7 @@
 #include "solver/actions/Proto/NodeLooper.hpp"
 #include "solver/actions/Proto/Terminals.hpp"
 
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
 #include "Tools/Testing/TimedTestFixture.hpp"
 
 using namespace cf3;
@@ -61,6 +65,22 @@ using namespace boost::assign;
 
 ////////////////////////////////////////////////////
 
+/// Scatter the element volume to each element node
+struct AddElementVolume
+{
+  typedef void result_type;
+
+  template<typename VarT>
+  void operator()(VarT& var) const
+  {
+    var.add_nodal_values(VarT::ElementVectorT::Constant(var.support().volume()));
+  }
+};
+
+static MakeSFOp<AddElementVolume>::type const add_element_volume = {};
+
+////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE( ProtoOperatorsSuite )
 
 //////////////////////////////////////////////////////////////////////////////
@@ -238,6 +258,61 @@ BOOST_AUTO_TEST_CASE( ProtoVectorElementField )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Scatter from elements to nodes using several threads
+BOOST_AUTO_TEST_CASE( ThreadedElementLoop )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("ThreadedLoopMesh");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 20, 20);
+
+  // Elements with the same color may not share nodes
+  BOOST_FOREACH(const mesh::Elements& elements, common::find_components_recursively_with_filter<mesh::Elements>(mesh->topology(), IsElementsVolume()))
+  {
+    std::vector< std::vector<Uint> > colors;
+    color_elements(elements, colors);
+    const Connectivity& connectivity = elements.geometry_space().connectivity();
+    Uint nb_colored = 0;
+    BOOST_FOREACH(const std::vector<Uint>& color, colors)
+    {
+      std::vector<bool> node_used(elements.geometry_fields().size(), false);
+      BOOST_FOREACH(const Uint elem, color)
+      {
+        BOOST_FOREACH(const Uint node, connectivity[elem])
+        {
+          BOOST_CHECK(!node_used[node]);
+          node_used[node] = true;
+        }
+      }
+      nb_colored += color.size();
+    }
+    BOOST_CHECK_EQUAL(nb_colored, elements.size());
+  }
+
+  mesh->geometry_fields().create_field("volumes", "Serial,TwoThreads,FourThreads").add_tag("volumes");
+
+  FieldVariable<0, ScalarField> serial("Serial", "volumes");
+  FieldVariable<1, ScalarField> two_threads("TwoThreads", "volumes");
+  FieldVariable<2, ScalarField> four_threads("FourThreads", "volumes");
+
+  for_each_node(mesh->topology(), group(serial = 0., two_threads = 0., four_threads = 0.));
+
+  for_each_element<LagrangeP1::CellTypes>(mesh->topology(), add_element_volume(serial));
+  for_each_element<LagrangeP1::CellTypes>(mesh->topology(), add_element_volume(two_threads), 2);
+  for_each_element<LagrangeP1::CellTypes>(mesh->topology(), add_element_volume(four_threads), 4);
+
+  const Field& volumes = find_component_with_tag<Field>(mesh->geometry_fields(), "volumes");
+  Real total = 0.;
+  for(Uint i = 0; i != volumes.size(); ++i)
+  {
+    BOOST_CHECK_CLOSE(volumes[i][0], volumes[i][1], 1e-10);
+    // Colored execution gives the same result, regardless of the number of threads
+    BOOST_CHECK_EQUAL(volumes[i][1], volumes[i][2]);
+    total += volumes[i][2];
+  }
+
+  // Each element volume was added to 3 nodes
+  BOOST_CHECK_CLOSE(total, 3., 1e-10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,186 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for proto expressions using the element geometry cache"
+
+#include <boost/test/unit_test.hpp>
+
+#include "solver/actions/Proto/ElementGradDiv.hpp"
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/NodeLooper.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementGeometryCache.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/ElementTypes.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+using namespace cf3::solver::actions::Proto;
+
+////////////////////////////////////////////////////
+
+/// Results of the expressions that use the jacobian or the shape function gradient
+template<typename ETYPE>
+struct GeometryResults
+{
+  typedef Eigen::Matrix<Real, ETYPE::nb_nodes, ETYPE::nb_nodes> ElementMatrixT;
+
+  GeometryResults() : volume(0.), exact_volume(0.), laplacian(0.)
+  {
+    gradient.setZero();
+    stiffness.setZero();
+  }
+
+  Real volume;
+  /// Volume from the element type, which does not use the jacobian
+  Real exact_volume;
+  RealVector2 gradient;
+  Real laplacian;
+  ElementMatrixT stiffness;
+};
+
+/// Distort the mesh, so each element has a different, non-constant jacobian, and set T to a quadratic function
+void setup_mesh(Mesh& mesh)
+{
+  Field& coords = mesh.geometry_fields().coordinates();
+  for(Uint i = 0; i != coords.size(); ++i)
+  {
+    const Real x = coords[i][XX];
+    const Real y = coords[i][YY];
+    coords[i][XX] += 0.03*sin(7.*y + 3.*x);
+    coords[i][YY] += 0.03*cos(5.*x - 2.*y);
+  }
+
+  mesh.geometry_fields().create_field( "scalar", "T" ).add_tag("scalar");
+  FieldVariable<0, ScalarField > T("T", "scalar");
+  for_each_node(mesh.topology(), T = coordinates[0]*coordinates[0] + 3.*coordinates[0]*coordinates[1]);
+}
+
+/// Enable or disable the geometry cache on all elements of the mesh
+void set_cache(Mesh& mesh, const bool enabled)
+{
+  boost_foreach(Elements& elements, common::find_components_recursively<Elements>(mesh.topology()))
+  {
+    elements.geometry_cache().options().set("enabled", enabled);
+    elements.geometry_cache().invalidate();
+  }
+}
+
+/// Number of points stored in the caches of all elements of the mesh
+Uint nb_cached_points(Mesh& mesh)
+{
+  Uint result = 0;
+  boost_foreach(Elements& elements, common::find_components_recursively<Elements>(mesh.topology()))
+  {
+    result += elements.geometry_cache().nb_points();
+  }
+  return result;
+}
+
+template<typename ETYPE>
+GeometryResults<ETYPE> compute_results(Mesh& mesh)
+{
+  using boost::proto::lit;
+
+  FieldVariable<0, ScalarField > T("T", "scalar");
+  GeometryResults<ETYPE> result;
+
+  for_each_element< boost::mpl::vector1<ETYPE> >
+  (
+    mesh.topology(),
+    group
+    (
+      element_quadrature
+      (
+        lit(result.volume) += 1.,
+        lit(result.gradient) += nabla(T)*nodal_values(T),
+        lit(result.laplacian) += partial(T, _i) * partial(T, _i)
+      ),
+      lit(result.stiffness) += integral<2>(transpose(nabla(T))*nabla(T)),
+      lit(result.exact_volume) += volume
+    )
+  );
+
+  return result;
+}
+
+/// Run the expressions without and with the cache and compare the results
+template<typename ETYPE>
+void check_cache(Mesh& mesh)
+{
+  set_cache(mesh, false);
+  const GeometryResults<ETYPE> reference = compute_results<ETYPE>(mesh);
+  BOOST_CHECK_EQUAL(nb_cached_points(mesh), 0u);
+
+  set_cache(mesh, true);
+  const GeometryResults<ETYPE> cached = compute_results<ETYPE>(mesh);
+  BOOST_CHECK(nb_cached_points(mesh) != 0);
+
+  // The second run with the cache enabled reuses the stored points
+  const Uint nb_points = nb_cached_points(mesh);
+  const GeometryResults<ETYPE> reused = compute_results<ETYPE>(mesh);
+  BOOST_CHECK_EQUAL(nb_cached_points(mesh), nb_points);
+
+  BOOST_CHECK_CLOSE(reference.volume, reference.exact_volume, 1e-10);
+  BOOST_CHECK_CLOSE(cached.volume, reference.volume, 1e-10);
+  BOOST_CHECK_CLOSE(cached.laplacian, reference.laplacian, 1e-10);
+  BOOST_CHECK_CLOSE(reused.laplacian, reference.laplacian, 1e-10);
+  for(Uint i = 0; i != 2; ++i)
+  {
+    BOOST_CHECK_CLOSE(cached.gradient[i], reference.gradient[i], 1e-10);
+    BOOST_CHECK_CLOSE(reused.gradient[i], reference.gradient[i], 1e-10);
+  }
+  for(Uint i = 0; i != ETYPE::nb_nodes; ++i)
+  {
+    for(Uint j = 0; j != ETYPE::nb_nodes; ++j)
+    {
+      BOOST_CHECK_SMALL(cached.stiffness(i,j) - reference.stiffness(i,j), 1e-12);
+      BOOST_CHECK_SMALL(reused.stiffness(i,j) - reference.stiffness(i,j), 1e-12);
+    }
+  }
+
+  set_cache(mesh, false);
+}
+
+////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( ProtoGeometryCacheSuite )
+
+BOOST_AUTO_TEST_CASE( Quads )
+{
+  Handle<Mesh> mesh = common::Core::instance().root().create_component<Mesh>("QuadGridGeometryCache");
+  Tools::MeshGeneration::create_rectangle(*mesh, 1., 1., 8, 8);
+  setup_mesh(*mesh);
+  check_cache<LagrangeP1::Quad2D>(*mesh);
+}
+
+BOOST_AUTO_TEST_CASE( Triags )
+{
+  Handle<Mesh> mesh = common::Core::instance().root().create_component<Mesh>("TriagGridGeometryCache");
+  Tools::MeshGeneration::create_rectangle_tris(*mesh, 1., 1., 8, 8);
+  setup_mesh(*mesh);
+  check_cache<LagrangeP1::Triag2D>(*mesh);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,194 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for proto element loops overlapping the ghost synchronization"
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/ActionDirector.hpp"
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementGhostClassification.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/Region.hpp"
+
+#include "mesh/LagrangeP1/Quad2D.hpp"
+
+#include "solver/Tags.hpp"
+
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/FieldSync.hpp"
+#include "solver/actions/Proto/NodeLooper.hpp"
+#include "solver/actions/Proto/ProtoAction.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////
+
+/// Scatter the element volume to each element node
+struct AddElementVolume
+{
+  typedef void result_type;
+
+  template<typename VarT>
+  void operator()(VarT& var) const
+  {
+    var.add_nodal_values(VarT::ElementVectorT::Constant(var.support().volume()));
+  }
+};
+
+static MakeSFOp<AddElementVolume>::type const add_element_volume = {};
+
+/// Scatter the sum of the nodal values of the first variable to each node of the second, so the result depends on ghost values
+struct AddNodalSum
+{
+  typedef void result_type;
+
+  template<typename SourceT, typename DestT>
+  void operator()(SourceT& source, DestT& dest) const
+  {
+    dest.add_nodal_values(DestT::ElementVectorT::Constant(source.value().sum()));
+  }
+};
+
+static MakeSFOp<AddNodalSum>::type const add_nodal_sum = {};
+
+typedef boost::mpl::vector1<LagrangeP1::Quad2D> ElementsT;
+
+////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( ProtoOverlapSuite )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// An element loop that overlaps the synchronization started by the previous action must give the same result as
+// a loop that starts after a blocking synchronization
+BOOST_AUTO_TEST_CASE( OverlappedLoop )
+{
+  Component& root = Core::instance().root();
+  boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+  meshgenerator->options().set("mesh",URI("//overlap_mesh"));
+  meshgenerator->options().set("nb_cells",std::vector<Uint>(2,16));
+  meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+  Mesh& mesh = meshgenerator->generate();
+
+  mesh.geometry_fields().create_field("overlap_test", "PlainA,PlainB,OverlapA,OverlapB").add_tag("overlap_test");
+
+  FieldVariable<0, ScalarField> plain_a("PlainA", "overlap_test");
+  FieldVariable<1, ScalarField> plain_b("PlainB", "overlap_test");
+  FieldVariable<2, ScalarField> overlap_a("OverlapA", "overlap_test");
+  FieldVariable<3, ScalarField> overlap_b("OverlapB", "overlap_test");
+
+  for_each_node(mesh.topology(), group(plain_a = 0., plain_b = 0., overlap_a = 0., overlap_b = 0.));
+
+  // Reference: the second loop starts after the ghost values of the first are up-to-date
+  for_each_element<ElementsT>(mesh.topology(), add_element_volume(plain_a));
+  BOOST_CHECK(!FieldSynchronizer::instance().is_synchronizing());
+  for_each_element<ElementsT>(mesh.topology(), add_nodal_sum(plain_a, plain_b));
+
+  // Overlapped: the action leaves the synchronization of OverlapA in progress, since the next action in its director is a proto action
+  Handle<ActionDirector> director = root.create_component<ActionDirector>("OverlapDirector");
+  boost::shared_ptr<ProtoAction> scatter_volume = create_proto_action("ScatterVolume", elements_expression(ElementsT(), add_element_volume(overlap_a)));
+  *director << scatter_volume << create_proto_action("NodalSum", elements_expression(ElementsT(), add_nodal_sum(overlap_a, overlap_b)));
+  scatter_volume->options().set(solver::Tags::regions(), std::vector<URI>(1, mesh.topology().uri()));
+  scatter_volume->options().set("overlap_synchronization", true);
+  scatter_volume->execute();
+
+  const bool is_parallel = PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+  if(is_parallel)
+  {
+    BOOST_CHECK(FieldSynchronizer::instance().is_synchronizing());
+
+    // There must be elements on both sides of the split, or the test proves nothing
+    Uint nb_interior = 0;
+    Uint nb_boundary = 0;
+    BOOST_FOREACH(Elements& elements, find_components_recursively_with_filter<Elements>(mesh.topology(), IsElementsVolume()))
+    {
+      nb_interior += elements.ghost_classification().interior_elements().size();
+      nb_boundary += elements.ghost_classification().boundary_elements().size();
+    }
+    BOOST_CHECK(nb_interior > 0);
+    BOOST_CHECK(nb_boundary > 0);
+  }
+
+  // This loop runs the interior elements, finishes the exchange, and then runs the elements touching ghosts
+  for_each_element<ElementsT>(mesh.topology(), add_nodal_sum(overlap_a, overlap_b));
+  BOOST_CHECK(!FieldSynchronizer::instance().is_synchronizing());
+
+  const Field& field = find_component_with_tag<Field>(mesh.geometry_fields(), "overlap_test");
+  for(Uint i = 0; i != field.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(field[i][0], field[i][2]);
+    // Only the order of the contributions differs
+    BOOST_CHECK_CLOSE(field[i][1], field[i][3], 1e-10);
+  }
+
+  root.remove_component(*director);
+}
+
+// The synchronization is finished by the action itself if the next action in its director isn't a proto action
+BOOST_AUTO_TEST_CASE( FinishBeforeOtherAction )
+{
+  Component& root = Core::instance().root();
+  Mesh& mesh = *root.get_child("overlap_mesh")->handle<Mesh>();
+
+  FieldVariable<0, ScalarField> plain_a("PlainA", "overlap_test");
+  FieldVariable<1, ScalarField> overlap_a("OverlapA", "overlap_test");
+  for_each_node(mesh.topology(), group(plain_a = 0., overlap_a = 0.));
+  for_each_element<ElementsT>(mesh.topology(), add_element_volume(plain_a));
+
+  Handle<ActionDirector> director = root.create_component<ActionDirector>("OverlapDirector");
+  boost::shared_ptr<ProtoAction> scatter_volume = create_proto_action("ScatterVolume", elements_expression(ElementsT(), add_element_volume(overlap_a)));
+  *director << scatter_volume << allocate_component<ActionDirector>("Other");
+  scatter_volume->options().set(solver::Tags::regions(), std::vector<URI>(1, mesh.topology().uri()));
+  scatter_volume->options().set("overlap_synchronization", true);
+  director->execute();
+  BOOST_CHECK(!FieldSynchronizer::instance().is_synchronizing());
+
+  // Ghost values are up-to-date after the director finished
+  const Field& field = find_component_with_tag<Field>(mesh.geometry_fields(), "overlap_test");
+  for(Uint i = 0; i != field.size(); ++i)
+    BOOST_CHECK_EQUAL(field[i][0], field[i][2]);
+
+  root.remove_component(*director);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
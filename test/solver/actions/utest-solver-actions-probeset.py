@@ -0,0 +1,93 @@
+import sys
+import coolfluid as cf
+
+env = cf.Core.environment()
+env.log_level = 1
+env.only_cpu0_writes = True
+
+root = cf.Core.root()
+domain = root.create_component('Domain', 'cf3.mesh.Domain')
+mesh = domain.create_component('OriginalMesh','cf3.mesh.Mesh')
+
+blocks = root.create_component('model', 'cf3.mesh.BlockMesh.BlockArrays')
+points = blocks.create_points(dimensions = 2, nb_points = 4)
+points[0]  = [0., 0.]
+points[1]  = [1., 0.]
+points[2]  = [1., 1.]
+points[3]  = [0., 1.]
+block_nodes = blocks.create_blocks(1)
+block_nodes[0] = [0, 1, 2, 3]
+block_subdivs = blocks.create_block_subdivisions()
+block_subdivs[0] = [16,16]
+gradings = blocks.create_block_gradings()
+gradings[0] = [1., 1., 1., 1.]
+blocks.create_patch_nb_faces(name = 'bottom', nb_faces = 1)[0] = [0, 1]
+blocks.create_patch_nb_faces(name = 'right', nb_faces = 1)[0] = [1, 2]
+blocks.create_patch_nb_faces(name = 'top', nb_faces = 1)[0] = [2, 3]
+blocks.create_patch_nb_faces(name = 'left', nb_faces = 1)[0] = [3, 0]
+blocks.partition_blocks(nb_partitions = cf.Core.nb_procs(), direction = 1)
+blocks.create_mesh(mesh.uri())
+
+velocity = mesh.geometry.create_field(name = 'velocity', variables='Velocity[vector]')
+pressure = mesh.geometry.create_field(name = 'pressure', variables='Pressure')
+coords = mesh.geometry.coordinates
+
+# Bilinear functions, interpolated exactly by the shape functions
+def exact(x, y, t):
+  return [x + t, 2.*y - t, x*y + t]
+
+def update_fields(t):
+  for i in range(len(coords)):
+    values = exact(coords[i][0], coords[i][1], t)
+    velocity[i][0] = values[0]
+    velocity[i][1] = values[1]
+    pressure[i][0] = values[2]
+
+time = domain.create_component('Time', 'cf3.solver.Time')
+time.time_step = 0.1
+time.end_time = 1.
+
+probe_points = [[0.05, 0.05], [0.5, 0.5], [0.33, 0.71], [0.97, 0.13], [1., 1.], [0.25, 0.999]]
+
+probes = domain.create_component('Probes', 'cf3.solver.actions.ProbeSet')
+probes.dict = mesh.geometry
+probes.time = time
+probes.variables = ['Velocity', 'Pressure']
+probes.coordinates = [c for p in probe_points for c in p]
+
+series_writer = domain.create_component('SeriesWriter', 'cf3.solver.actions.TimeSeriesWriter')
+series_writer.time = time
+series_writer.interval = 5
+
+writer = series_writer.create_component('ProbeWriter', 'cf3.solver.actions.ProbeSetWriter')
+writer.probe_set = probes
+writer.file = cf.URI('probeset.txt')
+
+advance_time = domain.create_component('AdvanceTime', 'cf3.solver.actions.AdvanceTime')
+advance_time.time = time
+
+nb_steps = 11
+for i in range(nb_steps):
+  update_fields(time.current_time)
+  probes.execute()
+  series_writer.execute()
+  advance_time.execute()
+
+if cf.Core.rank() == 0:
+  nb_lines = 0
+  for line in open('probeset.txt'):
+    if line.startswith('#'):
+      continue
+    columns = line.split()
+    iteration = int(columns[0])
+    t = float(columns[1])
+    probe = int(columns[2])
+    if abs(t - iteration*time.time_step) > 1e-10:
+      raise Exception('Bad time ' + str(t) + ' for iteration ' + str(iteration))
+    expected = exact(probe_points[probe][0], probe_points[probe][1], t)
+    for (value, ref) in zip(columns[3:], expected):
+      if abs(float(value) - ref) > 1e-8:
+        raise Exception('Bad value for probe ' + str(probe) + ' at iteration ' + str(iteration) + ': ' + value + ' instead of ' + str(ref))
+    nb_lines += 1
+  if nb_lines != nb_steps*len(probe_points):
+    raise Exception('Expected ' + str(nb_steps*len(probe_points)) + ' lines of probe data, got ' + str(nb_lines))
@@ -0,0 +1,61 @@
+import sys
+import coolfluid as cf
+
+# Restart files written on one number of CPUs and read on another. The rows are matched through the global node indices,
+# which the SimpleMeshGenerator numbers independently of the partitioning.
+# The first argument is "write" or "read", and the read test must run after the write test.
+
+env = cf.Core.environment()
+env.log_level = 1
+env.only_cpu0_writes = True
+
+mode = sys.argv[1]
+
+root = cf.Core.root()
+domain = root.create_component('Domain', 'cf3.mesh.Domain')
+mesh = domain.create_component('Mesh', 'cf3.mesh.Mesh')
+mesh_generator = domain.create_component('MeshGenerator', 'cf3.mesh.SimpleMeshGenerator')
+mesh_generator.options().set('mesh', mesh.uri())
+mesh_generator.options().set('nb_cells', [16, 16])
+mesh_generator.options().set('lengths', [1., 1.])
+mesh_generator.execute()
+
+solution = mesh.geometry.create_field(name = 'solution', variables = 'U[vector]')
+coords = mesh.geometry.coordinates
+
+def exact(x, y):
+  return [x + 2.*y, x*y]
+
+time = domain.create_component('Time', 'cf3.solver.Time')
+
+# Both the single shared file and the file per rank
+for shared_file in [True, False]:
+  suffix = 'Shared' if shared_file else 'Separate'
+  restart_file = cf.URI('restart-redistribute-' + suffix.lower() + '.cf3restart')
+  if mode == 'write':
+    for i in range(len(coords)):
+      values = exact(coords[i][0], coords[i][1])
+      solution[i][0] = values[0]
+      solution[i][1] = values[1]
+    writer = domain.create_component('Writer' + suffix, 'cf3.solver.actions.WriteRestartFile')
+    writer.fields = [solution]
+    writer.file = restart_file
+    writer.time = time
+    writer.shared_file = shared_file
+    writer.execute()
+  elif mode == 'read':
+    for i in range(len(coords)):
+      solution[i][0] = 0.
+      solution[i][1] = 0.
+    reader = domain.create_component('Reader' + suffix, 'cf3.solver.actions.ReadRestartFile')
+    reader.mesh = mesh
+    reader.file = restart_file
+    reader.time = time
+    reader.execute()
+    for i in range(len(coords)):
+      values = exact(coords[i][0], coords[i][1])
+      for j in range(2):
+        if abs(solution[i][j] - values[j]) > 1e-12:
+          raise Exception('Bad value ' + str(solution[i][j]) + ' for component ' + str(j) + ' of node ' + str(i) + ', expected ' + str(values[j]))
+  else:
+    raise Exception('Unknown mode ' + mode)
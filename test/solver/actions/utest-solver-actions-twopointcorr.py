@@ -49,4 +49,38 @@ corr2.interval = 10
 
 for i in range(20):
   corr.execute()
-  corr2.execute()
\ No newline at end of file
+  corr2.execute()
+corr3 = domain.create_component('TwoPointCorrelationPeriodic', 'cf3.solver.actions.TwoPointCorrelation')
+corr3.normal = 2
+corr3.field = coords
+corr3.coordinate = 1.5
+corr3.periodic = True
+corr3.file = cf.URI('two-point-correlation03-{iteration}.txt')
+corr3.interval = 10
+
+# Writing the output of iteration 20 waits for the background write of iteration 10 to finish
+for i in range(20):
+  corr3.execute()
+
+# The field is the coordinate vector, so in each direction the x and y components only depend on the node index i along a line
+# or on the line index, and z is constant. The circular autocorrelation at shift k is the average of c[i]*c[(i+k) % n].
+if cf.Core.rank() == 0:
+  n = 17
+  line_coords = [1. + i/16. for i in range(n)]
+  mean_square = sum([c*c for c in line_coords]) / n
+  expected = [sum([line_coords[i]*line_coords[(i+k) % n] for i in range(n)]) / n for k in range(n)]
+  sections = []
+  for line in open('two-point-correlation03-10.txt'):
+    if line.startswith('#'):
+      sections.append([])
+    else:
+      sections[-1].append([float(v) for v in line.split(',')])
+  if len(sections) != 2 or len(sections[0]) != n or len(sections[1]) != n:
+    raise Exception('Unexpected layout of the periodic correlation file')
+  for (section, along) in zip(sections, [0, 1]):
+    for k in range(n):
+      references = [mean_square, mean_square, 2.25]
+      references[along] = expected[k]
+      for (value, ref) in zip(section[k][1:], references):
+        if abs(value - ref) > 1e-10:
+          raise Exception('Bad periodic correlation ' + str(value) + ' at shift ' + str(k) + ', expected ' + str(ref))
@@ -15,6 +15,7 @@
 #include "common/TypeInfo.hpp"
 #include "common/XML/SignalFrame.hpp"
 #include "common/XML/FileOperations.hpp"
+#include "common/XML/MultiArray.hpp"
 
 #include "ui/network/TCPConnection.hpp"
 #include "ui/network/ErrorHandler.hpp"
@@ -506,6 +507,66 @@ BOOST_AUTO_TEST_CASE( multi_client_send )
 
 //////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( binary_attachments )
+{
+  asio::io_service ios_server;
+  asio::io_service ios_client;
+  Server server( ios_server );
+  Client client( ios_client );
+
+  // connect
+  ios_client.run();
+  ios_server.run_one();
+
+  BOOST_REQUIRE_EQUAL ( client.last_callback_info.error_raised, boost::system::errc::success );
+  BOOST_REQUIRE_EQUAL ( server.m_clients.size(), size_t(1) );
+
+  Server::ClientInfo & info = server.m_clients.begin()->second;
+  server.init_read( info.connection, info.buffer );
+
+  // a frame with a raw and a compressed array
+  boost::multi_array<cf3::Real, 2> table( boost::extents[10000][4] );
+  for( cf3::Uint row = 0 ; row < table.size() ; ++row )
+    for( cf3::Uint col = 0 ; col < 4 ; ++col )
+      table[row][col] = row + 0.25 * col;
+
+  SignalFrame frame = generate_message_frame( "binary" );
+  add_multi_array_in( frame.main_map, "Raw", table, *frame.attachments, false );
+  add_multi_array_in( frame.main_map, "Compressed", table, *frame.attachments, true );
+
+  client.init_send( frame );
+  ios_client.reset();
+  ios_client.run();
+  BOOST_CHECK_EQUAL ( client.last_callback_info.action, LastCallbackInfo::SEND );
+  BOOST_CHECK_EQUAL ( client.last_callback_info.error_raised, boost::system::errc::success );
+
+  ios_server.reset();
+  ios_server.run();
+  BOOST_CHECK_EQUAL ( server.last_callback_info.action, LastCallbackInfo::READ );
+  BOOST_CHECK_EQUAL ( server.last_callback_info.error_raised, boost::system::errc::success );
+
+  // the received frame has its own copy of the blocks
+  BOOST_REQUIRE_EQUAL ( info.buffer.attachments->size(), cf3::Uint(2) );
+  BOOST_CHECK ( info.buffer.attachments->block(0) != frame.attachments->block(0) );
+  BOOST_CHECK ( *info.buffer.attachments->block(1) == *frame.attachments->block(1) );
+
+  std::vector<std::string> names;
+  names.push_back( "Raw" );
+  names.push_back( "Compressed" );
+
+  for( cf3::Uint i = 0 ; i < names.size() ; ++i )
+  {
+    boost::multi_array<cf3::Real, 2> received;
+    std::vector<std::string> labels;
+    get_multi_array( info.buffer.main_map, names[i], received, labels, *info.buffer.attachments );
+
+    BOOST_REQUIRE_EQUAL ( received.num_elements(), table.num_elements() );
+    BOOST_CHECK ( std::equal( received.data(), received.data() + received.num_elements(), table.data() ) );
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( disconnect )
 {
   // 1. server closes the connection, client should throw an error (eof)